@@ -0,0 +1,203 @@
+#include "BRDFLookUp.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <math.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define BRDF_LOOK_UP_SSE2 1
+#include <emmintrin.h>
+#else
+#define BRDF_LOOK_UP_SSE2 0
+#endif
+
+static const float Pi = 3.14159265f;
+
+// Mirrors an integer's bits across the binary point, as
+// radicalInverse_VdC() does
+static float RadicalInverse(uint32_t bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return (float)bits * 2.3283064365386963e-10f;
+}
+
+// --------------------------------------------------------
+// The half vector for one Hammersley point.  With N = +Z,
+// ImportanceSampleGGX()'s tangent frame maps the sampled
+// (x, y, z) to (y, -x, z), and V has no y, so only H's x
+// and z ever matter.
+// --------------------------------------------------------
+static void SampleHalfVector(unsigned int i, unsigned int sampleCount, float roughness, float& hx, float& hz)
+{
+	float a = roughness * roughness;
+	float phi = 2 * Pi * ((float)i / (float)sampleCount);
+	float xiY = RadicalInverse(i);
+	float cosTheta = sqrtf((1 - xiY) / (1 + (a * a - 1) * xiY));
+	float sinTheta = sqrtf(1 - cosTheta * cosTheta);
+	hx = sinTheta * sinf(phi);
+	hz = cosTheta;
+}
+
+// Schlick-Smith geometry for one direction, k = a / 2
+static float G1Schlick(float k, float nDotX)
+{
+	return nDotX / (nDotX * (1 - k) + k);
+}
+
+static float Saturate(float value)
+{
+	return (std::min)((std::max)(value, 0.0f), 1.0f);
+}
+
+void IntegrateEnvironmentBRDF(float roughness, float nDotV, unsigned int sampleCount, float& scale, float& bias)
+{
+	float vx = sqrtf(1 - nDotV * nDotV);
+	float vz = nDotV;
+	float k = roughness * roughness / 2;
+
+	double a = 0, b = 0;
+	for (unsigned int i = 0; i < sampleCount; i++)
+	{
+		float hx, hz;
+		SampleHalfVector(i, sampleCount, roughness, hx, hz);
+		float vDotHRaw = vx * hx + vz * hz;
+		float nDotL = Saturate(2 * vDotHRaw * hz - vz);
+		float nDotH = Saturate(hz);
+		float vDotH = Saturate(vDotHRaw);
+		if (nDotL > 0)
+		{
+			float g = G1Schlick(k, nDotV) * G1Schlick(k, nDotL);
+			float gVis = g * vDotH / (nDotH * nDotV);
+			float fc = powf(1 - vDotH, 5);
+			a += (1 - fc) * gVis;
+			b += fc * gVis;
+		}
+	}
+
+	scale = (float)(a / sampleCount);
+	bias = (float)(b / sampleCount);
+}
+
+// --------------------------------------------------------
+// A row's half vectors, shared by every entry in it since
+// they depend only on roughness.  Padded to a multiple of
+// 4 with zeros, which never pass N dot L > 0.
+// --------------------------------------------------------
+struct HalfVectors
+{
+	std::vector<float> X;
+	std::vector<float> Z;
+	std::vector<float> InverseZ;	// 1 / N dot H
+};
+
+// --------------------------------------------------------
+// One table entry: sums of (1 - Fc) * G_Vis and Fc * G_Vis
+// --------------------------------------------------------
+static void IntegrateEntry(const HalfVectors& h, float k, float nDotV, float& a, float& b)
+{
+	float vx = sqrtf(1 - nDotV * nDotV);
+	float vz = nDotV;
+
+	// G_Vis = G1(V) * G1(L) * V dot H / (N dot H * N dot V),
+	// with everything but G1(L) and V dot H per sample hoisted
+	float gVisScale = G1Schlick(k, nDotV) / nDotV;
+	const float* hxs = h.X.data();
+	const float* hzs = h.Z.data();
+	const float* inverseHzs = h.InverseZ.data();
+	size_t paddedCount = h.X.size();
+
+#if BRDF_LOOK_UP_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 vxs = _mm_set1_ps(vx);
+	const __m128 vzs = _mm_set1_ps(vz);
+	const __m128 ks = _mm_set1_ps(k);
+	const __m128 oneMinusK = _mm_set1_ps(1 - k);
+	const __m128 gVisScales = _mm_set1_ps(gVisScale);
+	__m128 sumA = zero, sumB = zero;
+	for (size_t i = 0; i < paddedCount; i += 4)
+	{
+		__m128 hx = _mm_loadu_ps(hxs + i);
+		__m128 hz = _mm_loadu_ps(hzs + i);
+		__m128 vDotHRaw = _mm_add_ps(_mm_mul_ps(vxs, hx), _mm_mul_ps(vzs, hz));
+		__m128 lz = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(vDotHRaw, vDotHRaw), hz), vzs);
+		__m128 nDotL = _mm_min_ps(_mm_max_ps(lz, zero), one);
+		__m128 vDotH = _mm_min_ps(_mm_max_ps(vDotHRaw, zero), one);
+
+		__m128 g1L = _mm_div_ps(nDotL, _mm_add_ps(_mm_mul_ps(nDotL, oneMinusK), ks));
+		__m128 gVis = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(gVisScales, g1L), vDotH), _mm_loadu_ps(inverseHzs + i));
+		gVis = _mm_and_ps(gVis, _mm_cmpgt_ps(nDotL, zero));
+
+		__m128 f = _mm_sub_ps(one, vDotH);
+		__m128 f2 = _mm_mul_ps(f, f);
+		__m128 fc = _mm_mul_ps(_mm_mul_ps(f2, f2), f);
+		__m128 fcGVis = _mm_mul_ps(fc, gVis);
+		sumA = _mm_add_ps(sumA, _mm_sub_ps(gVis, fcGVis));
+		sumB = _mm_add_ps(sumB, fcGVis);
+	}
+
+	float lanesA[4], lanesB[4];
+	_mm_storeu_ps(lanesA, sumA);
+	_mm_storeu_ps(lanesB, sumB);
+	a = (lanesA[0] + lanesA[1]) + (lanesA[2] + lanesA[3]);
+	b = (lanesB[0] + lanesB[1]) + (lanesB[2] + lanesB[3]);
+#else
+	a = b = 0;
+	for (size_t i = 0; i < paddedCount; i++)
+	{
+		float vDotHRaw = vx * hxs[i] + vz * hzs[i];
+		float nDotL = Saturate(2 * vDotHRaw * hzs[i] - vz);
+		if (nDotL > 0)
+		{
+			float vDotH = Saturate(vDotHRaw);
+			float gVis = gVisScale * G1Schlick(k, nDotL) * vDotH * inverseHzs[i];
+			float f = 1 - vDotH;
+			float fc = f * f * f * f * f;
+			a += gVis - fc * gVis;
+			b += fc * gVis;
+		}
+	}
+#endif
+}
+
+static uint16_t EncodeUNorm16(float value)
+{
+	return (uint16_t)(Saturate(value) * 65535.0f + 0.5f);
+}
+
+void GenerateBRDFLookUp(unsigned int size, unsigned int sampleCount, std::vector<uint16_t>& table, unsigned int threadCount)
+{
+	table.assign((size_t)size * size * 2, 0);
+	if (size == 0 || sampleCount == 0)
+		return;
+
+	size_t paddedCount = (sampleCount + 3) & ~(size_t)3;
+	ParallelFor(size, threadCount, [&](unsigned int y)
+	{
+		HalfVectors h;
+		h.X.assign(paddedCount, 0.0f);
+		h.Z.assign(paddedCount, 0.0f);
+		h.InverseZ.assign(paddedCount, 0.0f);
+
+		float roughness = (y + 0.5f) / size;
+		for (unsigned int i = 0; i < sampleCount; i++)
+		{
+			SampleHalfVector(i, sampleCount, roughness, h.X[i], h.Z[i]);
+			h.InverseZ[i] = 1.0f / Saturate(h.Z[i]);
+		}
+
+		float k = roughness * roughness / 2;
+		uint16_t* row = &table[(size_t)y * size * 2];
+		for (unsigned int x = 0; x < size; x++)
+		{
+			float a, b;
+			IntegrateEntry(h, k, (x + 0.5f) / size, a, b);
+			row[x * 2 + 0] = EncodeUNorm16(a / sampleCount);
+			row[x * 2 + 1] = EncodeUNorm16(b / sampleCount);
+		}
+	});
+}
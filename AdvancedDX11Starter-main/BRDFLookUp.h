@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// The environment BRDF half of the split sum approximation
+// (Karis, "Real Shading in Unreal Engine 4"): for a
+// roughness and N dot V, the scale and bias that turn F0
+// into the reflected fraction of pre-filtered light.
+//
+// Integrated the same way Lighting.hlsli's IBL functions
+// would: Hammersley points, GGX importance sampling of the
+// half vector and Schlick-Smith geometry with k = a / 2.
+// --------------------------------------------------------
+
+// One table entry with plain float math, summed in double
+// so it can serve as a high sample count reference
+void IntegrateEnvironmentBRDF(float roughness, float nDotV, unsigned int sampleCount, float& scale, float& bias);
+
+// Fills a size x size R16G16_UNORM table, N dot V across
+// (x) and roughness down (y), each sampled at the texel
+// center.  Samples are integrated 4 at a time with SSE2
+// and rows are spread across threads (0 for every hardware
+// thread); the table is the same for any thread count.
+void GenerateBRDFLookUp(unsigned int size, unsigned int sampleCount, std::vector<uint16_t>& table, unsigned int threadCount = 0);
@@ -0,0 +1,127 @@
+#include "Benchmark.h"
+#include "Clock.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdio.h>
+#include <time.h>
+
+// Upper limit on iterations, for very fast benchmarks
+static const unsigned int MaxBenchmarkIterations = 100000;
+
+static void PrintResult(const BenchmarkResult& r)
+{
+	printf("%-28s %-12s median %9.4f ms  p99 %9.4f ms  %12.0f items/s\n",
+		r.Name.c_str(), r.Scale.c_str(), r.MedianMs, r.P99Ms, r.ItemsPerSecond);
+}
+
+Benchmark::Benchmark()
+{
+	minIterations = 30;
+	minSeconds = 0.25;
+}
+
+void Benchmark::SetMinimums(unsigned int iterations, double seconds)
+{
+	minIterations = iterations;
+	minSeconds = seconds;
+}
+
+// --------------------------------------------------------
+//  Times one benchmark.  Every iteration is timed on its
+//  own, so the median and p99 reflect the spread rather
+//  than just the average.
+//
+//  name              - What's being timed
+//  scale             - The size of this run, e.g. "10000"
+//  itemsPerIteration - Work per iteration, for throughput
+//  body              - One iteration of the work
+// --------------------------------------------------------
+const BenchmarkResult& Benchmark::Run(
+	const std::string& name,
+	const std::string& scale,
+	uint64_t itemsPerIteration,
+	const std::function<void()>& body)
+{
+	// Warm up caches, allocations, drivers, etc.
+	for (int i = 0; i < 3; i++)
+		body();
+
+	std::vector<double> times;
+	times.reserve(minIterations);
+	int64_t runStart = Clock::NowNanoseconds();
+	while (times.size() < MaxBenchmarkIterations)
+	{
+		int64_t start = Clock::NowNanoseconds();
+		body();
+		int64_t end = Clock::NowNanoseconds();
+		times.push_back((end - start) * 1e-6);
+
+		double elapsed = (end - runStart) * 1e-9;
+		if (times.size() >= minIterations && elapsed >= minSeconds)
+			break;
+	}
+
+	std::sort(times.begin(), times.end());
+	auto percentile = [&](double p) { return times[(size_t)(p * (times.size() - 1) + 0.5)]; };
+
+	BenchmarkResult result;
+	result.Name = name;
+	result.Scale = scale;
+	result.Iterations = (unsigned int)times.size();
+	result.ItemsPerIteration = itemsPerIteration;
+	result.MedianMs = percentile(0.5);
+	result.P99Ms = percentile(0.99);
+	result.MinMs = times.front();
+	result.ItemsPerSecond = result.MedianMs > 0.0 ? itemsPerIteration / (result.MedianMs * 0.001) : 0.0;
+	results.push_back(result);
+
+	PrintResult(result);
+	return results.back();
+}
+
+void Benchmark::Print()
+{
+	for (BenchmarkResult& r : results)
+		PrintResult(r);
+}
+
+// --------------------------------------------------------
+//  Writes the results as:
+//
+//  { "build": "Release", "timestamp": 1700000000,
+//    "results": [ { "name": ..., "scale": ..., "iterations": ...,
+//      "items": ..., "median_ms": ..., "p99_ms": ..., "min_ms": ...,
+//      "items_per_second": ... }, ... ] }
+// --------------------------------------------------------
+bool Benchmark::WriteJSON(const std::string& path)
+{
+	std::ofstream out(path, std::ios::out | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	const char* build = "Debug";
+#else
+	const char* build = "Release";
+#endif
+
+	char line[512];
+	snprintf(line, sizeof(line), "{\n\"build\": \"%s\",\n\"timestamp\": %lld,\n\"results\": [\n", build, (long long)time(0));
+	out << line;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		BenchmarkResult& r = results[i];
+		snprintf(line, sizeof(line),
+			"{\"name\": \"%s\", \"scale\": \"%s\", \"iterations\": %u, \"items\": %llu, "
+			"\"median_ms\": %.6f, \"p99_ms\": %.6f, \"min_ms\": %.6f, \"items_per_second\": %.1f}%s\n",
+			r.Name.c_str(), r.Scale.c_str(), r.Iterations, (unsigned long long)r.ItemsPerIteration,
+			r.MedianMs, r.P99Ms, r.MinMs, r.ItemsPerSecond,
+			i + 1 < results.size() ? "," : "");
+		out << line;
+	}
+
+	out << "]\n}\n";
+	return out.good();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Timings for one benchmark at one scale
+struct BenchmarkResult
+{
+	std::string Name;
+	std::string Scale;
+	unsigned int Iterations;
+	uint64_t ItemsPerIteration;	// Vertices, particles, etc. handled per iteration
+	double MedianMs;
+	double P99Ms;
+	double MinMs;
+	double ItemsPerSecond;		// Throughput at the median time
+};
+
+// --------------------------------------------------------
+// Times one benchmark after another, each at several
+// scales, and writes the results as JSON so runs can be
+// compared across commits.  The benchmarks themselves are
+// in two suites:
+//
+//  - RunPortableBenchmarks() (PortableBenchmarks.h): asset
+//    processing, allocators, IBL precomputation, OBJ
+//    parsing, transforms, particle simulation, shader
+//    constants and ImGui's CPU side, none of which need
+//    Windows or a GPU.  Built on its own by CMakeLists.txt
+//    as EngineBenchmark (the mesh, transform and particle
+//    ones only when DirectXMath is found):
+//
+//      EngineBenchmark [assetFolder] [results.json]
+//
+//  - RunEngineBenchmarks() (EngineBenchmarks.h): those plus
+//    the uploads that need a D3D device (particles, shader
+//    constants, with and without the constant ring), run by
+//    launching
+//
+//      DX11Starter.exe -benchmark results.json
+//
+//    which runs once loading is done, then exits.
+// --------------------------------------------------------
+class Benchmark
+{
+public:
+	Benchmark();
+
+	// Each benchmark runs at least this many times and for
+	// at least this long, after a few warm up iterations
+	void SetMinimums(unsigned int iterations, double seconds);
+
+	const BenchmarkResult& Run(
+		const std::string& name,
+		const std::string& scale,
+		uint64_t itemsPerIteration,
+		const std::function<void()>& body);
+
+	const std::vector<BenchmarkResult>& GetResults() { return results; }
+	void Print();
+	bool WriteJSON(const std::string& path);
+
+private:
+	unsigned int minIterations;
+	double minSeconds;
+	std::vector<BenchmarkResult> results;
+};
@@ -0,0 +1,36 @@
+#include "Benchmark.h"
+#include "PortableBenchmarks.h"
+
+#include <stdio.h>
+#include <string>
+
+// Set by CMakeLists.txt to this source folder's Assets
+#ifndef BENCHMARK_ASSET_FOLDER
+#define BENCHMARK_ASSET_FOLDER "Assets/"
+#endif
+
+// --------------------------------------------------------
+//  The standalone benchmark, built by CMakeLists.txt, for
+//  running the portable suite without Windows or a GPU:
+//
+//  EngineBenchmark [assetFolder] [results.json]
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::string assetFolder = argc > 1 ? argv[1] : BENCHMARK_ASSET_FOLDER;
+	std::string outputPath = argc > 2 ? argv[2] : "Benchmark.json";
+	if (!assetFolder.empty() && assetFolder.back() != '/' && assetFolder.back() != '\\')
+		assetFolder += '/';
+
+	Benchmark benchmark;
+	RunPortableBenchmarks(benchmark, assetFolder);
+
+	if (!benchmark.WriteJSON(outputPath))
+	{
+		printf("Could not write benchmark results to %s\n", outputPath.c_str());
+		return 1;
+	}
+
+	printf("Benchmark results written to %s\n", outputPath.c_str());
+	return 0;
+}
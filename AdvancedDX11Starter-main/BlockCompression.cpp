@@ -0,0 +1,854 @@
+#include "BlockCompression.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <string.h>
+#include <vector>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define BLOCK_COMPRESSION_SSE2 1
+#include <emmintrin.h>
+#else
+#define BLOCK_COMPRESSION_SSE2 0
+#endif
+
+// DXGI_FORMAT values, so this builds without D3D headers
+static const uint32_t DXGIFormatBC1 = 71;
+static const uint32_t DXGIFormatBC1SRGB = 72;
+static const uint32_t DXGIFormatBC4 = 80;
+static const uint32_t DXGIFormatBC5 = 83;
+static const uint32_t DXGIFormatBC7 = 98;
+static const uint32_t DXGIFormatBC7SRGB = 99;
+
+// BC7's 4 bit interpolation weights, out of 64
+static const int BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// --------------------------------------------------------
+// One 4x4 block's pixels, one array per channel so four
+// pixels can be handled at once.  Values are 0-255.
+// --------------------------------------------------------
+struct BlockPixels
+{
+	float Channels[4][16];
+};
+
+const char* GetBlockFormatName(BlockFormat format)
+{
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1: return "BC1";
+	case BLOCK_FORMAT_BC4: return "BC4";
+	case BLOCK_FORMAT_BC5: return "BC5";
+	case BLOCK_FORMAT_BC7: return "BC7";
+	default: return "Unknown";
+	}
+}
+
+const char* GetBlockQualityName(BlockQuality quality)
+{
+	switch (quality)
+	{
+	case BLOCK_QUALITY_FAST: return "fast";
+	case BLOCK_QUALITY_NORMAL: return "normal";
+	case BLOCK_QUALITY_HIGH: return "high";
+	default: return "unknown";
+	}
+}
+
+unsigned int GetBlockBytes(BlockFormat format)
+{
+	return (format == BLOCK_FORMAT_BC1 || format == BLOCK_FORMAT_BC4) ? 8 : 16;
+}
+
+size_t GetCompressedSize(BlockFormat format, unsigned int width, unsigned int height)
+{
+	size_t blocksX = (width + 3) / 4;
+	size_t blocksY = (height + 3) / 4;
+	return blocksX * blocksY * GetBlockBytes(format);
+}
+
+unsigned int GetBlockChannels(BlockFormat format)
+{
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1: return 3;
+	case BLOCK_FORMAT_BC4: return 1;
+	case BLOCK_FORMAT_BC5: return 2;
+	default: return 4;
+	}
+}
+
+uint32_t GetBlockDXGIFormat(BlockFormat format, bool sRGB)
+{
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1: return sRGB ? DXGIFormatBC1SRGB : DXGIFormatBC1;
+	case BLOCK_FORMAT_BC4: return DXGIFormatBC4;
+	case BLOCK_FORMAT_BC5: return DXGIFormatBC5;
+	default: return sRGB ? DXGIFormatBC7SRGB : DXGIFormatBC7;
+	}
+}
+
+// --------------------------------------------------------
+// Reads a block out of the image, repeating the last row
+// and column for blocks hanging off the edge
+// --------------------------------------------------------
+static void LoadBlock(const unsigned char* rgba, unsigned int width, unsigned int height, unsigned int blockX, unsigned int blockY, BlockPixels& block)
+{
+	for (unsigned int y = 0; y < 4; y++)
+	{
+		unsigned int row = (std::min)(blockY * 4 + y, height - 1);
+		for (unsigned int x = 0; x < 4; x++)
+		{
+			unsigned int column = (std::min)(blockX * 4 + x, width - 1);
+			const unsigned char* pixel = rgba + ((size_t)row * width + column) * 4;
+			for (unsigned int c = 0; c < 4; c++)
+				block.Channels[c][y * 4 + x] = pixel[c];
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Picks the closest palette entry for each pixel, over
+// channels [firstChannel, firstChannel + channelCount).
+// Returns the total squared error.
+// --------------------------------------------------------
+static float FindIndices(
+	const BlockPixels& block,
+	unsigned int firstChannel,
+	unsigned int channelCount,
+	const float palette[][4],
+	unsigned int paletteSize,
+	unsigned char indices[16])
+{
+	float totalError = 0;
+
+#if BLOCK_COMPRESSION_SSE2
+	for (unsigned int p = 0; p < 16; p += 4)
+	{
+		__m128 bestError = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+
+		for (unsigned int e = 0; e < paletteSize; e++)
+		{
+			__m128 error = _mm_setzero_ps();
+			for (unsigned int c = firstChannel; c < firstChannel + channelCount; c++)
+			{
+				__m128 difference = _mm_sub_ps(_mm_loadu_ps(&block.Channels[c][p]), _mm_set1_ps(palette[e][c]));
+				error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+			}
+
+			// Strictly less, so ties keep the earlier entry
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+			bestError = _mm_min_ps(error, bestError);
+			bestIndex = _mm_or_si128(
+				_mm_andnot_si128(closer, bestIndex),
+				_mm_and_si128(closer, _mm_set1_epi32((int)e)));
+		}
+
+		int chosen[4];
+		float errors[4];
+		_mm_storeu_si128((__m128i*)chosen, bestIndex);
+		_mm_storeu_ps(errors, bestError);
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			indices[p + i] = (unsigned char)chosen[i];
+			totalError += errors[i];
+		}
+	}
+#else
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		float bestError = FLT_MAX;
+		unsigned int bestIndex = 0;
+		for (unsigned int e = 0; e < paletteSize; e++)
+		{
+			float error = 0;
+			for (unsigned int c = firstChannel; c < firstChannel + channelCount; c++)
+			{
+				float difference = block.Channels[c][p] - palette[e][c];
+				error += difference * difference;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				bestIndex = e;
+			}
+		}
+
+		indices[p] = (unsigned char)bestIndex;
+		totalError += bestError;
+	}
+#endif
+
+	return totalError;
+}
+
+// --------------------------------------------------------
+// Fits a line through the block's colors: the mean, and
+// the direction of greatest variance (by power iteration
+// on the covariance matrix).  Endpoints are the extremes
+// of the pixels projected onto that line.
+// --------------------------------------------------------
+static void FitEndpoints(const BlockPixels& block, unsigned int channelCount, float endpoint0[4], float endpoint1[4])
+{
+	float mean[4] = {};
+	for (unsigned int c = 0; c < channelCount; c++)
+	{
+		for (unsigned int p = 0; p < 16; p++)
+			mean[c] += block.Channels[c][p];
+		mean[c] /= 16.0f;
+	}
+
+	float covariance[4][4] = {};
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		for (unsigned int i = 0; i < channelCount; i++)
+		{
+			for (unsigned int j = 0; j < channelCount; j++)
+				covariance[i][j] += (block.Channels[i][p] - mean[i]) * (block.Channels[j][p] - mean[j]);
+		}
+	}
+
+	float axis[4] = { 1, 1, 1, 1 };
+	for (unsigned int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[4] = {};
+		float length = 0;
+		for (unsigned int i = 0; i < channelCount; i++)
+		{
+			for (unsigned int j = 0; j < channelCount; j++)
+				next[i] += covariance[i][j] * axis[j];
+			length += next[i] * next[i];
+		}
+
+		// A flat block has no direction to speak of
+		if (length < 1e-8f)
+			break;
+
+		length = sqrtf(length);
+		for (unsigned int i = 0; i < channelCount; i++)
+			axis[i] = next[i] / length;
+	}
+
+	float minT = FLT_MAX, maxT = -FLT_MAX;
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		float t = 0;
+		for (unsigned int c = 0; c < channelCount; c++)
+			t += (block.Channels[c][p] - mean[c]) * axis[c];
+		minT = (std::min)(minT, t);
+		maxT = (std::max)(maxT, t);
+	}
+
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		float a = c < channelCount ? axis[c] : 0;
+		endpoint0[c] = (std::min)(255.0f, (std::max)(0.0f, mean[c] + a * minT));
+		endpoint1[c] = (std::min)(255.0f, (std::max)(0.0f, mean[c] + a * maxT));
+	}
+}
+
+// --------------------------------------------------------
+// Least squares endpoints for fixed indices, where each
+// index blends the endpoints by weights[index] (0 is all
+// endpoint0, 1 all endpoint1).  Leaves the endpoints alone
+// if every pixel uses the same blend.
+// --------------------------------------------------------
+static void RefineEndpoints(
+	const BlockPixels& block,
+	unsigned int firstChannel,
+	unsigned int channelCount,
+	const unsigned char indices[16],
+	const float* weights,
+	float endpoint0[4],
+	float endpoint1[4])
+{
+	float aa = 0, ab = 0, bb = 0;
+	float ax[4] = {}, bx[4] = {};
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		float b = weights[indices[p]];
+		float a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (unsigned int c = firstChannel; c < firstChannel + channelCount; c++)
+		{
+			ax[c] += a * block.Channels[c][p];
+			bx[c] += b * block.Channels[c][p];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) < 1e-6f)
+		return;
+
+	for (unsigned int c = firstChannel; c < firstChannel + channelCount; c++)
+	{
+		endpoint0[c] = (std::min)(255.0f, (std::max)(0.0f, (bb * ax[c] - ab * bx[c]) / determinant));
+		endpoint1[c] = (std::min)(255.0f, (std::max)(0.0f, (aa * bx[c] - ab * ax[c]) / determinant));
+	}
+}
+
+static unsigned int GetRefinementPasses(BlockQuality quality)
+{
+	return quality == BLOCK_QUALITY_FAST ? 0 : quality == BLOCK_QUALITY_NORMAL ? 1 : 3;
+}
+
+// === BC1 ==================================================
+
+static unsigned int QuantizeTo565(const float color[4])
+{
+	unsigned int r = (unsigned int)(color[0] * 31.0f / 255.0f + 0.5f);
+	unsigned int g = (unsigned int)(color[1] * 63.0f / 255.0f + 0.5f);
+	unsigned int b = (unsigned int)(color[2] * 31.0f / 255.0f + 0.5f);
+	return (r << 11) | (g << 5) | b;
+}
+
+static void Expand565(unsigned int color, int rgb[3])
+{
+	unsigned int r = (color >> 11) & 31;
+	unsigned int g = (color >> 5) & 63;
+	unsigned int b = color & 31;
+	rgb[0] = (int)((r << 3) | (r >> 2));
+	rgb[1] = (int)((g << 2) | (g >> 4));
+	rgb[2] = (int)((b << 3) | (b >> 2));
+}
+
+// The four colors of a block, in index order.  Blocks with
+// color0 <= color1 use three colors plus black instead.
+static void BuildBC1Palette(unsigned int color0, unsigned int color1, int palette[4][3])
+{
+	Expand565(color0, palette[0]);
+	Expand565(color1, palette[1]);
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		if (color0 > color1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+}
+
+static void EncodeBC1(const BlockPixels& block, BlockQuality quality, unsigned char* output)
+{
+	// Weight of color1 for each index in four color mode
+	static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	// The brighter end goes first, so color0 > color1 is likely
+	float endpoint0[4], endpoint1[4];
+	FitEndpoints(block, 3, endpoint1, endpoint0);
+
+	unsigned int bestColor0 = 0, bestColor1 = 0;
+	unsigned char bestIndices[16] = {};
+	float bestError = FLT_MAX;
+
+	unsigned int passes = GetRefinementPasses(quality);
+	for (unsigned int pass = 0; pass <= passes; pass++)
+	{
+		unsigned int color0 = QuantizeTo565(endpoint0);
+		unsigned int color1 = QuantizeTo565(endpoint1);
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+			std::swap(endpoint0, endpoint1);
+		}
+
+		int palette[4][3];
+		BuildBC1Palette(color0, color1, palette);
+		float paletteFloat[4][4] = {};
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			for (unsigned int c = 0; c < 3; c++)
+				paletteFloat[i][c] = (float)palette[i][c];
+		}
+
+		// Equal endpoints mean three color mode, where only
+		// index 0 is safe to use
+		unsigned char indices[16] = {};
+		float error = FindIndices(block, 0, 3, paletteFloat, color0 == color1 ? 1 : 4, indices);
+		if (error < bestError)
+		{
+			bestError = error;
+			bestColor0 = color0;
+			bestColor1 = color1;
+			memcpy(bestIndices, indices, sizeof(indices));
+		}
+
+		if (pass < passes && color0 != color1)
+			RefineEndpoints(block, 0, 3, indices, weights, endpoint0, endpoint1);
+	}
+
+	uint32_t indexBits = 0;
+	for (unsigned int p = 0; p < 16; p++)
+		indexBits |= (uint32_t)bestIndices[p] << (p * 2);
+
+	output[0] = (unsigned char)bestColor0;
+	output[1] = (unsigned char)(bestColor0 >> 8);
+	output[2] = (unsigned char)bestColor1;
+	output[3] = (unsigned char)(bestColor1 >> 8);
+	for (unsigned int i = 0; i < 4; i++)
+		output[4 + i] = (unsigned char)(indexBits >> (i * 8));
+}
+
+static void DecodeBC1(const unsigned char* input, unsigned char pixels[16][4])
+{
+	unsigned int color0 = input[0] | (input[1] << 8);
+	unsigned int color1 = input[2] | (input[3] << 8);
+	uint32_t indexBits = input[4] | (input[5] << 8) | (input[6] << 16) | ((uint32_t)input[7] << 24);
+
+	int palette[4][3];
+	BuildBC1Palette(color0, color1, palette);
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		unsigned int index = (indexBits >> (p * 2)) & 3;
+		for (unsigned int c = 0; c < 3; c++)
+			pixels[p][c] = (unsigned char)palette[index][c];
+		pixels[p][3] = 255;
+	}
+}
+
+// === BC4 ==================================================
+
+// The eight values of a block, in index order (the six
+// interpolated ones only when value0 > value1)
+static void BuildBC4Palette(unsigned int value0, unsigned int value1, int palette[8])
+{
+	palette[0] = (int)value0;
+	palette[1] = (int)value1;
+	if (value0 > value1)
+	{
+		for (int i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * (int)value0 + i * (int)value1 + 3) / 7;
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+			palette[i + 1] = ((5 - i) * (int)value0 + i * (int)value1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+static float EvaluateBC4(const BlockPixels& block, unsigned int channel, unsigned int value0, unsigned int value1, unsigned char indices[16])
+{
+	int palette[8];
+	BuildBC4Palette(value0, value1, palette);
+
+	float paletteFloat[8][4] = {};
+	for (unsigned int i = 0; i < 8; i++)
+		paletteFloat[i][channel] = (float)palette[i];
+
+	return FindIndices(block, channel, 1, paletteFloat, value0 == value1 ? 1 : 8, indices);
+}
+
+static void EncodeBC4(const BlockPixels& block, unsigned int channel, BlockQuality quality, unsigned char* output)
+{
+	// Weight of value1 for each index in eight value mode
+	static const float weights[8] = { 0.0f, 1.0f, 1 / 7.0f, 2 / 7.0f, 3 / 7.0f, 4 / 7.0f, 5 / 7.0f, 6 / 7.0f };
+
+	float low = 255, high = 0;
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		low = (std::min)(low, block.Channels[channel][p]);
+		high = (std::max)(high, block.Channels[channel][p]);
+	}
+
+	unsigned int bestValue0 = (unsigned int)high;
+	unsigned int bestValue1 = (unsigned int)low;
+	unsigned char bestIndices[16] = {};
+	float bestError = EvaluateBC4(block, channel, bestValue0, bestValue1, bestIndices);
+
+	// Refine the extremes, keeping value0 > value1 for eight value mode
+	float endpoint0[4] = {}, endpoint1[4] = {};
+	endpoint0[channel] = high;
+	endpoint1[channel] = low;
+	unsigned int passes = GetRefinementPasses(quality);
+	for (unsigned int pass = 0; pass < passes && bestValue0 != bestValue1; pass++)
+	{
+		RefineEndpoints(block, channel, 1, bestIndices, weights, endpoint0, endpoint1);
+		unsigned int value0 = (unsigned int)(endpoint0[channel] + 0.5f);
+		unsigned int value1 = (unsigned int)(endpoint1[channel] + 0.5f);
+		if (value0 <= value1)
+			break;
+
+		unsigned char indices[16];
+		float error = EvaluateBC4(block, channel, value0, value1, indices);
+		if (error >= bestError)
+			break;
+
+		bestError = error;
+		bestValue0 = value0;
+		bestValue1 = value1;
+		memcpy(bestIndices, indices, sizeof(indices));
+	}
+
+	// A small search around the best endpoints catches
+	// rounding the refinement can't
+	if (quality == BLOCK_QUALITY_HIGH && bestValue0 != bestValue1)
+	{
+		unsigned int center0 = bestValue0, center1 = bestValue1;
+		for (int d0 = -2; d0 <= 2; d0++)
+		{
+			for (int d1 = -2; d1 <= 2; d1++)
+			{
+				int value0 = (int)center0 + d0;
+				int value1 = (int)center1 + d1;
+				if (value0 > 255 || value1 < 0 || value0 <= value1)
+					continue;
+
+				unsigned char indices[16];
+				float error = EvaluateBC4(block, channel, value0, value1, indices);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestValue0 = value0;
+					bestValue1 = value1;
+					memcpy(bestIndices, indices, sizeof(indices));
+				}
+			}
+		}
+	}
+
+	uint64_t indexBits = 0;
+	for (unsigned int p = 0; p < 16; p++)
+		indexBits |= (uint64_t)bestIndices[p] << (p * 3);
+
+	output[0] = (unsigned char)bestValue0;
+	output[1] = (unsigned char)bestValue1;
+	for (unsigned int i = 0; i < 6; i++)
+		output[2 + i] = (unsigned char)(indexBits >> (i * 8));
+}
+
+static void DecodeBC4(const unsigned char* input, unsigned int channel, unsigned char pixels[16][4])
+{
+	int palette[8];
+	BuildBC4Palette(input[0], input[1], palette);
+
+	uint64_t indexBits = 0;
+	for (unsigned int i = 0; i < 6; i++)
+		indexBits |= (uint64_t)input[2 + i] << (i * 8);
+
+	for (unsigned int p = 0; p < 16; p++)
+		pixels[p][channel] = (unsigned char)palette[(indexBits >> (p * 3)) & 7];
+}
+
+// === BC7 (mode 6) =========================================
+
+class BlockBitWriter
+{
+public:
+	BlockBitWriter(unsigned char* data) : data(data), position(0) { memset(data, 0, 16); }
+
+	void Write(uint32_t value, unsigned int bits)
+	{
+		for (unsigned int i = 0; i < bits; i++, position++)
+		{
+			if ((value >> i) & 1)
+				data[position >> 3] |= (unsigned char)(1 << (position & 7));
+		}
+	}
+
+private:
+	unsigned char* data;
+	unsigned int position;
+};
+
+class BlockBitReader
+{
+public:
+	BlockBitReader(const unsigned char* data) : data(data), position(0) {}
+
+	uint32_t Read(unsigned int bits)
+	{
+		uint32_t value = 0;
+		for (unsigned int i = 0; i < bits; i++, position++)
+			value |= (uint32_t)((data[position >> 3] >> (position & 7)) & 1) << i;
+		return value;
+	}
+
+private:
+	const unsigned char* data;
+	unsigned int position;
+};
+
+// Mode 6 endpoints are 7 bits per channel plus a p-bit
+// shared by the whole endpoint
+struct BC7Endpoints
+{
+	unsigned int Color[2][4];
+	unsigned int PBit[2];
+};
+
+static void QuantizeBC7Endpoint(const float endpoint[4], unsigned int pBit, unsigned int color[4])
+{
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		int value = (int)floorf((endpoint[c] - pBit) / 2.0f + 0.5f);
+		color[c] = (unsigned int)(std::min)(127, (std::max)(0, value));
+	}
+}
+
+static void BuildBC7Palette(const BC7Endpoints& endpoints, int palette[16][4])
+{
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		int value0 = (int)(endpoints.Color[0][c] << 1 | endpoints.PBit[0]);
+		int value1 = (int)(endpoints.Color[1][c] << 1 | endpoints.PBit[1]);
+		for (unsigned int i = 0; i < 16; i++)
+			palette[i][c] = ((64 - BC7Weights4[i]) * value0 + BC7Weights4[i] * value1 + 32) >> 6;
+	}
+}
+
+static float EvaluateBC7(const BlockPixels& block, const BC7Endpoints& endpoints, unsigned char indices[16])
+{
+	int palette[16][4];
+	BuildBC7Palette(endpoints, palette);
+
+	float paletteFloat[16][4];
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		for (unsigned int c = 0; c < 4; c++)
+			paletteFloat[i][c] = (float)palette[i][c];
+	}
+
+	return FindIndices(block, 0, 4, paletteFloat, 16, indices);
+}
+
+static void EncodeBC7(const BlockPixels& block, BlockQuality quality, unsigned char* output)
+{
+	static const float weights[16] =
+	{
+		0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+		34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f
+	};
+
+	float endpoint0[4], endpoint1[4];
+	FitEndpoints(block, 4, endpoint0, endpoint1);
+
+	BC7Endpoints best = {};
+	unsigned char bestIndices[16] = {};
+	float bestError = FLT_MAX;
+
+	unsigned int passes = GetRefinementPasses(quality);
+	for (unsigned int pass = 0; pass <= passes; pass++)
+	{
+		// Fast only tries the p-bits that suit each endpoint's
+		// average, the others try all four pairs
+		unsigned int pBitPairs = quality == BLOCK_QUALITY_FAST ? 1 : 4;
+		for (unsigned int pair = 0; pair < pBitPairs; pair++)
+		{
+			BC7Endpoints candidate;
+			candidate.PBit[0] = pair & 1;
+			candidate.PBit[1] = pair >> 1;
+			if (quality == BLOCK_QUALITY_FAST)
+			{
+				candidate.PBit[0] = (unsigned int)((endpoint0[0] + endpoint0[1] + endpoint0[2] + endpoint0[3]) / 4.0f + 0.5f) & 1;
+				candidate.PBit[1] = (unsigned int)((endpoint1[0] + endpoint1[1] + endpoint1[2] + endpoint1[3]) / 4.0f + 0.5f) & 1;
+			}
+
+			QuantizeBC7Endpoint(endpoint0, candidate.PBit[0], candidate.Color[0]);
+			QuantizeBC7Endpoint(endpoint1, candidate.PBit[1], candidate.Color[1]);
+
+			unsigned char indices[16];
+			float error = EvaluateBC7(block, candidate, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = candidate;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+		}
+
+		if (pass < passes)
+			RefineEndpoints(block, 0, 4, bestIndices, weights, endpoint0, endpoint1);
+	}
+
+	// The first pixel's index is stored without its top bit,
+	// so it has to be in the lower half - flip if it isn't
+	if (bestIndices[0] >= 8)
+	{
+		std::swap(best.Color[0], best.Color[1]);
+		std::swap(best.PBit[0], best.PBit[1]);
+		for (unsigned int p = 0; p < 16; p++)
+			bestIndices[p] = 15 - bestIndices[p];
+	}
+
+	BlockBitWriter writer(output);
+	writer.Write(1 << 6, 7);
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		writer.Write(best.Color[0][c], 7);
+		writer.Write(best.Color[1][c], 7);
+	}
+	writer.Write(best.PBit[0], 1);
+	writer.Write(best.PBit[1], 1);
+	for (unsigned int p = 0; p < 16; p++)
+		writer.Write(bestIndices[p], p == 0 ? 3 : 4);
+}
+
+// Only mode 6 is decoded, as that's all EncodeBC7() writes.
+// Anything else decodes as transparent black.
+static void DecodeBC7(const unsigned char* input, unsigned char pixels[16][4])
+{
+	BlockBitReader reader(input);
+	if (reader.Read(7) != (1 << 6))
+	{
+		memset(pixels, 0, 16 * 4);
+		return;
+	}
+
+	BC7Endpoints endpoints;
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		endpoints.Color[0][c] = reader.Read(7);
+		endpoints.Color[1][c] = reader.Read(7);
+	}
+	endpoints.PBit[0] = reader.Read(1);
+	endpoints.PBit[1] = reader.Read(1);
+
+	int palette[16][4];
+	BuildBC7Palette(endpoints, palette);
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		unsigned int index = reader.Read(p == 0 ? 3 : 4);
+		for (unsigned int c = 0; c < 4; c++)
+			pixels[p][c] = (unsigned char)palette[index][c];
+	}
+}
+
+// === Whole images =========================================
+
+static void CompressBlockRows(
+	const unsigned char* rgba,
+	unsigned int width,
+	unsigned int height,
+	BlockFormat format,
+	BlockQuality quality,
+	unsigned char* output,
+	unsigned int firstRow,
+	unsigned int endRow)
+{
+	unsigned int blocksX = (width + 3) / 4;
+	unsigned int blockBytes = GetBlockBytes(format);
+	BlockPixels block;
+
+	for (unsigned int blockY = firstRow; blockY < endRow; blockY++)
+	{
+		for (unsigned int blockX = 0; blockX < blocksX; blockX++)
+		{
+			LoadBlock(rgba, width, height, blockX, blockY, block);
+			unsigned char* out = output + ((size_t)blockY * blocksX + blockX) * blockBytes;
+
+			switch (format)
+			{
+			case BLOCK_FORMAT_BC1: EncodeBC1(block, quality, out); break;
+			case BLOCK_FORMAT_BC4: EncodeBC4(block, 0, quality, out); break;
+			case BLOCK_FORMAT_BC5:
+				EncodeBC4(block, 0, quality, out);
+				EncodeBC4(block, 1, quality, out + 8);
+				break;
+			case BLOCK_FORMAT_BC7: EncodeBC7(block, quality, out); break;
+			}
+		}
+	}
+}
+
+void CompressBlocks(
+	const unsigned char* rgba,
+	unsigned int width,
+	unsigned int height,
+	BlockFormat format,
+	BlockQuality quality,
+	unsigned char* output,
+	unsigned int threadCount)
+{
+	if (width == 0 || height == 0)
+		return;
+
+	// Each row of blocks is plenty of work to hand out alone
+	unsigned int blocksY = (height + 3) / 4;
+	ParallelFor(blocksY, threadCount, [&](unsigned int blockY)
+	{
+		CompressBlockRows(rgba, width, height, format, quality, output, blockY, blockY + 1);
+	});
+}
+
+void DecompressBlocks(
+	const unsigned char* blocks,
+	unsigned int width,
+	unsigned int height,
+	BlockFormat format,
+	unsigned char* rgba)
+{
+	unsigned int blocksX = (width + 3) / 4;
+	unsigned int blocksY = (height + 3) / 4;
+	unsigned int blockBytes = GetBlockBytes(format);
+
+	for (unsigned int blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (unsigned int blockX = 0; blockX < blocksX; blockX++)
+		{
+			const unsigned char* in = blocks + ((size_t)blockY * blocksX + blockX) * blockBytes;
+			unsigned char pixels[16][4] = {};
+			for (unsigned int p = 0; p < 16; p++)
+				pixels[p][3] = 255;
+
+			switch (format)
+			{
+			case BLOCK_FORMAT_BC1: DecodeBC1(in, pixels); break;
+			case BLOCK_FORMAT_BC4: DecodeBC4(in, 0, pixels); break;
+			case BLOCK_FORMAT_BC5:
+				DecodeBC4(in, 0, pixels);
+				DecodeBC4(in + 8, 1, pixels);
+				break;
+			case BLOCK_FORMAT_BC7: DecodeBC7(in, pixels); break;
+			}
+
+			// Only write the pixels that are inside the image
+			for (unsigned int y = 0; y < 4 && blockY * 4 + y < height; y++)
+			{
+				for (unsigned int x = 0; x < 4 && blockX * 4 + x < width; x++)
+				{
+					unsigned char* out = rgba + ((size_t)(blockY * 4 + y) * width + blockX * 4 + x) * 4;
+					memcpy(out, pixels[y * 4 + x], 4);
+				}
+			}
+		}
+	}
+}
+
+double CalculatePSNR(
+	const unsigned char* a,
+	const unsigned char* b,
+	unsigned int width,
+	unsigned int height,
+	unsigned int channelCount)
+{
+	double squaredError = 0;
+	size_t pixelCount = (size_t)width * height;
+	for (size_t p = 0; p < pixelCount; p++)
+	{
+		for (unsigned int c = 0; c < channelCount; c++)
+		{
+			double difference = (double)a[p * 4 + c] - b[p * 4 + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	double meanSquaredError = squaredError / ((double)pixelCount * channelCount);
+	if (meanSquaredError <= 0)
+		return 100.0;
+
+	return (std::min)(100.0, 10.0 * log10(255.0 * 255.0 / meanSquaredError));
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// CPU block compression for material textures:
+//
+//  BC1 - RGB, 4 bits per pixel (albedo, when size matters most)
+//  BC4 - One channel (red), 4 bits per pixel (roughness, metal)
+//  BC5 - Two channels (red, green), 8 bits per pixel (normals)
+//  BC7 - RGBA, 8 bits per pixel (albedo)
+//
+// The BC7 encoder only writes mode 6 (one subset, RGBA
+// endpoints with p-bits, 4 bit indices), which covers
+// smooth material textures well without the partition
+// searches the other modes need.
+//
+// Endpoint fitting uses the block's principal axis, then
+// least squares refinement; index selection is SSE2 when
+// available.  Rows of blocks are spread over the shared
+// worker pool (see ParallelFor.h).  Pixels and blocks are
+// plain byte arrays, so the baker, benchmarks and tests
+// all run it without a device.
+// --------------------------------------------------------
+enum BlockFormat
+{
+	BLOCK_FORMAT_BC1,
+	BLOCK_FORMAT_BC4,
+	BLOCK_FORMAT_BC5,
+	BLOCK_FORMAT_BC7
+};
+
+enum BlockQuality
+{
+	BLOCK_QUALITY_FAST,		// Principal axis endpoints only
+	BLOCK_QUALITY_NORMAL,	// ...plus a refinement pass and a p-bit search
+	BLOCK_QUALITY_HIGH		// ...plus more refinement and an endpoint search
+};
+
+const char* GetBlockFormatName(BlockFormat format);
+const char* GetBlockQualityName(BlockQuality quality);
+
+// Bytes per 4x4 block, and for a whole image (partial
+// blocks at the edges count as whole ones)
+unsigned int GetBlockBytes(BlockFormat format);
+size_t GetCompressedSize(BlockFormat format, unsigned int width, unsigned int height);
+
+// Channels the format keeps, which are the ones compared
+// by CalculatePSNR()
+unsigned int GetBlockChannels(BlockFormat format);
+
+// The matching DXGI_FORMAT value.  Only BC1 and BC7 have
+// sRGB versions.
+uint32_t GetBlockDXGIFormat(BlockFormat format, bool sRGB);
+
+// Compresses an RGBA8 image into output, which needs
+// GetCompressedSize() bytes.  A thread count of 0 uses
+// every hardware thread.
+void CompressBlocks(
+	const unsigned char* rgba,
+	unsigned int width,
+	unsigned int height,
+	BlockFormat format,
+	BlockQuality quality,
+	unsigned char* output,
+	unsigned int threadCount = 0);
+
+// Decodes blocks written by CompressBlocks() back to RGBA8.
+// Channels the format doesn't store come back as 0 (alpha
+// as 255).
+void DecompressBlocks(
+	const unsigned char* blocks,
+	unsigned int width,
+	unsigned int height,
+	BlockFormat format,
+	unsigned char* rgba);
+
+// Peak signal to noise ratio in dB between two RGBA8
+// images, over their first channelCount channels.
+// Identical images return 100.
+double CalculatePSNR(
+	const unsigned char* a,
+	const unsigned char* b,
+	unsigned int width,
+	unsigned int height,
+	unsigned int channelCount);
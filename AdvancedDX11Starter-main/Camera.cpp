@@ -1,8 +1,20 @@
 #include "Camera.h"
 #include "Input.h"
 
+#include <math.h>
+
 using namespace DirectX;
 
+// Blends between two angles the short way round, so an
+// angle that has wrapped past +-pi between steps doesn't
+// spin the long way in between
+static float LerpAngle(float from, float to, float alpha)
+{
+	float delta = fmodf(to - from + XM_PI, XM_2PI);
+	if (delta < 0) delta += XM_2PI;
+	return from + (delta - XM_PI) * alpha;
+}
+
 // Creates a camera at the specified position
 Camera::Camera(float x, float y, float z, float moveSpeed, float mouseLookSpeed, float aspectRatio)
 {
@@ -10,6 +22,11 @@ Camera::Camera(float x, float y, float z, float moveSpeed, float mouseLookSpeed,
 	this->mouseLookSpeed = mouseLookSpeed;
 	transform.SetPosition(x, y, z);
 
+	previousPosition = transform.GetPosition();
+	previousPitchYawRoll = transform.GetPitchYawRoll();
+	pendingPitch = 0;
+	pendingYaw = 0;
+
 	UpdateViewMatrix();
 	UpdateProjectionMatrix(aspectRatio);
 }
@@ -19,9 +36,14 @@ Camera::~Camera()
 { }
 
 
-// Camera's update, which looks for key presses
+// Camera's update, which looks for key presses.  This runs once
+// per fixed simulation step, so dt is always the same.
 void Camera::Update(float dt)
 {
+	// Remember where we were, for interpolation
+	previousPosition = transform.GetPosition();
+	previousPitchYawRoll = transform.GetPitchYawRoll();
+
 	// Current speed
 	float speed = dt * movementSpeed;
 
@@ -40,35 +62,66 @@ void Camera::Update(float dt)
 	if (input.KeyDown('X')) { transform.MoveAbsolute(0, -speed, 0); }
 	if (input.KeyDown(' ')) { transform.MoveAbsolute(0, speed, 0); }
 
+	// Apply any mouse look gathered since the last step
+	transform.Rotate(pendingPitch, pendingYaw, 0);
+	pendingPitch = 0;
+	pendingYaw = 0;
+
+	// Update the view every step - could be optimized
+	UpdateViewMatrix();
+
+}
+
+// Gathers mouse look once per frame, since mouse deltas are per
+// frame and a frame may run any number of simulation steps.  The
+// rotation is applied on the next step.
+void Camera::UpdateLook(float lookScale)
+{
+	Input& input = Input::GetInstance();
+
 	// Handle mouse movement only when button is down
 	if (input.MouseLeftDown())
 	{
 		// Calculate cursor change
-		float xDiff = dt * mouseLookSpeed * input.GetMouseXDelta();
-		float yDiff = dt * mouseLookSpeed * input.GetMouseYDelta();
-		transform.Rotate(yDiff, xDiff, 0);
+		pendingYaw += lookScale * mouseLookSpeed * input.GetMouseXDelta();
+		pendingPitch += lookScale * mouseLookSpeed * input.GetMouseYDelta();
 	}
-
-	// Update the view every frame - could be optimized
-	UpdateViewMatrix();
-
 }
 
 // Creates a new view matrix based on current position and orientation
 void Camera::UpdateViewMatrix()
+{
+	BuildViewMatrix(transform.GetPosition(), transform.GetPitchYawRoll());
+}
+
+// Creates a view matrix blended between the previous and current steps
+void Camera::Interpolate(float alpha)
+{
+	XMFLOAT3 pos;
+	XMFLOAT3 rot;
+	XMFLOAT3 currentPos = transform.GetPosition();
+	XMFLOAT3 currentRot = transform.GetPitchYawRoll();
+	XMStoreFloat3(&pos, XMVectorLerp(XMLoadFloat3(&previousPosition), XMLoadFloat3(&currentPos), alpha));
+	rot.x = LerpAngle(previousPitchYawRoll.x, currentRot.x, alpha);
+	rot.y = LerpAngle(previousPitchYawRoll.y, currentRot.y, alpha);
+	rot.z = LerpAngle(previousPitchYawRoll.z, currentRot.z, alpha);
+
+	BuildViewMatrix(pos, rot);
+}
+
+void Camera::BuildViewMatrix(XMFLOAT3 position, XMFLOAT3 pitchYawRoll)
 {
 	// Rotate the standard "forward" matrix by our rotation
 	// This gives us our "look direction"
-	XMFLOAT3 rot = transform.GetPitchYawRoll();
-	XMVECTOR dir = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&rot)));
+	XMVECTOR dir = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll)));
 
-	XMFLOAT3 pos = transform.GetPosition();
 	XMMATRIX view = XMMatrixLookToLH(
-		XMLoadFloat3(&pos),
+		XMLoadFloat3(&position),
 		dir,
 		XMVectorSet(0, 1, 0, 0));
 
 	XMStoreFloat4x4(&viewMatrix, view);
+	viewPosition = position;
 }
 
 // Updates the projection matrix
@@ -11,13 +11,19 @@ public:
 	~Camera();
 
 	// Updating
-	void Update(float dt);
+	void Update(float dt);					// One fixed simulation step
+	void UpdateLook(float lookScale);		// Once per frame, gathers mouse look
 	void UpdateViewMatrix();
 	void UpdateProjectionMatrix(float aspectRatio);
 
+	// Builds the view matrix between the previous and
+	// current simulation steps (alpha in [0, 1])
+	void Interpolate(float alpha);
+
 	// Getters
 	DirectX::XMFLOAT4X4 GetView() { return viewMatrix; }
 	DirectX::XMFLOAT4X4 GetProjection() { return projMatrix; }
+	DirectX::XMFLOAT3 GetViewPosition() { return viewPosition; }	// Position the view matrix was built from
 
 	Transform* GetTransform();
 
@@ -25,10 +31,21 @@ private:
 	// Camera matrices
 	DirectX::XMFLOAT4X4 viewMatrix;
 	DirectX::XMFLOAT4X4 projMatrix;
+	DirectX::XMFLOAT3 viewPosition;
 
 	Transform transform;
 
+	// State as of the previous simulation step
+	DirectX::XMFLOAT3 previousPosition;
+	DirectX::XMFLOAT3 previousPitchYawRoll;
+
+	// Mouse look gathered per frame, applied on the next step
+	float pendingPitch;
+	float pendingYaw;
+
 	float movementSpeed;
 	float mouseLookSpeed;
+
+	void BuildViewMatrix(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 pitchYawRoll);
 };
 
@@ -0,0 +1,144 @@
+#include "Clock.h"
+
+#include <chrono>
+
+// --------------------------------------------------------
+//  Starts the clock at the current time
+// --------------------------------------------------------
+Clock::Clock()
+{
+	Reset();
+}
+
+// --------------------------------------------------------
+//  Current time on the steady clock, in nanoseconds
+// --------------------------------------------------------
+int64_t Clock::NowNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// --------------------------------------------------------
+//  Restarts the clock from zero
+// --------------------------------------------------------
+void Clock::Reset()
+{
+	startTime = NowNanoseconds();
+	previousTime = startTime;
+	currentTime = startTime;
+}
+
+// --------------------------------------------------------
+//  Samples the clock, returning the seconds elapsed since
+//  the previous sample (never negative)
+// --------------------------------------------------------
+double Clock::Tick()
+{
+	currentTime = NowNanoseconds();
+	double delta = (currentTime - previousTime) * 1e-9;
+	previousTime = currentTime;
+
+	return delta < 0.0 ? 0.0 : delta;
+}
+
+double Clock::GetTotalSeconds()
+{
+	return (currentTime - startTime) * 1e-9;
+}
+
+
+// --------------------------------------------------------
+//  Sets up the timestep
+//
+//  ticksPerSecond   - Simulation rate, in Hz
+//  maxStepsPerFrame - Limit on catch-up steps in one frame,
+//                     so a long hitch can't snowball into
+//                     ever longer frames
+// --------------------------------------------------------
+FixedTimestep::FixedTimestep(double ticksPerSecond, unsigned int maxStepsPerFrame)
+{
+	this->maxStepsPerFrame = maxStepsPerFrame;
+	SetTickRate(ticksPerSecond);
+	Reset();
+}
+
+// --------------------------------------------------------
+//  Changes the simulation rate.  Time already accumulated
+//  is kept, so this is safe to call mid-run.
+// --------------------------------------------------------
+void FixedTimestep::SetTickRate(double ticksPerSecond)
+{
+	if (ticksPerSecond <= 0.0)
+		return;
+
+	stepSeconds = 1.0 / ticksPerSecond;
+}
+
+// --------------------------------------------------------
+//  Starts over from simulation time zero
+// --------------------------------------------------------
+void FixedTimestep::Reset()
+{
+	accumulator = 0.0;
+	simulationTime = 0.0;
+	pendingSteps = 0;
+	stepCount = 0;
+	droppedSteps = 0;
+}
+
+// --------------------------------------------------------
+//  Adds a frame's elapsed time and works out how many
+//  whole steps it pays for.  Anything beyond the per-frame
+//  limit is dropped (the simulation runs slow rather than
+//  falling further and further behind).
+// --------------------------------------------------------
+unsigned int FixedTimestep::Advance(double frameSeconds)
+{
+	if (frameSeconds > 0.0)
+		accumulator += frameSeconds;
+
+	bool dropped = false;
+	while (accumulator >= stepSeconds)
+	{
+		accumulator -= stepSeconds;
+		if (pendingSteps < maxStepsPerFrame)
+			pendingSteps++;
+		else
+		{
+			droppedSteps++;
+			dropped = true;
+		}
+	}
+
+	// With the catch-up limit hit, whatever is left over
+	// is dropped too so the next frame starts clean
+	if (dropped)
+		accumulator = 0.0;
+
+	return pendingSteps;
+}
+
+// --------------------------------------------------------
+//  Consumes one pending step, moving simulation time on
+// --------------------------------------------------------
+bool FixedTimestep::Step()
+{
+	if (pendingSteps == 0)
+		return false;
+
+	pendingSteps--;
+	stepCount++;
+	simulationTime += stepSeconds;
+	return true;
+}
+
+// --------------------------------------------------------
+//  The time matching GetAlpha(): one step behind the
+//  latest state, plus whatever is in the accumulator
+// --------------------------------------------------------
+double FixedTimestep::GetInterpolatedTime()
+{
+	double time = simulationTime - stepSeconds + accumulator;
+	return time < 0.0 ? 0.0 : time;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+// --------------------------------------------------------
+// A portable high resolution clock, built on the C++
+// steady clock (which is QueryPerformanceCounter on
+// Windows and CLOCK_MONOTONIC on Linux)
+// --------------------------------------------------------
+class Clock
+{
+public:
+	Clock();
+
+	// Raw time, in nanoseconds since an arbitrary epoch
+	static int64_t NowNanoseconds();
+
+	void Reset();
+	double Tick();				// Seconds since the last Tick() or Reset()
+	double GetTotalSeconds();	// Seconds since the last Reset(), as of the last Tick()
+
+private:
+	int64_t startTime;
+	int64_t previousTime;
+	int64_t currentTime;
+};
+
+// --------------------------------------------------------
+// Turns variable frame times into a whole number of fixed
+// simulation steps, carrying the remainder between frames
+//
+//  timestep.Advance(frameSeconds);
+//  while (timestep.Step())
+//      Simulate(timestep.GetStepSeconds(), timestep.GetSimulationTime());
+//  Render(timestep.GetAlpha());
+// --------------------------------------------------------
+class FixedTimestep
+{
+public:
+	FixedTimestep(double ticksPerSecond = 60.0, unsigned int maxStepsPerFrame = 8);
+
+	void SetTickRate(double ticksPerSecond);
+	void SetMaxStepsPerFrame(unsigned int maxSteps) { maxStepsPerFrame = maxSteps; }
+	void Reset();
+
+	// Adds one frame's worth of time, returns the number of steps now pending
+	unsigned int Advance(double frameSeconds);
+
+	// Consumes one pending step, returns false when there are none left
+	bool Step();
+
+	double GetTickRate() { return 1.0 / stepSeconds; }
+	double GetStepSeconds() { return stepSeconds; }
+	double GetSimulationTime() { return simulationTime; }	// Time of the latest simulated state
+	uint64_t GetStepCount() { return stepCount; }
+	uint64_t GetDroppedSteps() { return droppedSteps; }
+
+	// How far between the previous and latest simulated states
+	// the current frame falls, in [0, 1)
+	double GetAlpha() { return accumulator / stepSeconds; }
+
+	// Time to render at: between the last two simulated states
+	double GetInterpolatedTime();
+
+private:
+	double stepSeconds;
+	double accumulator;
+	double simulationTime;
+	unsigned int maxStepsPerFrame;
+	unsigned int pendingSteps;
+	uint64_t stepCount;
+	uint64_t droppedSteps;
+};
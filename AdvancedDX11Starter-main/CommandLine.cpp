@@ -0,0 +1,97 @@
+#include "CommandLine.h"
+
+#include <stdlib.h>
+
+CommandLine::CommandLine()
+{
+}
+
+CommandLine::CommandLine(const char* commandLine)
+{
+	Parse(commandLine);
+}
+
+// --------------------------------------------------------
+//  Breaks the command line into whitespace separated
+//  arguments.  Double quotes group an argument (and are
+//  removed from it).
+// --------------------------------------------------------
+void CommandLine::Parse(const char* commandLine)
+{
+	arguments.clear();
+	if (!commandLine)
+		return;
+
+	std::string current;
+	bool inQuotes = false;
+	bool hasArgument = false;
+	for (const char* c = commandLine; *c; c++)
+	{
+		if (*c == '"')
+		{
+			inQuotes = !inQuotes;
+			hasArgument = true;
+		}
+		else if ((*c == ' ' || *c == '\t') && !inQuotes)
+		{
+			if (hasArgument)
+				arguments.push_back(current);
+			current.clear();
+			hasArgument = false;
+		}
+		else
+		{
+			current.push_back(*c);
+			hasArgument = true;
+		}
+	}
+
+	if (hasArgument)
+		arguments.push_back(current);
+}
+
+int CommandLine::FindOption(const std::string& name)
+{
+	for (size_t i = 0; i < arguments.size(); i++)
+	{
+		if (arguments[i] == name)
+			return (int)i;
+	}
+	return -1;
+}
+
+bool CommandLine::HasOption(const std::string& name)
+{
+	return FindOption(name) >= 0;
+}
+
+// --------------------------------------------------------
+//  Gets the argument following an option, or the default
+//  if the option is missing or has nothing after it
+// --------------------------------------------------------
+std::string CommandLine::GetValue(const std::string& name, const std::string& defaultValue)
+{
+	int index = FindOption(name);
+	if (index < 0 || index + 1 >= (int)arguments.size())
+		return defaultValue;
+
+	return arguments[index + 1];
+}
+
+unsigned int CommandLine::GetUInt(const std::string& name, unsigned int defaultValue)
+{
+	std::string value = GetValue(name);
+	if (value.empty())
+		return defaultValue;
+
+	return (unsigned int)strtoul(value.c_str(), 0, 10);
+}
+
+float CommandLine::GetFloat(const std::string& name, float defaultValue)
+{
+	std::string value = GetValue(name);
+	if (value.empty())
+		return defaultValue;
+
+	return (float)atof(value.c_str());
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Splits the program's command line into arguments, with
+// support for quoted values containing spaces:
+//
+//  DX11Starter.exe -replay "C:\runs\fly through.inputs" -frametimes out.csv
+//
+//  CommandLine cmd(lpCmdLine);
+//  if (cmd.HasOption("-replay"))
+//      path = cmd.GetValue("-replay");
+// --------------------------------------------------------
+class CommandLine
+{
+public:
+	CommandLine();
+	CommandLine(const char* commandLine);
+
+	void Parse(const char* commandLine);
+
+	bool HasOption(const std::string& name);
+	std::string GetValue(const std::string& name, const std::string& defaultValue = "");
+	unsigned int GetUInt(const std::string& name, unsigned int defaultValue);
+	float GetFloat(const std::string& name, float defaultValue);
+
+	const std::vector<std::string>& GetArguments() { return arguments; }
+
+private:
+	std::vector<std::string> arguments;
+
+	int FindOption(const std::string& name);
+};
@@ -0,0 +1,65 @@
+#include "ConstantBufferData.h"
+
+#include <string.h>
+
+ConstantBufferData::ConstantBufferData(unsigned int size)
+{
+	Resize(size);
+}
+
+void ConstantBufferData::Resize(unsigned int size)
+{
+	bytes.assign(size, 0);
+	MarkAllDirty();
+}
+
+bool ConstantBufferData::Write(unsigned int byteOffset, const void* data, unsigned int size)
+{
+	// Checked without overflowing, whatever the offset
+	unsigned int bufferSize = GetSize();
+	if (size > bufferSize || byteOffset > bufferSize - size)
+		return false;
+
+	unsigned char* dest = bytes.data() + byteOffset;
+	if (size == 0 || memcmp(dest, data, size) == 0)
+		return true;
+
+	memcpy(dest, data, size);
+
+	unsigned int end = byteOffset + size;
+	if (dirtyStart >= dirtyEnd)
+	{
+		dirtyStart = byteOffset;
+		dirtyEnd = end;
+	}
+	else
+	{
+		if (byteOffset < dirtyStart) dirtyStart = byteOffset;
+		if (end > dirtyEnd) dirtyEnd = end;
+	}
+	return true;
+}
+
+bool ConstantBufferData::GetUploadRange(unsigned int* start, unsigned int* end)
+{
+	if (!IsDirty())
+		return false;
+
+	*start = dirtyStart & ~15u;
+	*end = (dirtyEnd + 15) & ~15u;
+	if (*end > GetSize())
+		*end = GetSize();
+	return true;
+}
+
+void ConstantBufferData::MarkAllDirty()
+{
+	dirtyStart = 0;
+	dirtyEnd = GetSize();
+}
+
+void ConstantBufferData::MarkClean()
+{
+	dirtyStart = 0;
+	dirtyEnd = 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// The CPU copy of one constant buffer, tracking which bytes
+// changed since they were last uploaded.  SimpleShader
+// keeps one per buffer and does the uploading; nothing
+// here needs a device, so it can be used (and timed)
+// anywhere.
+// --------------------------------------------------------
+class ConstantBufferData
+{
+public:
+	ConstantBufferData(unsigned int size = 0);
+
+	// Zeroes the data at the new size, all of it dirty
+	void Resize(unsigned int size);
+
+	// Copies bytes in, only marking them dirty if they
+	// actually changed, so setting the same values every
+	// draw doesn't cause uploads.  Returns false, copying
+	// nothing, if they don't fit in the buffer.
+	bool Write(unsigned int byteOffset, const void* data, unsigned int size);
+
+	// The bytes to upload: the dirty range rounded out to
+	// 16 byte boundaries, as partial constant buffer updates
+	// need.  Returns false if nothing has changed.
+	bool GetUploadRange(unsigned int* start, unsigned int* end);
+
+	bool IsDirty() { return dirtyStart < dirtyEnd; }
+	void MarkAllDirty();
+	void MarkClean();
+
+	const unsigned char* GetData() { return bytes.data(); }
+	unsigned int GetSize() { return (unsigned int)bytes.size(); }
+
+private:
+	std::vector<unsigned char> bytes;
+
+	// Bytes changed since the last upload, as [dirtyStart,
+	// dirtyEnd).  Empty when dirtyStart >= dirtyEnd.
+	unsigned int dirtyStart;
+	unsigned int dirtyEnd;
+};
@@ -0,0 +1,175 @@
+#include "ConstantRing.h"
+#include "Profiler.h"
+
+#include <string.h>
+
+// Shared by every ring, so slices from one ring can never
+// look current to another
+static uint64_t generationCounter = 0;
+
+// Constant buffer offsets must be multiples of 16 constants
+static const unsigned int SliceAlignment = 256;
+
+// Largest single constant buffer D3D allows
+static const unsigned int MinCapacity = D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16;
+
+ConstantRing::ConstantRing(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	unsigned int capacity)
+	:
+	device(device),
+	context(context),
+	allocator(0, SliceAlignment),
+	frameNumber(0),
+	oldestPendingFrame(0),
+	generation(0),
+	discardNextMap(true),
+	overflowed(false),
+	skippingFrame(false)
+{
+	stats = {};
+	lastFrameStats = {};
+
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+	for (unsigned int i = 0; i < MaxFramesInFlight; i++)
+		device->CreateQuery(&queryDesc, frameQueries[i].GetAddressOf());
+
+	CreateBuffer(capacity);
+	NextGeneration();
+}
+
+bool ConstantRing::IsSupported(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+		return false;
+
+	if (!options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+		return false;
+
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1;
+	return SUCCEEDED(context->QueryInterface(IID_PPV_ARGS(context1.GetAddressOf())));
+}
+
+// --------------------------------------------------------
+// (Re)creates the buffer itself.  The allocator starts
+// over, and the first map has to discard.
+// --------------------------------------------------------
+void ConstantRing::CreateBuffer(unsigned int capacity)
+{
+	if (capacity < MinCapacity) capacity = MinCapacity;
+	if (capacity > MaxCapacity) capacity = MaxCapacity;
+	capacity = (capacity + SliceAlignment - 1) & ~(SliceAlignment - 1);
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = capacity;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	buffer.Reset();
+	device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+
+	allocator.Reset(capacity);
+	discardNextMap = true;
+}
+
+void ConstantRing::NextGeneration()
+{
+	generation = ++generationCounter;
+}
+
+// --------------------------------------------------------
+// Appends data to the ring.  Space that's still in use by
+// the GPU is never mapped over; if there's none left, the
+// ring sits out the rest of the frame, leaving every slice
+// written so far as it is.
+// --------------------------------------------------------
+bool ConstantRing::Write(const void* data, unsigned int size, ConstantRingSlice* slice)
+{
+	if (!buffer || skippingFrame || overflowed)
+		return false;
+
+	size_t offset = allocator.Allocate(size);
+	if (offset == RingAllocator::InvalidOffset)
+	{
+		overflowed = true;
+		stats.Overflowed = true;
+		return false;
+	}
+
+	D3D11_MAP mapType = discardNextMap ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(buffer.Get(), 0, mapType, 0, &mapped)))
+		return false;
+
+	memcpy((unsigned char*)mapped.pData + offset, data, size);
+	context->Unmap(buffer.Get(), 0);
+	discardNextMap = false;
+
+	unsigned int alignedSize = (size + SliceAlignment - 1) & ~(SliceAlignment - 1);
+	slice->Buffer = buffer.Get();
+	slice->FirstConstant = (unsigned int)(offset / 16);
+	slice->NumConstants = alignedSize / 16;
+	slice->Generation = generation;
+
+	stats.Slices++;
+	stats.BytesWritten += alignedSize;
+	return true;
+}
+
+// --------------------------------------------------------
+// Frees the space of any frames the GPU has finished, and
+// grows the ring if the last frame didn't fit.  Never
+// waits on the GPU: if every fence is still pending, the
+// ring is skipped for this frame instead.
+// --------------------------------------------------------
+void ConstantRing::BeginFrame()
+{
+	PROFILE_ZONE("ConstantRing::BeginFrame");
+
+	while (oldestPendingFrame < frameNumber)
+	{
+		// Only flush when every query is in use, so the
+		// oldest one is sure to finish by the next frame
+		bool full = frameNumber - oldestPendingFrame == MaxFramesInFlight;
+		ID3D11Query* query = frameQueries[oldestPendingFrame % MaxFramesInFlight].Get();
+		if (context->GetData(query, 0, 0, full ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			break;
+
+		allocator.RetireFrame(oldestPendingFrame);
+		oldestPendingFrame++;
+	}
+
+	// No query left to fence this frame with
+	skippingFrame = frameNumber - oldestPendingFrame == MaxFramesInFlight;
+	stats.Skipped = skippingFrame;
+
+	if (overflowed)
+	{
+		CreateBuffer((unsigned int)allocator.GetCapacity() * 2);
+		overflowed = false;
+	}
+
+	NextGeneration();
+}
+
+void ConstantRing::EndFrame()
+{
+	// A skipped frame wrote nothing, so it needs no fence
+	if (!skippingFrame)
+	{
+		allocator.EndFrame(frameNumber);
+		context->End(frameQueries[frameNumber % MaxFramesInFlight].Get());
+		frameNumber++;
+	}
+	skippingFrame = false;
+
+	stats.Capacity = allocator.GetCapacity();
+	stats.FramesInFlight = (unsigned int)(frameNumber - oldestPendingFrame);
+	lastFrameStats = stats;
+	stats = {};
+}
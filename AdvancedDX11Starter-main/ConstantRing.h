@@ -0,0 +1,107 @@
+#pragma once
+
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <wrl/client.h>
+
+#include <cstdint>
+
+#include "RingAllocator.h"
+
+// Where one upload landed in the ring, in the units
+// *SetConstantBuffers1() takes (16 byte constants)
+struct ConstantRingSlice
+{
+	ID3D11Buffer* Buffer;
+	unsigned int FirstConstant;
+	unsigned int NumConstants;
+	uint64_t Generation;	// See ConstantRing::GetGeneration()
+};
+
+// Counts for one finished frame
+struct ConstantRingStats
+{
+	size_t BytesWritten;
+	unsigned int Slices;
+	bool Overflowed;			// Ran out, so shaders used their own buffers for the rest of the frame
+	bool Skipped;				// GPU was too far behind, so the ring sat out the frame
+	size_t Capacity;
+	unsigned int FramesInFlight;
+};
+
+// --------------------------------------------------------
+// One big dynamic constant buffer that per-draw constant
+// data is appended to, instead of every shader updating
+// its own buffers.  Each upload is Map(NO_OVERWRITE) into
+// a fresh 256 byte aligned slice, and draws bind their
+// slice by offset with *SetConstantBuffers1().
+//
+// Event queries act as fences, so space is only reused
+// once the GPU has finished the frame that used it.  If
+// a frame runs out anyway, Write() fails for the rest of
+// it, so shaders go back to their own buffers, and the
+// ring grows for the next frame.  It's never discarded
+// mid-frame, as slices written earlier may still be bound
+// for draws that haven't been issued yet.  If the GPU
+// still hasn't finished the oldest frame when every fence
+// is in use, the ring sits that frame out rather than wait
+// for it: Write() fails, and shaders use their own buffers.
+//
+// Needs D3D 11.1 (see IsSupported()).  SimpleShader uses
+// the ring once it's given one with
+// ISimpleShader::SetConstantRing().
+// --------------------------------------------------------
+class ConstantRing
+{
+public:
+	static const unsigned int DefaultCapacity = 4 * 1024 * 1024;
+
+	ConstantRing(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		unsigned int capacity = DefaultCapacity);
+
+	// Constant buffer offsets and NO_OVERWRITE maps on
+	// constant buffers are both optional 11.1 features
+	static bool IsSupported(ID3D11Device* device, ID3D11DeviceContext* context);
+
+	// Copies data into a new slice.  Returns false if the
+	// ring is sitting this frame (or the rest of it) out,
+	// or the data couldn't be mapped at all.
+	bool Write(const void* data, unsigned int size, ConstantRingSlice* slice);
+
+	// Call around each frame's rendering
+	void BeginFrame();
+	void EndFrame();
+
+	// Changes at the start of each frame, after which
+	// earlier slices may be reused.  Slices from an older
+	// generation need to be written again.
+	uint64_t GetGeneration() { return generation; }
+
+	ID3D11Buffer* GetBuffer() { return buffer.Get(); }
+	const ConstantRingStats& GetLastFrameStats() { return lastFrameStats; }
+
+private:
+	static const unsigned int MaxFramesInFlight = 3;
+	static const unsigned int MaxCapacity = 64 * 1024 * 1024;
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	Microsoft::WRL::ComPtr<ID3D11Query> frameQueries[MaxFramesInFlight];
+
+	RingAllocator allocator;
+	uint64_t frameNumber;
+	uint64_t oldestPendingFrame;
+	uint64_t generation;
+	bool discardNextMap;
+	bool overflowed;
+	bool skippingFrame;
+
+	ConstantRingStats stats;
+	ConstantRingStats lastFrameStats;
+
+	void CreateBuffer(unsigned int capacity);
+	void NextGeneration();
+};
@@ -0,0 +1,245 @@
+#include "Cubemap.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <math.h>
+
+static const float Gamma = 2.2f;
+
+void GetCubemapDirection(unsigned int face, float u, float v, float direction[3])
+{
+	float x = u * 2.0f - 1.0f;
+	float y = v * 2.0f - 1.0f;
+	switch (face)
+	{
+	default:
+	case 0: direction[0] = +1; direction[1] = -y; direction[2] = -x; break;
+	case 1: direction[0] = -1; direction[1] = -y; direction[2] = +x; break;
+	case 2: direction[0] = +x; direction[1] = +1; direction[2] = +y; break;
+	case 3: direction[0] = +x; direction[1] = -1; direction[2] = -y; break;
+	case 4: direction[0] = +x; direction[1] = -y; direction[2] = +1; break;
+	case 5: direction[0] = -x; direction[1] = -y; direction[2] = -1; break;
+	}
+}
+
+void GetCubemapFace(const float d[3], unsigned int& face, float& u, float& v)
+{
+	float ax = fabsf(d[0]), ay = fabsf(d[1]), az = fabsf(d[2]);
+	float major, s, t;
+	if (ax >= ay && ax >= az)
+	{
+		face = d[0] > 0 ? 0 : 1;
+		major = ax;
+		s = d[0] > 0 ? -d[2] : d[2];
+		t = -d[1];
+	}
+	else if (ay >= az)
+	{
+		face = d[1] > 0 ? 2 : 3;
+		major = ay;
+		s = d[0];
+		t = d[1] > 0 ? d[2] : -d[2];
+	}
+	else
+	{
+		face = d[2] > 0 ? 4 : 5;
+		major = az;
+		s = d[2] > 0 ? d[0] : -d[0];
+		t = -d[1];
+	}
+
+	u = (s / major + 1.0f) * 0.5f;
+	v = (t / major + 1.0f) * 0.5f;
+}
+
+void BuildCubemapViewTable(bool srgb, float table[256])
+{
+	for (int i = 0; i < 256; i++)
+	{
+		float value = i / 255.0f;
+		if (srgb)
+			value = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+		table[i] = value;
+	}
+}
+
+// --------------------------------------------------------
+// The four texels around a face's u, v and how far between
+// them it lies, clamped to the face
+// --------------------------------------------------------
+struct BilinearFootprint
+{
+	unsigned int X0, X1, Y0, Y1;
+	float FX, FY;
+};
+
+static BilinearFootprint GetFootprint(unsigned int size, float u, float v)
+{
+	float maxCoordinate = (float)(size - 1);
+	float x = (std::min)((std::max)(u * size - 0.5f, 0.0f), maxCoordinate);
+	float y = (std::min)((std::max)(v * size - 0.5f, 0.0f), maxCoordinate);
+
+	BilinearFootprint footprint;
+	footprint.X0 = (unsigned int)x;
+	footprint.Y0 = (unsigned int)y;
+	footprint.X1 = (std::min)(footprint.X0 + 1, size - 1);
+	footprint.Y1 = (std::min)(footprint.Y0 + 1, size - 1);
+	footprint.FX = x - footprint.X0;
+	footprint.FY = y - footprint.Y0;
+	return footprint;
+}
+
+void SampleCubemapPixels(const CubemapPixels& cube, const float table[256], const float direction[3], float rgb[3])
+{
+	unsigned int face;
+	float u, v;
+	GetCubemapFace(direction, face, u, v);
+	BilinearFootprint f = GetFootprint(cube.Size, u, v);
+
+	const unsigned char* row0 = cube.Faces[face] + f.Y0 * cube.RowPitch;
+	const unsigned char* row1 = cube.Faces[face] + f.Y1 * cube.RowPitch;
+	const int channels[3] = { cube.BGRA ? 2 : 0, 1, cube.BGRA ? 0 : 2 };
+	for (int c = 0; c < 3; c++)
+	{
+		int i = channels[c];
+		float top = table[row0[f.X0 * 4 + i]] + (table[row0[f.X1 * 4 + i]] - table[row0[f.X0 * 4 + i]]) * f.FX;
+		float bottom = table[row1[f.X0 * 4 + i]] + (table[row1[f.X1 * 4 + i]] - table[row1[f.X0 * 4 + i]]) * f.FX;
+		rgb[c] = top + (bottom - top) * f.FY;
+	}
+}
+
+bool DecodeCubemap(const CubemapPixels& cube, unsigned int maxSize, LinearCubemap& linear, unsigned int threadCount)
+{
+	linear.Mips.clear();
+	if (cube.Size == 0 || maxSize == 0)
+		return false;
+	for (const unsigned char* face : cube.Faces)
+	{
+		if (!face)
+			return false;
+	}
+
+	float table[256];
+	BuildCubemapViewTable(cube.SRGB, table);
+	for (float& value : table)
+		value = powf(value, Gamma);
+
+	unsigned int levelCount = 1;
+	for (unsigned int size = (std::min)(cube.Size, maxSize); size > 1; size /= 2)
+		levelCount++;
+	linear.Mips.resize(levelCount);
+	for (unsigned int mip = 0; mip < levelCount; mip++)
+	{
+		LinearCubemapLevel& level = linear.Mips[mip];
+		level.Size = (std::max)(1u, (std::min)(cube.Size, maxSize) >> mip);
+		for (std::vector<float>& face : level.Faces)
+			face.resize((size_t)level.Size * level.Size * 3);
+	}
+
+	// The top level: each texel averages the source texels it
+	// covers, a whole block when the sizes divide evenly
+	unsigned int size = linear.Mips[0].Size;
+	int red = cube.BGRA ? 2 : 0;
+	int blue = cube.BGRA ? 0 : 2;
+	ParallelFor(size * 6, threadCount, [&](unsigned int item)
+	{
+		unsigned int face = item / size;
+		unsigned int y = item % size;
+		unsigned int sy0 = (unsigned int)((size_t)y * cube.Size / size);
+		unsigned int sy1 = (unsigned int)((size_t)(y + 1) * cube.Size / size);
+		float* out = &linear.Mips[0].Faces[face][(size_t)y * size * 3];
+		for (unsigned int x = 0; x < size; x++, out += 3)
+		{
+			unsigned int sx0 = (unsigned int)((size_t)x * cube.Size / size);
+			unsigned int sx1 = (unsigned int)((size_t)(x + 1) * cube.Size / size);
+			float sum[3] = {};
+			for (unsigned int sy = sy0; sy < sy1; sy++)
+			{
+				const unsigned char* texel = cube.Faces[face] + sy * cube.RowPitch + sx0 * 4;
+				for (unsigned int sx = sx0; sx < sx1; sx++, texel += 4)
+				{
+					sum[0] += table[texel[red]];
+					sum[1] += table[texel[1]];
+					sum[2] += table[texel[blue]];
+				}
+			}
+
+			float scale = 1.0f / ((sy1 - sy0) * (sx1 - sx0));
+			out[0] = sum[0] * scale;
+			out[1] = sum[1] * scale;
+			out[2] = sum[2] * scale;
+		}
+	});
+
+	// Each mip averages 2x2 blocks of the one above
+	for (unsigned int mip = 1; mip < levelCount; mip++)
+	{
+		const LinearCubemapLevel& source = linear.Mips[mip - 1];
+		LinearCubemapLevel& level = linear.Mips[mip];
+		ParallelFor(level.Size * 6, threadCount, [&](unsigned int item)
+		{
+			unsigned int y = item % level.Size;
+			DownsampleCubemapRows(source, level, item / level.Size, y, y + 1);
+		});
+	}
+	return true;
+}
+
+void DownsampleCubemapRows(const LinearCubemapLevel& source, LinearCubemapLevel& level, unsigned int face, unsigned int firstRow, unsigned int endRow)
+{
+	for (unsigned int y = firstRow; y < endRow; y++)
+	{
+		const float* row0 = &source.Faces[face][(size_t)y * 2 * source.Size * 3];
+		const float* row1 = row0 + source.Size * 3;
+		float* out = &level.Faces[face][(size_t)y * level.Size * 3];
+		for (unsigned int x = 0; x < level.Size * 3; x++)
+		{
+			unsigned int i = (x / 3) * 6 + x % 3;
+			out[x] = (row0[i] + row0[i + 3] + row1[i] + row1[i + 3]) * 0.25f;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// A bilinear sample of a level at a face's u, v
+// --------------------------------------------------------
+static void SampleFace(const LinearCubemapLevel& level, unsigned int face, float u, float v, float rgb[3])
+{
+	BilinearFootprint f = GetFootprint(level.Size, u, v);
+	const float* row0 = &level.Faces[face][(size_t)f.Y0 * level.Size * 3];
+	const float* row1 = &level.Faces[face][(size_t)f.Y1 * level.Size * 3];
+	for (int c = 0; c < 3; c++)
+	{
+		float top = row0[f.X0 * 3 + c] + (row0[f.X1 * 3 + c] - row0[f.X0 * 3 + c]) * f.FX;
+		float bottom = row1[f.X0 * 3 + c] + (row1[f.X1 * 3 + c] - row1[f.X0 * 3 + c]) * f.FX;
+		rgb[c] = top + (bottom - top) * f.FY;
+	}
+}
+
+void SampleCubemapLevel(const LinearCubemapLevel& level, const float direction[3], float rgb[3])
+{
+	unsigned int face;
+	float u, v;
+	GetCubemapFace(direction, face, u, v);
+	SampleFace(level, face, u, v, rgb);
+}
+
+void SampleCubemapTrilinear(const LinearCubemap& cube, const float direction[3], float mip, float rgb[3])
+{
+	float maxMip = (float)(cube.Mips.size() - 1);
+	mip = (std::min)((std::max)(mip, 0.0f), maxMip);
+	unsigned int mip0 = (unsigned int)mip;
+	float blend = mip - mip0;
+
+	unsigned int face;
+	float u, v;
+	GetCubemapFace(direction, face, u, v);
+	SampleFace(cube.Mips[mip0], face, u, v, rgb);
+	if (blend > 0.0f)
+	{
+		float coarser[3];
+		SampleFace(cube.Mips[mip0 + 1], face, u, v, coarser);
+		for (int c = 0; c < 3; c++)
+			rgb[c] += (coarser[c] - rgb[c]) * blend;
+	}
+}
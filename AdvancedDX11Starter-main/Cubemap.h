@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// The pixels of a cube map's 6 faces, in D3D's order:
+// +X, -X, +Y, -Y, +Z, -Z.  Colors are gamma 2.2 encoded,
+// as the IBL shaders read them.
+// --------------------------------------------------------
+struct CubemapPixels
+{
+	const unsigned char* Faces[6] = {};
+	unsigned int Size = 0;		// Width and height of every face
+	size_t RowPitch = 0;		// Bytes from one row to the next
+	bool BGRA = false;			// Red and blue are swapped
+	bool SRGB = false;			// Sampled through an sRGB view, which decodes before the 2.2 gamma does
+};
+
+// --------------------------------------------------------
+// One mip of a cube map as linear RGB floats, rows tightly
+// packed
+// --------------------------------------------------------
+struct LinearCubemapLevel
+{
+	unsigned int Size = 0;
+	std::vector<float> Faces[6];
+};
+
+// --------------------------------------------------------
+// A linear cube map and its mips, down to 1x1
+// --------------------------------------------------------
+struct LinearCubemap
+{
+	std::vector<LinearCubemapLevel> Mips;
+};
+
+// The (unnormalized) direction through a face's u, v (0-1)
+void GetCubemapDirection(unsigned int face, float u, float v, float direction[3]);
+
+// The face a direction hits and where on it (0-1), picked
+// by the major axis as the hardware does
+void GetCubemapFace(const float direction[3], unsigned int& face, float& u, float& v);
+
+// What each byte value reads as through the cube's view,
+// before the shaders' 2.2 gamma
+void BuildCubemapViewTable(bool srgb, float table[256]);
+
+// A bilinear sample of the view's values (not yet linear),
+// clamped at face edges.  table is from BuildCubemapViewTable().
+void SampleCubemapPixels(const CubemapPixels& cube, const float table[256], const float direction[3], float rgb[3]);
+
+// Decodes to linear color, box filtering to at most maxSize
+// texels across, then fills in the mips by averaging 2x2
+// blocks.  Rows are spread across threads (0 for every
+// hardware thread).  False if the cube is empty.
+bool DecodeCubemap(const CubemapPixels& cube, unsigned int maxSize, LinearCubemap& linear, unsigned int threadCount = 0);
+
+// Fills rows firstRow to endRow of one face of a level by
+// averaging 2x2 blocks of the level above, as DecodeCubemap()
+// makes its mips.  The source must be twice the level's
+// size, and the level's faces already sized to fit.
+void DownsampleCubemapRows(const LinearCubemapLevel& source, LinearCubemapLevel& level, unsigned int face, unsigned int firstRow, unsigned int endRow);
+
+// Bilinear within a level, clamped at face edges
+void SampleCubemapLevel(const LinearCubemapLevel& level, const float direction[3], float rgb[3]);
+
+// Trilinear between the two levels around a fractional mip,
+// which is clamped to the ones that exist
+void SampleCubemapTrilinear(const LinearCubemap& cube, const float direction[3], float mip, float rgb[3]);
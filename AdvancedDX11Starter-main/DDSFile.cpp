@@ -0,0 +1,146 @@
+#include "DDSFile.h"
+
+#include <algorithm>
+#include <string.h>
+
+// From the DDS file format documentation
+static const uint32_t DDSMagic = 0x20534444;	// "DDS "
+static const uint32_t DDSFourCCDX10 = 0x30315844;	// "DX10"
+static const uint32_t DDSHeaderSize = 124;
+static const uint32_t DDSPixelFormatSize = 32;
+
+static const uint32_t DDSD_CAPS = 0x1;
+static const uint32_t DDSD_HEIGHT = 0x2;
+static const uint32_t DDSD_WIDTH = 0x4;
+static const uint32_t DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDSD_LINEARSIZE = 0x80000;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS_COMPLEX = 0x8;
+static const uint32_t DDSCAPS_TEXTURE = 0x1000;
+static const uint32_t DDSCAPS_MIPMAP = 0x400000;
+static const uint32_t D3D10ResourceDimensionTexture2D = 3;
+
+// The header, pixel format and DX10 extension as a flat
+// run of 32 bit values, after the magic number
+static const unsigned int DDSHeaderWords = 31 + 5;
+
+// Bytes per 4x4 block for block compressed DXGI formats,
+// or 0 for anything else
+static unsigned int GetBlockBytes(uint32_t dxgiFormat)
+{
+	switch (dxgiFormat)
+	{
+	case 70: case 71: case 72:		// BC1
+	case 79: case 80: case 81:		// BC4
+		return 8;
+	case 73: case 74: case 75:		// BC2
+	case 76: case 77: case 78:		// BC3
+	case 82: case 83: case 84:		// BC5
+	case 94: case 95: case 96:		// BC6H
+	case 97: case 98: case 99:		// BC7
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+static bool IsRGBA8(uint32_t dxgiFormat)
+{
+	return dxgiFormat >= 27 && dxgiFormat <= 32;	// R8G8B8A8 typeless through SINT
+}
+
+size_t DDSRowPitch(uint32_t dxgiFormat, unsigned int width)
+{
+	unsigned int blockBytes = GetBlockBytes(dxgiFormat);
+	if (blockBytes)
+		return (size_t)(std::max)(1u, (width + 3) / 4) * blockBytes;
+	if (IsRGBA8(dxgiFormat))
+		return (size_t)width * 4;
+	return 0;
+}
+
+size_t DDSMipSize(uint32_t dxgiFormat, unsigned int width, unsigned int height)
+{
+	size_t rows = GetBlockBytes(dxgiFormat) ? (std::max)(1u, (height + 3) / 4) : height;
+	return DDSRowPitch(dxgiFormat, width) * rows;
+}
+
+void SerializeDDS(const DDSImage& image, std::vector<unsigned char>& output)
+{
+	uint32_t header[DDSHeaderWords] = {};
+	header[0] = DDSHeaderSize;
+	header[1] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header[2] = image.Height;
+	header[3] = image.Width;
+	header[4] = image.Mips.empty() ? 0 : (uint32_t)image.Mips[0].size();
+	header[6] = (uint32_t)image.Mips.size();
+
+	// Reserved words that tools leave alone
+	header[7] = (uint32_t)image.SourceHash;
+	header[8] = (uint32_t)(image.SourceHash >> 32);
+
+	header[18] = DDSPixelFormatSize;
+	header[19] = DDPF_FOURCC;
+	header[20] = DDSFourCCDX10;
+	header[26] = DDSCAPS_TEXTURE | (image.Mips.size() > 1 ? DDSCAPS_MIPMAP | DDSCAPS_COMPLEX : 0);
+
+	// DX10 extension: format, dimension, misc flags, array size, misc flags 2
+	header[31] = image.DXGIFormat;
+	header[32] = D3D10ResourceDimensionTexture2D;
+	header[34] = 1;
+
+	size_t size = sizeof(DDSMagic) + sizeof(header);
+	for (const std::vector<unsigned char>& mip : image.Mips)
+		size += mip.size();
+
+	output.resize(size);
+	unsigned char* out = output.data();
+	memcpy(out, &DDSMagic, sizeof(DDSMagic));
+	memcpy(out + sizeof(DDSMagic), header, sizeof(header));
+	out += sizeof(DDSMagic) + sizeof(header);
+	for (const std::vector<unsigned char>& mip : image.Mips)
+	{
+		memcpy(out, mip.data(), mip.size());
+		out += mip.size();
+	}
+}
+
+bool ParseDDS(const unsigned char* data, size_t size, DDSImage& image)
+{
+	uint32_t magic;
+	uint32_t header[DDSHeaderWords];
+	if (size < sizeof(magic) + sizeof(header))
+		return false;
+
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(header, data + sizeof(magic), sizeof(header));
+	if (magic != DDSMagic || header[0] != DDSHeaderSize ||
+		!(header[19] & DDPF_FOURCC) || header[20] != DDSFourCCDX10 ||
+		header[32] != D3D10ResourceDimensionTexture2D || header[34] != 1)
+		return false;
+
+	image.DXGIFormat = header[31];
+	image.Height = header[2];
+	image.Width = header[3];
+	image.SourceHash = header[7] | ((uint64_t)header[8] << 32);
+	unsigned int mipCount = (std::max)(1u, header[6]);
+	if (image.Width == 0 || image.Height == 0 || DDSMipSize(image.DXGIFormat, 1, 1) == 0 || mipCount > 32)
+		return false;
+
+	image.Mips.clear();
+	size_t offset = sizeof(magic) + sizeof(header);
+	for (unsigned int mip = 0; mip < mipCount; mip++)
+	{
+		unsigned int width = (std::max)(1u, image.Width >> mip);
+		unsigned int height = (std::max)(1u, image.Height >> mip);
+		size_t mipSize = DDSMipSize(image.DXGIFormat, width, height);
+		if (offset + mipSize > size)
+			return false;
+
+		image.Mips.emplace_back(data + offset, data + offset + mipSize);
+		offset += mipSize;
+	}
+
+	return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// A 2D texture as stored in a .dds file.  Always written
+// with the DX10 header extension so any DXGI format can be
+// described; reading handles the same files back, for the
+// formats DDSMipSize() knows.
+// --------------------------------------------------------
+struct DDSImage
+{
+	uint32_t DXGIFormat = 0;
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	uint64_t SourceHash = 0;	// Whatever the file was built from, for caches (0 if none)
+	std::vector<std::vector<unsigned char>> Mips;	// Finest first
+};
+
+// Bytes in one mip of the given size, or 0 for formats
+// this doesn't handle (block compressed and RGBA8 only)
+size_t DDSMipSize(uint32_t dxgiFormat, unsigned int width, unsigned int height);
+
+// Bytes in one row of 4x4 blocks (or pixels, for RGBA8)
+size_t DDSRowPitch(uint32_t dxgiFormat, unsigned int width);
+
+void SerializeDDS(const DDSImage& image, std::vector<unsigned char>& output);
+
+// Fails for anything that isn't a single 2D texture with a
+// DX10 header, or whose data is shorter than it claims
+bool ParseDDS(const unsigned char* data, size_t size, DDSImage& image);
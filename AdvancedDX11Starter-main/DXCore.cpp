@@ -1,8 +1,14 @@
 #include "DXCore.h"
+#include "EngineBenchmarks.h"
+#include "FrameArena.h"
+#include "SimpleShader.h"
 #include "Input.h"
+#include "Profiler.h"
 #include "ImGui/imgui.h"
 #include <WindowsX.h>
 #include <sstream>
+#include <stdlib.h>
+#include <time.h>
 
 // Define the static instance variable so our OS-level 
 // message handling function below can talk to our object
@@ -53,15 +59,13 @@ DXCore::DXCore(
 	
 	this->fpsFrameCount = 0;
 	this->fpsTimeElapsed = 0.0f;
-	this->currentTime = 0;
 	this->deltaTime = 0;
-	this->startTime = 0;
 	this->totalTime = 0;
+	this->stepsThisFrame = 0;
 
-	// Query performance counter for accurate timing information
-	__int64 perfFreq = 0;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
-	perfCounterSeconds = 1.0 / (double)perfFreq;
+	// Create the profiler up front, so the main thread
+	// is always the profiler's first (index 0) thread
+	Profiler::GetThreadBuffer();
 }
 
 // --------------------------------------------------------
@@ -76,6 +80,8 @@ DXCore::~DXCore()
 
 	// Delete singletons
 	delete& Input::GetInstance();
+	delete& Profiler::GetInstance();
+	delete& FrameArena::GetInstance();
 }
 
 // --------------------------------------------------------
@@ -373,17 +379,42 @@ void DXCore::OnResize()
 // --------------------------------------------------------
 HRESULT DXCore::Run()
 {
-	// Grab the start time now that
-	// the game loop is running
-	__int64 now = 0;
-	QueryPerformanceCounter((LARGE_INTEGER*)&now);
-	startTime = now;
-	currentTime = now;
-	previousTime = now;
+	// Seed random.  Replays use the seed stored in the recording,
+	// so anything random (lights, particles) matches the original run.
+	unsigned int seed = commandLine.GetUInt("-seed", (unsigned int)time(0));
+	if (commandLine.HasOption("-replay"))
+	{
+		if (inputRecorder.StartPlayback(commandLine.GetValue("-replay")))
+			seed = inputRecorder.GetRandomSeed();
+		else
+			printf("Could not open input recording %s\n", commandLine.GetValue("-replay").c_str());
+	}
+	srand(seed);
 
 	// Give subclass a chance to initialize
 	Init();
 
+	// Benchmark mode: time the CPU hot paths, write the results and exit
+	if (commandLine.HasOption("-benchmark"))
+	{
+		bool written = RunEngineBenchmarks(
+			device,
+			context,
+			GetFullPathTo("../../Assets/"),
+			GetExePath_Wide() + L"\\",
+			commandLine.GetValue("-benchmark", "Benchmark.json"));
+		return written ? S_OK : E_FAIL;
+	}
+
+	StartRecordingOrPlayback(seed);
+	if (inputRecorder.IsRecording())
+		printf("Recording input (seed %u)\n", seed);
+
+	// Start the clocks once loading is done, so the first
+	// frame doesn't try to simulate the whole load time
+	clock.Reset();
+	timestep.Reset();
+
 	// Our overall game and message loop
 	MSG msg = {};
 	while (msg.message != WM_QUIT)
@@ -398,29 +429,119 @@ HRESULT DXCore::Run()
 		}
 		else
 		{
+			Profiler::GetInstance().BeginFrame();
+
 			// Update timer and title bar (if necessary)
 			UpdateTimer();
 			if (titleBarStats)
 				UpdateTitleBarStats();
 
-			// Update the input manager
-			Input::GetInstance().Update();
+			// Update the input manager (which may come from a recording)
+			float frameTime = deltaTime;
+			UpdateInput();
 
-			// The game loop
-			Update(deltaTime, totalTime);
-			Draw(deltaTime, totalTime);
+			// The game loop: per-frame work, then as many fixed simulation
+			// steps as the elapsed time pays for, then a render that
+			// interpolates between the last two simulated states
+			FrameUpdate(deltaTime, totalTime);
+
+			stepsThisFrame = timestep.Advance(deltaTime);
+			while (timestep.Step())
+				Update((float)timestep.GetStepSeconds(), (float)timestep.GetSimulationTime());
+
+			Draw(deltaTime, (float)timestep.GetInterpolatedTime());
+			frameTimeLog.AddFrame(frameTime * 1000.0f, stepsThisFrame);
 
 			// Frame is over, notify the input manager
 			Input::GetInstance().EndOfFrame();
+			FrameArena::GetInstance().EndFrame();
+			ISimpleShader::EndFrameUploadStats();
+
+			Profiler::GetInstance().EndFrame();
 		}
 	}
 
 	// We'll end up here once we get a WM_QUIT message,
 	// which usually comes from the user closing the window
+	inputRecorder.Stop();
+	frameTimeLog.Close();
 	return (HRESULT)msg.wParam;
 }
 
 
+// --------------------------------------------------------
+// Handles the -record, -tickrate and -frametimes options, and
+// matches the tick rate of a replay to its recording.  Called
+// after Init() so the game has set its own tick rate first.
+// --------------------------------------------------------
+void DXCore::StartRecordingOrPlayback(unsigned int seed)
+{
+	if (commandLine.HasOption("-tickrate"))
+		SetTickRate(commandLine.GetFloat("-tickrate", GetTickRate()));
+
+	if (inputRecorder.IsPlaying())
+	{
+		if (inputRecorder.GetTickRate() > 0)
+			SetTickRate(inputRecorder.GetTickRate());
+	}
+	else if (commandLine.HasOption("-record"))
+	{
+		std::string path = commandLine.GetValue("-record");
+		if (!inputRecorder.StartRecording(path, seed, GetTickRate()))
+			printf("Could not create input recording %s\n", path.c_str());
+	}
+
+	if (commandLine.HasOption("-frametimes"))
+	{
+		std::string path = commandLine.GetValue("-frametimes");
+		if (!frameTimeLog.Open(path))
+			printf("Could not create frame time log %s\n", path.c_str());
+	}
+}
+
+
+// --------------------------------------------------------
+// Updates the input manager for this frame.  During playback
+// the recorded frame replaces both the OS input and the frame
+// timing, so the simulation runs exactly as it did when
+// recorded.  When the recording runs out, we quit.
+// --------------------------------------------------------
+void DXCore::UpdateInput()
+{
+	Input& input = Input::GetInstance();
+
+	if (inputRecorder.IsPlaying())
+	{
+		InputFrame frame = {};
+		if (inputRecorder.ReadFrame(&frame))
+		{
+			input.UpdateFromFrame(frame);
+			deltaTime = frame.DeltaTime;
+			totalTime = frame.TotalTime;
+			return;
+		}
+
+		// Out of frames - done with the playback
+		printf("Playback finished after %u frames\n", inputRecorder.GetCurrentFrame());
+		inputRecorder.Stop();
+		frameTimeLog.Close();
+		Quit();
+		return;
+	}
+
+	input.Update();
+
+	if (inputRecorder.IsRecording())
+	{
+		InputFrame frame = {};
+		frame.DeltaTime = deltaTime;
+		frame.TotalTime = totalTime;
+		input.CaptureFrame(&frame);
+		inputRecorder.RecordFrame(frame);
+	}
+}
+
+
 // --------------------------------------------------------
 // Sends an OS-level window close message to our process, which
 // will be handled by our message processing function
@@ -437,21 +558,12 @@ void DXCore::Quit()
 // --------------------------------------------------------
 void DXCore::UpdateTimer()
 {
-	// Grab the current time
-	__int64 now = 0;
-	QueryPerformanceCounter((LARGE_INTEGER*)&now);
-	currentTime = now;
-
-	// Calculate delta time and clamp to zero
-	//  - Could go negative if CPU goes into power save mode 
-	//    or the process itself gets moved to another core
-	deltaTime = max((float)((currentTime - previousTime) * perfCounterSeconds), 0.0f);
+	// Sample the clock for this frame's delta time, which
+	// the clock already clamps to zero
+	deltaTime = (float)clock.Tick();
 
 	// Calculate the total time from start to now
-	totalTime = (float)((currentTime - startTime) * perfCounterSeconds);
-
-	// Save current time for next frame
-	previousTime = currentTime;
+	totalTime = (float)clock.GetTotalSeconds();
 }
 
 
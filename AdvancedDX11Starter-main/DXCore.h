@@ -4,6 +4,9 @@
 #include <d3d11.h>
 #include <string>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
+#include "Clock.h"
+#include "CommandLine.h"
+#include "InputRecorder.h"
 
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
@@ -37,10 +40,15 @@ public:
 	HRESULT InitDirectX();
 	HRESULT Run();
 	void Quit();
+	void SetCommandLine(const char* commandLine) { this->commandLine.Parse(commandLine); }
 	virtual void OnResize();
 
 	// Pure virtual methods for setup and game functionality
+	//  - FrameUpdate() runs once per rendered frame, with the real frame time
+	//  - Update() runs zero or more times per frame, always with the fixed step
+	//  - Draw() gets the real frame time and the interpolated simulation time
 	virtual void Init() = 0;
+	virtual void FrameUpdate(float deltaTime, float totalTime) {}
 	virtual void Update(float deltaTime, float totalTime) = 0;
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
@@ -54,6 +62,9 @@ protected:
 	unsigned int width;
 	unsigned int height;
 
+	// Options the program was launched with
+	CommandLine commandLine;
+
 	// Does our window currently have focus?
 	// Helpful if we want to pause while not the active window
 	bool hasFocus;
@@ -77,15 +88,34 @@ protected:
 	std::string GetFullPathTo(std::string relativeFilePath);
 	std::wstring GetFullPathTo_Wide(std::wstring relativeFilePath);
 
+	// Fixed simulation step control
+	void SetTickRate(float ticksPerSecond) { timestep.SetTickRate(ticksPerSecond); }
+	float GetTickRate() { return (float)timestep.GetTickRate(); }
+	unsigned int GetStepsThisFrame() { return stepsThisFrame; }
+
+	// How far the current frame is between the previous and
+	// latest simulation states, for interpolating in Draw()
+	float GetInterpolationAlpha() { return (float)timestep.GetAlpha(); }
+
+	// Time of the latest simulation state, for anything drawn
+	// straight from it rather than interpolated
+	float GetSimulationTime() { return (float)timestep.GetSimulationTime(); }
+
 
 private:
 	// Timing related data
-	double perfCounterSeconds;
+	Clock clock;
+	FixedTimestep timestep;
 	float totalTime;
 	float deltaTime;
-	__int64 startTime;
-	__int64 currentTime;
-	__int64 previousTime;
+	unsigned int stepsThisFrame;
+
+	// Input recording/playback and frame time logging,
+	// driven by the -record, -replay and -frametimes options
+	InputRecorder inputRecorder;
+	FrameTimeLog frameTimeLog;
+	void StartRecordingOrPlayback(unsigned int seed);
+	void UpdateInput();
 
 	// FPS calculation
 	int fpsFrameCount;
@@ -1,4 +1,5 @@
 #include "Emitter.h"
+#include "Profiler.h"
 using namespace DirectX;
 
 Emitter::Emitter(DirectX::XMFLOAT3 emitterPosition, std::shared_ptr<SimpleVertexShader> vs, std::shared_ptr<SimplePixelShader> ps, int maxParticles, int particlesPerSecond, float lifetime, float startSize, float endSize,
@@ -6,49 +7,51 @@ Emitter::Emitter(DirectX::XMFLOAT3 emitterPosition, std::shared_ptr<SimpleVertex
 	DirectX::XMFLOAT3 emitterAcceleration, DirectX::XMFLOAT2 rotationStart, DirectX::XMFLOAT2 rotationEnd,
 	Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> particleTexture, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context
 )
+	: simulation(maxParticles, particlesPerSecond, lifetime)
 {
 	//set variables
 	this->context = context;
-	this->emitterPosition = emitterPosition;
 	this->vs = vs;
 	this->ps = ps;
 	this->maxParticles = maxParticles;
-	this->particlesPerSecond = particlesPerSecond;
 	this->lifetime = lifetime;
 	this->startSize = startSize;
 	this->endSize = endSize;
 	this->startColor = startColor;
 	this->endColor = endColor;
-	this->startVelocity = startVelocity;
-	this->positionRandomRange = positionRandomRange;
-	this->velocityRandomRange = velocityRandomRange;
 	this->emitterAcceleration = emitterAcceleration;
 	this->particleTexture = particleTexture;
-	this->rotationEnd = rotationEnd;
-	this->rotationStart = rotationStart;
+	this->uploadPending = true;
 
-	this->secondsPerParticle = 1.0 / particlesPerSecond;
-	timeSinceEmit = 0;
-	numAliveParticles = 0;
-	firstAliveIndex = 0;
-	firstDeadIndex = 0;
-	particles = new Particle[maxParticles];
-	ZeroMemory(particles, sizeof(Particle) * maxParticles);
+	simulation.SetPosition(emitterPosition);
+	simulation.SetStartVelocity(startVelocity);
+	simulation.SetRandomRanges(positionRandomRange, velocityRandomRange);
+	simulation.SetRotationRanges(rotationStart, rotationEnd);
 
 	this->sampler = samplerState;
 
+	viewHandle = vs->GetVariableHandle("view");
+	projectionHandle = vs->GetVariableHandle("projection");
+	accelerationHandle = vs->GetVariableHandle("acceleration");
+	startColorHandle = vs->GetVariableHandle("startColor");
+	endColorHandle = vs->GetVariableHandle("endColor");
+	startSizeHandle = vs->GetVariableHandle("startSize");
+	endSizeHandle = vs->GetVariableHandle("endSize");
+	lifetimeHandle = vs->GetVariableHandle("lifetime");
+	currentTimeHandle = vs->GetVariableHandle("currentTime");
+	particleDataHandle = vs->GetShaderResourceViewHandle("ParticleData");
+	particleTextureHandle = ps->GetShaderResourceViewHandle("particleTexture");
+	samplerHandle = ps->GetSamplerHandle("sampleState");
+
 	createBuffers(device);
 
 }
 
 void Emitter::createBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
-	if (particles!=NULL) delete[] particles;
 	indexBuffer.Reset();
 	particleDataBuffer.Reset();
 	particleDataSRV.Reset();
-	particles = new Particle[maxParticles];
-	ZeroMemory(particles, sizeof(Particle) * maxParticles);
 
 	unsigned int* indices = new unsigned int[(unsigned int)maxParticles * 6];
 	int indexCount = 0;
@@ -98,111 +101,48 @@ void Emitter::createBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device)
 
 Emitter::~Emitter()
 {
-	//only thing we created on the heap
-	delete[] particles;
 }
 
 void Emitter::Update(float dt, float currentTime)
 {
-	//first check to see that there are alive particles
-	if (numAliveParticles > 0) {
-
-		//when we don't need to wrap around array
-		if (firstAliveIndex < firstDeadIndex) {
-			for (int i = firstAliveIndex; i < firstDeadIndex; i++) {
-				UpdateSingleParticle(currentTime, i);
-			}
-		}//when we do need to wrap around the array
-		else if (firstAliveIndex > firstDeadIndex) {
-			for (int i = firstAliveIndex; i < maxParticles; i++) {
-				UpdateSingleParticle(currentTime, i);
-			}
-			for (int i = 0; i < firstDeadIndex; i++) {
-				UpdateSingleParticle(currentTime, i);
-
-			}
-		}//when we need to update all particles
-		else {
-			for (int i = 0; i < maxParticles; i++) {
-				UpdateSingleParticle(currentTime, i);
-			}
-		}
-	}
-
-	//do this no matter what particles we need to update
-	timeSinceEmit += dt;
-
-	//spawn more particles if it's time
-	while (timeSinceEmit > secondsPerParticle) {
-		SpawnParticle(currentTime);
-		timeSinceEmit -= secondsPerParticle;
-	}
-
-	D3D11_MAPPED_SUBRESOURCE mapped = {};
-	context->Map(particleDataBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
-
-	if (firstAliveIndex < firstDeadIndex) {
-		memcpy(mapped.pData, particles + firstAliveIndex, sizeof(Particle) * numAliveParticles);
-	}
-	else {
-		memcpy(mapped.pData, particles, sizeof(Particle) * firstDeadIndex);
-		memcpy(
-			(void*)((Particle*)mapped.pData + firstDeadIndex),
-			particles + firstAliveIndex,
-			sizeof(Particle) * (maxParticles - firstAliveIndex));
+	PROFILE_ZONE("Emitter::Update");
 
-	}
-	context->Unmap(particleDataBuffer.Get(), 0);
+	// Update runs every fixed step, possibly several times
+	// a frame, so the upload waits for Draw()
+	Simulate(dt, currentTime);
 }
 
-void Emitter::UpdateSingleParticle(float currentTime, int index)
+void Emitter::Simulate(float dt, float currentTime)
 {
-	//calculate how long this particle has been alive
-	float timeAlive = currentTime - particles[index].spawnTime;
-
-	//check to see if it's time to die, kill it if it is
-	if (timeAlive >= lifetime) {
-		firstAliveIndex = (firstAliveIndex + 1) % maxParticles; //take mod so we can wrap around when at last index
-		numAliveParticles--;
-	}
+	simulation.Simulate(dt, currentTime);
+	uploadPending = true;
 }
 
-void Emitter::SpawnParticle(float currentTime)
+void Emitter::UploadParticles()
 {
-	//only spawn if we aren't at max particles
-	if (numAliveParticles < maxParticles) {
-		particles[firstDeadIndex].spawnTime = currentTime;
-
-		//get random position based around emitterPosition
-		DirectX::XMFLOAT3 tempPos = emitterPosition;
-		tempPos.x += (((float)rand() / RAND_MAX) * 2 - 1) * positionRandomRange.x;
-		tempPos.y += (((float)rand() / RAND_MAX) * 2 - 1) * positionRandomRange.y;
-		tempPos.z += (((float)rand() / RAND_MAX) * 2 - 1) * positionRandomRange.z;
-		particles[firstDeadIndex].startPos = tempPos;
-
-		DirectX::XMFLOAT3 tempVelocity = startVelocity;
-		tempVelocity.x += (rand()) / (float)(RAND_MAX / (velocityRandomRange.x * 2));
-		tempVelocity.y += (rand()) / (float)(RAND_MAX / (velocityRandomRange.y * 2));
-		tempVelocity.z += (rand()) / (float)(RAND_MAX / (velocityRandomRange.z * 2));
-		particles[firstDeadIndex].startVelocity = tempVelocity;
-
-		particles[firstDeadIndex].startRotation = ((float)(rand()) / (float)RAND_MAX) * (rotationStart.y - rotationStart.x) + rotationStart.x;
-		particles[firstDeadIndex].endRotation = ((float)(rand()) / (float)RAND_MAX) * (rotationEnd.y - rotationEnd.x) + rotationEnd.x;
-
+	PROFILE_ZONE("Particle Upload");
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(particleDataBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
 
-		//update parameters
-		firstDeadIndex = (firstDeadIndex + 1) % maxParticles; //take mod so we can wrap around when at last index
-		numAliveParticles++;
+	//copy the live particles to the front of the buffer, oldest first
+	ParticleRing::Span spans[2];
+	int spanCount = simulation.GetAliveSpans(spans);
+	const Particle* particles = simulation.GetParticles();
+	Particle* dest = (Particle*)mapped.pData;
+	for (int i = 0; i < spanCount; i++) {
+		memcpy(dest, particles + spans[i].First, sizeof(Particle) * spans[i].Count);
+		dest += spans[i].Count;
 	}
+	context->Unmap(particleDataBuffer.Get(), 0);
+	uploadPending = false;
 }
 
 void Emitter::Draw(std::shared_ptr<Camera> camera, float currentTime)
 {
-	//set up buffers for drawing
-	//D3D11_MAPPED_SUBRESOURCE mapped = {};
-	//context->Map(particleDataBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
-	//memcpy(mapped.pData, particles, sizeof(Particle) * maxParticles);
-	//context->Unmap(particleDataBuffer.Get(), 0);
+	//set up buffers for drawing, copying the particles over
+	//once per frame however many steps ran since the last
+	if (uploadPending)
+		UploadParticles();
 
 	UINT stride = 0;
 	UINT offset = 0;
@@ -214,25 +154,25 @@ void Emitter::Draw(std::shared_ptr<Camera> camera, float currentTime)
 	ps->SetShader();
 
 	//set info for vertex Shader 
-	vs->SetMatrix4x4("view", camera->GetView());
-	vs->SetMatrix4x4("projection", camera->GetProjection());
-	vs->SetFloat3("acceleration", emitterAcceleration);
-	vs->SetFloat4("startColor", startColor);
-	vs->SetFloat4("endColor", endColor);
-	vs->SetFloat("startSize", startSize);
-	vs->SetFloat("endSize", endSize);
-	vs->SetFloat("lifetime", lifetime);
-	vs->SetFloat("currentTime", currentTime);
+	vs->SetMatrix4x4(viewHandle, camera->GetView());
+	vs->SetMatrix4x4(projectionHandle, camera->GetProjection());
+	vs->SetFloat3(accelerationHandle, emitterAcceleration);
+	vs->SetFloat4(startColorHandle, startColor);
+	vs->SetFloat4(endColorHandle, endColor);
+	vs->SetFloat(startSizeHandle, startSize);
+	vs->SetFloat(endSizeHandle, endSize);
+	vs->SetFloat(lifetimeHandle, lifetime);
+	vs->SetFloat(currentTimeHandle, currentTime);
 	vs->CopyAllBufferData();
 
-	vs->SetShaderResourceView("ParticleData", particleDataSRV);
+	vs->SetShaderResourceView(particleDataHandle, particleDataSRV.Get());
 
 	//set info for pixel shader
-	ps->SetShaderResourceView("particleTexture", particleTexture.Get());
-	ps->SetSamplerState("sampleState", sampler.Get());
+	ps->SetShaderResourceView(particleTextureHandle, particleTexture.Get());
+	ps->SetSamplerState(samplerHandle, sampler.Get());
 	ps->SetShader();
 
-	context->DrawIndexed(numAliveParticles * 6, 0, 0);
+	context->DrawIndexed(simulation.GetAliveCount() * 6, 0, 0);
 
 	////check to see if we need to wrap
 	//if (firstAliveIndex < firstDeadIndex)
@@ -255,5 +195,5 @@ void Emitter::Draw(std::shared_ptr<Camera> camera, float currentTime)
 
 void Emitter::SetPosition(DirectX::XMFLOAT3 newPos)
 {
-	this->emitterPosition = newPos;
+	simulation.SetPosition(newPos);
 }
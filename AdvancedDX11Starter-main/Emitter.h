@@ -4,47 +4,27 @@
 #include <wrl/client.h>
 
 #include "Camera.h"
+#include "ParticleSimulation.h"
 #include "SimpleShader.h"
 #include <DirectXMath.h>
 #include <memory>
 
 
-struct Particle {
-	float spawnTime;
-	DirectX::XMFLOAT3 startPos;
-
-	DirectX::XMFLOAT3 startVelocity;
-	float startRotation;
-	float endRotation;
-	DirectX::XMFLOAT3 padding;
-
-};
-
 class Emitter
 {
 private:
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
-	Particle* particles;
 	int maxParticles;
-	int firstDeadIndex;
-	int firstAliveIndex;
-
-	int particlesPerSecond;
-	float secondsPerParticle;
-	float timeSinceEmit;
-
-	int numAliveParticles;
 	float lifetime;
 
-	DirectX::XMFLOAT3 emitterAcceleration;
-	DirectX::XMFLOAT3 emitterPosition;
-	DirectX::XMFLOAT3 startVelocity;
+	// Spawning and retiring, on the CPU
+	ParticleSimulation simulation;
 
-	DirectX::XMFLOAT3 positionRandomRange;
-	DirectX::XMFLOAT3 velocityRandomRange;
+	// Whether the simulation has stepped since the live
+	// particles were last copied to the GPU
+	bool uploadPending;
 
-	DirectX::XMFLOAT2 rotationStart;
-	DirectX::XMFLOAT2 rotationEnd;
+	DirectX::XMFLOAT3 emitterAcceleration;
 
 	DirectX::XMFLOAT4 startColor;
 	DirectX::XMFLOAT4 endColor;
@@ -60,9 +40,21 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> particleTexture;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
 
+	// Handles for what Draw() sets, resolved once
+	SimpleVariableHandle viewHandle;
+	SimpleVariableHandle projectionHandle;
+	SimpleVariableHandle accelerationHandle;
+	SimpleVariableHandle startColorHandle;
+	SimpleVariableHandle endColorHandle;
+	SimpleVariableHandle startSizeHandle;
+	SimpleVariableHandle endSizeHandle;
+	SimpleVariableHandle lifetimeHandle;
+	SimpleVariableHandle currentTimeHandle;
+	SimpleResourceHandle particleDataHandle;
+	SimpleResourceHandle particleTextureHandle;
+	SimpleResourceHandle samplerHandle;
+
 	// Update Methods
-	void UpdateSingleParticle(float currentTime, int index);
-	void SpawnParticle(float currentTime);
 	void createBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device);
 
 public:
@@ -93,5 +85,12 @@ public:
 	void Update(float dt, float currentTime);
 	void Draw(std::shared_ptr<Camera> camera, float currentTime);
 	void SetPosition(DirectX::XMFLOAT3 newPos);
+
+	// The CPU simulation (retiring and spawning particles),
+	// run by Update() every fixed step, and the copy to the
+	// GPU buffer, which Draw() does once per frame at most
+	void Simulate(float dt, float currentTime);
+	void UploadParticles();
+	int GetAliveCount() { return simulation.GetAliveCount(); }
 };
 
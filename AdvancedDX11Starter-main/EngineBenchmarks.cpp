@@ -0,0 +1,204 @@
+#include "EngineBenchmarks.h"
+#include "Benchmark.h"
+#include "ConstantRing.h"
+#include "Emitter.h"
+#include "Lights.h"
+#include "PortableBenchmarks.h"
+#include "SimpleShader.h"
+
+#include <stdio.h>
+
+using namespace DirectX;
+
+static void BenchmarkEmitters(
+	Benchmark& benchmark,
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	const float dt = 1.0f / 60.0f;
+	const int counts[] = { 1000, 10000, 100000 };
+	for (int count : counts)
+	{
+		// One second lifetime at "count" per second, so the
+		// emitter runs full once it reaches a steady state
+		Emitter emitter(
+			XMFLOAT3(0, 0, 0), 0, 0,
+			count, count, 1.0f,
+			0.1f, 1.0f,
+			XMFLOAT4(1, 1, 1, 1), XMFLOAT4(1, 1, 1, 0),
+			XMFLOAT3(0, 1, 0), XMFLOAT3(1, 1, 1), XMFLOAT3(1, 1, 1), XMFLOAT3(0, -1, 0),
+			XMFLOAT2(0, 1), XMFLOAT2(0, 1),
+			device, 0, 0, context);
+
+		float time = 0.0f;
+		for (int i = 0; i < 90; i++, time += dt)
+			emitter.Simulate(dt, time);
+
+		benchmark.Run("Emitter::UploadParticles", std::to_string(count), emitter.GetAliveCount(),
+			[&]() { emitter.UploadParticles(); });
+	}
+}
+
+static void BenchmarkShaders(
+	Benchmark& benchmark,
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const std::wstring& shaderFolder)
+{
+	SimpleVertexShader vs(device.Get(), context.Get(), (shaderFolder + L"VertexShader.cso").c_str());
+	SimplePixelShader ps(device.Get(), context.Get(), (shaderFolder + L"PixelShaderPBR.cso").c_str());
+	if (!vs.IsShaderValid() || !ps.IsShaderValid())
+	{
+		printf("Skipping shader benchmarks - could not load shaders\n");
+		return;
+	}
+
+	Light lights[MAX_LIGHTS] = {};
+	XMFLOAT4X4 matrix;
+	XMStoreFloat4x4(&matrix, XMMatrixIdentity());
+
+	// Per-entity work, the same as Material::PrepareMaterial()
+	// plus the per-frame light data
+	auto setEntity = [&]()
+	{
+		vs.SetMatrix4x4("world", matrix);
+		vs.SetMatrix4x4("worldInverseTranspose", matrix);
+		vs.SetMatrix4x4("view", matrix);
+		vs.SetMatrix4x4("projection", matrix);
+		ps.SetFloat3("colorTint", XMFLOAT3(1, 1, 1));
+		ps.SetFloat3("cameraPosition", XMFLOAT3(0, 0, -5));
+		ps.SetFloat2("uvScale", XMFLOAT2(1, 1));
+		ps.SetFloat2("uvOffset", XMFLOAT2(0, 0));
+	};
+
+	// The same work through pre-resolved handles
+	SimpleVariableHandle world = vs.GetVariableHandle("world");
+	SimpleVariableHandle worldInverseTranspose = vs.GetVariableHandle("worldInverseTranspose");
+	SimpleVariableHandle view = vs.GetVariableHandle("view");
+	SimpleVariableHandle projection = vs.GetVariableHandle("projection");
+	SimpleVariableHandle colorTint = ps.GetVariableHandle("colorTint");
+	SimpleVariableHandle cameraPosition = ps.GetVariableHandle("cameraPosition");
+	SimpleVariableHandle uvScale = ps.GetVariableHandle("uvScale");
+	SimpleVariableHandle uvOffset = ps.GetVariableHandle("uvOffset");
+	SimpleVariableHandle lightData = ps.GetVariableHandle("lights");
+	SimpleVariableHandle lightCount = ps.GetVariableHandle("lightCount");
+	auto setEntityHandles = [&]()
+	{
+		vs.SetMatrix4x4(world, matrix);
+		vs.SetMatrix4x4(worldInverseTranspose, matrix);
+		vs.SetMatrix4x4(view, matrix);
+		vs.SetMatrix4x4(projection, matrix);
+		ps.SetFloat3(colorTint, XMFLOAT3(1, 1, 1));
+		ps.SetFloat3(cameraPosition, XMFLOAT3(0, 0, -5));
+		ps.SetFloat2(uvScale, XMFLOAT2(1, 1));
+		ps.SetFloat2(uvOffset, XMFLOAT2(0, 0));
+	};
+
+	const int entityCounts[] = { 1, 100, 1000 };
+	for (int count : entityCounts)
+	{
+		benchmark.Run("SimpleShader Set", std::to_string(count), count,
+			[&]()
+			{
+				ps.SetData("lights", lights, sizeof(lights));
+				ps.SetInt("lightCount", MAX_LIGHTS);
+				for (int i = 0; i < count; i++)
+					setEntity();
+			});
+
+		benchmark.Run("SimpleShader Set (handles)", std::to_string(count), count,
+			[&]()
+			{
+				ps.SetData(lightData, lights, sizeof(lights));
+				ps.SetInt(lightCount, MAX_LIGHTS);
+				for (int i = 0; i < count; i++)
+					setEntityHandles();
+			});
+
+		benchmark.Run("SimpleShader Set+Copy", std::to_string(count), count,
+			[&]()
+			{
+				ps.SetData("lights", lights, sizeof(lights));
+				ps.SetInt("lightCount", MAX_LIGHTS);
+				for (int i = 0; i < count; i++)
+				{
+					setEntity();
+					vs.CopyAllBufferData();
+					ps.CopyAllBufferData();
+				}
+			});
+	}
+
+	// Different world matrices per draw, so every draw has
+	// to upload, with and without the constant ring
+	auto drawEntities = [&](int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			matrix._41 = (float)i;
+			setEntityHandles();
+			vs.SetShader();
+			ps.SetShader();
+			vs.CopyAllBufferData();
+			ps.CopyAllBufferData();
+		}
+	};
+
+	for (int count : entityCounts)
+	{
+		benchmark.Run("SimpleShader per-draw upload", std::to_string(count), count,
+			[&]() { drawEntities(count); });
+	}
+
+	if (!ConstantRing::IsSupported(device.Get(), context.Get()))
+	{
+		printf("Skipping constant ring benchmarks - needs D3D 11.1\n");
+		return;
+	}
+
+	ConstantRing ring(device, context);
+	ConstantRing* previousRing = ISimpleShader::GetConstantRing();
+	ISimpleShader::SetConstantRing(&ring);
+	for (int count : entityCounts)
+	{
+		benchmark.Run("SimpleShader per-draw upload (ring)", std::to_string(count), count,
+			[&]()
+			{
+				ring.BeginFrame();
+				drawEntities(count);
+				ring.EndFrame();
+			});
+	}
+	ISimpleShader::SetConstantRing(previousRing);
+}
+
+// --------------------------------------------------------
+//  Runs every engine benchmark, those needing D3D and then
+//  the portable ones, and writes the results
+//
+//  assetFolder  - Path to the Assets folder (ending in a slash)
+//  shaderFolder - Path to the compiled shaders (ending in a slash)
+//  outputPath   - Where to write the JSON results
+// --------------------------------------------------------
+bool RunEngineBenchmarks(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const std::string& assetFolder,
+	const std::wstring& shaderFolder,
+	const std::string& outputPath)
+{
+	Benchmark benchmark;
+
+	BenchmarkEmitters(benchmark, device, context);
+	BenchmarkShaders(benchmark, device, context, shaderFolder);
+	RunPortableBenchmarks(benchmark, assetFolder);
+
+	if (!benchmark.WriteJSON(outputPath))
+	{
+		printf("Could not write benchmark results to %s\n", outputPath.c_str());
+		return false;
+	}
+
+	printf("Benchmark results written to %s\n", outputPath.c_str());
+	return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include <string>
+
+// Runs every engine benchmark (see Benchmark.h), including
+// the ones that need a D3D device, and writes the results
+bool RunEngineBenchmarks(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const std::string& assetFolder,
+	const std::wstring& shaderFolder,
+	const std::string& outputPath);
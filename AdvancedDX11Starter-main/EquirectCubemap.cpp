@@ -0,0 +1,430 @@
+#include "EquirectCubemap.h"
+#include "Cubemap.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <math.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define EQUIRECT_CUBEMAP_SSE2 1
+#include <emmintrin.h>
+#else
+#define EQUIRECT_CUBEMAP_SSE2 0
+#endif
+
+// Rows of the top mip each work item resamples.  Its mips
+// are made from it before moving on, down to the one where
+// the band is a single row; smaller mips are made per face
+// at the end.
+static const unsigned int BandRows = 32;
+
+static const float Gamma = 2.2f;
+static const float Pi = 3.14159265f;
+
+// Halves can't hold anything larger, and anything smaller
+// than their smallest normal is stored as zero
+static const float MaxHalf = 65504.0f;
+static const float MinHalf = 6.10351562e-05f;
+
+unsigned int HalfCubemap::GetMipSize(unsigned int mip) const
+{
+	return (std::max)(1u, Size >> mip);
+}
+
+size_t HalfCubemap::GetRowPitch(unsigned int mip) const
+{
+	return (size_t)GetMipSize(mip) * 4 * sizeof(uint16_t);
+}
+
+size_t HalfCubemap::GetSubresourceOffset(unsigned int face, unsigned int mip) const
+{
+	size_t faceTexels = 0, mipOffset = 0;
+	for (unsigned int m = 0; m < MipLevels; m++)
+	{
+		if (m == mip)
+			mipOffset = faceTexels;
+		faceTexels += (size_t)GetMipSize(m) * GetMipSize(m);
+	}
+	return (face * faceTexels + mipOffset) * 4;
+}
+
+const uint16_t* HalfCubemap::GetSubresource(unsigned int face, unsigned int mip) const
+{
+	return Texels.data() + GetSubresourceOffset(face, mip);
+}
+
+unsigned int GetEquirectCubeSize(unsigned int equirectWidth)
+{
+	unsigned int size = 1;
+	while (size * 2 <= equirectWidth / 4)
+		size *= 2;
+	return size;
+}
+
+// --------------------------------------------------------
+// The 4 pixels around a point in the image, as indices:
+// wrapped around horizontally, clamped at the poles
+// --------------------------------------------------------
+static void GetTaps(const HDRImage& image, int x0, int y0, size_t taps[4])
+{
+	int width = (int)image.Width;
+	int height = (int)image.Height;
+	int x1 = x0 + 1;
+	x0 = x0 < 0 ? x0 + width : x0 >= width ? x0 - width : x0;
+	x1 = x1 >= width ? x1 - width : x1;
+	int y1 = (std::min)(y0 + 1, height - 1);
+	y0 = (std::max)(y0, 0);
+	taps[0] = (size_t)y0 * width + x0;
+	taps[1] = (size_t)y0 * width + x1;
+	taps[2] = (size_t)y1 * width + x0;
+	taps[3] = (size_t)y1 * width + x1;
+}
+
+void SampleEquirect(const HDRImage& equirect, const float d[3], float rgb[3])
+{
+	float u = 0.5f + atan2f(d[0], d[2]) / (2 * Pi);
+	float v = atan2f(sqrtf(d[0] * d[0] + d[2] * d[2]), d[1]) / Pi;
+	float x = u * equirect.Width - 0.5f;
+	float y = v * equirect.Height - 0.5f;
+	float x0 = floorf(x), y0 = floorf(y);
+	float fx = x - x0, fy = y - y0;
+
+	size_t taps[4];
+	GetTaps(equirect, (int)x0, (int)y0, taps);
+	float colors[4][3];
+	for (int i = 0; i < 4; i++)
+		DecodeRGBE(&equirect.RGBE[taps[i] * 4], colors[i]);
+	for (int c = 0; c < 3; c++)
+	{
+		float top = colors[0][c] + (colors[1][c] - colors[0][c]) * fx;
+		float bottom = colors[2][c] + (colors[3][c] - colors[2][c]) * fx;
+		rgb[c] = top + (bottom - top) * fy;
+	}
+}
+
+// A linear value as a gamma encoded half, rounded to nearest
+static uint16_t EncodeHalf(float value)
+{
+	value = value > 0 ? powf(value, 1.0f / Gamma) : 0.0f;
+	if (value < MinHalf)
+		return 0;
+	value = (std::min)(value, MaxHalf);
+
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bits += 0xFFF + ((bits >> 13) & 1);
+	return (uint16_t)((bits >> 13) - (112 << 10));
+}
+
+float DecodeHalf(uint16_t half)
+{
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+	float value;
+	if (exponent == 0)
+		value = ldexpf((float)mantissa, -24);
+	else if (exponent == 31)
+		value = mantissa ? NAN : INFINITY;
+	else
+		value = ldexpf((float)(mantissa | 0x400), (int)exponent - 25);
+	return (half & 0x8000) ? -value : value;
+}
+
+#if EQUIRECT_CUBEMAP_SSE2
+static __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static __m128 Floor(__m128 value)
+{
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(value));
+	return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, value), _mm_set1_ps(1.0f)));
+}
+
+// --------------------------------------------------------
+// atan2(y, x), to within 2e-6 radians: a polynomial for
+// atan on 0 to 1, then the octant from the signs and which
+// of x and y is larger
+// --------------------------------------------------------
+static __m128 Atan2(__m128 y, __m128 x)
+{
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+	__m128 ax = _mm_andnot_ps(signMask, x);
+	__m128 ay = _mm_andnot_ps(signMask, y);
+	__m128 t = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(1e-30f)));
+	__m128 s = _mm_mul_ps(t, t);
+
+	__m128 p = _mm_set1_ps(-0.0117704999f);
+	p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(0.0528234877f));
+	p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(-0.116651118f));
+	p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(0.193670318f));
+	p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(-0.332655489f));
+	p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(0.999979854f));
+	__m128 angle = _mm_mul_ps(p, t);
+
+	angle = Select(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(Pi * 0.5f), angle), angle);
+	angle = Select(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(Pi), angle), angle);
+	return _mm_or_ps(angle, _mm_and_ps(signMask, y));
+}
+
+// --------------------------------------------------------
+// 4 RGBE pixels as linear red, green and blue.  The shared
+// exponent becomes the float 2^(e - 136) by building its
+// bits directly; exponents too small for a normal float
+// (and 0, which means black) give 0.
+// --------------------------------------------------------
+static void DecodeRGBE4(__m128i rgbe, __m128& r, __m128& g, __m128& b)
+{
+	const __m128i byteMask = _mm_set1_epi32(0xFF);
+	__m128i exponent = _mm_srli_epi32(rgbe, 24);
+	__m128i scaleBits = _mm_slli_epi32(_mm_sub_epi32(exponent, _mm_set1_epi32(9)), 23);
+	scaleBits = _mm_and_si128(scaleBits, _mm_cmpgt_epi32(exponent, _mm_set1_epi32(9)));
+	__m128 scale = _mm_castsi128_ps(scaleBits);
+
+	r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(rgbe, byteMask)), scale);
+	g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(rgbe, 8), byteMask)), scale);
+	b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(rgbe, 16), byteMask)), scale);
+}
+
+// --------------------------------------------------------
+// 4 linear values as gamma encoded halves (in the low 16
+// bits of each lane).  x^(1 / 2.2) is 2^(log2(x) / 2.2),
+// with polynomials for log2 of the mantissa and 2^ of the
+// fraction, well within a half's precision.
+// --------------------------------------------------------
+static __m128i EncodeHalf4(__m128 linear)
+{
+	__m128i bits = _mm_castps_si128(linear);
+	__m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+	__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x7FFFFF)), _mm_set1_epi32(0x3F800000)));
+	m = _mm_sub_ps(m, _mm_set1_ps(1.0f));
+
+	__m128 log2 = _mm_set1_ps(0.0439286269f);
+	log2 = _mm_add_ps(_mm_mul_ps(log2, m), _mm_set1_ps(-0.189832449f));
+	log2 = _mm_add_ps(_mm_mul_ps(log2, m), _mm_set1_ps(0.411561489f));
+	log2 = _mm_add_ps(_mm_mul_ps(log2, m), _mm_set1_ps(-0.707253456f));
+	log2 = _mm_add_ps(_mm_mul_ps(log2, m), _mm_set1_ps(1.4415921f));
+	log2 = _mm_add_ps(_mm_mul_ps(log2, m), _mm_set1_ps(1.43909301e-05f));
+	__m128 y = _mm_mul_ps(_mm_add_ps(exponent, log2), _mm_set1_ps(1.0f / Gamma));
+
+	__m128 whole = Floor(y);
+	__m128 f = _mm_sub_ps(y, whole);
+	__m128 exp2 = _mm_set1_ps(0.0135206031f);
+	exp2 = _mm_add_ps(_mm_mul_ps(exp2, f), _mm_set1_ps(0.0520374291f));
+	exp2 = _mm_add_ps(_mm_mul_ps(exp2, f), _mm_set1_ps(0.241427496f));
+	exp2 = _mm_add_ps(_mm_mul_ps(exp2, f), _mm_set1_ps(0.693006635f));
+	exp2 = _mm_add_ps(_mm_mul_ps(exp2, f), _mm_set1_ps(1.0000025f));
+	__m128i encodedBits = _mm_add_epi32(_mm_castps_si128(exp2), _mm_slli_epi32(_mm_cvttps_epi32(whole), 23));
+	__m128 encoded = _mm_min_ps(_mm_castsi128_ps(encodedBits), _mm_set1_ps(MaxHalf));
+
+	// Zero, negative and denormal input has no log, and
+	// what's too small for a half is flushed to zero
+	__m128 valid = _mm_and_ps(
+		_mm_cmpge_ps(linear, _mm_set1_ps(1.17549435e-38f)),
+		_mm_cmpge_ps(encoded, _mm_set1_ps(MinHalf)));
+
+	encodedBits = _mm_castps_si128(encoded);
+	encodedBits = _mm_add_epi32(encodedBits, _mm_add_epi32(_mm_set1_epi32(0xFFF), _mm_and_si128(_mm_srli_epi32(encodedBits, 13), _mm_set1_epi32(1))));
+	__m128i half = _mm_sub_epi32(_mm_srli_epi32(encodedBits, 13), _mm_set1_epi32(112 << 10));
+	return _mm_and_si128(half, _mm_castps_si128(valid));
+}
+#endif
+
+// --------------------------------------------------------
+// Resamples one row of a face into linear RGBA floats
+// --------------------------------------------------------
+static void ResampleRow(const HDRImage& image, unsigned int face, unsigned int y, unsigned int size, float* out)
+{
+	// Directions along a row are a line, so each texel's is
+	// the first one's plus a step per texel.  They needn't be
+	// normalized for atan2.
+	float first[3], second[3], step[3];
+	GetCubemapDirection(face, 0.5f / size, (y + 0.5f) / size, first);
+	GetCubemapDirection(face, 1.5f / size, (y + 0.5f) / size, second);
+	for (int i = 0; i < 3; i++)
+		step[i] = second[i] - first[i];
+
+	unsigned int x = 0;
+#if EQUIRECT_CUBEMAP_SSE2
+	const unsigned char* pixels = image.RGBE.data();
+	const __m128 width = _mm_set1_ps((float)image.Width);
+	const __m128 height = _mm_set1_ps((float)image.Height);
+	const __m128 half = _mm_set1_ps(0.5f);
+	for (; x + 4 <= size; x += 4)
+	{
+		__m128 xs = _mm_add_ps(_mm_set1_ps((float)x), _mm_set_ps(3, 2, 1, 0));
+		__m128 dx = _mm_add_ps(_mm_set1_ps(first[0]), _mm_mul_ps(xs, _mm_set1_ps(step[0])));
+		__m128 dy = _mm_add_ps(_mm_set1_ps(first[1]), _mm_mul_ps(xs, _mm_set1_ps(step[1])));
+		__m128 dz = _mm_add_ps(_mm_set1_ps(first[2]), _mm_mul_ps(xs, _mm_set1_ps(step[2])));
+
+		__m128 u = _mm_add_ps(half, _mm_mul_ps(Atan2(dx, dz), _mm_set1_ps(0.5f / Pi)));
+		__m128 horizontal = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)));
+		__m128 v = _mm_mul_ps(Atan2(horizontal, dy), _mm_set1_ps(1.0f / Pi));
+
+		__m128 px = _mm_sub_ps(_mm_mul_ps(u, width), half);
+		__m128 py = _mm_sub_ps(_mm_mul_ps(v, height), half);
+		__m128 x0 = Floor(px), y0 = Floor(py);
+		__m128 fx = _mm_sub_ps(px, x0), fy = _mm_sub_ps(py, y0);
+
+		// No gathers in SSE2, so the taps are fetched per lane
+		int x0s[4], y0s[4];
+		_mm_storeu_si128((__m128i*)x0s, _mm_cvttps_epi32(x0));
+		_mm_storeu_si128((__m128i*)y0s, _mm_cvttps_epi32(y0));
+		uint32_t tapPixels[4][4];
+		for (int lane = 0; lane < 4; lane++)
+		{
+			size_t taps[4];
+			GetTaps(image, x0s[lane], y0s[lane], taps);
+			for (int tap = 0; tap < 4; tap++)
+				memcpy(&tapPixels[tap][lane], pixels + taps[tap] * 4, 4);
+		}
+
+		__m128 r[4], g[4], b[4];
+		for (int tap = 0; tap < 4; tap++)
+			DecodeRGBE4(_mm_loadu_si128((const __m128i*)tapPixels[tap]), r[tap], g[tap], b[tap]);
+
+		auto bilinear = [&](const __m128 c[4])
+		{
+			__m128 top = _mm_add_ps(c[0], _mm_mul_ps(_mm_sub_ps(c[1], c[0]), fx));
+			__m128 bottom = _mm_add_ps(c[2], _mm_mul_ps(_mm_sub_ps(c[3], c[2]), fx));
+			return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fy));
+		};
+		__m128 red = bilinear(r);
+		__m128 green = bilinear(g);
+		__m128 blue = bilinear(b);
+		__m128 alpha = _mm_set1_ps(1.0f);
+		_MM_TRANSPOSE4_PS(red, green, blue, alpha);
+		_mm_storeu_ps(out + x * 4 + 0, red);
+		_mm_storeu_ps(out + x * 4 + 4, green);
+		_mm_storeu_ps(out + x * 4 + 8, blue);
+		_mm_storeu_ps(out + x * 4 + 12, alpha);
+	}
+#endif
+
+	for (; x < size; x++)
+	{
+		float direction[3];
+		for (int i = 0; i < 3; i++)
+			direction[i] = first[i] + step[i] * x;
+		SampleEquirect(image, direction, out + x * 4);
+		out[x * 4 + 3] = 1.0f;
+	}
+}
+
+// --------------------------------------------------------
+// Averages 2x2 blocks of linear RGBA rows into the next mip
+// --------------------------------------------------------
+static void DownsampleRows(const float* source, unsigned int sourceSize, unsigned int rows, float* out)
+{
+	unsigned int size = sourceSize / 2;
+	for (unsigned int y = 0; y < rows; y++)
+	{
+		const float* row0 = source + (size_t)y * 2 * sourceSize * 4;
+		const float* row1 = row0 + sourceSize * 4;
+		float* outRow = out + (size_t)y * size * 4;
+		for (unsigned int x = 0; x < size * 4; x++)
+		{
+			unsigned int i = (x / 4) * 8 + x % 4;
+			outRow[x] = (row0[i] + row0[i + 4] + row1[i] + row1[i + 4]) * 0.25f;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Linear RGBA floats to gamma encoded halves
+// --------------------------------------------------------
+static void EncodeHalves(const float* linear, size_t count, uint16_t* out)
+{
+	size_t i = 0;
+#if EQUIRECT_CUBEMAP_SSE2
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i low = EncodeHalf4(_mm_loadu_ps(linear + i));
+		__m128i high = EncodeHalf4(_mm_loadu_ps(linear + i + 4));
+		_mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(low, high));
+	}
+#endif
+
+	for (; i < count; i++)
+		out[i] = EncodeHalf(linear[i]);
+}
+
+bool ConvertEquirectToCubemap(const HDRImage& equirect, unsigned int size, unsigned int mipLevels, HalfCubemap& cube, unsigned int threadCount)
+{
+	cube = HalfCubemap();
+	if (equirect.Width == 0 || equirect.Height == 0 || size == 0 || (size & (size - 1)) != 0)
+		return false;
+
+	unsigned int fullChain = 1;
+	while ((size >> fullChain) > 0)
+		fullChain++;
+	mipLevels = mipLevels == 0 ? fullChain : (std::min)(mipLevels, fullChain);
+
+	cube.Size = size;
+	cube.MipLevels = mipLevels;
+	cube.Texels.resize(cube.GetSubresourceOffset(6, 0));
+
+	// Mips up to the one with a row per band come from the
+	// band; that one is also kept whole for the smaller ones
+	unsigned int bandRows = (std::min)(size, BandRows);
+	unsigned int bandMips = 1;
+	while (bandMips < mipLevels && (bandRows >> bandMips) > 0)
+		bandMips++;
+	unsigned int bandsPerFace = size / bandRows;
+	unsigned int seedSize = size >> (bandMips - 1);
+	std::vector<float> seeds[6];
+	if (bandMips < mipLevels)
+	{
+		for (std::vector<float>& seed : seeds)
+			seed.resize((size_t)seedSize * seedSize * 4);
+	}
+
+	ParallelFor(bandsPerFace * 6, threadCount, [&](unsigned int band)
+	{
+		// Each thread keeps its band's levels between bands
+		static thread_local std::vector<std::vector<float>> levels;
+		levels.resize(bandMips);
+		for (unsigned int mip = 0; mip < bandMips; mip++)
+			levels[mip].resize((size_t)(bandRows >> mip) * (size >> mip) * 4);
+
+		unsigned int face = band / bandsPerFace;
+		unsigned int firstRow = (band % bandsPerFace) * bandRows;
+		for (unsigned int y = 0; y < bandRows; y++)
+			ResampleRow(equirect, face, firstRow + y, size, &levels[0][(size_t)y * size * 4]);
+
+		for (unsigned int mip = 0; mip < bandMips; mip++)
+		{
+			unsigned int mipSize = size >> mip;
+			unsigned int rows = bandRows >> mip;
+			if (mip > 0)
+				DownsampleRows(levels[mip - 1].data(), mipSize * 2, rows, levels[mip].data());
+
+			size_t offset = cube.GetSubresourceOffset(face, mip) + (size_t)(firstRow >> mip) * mipSize * 4;
+			EncodeHalves(levels[mip].data(), (size_t)rows * mipSize * 4, &cube.Texels[offset]);
+		}
+
+		if (!seeds[face].empty())
+		{
+			size_t rowFloats = (size_t)seedSize * 4;
+			memcpy(&seeds[face][(firstRow >> (bandMips - 1)) * rowFloats], levels[bandMips - 1].data(), rowFloats * sizeof(float));
+		}
+	});
+
+	// The last few mips are tiny, so they're made here
+	for (unsigned int face = 0; face < 6 && bandMips < mipLevels; face++)
+	{
+		std::vector<float> level, next;
+		level.swap(seeds[face]);
+		for (unsigned int mip = bandMips; mip < mipLevels; mip++)
+		{
+			unsigned int mipSize = size >> mip;
+			next.resize((size_t)mipSize * mipSize * 4);
+			DownsampleRows(level.data(), mipSize * 2, mipSize, next.data());
+			EncodeHalves(next.data(), next.size(), &cube.Texels[cube.GetSubresourceOffset(face, mip)]);
+			level.swap(next);
+		}
+	}
+	return true;
+}
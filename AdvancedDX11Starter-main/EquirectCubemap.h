@@ -0,0 +1,58 @@
+#pragma once
+
+#include "HDRDecoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// A cube map and its mips in a single allocation of
+// DXGI_FORMAT_R16G16B16A16_FLOAT texels, in D3D's
+// subresource order (every mip of +X, then every mip of -X
+// and so on) with tightly packed rows, so each subresource
+// can be handed straight to CreateTexture2D()
+// --------------------------------------------------------
+struct HalfCubemap
+{
+	unsigned int Size = 0;			// Of the top mip
+	unsigned int MipLevels = 0;
+	std::vector<uint16_t> Texels;	// 4 halves each
+
+	unsigned int GetMipSize(unsigned int mip) const;
+	size_t GetRowPitch(unsigned int mip) const;		// In bytes
+	size_t GetSubresourceOffset(unsigned int face, unsigned int mip) const;	// In halves
+	const uint16_t* GetSubresource(unsigned int face, unsigned int mip) const;
+};
+
+// --------------------------------------------------------
+// Resamples an equirectangular (latitude-longitude) image
+// onto a cube, bilinearly.  The image's center looks down
+// +Z with +X a quarter of the way to its right edge, and
+// its top row is straight up.
+//
+// Faces are split into bands of rows spread across threads
+// (0 for every hardware thread).  4 texels at a time, SSE2
+// finds where each one's direction lands, decodes the RGBE
+// under it and filters, and each band's mips are averaged
+// while it's still in cache.  Colors are averaged linear,
+// then stored gamma 2.2 encoded as every sky is, since the
+// sky and IBL shaders raise what they sample to 2.2; being
+// halves, they keep the range over 1.
+// --------------------------------------------------------
+
+// The largest power of two no more than a quarter of the
+// image's width, which keeps about one texel per pixel
+// around the horizon
+unsigned int GetEquirectCubeSize(unsigned int equirectWidth);
+
+// size must be a power of two.  mipLevels of 0 makes the
+// full chain down to 1x1.  False for an empty image or a
+// size it can't make.
+bool ConvertEquirectToCubemap(const HDRImage& equirect, unsigned int size, unsigned int mipLevels, HalfCubemap& cube, unsigned int threadCount = 0);
+
+// The image's linear color in a direction, filtered the
+// same way with plain float math, to check against
+void SampleEquirect(const HDRImage& equirect, const float direction[3], float rgb[3]);
+
+float DecodeHalf(uint16_t half);
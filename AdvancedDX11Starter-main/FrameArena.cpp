@@ -0,0 +1,226 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Singleton requirement
+FrameArena* FrameArena::instance;
+
+// Starting size of each buffer; they grow if a frame overflows
+static const size_t InitialArenaCapacity = 256 * 1024;
+
+#if ENABLE_HEAP_TRACKING
+// --------------------------------------------------------
+//  Global operator new/delete, replaced only to count
+//  allocations so the per-frame number can be reported.
+//  The aligned versions (C++17) are counted too, where the
+//  compiler has them.
+// --------------------------------------------------------
+static std::atomic<uint64_t> heapAllocationCount;
+
+void* operator new(size_t size)
+{
+	heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	void* memory = malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+
+#ifdef __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+#ifdef _WIN32
+	void* memory = _aligned_malloc(size ? size : 1, (size_t)alignment);
+#else
+	void* memory = 0;
+	if (posix_memalign(&memory, (std::max)((size_t)alignment, sizeof(void*)), size ? size : 1) != 0)
+		memory = 0;
+#endif
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+#ifdef _WIN32
+static void FreeAligned(void* memory) { _aligned_free(memory); }
+#else
+static void FreeAligned(void* memory) { free(memory); }
+#endif
+
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void operator delete(void* memory, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { FreeAligned(memory); }
+#endif
+
+uint64_t FrameArena::GetHeapAllocationCount()
+{
+	return heapAllocationCount.load(std::memory_order_relaxed);
+}
+#else
+uint64_t FrameArena::GetHeapAllocationCount()
+{
+	return 0;
+}
+#endif
+
+// Rounds an address up to a power of two alignment
+static uintptr_t AlignUp(uintptr_t address, size_t alignment)
+{
+	return (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+}
+
+FrameArena::FrameArena()
+{
+	for (Buffer& buffer : buffers)
+	{
+		// Without memory everything goes to the heap, and the
+		// next reset tries again
+		buffer.Memory = (unsigned char*)malloc(InitialArenaCapacity);
+		buffer.Capacity = buffer.Memory ? InitialArenaCapacity : 0;
+		buffer.Offset = 0;
+		buffer.Allocations = 0;
+		buffer.OverflowBytes = 0;
+	}
+
+	current = 0;
+	lastFrameStats = {};
+	lastFrameStats.Capacity = InitialArenaCapacity;
+	heapAllocationsAtFrameStart = GetHeapAllocationCount();
+}
+
+FrameArena::~FrameArena()
+{
+	for (Buffer& buffer : buffers)
+	{
+		for (void* block : buffer.Overflow)
+			free(block);
+		free(buffer.Memory);
+	}
+}
+
+// --------------------------------------------------------
+//  Bumps the current buffer's offset.  If the buffer is
+//  full the memory comes from the heap instead (and the
+//  buffer grows at its next reset), so allocation never
+//  fails just because a frame was busier than usual.
+//
+//  alignment - Must be a power of two
+// --------------------------------------------------------
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	Buffer& buffer = buffers[current];
+	buffer.Allocations.fetch_add(1, std::memory_order_relaxed);
+
+	uintptr_t base = (uintptr_t)buffer.Memory;
+	size_t offset = buffer.Offset.load(std::memory_order_relaxed);
+	while (true)
+	{
+		size_t start = AlignUp(base + offset, alignment) - base;
+		if (start > buffer.Capacity || size > buffer.Capacity - start)
+			break;
+		size_t end = start + size;
+
+		if (buffer.Offset.compare_exchange_weak(offset, end, std::memory_order_relaxed))
+			return buffer.Memory + start;
+	}
+
+	// Overflow - fall back to the heap until the next reset
+	if (size > SIZE_MAX - alignment)
+		return 0;
+	void* block = malloc(size + alignment);
+	if (!block)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(overflowMutex);
+	buffer.Overflow.push_back(block);
+	buffer.OverflowBytes += size;
+	return (void*)AlignUp((uintptr_t)block, alignment);
+}
+
+const char* FrameArena::Format(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(0, 0, format, args);
+	va_end(args);
+
+	if (length < 0)
+		return "";
+
+	char* text = AllocateArray<char>((size_t)length + 1);
+	if (!text)
+		return "";
+
+	va_start(args, format);
+	vsnprintf(text, (size_t)length + 1, format, args);
+	va_end(args);
+	return text;
+}
+
+// --------------------------------------------------------
+//  Records the finished frame's stats, then swaps buffers.
+//  The buffer being switched to was last used two frames
+//  ago, so it's safe to reset.
+// --------------------------------------------------------
+void FrameArena::EndFrame()
+{
+	Buffer& finished = buffers[current];
+	lastFrameStats.BytesAllocated = finished.Offset.load() + finished.OverflowBytes;
+	lastFrameStats.Allocations = finished.Allocations.load();
+	lastFrameStats.OverflowAllocations = (unsigned int)finished.Overflow.size();
+	lastFrameStats.Capacity = finished.Capacity;
+
+	uint64_t heapAllocations = GetHeapAllocationCount();
+	lastFrameStats.HeapAllocations = (unsigned int)(heapAllocations - heapAllocationsAtFrameStart);
+	heapAllocationsAtFrameStart = heapAllocations;
+
+	current ^= 1;
+	Reset(buffers[current]);
+}
+
+// --------------------------------------------------------
+//  Empties a buffer, growing it first if it overflowed so
+//  the same workload fits next time.  If the bigger block
+//  can't be had, the old one is kept and the overflow just
+//  goes to the heap again.
+// --------------------------------------------------------
+void FrameArena::Reset(Buffer& buffer)
+{
+	if (!buffer.Overflow.empty())
+	{
+		size_t needed = buffer.Offset.load() + buffer.OverflowBytes;
+		size_t capacity = (std::max)(buffer.Capacity, InitialArenaCapacity) * 2;
+		while (capacity < needed && capacity <= SIZE_MAX / 2)
+			capacity *= 2;
+
+		for (void* block : buffer.Overflow)
+			free(block);
+		buffer.Overflow.clear();
+
+		unsigned char* memory = (unsigned char*)malloc(capacity);
+		if (memory)
+		{
+			free(buffer.Memory);
+			buffer.Memory = memory;
+			buffer.Capacity = capacity;
+		}
+	}
+
+	buffer.Offset = 0;
+	buffer.Allocations = 0;
+	buffer.OverflowBytes = 0;
+}
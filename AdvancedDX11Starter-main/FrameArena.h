@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Set to 1 to count every global operator new call, for the
+// per-frame heap allocation report.  That replaces operator
+// new for the whole program (DirectXTK and ImGui included)
+// and puts each allocation on one shared atomic, so it's only
+// on by default in Debug builds.
+#ifndef ENABLE_HEAP_TRACKING
+#if defined(DEBUG) || defined(_DEBUG)
+#define ENABLE_HEAP_TRACKING 1
+#else
+#define ENABLE_HEAP_TRACKING 0
+#endif
+#endif
+
+// --------------- Basic usage -----------------
+//
+// Memory for data that only lives for a frame or so.
+// Allocating is a pointer bump, and nothing is ever
+// freed individually: the whole arena is reset at once.
+//
+//  FrameVector<GameEntity*> visible;
+//  visible.reserve(entities.size());
+//
+//  ImGui::TreeNode(FrameArena::GetInstance().Format("Entity %d", i));
+//
+// The arena is double buffered.  DXCore::Run() calls
+// EndFrame() after each frame, which swaps buffers and
+// resets the one about to be used, so an allocation stays
+// valid through the end of the *next* frame too.
+// ---------------------------------------------
+
+// Counts for one finished frame
+struct FrameArenaStats
+{
+	size_t BytesAllocated;
+	unsigned int Allocations;
+	unsigned int OverflowAllocations;	// Didn't fit, so went to the heap
+	size_t Capacity;					// Per buffer
+	unsigned int HeapAllocations;		// Every operator new in the frame
+};
+
+class FrameArena
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static FrameArena& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new FrameArena();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	FrameArena(FrameArena const&) = delete;
+	void operator=(FrameArena const&) = delete;
+
+private:
+	static FrameArena* instance;
+	FrameArena();
+#pragma endregion
+
+public:
+	~FrameArena();
+
+	// Safe to call from any thread
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	template<typename T>
+	T* AllocateArray(size_t count) { return (T*)Allocate(sizeof(T) * count, alignof(T)); }
+
+	// printf into arena memory, for labels and the like
+	const char* Format(const char* format, ...);
+
+	// Called once per frame by DXCore::Run()
+	void EndFrame();
+
+	// Stats for the last finished frame
+	const FrameArenaStats& GetLastFrameStats() { return lastFrameStats; }
+
+	// Total operator new calls since startup (always 0
+	// with ENABLE_HEAP_TRACKING off)
+	static uint64_t GetHeapAllocationCount();
+
+private:
+	// One half of the double buffer
+	struct Buffer
+	{
+		unsigned char* Memory;
+		size_t Capacity;
+		std::atomic<size_t> Offset;
+		std::atomic<unsigned int> Allocations;
+		std::vector<void*> Overflow;	// Heap blocks to free on reset
+		size_t OverflowBytes;
+	};
+
+	Buffer buffers[2];
+	unsigned int current;
+	std::mutex overflowMutex;
+
+	FrameArenaStats lastFrameStats;
+	uint64_t heapAllocationsAtFrameStart;
+
+	void Reset(Buffer& buffer);
+};
+
+
+// --------------------------------------------------------
+// STL allocator that takes its memory from the frame arena,
+// for containers that are thrown away by the end of the
+// frame.  Deallocation does nothing.
+// --------------------------------------------------------
+template<typename T>
+class FrameAllocator
+{
+public:
+	typedef T value_type;
+
+	FrameAllocator() {}
+	template<typename U> FrameAllocator(const FrameAllocator<U>&) {}
+
+	T* allocate(size_t count) { return FrameArena::GetInstance().AllocateArray<T>(count); }
+	void deallocate(T*, size_t) {}
+
+	template<typename U> bool operator==(const FrameAllocator<U>&) const { return true; }
+	template<typename U> bool operator!=(const FrameAllocator<U>&) const { return false; }
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
@@ -1,12 +1,17 @@
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
 #include "ImGui\imgui_impl_win32.h"
-#include <stdlib.h>     // For seeding random and rand()
-#include <time.h>       // For grabbing time (to seed random)
+#include <stdlib.h>     // For rand()
+#include <string.h>
 
 #include "Game.h"
 #include "Vertex.h"
 #include "Input.h"
+#include "Profiler.h"
+#include "FrameArena.h"
+#include "ParallelFor.h"
+#include "TexturePacker.h"
+#include "TextureBaker.h"
 
 #include "WICTextureLoader.h"
 
@@ -22,8 +27,57 @@ using namespace DirectX;
 #define RandomRange(min, max) (float)rand() / RAND_MAX * (max - min) + min
 
 // Helper macros for making texture and shader loading code more succinct
-#define LoadTexture(file, srv) CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(file).c_str(), 0, srv.GetAddressOf())
+#define LoadTexture(file, texture) texture = resourceCache->LoadTextureAsync(GetFullPathTo_Wide(file))
+#define StreamTexture(file, texture) texture = textureStreamer->Load(GetFullPathTo_Wide(file), TextureStreamer::GetMaterialTextureOptions(file))
 #define LoadShader(type, file) std::make_shared<type>(device.Get(), context.Get(), GetFullPathTo_Wide(file).c_str())
+#define QueueShaderLoad(shader, type, file) shaderLoads.push_back({ file, \
+	[&]() { return std::static_pointer_cast<ISimpleShader>(LoadShader(type, file)); }, \
+	[&](std::shared_ptr<ISimpleShader> loaded) { shader = std::static_pointer_cast<type>(loaded); } })
+
+// One shader for LoadShaders() to load, and where to put it
+struct ShaderLoad
+{
+	std::wstring File;
+	std::function<std::shared_ptr<ISimpleShader>()> Load;
+	std::function<void(std::shared_ptr<ISimpleShader>)> Assign;
+};
+
+// --------------------------------------------------------
+// Loads shaders on the shared worker pool.  Each is mostly
+// file reading and reflection (or reading its cached
+// reflection), and the device is free threaded.  A file
+// that's asked for more than once is only loaded once, and
+// shared, so no two threads ever race on its .meta cache.
+// --------------------------------------------------------
+static void LoadShaders(const std::vector<ShaderLoad>& loads)
+{
+	std::vector<size_t> sources(loads.size());
+	std::vector<size_t> uniqueLoads;
+	for (size_t i = 0; i < loads.size(); i++)
+	{
+		sources[i] = i;
+		for (size_t u : uniqueLoads)
+		{
+			if (loads[u].File == loads[i].File)
+			{
+				sources[i] = u;
+				break;
+			}
+		}
+
+		if (sources[i] == i)
+			uniqueLoads.push_back(i);
+	}
+
+	std::vector<std::shared_ptr<ISimpleShader>> shaders(loads.size());
+	ParallelFor((unsigned int)uniqueLoads.size(), 0, [&](unsigned int u)
+	{
+		shaders[uniqueLoads[u]] = loads[uniqueLoads[u]].Load();
+	});
+
+	for (size_t i = 0; i < loads.size(); i++)
+		loads[i].Assign(shaders[sources[i]]);
+}
 
 
 // --------------------------------------------------------
@@ -47,8 +101,8 @@ Game::Game(HINSTANCE hInstance)
 	lightCount(0),
 	arial(0)
 {
-	// Seed random
-	srand((unsigned int)time(0));
+	// Note: random is seeded by DXCore::Run(), so that input
+	// recordings can replay with the same seed
 
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -74,6 +128,8 @@ Game::~Game()
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
 	delete renderer;
+
+	ISimpleShader::SetConstantRing(0);
 }
 
 // --------------------------------------------------------
@@ -82,8 +138,19 @@ Game::~Game()
 // --------------------------------------------------------
 void Game::Init()
 {
+	PROFILE_ZONE("Game::Init");
+
 	// Asset loading and entity creation
 	LoadAssetsAndCreateEntities();
+
+	// Shaders share one ring of constant data from here on,
+	// unless it's unsupported or turned off for comparison
+	if (!commandLine.HasOption("-noconstantring") &&
+		ConstantRing::IsSupported(device.Get(), context.Get()))
+	{
+		constantRing = std::make_shared<ConstantRing>(device, context);
+		ISimpleShader::SetConstantRing(constantRing.get());
+	}
 	
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
@@ -139,6 +206,7 @@ void Game::Init()
 	ImGui_ImplDX11_Init(device.Get(), context.Get());
 
 	guiActive = true;
+	profilerWindowOpen = false;
 }
 
 
@@ -147,35 +215,49 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadAssetsAndCreateEntities()
 {
-	// Load shaders using our succinct LoadShader() macro
-	std::shared_ptr<SimpleVertexShader> vertexShader	= LoadShader(SimpleVertexShader, L"VertexShader.cso");
-	std::shared_ptr<SimplePixelShader> pixelShader		= LoadShader(SimplePixelShader, L"PixelShader.cso");
-	pixelShaderPBR	= LoadShader(SimplePixelShader, L"PixelShaderPBR.cso");
-	std::shared_ptr<SimplePixelShader> solidColorPS		= LoadShader(SimplePixelShader, L"SolidColorPS.cso");
-	
-	std::shared_ptr<SimpleVertexShader> skyVS = LoadShader(SimpleVertexShader, L"SkyVS.cso");
-	skyPS  = LoadShader(SimplePixelShader, L"SkyPS.cso");
+	PROFILE_ZONE("LoadAssetsAndCreateEntities");
+
+	// Load shaders using our succinct QueueShaderLoad() macro, then
+	// load them all at once (see LoadShaders() above)
+	std::shared_ptr<SimpleVertexShader> vertexShader;
+	std::shared_ptr<SimplePixelShader> pixelShader;
+	std::shared_ptr<SimplePixelShader> solidColorPS;
+	std::shared_ptr<SimpleVertexShader> skyVS;
+	std::shared_ptr<SimplePixelShader> irradiancePS;
+	std::shared_ptr<SimplePixelShader> specConvPS;
+	{
+		PROFILE_ZONE("Load shaders");
+		std::vector<ShaderLoad> shaderLoads;
+		QueueShaderLoad(vertexShader, SimpleVertexShader, L"VertexShader.cso");
+		QueueShaderLoad(pixelShader, SimplePixelShader, L"PixelShader.cso");
+		QueueShaderLoad(pixelShaderPBR, SimplePixelShader, L"PixelShaderPBR.cso");
+		QueueShaderLoad(solidColorPS, SimplePixelShader, L"SolidColorPS.cso");
 
-	//IBL SHADERS
-	fullscreenVS = LoadShader(SimpleVertexShader, L"FullscreenVS.cso");
-	std::shared_ptr<SimplePixelShader> irradiancePS = LoadShader(SimplePixelShader, L"IBLIrradianceMapPS.cso");
-	std::shared_ptr<SimplePixelShader> specConvPS = LoadShader(SimplePixelShader, L"IBLSpecularConvolutionPS.cso");
-	std::shared_ptr<SimplePixelShader> envBrdfPS = LoadShader(SimplePixelShader, L"IBLBrdfLookUpTablePS.cso");
+		QueueShaderLoad(skyVS, SimpleVertexShader, L"SkyVS.cso");
+		QueueShaderLoad(skyPS, SimplePixelShader, L"SkyPS.cso");
 
-	//Refraction Shaders
-	refractionPS = LoadShader(SimplePixelShader, L"RefractionPS.cso");
-	simplePS = LoadShader(SimplePixelShader, L"SimpleShaderPS.cso");
+		//IBL SHADERS
+		QueueShaderLoad(fullscreenVS, SimpleVertexShader, L"FullscreenVS.cso");
+		QueueShaderLoad(irradiancePS, SimplePixelShader, L"IBLIrradianceMapPS.cso");
+		QueueShaderLoad(specConvPS, SimplePixelShader, L"IBLSpecularConvolutionPS.cso");
 
-	//Particle Shaders
-	particlePS = LoadShader(SimplePixelShader, L"ParticlePS.cso");
-	particleVS = LoadShader(SimpleVertexShader, L"ParticleVS.cso");
+		//Refraction Shaders
+		QueueShaderLoad(refractionPS, SimplePixelShader, L"RefractionPS.cso");
+		QueueShaderLoad(simplePS, SimplePixelShader, L"SimpleShaderPS.cso");
 
-	//SSAO Shaders
-	ssaoPS = LoadShader(SimplePixelShader, L"SsaoPS.cso");
-	ssaoBlurPS = LoadShader(SimplePixelShader, L"SsaoPS.cso");
-	ssaoCombinePS = LoadShader(SimplePixelShader, L"SsaoPS.cso");
+		//Particle Shaders
+		QueueShaderLoad(particlePS, SimplePixelShader, L"ParticlePS.cso");
+		QueueShaderLoad(particleVS, SimpleVertexShader, L"ParticleVS.cso");
 
-	lightRayPS = LoadShader(SimplePixelShader, L"LightRayPS.cso");
+		//SSAO Shaders
+		QueueShaderLoad(ssaoPS, SimplePixelShader, L"SsaoPS.cso");
+		QueueShaderLoad(ssaoBlurPS, SimplePixelShader, L"SsaoBlurPS.cso");
+		QueueShaderLoad(ssaoCombinePS, SimplePixelShader, L"SsaoCombinePS.cso");
+
+		QueueShaderLoad(lightRayPS, SimplePixelShader, L"LightRayPS.cso");
+
+		LoadShaders(shaderLoads);
+	}
 
 
 	// Set up the sprite batch and load the sprite font
@@ -189,64 +271,97 @@ void Game::LoadAssetsAndCreateEntities()
 	std::shared_ptr<Mesh> coneMesh = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cone.obj").c_str(), device);
 	
 	// Declare the textures we'll need
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleA,  cobbleN,  cobbleR,  cobbleM;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorA,  floorN,  floorR,  floorM;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paintA,  paintN,  paintR,  paintM;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedA,  scratchedN,  scratchedR,  scratchedM;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeA,  bronzeN,  bronzeR,  bronzeM;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> roughA,  roughN,  roughR,  roughM;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodA,  woodN,  woodR,  woodM;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> white, black, light_gray, dark_gray, flatNormalMap;
-	
+	std::shared_ptr<StreamedTexture> cobbleA,  cobbleN,  cobbleORM;
+	std::shared_ptr<StreamedTexture> floorA,  floorN,  floorORM;
+	std::shared_ptr<StreamedTexture> paintA,  paintN,  paintORM;
+	std::shared_ptr<StreamedTexture> scratchedA,  scratchedN,  scratchedORM;
+	std::shared_ptr<StreamedTexture> bronzeA,  bronzeN,  bronzeORM;
+	std::shared_ptr<StreamedTexture> roughA,  roughN,  roughORM;
+	std::shared_ptr<StreamedTexture> woodA,  woodN,  woodORM;
+	std::shared_ptr<StreamedTexture> shinyMetalORM, quarterRoughMetalORM, halfRoughMetalORM;
+	std::shared_ptr<StreamedTexture> shinyPlasticORM, quarterRoughPlasticORM, halfRoughPlasticORM;
+	std::shared_ptr<CachedTexture> white;
+
+	// Bake block compressed copies of the material textures first if
+	// asked, so they're what gets streamed below
+	if (commandLine.HasOption("-bake-textures"))
+	{
+		std::string quality = commandLine.GetValue("-bake-quality", "normal");
+		TextureBaker::BakeFolder(GetFullPathTo_Wide(L"../../Assets/Textures/"),
+			quality == "fast" ? BLOCK_QUALITY_FAST : quality == "high" ? BLOCK_QUALITY_HIGH : BLOCK_QUALITY_NORMAL);
+	}
 
-	// Load the textures using our succinct LoadTexture() macro
-	LoadTexture(L"../../Assets/Textures/cobblestone_albedo.png", cobbleA);
-	LoadTexture(L"../../Assets/Textures/cobblestone_normals.png", cobbleN);
-	LoadTexture(L"../../Assets/Textures/cobblestone_roughness.png", cobbleR);
-	LoadTexture(L"../../Assets/Textures/cobblestone_metal.png", cobbleM);
+	// Load the textures using our succinct LoadTexture() macro.  Each
+	// is decoded on its own thread, and the cache only loads a file once.
+	// Material textures are streamed, starting with just their small mips.
+	resourceCache = std::make_shared<ResourceCache>(device, context);
+	textureStreamer = std::make_shared<TextureStreamer>(device, context,
+		(size_t)commandLine.GetUInt("-texturebudget", TextureResidency::DefaultBudget / (1024 * 1024)) * 1024 * 1024);
 
-	LoadTexture(L"../../Assets/Textures/floor_albedo.png", floorA);
-	LoadTexture(L"../../Assets/Textures/floor_normals.png", floorN);
-	LoadTexture(L"../../Assets/Textures/floor_roughness.png", floorR);
-	LoadTexture(L"../../Assets/Textures/floor_metal.png", floorM);
+	// Roughness and metal are packed into one texture per material
+	// (see TexturePacker), and compressed too when baking
+	bool compressPacked = commandLine.HasOption("-bake-textures");
+	{
+		PROFILE_ZONE("Textures");
+		StreamTexture(L"../../Assets/Textures/cobblestone_albedo.png", cobbleA);
+		StreamTexture(L"../../Assets/Textures/cobblestone_normals.png", cobbleN);
+		cobbleORM = LoadPackedORM("cobblestone", "cobblestone_roughness.png", "cobblestone_metal.png", compressPacked);
+
+		StreamTexture(L"../../Assets/Textures/floor_albedo.png", floorA);
+		StreamTexture(L"../../Assets/Textures/floor_normals.png", floorN);
+		floorORM = LoadPackedORM("floor", "floor_roughness.png", "floor_metal.png", compressPacked);
 	
-	LoadTexture(L"../../Assets/Textures/paint_albedo.png", paintA);
-	LoadTexture(L"../../Assets/Textures/paint_normals.png", paintN);
-	LoadTexture(L"../../Assets/Textures/paint_roughness.png", paintR);
-	LoadTexture(L"../../Assets/Textures/paint_metal.png", paintM);
+		StreamTexture(L"../../Assets/Textures/paint_albedo.png", paintA);
+		StreamTexture(L"../../Assets/Textures/paint_normals.png", paintN);
+		paintORM = LoadPackedORM("paint", "paint_roughness.png", "paint_metal.png", compressPacked);
 	
-	LoadTexture(L"../../Assets/Textures/scratched_albedo.png", scratchedA);
-	LoadTexture(L"../../Assets/Textures/scratched_normals.png", scratchedN);
-	LoadTexture(L"../../Assets/Textures/scratched_roughness.png", scratchedR);
-	LoadTexture(L"../../Assets/Textures/scratched_metal.png", scratchedM);
+		StreamTexture(L"../../Assets/Textures/scratched_albedo.png", scratchedA);
+		StreamTexture(L"../../Assets/Textures/scratched_normals.png", scratchedN);
+		scratchedORM = LoadPackedORM("scratched", "scratched_roughness.png", "scratched_metal.png", compressPacked);
 	
-	LoadTexture(L"../../Assets/Textures/bronze_albedo.png", bronzeA);
-	LoadTexture(L"../../Assets/Textures/bronze_normals.png", bronzeN);
-	LoadTexture(L"../../Assets/Textures/bronze_roughness.png", bronzeR);
-	LoadTexture(L"../../Assets/Textures/bronze_metal.png", bronzeM);
+		StreamTexture(L"../../Assets/Textures/bronze_albedo.png", bronzeA);
+		StreamTexture(L"../../Assets/Textures/bronze_normals.png", bronzeN);
+		bronzeORM = LoadPackedORM("bronze", "bronze_roughness.png", "bronze_metal.png", compressPacked);
 	
-	LoadTexture(L"../../Assets/Textures/rough_albedo.png", roughA);
-	LoadTexture(L"../../Assets/Textures/rough_normals.png", roughN);
-	LoadTexture(L"../../Assets/Textures/rough_roughness.png", roughR);
-	LoadTexture(L"../../Assets/Textures/rough_metal.png", roughM);
+		StreamTexture(L"../../Assets/Textures/rough_albedo.png", roughA);
+		StreamTexture(L"../../Assets/Textures/rough_normals.png", roughN);
+		roughORM = LoadPackedORM("rough", "rough_roughness.png", "rough_metal.png", compressPacked);
 	
-	LoadTexture(L"../../Assets/Textures/wood_albedo.png", woodA);
-	LoadTexture(L"../../Assets/Textures/wood_normals.png", woodN);
-	LoadTexture(L"../../Assets/Textures/wood_roughness.png", woodR);
-	LoadTexture(L"../../Assets/Textures/wood_metal.png", woodM);
-
-	LoadTexture(L"../../Assets/Textures/white.png", white);
-	LoadTexture(L"../../Assets/Textures/black.png", black);
-	LoadTexture(L"../../Assets/Textures/light_gray.png", light_gray);
-	LoadTexture(L"../../Assets/Textures/dark_gray.png", dark_gray);
-
-	LoadTexture(L"../../Assets/Particles/snowflake.png", particleTextureSnow);
-	LoadTexture(L"../../Assets/Particles/smoke_01.png", particleTextureSmoke);
-	LoadTexture(L"../../Assets/Particles/trace_03.png", particleTextureTrace);
-	//LoadTexture(L"../../Assets/Textures/FlatNormalMap.png", flatNormalMap);
-	CreateWICTextureFromFileEx(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/FlatNormalMap.png").c_str(), 1024, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0, WIC_LOADER_IGNORE_SRGB, 0, flatNormalMap.GetAddressOf());
+		StreamTexture(L"../../Assets/Textures/wood_albedo.png", woodA);
+		StreamTexture(L"../../Assets/Textures/wood_normals.png", woodN);
+		woodORM = LoadPackedORM("wood", "wood_roughness.png", "wood_metal.png", compressPacked);
+
+		LoadTexture(L"../../Assets/Textures/white.png", white);
+
+		// Solid roughness and metal for the testing materials
+		shinyMetalORM = LoadPackedORM("shiny_metal", "black.png", "white.png", compressPacked);
+		quarterRoughMetalORM = LoadPackedORM("quarter_rough_metal", "dark_gray.png", "white.png", compressPacked);
+		halfRoughMetalORM = LoadPackedORM("half_rough_metal", "light_gray.png", "white.png", compressPacked);
+		shinyPlasticORM = LoadPackedORM("shiny_plastic", "black.png", "black.png", compressPacked);
+		quarterRoughPlasticORM = LoadPackedORM("quarter_rough_plastic", "dark_gray.png", "black.png", compressPacked);
+		halfRoughPlasticORM = LoadPackedORM("half_rough_plastic", "light_gray.png", "black.png", compressPacked);
+
+		// Keep thin particles from fading away in the distance
+		TextureLoadOptions particleOptions;
+		particleOptions.Mips.Filter = MIP_FILTER_KAISER;
+		particleOptions.Mips.PreserveAlphaCoverage = true;
+		snowTexture = resourceCache->LoadTextureAsync(GetFullPathTo_Wide(L"../../Assets/Particles/snowflake.png"), particleOptions);
+		smokeTexture = resourceCache->LoadTextureAsync(GetFullPathTo_Wide(L"../../Assets/Particles/smoke_01.png"), particleOptions);
+		traceTexture = resourceCache->LoadTextureAsync(GetFullPathTo_Wide(L"../../Assets/Particles/trace_03.png"), particleOptions);
+
+		TextureLoadOptions normalMapOptions;
+		normalMapOptions.IgnoreSRGB = true;
+		normalMapOptions.MaxSize = 1024;
+		flatNormalMap = resourceCache->LoadTextureAsync(GetFullPathTo_Wide(L"../../Assets/Textures/FlatNormalMap.png"), normalMapOptions);
+
+		resourceCache->WaitForLoads();
+		textureStreamer->WaitForLoads();
+	}
 
-	FlatNormalMapTest = flatNormalMap;
+	FlatNormalMapTest = flatNormalMap->SRV;
+	particleTextureSnow = snowTexture->SRV;
+	particleTextureSmoke = smokeTexture->SRV;
+	particleTextureTrace = traceTexture->SRV;
 
 	// Describe and create our sampler state
 	D3D11_SAMPLER_DESC sampDesc = {};
@@ -256,150 +371,152 @@ void Game::LoadAssetsAndCreateEntities()
 	sampDesc.Filter = D3D11_FILTER_ANISOTROPIC;
 	sampDesc.MaxAnisotropy = 16;
 	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-	device->CreateSamplerState(&sampDesc, samplerOptions.GetAddressOf());
+	samplerOptions = resourceCache->GetSampler(sampDesc);
 
 	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
 	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
 	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
-	device->CreateSamplerState(&sampDesc, clampSampler.GetAddressOf());
-
-
-	// Create the sky using 6 images
-	sky = std::make_shared<Sky>(
-		GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\right.png").c_str(),
-		GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\left.png").c_str(),
-		GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\up.png").c_str(),
-		GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\down.png").c_str(),
-		GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\front.png").c_str(),
-		GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\back.png").c_str(),
-		cubeMesh,
-		skyVS,
-		skyPS,
-		samplerOptions,
-		device,
-		context,
-		fullscreenVS,
-		irradiancePS,
-		specConvPS,
-		envBrdfPS);
+	clampSampler = resourceCache->GetSampler(sampDesc);
+
+
+	// Create the sky, procedural or using 6 images
+	if (commandLine.HasOption("-proceduralsky"))
+	{
+		ProceduralSkySettings skySettings;
+		GetSunDirectionAtTime(timeOfDay, sunMaxElevation, skySettings.SunDirection);
+		skyUpdateBudgetMs = commandLine.GetFloat("-skybudget", skyUpdateBudgetMs);
+		sky = std::make_shared<Sky>(
+			skySettings,
+			cubeMesh,
+			skyVS,
+			skyPS,
+			samplerOptions,
+			device,
+			context);
+	}
+	else
+	{
+		sky = std::make_shared<Sky>(
+			GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\right.png").c_str(),
+			GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\left.png").c_str(),
+			GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\up.png").c_str(),
+			GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\down.png").c_str(),
+			GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\front.png").c_str(),
+			GetFullPathTo_Wide(L"..\\..\\Assets\\Skies\\Clouds Blue\\back.png").c_str(),
+			cubeMesh,
+			skyVS,
+			skyPS,
+			samplerOptions,
+			device,
+			context,
+			fullscreenVS,
+			irradiancePS,
+			specConvPS);
+	}
 
 
 	// Create PBR materials
 	std::shared_ptr<Material> cobbleMat2xPBR = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	cobbleMat2xPBR->AddSampler("BasicSampler", samplerOptions);
 	cobbleMat2xPBR->AddSampler("ClampSampler", clampSampler);
-	cobbleMat2xPBR->AddTextureSRV("Albedo", cobbleA);
-	cobbleMat2xPBR->AddTextureSRV("NormalMap", cobbleN);
-	cobbleMat2xPBR->AddTextureSRV("RoughnessMap", cobbleR);
-	cobbleMat2xPBR->AddTextureSRV("MetalMap", cobbleM);
+	textureStreamer->Bind(cobbleMat2xPBR, "Albedo", cobbleA);
+	textureStreamer->Bind(cobbleMat2xPBR, "NormalMap", cobbleN);
+	textureStreamer->Bind(cobbleMat2xPBR, "OcclusionRoughnessMetalMap", cobbleORM);
 	cobbleMat2xPBR->SetRefractive(true);
 
 
 	std::shared_ptr<Material> cobbleMat4xPBR = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(4, 4));
 	cobbleMat4xPBR->AddSampler("BasicSampler", samplerOptions);
 	cobbleMat4xPBR->AddSampler("ClampSampler", clampSampler);
-	cobbleMat4xPBR->AddTextureSRV("Albedo", cobbleA);
-	cobbleMat4xPBR->AddTextureSRV("NormalMap", cobbleN);
-	cobbleMat4xPBR->AddTextureSRV("RoughnessMap", cobbleR);
-	cobbleMat4xPBR->AddTextureSRV("MetalMap", cobbleM);
+	textureStreamer->Bind(cobbleMat4xPBR, "Albedo", cobbleA);
+	textureStreamer->Bind(cobbleMat4xPBR, "NormalMap", cobbleN);
+	textureStreamer->Bind(cobbleMat4xPBR, "OcclusionRoughnessMetalMap", cobbleORM);
 
 	std::shared_ptr<Material> floorMatPBR = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	floorMatPBR->AddSampler("BasicSampler", samplerOptions);
 	floorMatPBR->AddSampler("ClampSampler", clampSampler);
-	floorMatPBR->AddTextureSRV("Albedo", floorA);
-	floorMatPBR->AddTextureSRV("NormalMap", floorN);
-	floorMatPBR->AddTextureSRV("RoughnessMap", floorR);
-	floorMatPBR->AddTextureSRV("MetalMap", floorM);
+	textureStreamer->Bind(floorMatPBR, "Albedo", floorA);
+	textureStreamer->Bind(floorMatPBR, "NormalMap", floorN);
+	textureStreamer->Bind(floorMatPBR, "OcclusionRoughnessMetalMap", floorORM);
 
 	std::shared_ptr<Material> paintMatPBR = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	paintMatPBR->AddSampler("BasicSampler", samplerOptions);
 	paintMatPBR->AddSampler("ClampSampler", clampSampler);
-	paintMatPBR->AddTextureSRV("Albedo", paintA);
-	paintMatPBR->AddTextureSRV("NormalMap", paintN);
-	paintMatPBR->AddTextureSRV("RoughnessMap", paintR);
-	paintMatPBR->AddTextureSRV("MetalMap", paintM);
+	textureStreamer->Bind(paintMatPBR, "Albedo", paintA);
+	textureStreamer->Bind(paintMatPBR, "NormalMap", paintN);
+	textureStreamer->Bind(paintMatPBR, "OcclusionRoughnessMetalMap", paintORM);
 
 	std::shared_ptr<Material> scratchedMatPBR = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	scratchedMatPBR->AddSampler("BasicSampler", samplerOptions);
 	scratchedMatPBR->AddSampler("ClampSampler", clampSampler);
-	scratchedMatPBR->AddTextureSRV("Albedo", scratchedA);
-	scratchedMatPBR->AddTextureSRV("NormalMap", scratchedN);
-	scratchedMatPBR->AddTextureSRV("RoughnessMap", scratchedR);
-	scratchedMatPBR->AddTextureSRV("MetalMap", scratchedM);
+	textureStreamer->Bind(scratchedMatPBR, "Albedo", scratchedA);
+	textureStreamer->Bind(scratchedMatPBR, "NormalMap", scratchedN);
+	textureStreamer->Bind(scratchedMatPBR, "OcclusionRoughnessMetalMap", scratchedORM);
 
 	std::shared_ptr<Material> bronzeMatPBR = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	bronzeMatPBR->AddSampler("BasicSampler", samplerOptions);
 	bronzeMatPBR->AddSampler("ClampSampler", clampSampler);
-	bronzeMatPBR->AddTextureSRV("Albedo", bronzeA);
-	bronzeMatPBR->AddTextureSRV("NormalMap", bronzeN);
-	bronzeMatPBR->AddTextureSRV("RoughnessMap", bronzeR);
-	bronzeMatPBR->AddTextureSRV("MetalMap", bronzeM);
+	textureStreamer->Bind(bronzeMatPBR, "Albedo", bronzeA);
+	textureStreamer->Bind(bronzeMatPBR, "NormalMap", bronzeN);
+	textureStreamer->Bind(bronzeMatPBR, "OcclusionRoughnessMetalMap", bronzeORM);
 
 	std::shared_ptr<Material> roughMatPBR = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	roughMatPBR->AddSampler("BasicSampler", samplerOptions);
 	roughMatPBR->AddSampler("ClampSampler", clampSampler);
-	roughMatPBR->AddTextureSRV("Albedo", roughA);
-	roughMatPBR->AddTextureSRV("NormalMap", roughN);
-	roughMatPBR->AddTextureSRV("RoughnessMap", roughR);
-	roughMatPBR->AddTextureSRV("MetalMap", roughM);
+	textureStreamer->Bind(roughMatPBR, "Albedo", roughA);
+	textureStreamer->Bind(roughMatPBR, "NormalMap", roughN);
+	textureStreamer->Bind(roughMatPBR, "OcclusionRoughnessMetalMap", roughORM);
 	roughMatPBR->SetRefractive(true);
 
 	std::shared_ptr<Material> woodMatPBR = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	woodMatPBR->AddSampler("BasicSampler", samplerOptions);
 	woodMatPBR->AddSampler("ClampSampler", clampSampler);
-	woodMatPBR->AddTextureSRV("Albedo", woodA);
-	woodMatPBR->AddTextureSRV("NormalMap", woodN);
-	woodMatPBR->AddTextureSRV("RoughnessMap", woodR);
-	woodMatPBR->AddTextureSRV("MetalMap", woodM);
+	textureStreamer->Bind(woodMatPBR, "Albedo", woodA);
+	textureStreamer->Bind(woodMatPBR, "NormalMap", woodN);
+	textureStreamer->Bind(woodMatPBR, "OcclusionRoughnessMetalMap", woodORM);
 
 	//create testing materials
 	std::shared_ptr<Material> shinyMetal = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	shinyMetal->AddSampler("BasicSampler", samplerOptions);
 	shinyMetal->AddSampler("ClampSampler", clampSampler);
-	shinyMetal->AddTextureSRV("Albedo", white);
-	shinyMetal->AddTextureSRV("NormalMap", flatNormalMap);
-	shinyMetal->AddTextureSRV("RoughnessMap", black);
-	shinyMetal->AddTextureSRV("MetalMap", white);
+	shinyMetal->AddTexture("Albedo", white);
+	shinyMetal->AddTexture("NormalMap", flatNormalMap);
+	textureStreamer->Bind(shinyMetal, "OcclusionRoughnessMetalMap", shinyMetalORM);
 
 	std::shared_ptr<Material> quarterRoughMetal = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	quarterRoughMetal->AddSampler("BasicSampler", samplerOptions);
 	quarterRoughMetal->AddSampler("ClampSampler", clampSampler);
-	quarterRoughMetal->AddTextureSRV("Albedo", white);
-	quarterRoughMetal->AddTextureSRV("NormalMap", flatNormalMap);
-	quarterRoughMetal->AddTextureSRV("RoughnessMap", dark_gray);
-	quarterRoughMetal->AddTextureSRV("MetalMap", white);
+	quarterRoughMetal->AddTexture("Albedo", white);
+	quarterRoughMetal->AddTexture("NormalMap", flatNormalMap);
+	textureStreamer->Bind(quarterRoughMetal, "OcclusionRoughnessMetalMap", quarterRoughMetalORM);
 
 	std::shared_ptr<Material> halfRoughMetal = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	halfRoughMetal->AddSampler("BasicSampler", samplerOptions);
 	halfRoughMetal->AddSampler("ClampSampler", clampSampler);
-	halfRoughMetal->AddTextureSRV("Albedo", white);
-	halfRoughMetal->AddTextureSRV("NormalMap", flatNormalMap);
-	halfRoughMetal->AddTextureSRV("RoughnessMap", light_gray);
-	halfRoughMetal->AddTextureSRV("MetalMap", white);
+	halfRoughMetal->AddTexture("Albedo", white);
+	halfRoughMetal->AddTexture("NormalMap", flatNormalMap);
+	textureStreamer->Bind(halfRoughMetal, "OcclusionRoughnessMetalMap", halfRoughMetalORM);
 
 	std::shared_ptr<Material> shinyPlastic = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	shinyPlastic->AddSampler("BasicSampler", samplerOptions);
 	shinyPlastic->AddSampler("ClampSampler", clampSampler);
-	shinyPlastic->AddTextureSRV("Albedo", white);
-	shinyPlastic->AddTextureSRV("NormalMap", flatNormalMap);
-	shinyPlastic->AddTextureSRV("RoughnessMap", black);
-	shinyPlastic->AddTextureSRV("MetalMap", black);
+	shinyPlastic->AddTexture("Albedo", white);
+	shinyPlastic->AddTexture("NormalMap", flatNormalMap);
+	textureStreamer->Bind(shinyPlastic, "OcclusionRoughnessMetalMap", shinyPlasticORM);
 
 	std::shared_ptr<Material> quarterRoughPlastic = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	quarterRoughPlastic->AddSampler("BasicSampler", samplerOptions);
 	quarterRoughPlastic->AddSampler("ClampSampler", clampSampler);
-	quarterRoughPlastic->AddTextureSRV("Albedo", white);
-	quarterRoughPlastic->AddTextureSRV("NormalMap", flatNormalMap);
-	quarterRoughPlastic->AddTextureSRV("RoughnessMap", dark_gray);
-	quarterRoughPlastic->AddTextureSRV("MetalMap", black);
+	quarterRoughPlastic->AddTexture("Albedo", white);
+	quarterRoughPlastic->AddTexture("NormalMap", flatNormalMap);
+	textureStreamer->Bind(quarterRoughPlastic, "OcclusionRoughnessMetalMap", quarterRoughPlasticORM);
 
 	std::shared_ptr<Material> halfRoughPlastic = std::make_shared<Material>(pixelShaderPBR, vertexShader, XMFLOAT3(1, 1, 1), XMFLOAT2(2, 2));
 	halfRoughPlastic->AddSampler("BasicSampler", samplerOptions);
 	halfRoughPlastic->AddSampler("ClampSampler", clampSampler);
-	halfRoughPlastic->AddTextureSRV("Albedo", white);
-	halfRoughPlastic->AddTextureSRV("NormalMap", flatNormalMap);
-	halfRoughPlastic->AddTextureSRV("RoughnessMap", light_gray);
-	halfRoughPlastic->AddTextureSRV("MetalMap", black);
+	halfRoughPlastic->AddTexture("Albedo", white);
+	halfRoughPlastic->AddTexture("NormalMap", flatNormalMap);
+	textureStreamer->Bind(halfRoughPlastic, "OcclusionRoughnessMetalMap", halfRoughPlasticORM);
 
 
 
@@ -621,10 +738,13 @@ void Game::OnResize()
 }
 
 // --------------------------------------------------------
-// Update your game here - user input, move objects, AI, etc.
+// Once-per-frame work - UI, and input that has to be read
+// exactly once per frame (key presses, mouse deltas)
 // --------------------------------------------------------
-void Game::Update(float deltaTime, float totalTime)
+void Game::FrameUpdate(float deltaTime, float totalTime)
 {
+	PROFILE_ZONE("Game::FrameUpdate");
+
 	//Get input once
 	Input& input = Input::GetInstance();
 
@@ -655,9 +775,12 @@ void Game::Update(float deltaTime, float totalTime)
 	input.GetKeyArray(io.KeysDown, 256);
 
 	// Reset the frame
-	ImGui_ImplDX11_NewFrame();
-	ImGui_ImplWin32_NewFrame();
-	ImGui::NewFrame();
+	{
+		PROFILE_ZONE("ImGui NewFrame");
+		ImGui_ImplDX11_NewFrame();
+		ImGui_ImplWin32_NewFrame();
+		ImGui::NewFrame();
+	}
 
 	// Determine new input capture
 	input.SetGuiKeyboardCapture(io.WantCaptureKeyboard);
@@ -667,6 +790,7 @@ void Game::Update(float deltaTime, float totalTime)
 	//ImGui::ShowDemoWindow();
 	
 	if (guiActive) {
+		PROFILE_ZONE("ImGui Windows");
 	
 		//ImGui::Begin("Engine Stats");
 
@@ -685,6 +809,74 @@ void Game::Update(float deltaTime, float totalTime)
 			ImGui::BulletText("Width: %d | Height: %d", width, height);
 			ImGui::BulletText("# of Lights: %d", lights.size());
 			ImGui::BulletText("# of Entities: %d", entities.size());
+			ImGui::Checkbox("Show Profiler", &profilerWindowOpen);
+
+			float tickRate = GetTickRate();
+			if (ImGui::SliderFloat("Simulation Hz", &tickRate, 10.0f, 240.0f, "%.0f"))
+				SetTickRate(tickRate);
+			ImGui::BulletText("Simulation steps this frame: %u", GetStepsThisFrame());
+
+			const FrameArenaStats& arenaStats = FrameArena::GetInstance().GetLastFrameStats();
+			ImGui::BulletText("Frame arena: %zu / %zu bytes, %u allocations (%u overflowed)",
+				arenaStats.BytesAllocated, arenaStats.Capacity, arenaStats.Allocations, arenaStats.OverflowAllocations);
+#if ENABLE_HEAP_TRACKING
+			ImGui::BulletText("Heap allocations last frame: %u", arenaStats.HeapAllocations);
+#else
+			ImGui::BulletText("Heap allocations last frame: not counted (ENABLE_HEAP_TRACKING is off)");
+#endif
+
+			const SimpleShaderUploadStats& uploadStats = ISimpleShader::GetLastFrameUploadStats();
+			ImGui::BulletText("Constant buffer uploads: %u (%u partial), %u skipped, %llu bytes",
+				uploadStats.Uploads, uploadStats.PartialUploads, uploadStats.SkippedUploads, uploadStats.BytesUploaded);
+
+			if (constantRing)
+			{
+				const ConstantRingStats& ringStats = constantRing->GetLastFrameStats();
+				ImGui::BulletText("Constant ring: %zu / %zu bytes, %u slices, %u frames in flight%s",
+					ringStats.BytesWritten, ringStats.Capacity, ringStats.Slices, ringStats.FramesInFlight,
+					ringStats.Skipped ? " (skipped, GPU behind)" :
+					ringStats.Overflowed ? " (ran out, growing)" : "");
+			}
+			else
+			{
+				ImGui::BulletText("Constant ring: off");
+			}
+
+			ResourceCacheStats cacheStats = resourceCache->GetStats();
+			ImGui::BulletText("Resource cache: %u textures (%u loading), %u samplers, %u evicted",
+				cacheStats.Textures, cacheStats.PendingLoads, cacheStats.Samplers, cacheStats.Evictions);
+			ImGui::BulletText("Resource memory: %.1f MB GPU, %.0f MB budget",
+				cacheStats.GPUBytes / (1024.0f * 1024.0f), cacheStats.Budget / (1024.0f * 1024.0f));
+			const TextureResidencyStats& streamStats = textureStreamer->GetResidency().GetStats();
+			ImGui::BulletText("Streamed textures: %.1f / %.0f MB, %u of %u requested (%u waiting on mips)",
+				streamStats.ResidentBytes / (1024.0f * 1024.0f), streamStats.Budget / (1024.0f * 1024.0f),
+				streamStats.Requested, streamStats.Textures, streamStats.Starved);
+			ImGui::BulletText("Streaming this frame: %u mips in (%.2f MB), %u out",
+				streamStats.Loads, streamStats.LoadedBytes / (1024.0f * 1024.0f), streamStats.Evictions);
+			if (ImGui::TreeNode("Streamed Textures"))
+			{
+				for (const std::shared_ptr<StreamedTexture>& texture : textureStreamer->GetTextures())
+				{
+					size_t slash = texture->Path.find_last_of(L'\\');
+					std::wstring name = slash == std::wstring::npos ? texture->Path : texture->Path.substr(slash + 1);
+					ImGui::BulletText("%ls: mip %u (%ux%u), %.2f MB GPU, %.2f MB CPU", name.c_str(), texture->ResidentMip,
+						max(1u, texture->Width >> texture->ResidentMip), max(1u, texture->Height >> texture->ResidentMip),
+						texture->GPUBytes / (1024.0f * 1024.0f), texture->CPUBytes / (1024.0f * 1024.0f));
+				}
+				ImGui::TreePop();
+			}
+			if (ImGui::TreeNode("Cached Textures"))
+			{
+				for (std::shared_ptr<CachedTexture>& texture : resourceCache->GetTextures())
+				{
+					size_t slash = texture->Path.find_last_of(L'\\');
+					std::wstring name = slash == std::wstring::npos ? texture->Path : texture->Path.substr(slash + 1);
+					ImGui::BulletText("%ls: %.2f MB GPU%s", name.c_str(),
+						texture->GPUBytes / (1024.0f * 1024.0f),
+						texture->Failed ? " (failed)" : texture->IsReady() ? "" : " (loading)");
+				}
+				ImGui::TreePop();
+			}
 		}
 		if (ImGui::CollapsingHeader("Camera")) {
 			XMFLOAT3 cameraPos = camera->GetTransform()->GetPosition();
@@ -708,8 +900,7 @@ void Game::Update(float deltaTime, float totalTime)
 				XMFLOAT3 rotation = entities[i].get()->GetTransform()->GetPitchYawRoll();
 				XMFLOAT3 scale = entities[i].get()->GetTransform()->GetScale();
 
-				std::string name = "Entity " + std::to_string(i);
-				if (ImGui::TreeNode(name.c_str())) {
+				if (ImGui::TreeNode(FrameArena::GetInstance().Format("Entity %d", i))) {
 					if (ImGui::DragFloat3("Position", &position.x, 0.25f)) {
 						entities[i]->GetTransform()->SetPosition(position.x, position.y, position.z);
 					}
@@ -729,6 +920,10 @@ void Game::Update(float deltaTime, float totalTime)
 			if(ImGui::Button("Randomize Lights")) for(int i=0; i<lightCount; i++)lights[i].Position = XMFLOAT3(RandomRange(-10.0f, 10.0f), RandomRange(-5.0f, 5.0f), RandomRange(-10.0f, 10.0f));
 		}
 
+		if (sky->IsProcedural() && ImGui::CollapsingHeader("Procedural Sky")) {
+			DrawProceduralSkyUI();
+		}
+
 		if (ImGui::CollapsingHeader("IBL Textures")) {
 			ImGui::Image(sky->GetBRDFLookUpTexture().Get(), ImVec2(200,200));
 			ImGui::Image(FlatNormalMapTest.Get(), ImVec2(200, 200));
@@ -760,15 +955,17 @@ void Game::Update(float deltaTime, float totalTime)
 		}
 
 		ImGui::End();
+
+		if (profilerWindowOpen)
+			Profiler::GetInstance().DrawImGuiWindow(GetFullPathTo("FrameTrace.json").c_str(), &profilerWindowOpen);
 	}
 	
 
-	// Update the camera
-	camera->Update(deltaTime);
+	UpdateProceduralSky(deltaTime);
 
-	for (auto& emitter : emitters) {
-		emitter->Update(deltaTime, totalTime);
-	}
+	// Mouse look is scaled by the step length, so it feels the
+	// same no matter the frame rate or tick rate
+	camera->UpdateLook(1.0f / GetTickRate());
 
 	if (input.KeyDown(VK_ESCAPE)) Quit();
 	if (input.KeyPress(VK_TAB)) GenerateLights();
@@ -778,73 +975,164 @@ void Game::Update(float deltaTime, float totalTime)
 	}
 }
 
+// --------------------------------------------------------
+// Update your game here - move objects, AI, etc.  This runs
+// at the fixed simulation rate, so deltaTime is constant.
+// --------------------------------------------------------
+void Game::Update(float deltaTime, float totalTime)
+{
+	PROFILE_ZONE("Game::Update");
+
+	// Update the camera
+	{
+		PROFILE_ZONE("Camera");
+		camera->Update(deltaTime);
+	}
+
+	{
+		PROFILE_ZONE("Emitters");
+		for (auto& emitter : emitters) {
+			emitter->Update(deltaTime, totalTime);
+		}
+	}
+}
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
 
 void Game::Draw(float deltaTime, float totalTime)
 {
-	renderer->Render(camera, totalTime);
+	// Render between the last two simulation steps
+	camera->Interpolate(GetInterpolationAlpha());
+
+	resourceCache->Update();
+	UpdateTextureStreaming();
+	sky->UpdateProcedural(skyUpdateBudgetMs);
+	if (constantRing) constantRing->BeginFrame();
+
+	// The emitters' buffers hold the latest step, so they're
+	// drawn at its time; the interpolated time is earlier,
+	// which would make the newest particles younger than 0
+	renderer->Render(camera, GetSimulationTime());
 	DrawUI();
+
+	if (constantRing) constantRing->EndFrame();
 }
 
 
 // --------------------------------------------------------
-// Draws the point lights as solid color spheres
+// Moves a procedural sky's sun with the time of day, asking
+// for a new bake whenever it has moved, and points the main
+// light and the light rays along it
 // --------------------------------------------------------
-void Game::DrawPointLights()
+void Game::UpdateProceduralSky(float deltaTime)
 {
-	// Turn on these shaders
-	lightVS->SetShader();
-	lightPS->SetShader();
+	if (!sky->IsProcedural())
+		return;
 
-	// Set up vertex shader
-	lightVS->SetMatrix4x4("view", camera->GetView());
-	lightVS->SetMatrix4x4("projection", camera->GetProjection());
+	timeOfDay = fmodf(timeOfDay + timeOfDaySpeed * deltaTime, 24.0f);
 
-	for (int i = 0; i < lightCount; i++)
+	float sun[3];
+	GetSunDirectionAtTime(timeOfDay, sunMaxElevation, sun);
+	ProceduralSkySettings settings = sky->GetProceduralSettings();
+	if (memcmp(sun, settings.SunDirection, sizeof(sun)) != 0)
 	{
-		Light light = lights[i];
-
-		// Only drawing points, so skip others
-		if (light.Type != LIGHT_TYPE_POINT)
-			continue;
-
-		// Calc quick scale based on range
-		float scale = light.Range / 20.0f;
-
-		// Make the transform for this light
-		XMMATRIX rotMat = XMMatrixIdentity();
-		XMMATRIX scaleMat = XMMatrixScaling(scale, scale, scale);
-		XMMATRIX transMat = XMMatrixTranslation(light.Position.x, light.Position.y, light.Position.z);
-		XMMATRIX worldMat = scaleMat * rotMat * transMat;
-
-		XMFLOAT4X4 world;
-		XMFLOAT4X4 worldInvTrans;
-		XMStoreFloat4x4(&world, worldMat);
-		XMStoreFloat4x4(&worldInvTrans, XMMatrixInverse(0, XMMatrixTranspose(worldMat)));
-
-		// Set up the world matrix for this light
-		lightVS->SetMatrix4x4("world", world);
-		lightVS->SetMatrix4x4("worldInverseTranspose", worldInvTrans);
-
-		// Set up the pixel shader data
-		XMFLOAT3 finalColor = light.Color;
-		finalColor.x *= light.Intensity;
-		finalColor.y *= light.Intensity;
-		finalColor.z *= light.Intensity;
-		lightPS->SetFloat3("Color", finalColor);
-
-		// Copy data
-		lightVS->CopyAllBufferData();
-		lightPS->CopyAllBufferData();
-
-		// Draw
-		lightMesh->SetBuffersAndDraw(context);
+		memcpy(settings.SunDirection, sun, sizeof(sun));
+		sky->SetProceduralSettings(settings);
 	}
 
+	renderer->SunDirection = XMFLOAT3(sun[0], sun[1], sun[2]);
+	lights[0].Direction = XMFLOAT3(-sun[0], -sun[1], -sun[2]);
+}
+
+// --------------------------------------------------------
+// Time of day and haze controls, and how the re-bakes are
+// keeping to their budget
+// --------------------------------------------------------
+void Game::DrawProceduralSkyUI()
+{
+	ImGui::SliderFloat("Time of Day", &timeOfDay, 0.0f, 24.0f);
+	ImGui::SliderFloat("Hours per Second", &timeOfDaySpeed, 0.0f, 2.0f);
+	ImGui::SliderFloat("Sun Elevation at Noon", &sunMaxElevation, 5.0f, 90.0f);
+
+	ProceduralSkySettings settings = sky->GetProceduralSettings();
+	bool changed = ImGui::SliderFloat("Turbidity", &settings.Turbidity, 2.0f, 10.0f);
+	changed |= ImGui::SliderFloat("Exposure", &settings.Exposure, 0.01f, 0.2f);
+	if (changed)
+		sky->SetProceduralSettings(settings);
+
+	ImGui::SliderFloat("Budget (ms)", &skyUpdateBudgetMs, 0.1f, 8.0f);
+
+	const ProceduralSkyBaker* baker = sky->GetProceduralBaker();
+	const ProceduralSkyStats& stats = baker->GetStats();
+	ImGui::ProgressBar(baker->GetProgress());
+	ImGui::BulletText("Bakes: %llu (last over %u frames, %.1f ms)", (unsigned long long)stats.CompletedBakes, stats.LastBakeUpdates, stats.LastBakeMs);
+	ImGui::BulletText("Last frame: %.3f ms | Max: %.3f ms", stats.LastUpdateMs, stats.MaxUpdateMs);
+	ImGui::BulletText("Over budget: %llu of %llu frames (worst +%.3f ms)", (unsigned long long)stats.OverBudgetUpdates, (unsigned long long)stats.Updates, stats.MaxOverrunMs);
+}
+
+// --------------------------------------------------------
+// Streams name_orm.dds, packed from a material's roughness
+// and metal maps (files in Assets/Textures).  It's repacked
+// first if they've changed since, on the streamer's
+// decoding thread rather than here.
+// --------------------------------------------------------
+std::shared_ptr<StreamedTexture> Game::LoadPackedORM(const std::string& name, const std::string& roughnessFile, const std::string& metalFile, bool compress)
+{
+	TexturePacker::ImageDecoder decoder = [](const unsigned char* data, size_t size, PackSourceImage& image)
+	{
+		TextureLoadOptions options;
+		options.IgnoreSRGB = true;
+		options.GenerateMips = false;
+		std::shared_ptr<TextureStreamer::TextureData> decoded = TextureStreamer::DecodeImage(data, size, options);
+		if (!decoded)
+			return false;
+
+		image.Width = decoded->Width;
+		image.Height = decoded->Height;
+		image.RGBA = std::move(decoded->Mips[0]);
+		return true;
+	};
+
+	std::string folder = GetFullPathTo("../../Assets/Textures/");
+	std::string outputPath = folder + name + "_orm.dds";
+	auto build = [=]()
+	{
+		if (TexturePacker::BuildORM("", folder + roughnessFile, folder + metalFile, outputPath, decoder, compress) == TEXTURE_PACK_FAILED)
+			printf("Could not pack %s\n", outputPath.c_str());
+	};
+
+	// Asset paths are plain ASCII
+	return textureStreamer->LoadGenerated(std::wstring(outputPath.begin(), outputPath.end()), build);
 }
 
+// --------------------------------------------------------
+// Asks the streamer for each material's textures at the
+// detail its closest entity needs on screen
+// --------------------------------------------------------
+void Game::UpdateTextureStreaming()
+{
+	XMFLOAT3 cameraPos = camera->GetViewPosition();
+	float projectionScale = camera->GetProjection()._22;
+
+	textureStreamer->BeginFrame();
+	for (auto& e : entities)
+	{
+		std::shared_ptr<Material> material = e->GetMaterial();
+		XMFLOAT3 pos = e->GetTransform()->GetPosition();
+		XMFLOAT3 scale = e->GetTransform()->GetScale();
+		float radius = e->GetMesh()->GetBoundsRadius() * max(max(fabsf(scale.x), fabsf(scale.y)), fabsf(scale.z));
+
+		XMFLOAT3 toEntity(pos.x - cameraPos.x, pos.y - cameraPos.y, pos.z - cameraPos.z);
+		float distance = sqrtf(toEntity.x * toEntity.x + toEntity.y * toEntity.y + toEntity.z * toEntity.z) - radius;
+
+		XMFLOAT2 uvScale = material->GetUVScale();
+		float texels = TextureResidency::CalculateRequiredTexels(radius * 2, max(uvScale.x, uvScale.y), distance, projectionScale, (float)height);
+		textureStreamer->RequestMaterial(material.get(), texels);
+	}
+	textureStreamer->Update();
+}
 
 // --------------------------------------------------------
 // Draws a simple informational "UI" using sprite batch
@@ -11,6 +11,9 @@
 #include "Sky.h"
 #include "Renderer.h"
 #include "Emitter.h"
+#include "ConstantRing.h"
+#include "ResourceCache.h"
+#include "TextureStreamer.h"
 
 
 #include <DirectXMath.h>
@@ -29,6 +32,7 @@ public:
 	// will be called automatically
 	void Init();
 	void OnResize();
+	void FrameUpdate(float deltaTime, float totalTime);
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 	bool lightsOn = true;
@@ -44,6 +48,7 @@ private:
 	int lightCount;
 
 	bool guiActive;
+	bool profilerWindowOpen;
 
 	// These will be loaded along with other assets and
 	// saved to these variables for ease of access
@@ -59,6 +64,10 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerOptions;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> clampSampler;
 
+	// Handles to cached textures used outside of materials,
+	// which keep the cache from evicting them
+	std::shared_ptr<CachedTexture> flatNormalMap;
+	std::shared_ptr<CachedTexture> snowTexture, smokeTexture, traceTexture;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> FlatNormalMapTest;
 
 	std::shared_ptr<SimplePixelShader> pixelShaderPBR;
@@ -79,9 +88,18 @@ private:
 	// Skybox
 	std::shared_ptr<Sky> sky;
 
+	// A procedural sky (-proceduralsky) follows the time of
+	// day, re-baking within a budget of milliseconds per frame
+	// (-skybudget)
+	float timeOfDay = 10.0f;
+	float timeOfDaySpeed = 0.0f;	// Hours per second
+	float sunMaxElevation = 60.0f;	// Degrees at noon
+	float skyUpdateBudgetMs = 2.0f;
+	void UpdateProceduralSky(float deltaTime);
+	void DrawProceduralSkyUI();
+
 	// General helpers for setup and drawing
 	void GenerateLights();
-	void DrawPointLights();
 	void DrawUI();
 
 	// Initialization helper method
@@ -89,6 +107,17 @@ private:
 
 	Renderer* renderer;
 
+	// Per-draw constant data, if D3D 11.1 allows it
+	std::shared_ptr<ConstantRing> constantRing;
+
+	// Textures and samplers, each loaded once
+	std::shared_ptr<ResourceCache> resourceCache;
+
+	// Material textures, with mips streamed by screen size
+	std::shared_ptr<TextureStreamer> textureStreamer;
+	void UpdateTextureStreaming();
+	std::shared_ptr<StreamedTexture> LoadPackedORM(const std::string& name, const std::string& roughnessFile, const std::string& metalFile, bool compress);
+
 	std::vector<std::shared_ptr<Emitter>>emitters;
 	std::shared_ptr<SimpleVertexShader> particleVS;
 	std::shared_ptr<SimplePixelShader> particlePS;
@@ -0,0 +1,244 @@
+#include "HDRDecoder.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <math.h>
+#include <string>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define HDR_DECODER_SSE2 1
+#include <emmintrin.h>
+#else
+#define HDR_DECODER_SSE2 0
+#endif
+
+// Run length encoded rows are only used for widths in this
+// range; anything else is always flat
+static const unsigned int MinEncodedWidth = 8;
+static const unsigned int MaxEncodedWidth = 0x7FFF;
+
+// Far beyond any real file's dimensions, to refuse sizes
+// that would overflow before anything is allocated
+static const unsigned int MaxDimension = 1 << 16;
+
+// --------------------------------------------------------
+// Reads one header line (without its newline) and moves
+// past it.  False at the end of the data.
+// --------------------------------------------------------
+static bool ReadLine(const unsigned char*& at, const unsigned char* end, std::string& line)
+{
+	const unsigned char* newline = (const unsigned char*)memchr(at, '\n', end - at);
+	if (!newline)
+		return false;
+
+	line.assign((const char*)at, newline - at);
+	if (!line.empty() && line.back() == '\r')
+		line.pop_back();
+	at = newline + 1;
+	return true;
+}
+
+// --------------------------------------------------------
+// Parses "-Y height +X width", the top to bottom, left to
+// right order every common tool writes
+// --------------------------------------------------------
+static bool ParseResolution(const std::string& line, unsigned int& width, unsigned int& height)
+{
+	const char* text = line.c_str();
+	if (strncmp(text, "-Y ", 3) != 0)
+		return false;
+
+	char* after;
+	unsigned long h = strtoul(text + 3, &after, 10);
+	if (after == text + 3 || strncmp(after, " +X ", 4) != 0)
+		return false;
+
+	const char* widthText = after + 4;
+	unsigned long w = strtoul(widthText, &after, 10);
+	if (after == widthText || *after != '\0')
+		return false;
+
+	if (w == 0 || h == 0 || w > MaxDimension || h > MaxDimension)
+		return false;
+	width = (unsigned int)w;
+	height = (unsigned int)h;
+	return true;
+}
+
+// --------------------------------------------------------
+// A row of 4 bytes per pixel, either flat or with the old
+// encoding's (1, 1, 1, count) pixels repeating the one
+// before, consecutive ones making the count's higher bytes
+// --------------------------------------------------------
+static bool DecodeFlatRow(const unsigned char*& at, const unsigned char* end, unsigned char* row, unsigned int width)
+{
+	unsigned int x = 0;
+	unsigned int shift = 0;
+	while (x < width)
+	{
+		if (end - at < 4)
+			return false;
+
+		if (at[0] == 1 && at[1] == 1 && at[2] == 1)
+		{
+			if (x == 0 || shift > 16)
+				return false;
+			unsigned int count = (unsigned int)at[3] << shift;
+			if (count > width - x)
+				return false;
+			for (unsigned int i = 0; i < count; i++, x++)
+				memcpy(row + x * 4, row + (x - 1) * 4, 4);
+			shift += 8;
+		}
+		else
+		{
+			memcpy(row + x * 4, at, 4);
+			x++;
+			shift = 0;
+		}
+		at += 4;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Interleaves a row's 4 channel planes into RGBE pixels
+// --------------------------------------------------------
+static void InterleaveRow(const unsigned char* planes, unsigned char* row, unsigned int width)
+{
+	const unsigned char* r = planes;
+	const unsigned char* g = planes + width;
+	const unsigned char* b = planes + width * 2;
+	const unsigned char* e = planes + width * 3;
+	unsigned int x = 0;
+
+#if HDR_DECODER_SSE2
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i rs = _mm_loadu_si128((const __m128i*)(r + x));
+		__m128i gs = _mm_loadu_si128((const __m128i*)(g + x));
+		__m128i bs = _mm_loadu_si128((const __m128i*)(b + x));
+		__m128i es = _mm_loadu_si128((const __m128i*)(e + x));
+		__m128i rgLow = _mm_unpacklo_epi8(rs, gs);
+		__m128i rgHigh = _mm_unpackhi_epi8(rs, gs);
+		__m128i beLow = _mm_unpacklo_epi8(bs, es);
+		__m128i beHigh = _mm_unpackhi_epi8(bs, es);
+		unsigned char* out = row + x * 4;
+		_mm_storeu_si128((__m128i*)(out + 0), _mm_unpacklo_epi16(rgLow, beLow));
+		_mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi16(rgLow, beLow));
+		_mm_storeu_si128((__m128i*)(out + 32), _mm_unpacklo_epi16(rgHigh, beHigh));
+		_mm_storeu_si128((__m128i*)(out + 48), _mm_unpackhi_epi16(rgHigh, beHigh));
+	}
+#endif
+
+	for (; x < width; x++)
+	{
+		row[x * 4 + 0] = r[x];
+		row[x * 4 + 1] = g[x];
+		row[x * 4 + 2] = b[x];
+		row[x * 4 + 3] = e[x];
+	}
+}
+
+// --------------------------------------------------------
+// A run length encoded row: each channel in turn as runs
+// (a count over 128, then the byte to repeat) and literals
+// (a count, then that many bytes), decoded into planes
+// --------------------------------------------------------
+static bool DecodeEncodedRow(const unsigned char*& at, const unsigned char* end, unsigned char* planes, unsigned int width)
+{
+	for (unsigned int channel = 0; channel < 4; channel++)
+	{
+		unsigned char* plane = planes + channel * width;
+		unsigned int x = 0;
+		while (x < width)
+		{
+			if (at >= end)
+				return false;
+
+			unsigned int count = *at++;
+			if (count > 128)
+			{
+				count -= 128;
+				if (count > width - x || at >= end)
+					return false;
+				memset(plane + x, *at++, count);
+			}
+			else
+			{
+				if (count == 0 || count > width - x || (size_t)(end - at) < count)
+					return false;
+				memcpy(plane + x, at, count);
+				at += count;
+			}
+			x += count;
+		}
+	}
+	return true;
+}
+
+bool DecodeHDR(const unsigned char* data, size_t size, HDRImage& image)
+{
+	image = HDRImage();
+	const unsigned char* at = data;
+	const unsigned char* end = data + size;
+
+	std::string line;
+	if (!ReadLine(at, end, line) || (line != "#?RADIANCE" && line != "#?RGBE"))
+		return false;
+
+	// Variables up to a blank line, then the resolution
+	while (true)
+	{
+		if (!ReadLine(at, end, line))
+			return false;
+		if (line.empty())
+			break;
+		if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe")
+			return false;
+	}
+
+	unsigned int width, height;
+	if (!ReadLine(at, end, line) || !ParseResolution(line, width, height))
+		return false;
+
+	// Every row takes at least 4 bytes, however it's stored
+	if ((size_t)(end - at) / 4 < height)
+		return false;
+
+	std::vector<unsigned char> pixels((size_t)width * height * 4);
+	std::vector<unsigned char> planes((size_t)width * 4);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		unsigned char* row = &pixels[(size_t)y * width * 4];
+		bool encoded = width >= MinEncodedWidth && width <= MaxEncodedWidth &&
+			end - at >= 4 && at[0] == 2 && at[1] == 2 && (at[2] & 0x80) == 0;
+		if (encoded)
+		{
+			if (((unsigned int)at[2] << 8 | at[3]) != width)
+				return false;
+			at += 4;
+			if (!DecodeEncodedRow(at, end, planes.data(), width))
+				return false;
+			InterleaveRow(planes.data(), row, width);
+		}
+		else if (!DecodeFlatRow(at, end, row, width))
+		{
+			return false;
+		}
+	}
+
+	image.Width = width;
+	image.Height = height;
+	image.RGBE.swap(pixels);
+	return true;
+}
+
+void DecodeRGBE(const unsigned char rgbe[4], float rgb[3])
+{
+	float scale = rgbe[3] ? ldexpf(1.0f, (int)rgbe[3] - (128 + 8)) : 0.0f;
+	rgb[0] = rgbe[0] * scale;
+	rgb[1] = rgbe[1] * scale;
+	rgb[2] = rgbe[2] * scale;
+}
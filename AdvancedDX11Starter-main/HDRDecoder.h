@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// A decoded Radiance HDR image, still as RGBE: a shared
+// exponent byte after 8 bit red, green and blue mantissas,
+// 4 bytes per pixel with no row padding.  Kept that way
+// rather than expanded to floats, which would triple the
+// size of an 8K sky.
+// --------------------------------------------------------
+struct HDRImage
+{
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	std::vector<unsigned char> RGBE;
+};
+
+// --------------------------------------------------------
+// Decodes Radiance .hdr files (Greg Ward's RGBE format):
+// flat scanlines, the old repeat-pixel encoding and the
+// usual run length encoding, where each channel of a row
+// is stored separately.  Only the standard -Y H +X W
+// orientation is read, and XYZE pixels are refused.
+// --------------------------------------------------------
+bool DecodeHDR(const unsigned char* data, size_t size, HDRImage& image);
+
+// One RGBE pixel as linear RGB
+void DecodeRGBE(const unsigned char rgbe[4], float rgb[3]);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// 64 bit FNV-1a.  Not cryptographic - just a quick way to
+// tell whether a file has changed since something was
+// cached from it.  Pass a previous result as "hash" to
+// continue hashing across several pieces of data.
+// --------------------------------------------------------
+static const uint64_t HashFNV1aOffset = 0xcbf29ce484222325ull;
+
+inline uint64_t HashFNV1a(const void* data, size_t size, uint64_t hash = HashFNV1aOffset)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
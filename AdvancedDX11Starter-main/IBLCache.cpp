@@ -0,0 +1,139 @@
+#include "IBLCache.h"
+
+// Layout of the binary form, all little endian:
+//
+//  Header   - magic, version, source hash (64 bit)
+//  Textures - irradiance, specular and BRDF look up, each
+//             DXGI format, bytes per texel, width, height,
+//             array size and mip levels
+//  Pixels   - each texture's subresources in the same order,
+//             back to back
+//
+// Every field other than the hash is 32 bits.
+static const uint32_t CacheMagic = 0x434C4249; // "IBLC"
+static const size_t HeaderSize = 2 * 4 + 8;
+static const size_t TextureRecordSize = 6 * 4;
+static const int TextureCount = 3;
+
+// Keeps a bad file from asking for absurd allocations
+static const uint32_t MaxTextureSize = 16384;
+static const uint32_t MaxBytesPerTexel = 16;
+
+size_t IBLCacheTexture::GetRowPitch(uint32_t mip) const
+{
+	uint32_t width = Width >> mip;
+	return (size_t)(width > 0 ? width : 1) * BytesPerTexel;
+}
+
+size_t IBLCacheTexture::GetSubresourceSize(uint32_t mip) const
+{
+	uint32_t height = Height >> mip;
+	return GetRowPitch(mip) * (height > 0 ? height : 1);
+}
+
+static void Write32(std::vector<unsigned char>& out, uint32_t value)
+{
+	unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+	out.insert(out.end(), bytes, bytes + 4);
+}
+
+static uint32_t Read32(const unsigned char* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void IBLCache::Serialize(std::vector<unsigned char>& out) const
+{
+	const IBLCacheTexture* textures[TextureCount] = { &Irradiance, &Specular, &BRDFLookUp };
+
+	size_t pixelBytes = 0;
+	for (const IBLCacheTexture* t : textures)
+	{
+		for (size_t i = 0; i < t->Subresources.size(); i++)
+			pixelBytes += t->GetSubresourceSize((uint32_t)(i % t->MipLevels));
+	}
+
+	out.clear();
+	out.reserve(HeaderSize + TextureCount * TextureRecordSize + pixelBytes);
+	Write32(out, CacheMagic);
+	Write32(out, Version);
+	Write32(out, (uint32_t)SourceHash);
+	Write32(out, (uint32_t)(SourceHash >> 32));
+
+	for (const IBLCacheTexture* t : textures)
+	{
+		Write32(out, t->DXGIFormat);
+		Write32(out, t->BytesPerTexel);
+		Write32(out, t->Width);
+		Write32(out, t->Height);
+		Write32(out, t->ArraySize);
+		Write32(out, t->MipLevels);
+	}
+
+	for (const IBLCacheTexture* t : textures)
+	{
+		for (size_t i = 0; i < t->Subresources.size(); i++)
+		{
+			const unsigned char* pixels = t->Subresources[i];
+			out.insert(out.end(), pixels, pixels + t->GetSubresourceSize((uint32_t)(i % t->MipLevels)));
+		}
+	}
+}
+
+bool IBLCache::Parse(const unsigned char* data, size_t size, uint64_t expectedSourceHash)
+{
+	if (size < HeaderSize + TextureCount * TextureRecordSize ||
+		Read32(data) != CacheMagic ||
+		Read32(data + 4) != Version ||
+		((uint64_t)Read32(data + 8) | ((uint64_t)Read32(data + 12) << 32)) != expectedSourceHash)
+		return false;
+	SourceHash = expectedSourceHash;
+
+	IBLCacheTexture* textures[TextureCount] = { &Irradiance, &Specular, &BRDFLookUp };
+	const unsigned char* record = data + HeaderSize;
+	for (IBLCacheTexture* t : textures)
+	{
+		t->DXGIFormat = Read32(record);
+		t->BytesPerTexel = Read32(record + 4);
+		t->Width = Read32(record + 8);
+		t->Height = Read32(record + 12);
+		t->ArraySize = Read32(record + 16);
+		t->MipLevels = Read32(record + 20);
+		record += TextureRecordSize;
+
+		if (t->BytesPerTexel == 0 || t->BytesPerTexel > MaxBytesPerTexel ||
+			t->Width == 0 || t->Width > MaxTextureSize ||
+			t->Height == 0 || t->Height > MaxTextureSize ||
+			t->ArraySize == 0 || t->ArraySize > 6)
+			return false;
+
+		// Enough mips to reach 1x1 at most
+		uint32_t largest = t->Width > t->Height ? t->Width : t->Height;
+		uint32_t maxMips = 1;
+		while ((largest >> maxMips) > 0)
+			maxMips++;
+		if (t->MipLevels == 0 || t->MipLevels > maxMips)
+			return false;
+	}
+
+	// The pixels have to account for the rest exactly
+	const unsigned char* pixels = record;
+	size_t remaining = size - (record - data);
+	for (IBLCacheTexture* t : textures)
+	{
+		t->Subresources.clear();
+		for (uint32_t slice = 0; slice < t->ArraySize; slice++)
+		{
+			for (uint32_t mip = 0; mip < t->MipLevels; mip++)
+			{
+				size_t bytes = t->GetSubresourceSize(mip);
+				if (bytes > remaining)
+					return false;
+				t->Subresources.push_back(pixels);
+				pixels += bytes;
+				remaining -= bytes;
+			}
+		}
+	}
+	return remaining == 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// One texture's description and pixels.  The pixels aren't
+// owned: they point into whatever the cache was parsed
+// from, or whatever is being serialized.
+// --------------------------------------------------------
+struct IBLCacheTexture
+{
+	uint32_t DXGIFormat = 0;
+	uint32_t BytesPerTexel = 0;
+	uint32_t Width = 0;			// Of the top mip
+	uint32_t Height = 0;
+	uint32_t ArraySize = 1;		// 6 for cubes
+	uint32_t MipLevels = 1;
+
+	// In D3D subresource order (every mip of the first array
+	// slice, then the next), rows tightly packed
+	std::vector<const unsigned char*> Subresources;
+
+	size_t GetRowPitch(uint32_t mip) const;
+	size_t GetSubresourceSize(uint32_t mip) const;
+};
+
+// --------------------------------------------------------
+// Everything the sky precomputes for image based lighting,
+// in a binary file that can be mapped and handed straight
+// to CreateTexture2D() as initial data.  Like the shader
+// metadata cache, it records a hash of everything it was
+// built from and is ignored if that or the format version
+// doesn't match.
+// --------------------------------------------------------
+struct IBLCache
+{
+	// Bump whenever the layout or how the maps are made changes
+	static const uint32_t Version = 4;
+
+	uint64_t SourceHash = 0;
+	IBLCacheTexture Irradiance;
+	IBLCacheTexture Specular;
+	IBLCacheTexture BRDFLookUp;
+
+	void Serialize(std::vector<unsigned char>& out) const;
+
+	// Checks every size against the data, and points the
+	// textures' subresources into it.  False for anything
+	// malformed, outdated or built from another sky.
+	bool Parse(const unsigned char* data, size_t size, uint64_t expectedSourceHash);
+};
@@ -57,5 +57,5 @@ float4 main(VertexToPixel input) : SV_TARGET
 	}
 	}
 	float3 finalColor = PI * totalColor / sampleCount;
-	return float4(pow(abs(finalColor), 1.0f / 2.2f), 1);
+	return float4(finalColor, 1); // Linear for the HDR target
 }
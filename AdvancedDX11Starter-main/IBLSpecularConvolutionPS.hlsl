@@ -42,8 +42,8 @@ float3 ConvolveTextureCube(float roughness, float3 R)
 			totalWeight += nDotL;
 		}
 	}
-	// Divide and return result
-	return pow(abs(finalColor / totalWeight), 1.0f / 2.2f); // Using abs() to stop a compiler warning
+	// Divide and return result, linear for the HDR target
+	return finalColor / totalWeight;
 }
 float4 main(VertexToPixel input) : SV_TARGET
 {
@@ -117,6 +117,45 @@ void Input::Update()
 	mouseYDelta = mouseY - prevMouseY;
 }
 
+// ----------------------------------------------------------
+//  Copies this frame's input (as gathered by Update()) into
+//  a frame record, for the input recorder.  Only the "down"
+//  bit of each key is kept, as that's all we ever check.
+// ----------------------------------------------------------
+void Input::CaptureFrame(InputFrame* frame)
+{
+	memset(frame->KeysDown, 0, sizeof(frame->KeysDown));
+	for (int i = 0; i < 256; i++)
+		frame->SetKeyDown(i, (kbState[i] & 0x80) != 0);
+
+	frame->MouseX = mouseX;
+	frame->MouseY = mouseY;
+	frame->WheelDelta = wheelDelta;
+}
+
+// ----------------------------------------------------------
+//  Updates the input manager from a recorded frame rather
+//  than the OS.  Used in place of Update() during playback.
+// ----------------------------------------------------------
+void Input::UpdateFromFrame(const InputFrame& frame)
+{
+	// Copy the old keys so we have last frame's data
+	memcpy(prevKbState, kbState, sizeof(unsigned char) * 256);
+
+	for (int i = 0; i < 256; i++)
+		kbState[i] = frame.IsKeyDown(i) ? 0x80 : 0;
+
+	prevMouseX = mouseX;
+	prevMouseY = mouseY;
+	mouseX = frame.MouseX;
+	mouseY = frame.MouseY;
+	mouseXDelta = mouseX - prevMouseX;
+	mouseYDelta = mouseY - prevMouseY;
+
+	// Overrides anything the real wheel did this frame
+	wheelDelta = frame.WheelDelta;
+}
+
 // ----------------------------------------------------------
 //  Resets the mouse wheel value at the end of the frame.
 //  This cannot occur earlier in the frame, since the wheel
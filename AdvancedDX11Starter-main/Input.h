@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Windows.h>
+#include "InputRecorder.h"
 
 class Input
 {
@@ -33,6 +34,10 @@ public:
 	void Update();
 	void EndOfFrame();
 
+	// Recording and playback
+	void CaptureFrame(InputFrame* frame);
+	void UpdateFromFrame(const InputFrame& frame);
+
 	int GetMouseX();
 	int GetMouseY();
 	int GetMouseXDelta();
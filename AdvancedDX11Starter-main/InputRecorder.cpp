@@ -0,0 +1,280 @@
+#include "InputRecorder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string.h>
+
+// File header, written once at the start of a recording
+struct InputRecordingHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t RandomSeed;
+	uint32_t FrameCount;	// Filled in when recording stops
+	float TickRate;
+};
+
+static const char InputRecordingMagic[4] = { 'I', 'N', 'P', 'R' };
+static const uint32_t InputRecordingVersion = 1;
+
+// Per-frame flags, saying which optional fields follow
+enum InputFrameFlags : uint8_t
+{
+	FrameKeysChanged = 1 << 0,
+	FrameMouseMoved = 1 << 1,
+	FrameWheel = 1 << 2
+};
+
+InputRecorder::InputRecorder()
+{
+	recording = false;
+	playing = false;
+	ResetState();
+}
+
+InputRecorder::~InputRecorder()
+{
+	Stop();
+}
+
+void InputRecorder::ResetState()
+{
+	randomSeed = 0;
+	tickRate = 0;
+	frameCount = 0;
+	currentFrame = 0;
+	memset(&lastFrame, 0, sizeof(InputFrame));
+}
+
+// --------------------------------------------------------
+//  Creates a new recording, overwriting any existing file
+//
+//  randomSeed - Seed used for rand() this run, so playback
+//               can reproduce anything random
+//  tickRate   - Simulation rate, stored for reference
+// --------------------------------------------------------
+bool InputRecorder::StartRecording(const std::string& path, unsigned int randomSeed, float tickRate)
+{
+	Stop();
+	ResetState();
+
+	file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	this->randomSeed = randomSeed;
+	this->tickRate = tickRate;
+
+	InputRecordingHeader header = {};
+	memcpy(header.Magic, InputRecordingMagic, sizeof(header.Magic));
+	header.Version = InputRecordingVersion;
+	header.RandomSeed = randomSeed;
+	header.FrameCount = 0;
+	header.TickRate = tickRate;
+	file.write((const char*)&header, sizeof(header));
+
+	recording = true;
+	return true;
+}
+
+// --------------------------------------------------------
+//  Opens a recording for playback, validating its header
+// --------------------------------------------------------
+bool InputRecorder::StartPlayback(const std::string& path)
+{
+	Stop();
+	ResetState();
+
+	file.open(path, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	InputRecordingHeader header = {};
+	file.read((char*)&header, sizeof(header));
+	if (!file ||
+		memcmp(header.Magic, InputRecordingMagic, sizeof(header.Magic)) != 0 ||
+		header.Version != InputRecordingVersion)
+	{
+		file.close();
+		return false;
+	}
+
+	randomSeed = header.RandomSeed;
+	tickRate = header.TickRate;
+	frameCount = header.FrameCount;
+
+	playing = true;
+	return true;
+}
+
+// --------------------------------------------------------
+//  Finishes the current recording or playback.  Recordings
+//  get their frame count patched into the header.
+// --------------------------------------------------------
+void InputRecorder::Stop()
+{
+	if (recording)
+	{
+		file.seekp(offsetof(InputRecordingHeader, FrameCount));
+		uint32_t count = frameCount;
+		file.write((const char*)&count, sizeof(count));
+	}
+
+	if (file.is_open())
+		file.close();
+
+	recording = false;
+	playing = false;
+}
+
+// --------------------------------------------------------
+//  Appends one frame, only storing what changed
+// --------------------------------------------------------
+void InputRecorder::RecordFrame(const InputFrame& frame)
+{
+	if (!recording)
+		return;
+
+	uint8_t flags = 0;
+	if (frameCount == 0 || memcmp(frame.KeysDown, lastFrame.KeysDown, sizeof(frame.KeysDown)) != 0)
+		flags |= FrameKeysChanged;
+	if (frameCount == 0 || frame.MouseX != lastFrame.MouseX || frame.MouseY != lastFrame.MouseY)
+		flags |= FrameMouseMoved;
+	if (frame.WheelDelta != 0.0f)
+		flags |= FrameWheel;
+
+	file.write((const char*)&flags, sizeof(flags));
+	file.write((const char*)&frame.DeltaTime, sizeof(float));
+	file.write((const char*)&frame.TotalTime, sizeof(float));
+	if (flags & FrameKeysChanged)
+		file.write((const char*)frame.KeysDown, sizeof(frame.KeysDown));
+	if (flags & FrameMouseMoved)
+	{
+		int32_t mouse[2] = { frame.MouseX, frame.MouseY };
+		file.write((const char*)mouse, sizeof(mouse));
+	}
+	if (flags & FrameWheel)
+		file.write((const char*)&frame.WheelDelta, sizeof(float));
+
+	lastFrame = frame;
+	frameCount++;
+}
+
+// --------------------------------------------------------
+//  Reads the next frame, filling in unchanged fields from
+//  the previous one
+// --------------------------------------------------------
+bool InputRecorder::ReadFrame(InputFrame* frame)
+{
+	// A frame count of zero means the recording was never
+	// closed properly, so play until the data runs out
+	if (!playing || (frameCount > 0 && currentFrame >= frameCount))
+		return false;
+
+	uint8_t flags = 0;
+	InputFrame next = lastFrame;
+	file.read((char*)&flags, sizeof(flags));
+	file.read((char*)&next.DeltaTime, sizeof(float));
+	file.read((char*)&next.TotalTime, sizeof(float));
+	if (flags & FrameKeysChanged)
+		file.read((char*)next.KeysDown, sizeof(next.KeysDown));
+	if (flags & FrameMouseMoved)
+	{
+		int32_t mouse[2] = {};
+		file.read((char*)mouse, sizeof(mouse));
+		next.MouseX = mouse[0];
+		next.MouseY = mouse[1];
+	}
+	next.WheelDelta = 0.0f;
+	if (flags & FrameWheel)
+		file.read((char*)&next.WheelDelta, sizeof(float));
+
+	// A truncated file just ends the playback early
+	if (!file)
+		return false;
+
+	lastFrame = next;
+	*frame = next;
+	currentFrame++;
+	return true;
+}
+
+
+FrameTimeLog::FrameTimeLog()
+{
+	open = false;
+}
+
+FrameTimeLog::~FrameTimeLog()
+{
+	Close();
+}
+
+// --------------------------------------------------------
+//  Starts a log.  Nothing is written until Close(), so
+//  logging doesn't add file I/O to the frames it measures.
+// --------------------------------------------------------
+bool FrameTimeLog::Open(const std::string& path)
+{
+	Close();
+
+	// Make sure we'll be able to write it later
+	std::ofstream test(path, std::ios::out | std::ios::trunc);
+	if (!test.is_open())
+		return false;
+
+	this->path = path;
+	frameTimes.clear();
+	stepCounts.clear();
+	frameTimes.reserve(1 << 16);
+	stepCounts.reserve(1 << 16);
+	open = true;
+	return true;
+}
+
+void FrameTimeLog::AddFrame(float frameMilliseconds, unsigned int simulationSteps)
+{
+	if (!open)
+		return;
+
+	frameTimes.push_back(frameMilliseconds);
+	stepCounts.push_back(simulationSteps);
+}
+
+// --------------------------------------------------------
+//  Writes every frame as "frame,frame_ms,sim_steps" and
+//  a "<path>.summary.csv" with the distribution
+// --------------------------------------------------------
+void FrameTimeLog::Close()
+{
+	if (!open)
+		return;
+	open = false;
+
+	std::ofstream csv(path, std::ios::out | std::ios::trunc);
+	csv << "frame,frame_ms,sim_steps\n";
+	for (size_t i = 0; i < frameTimes.size(); i++)
+		csv << i << "," << frameTimes[i] << "," << stepCounts[i] << "\n";
+	csv.close();
+
+	if (frameTimes.empty())
+		return;
+
+	std::vector<float> sorted = frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&](double p) { return sorted[(size_t)(p * (sorted.size() - 1) + 0.5)]; };
+
+	double total = 0;
+	for (float t : sorted)
+		total += t;
+
+	std::ofstream summary(path + ".summary.csv", std::ios::out | std::ios::trunc);
+	summary << "metric,value\n";
+	summary << "frames," << sorted.size() << "\n";
+	summary << "mean_ms," << total / sorted.size() << "\n";
+	summary << "median_ms," << percentile(0.5) << "\n";
+	summary << "p95_ms," << percentile(0.95) << "\n";
+	summary << "p99_ms," << percentile(0.99) << "\n";
+	summary << "min_ms," << sorted.front() << "\n";
+	summary << "max_ms," << sorted.back() << "\n";
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Everything Input needs to reproduce one frame, plus the
+// frame's timing so the simulation steps identically
+struct InputFrame
+{
+	float DeltaTime;
+	float TotalTime;
+	int MouseX;
+	int MouseY;
+	float WheelDelta;
+	uint8_t KeysDown[32];	// One bit per virtual key code
+
+	bool IsKeyDown(int key) const { return (KeysDown[key >> 3] & (1 << (key & 7))) != 0; }
+	void SetKeyDown(int key, bool down)
+	{
+		if (down) KeysDown[key >> 3] |= (uint8_t)(1 << (key & 7));
+		else KeysDown[key >> 3] &= (uint8_t)~(1 << (key & 7));
+	}
+};
+
+// --------------------------------------------------------
+// Writes and reads input recordings.  The file is a small
+// header followed by one record per frame:
+//
+//  flags (1 byte), deltaTime, totalTime (floats)
+//  [key bits (32 bytes)]     if FrameKeysChanged
+//  [mouse x, y (int32s)]     if FrameMouseMoved
+//  [wheel delta (float)]     if FrameWheel
+//
+// so frames where nothing changes cost 9 bytes.
+// --------------------------------------------------------
+class InputRecorder
+{
+public:
+	InputRecorder();
+	~InputRecorder();
+
+	bool StartRecording(const std::string& path, unsigned int randomSeed, float tickRate);
+	bool StartPlayback(const std::string& path);
+	void Stop();
+
+	bool IsRecording() { return recording; }
+	bool IsPlaying() { return playing; }
+
+	// Recording
+	void RecordFrame(const InputFrame& frame);
+
+	// Playback - returns false once the recording runs out
+	bool ReadFrame(InputFrame* frame);
+
+	// From the header of the file being played back
+	unsigned int GetRandomSeed() { return randomSeed; }
+	float GetTickRate() { return tickRate; }
+	unsigned int GetFrameCount() { return frameCount; }
+	unsigned int GetCurrentFrame() { return currentFrame; }
+
+private:
+	std::fstream file;
+	bool recording;
+	bool playing;
+
+	unsigned int randomSeed;
+	float tickRate;
+	unsigned int frameCount;
+	unsigned int currentFrame;
+
+	// The previous frame, which the next one is stored relative to
+	InputFrame lastFrame;
+
+	void ResetState();
+};
+
+// --------------------------------------------------------
+// Per-frame timings for a run, written out as CSV along
+// with a summary (so runs can be compared) when finished
+// --------------------------------------------------------
+class FrameTimeLog
+{
+public:
+	FrameTimeLog();
+	~FrameTimeLog();
+
+	bool Open(const std::string& path);
+	bool IsOpen() { return open; }
+	void AddFrame(float frameMilliseconds, unsigned int simulationSteps);
+	void Close();
+
+private:
+	std::string path;
+	bool open;
+	std::vector<float> frameTimes;
+	std::vector<unsigned int> stepCounts;
+};
@@ -27,10 +27,12 @@ struct Light
 
 // === UTILITY FUNCTIONS ============================================
 
-// Basic sample and unpack
+// Basic sample and unpack.  Z is rebuilt from X and Y, so two
+// channel (BC5) normal maps work the same as full RGB ones.
 float3 SampleAndUnpackNormalMap(Texture2D map, SamplerState samp, float2 uv)
 {
-	return map.Sample(samp, uv).rgb * 2.0f - 1.0f;
+	float2 xy = map.Sample(samp, uv).rg * 2.0f - 1.0f;
+	return float3(xy, sqrt(saturate(1.0f - dot(xy, xy))));
 }
 
 // Handle converting tangent-space normal map to world space normal
@@ -323,9 +325,9 @@ float3 IndirectDiffuse(TextureCube irrMap, SamplerState samp, float3 direction)
 {
 	// Sample in the specified direction - the irradiance map
 	// is a pre-computed cube map which represents light
-	// coming into this pixel from a particular hemisphere
-	float3 diff = irrMap.SampleLevel(samp, direction, 0).rgb;
-	return pow(abs(diff), 2.2);
+	// coming into this pixel from a particular hemisphere,
+	// stored linear in an HDR format
+	return irrMap.SampleLevel(samp, direction, 0).rgb;
 }
 // Indirect specular (environment reflections)
 //
@@ -348,10 +350,10 @@ float3 IndirectSpecular(TextureCube envMap, int mips, Texture2D brdfLookUp, Samp
 	// Calculate half of the split-sum approx (this texture is not gamma-corrected, as it just holds raw data)
 	float2 indirectBRDF = brdfLookUp.Sample(samp, float2(NdotV, roughness)).rg;
 	float3 indSpecFresnel = specColor * indirectBRDF.x + indirectBRDF.y; // Spec color is f0
-	// Sample the convolved environment map (other half of split-sum)
+	// Sample the convolved environment map (other half of split-sum), already linear
 	float3 envSample = envMap.SampleLevel(samp, viewRefl, roughness * (mips - 1)).rgb;
 	// Adjust environment sample by fresnel
-	return pow(abs(envSample), 2.2) * indSpecFresnel;
+	return envSample * indSpecFresnel;
 }
 // === UTILITY FUNCTIONS for Indirect PBR Pre-Calculations ====================
 // 
@@ -38,6 +38,9 @@ int WINAPI WinMain(
 	hr = dxGame.InitDirectX();
 	if(FAILED(hr)) return hr;
 
+	// Options like -record, -replay and -frametimes
+	dxGame.SetCommandLine(lpCmdLine);
+
 	// Begin the message and game loop, and then return
 	// whatever we get back once the game loop is over
 	return dxGame.Run();
@@ -0,0 +1,200 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <functional>
+#include <string>
+#include <thread>
+
+MappedFile::MappedFile()
+	: data(0), size(0)
+#ifdef _WIN32
+	, file(INVALID_HANDLE_VALUE), mapping(0)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	return Map();
+}
+
+bool MappedFile::Open(const wchar_t* path)
+{
+	Close();
+	file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	return Map();
+}
+
+// --------------------------------------------------------
+// Maps the file that was just opened, cleaning up if any
+// step fails
+// --------------------------------------------------------
+bool MappedFile::Map()
+{
+	LARGE_INTEGER fileSize = {};
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping)
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+
+	data = 0;
+	size = 0;
+	mapping = 0;
+	file = INVALID_HANDLE_VALUE;
+}
+
+// --------------------------------------------------------
+// Writes and closes an open file, in chunks WriteFile()
+// can take
+// --------------------------------------------------------
+static bool WriteAndClose(HANDLE file, const void* data, size_t size)
+{
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	bool written = true;
+	while (written && size > 0)
+	{
+		DWORD chunk = (DWORD)(size < 0x40000000 ? size : 0x40000000);
+		DWORD chunkWritten = 0;
+		written = WriteFile(file, bytes, chunk, &chunkWritten, 0) && chunkWritten == chunk;
+		bytes += chunk;
+		size -= chunk;
+	}
+
+	return CloseHandle(file) && written;
+}
+
+bool WriteFileReplacing(const char* path, const void* data, size_t size)
+{
+	std::string tempPath = std::string(path) + ".tmp" + std::to_string(GetCurrentThreadId());
+	HANDLE file = CreateFileA(tempPath.c_str(), GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if (WriteAndClose(file, data, size) && MoveFileExA(tempPath.c_str(), path, MOVEFILE_REPLACE_EXISTING))
+		return true;
+
+	DeleteFileA(tempPath.c_str());
+	return false;
+}
+
+bool WriteFileReplacing(const wchar_t* path, const void* data, size_t size)
+{
+	std::wstring tempPath = std::wstring(path) + L".tmp" + std::to_wstring(GetCurrentThreadId());
+	HANDLE file = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if (WriteAndClose(file, data, size) && MoveFileExW(tempPath.c_str(), path, MOVEFILE_REPLACE_EXISTING))
+		return true;
+
+	DeleteFileW(tempPath.c_str());
+	return false;
+}
+
+#else
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info = {};
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file
+	void* memory = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (memory == MAP_FAILED)
+		return false;
+
+	data = (const unsigned char*)memory;
+	size = (size_t)info.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data) munmap((void*)data, size);
+
+	data = 0;
+	size = 0;
+}
+
+// --------------------------------------------------------
+// rename() replaces the destination in one step, so the
+// temporary file only needs a name no other process or
+// thread is using
+// --------------------------------------------------------
+bool WriteFileReplacing(const char* path, const void* data, size_t size)
+{
+	std::string tempPath = std::string(path) + ".tmp" +
+		std::to_string(getpid()) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+	int file = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (file < 0)
+		return false;
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	bool written = true;
+	while (written && size > 0)
+	{
+		ssize_t chunk = write(file, bytes, size);
+		written = chunk > 0;
+		if (written)
+		{
+			bytes += chunk;
+			size -= (size_t)chunk;
+		}
+	}
+
+	if (close(file) == 0 && written && rename(tempPath.c_str(), path) == 0)
+		return true;
+
+	unlink(tempPath.c_str());
+	return false;
+}
+
+#endif
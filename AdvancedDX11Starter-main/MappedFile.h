@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// A whole file mapped read-only into memory, so it can be
+// read in place without copying it into a buffer first.
+// The data stays valid until Close() or destruction.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(MappedFile const&) = delete;
+	void operator=(MappedFile const&) = delete;
+
+	// Fails for missing or empty files
+	bool Open(const char* path);
+#ifdef _WIN32
+	bool Open(const wchar_t* path);
+#endif
+	void Close();
+
+	bool IsOpen() { return data != 0; }
+	const unsigned char* GetData() { return data; }
+	size_t GetSize() { return size; }
+
+private:
+	const unsigned char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+
+	bool Map();
+#endif
+};
+
+// --------------------------------------------------------
+// Writes a whole file by way of a temporary file next to
+// it that's then moved into place, so anything opening the
+// path (even another thread writing it at the same time)
+// sees either the old contents or the new, never half.
+// The temporary file is removed if any step fails.
+// --------------------------------------------------------
+bool WriteFileReplacing(const char* path, const void* data, size_t size);
+#ifdef _WIN32
+bool WriteFileReplacing(const wchar_t* path, const void* data, size_t size);
+#endif
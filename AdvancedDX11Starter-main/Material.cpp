@@ -1,4 +1,8 @@
 #include "Material.h"
+#include "ResourceCache.h"
+
+#include <algorithm>
+#include <string.h>
 
 Material::Material(
 	std::shared_ptr<SimplePixelShader> ps,
@@ -14,6 +18,7 @@ Material::Material(
 	uvOffset(uvOffset)
 {
 	isRefractive = false;
+	propertyRevision = 0;
 }
 
 bool Material::GetRefractive()
@@ -61,29 +66,176 @@ Microsoft::WRL::ComPtr<ID3D11SamplerState> Material::GetSampler(std::string name
 // Setters
 void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> ps) { this->ps = ps; }
 void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> vs) { this->vs = vs; }
-void Material::SetUVScale(DirectX::XMFLOAT2 scale) { uvScale = scale; }
-void Material::SetUVOffset(DirectX::XMFLOAT2 offset) { uvOffset = offset; }
-void Material::SetColorTint(DirectX::XMFLOAT3 tint) { this->colorTint = tint; }
+void Material::SetUVScale(DirectX::XMFLOAT2 scale) { uvScale = scale; propertyRevision++; }
+void Material::SetUVOffset(DirectX::XMFLOAT2 offset) { uvOffset = offset; propertyRevision++; }
+void Material::SetColorTint(DirectX::XMFLOAT3 tint) { this->colorTint = tint; propertyRevision++; }
 
 
+// Changing resources invalidates the compiled bindings.  Adding
+// a resource under an existing name replaces it.
 void Material::AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
-	textureSRVs.insert({ name, srv });
+	textureSRVs[name] = srv;
+	cachedTextures.erase(name);
+	compiled.clear();
+}
+
+void Material::AddTexture(std::string name, std::shared_ptr<CachedTexture> texture)
+{
+	AddTextureSRV(name, texture->SRV);
+	cachedTextures[name] = texture;
+}
+
+// --------------------------------------------------------
+// Swaps the SRV behind a texture the material already has,
+// without recompiling: each compiled entry's slot for that
+// texture's register is patched in place.  Adds the texture
+// (which does recompile) if the material doesn't have it.
+// --------------------------------------------------------
+void Material::ReplaceTextureSRV(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	auto it = textureSRVs.find(name);
+	if (it == textureSRVs.end())
+	{
+		AddTextureSRV(name, srv);
+		return;
+	}
+
+	it->second = srv;
+	cachedTextures.erase(name);
+
+	for (CompiledMaterial& c : compiled)
+	{
+		SimpleResourceHandle handle = c.PS->GetShaderResourceViewHandle(name);
+		if (!handle.IsValid())
+			continue;
+
+		for (BindingRange& range : c.TextureRanges)
+		{
+			if (handle.BindIndex >= range.StartSlot && handle.BindIndex < range.StartSlot + range.Count)
+				c.Textures[range.Offset + handle.BindIndex - range.StartSlot] = srv.Get();
+		}
+	}
 }
 
 void Material::AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
 {
-	samplers.insert({ name, sampler });
+	samplers[name] = sampler;
+	compiled.clear();
 }
 
 void Material::RemoveTextureSRV(std::string name)
 {
 	textureSRVs.erase(name);
+	cachedTextures.erase(name);
+	compiled.clear();
 }
 
 void Material::RemoveSampler(std::string name)
 {
 	samplers.erase(name);
+	compiled.clear();
+}
+
+// --------------------------------------------------------
+// Sorts (register, resource) pairs and splits them into
+// runs of consecutive registers, each bound with one call
+// --------------------------------------------------------
+template<typename T, typename Range>
+static void BuildBindingRanges(
+	std::vector<std::pair<unsigned int, T*>>& bindings,
+	std::vector<T*>& resources,
+	std::vector<Range>& ranges)
+{
+	std::sort(bindings.begin(), bindings.end(),
+		[](const std::pair<unsigned int, T*>& a, const std::pair<unsigned int, T*>& b) { return a.first < b.first; });
+
+	for (auto& b : bindings)
+	{
+		if (ranges.empty() || ranges.back().StartSlot + ranges.back().Count != b.first)
+			ranges.push_back({ b.first, 0, (unsigned int)resources.size() });
+
+		ranges.back().Count++;
+		resources.push_back(b.second);
+	}
+}
+
+// --------------------------------------------------------
+// Finds the material compiled for the current shaders, or
+// compiles it.  Everything name based happens here, once,
+// so drawing doesn't look up any names.
+// --------------------------------------------------------
+Material::CompiledMaterial& Material::GetCompiledMaterial()
+{
+	for (CompiledMaterial& c : compiled)
+	{
+		if (c.PS == ps && c.VS == vs)
+			return c;
+	}
+
+	CompiledMaterial c;
+	c.PS = ps;
+	c.VS = vs;
+
+	c.World = vs->GetVariableHandle("world");
+	c.WorldInverseTranspose = vs->GetVariableHandle("worldInverseTranspose");
+	c.View = vs->GetVariableHandle("view");
+	c.Projection = vs->GetVariableHandle("projection");
+	c.CameraPosition = ps->GetVariableHandle("cameraPosition");
+
+	c.ColorTint = ps->GetVariableHandle("colorTint");
+	c.UVScale = ps->GetVariableHandle("uvScale");
+	c.UVOffset = ps->GetVariableHandle("uvOffset");
+
+	c.PerMaterialBuffer = ps->GetBufferIndex("perMaterial");
+	if (c.PerMaterialBuffer != SimpleVariableHandle::InvalidIndex)
+		c.PerMaterialData.resize(ps->GetBufferSize(c.PerMaterialBuffer));
+	PackPerMaterialData(c);
+
+	// Resources the shader doesn't use are dropped here,
+	// rather than failing a lookup every draw
+	std::vector<std::pair<unsigned int, ID3D11ShaderResourceView*>> textureBindings;
+	for (auto& t : textureSRVs)
+	{
+		SimpleResourceHandle handle = ps->GetShaderResourceViewHandle(t.first);
+		if (handle.IsValid())
+			textureBindings.push_back({ handle.BindIndex, t.second.Get() });
+	}
+
+	std::vector<std::pair<unsigned int, ID3D11SamplerState*>> samplerBindings;
+	for (auto& s : samplers)
+	{
+		SimpleResourceHandle handle = ps->GetSamplerHandle(s.first);
+		if (handle.IsValid())
+			samplerBindings.push_back({ handle.BindIndex, s.second.Get() });
+	}
+
+	BuildBindingRanges(textureBindings, c.Textures, c.TextureRanges);
+	BuildBindingRanges(samplerBindings, c.Samplers, c.SamplerRanges);
+
+	compiled.push_back(c);
+	return compiled.back();
+}
+
+// --------------------------------------------------------
+// Writes the tint and UVs into the compiled perMaterial
+// data, at the offsets the shader expects them
+// --------------------------------------------------------
+void Material::PackPerMaterialData(CompiledMaterial& c)
+{
+	c.PackedRevision = propertyRevision;
+	if (c.PerMaterialData.empty())
+		return;
+
+	auto pack = [&](SimpleVariableHandle handle, const void* data, unsigned int size)
+	{
+		if (handle.ConstantBufferIndex == c.PerMaterialBuffer && handle.ByteOffset + size <= c.PerMaterialData.size())
+			memcpy(&c.PerMaterialData[handle.ByteOffset], data, size);
+	};
+
+	pack(c.ColorTint, &colorTint, sizeof(colorTint));
+	pack(c.UVScale, &uvScale, sizeof(uvScale));
+	pack(c.UVOffset, &uvOffset, sizeof(uvOffset));
 }
 
 
@@ -93,21 +245,33 @@ void Material::PrepareMaterial(Transform* transform, std::shared_ptr<Camera> cam
 	vs->SetShader();
 	ps->SetShader();
 
+	CompiledMaterial& c = GetCompiledMaterial();
+	if (c.PackedRevision != propertyRevision)
+		PackPerMaterialData(c);
+
 	// Send data to the vertex shader
-	vs->SetMatrix4x4("world", transform->GetWorldMatrix());
-	vs->SetMatrix4x4("worldInverseTranspose", transform->GetWorldInverseTransposeMatrix());
-	vs->SetMatrix4x4("view", camera->GetView());
-	vs->SetMatrix4x4("projection", camera->GetProjection());
+	vs->SetMatrix4x4(c.World, transform->GetWorldMatrix());
+	vs->SetMatrix4x4(c.WorldInverseTranspose, transform->GetWorldInverseTransposeMatrix());
+	vs->SetMatrix4x4(c.View, camera->GetView());
+	vs->SetMatrix4x4(c.Projection, camera->GetProjection());
 	vs->CopyAllBufferData();
 
-	// Send data to the pixel shader
-	ps->SetFloat3("colorTint", colorTint);
-	ps->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
-	ps->SetFloat2("uvScale", uvScale);
-	ps->SetFloat2("uvOffset", uvOffset);
+	// Send data to the pixel shader - the whole perMaterial
+	// buffer in one copy if the shader has one
+	if (!c.PerMaterialData.empty())
+	{
+		ps->SetBufferData(c.PerMaterialBuffer, c.PerMaterialData.data(), (unsigned int)c.PerMaterialData.size());
+	}
+	else
+	{
+		ps->SetFloat3(c.ColorTint, colorTint);
+		ps->SetFloat2(c.UVScale, uvScale);
+		ps->SetFloat2(c.UVOffset, uvOffset);
+	}
+	ps->SetFloat3(c.CameraPosition, camera->GetViewPosition());
 	ps->CopyAllBufferData();
 
-	// Loop and set any other resources
-	for (auto& t : textureSRVs) { ps->SetShaderResourceView(t.first.c_str(), t.second.Get()); }
-	for (auto& s : samplers) { ps->SetSamplerState(s.first.c_str(), s.second.Get()); }
+	// Bind textures and samplers, one call per range of registers
+	for (BindingRange& r : c.TextureRanges) { ps->SetShaderResourceViews(r.StartSlot, r.Count, &c.Textures[r.Offset]); }
+	for (BindingRange& r : c.SamplerRanges) { ps->SetSamplerStates(r.StartSlot, r.Count, &c.Samplers[r.Offset]); }
 }
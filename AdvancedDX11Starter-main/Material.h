@@ -5,11 +5,14 @@
 #include <DirectXMath.h>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "SimpleShader.h"
 #include "Camera.h"
 #include "Transform.h"
 
+struct CachedTexture;
+
 class Material
 {
 public:
@@ -37,8 +40,12 @@ public:
 	void SetColorTint(DirectX::XMFLOAT3 tint);
 
 	void AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	void AddTexture(std::string name, std::shared_ptr<CachedTexture> texture);
 	void AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 
+	// For textures whose SRV changes often (streamed mips)
+	void ReplaceTextureSRV(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+
 	void RemoveTextureSRV(std::string name);
 	void RemoveSampler(std::string name);
 
@@ -59,6 +66,61 @@ private:
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
 
+	// Handles to textures from the ResourceCache, which keep
+	// them from being evicted while this material uses them
+	std::unordered_map<std::string, std::shared_ptr<CachedTexture>> cachedTextures;
+
 	bool isRefractive;
-};
 
+	// Bumped whenever the tint or UVs change, so compiled
+	// materials know to repack their perMaterial data
+	unsigned int propertyRevision;
+
+	// Registers [StartSlot, StartSlot + Count) bound in one
+	// call, from Offset in the compiled resource array
+	struct BindingRange
+	{
+		unsigned int StartSlot;
+		unsigned int Count;
+		unsigned int Offset;
+	};
+
+	// The material compiled against one pair of shaders: handles
+	// for per-draw data, the perMaterial buffer already packed,
+	// and textures and samplers sorted by register into ranges.
+	// The shared_ptrs keep the shaders alive so a compiled entry
+	// can never go stale.
+	struct CompiledMaterial
+	{
+		std::shared_ptr<SimplePixelShader> PS;
+		std::shared_ptr<SimpleVertexShader> VS;
+
+		SimpleVariableHandle World;
+		SimpleVariableHandle WorldInverseTranspose;
+		SimpleVariableHandle View;
+		SimpleVariableHandle Projection;
+		SimpleVariableHandle CameraPosition;
+
+		// Variables set individually when the shader has no
+		// perMaterial buffer to pack them into
+		SimpleVariableHandle ColorTint;
+		SimpleVariableHandle UVScale;
+		SimpleVariableHandle UVOffset;
+
+		unsigned int PerMaterialBuffer;
+		std::vector<unsigned char> PerMaterialData;
+		unsigned int PackedRevision;
+
+		std::vector<ID3D11ShaderResourceView*> Textures;
+		std::vector<ID3D11SamplerState*> Samplers;
+		std::vector<BindingRange> TextureRanges;
+		std::vector<BindingRange> SamplerRanges;
+	};
+
+	// Usually one entry, two while the renderer swaps in the
+	// refraction shader.  Cleared whenever a texture or sampler
+	// changes, so the next draw recompiles.
+	std::vector<CompiledMaterial> compiled;
+	CompiledMaterial& GetCompiledMaterial();
+	void PackPerMaterialData(CompiledMaterial& c);
+};
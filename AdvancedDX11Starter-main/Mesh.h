@@ -2,6 +2,7 @@
 
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <vector>
 
 #include "Vertex.h"
 
@@ -16,6 +17,7 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return vb; }
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return ib; }
 	int GetIndexCount() { return numIndices; }
+	float GetBoundsRadius() { return boundsRadius; }	// Around the mesh's origin
 
 	void SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
 
@@ -23,9 +25,9 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vb;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ib;
 	int numIndices;
+	float boundsRadius;
 
 	void CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 
 };
 
@@ -0,0 +1,370 @@
+#include "MipGenerator.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define MIP_GENERATOR_SSE2 1
+#include <emmintrin.h>
+#else
+#define MIP_GENERATOR_SSE2 0
+#endif
+
+// Kaiser kernel: radius in destination texels, and how
+// quickly the window falls off
+static const float KaiserRadius = 2.0f;
+static const float KaiserAlpha = 4.0f;
+
+// Bands of rows smaller than this aren't worth handing to
+// another thread
+static const size_t MinTexelsPerBand = 64 * 64;
+
+// One source texel's contribution to a destination texel
+struct FilterTap
+{
+	unsigned int Index;
+	float Weight;
+};
+
+// Every destination texel's taps along one axis: texel d
+// uses Taps[Offsets[d]] up to Taps[Offsets[d + 1]]
+struct FilterTaps
+{
+	std::vector<FilterTap> Taps;
+	std::vector<unsigned int> Offsets;
+};
+
+// A mip level at full precision, 4 floats per texel
+struct FloatImage
+{
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	std::vector<float> Texels;
+};
+
+// === Kernels ==============================================
+
+// Modified Bessel function of the first kind, order 0
+static float BesselI0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	float halfX = x * 0.5f;
+	for (int k = 1; k < 32; k++)
+	{
+		term *= (halfX / k) * (halfX / k);
+		sum += term;
+		if (term < sum * 1e-8f)
+			break;
+	}
+	return sum;
+}
+
+static float Sinc(float x)
+{
+	if (fabsf(x) < 1e-5f)
+		return 1.0f;
+	const float pi = 3.14159265358979f;
+	return sinf(pi * x) / (pi * x);
+}
+
+// t is in destination texels
+static float Kaiser(float t)
+{
+	if (fabsf(t) >= KaiserRadius)
+		return 0.0f;
+	float r = t / KaiserRadius;
+	return Sinc(t) * BesselI0(KaiserAlpha * sqrtf(1.0f - r * r)) / BesselI0(KaiserAlpha);
+}
+
+static unsigned int WrapIndex(int index, unsigned int size, bool wrap)
+{
+	int n = (int)size;
+	if (wrap)
+		return (unsigned int)((index % n + n) % n);
+	return (unsigned int)(std::min)((std::max)(index, 0), n - 1);
+}
+
+// --------------------------------------------------------
+// Works out which source texels (and how much of each) go
+// into each destination texel, for one axis
+// --------------------------------------------------------
+static void BuildTaps(unsigned int sourceSize, unsigned int destSize, const MipOptions& options, FilterTaps& taps)
+{
+	taps.Taps.clear();
+	taps.Offsets.clear();
+
+	float scale = (float)sourceSize / destSize;
+	for (unsigned int d = 0; d < destSize; d++)
+	{
+		taps.Offsets.push_back((unsigned int)taps.Taps.size());
+		float center = (d + 0.5f) * scale;
+
+		// Box: each source texel counts by how much of it the
+		// destination texel covers.  Kaiser: sampled kernel.
+		float radius = options.Filter == MIP_FILTER_BOX ? scale * 0.5f : scale * KaiserRadius;
+		int first = (int)floorf(center - radius);
+		int last = (int)ceilf(center + radius);
+
+		float total = 0;
+		size_t start = taps.Taps.size();
+		for (int i = first; i <= last; i++)
+		{
+			float weight;
+			if (options.Filter == MIP_FILTER_BOX)
+				weight = (std::max)(0.0f, (std::min)((float)i + 1, center + radius) - (std::max)((float)i, center - radius));
+			else
+				weight = Kaiser((i + 0.5f - center) / scale);
+
+			if (weight == 0.0f)
+				continue;
+
+			taps.Taps.push_back({ WrapIndex(i, sourceSize, options.Wrap), weight });
+			total += weight;
+		}
+
+		for (size_t t = start; t < taps.Taps.size(); t++)
+			taps.Taps[t].Weight /= total;
+	}
+	taps.Offsets.push_back((unsigned int)taps.Taps.size());
+}
+
+// === Color conversion =====================================
+
+static float SRGBToLinear(float value)
+{
+	return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+struct ConversionTables
+{
+	float SRGBToLinear[256];
+
+	// Linear values halfway between consecutive sRGB bytes,
+	// so encoding rounds exactly without calling pow
+	float SRGBThresholds[255];
+
+	ConversionTables()
+	{
+		for (int i = 0; i < 256; i++)
+			SRGBToLinear[i] = ::SRGBToLinear(i / 255.0f);
+		for (int i = 0; i < 255; i++)
+			SRGBThresholds[i] = ::SRGBToLinear((i + 0.5f) / 255.0f);
+	}
+};
+
+static const ConversionTables& GetConversionTables()
+{
+	static ConversionTables tables;
+	return tables;
+}
+
+static unsigned char EncodeLinear(float value)
+{
+	return (unsigned char)((std::min)(1.0f, (std::max)(0.0f, value)) * 255.0f + 0.5f);
+}
+
+static unsigned char EncodeSRGB(float value, const ConversionTables& tables)
+{
+	return (unsigned char)(std::upper_bound(tables.SRGBThresholds, tables.SRGBThresholds + 255, value) - tables.SRGBThresholds);
+}
+
+// === Threading ============================================
+
+// --------------------------------------------------------
+// Runs work(firstRow, endRow) over bands of rows on the
+// shared pool.  Every row is computed the same way whichever
+// band it's in, so results don't depend on the thread count.
+// --------------------------------------------------------
+static void ForEachRowBand(unsigned int rows, size_t texelsPerRow, unsigned int threadCount, const std::function<void(unsigned int, unsigned int)>& work)
+{
+	size_t minRows = (MinTexelsPerBand + texelsPerRow - 1) / (std::max)((size_t)1, texelsPerRow);
+	ParallelForBands(rows, (unsigned int)minRows, threadCount, work);
+}
+
+// === Filtering ============================================
+
+// Adds weight * source to accumulator, 4 floats at a time
+static inline void MultiplyAdd(float* accumulator, const float* source, float weight)
+{
+#if MIP_GENERATOR_SSE2
+	_mm_storeu_ps(accumulator, _mm_add_ps(_mm_loadu_ps(accumulator), _mm_mul_ps(_mm_loadu_ps(source), _mm_set1_ps(weight))));
+#else
+	for (int c = 0; c < 4; c++)
+		accumulator[c] = accumulator[c] + source[c] * weight;
+#endif
+}
+
+// --------------------------------------------------------
+// Filters one level down to the next: across each row into
+// a temporary image, then down each column of that
+// --------------------------------------------------------
+static void FilterLevel(const FloatImage& source, FloatImage& dest, const MipOptions& options, unsigned int threadCount)
+{
+	FilterTaps horizontal, vertical;
+	BuildTaps(source.Width, dest.Width, options, horizontal);
+	BuildTaps(source.Height, dest.Height, options, vertical);
+
+	std::vector<float> rows((size_t)dest.Width * source.Height * 4);
+	ForEachRowBand(source.Height, dest.Width, threadCount, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (unsigned int y = firstRow; y < endRow; y++)
+		{
+			const float* sourceRow = &source.Texels[(size_t)y * source.Width * 4];
+			float* destRow = &rows[(size_t)y * dest.Width * 4];
+			for (unsigned int x = 0; x < dest.Width; x++)
+			{
+				float* texel = destRow + x * 4;
+				texel[0] = texel[1] = texel[2] = texel[3] = 0;
+				for (unsigned int t = horizontal.Offsets[x]; t < horizontal.Offsets[x + 1]; t++)
+					MultiplyAdd(texel, sourceRow + horizontal.Taps[t].Index * 4, horizontal.Taps[t].Weight);
+			}
+		}
+	});
+
+	dest.Texels.assign((size_t)dest.Width * dest.Height * 4, 0.0f);
+	ForEachRowBand(dest.Height, dest.Width, threadCount, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (unsigned int y = firstRow; y < endRow; y++)
+		{
+			float* destRow = &dest.Texels[(size_t)y * dest.Width * 4];
+			for (unsigned int t = vertical.Offsets[y]; t < vertical.Offsets[y + 1]; t++)
+			{
+				const float* sourceRow = &rows[(size_t)vertical.Taps[t].Index * dest.Width * 4];
+				for (unsigned int x = 0; x < dest.Width; x++)
+					MultiplyAdd(destRow + x * 4, sourceRow + x * 4, vertical.Taps[t].Weight);
+			}
+
+			// Kaiser's negative lobes can overshoot
+			for (unsigned int x = 0; x < dest.Width; x++)
+			{
+				float* texel = destRow + x * 4;
+				for (int c = 0; c < 4; c++)
+					texel[c] = (std::min)(1.0f, (std::max)(0.0f, texel[c]));
+
+				if (options.NormalMap)
+				{
+					float nx = texel[0] * 2 - 1;
+					float ny = texel[1] * 2 - 1;
+					float nz = texel[2] * 2 - 1;
+					float length = sqrtf(nx * nx + ny * ny + nz * nz);
+					if (length > 1e-6f)
+					{
+						texel[0] = nx / length * 0.5f + 0.5f;
+						texel[1] = ny / length * 0.5f + 0.5f;
+						texel[2] = nz / length * 0.5f + 0.5f;
+					}
+				}
+			}
+		}
+	});
+}
+
+// Coverage of the alpha as it will be stored
+static float CalculateAlphaCoverage(const FloatImage& image, float reference, float scale)
+{
+	size_t covered = 0;
+	size_t texels = (size_t)image.Width * image.Height;
+	for (size_t i = 0; i < texels; i++)
+	{
+		if (EncodeLinear(image.Texels[i * 4 + 3] * scale) / 255.0f > reference)
+			covered++;
+	}
+	return texels ? (float)covered / texels : 0.0f;
+}
+
+// --------------------------------------------------------
+// The alpha scale that brings a level's coverage closest
+// to the target, by bisection (coverage only goes up as
+// the scale does).  Coverage comes in steps, so the scale
+// on whichever side of the step is closer wins.
+// --------------------------------------------------------
+static float FindAlphaScale(const FloatImage& image, float reference, float targetCoverage)
+{
+	float low = 0.0f, high = 4.0f;
+	while (high < 1024.0f && CalculateAlphaCoverage(image, reference, high) < targetCoverage)
+	{
+		low = high;
+		high *= 2.0f;
+	}
+
+	for (int i = 0; i < 16; i++)
+	{
+		float middle = (low + high) * 0.5f;
+		if (CalculateAlphaCoverage(image, reference, middle) < targetCoverage)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	float lowError = targetCoverage - CalculateAlphaCoverage(image, reference, low);
+	float highError = CalculateAlphaCoverage(image, reference, high) - targetCoverage;
+	return lowError < highError ? low : high;
+}
+
+float CalculateAlphaCoverage(const unsigned char* rgba, unsigned int width, unsigned int height, float reference, float scale)
+{
+	size_t covered = 0;
+	size_t texels = (size_t)width * height;
+	for (size_t i = 0; i < texels; i++)
+	{
+		if (rgba[i * 4 + 3] / 255.0f * scale > reference)
+			covered++;
+	}
+	return texels ? (float)covered / texels : 0.0f;
+}
+
+void GenerateMipChain(
+	std::vector<std::vector<unsigned char>>& mips,
+	unsigned int width,
+	unsigned int height,
+	const MipOptions& options)
+{
+	if (mips.empty() || width == 0 || height == 0)
+		return;
+
+	const ConversionTables& tables = GetConversionTables();
+	unsigned int threadCount = options.ThreadCount;
+
+	FloatImage level;
+	level.Width = width;
+	level.Height = height;
+	level.Texels.resize((size_t)width * height * 4);
+	const std::vector<unsigned char>& top = mips[0];
+	ForEachRowBand(height, width, threadCount, [&](unsigned int firstRow, unsigned int endRow)
+	{
+		for (size_t i = (size_t)firstRow * width * 4; i < (size_t)endRow * width * 4; i++)
+		{
+			bool color = (i & 3) != 3;
+			level.Texels[i] = (options.SRGB && color) ? tables.SRGBToLinear[top[i]] : top[i] / 255.0f;
+		}
+	});
+
+	float targetCoverage = options.PreserveAlphaCoverage ? CalculateAlphaCoverage(top.data(), width, height, options.AlphaReference) : 0.0f;
+
+	while (level.Width > 1 || level.Height > 1)
+	{
+		FloatImage next;
+		next.Width = (std::max)(1u, level.Width / 2);
+		next.Height = (std::max)(1u, level.Height / 2);
+		FilterLevel(level, next, options, threadCount);
+
+		float alphaScale = options.PreserveAlphaCoverage ? FindAlphaScale(next, options.AlphaReference, targetCoverage) : 1.0f;
+
+		std::vector<unsigned char> mip(next.Texels.size());
+		ForEachRowBand(next.Height, next.Width, threadCount, [&](unsigned int firstRow, unsigned int endRow)
+		{
+			for (size_t i = (size_t)firstRow * next.Width * 4; i < (size_t)endRow * next.Width * 4; i++)
+			{
+				if ((i & 3) == 3)
+					mip[i] = EncodeLinear(next.Texels[i] * alphaScale);
+				else
+					mip[i] = options.SRGB ? EncodeSRGB(next.Texels[i], tables) : EncodeLinear(next.Texels[i]);
+			}
+		});
+
+		mips.push_back(std::move(mip));
+		level = std::move(next);
+	}
+}
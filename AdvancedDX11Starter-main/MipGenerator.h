@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+enum MipFilter
+{
+	MIP_FILTER_BOX,		// Average of the texels each mip texel covers
+	MIP_FILTER_KAISER	// Kaiser windowed sinc - sharper, without the box's blur
+};
+
+// --------------------------------------------------------
+// How a mip chain is filtered
+// --------------------------------------------------------
+struct MipOptions
+{
+	MipFilter Filter = MIP_FILTER_BOX;
+
+	// Color channels are gamma encoded, so filter them in
+	// linear space.  Alpha is always linear.
+	bool SRGB = false;
+
+	// RGB holds a unit vector (as rgb * 2 - 1), renormalized
+	// after filtering
+	bool NormalMap = false;
+
+	// Wider filters read across the edges: wrapping for
+	// tiling textures, clamping otherwise
+	bool Wrap = false;
+
+	// Scales each mip's alpha so the fraction of texels above
+	// AlphaReference matches the top mip's, so alpha tested
+	// or thin sprites don't fade out with distance
+	bool PreserveAlphaCoverage = false;
+	float AlphaReference = 0.5f;
+
+	// 0 uses every hardware thread.  The output is identical
+	// for any thread count.
+	unsigned int ThreadCount = 0;
+};
+
+// --------------------------------------------------------
+// Builds the rest of an RGBA8 mip chain on the CPU.
+// mips[0] must already hold the top level (width x
+// height); every level down to 1x1 is appended after it.
+//
+// Each level is filtered from the one above at full float
+// precision (not from its 8 bit copy), separably, with
+// rows split across threads.
+// --------------------------------------------------------
+void GenerateMipChain(
+	std::vector<std::vector<unsigned char>>& mips,
+	unsigned int width,
+	unsigned int height,
+	const MipOptions& options = MipOptions());
+
+// Fraction of texels whose alpha, multiplied by scale, is
+// above reference (both 0-1)
+float CalculateAlphaCoverage(const unsigned char* rgba, unsigned int width, unsigned int height, float reference, float scale = 1.0f);
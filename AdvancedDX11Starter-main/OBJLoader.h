@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// The CPU half of mesh creation: reading OBJ files into
+// vertex and index lists, and working out tangents.  Mesh
+// uploads the results; nothing here needs a device, so it
+// can be used (and timed) anywhere.
+// --------------------------------------------------------
+
+// Reads an OBJ file (which must have positions, UVs and
+// normals) into a left-handed triangle list
+bool LoadOBJ(const char* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+// Fills in each vertex's tangent from its triangles' UVs
+void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
@@ -0,0 +1,927 @@
+#include "PNGDecoder.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define PNG_DECODER_SSE2 1
+#include <emmintrin.h>
+#else
+#define PNG_DECODER_SSE2 0
+#endif
+
+// === Inflate ==============================================
+
+// Codes up to this long are found with one table lookup,
+// longer ones with a second
+static const unsigned int PrimaryBits = 10;
+
+// Lets match copies write 8 bytes at a time past the end
+static const size_t InflateSlack = 8;
+
+// Table entries: the symbol in the low 16 bits and the code
+// length above that.  Subtable links have the flag set, the
+// subtable's offset in the low bits and its size in bits.
+static const uint32_t SubtableFlag = 0x80000000u;
+
+static const unsigned short LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const unsigned char DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const unsigned char CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// --------------------------------------------------------
+// A canonical Huffman code as lookup tables indexed by the
+// next (bit reversed, as deflate stores them) input bits
+// --------------------------------------------------------
+struct HuffmanTable
+{
+	std::vector<uint32_t> Entries;
+
+	bool Build(const unsigned char* lengths, unsigned int count)
+	{
+		unsigned int lengthCounts[16] = {};
+		for (unsigned int i = 0; i < count; i++)
+			lengthCounts[lengths[i]]++;
+		lengthCounts[0] = 0;
+
+		// More codes than the lengths allow can't be decoded
+		int left = 1;
+		unsigned int maxLength = 0;
+		for (unsigned int length = 1; length < 16; length++)
+		{
+			left = (left << 1) - (int)lengthCounts[length];
+			if (left < 0)
+				return false;
+			if (lengthCounts[length])
+				maxLength = length;
+		}
+
+		unsigned int nextCode[16] = {};
+		unsigned int code = 0;
+		for (unsigned int length = 1; length < 16; length++)
+		{
+			code = (code + lengthCounts[length - 1]) << 1;
+			nextCode[length] = code;
+		}
+
+		// Unused entries stay 0, which has no length, so reading
+		// a code that doesn't exist is caught
+		Entries.assign((size_t)1 << PrimaryBits, 0);
+		unsigned int subtableBits = maxLength > PrimaryBits ? maxLength - PrimaryBits : 0;
+		for (unsigned int symbol = 0; symbol < count; symbol++)
+		{
+			unsigned int length = lengths[symbol];
+			if (!length)
+				continue;
+
+			unsigned int reversed = 0;
+			unsigned int bits = nextCode[length]++;
+			for (unsigned int i = 0; i < length; i++, bits >>= 1)
+				reversed = (reversed << 1) | (bits & 1);
+
+			uint32_t entry = symbol | (length << 16);
+			if (length <= PrimaryBits)
+			{
+				for (unsigned int i = reversed; i < (1u << PrimaryBits); i += 1u << length)
+					Entries[i] = entry;
+				continue;
+			}
+
+			// Long codes share a subtable per primary prefix,
+			// indexed by the bits after the prefix
+			unsigned int prefix = reversed & ((1u << PrimaryBits) - 1);
+			if (!(Entries[prefix] & SubtableFlag))
+			{
+				Entries[prefix] = SubtableFlag | (subtableBits << 16) | (uint32_t)Entries.size();
+				Entries.resize(Entries.size() + ((size_t)1 << subtableBits), 0);
+			}
+
+			size_t offset = Entries[prefix] & 0xFFFF;
+			for (unsigned int i = reversed >> PrimaryBits; i < (1u << subtableBits); i += 1u << (length - PrimaryBits))
+				Entries[offset + i] = entry;
+		}
+		return true;
+	}
+};
+
+// --------------------------------------------------------
+// Reads deflate's little endian bit stream 64 bits at a
+// time.  Reading past the end gives zeros, which either
+// end the stream or fail it.
+// --------------------------------------------------------
+struct BitReader
+{
+	const unsigned char* Next;
+	const unsigned char* End;
+	uint64_t Bits;
+	unsigned int Count;
+	unsigned int Overrun;	// Zero bytes in the buffer from past the end
+
+	// Tops the buffer up to at least 56 bits
+	inline void Refill()
+	{
+		if (End - Next >= 8)
+		{
+			// Bytes already in the buffer are loaded again in the
+			// same place, which leaves them unchanged
+			uint64_t word;
+			memcpy(&word, Next, 8);
+			Bits |= word << Count;
+			Next += (63 - Count) >> 3;
+			Count |= 56;
+			return;
+		}
+
+		while (Count <= 56)
+		{
+			if (Next < End)
+				Bits |= (uint64_t)*Next++ << Count;
+			else
+				Overrun++;
+			Count += 8;
+		}
+	}
+
+	// Needs count bits already in the buffer
+	inline unsigned int Take(unsigned int count)
+	{
+		unsigned int value = (unsigned int)(Bits & ((1ull << count) - 1));
+		Bits >>= count;
+		Count -= count;
+		return value;
+	}
+
+	// 0xFFFF for codes that don't exist
+	inline unsigned int Decode(const HuffmanTable& table)
+	{
+		const uint32_t* entries = table.Entries.data();
+		uint32_t entry = entries[Bits & ((1u << PrimaryBits) - 1)];
+		if (entry & SubtableFlag)
+			entry = entries[(entry & 0xFFFF) + ((Bits >> PrimaryBits) & ((1u << ((entry >> 16) & 0xFF)) - 1))];
+
+		unsigned int length = (entry >> 16) & 0xFF;
+		if (!length)
+			return 0xFFFF;
+		Take(length);
+		return entry & 0xFFFF;
+	}
+};
+
+static const HuffmanTable* GetFixedTables()
+{
+	struct FixedTables
+	{
+		HuffmanTable Tables[2];
+
+		FixedTables()
+		{
+			unsigned char lengths[288];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			Tables[0].Build(lengths, 288);
+
+			memset(lengths, 5, 30);
+			Tables[1].Build(lengths, 30);
+		}
+	};
+
+	static FixedTables fixed;
+	return fixed.Tables;
+}
+
+// --------------------------------------------------------
+// Inflates a raw deflate stream into exactly outputSize
+// bytes.  The output needs InflateSlack bytes of room past
+// that.
+// --------------------------------------------------------
+static bool Inflate(const unsigned char* data, size_t size, unsigned char* output, size_t outputSize)
+{
+	BitReader reader = { data, data + size, 0, 0, 0 };
+	unsigned char* out = output;
+	unsigned char* outEnd = output + outputSize;
+
+	HuffmanTable dynamicTables[2];
+	HuffmanTable codeLengthTable;
+
+	bool finalBlock = false;
+	while (!finalBlock)
+	{
+		reader.Refill();
+		finalBlock = reader.Take(1) != 0;
+		unsigned int type = reader.Take(2);
+
+		if (type == 0)
+		{
+			// Stored: byte aligned length, its complement, then bytes
+			reader.Take(reader.Count & 7);
+			unsigned int length = reader.Take(16);
+			unsigned int complement = reader.Take(16);
+			if ((length ^ 0xFFFF) != complement || length > (size_t)(outEnd - out))
+				return false;
+
+			while (length > 0 && reader.Count > reader.Overrun * 8)
+			{
+				*out++ = (unsigned char)reader.Take(8);
+				length--;
+			}
+
+			// Hand back whole bytes the buffer read ahead
+			reader.Next -= reader.Count / 8 - (std::min)(reader.Count / 8, reader.Overrun);
+			reader.Bits = 0;
+			reader.Count = 0;
+			reader.Overrun = 0;
+
+			if (length > (size_t)(reader.End - reader.Next))
+				return false;
+			memcpy(out, reader.Next, length);
+			out += length;
+			reader.Next += length;
+			continue;
+		}
+
+		const HuffmanTable* tables = GetFixedTables();
+		if (type == 2)
+		{
+			unsigned int literalCount = reader.Take(5) + 257;
+			unsigned int distanceCount = reader.Take(5) + 1;
+			unsigned int codeLengthCount = reader.Take(4) + 4;
+
+			unsigned char codeLengths[19] = {};
+			for (unsigned int i = 0; i < codeLengthCount; i++)
+			{
+				reader.Refill();
+				codeLengths[CodeLengthOrder[i]] = (unsigned char)reader.Take(3);
+			}
+			if (!codeLengthTable.Build(codeLengths, 19))
+				return false;
+
+			// Literal/length and distance code lengths, run length coded
+			unsigned char lengths[288 + 32];
+			unsigned int total = literalCount + distanceCount;
+			for (unsigned int i = 0; i < total;)
+			{
+				reader.Refill();
+				unsigned int symbol = reader.Decode(codeLengthTable);
+				if (symbol < 16)
+				{
+					lengths[i++] = (unsigned char)symbol;
+					continue;
+				}
+
+				unsigned char value = 0;
+				unsigned int repeat;
+				if (symbol == 16)
+				{
+					if (i == 0)
+						return false;
+					value = lengths[i - 1];
+					repeat = 3 + reader.Take(2);
+				}
+				else if (symbol == 17)
+					repeat = 3 + reader.Take(3);
+				else if (symbol == 18)
+					repeat = 11 + reader.Take(7);
+				else
+					return false;
+
+				if (i + repeat > total)
+					return false;
+				memset(lengths + i, value, repeat);
+				i += repeat;
+			}
+
+			if (!dynamicTables[0].Build(lengths, literalCount) ||
+				!dynamicTables[1].Build(lengths + literalCount, distanceCount))
+				return false;
+			tables = dynamicTables;
+		}
+		else if (type != 1)
+		{
+			return false;
+		}
+
+		// One refill covers the longest length and distance
+		// codes with their extra bits (48 bits)
+		for (;;)
+		{
+			reader.Refill();
+			unsigned int symbol = reader.Decode(tables[0]);
+			if (symbol < 256)
+			{
+				if (out == outEnd)
+					return false;
+				*out++ = (unsigned char)symbol;
+				continue;
+			}
+			if (symbol == 256)
+				break;
+
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			size_t length = LengthBase[symbol] + reader.Take(LengthExtra[symbol]);
+
+			unsigned int distanceSymbol = reader.Decode(tables[1]);
+			if (distanceSymbol >= 30)
+				return false;
+			size_t distance = DistanceBase[distanceSymbol] + reader.Take(DistanceExtra[distanceSymbol]);
+
+			if (distance > (size_t)(out - output) || length > (size_t)(outEnd - out))
+				return false;
+
+			// Far enough back, whole words can be copied, running
+			// into the slack past the end
+			const unsigned char* from = out - distance;
+			if (distance >= 8)
+			{
+				for (size_t i = 0; i < length; i += 8)
+					memcpy(out + i, from + i, 8);
+			}
+			else if (distance == 1)
+			{
+				memset(out, *from, length);
+			}
+			else
+			{
+				for (size_t i = 0; i < length; i++)
+					out[i] = from[i];
+			}
+			out += length;
+		}
+	}
+
+	return out == outEnd;
+}
+
+// === Unfiltering ==========================================
+
+static inline unsigned char Paeth(int a, int b, int c)
+{
+	int pa = abs(b - c);
+	int pb = abs(a - c);
+	int pc = abs(a + b - 2 * c);
+	if (pa <= pb && pa <= pc)
+		return (unsigned char)a;
+	return (unsigned char)(pb <= pc ? b : c);
+}
+
+#if PNG_DECODER_SSE2
+// Reads a pixel, plus whatever follows it when there's
+// room (it's never stored)
+template<unsigned int BytesPerPixel>
+static inline __m128i LoadPixel(const unsigned char* p, bool whole)
+{
+	uint32_t value = 0;
+	memcpy(&value, p, whole ? 4 : BytesPerPixel);
+	return _mm_cvtsi32_si128((int)value);
+}
+
+template<unsigned int BytesPerPixel>
+static inline void StorePixel(unsigned char* p, __m128i pixel)
+{
+	uint32_t value = (uint32_t)_mm_cvtsi128_si32(pixel);
+	memcpy(p, &value, BytesPerPixel);
+}
+
+// --------------------------------------------------------
+// One pixel of Sub, Average or Paeth.  a is the previous
+// result; c is the pixel above that, as 16 bit lanes.
+// --------------------------------------------------------
+template<unsigned int Filter>
+static inline __m128i UnfilterPixel(__m128i x, __m128i above, __m128i& a, __m128i& c)
+{
+	if (Filter == 1)
+		return a = _mm_add_epi8(a, x);
+
+	if (Filter == 3)
+	{
+		// Average rounding down: avg_epu8 rounds up
+		__m128i average = _mm_sub_epi8(_mm_avg_epu8(a, above), _mm_and_si128(_mm_xor_si128(a, above), _mm_set1_epi8(1)));
+		return a = _mm_add_epi8(average, x);
+	}
+
+	// Paeth on 16 bit lanes, so the differences fit
+	__m128i zero = _mm_setzero_si128();
+	__m128i b = _mm_unpacklo_epi8(above, zero);
+	__m128i a16 = _mm_unpacklo_epi8(a, zero);
+	__m128i pa = _mm_sub_epi16(b, c);
+	__m128i pb = _mm_sub_epi16(a16, c);
+	__m128i pc = _mm_add_epi16(pa, pb);
+	pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+	pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+	pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+	// Ties go to a, then b
+	__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+	__m128i useA = _mm_cmpeq_epi16(smallest, pa);
+	__m128i useB = _mm_cmpeq_epi16(smallest, pb);
+	__m128i nearest = _mm_or_si128(_mm_and_si128(useB, b), _mm_andnot_si128(useB, c));
+	nearest = _mm_or_si128(_mm_and_si128(useA, a16), _mm_andnot_si128(useA, nearest));
+
+	c = b;
+	return a = _mm_packus_epi16(_mm_and_si128(_mm_add_epi16(nearest, _mm_unpacklo_epi8(x, zero)), _mm_set1_epi16(0xFF)), zero);
+}
+
+// --------------------------------------------------------
+// Sub, Average and Paeth depend on the pixel to the left,
+// so these go a whole pixel (every channel) at a time
+// --------------------------------------------------------
+template<unsigned int BytesPerPixel, unsigned int Filter>
+static void UnfilterPixels(unsigned char* dest, const unsigned char* source, const unsigned char* previous, size_t rowBytes)
+{
+	__m128i a = _mm_setzero_si128();
+	__m128i c = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 4 <= rowBytes; i += BytesPerPixel)
+		StorePixel<BytesPerPixel>(dest + i, UnfilterPixel<Filter>(LoadPixel<BytesPerPixel>(source + i, true), LoadPixel<BytesPerPixel>(previous + i, true), a, c));
+	for (; i < rowBytes; i += BytesPerPixel)
+		StorePixel<BytesPerPixel>(dest + i, UnfilterPixel<Filter>(LoadPixel<BytesPerPixel>(source + i, false), LoadPixel<BytesPerPixel>(previous + i, false), a, c));
+}
+
+template<unsigned int BytesPerPixel>
+static void UnfilterPixels(unsigned int filter, unsigned char* dest, const unsigned char* source, const unsigned char* previous, size_t rowBytes)
+{
+	if (filter == 1)
+		UnfilterPixels<BytesPerPixel, 1>(dest, source, previous, rowBytes);
+	else if (filter == 3)
+		UnfilterPixels<BytesPerPixel, 3>(dest, source, previous, rowBytes);
+	else
+		UnfilterPixels<BytesPerPixel, 4>(dest, source, previous, rowBytes);
+}
+#endif
+
+// --------------------------------------------------------
+// Undoes one scanline's filter.  dest can be source (in
+// place); previous is the unfiltered row above (zeros for
+// the first row).
+// --------------------------------------------------------
+static bool Unfilter(unsigned int filter, unsigned char* dest, const unsigned char* source, const unsigned char* previous, size_t rowBytes, unsigned int bytesPerPixel)
+{
+	size_t i = 0;
+	switch (filter)
+	{
+	case 0:
+		if (dest != source)
+			memcpy(dest, source, rowBytes);
+		return true;
+
+	case 2:
+#if PNG_DECODER_SSE2
+		for (; i + 16 <= rowBytes; i += 16)
+			_mm_storeu_si128((__m128i*)(dest + i), _mm_add_epi8(_mm_loadu_si128((const __m128i*)(source + i)), _mm_loadu_si128((const __m128i*)(previous + i))));
+#endif
+		for (; i < rowBytes; i++)
+			dest[i] = (unsigned char)(source[i] + previous[i]);
+		return true;
+
+	case 1:
+	case 3:
+	case 4:
+#if PNG_DECODER_SSE2
+		if (bytesPerPixel == 4)
+		{
+			UnfilterPixels<4>(filter, dest, source, previous, rowBytes);
+			return true;
+		}
+		if (bytesPerPixel == 3)
+		{
+			UnfilterPixels<3>(filter, dest, source, previous, rowBytes);
+			return true;
+		}
+#endif
+		for (; i < rowBytes; i++)
+		{
+			int a = i >= bytesPerPixel ? dest[i - bytesPerPixel] : 0;
+			int b = previous[i];
+			int c = i >= bytesPerPixel ? previous[i - bytesPerPixel] : 0;
+			int predicted = filter == 1 ? a : filter == 3 ? (a + b) >> 1 : Paeth(a, b, c);
+			dest[i] = (unsigned char)(source[i] + predicted);
+		}
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+// === Checksums ============================================
+
+// --------------------------------------------------------
+// CRC-32 tables for slicing by 4: table 0 is the usual byte
+// at a time table, and table k advances a byte k further
+// --------------------------------------------------------
+struct CRCTables
+{
+	uint32_t Table[4][256];
+
+	CRCTables()
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int bit = 0; bit < 8; bit++)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			Table[0][i] = c;
+		}
+
+		for (uint32_t i = 0; i < 256; i++)
+			for (int k = 1; k < 4; k++)
+				Table[k][i] = (Table[k - 1][i] >> 8) ^ Table[0][Table[k - 1][i] & 0xFF];
+	}
+};
+
+static uint32_t UpdateCRC(uint32_t crc, const unsigned char* data, size_t size)
+{
+	static const CRCTables tables;
+	const uint32_t (*t)[256] = tables.Table;
+
+	crc = ~crc;
+	for (; size >= 4; size -= 4, data += 4)
+	{
+		crc ^= (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+		crc = t[3][crc & 0xFF] ^ t[2][(crc >> 8) & 0xFF] ^ t[1][(crc >> 16) & 0xFF] ^ t[0][crc >> 24];
+	}
+	for (; size > 0; size--, data++)
+		crc = t[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+// --------------------------------------------------------
+// zlib's Adler-32.  5552 is the most bytes that can be
+// summed before the 32 bit sums need reducing.
+// --------------------------------------------------------
+static uint32_t Adler32(const unsigned char* data, size_t size)
+{
+	uint32_t a = 1, b = 0;
+	while (size > 0)
+	{
+		size_t block = (std::min)(size, (size_t)5552);
+		size -= block;
+		for (; block > 0; block--)
+		{
+			a += *data++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return (b << 16) | a;
+}
+
+// === PNG ==================================================
+
+static const unsigned char Signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+// Adam7 interlacing: where each pass starts and its spacing
+static const unsigned int PassX[7] = { 0, 4, 0, 2, 0, 1, 0 };
+static const unsigned int PassY[7] = { 0, 0, 4, 0, 2, 0, 1 };
+static const unsigned int PassStepX[7] = { 8, 8, 4, 4, 2, 2, 1 };
+static const unsigned int PassStepY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+// Everything decoding needs from the chunks
+struct PNGFile
+{
+	PNGInfo Info;
+	unsigned char Palette[256][4];
+	bool HasTransparentColor = false;
+	unsigned int TransparentColor[3] = {};
+	std::vector<std::pair<const unsigned char*, size_t>> Data;	// The IDAT chunks
+};
+
+static uint32_t ReadBigEndian(const unsigned char* p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static unsigned int GetChannels(unsigned int colorType)
+{
+	switch (colorType)
+	{
+	case 0: return 1;
+	case 2: return 3;
+	case 3: return 1;
+	case 4: return 2;
+	case 6: return 4;
+	default: return 0;
+	}
+}
+
+static bool IsValidBitDepth(unsigned int colorType, unsigned int bitDepth)
+{
+	switch (colorType)
+	{
+	case 0: return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+	case 3: return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+	case 2:
+	case 4:
+	case 6: return bitDepth == 8 || bitDepth == 16;
+	default: return false;
+	}
+}
+
+// --------------------------------------------------------
+// Walks the chunks, stopping at IEND.  With headerOnly it
+// stops at the first IDAT, having seen everything before.
+// --------------------------------------------------------
+static bool ParseChunks(const unsigned char* data, size_t size, PNGFile& png, bool headerOnly)
+{
+	if (size < 8 + 25 || memcmp(data, Signature, 8) != 0)
+		return false;
+
+	for (unsigned int i = 0; i < 256; i++)
+	{
+		png.Palette[i][0] = png.Palette[i][1] = png.Palette[i][2] = 0;
+		png.Palette[i][3] = 255;
+	}
+
+	size_t offset = 8;
+	bool first = true;
+	while (offset + 12 <= size)
+	{
+		uint32_t length = ReadBigEndian(data + offset);
+		const unsigned char* type = data + offset + 4;
+		const unsigned char* body = data + offset + 8;
+		if (length > size - offset - 12 ||
+			UpdateCRC(0, type, 4 + (size_t)length) != ReadBigEndian(body + length))
+			return false;
+		offset += 12 + (size_t)length;
+
+		if (first)
+		{
+			// IHDR has to come first
+			if (memcmp(type, "IHDR", 4) != 0 || length < 13)
+				return false;
+
+			PNGInfo& info = png.Info;
+			info.Width = ReadBigEndian(body);
+			info.Height = ReadBigEndian(body + 4);
+			info.BitDepth = body[8];
+			info.ColorType = body[9];
+			info.Interlaced = body[12] == 1;
+			if (info.Width == 0 || info.Height == 0 || info.Width > (1u << 24) || info.Height > (1u << 24) ||
+				(uint64_t)info.Width * info.Height > PNGMaxPixels ||
+				!IsValidBitDepth(info.ColorType, info.BitDepth) ||
+				body[10] != 0 || body[11] != 0 || body[12] > 1)
+				return false;
+			first = false;
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			if (headerOnly)
+				return true;
+			png.Data.push_back({ body, length });
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			for (uint32_t i = 0; i < length / 3 && i < 256; i++)
+				memcpy(png.Palette[i], body + i * 3, 3);
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (png.Info.ColorType == 3)
+			{
+				for (uint32_t i = 0; i < length && i < 256; i++)
+					png.Palette[i][3] = body[i];
+			}
+			else if (png.Info.ColorType == 0 && length >= 2)
+			{
+				png.HasTransparentColor = true;
+				png.TransparentColor[0] = (body[0] << 8) | body[1];
+			}
+			else if (png.Info.ColorType == 2 && length >= 6)
+			{
+				png.HasTransparentColor = true;
+				for (unsigned int c = 0; c < 3; c++)
+					png.TransparentColor[c] = (body[c * 2] << 8) | body[c * 2 + 1];
+			}
+		}
+		else if (memcmp(type, "sRGB", 4) == 0)
+		{
+			png.Info.SRGB = true;
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			break;
+		}
+	}
+
+	return !first && (headerOnly || !png.Data.empty());
+}
+
+// --------------------------------------------------------
+// Converts a row of unfiltered samples to RGBA8, writing
+// each pixel destStep bytes after the last
+// --------------------------------------------------------
+static void ExpandRow(const PNGFile& png, const unsigned char* row, unsigned int count, unsigned char* dest, size_t destStep)
+{
+	const PNGInfo& info = png.Info;
+	unsigned int depth = info.BitDepth;
+
+	if (depth < 8)
+	{
+		// Packed gray or palette indices, high bits first
+		unsigned int mask = (1u << depth) - 1;
+		unsigned int scale = 255 / mask;
+		for (unsigned int x = 0; x < count; x++, dest += destStep)
+		{
+			unsigned int bit = x * depth;
+			unsigned int sample = (row[bit >> 3] >> (8 - depth - (bit & 7))) & mask;
+			if (info.ColorType == 3)
+			{
+				memcpy(dest, png.Palette[sample], 4);
+				continue;
+			}
+			dest[0] = dest[1] = dest[2] = (unsigned char)(sample * scale);
+			dest[3] = (png.HasTransparentColor && sample == png.TransparentColor[0]) ? 0 : 255;
+		}
+		return;
+	}
+
+	// The usual case, without transparency to check
+	if (depth == 8 && info.ColorType == 2 && !png.HasTransparentColor)
+	{
+		for (unsigned int x = 0; x < count; x++, dest += destStep, row += 3)
+		{
+			dest[0] = row[0];
+			dest[1] = row[1];
+			dest[2] = row[2];
+			dest[3] = 255;
+		}
+		return;
+	}
+
+	// 16 bit samples keep their high byte, though transparency
+	// is matched against the whole thing
+	unsigned int sampleBytes = depth / 8;
+	unsigned int channels = GetChannels(info.ColorType);
+	for (unsigned int x = 0; x < count; x++, dest += destStep, row += channels * sampleBytes)
+	{
+		auto sample = [&](unsigned int c) { return sampleBytes == 2 ? (unsigned int)(row[c * 2] << 8) | row[c * 2 + 1] : row[c]; };
+		switch (info.ColorType)
+		{
+		case 0:
+			dest[0] = dest[1] = dest[2] = row[0];
+			dest[3] = (png.HasTransparentColor && sample(0) == png.TransparentColor[0]) ? 0 : 255;
+			break;
+
+		case 2:
+			dest[0] = row[0];
+			dest[1] = row[sampleBytes];
+			dest[2] = row[sampleBytes * 2];
+			dest[3] = (png.HasTransparentColor &&
+				sample(0) == png.TransparentColor[0] &&
+				sample(1) == png.TransparentColor[1] &&
+				sample(2) == png.TransparentColor[2]) ? 0 : 255;
+			break;
+
+		case 3:
+			memcpy(dest, png.Palette[row[0]], 4);
+			break;
+
+		case 4:
+			dest[0] = dest[1] = dest[2] = row[0];
+			dest[3] = row[sampleBytes];
+			break;
+
+		case 6:
+			dest[0] = row[0];
+			dest[1] = row[sampleBytes];
+			dest[2] = row[sampleBytes * 2];
+			dest[3] = row[sampleBytes * 3];
+			break;
+		}
+	}
+}
+
+bool ReadPNGInfo(const unsigned char* data, size_t size, PNGInfo& info)
+{
+	PNGFile png;
+	if (!ParseChunks(data, size, png, true))
+		return false;
+	info = png.Info;
+	return true;
+}
+
+bool DecodePNG(const unsigned char* data, size_t size, unsigned char* destination, size_t rowPitch)
+{
+	PNGFile png;
+	if (!ParseChunks(data, size, png, false))
+		return false;
+
+	const PNGInfo& info = png.Info;
+	unsigned int bitsPerPixel = GetChannels(info.ColorType) * info.BitDepth;
+	unsigned int bytesPerPixel = (std::max)(1u, bitsPerPixel / 8);
+
+	// Each pass is its own little image; without interlacing
+	// there's just the one
+	unsigned int passes = info.Interlaced ? 7 : 1;
+	unsigned int passWidths[7] = {}, passHeights[7] = {};
+	size_t scanlineBytes = 0;
+	size_t maxRowBytes = 0;
+	for (unsigned int pass = 0; pass < passes; pass++)
+	{
+		unsigned int x = info.Interlaced ? PassX[pass] : 0, stepX = info.Interlaced ? PassStepX[pass] : 1;
+		unsigned int y = info.Interlaced ? PassY[pass] : 0, stepY = info.Interlaced ? PassStepY[pass] : 1;
+		passWidths[pass] = info.Width > x ? (info.Width - x + stepX - 1) / stepX : 0;
+		passHeights[pass] = info.Height > y ? (info.Height - y + stepY - 1) / stepY : 0;
+		if (!passWidths[pass] || !passHeights[pass])
+			continue;
+
+		size_t rowBytes = ((size_t)passWidths[pass] * bitsPerPixel + 7) / 8;
+		scanlineBytes += (rowBytes + 1) * passHeights[pass];
+		maxRowBytes = (std::max)(maxRowBytes, rowBytes);
+	}
+
+	// The zlib stream can be split across IDAT chunks, and
+	// is only copied to join it back up when it is
+	const unsigned char* stream = png.Data[0].first;
+	size_t streamSize = png.Data[0].second;
+	std::vector<unsigned char> joined;
+	if (png.Data.size() > 1)
+	{
+		for (auto& chunk : png.Data)
+			joined.insert(joined.end(), chunk.first, chunk.first + chunk.second);
+		stream = joined.data();
+		streamSize = joined.size();
+	}
+
+	// zlib header: deflate, no preset dictionary.  The
+	// stream ends with the Adler-32 of the inflated data.
+	if (streamSize < 6 || (stream[0] & 0x0F) != 8 || ((stream[0] << 8) | stream[1]) % 31 != 0 || (stream[1] & 0x20))
+		return false;
+
+	std::vector<unsigned char> scanlines(scanlineBytes + InflateSlack);
+	if (!Inflate(stream + 2, streamSize - 6, scanlines.data(), scanlineBytes) ||
+		Adler32(scanlines.data(), scanlineBytes) != ReadBigEndian(stream + streamSize - 4))
+		return false;
+
+	std::vector<unsigned char> zeros(maxRowBytes, 0);
+	unsigned char* scanline = scanlines.data();
+	for (unsigned int pass = 0; pass < passes; pass++)
+	{
+		if (!passWidths[pass] || !passHeights[pass])
+			continue;
+
+		unsigned int startX = info.Interlaced ? PassX[pass] : 0, stepX = info.Interlaced ? PassStepX[pass] : 1;
+		unsigned int startY = info.Interlaced ? PassY[pass] : 0, stepY = info.Interlaced ? PassStepY[pass] : 1;
+		size_t rowBytes = ((size_t)passWidths[pass] * bitsPerPixel + 7) / 8;
+
+		// 8 bit RGBA is already in its final layout, so it's
+		// unfiltered straight into the destination
+		bool direct = !info.Interlaced && info.ColorType == 6 && info.BitDepth == 8;
+
+		const unsigned char* previous = zeros.data();
+		for (unsigned int y = 0; y < passHeights[pass]; y++, scanline += rowBytes + 1)
+		{
+			unsigned char* destRow = destination + (size_t)(startY + y * stepY) * rowPitch;
+			unsigned char* unfiltered = direct ? destRow : scanline + 1;
+			if (!Unfilter(scanline[0], unfiltered, scanline + 1, previous, rowBytes, bytesPerPixel))
+				return false;
+			previous = unfiltered;
+
+			if (!direct)
+				ExpandRow(png, unfiltered, passWidths[pass], destRow + (size_t)startX * 4, (size_t)stepX * 4);
+		}
+	}
+
+	return true;
+}
+
+bool DecodePNG(const unsigned char* data, size_t size, PNGImage& image)
+{
+	image.RGBA.clear();
+	if (!ReadPNGInfo(data, size, image.Info))
+		return false;
+
+	image.RGBA.resize((size_t)image.Info.Width * image.Info.Height * 4);
+	if (!DecodePNG(data, size, image.RGBA.data(), (size_t)image.Info.Width * 4))
+	{
+		image.RGBA.clear();
+		return false;
+	}
+	return true;
+}
+
+unsigned int DecodePNGs(
+	const std::vector<std::pair<const unsigned char*, size_t>>& files,
+	std::vector<PNGImage>& images,
+	unsigned int threadCount)
+{
+	images.clear();
+	images.resize(files.size());
+
+	std::atomic<unsigned int> decoded(0);
+	ParallelFor((unsigned int)files.size(), threadCount, [&](unsigned int i)
+	{
+		if (DecodePNG(files[i].first, files[i].second, images[i]))
+			decoded++;
+	});
+	return decoded;
+}
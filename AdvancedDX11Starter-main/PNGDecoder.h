@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------
+// What a PNG's header says about it
+// --------------------------------------------------------
+struct PNGInfo
+{
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	unsigned int BitDepth = 0;
+	unsigned int ColorType = 0;	// 0 gray, 2 RGB, 3 palette, 4 gray + alpha, 6 RGBA
+	bool Interlaced = false;
+	bool SRGB = false;			// Has an sRGB chunk
+};
+
+// --------------------------------------------------------
+// A decoded PNG, RGBA8 with no row padding
+// --------------------------------------------------------
+struct PNGImage
+{
+	PNGInfo Info;
+	std::vector<unsigned char> RGBA;
+};
+
+// --------------------------------------------------------
+// Decodes PNG files without any platform image library:
+// every color type and bit depth, palettes, transparency
+// and interlacing.  16 bit channels are cut to 8 bits.
+// Every chunk's CRC and the zlib stream's Adler-32 are
+// checked, and images over PNGMaxPixels are refused before
+// anything is allocated for them.
+//
+// The zlib stream is inflated in one go into a buffer of
+// scanlines, which are unfiltered (with SSE2 for 3 and 4
+// byte pixels) straight into the destination.  That can be
+// memory the GPU copy is made from, with any row pitch, so
+// the pixels aren't copied again.
+// --------------------------------------------------------
+
+// 16384 x 16384, D3D11's largest texture (1 GB as RGBA8)
+static const unsigned long long PNGMaxPixels = 16384ull * 16384ull;
+
+// Reads just the header.  False if it isn't a PNG.
+bool ReadPNGInfo(const unsigned char* data, size_t size, PNGInfo& info);
+
+// Decodes into width x height RGBA8 pixels at destination,
+// with rowPitch bytes from one row to the next
+bool DecodePNG(const unsigned char* data, size_t size, unsigned char* destination, size_t rowPitch);
+
+bool DecodePNG(const unsigned char* data, size_t size, PNGImage& image);
+
+// Decodes several files at once, spread over threadCount
+// threads of the shared pool (0 for all of them).  Returns how many
+// decoded; failed images are left empty.
+unsigned int DecodePNGs(
+	const std::vector<std::pair<const unsigned char*, size_t>>& files,
+	std::vector<PNGImage>& images,
+	unsigned int threadCount = 0);
@@ -0,0 +1,377 @@
+#include "PackedHDR.h"
+
+#include <algorithm>
+#include <cstring>
+#include <math.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define PACKED_HDR_SSE2 1
+#include <emmintrin.h>
+#else
+#define PACKED_HDR_SSE2 0
+#endif
+
+// DXGI_FORMAT values, so this doesn't need D3D headers
+static const uint32_t DXGIFormatR11G11B10Float = 26;
+static const uint32_t DXGIFormatR8G8B8A8 = 28;
+static const uint32_t DXGIFormatR9G9B9E5 = 67;
+
+// Largest values each format holds
+static const float MaxRGB9E5 = 65408.0f;		// 511/512 * 2^16
+static const float MaxFloat11 = 65024.0f;		// 127/64 * 2^15
+static const float MaxFloat10 = 64512.0f;		// 63/32 * 2^15
+
+// The smallest normal float11/float10, below which they're
+// denormal
+static const float MinNormalFloat11 = 6.10351562e-05f;
+
+const char* GetPackedHDRFormatName(PackedHDRFormat format)
+{
+	switch (format)
+	{
+	case PACKED_HDR_RGB9E5: return "RGB9E5";
+	case PACKED_HDR_R11G11B10F: return "R11G11B10F";
+	default: return "RGBM";
+	}
+}
+
+uint32_t GetPackedHDRDXGIFormat(PackedHDRFormat format)
+{
+	switch (format)
+	{
+	case PACKED_HDR_RGB9E5: return DXGIFormatR9G9B9E5;
+	case PACKED_HDR_R11G11B10F: return DXGIFormatR11G11B10Float;
+	default: return DXGIFormatR8G8B8A8;
+	}
+}
+
+static float FloatFromBits(uint32_t bits)
+{
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static uint32_t BitsFromFloat(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+// Negative and NaN to 0, too large to the largest value
+static float Sanitize(float value, float maxValue)
+{
+	return value > 0.0f ? (std::min)(value, maxValue) : 0.0f;
+}
+
+// --------------------------------------------------------
+// The shared exponent comes from the brightest channel:
+// biased by 15, so the mantissas are its value over
+// 2^(exponent - 24), rounded.  If that rounds the brightest
+// up to 512 the exponent has to go up one.
+// --------------------------------------------------------
+static uint32_t PackRGB9E5(const float rgb[3])
+{
+	float r = Sanitize(rgb[0], MaxRGB9E5);
+	float g = Sanitize(rgb[1], MaxRGB9E5);
+	float b = Sanitize(rgb[2], MaxRGB9E5);
+	float maxChannel = (std::max)(r, (std::max)(g, b));
+
+	int exponent = (std::max)((int)(BitsFromFloat(maxChannel) >> 23) - 111, 0);
+	float scale = FloatFromBits((uint32_t)(151 - exponent) << 23);
+	if ((uint32_t)(maxChannel * scale + 0.5f) == 512)
+	{
+		exponent++;
+		scale *= 0.5f;
+	}
+
+	uint32_t red = (uint32_t)(r * scale + 0.5f);
+	uint32_t green = (uint32_t)(g * scale + 0.5f);
+	uint32_t blue = (uint32_t)(b * scale + 0.5f);
+	return red | green << 9 | blue << 18 | (uint32_t)exponent << 27;
+}
+
+static void UnpackRGB9E5(uint32_t packed, float rgb[3])
+{
+	float scale = FloatFromBits(((packed >> 27) + 103) << 23);
+	rgb[0] = (packed & 0x1FF) * scale;
+	rgb[1] = ((packed >> 9) & 0x1FF) * scale;
+	rgb[2] = ((packed >> 18) & 0x1FF) * scale;
+}
+
+// --------------------------------------------------------
+// A float as an unsigned float11 or float10 (5 exponent
+// bits, biased by 15), rounded to nearest even.  Normal
+// values round the float's own bits; denormals are just
+// the value in steps of the smallest one.
+// --------------------------------------------------------
+static uint32_t PackSmallFloat(float value, float maxValue, int mantissaBits)
+{
+	value = Sanitize(value, maxValue);
+	if (value < MinNormalFloat11)
+		return (uint32_t)lrintf(value * ldexpf(1.0f, 14 + mantissaBits));
+
+	int shift = 23 - mantissaBits;
+	uint32_t bits = BitsFromFloat(value);
+	bits += (1u << (shift - 1)) - 1 + ((bits >> shift) & 1);
+	return (bits >> shift) - (112u << mantissaBits);
+}
+
+static float UnpackSmallFloat(uint32_t bits, int mantissaBits)
+{
+	if ((bits >> mantissaBits) == 0)
+		return bits * ldexpf(1.0f, -14 - mantissaBits);
+	return FloatFromBits((bits << (23 - mantissaBits)) + (112u << 23));
+}
+
+static uint32_t PackR11G11B10F(const float rgb[3])
+{
+	return PackSmallFloat(rgb[0], MaxFloat11, 6) |
+		PackSmallFloat(rgb[1], MaxFloat11, 6) << 11 |
+		PackSmallFloat(rgb[2], MaxFloat10, 5) << 22;
+}
+
+static void UnpackR11G11B10F(uint32_t packed, float rgb[3])
+{
+	rgb[0] = UnpackSmallFloat(packed & 0x7FF, 6);
+	rgb[1] = UnpackSmallFloat((packed >> 11) & 0x7FF, 6);
+	rgb[2] = UnpackSmallFloat(packed >> 22, 5);
+}
+
+// --------------------------------------------------------
+// The multiplier is the smallest that keeps the brightest
+// channel at or under 255, so it gets the most precision
+// --------------------------------------------------------
+static uint32_t PackRGBM(const float rgb[3])
+{
+	float r = Sanitize(rgb[0], PackedHDRRGBMRange);
+	float g = Sanitize(rgb[1], PackedHDRRGBMRange);
+	float b = Sanitize(rgb[2], PackedHDRRGBMRange);
+	float maxChannel = (std::max)(r, (std::max)(g, b));
+
+	float multiplier = (std::max)(ceilf(maxChannel * (255.0f / PackedHDRRGBMRange)), 1.0f);
+	float scale = 65025.0f / (multiplier * PackedHDRRGBMRange);
+	uint32_t red = (std::min)((uint32_t)lrintf(r * scale), 255u);
+	uint32_t green = (std::min)((uint32_t)lrintf(g * scale), 255u);
+	uint32_t blue = (std::min)((uint32_t)lrintf(b * scale), 255u);
+	return red | green << 8 | blue << 16 | (uint32_t)multiplier << 24;
+}
+
+static void UnpackRGBM(uint32_t packed, float rgb[3])
+{
+	float scale = (packed >> 24) * (PackedHDRRGBMRange / 65025.0f);
+	rgb[0] = (packed & 0xFF) * scale;
+	rgb[1] = ((packed >> 8) & 0xFF) * scale;
+	rgb[2] = ((packed >> 16) & 0xFF) * scale;
+}
+
+uint32_t PackHDRTexel(const float rgb[3], PackedHDRFormat format)
+{
+	switch (format)
+	{
+	case PACKED_HDR_RGB9E5: return PackRGB9E5(rgb);
+	case PACKED_HDR_R11G11B10F: return PackR11G11B10F(rgb);
+	default: return PackRGBM(rgb);
+	}
+}
+
+void UnpackHDRTexel(uint32_t packed, PackedHDRFormat format, float rgb[3])
+{
+	switch (format)
+	{
+	case PACKED_HDR_RGB9E5: UnpackRGB9E5(packed, rgb); break;
+	case PACKED_HDR_R11G11B10F: UnpackR11G11B10F(packed, rgb); break;
+	default: UnpackRGBM(packed, rgb); break;
+	}
+}
+
+#if PACKED_HDR_SSE2
+// 4 texels of packed RGB as a vector per channel
+static void LoadRGB4(const float* rgb, __m128& r, __m128& g, __m128& b)
+{
+	__m128 a = _mm_loadu_ps(rgb);		// r0 g0 b0 r1
+	__m128 c = _mm_loadu_ps(rgb + 4);	// g1 b1 r2 g2
+	__m128 d = _mm_loadu_ps(rgb + 8);	// b2 r3 g3 b3
+	r = _mm_shuffle_ps(a, _mm_shuffle_ps(c, d, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+	g = _mm_shuffle_ps(_mm_shuffle_ps(a, c, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(c, d, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	b = _mm_shuffle_ps(_mm_shuffle_ps(a, c, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+static void StoreRGB4(__m128 r, __m128 g, __m128 b, float* rgb)
+{
+	__m128 rgLow = _mm_unpacklo_ps(r, g);	// r0 g0 r1 g1
+	__m128 rgHigh = _mm_unpackhi_ps(r, g);	// r2 g2 r3 g3
+	_mm_storeu_ps(rgb, _mm_shuffle_ps(rgLow, _mm_shuffle_ps(b, r, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0)));
+	_mm_storeu_ps(rgb + 4, _mm_shuffle_ps(_mm_shuffle_ps(g, b, _MM_SHUFFLE(1, 1, 1, 1)), rgHigh, _MM_SHUFFLE(1, 0, 2, 0)));
+	_mm_storeu_ps(rgb + 8, _mm_shuffle_ps(_mm_shuffle_ps(b, rgHigh, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(rgHigh, b, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+static __m128 Sanitize4(__m128 value, float maxValue)
+{
+	// max() returns its second operand for NaN
+	return _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(maxValue));
+}
+
+static __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static __m128i RoundHalfUp4(__m128 value)
+{
+	return _mm_cvttps_epi32(_mm_add_ps(value, _mm_set1_ps(0.5f)));
+}
+
+static __m128i PackRGB9E5x4(__m128 r, __m128 g, __m128 b)
+{
+	r = Sanitize4(r, MaxRGB9E5);
+	g = Sanitize4(g, MaxRGB9E5);
+	b = Sanitize4(b, MaxRGB9E5);
+	__m128 maxChannel = _mm_max_ps(r, _mm_max_ps(g, b));
+
+	// No max_epi32 in SSE2, so negative exponents are masked
+	__m128i exponent = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(maxChannel), 23), _mm_set1_epi32(111));
+	exponent = _mm_andnot_si128(_mm_cmplt_epi32(exponent, _mm_setzero_si128()), exponent);
+	__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(151), exponent), 23));
+
+	__m128i overflow = _mm_cmpeq_epi32(RoundHalfUp4(_mm_mul_ps(maxChannel, scale)), _mm_set1_epi32(512));
+	exponent = _mm_sub_epi32(exponent, overflow);
+	scale = _mm_mul_ps(scale, Select(_mm_castsi128_ps(overflow), _mm_set1_ps(0.5f), _mm_set1_ps(1.0f)));
+
+	__m128i packed = RoundHalfUp4(_mm_mul_ps(r, scale));
+	packed = _mm_or_si128(packed, _mm_slli_epi32(RoundHalfUp4(_mm_mul_ps(g, scale)), 9));
+	packed = _mm_or_si128(packed, _mm_slli_epi32(RoundHalfUp4(_mm_mul_ps(b, scale)), 18));
+	return _mm_or_si128(packed, _mm_slli_epi32(exponent, 27));
+}
+
+static void UnpackRGB9E5x4(__m128i packed, __m128& r, __m128& g, __m128& b)
+{
+	const __m128i mantissaMask = _mm_set1_epi32(0x1FF);
+	__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_srli_epi32(packed, 27), _mm_set1_epi32(103)), 23));
+	r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(packed, mantissaMask)), scale);
+	g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 9), mantissaMask)), scale);
+	b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 18), mantissaMask)), scale);
+}
+
+static __m128i PackSmallFloat4(__m128 value, float maxValue, int mantissaBits)
+{
+	value = Sanitize4(value, maxValue);
+	__m128i denormal = _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(ldexpf(1.0f, 14 + mantissaBits))));
+
+	// Shifts by a register, as the count isn't a constant
+	__m128i shift = _mm_cvtsi32_si128(23 - mantissaBits);
+	__m128i bits = _mm_castps_si128(value);
+	__m128i odd = _mm_and_si128(_mm_srl_epi32(bits, shift), _mm_set1_epi32(1));
+	bits = _mm_add_epi32(bits, _mm_add_epi32(_mm_set1_epi32((1 << (22 - mantissaBits)) - 1), odd));
+	__m128i normal = _mm_sub_epi32(_mm_srl_epi32(bits, shift), _mm_set1_epi32(112 << mantissaBits));
+
+	__m128 isDenormal = _mm_cmplt_ps(value, _mm_set1_ps(MinNormalFloat11));
+	return _mm_castps_si128(Select(isDenormal, _mm_castsi128_ps(denormal), _mm_castsi128_ps(normal)));
+}
+
+static __m128 UnpackSmallFloat4(__m128i bits, int mantissaBits)
+{
+	__m128 denormal = _mm_mul_ps(_mm_cvtepi32_ps(bits), _mm_set1_ps(ldexpf(1.0f, -14 - mantissaBits)));
+	__m128i normal = _mm_add_epi32(_mm_sll_epi32(bits, _mm_cvtsi32_si128(23 - mantissaBits)), _mm_set1_epi32(112 << 23));
+	__m128 isDenormal = _mm_castsi128_ps(_mm_cmplt_epi32(bits, _mm_set1_epi32(1 << mantissaBits)));
+	return Select(isDenormal, denormal, _mm_castsi128_ps(normal));
+}
+
+static __m128i PackR11G11B10Fx4(__m128 r, __m128 g, __m128 b)
+{
+	__m128i packed = PackSmallFloat4(r, MaxFloat11, 6);
+	packed = _mm_or_si128(packed, _mm_slli_epi32(PackSmallFloat4(g, MaxFloat11, 6), 11));
+	return _mm_or_si128(packed, _mm_slli_epi32(PackSmallFloat4(b, MaxFloat10, 5), 22));
+}
+
+static void UnpackR11G11B10Fx4(__m128i packed, __m128& r, __m128& g, __m128& b)
+{
+	const __m128i float11Mask = _mm_set1_epi32(0x7FF);
+	r = UnpackSmallFloat4(_mm_and_si128(packed, float11Mask), 6);
+	g = UnpackSmallFloat4(_mm_and_si128(_mm_srli_epi32(packed, 11), float11Mask), 6);
+	b = UnpackSmallFloat4(_mm_srli_epi32(packed, 22), 5);
+}
+
+static __m128i PackRGBMx4(__m128 r, __m128 g, __m128 b)
+{
+	r = Sanitize4(r, PackedHDRRGBMRange);
+	g = Sanitize4(g, PackedHDRRGBMRange);
+	b = Sanitize4(b, PackedHDRRGBMRange);
+	__m128 maxChannel = _mm_max_ps(r, _mm_max_ps(g, b));
+
+	// Ceiling of a non-negative value, at least 1
+	__m128 multiplier = _mm_mul_ps(maxChannel, _mm_set1_ps(255.0f / PackedHDRRGBMRange));
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(multiplier));
+	multiplier = _mm_add_ps(truncated, _mm_and_ps(_mm_cmplt_ps(truncated, multiplier), _mm_set1_ps(1.0f)));
+	multiplier = _mm_max_ps(multiplier, _mm_set1_ps(1.0f));
+
+	__m128 scale = _mm_div_ps(_mm_set1_ps(65025.0f), _mm_mul_ps(multiplier, _mm_set1_ps(PackedHDRRGBMRange)));
+	__m128i maxByte = _mm_set1_epi32(255);
+	auto channel = [&](__m128 value)
+	{
+		__m128i rounded = _mm_cvtps_epi32(_mm_mul_ps(value, scale));
+		__m128i over = _mm_cmpgt_epi32(rounded, maxByte);
+		return _mm_or_si128(_mm_and_si128(over, maxByte), _mm_andnot_si128(over, rounded));
+	};
+
+	__m128i packed = channel(r);
+	packed = _mm_or_si128(packed, _mm_slli_epi32(channel(g), 8));
+	packed = _mm_or_si128(packed, _mm_slli_epi32(channel(b), 16));
+	return _mm_or_si128(packed, _mm_slli_epi32(_mm_cvttps_epi32(multiplier), 24));
+}
+
+static void UnpackRGBMx4(__m128i packed, __m128& r, __m128& g, __m128& b)
+{
+	const __m128i byteMask = _mm_set1_epi32(0xFF);
+	__m128 scale = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(packed, 24)), _mm_set1_ps(PackedHDRRGBMRange / 65025.0f));
+	r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(packed, byteMask)), scale);
+	g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 8), byteMask)), scale);
+	b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 16), byteMask)), scale);
+}
+#endif
+
+void PackHDR(const float* rgb, size_t count, PackedHDRFormat format, uint32_t* packed)
+{
+	size_t i = 0;
+#if PACKED_HDR_SSE2
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 r, g, b;
+		LoadRGB4(rgb + i * 3, r, g, b);
+		__m128i texels;
+		switch (format)
+		{
+		case PACKED_HDR_RGB9E5: texels = PackRGB9E5x4(r, g, b); break;
+		case PACKED_HDR_R11G11B10F: texels = PackR11G11B10Fx4(r, g, b); break;
+		default: texels = PackRGBMx4(r, g, b); break;
+		}
+		_mm_storeu_si128((__m128i*)(packed + i), texels);
+	}
+#endif
+
+	for (; i < count; i++)
+		packed[i] = PackHDRTexel(rgb + i * 3, format);
+}
+
+void UnpackHDR(const uint32_t* packed, size_t count, PackedHDRFormat format, float* rgb)
+{
+	size_t i = 0;
+#if PACKED_HDR_SSE2
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i texels = _mm_loadu_si128((const __m128i*)(packed + i));
+		__m128 r, g, b;
+		switch (format)
+		{
+		case PACKED_HDR_RGB9E5: UnpackRGB9E5x4(texels, r, g, b); break;
+		case PACKED_HDR_R11G11B10F: UnpackR11G11B10Fx4(texels, r, g, b); break;
+		default: UnpackRGBMx4(texels, r, g, b); break;
+		}
+		StoreRGB4(r, g, b, rgb + i * 3);
+	}
+#endif
+
+	for (; i < count; i++)
+		UnpackHDRTexel(packed[i], format, rgb + i * 3);
+}
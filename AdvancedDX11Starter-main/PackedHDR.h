@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// 32 bit HDR color formats for textures that don't need
+// alpha, in place of gamma encoded RGBA8 (which clips at 1):
+//
+//  RGB9E5     - 9 bit mantissas sharing a 5 bit exponent, up
+//               to 65408.  Within 1/512 of the brightest
+//               channel; dimmer ones share its step size.
+//  R11G11B10F - Unsigned floats with 6 bit (red, green) and
+//               5 bit (blue) mantissas, up to 65024 (64512
+//               for blue).  Within 1/128 (blue 1/64) of each
+//               channel on its own.  Unlike RGB9E5 it can be
+//               rendered to.
+//  RGBM       - 8 bit color times an 8 bit multiplier, up to
+//               PackedHDRRGBMRange, in an RGBA8 texture for
+//               hardware without the others.  Filtering blends
+//               the encoded values, which isn't linear.
+//
+// Conversion follows D3D's rules: negative and NaN values
+// become 0 and anything too large the largest value.  Each
+// format has a single texel version, which the batch
+// versions (SSE2 when available, 4 texels at a time) match
+// bit for bit, which the tests check against each other on
+// whatever CPU they run on.
+// --------------------------------------------------------
+enum PackedHDRFormat
+{
+	PACKED_HDR_RGB9E5,
+	PACKED_HDR_R11G11B10F,
+	PACKED_HDR_RGBM
+};
+
+// RGBM's largest value, which a decoding shader has to use
+// too
+const float PackedHDRRGBMRange = 8.0f;
+
+const char* GetPackedHDRFormatName(PackedHDRFormat format);
+
+// The matching DXGI_FORMAT value
+uint32_t GetPackedHDRDXGIFormat(PackedHDRFormat format);
+
+uint32_t PackHDRTexel(const float rgb[3], PackedHDRFormat format);
+void UnpackHDRTexel(uint32_t packed, PackedHDRFormat format, float rgb[3]);
+
+// count texels of tightly packed linear RGB floats to and
+// from the format, one uint32_t each
+void PackHDR(const float* rgb, size_t count, PackedHDRFormat format, uint32_t* packed);
+void UnpackHDR(const uint32_t* packed, size_t count, PackedHDRFormat format, float* rgb);
@@ -0,0 +1,199 @@
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Bands ParallelForBands() aims for per thread, so one slow
+// band doesn't leave the rest of the threads idle
+static const unsigned int BandsPerThread = 4;
+
+// One ParallelFor() call's items.  Shared with the workers,
+// so one that picks it up late can still safely see that
+// every item has been claimed.
+struct ParallelJob
+{
+	const std::function<void(unsigned int)>* Work;
+	unsigned int ItemCount;
+	unsigned int MaxHelpers;	// Workers allowed to join the caller
+	unsigned int Helpers;		// Workers that have joined (under the pool's lock)
+	std::atomic<unsigned int> NextItem;
+	std::atomic<unsigned int> FinishedItems;
+};
+
+// --------------------------------------------------------
+// The worker threads, and a queue of jobs that still want
+// more of them
+// --------------------------------------------------------
+class ParallelPool
+{
+public:
+	ParallelPool();
+	~ParallelPool();
+
+	void Run(const std::shared_ptr<ParallelJob>& job);
+	unsigned int GetThreadCount() { return (unsigned int)threads.size() + 1; }
+
+private:
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable jobFinished;
+	std::deque<std::shared_ptr<ParallelJob>> jobs;
+	std::vector<std::thread> threads;
+	bool quitting;
+
+	void WorkerLoop();
+	void WorkOn(ParallelJob* job);
+};
+
+ParallelPool::ParallelPool()
+	: quitting(false)
+{
+	unsigned int hardwareThreads = (std::max)(1u, std::thread::hardware_concurrency());
+	for (unsigned int t = 1; t < hardwareThreads; t++)
+		threads.emplace_back(&ParallelPool::WorkerLoop, this);
+}
+
+ParallelPool::~ParallelPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quitting = true;
+	}
+	jobAvailable.notify_all();
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+// --------------------------------------------------------
+// Claims and runs items until there are none left,
+// waking the job's caller after the last one finishes
+// --------------------------------------------------------
+void ParallelPool::WorkOn(ParallelJob* job)
+{
+	for (unsigned int item = job->NextItem++; item < job->ItemCount; item = job->NextItem++)
+	{
+		(*job->Work)(item);
+		if (++job->FinishedItems == job->ItemCount)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobFinished.notify_all();
+		}
+	}
+}
+
+void ParallelPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::shared_ptr<ParallelJob> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [&]() { return quitting || !jobs.empty(); });
+			if (quitting)
+				return;
+
+			job = jobs.front();
+			if (++job->Helpers >= job->MaxHelpers)
+				jobs.pop_front();
+		}
+
+		WorkOn(job.get());
+	}
+}
+
+void ParallelPool::Run(const std::shared_ptr<ParallelJob>& job)
+{
+	if (job->MaxHelpers > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(job);
+		}
+
+		if (job->MaxHelpers == 1)
+			jobAvailable.notify_one();
+		else
+			jobAvailable.notify_all();
+	}
+
+	WorkOn(job.get());
+
+	// Every item is claimed, so stop offering the job, and
+	// wait for any still running elsewhere
+	std::unique_lock<std::mutex> lock(mutex);
+	std::deque<std::shared_ptr<ParallelJob>>::iterator queued = std::find(jobs.begin(), jobs.end(), job);
+	if (queued != jobs.end())
+		jobs.erase(queued);
+
+	jobFinished.wait(lock, [&]() { return job->FinishedItems == job->ItemCount; });
+}
+
+// Started on first use, rather than before main()
+static ParallelPool& GetPool()
+{
+	static ParallelPool pool;
+	return pool;
+}
+
+void ParallelFor(unsigned int itemCount, unsigned int threadCount, const std::function<void(unsigned int)>& work)
+{
+	if (itemCount == 0)
+		return;
+
+	ParallelPool& pool = GetPool();
+	if (threadCount == 0 || threadCount > pool.GetThreadCount())
+		threadCount = pool.GetThreadCount();
+	threadCount = (std::min)(threadCount, itemCount);
+
+	if (threadCount <= 1)
+	{
+		for (unsigned int item = 0; item < itemCount; item++)
+			work(item);
+		return;
+	}
+
+	std::shared_ptr<ParallelJob> job = std::make_shared<ParallelJob>();
+	job->Work = &work;
+	job->ItemCount = itemCount;
+	job->MaxHelpers = threadCount - 1;
+	job->Helpers = 0;
+	job->NextItem = 0;
+	job->FinishedItems = 0;
+	pool.Run(job);
+}
+
+void ParallelForBands(unsigned int count, unsigned int minBandSize, unsigned int threadCount, const std::function<void(unsigned int, unsigned int)>& work)
+{
+	if (count == 0)
+		return;
+
+	unsigned int poolThreads = GetPool().GetThreadCount();
+	if (threadCount == 0 || threadCount > poolThreads)
+		threadCount = poolThreads;
+
+	unsigned int bands = threadCount > 1 ? threadCount * BandsPerThread : 1;
+	bands = (std::max)(1u, (std::min)(bands, count / (std::max)(1u, minBandSize)));
+	if (bands == 1)
+	{
+		work(0, count);
+		return;
+	}
+
+	ParallelFor(bands, threadCount, [&](unsigned int band)
+	{
+		work((unsigned int)((uint64_t)count * band / bands), (unsigned int)((uint64_t)count * (band + 1) / bands));
+	});
+}
+
+unsigned int GetParallelThreadCount()
+{
+	return GetPool().GetThreadCount();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+
+// --------------------------------------------------------
+// Runs work(item) for every item in [0, itemCount), spread
+// over a pool of worker threads that's started once and
+// kept for the life of the program.  The calling thread
+// works on items too, and the call returns once all of
+// them are done.
+//
+// threadCount - Most threads to use, counting the caller,
+//               or 0 for every hardware thread
+//
+// Calls may come from any thread, including from inside
+// another ParallelFor's work.  Items are handed out one at
+// a time as threads free up, so uneven items balance out;
+// for very cheap ones, make each item a band of work.
+// --------------------------------------------------------
+void ParallelFor(unsigned int itemCount, unsigned int threadCount, const std::function<void(unsigned int)>& work);
+
+// --------------------------------------------------------
+// ParallelFor() over contiguous bands of [0, count), for
+// items too cheap to hand out one at a time.  Calls
+// work(first, end) for each band.  Bands have at least
+// minBandSize items (bar a short total), and there are a
+// few per thread so uneven ones still balance out.
+// --------------------------------------------------------
+void ParallelForBands(unsigned int count, unsigned int minBandSize, unsigned int threadCount, const std::function<void(unsigned int, unsigned int)>& work);
+
+// Threads ParallelFor() can use at once, counting the caller
+unsigned int GetParallelThreadCount();
@@ -0,0 +1,68 @@
+#include "ParticleRing.h"
+
+ParticleRing::ParticleRing(int capacity)
+{
+	Reset(capacity);
+}
+
+void ParticleRing::Reset()
+{
+	firstAliveIndex = 0;
+	firstDeadIndex = 0;
+	aliveCount = 0;
+}
+
+void ParticleRing::Reset(int capacity)
+{
+	this->capacity = capacity > 0 ? capacity : 0;
+	spawnTimes.assign(this->capacity, 0.0f);
+	Reset();
+}
+
+int ParticleRing::Spawn(float time)
+{
+	if (aliveCount == capacity)
+		return -1;
+
+	int slot = firstDeadIndex;
+	spawnTimes[slot] = time;
+	if (++firstDeadIndex == capacity)
+		firstDeadIndex = 0;
+	aliveCount++;
+	return slot;
+}
+
+// --------------------------------------------------------
+// Particles sit in the ring in the order they spawned, all
+// with the same lifetime, so only the oldest can have
+// expired: pop from the front until one hasn't.  That's
+// O(deaths) per frame rather than checking every live
+// particle's age.
+// --------------------------------------------------------
+void ParticleRing::Retire(float currentTime, float lifetime)
+{
+	while (aliveCount > 0 && currentTime - spawnTimes[firstAliveIndex] >= lifetime)
+	{
+		if (++firstAliveIndex == capacity)
+			firstAliveIndex = 0;
+		aliveCount--;
+	}
+}
+
+int ParticleRing::GetAliveSpans(Span spans[2])
+{
+	if (aliveCount == 0)
+		return 0;
+
+	// A full ring starts wherever the first alive index is,
+	// so it can wrap too
+	if (firstAliveIndex + aliveCount <= capacity)
+	{
+		spans[0] = { firstAliveIndex, aliveCount };
+		return 1;
+	}
+
+	spans[0] = { firstAliveIndex, capacity - firstAliveIndex };
+	spans[1] = { 0, firstDeadIndex };
+	return 2;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// Which slots of an emitter's particle array are alive.
+// Particles spawn into the slot after the newest and all
+// share one lifetime, so they die in the order they were
+// born: the live ones always run from the first alive slot
+// up to (but not including) the first dead one, wrapping
+// at the end.  It only hands out slots - the particles
+// themselves belong to whoever owns the ring (see Emitter)
+// - so it can be used and tested without a device.
+// --------------------------------------------------------
+class ParticleRing
+{
+public:
+	// A run of live slots
+	struct Span
+	{
+		int First;
+		int Count;
+	};
+
+	ParticleRing(int capacity = 0);
+
+	// Kills every particle, optionally resizing
+	void Reset();
+	void Reset(int capacity);
+
+	// Returns the slot for a particle spawned at "time", or
+	// -1 if every slot is alive
+	int Spawn(float time);
+
+	// Kills every particle at least "lifetime" old
+	void Retire(float currentTime, float lifetime);
+
+	// The live slots as at most two runs, oldest first, so
+	// they can be copied out in spawn order.  Returns how
+	// many runs there are.
+	int GetAliveSpans(Span spans[2]);
+
+	int GetCapacity() { return capacity; }
+	int GetAliveCount() { return aliveCount; }
+	int GetFirstAliveIndex() { return firstAliveIndex; }
+	int GetFirstDeadIndex() { return firstDeadIndex; }
+
+private:
+	int capacity;
+	int firstAliveIndex;
+	int firstDeadIndex;
+
+	// The indices match both when empty and when full, so
+	// the count tells them apart
+	int aliveCount;
+
+	// Each slot's spawn time, packed together so retiring
+	// doesn't have to walk whole particles
+	std::vector<float> spawnTimes;
+};
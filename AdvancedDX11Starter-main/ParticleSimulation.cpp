@@ -0,0 +1,73 @@
+#include "ParticleSimulation.h"
+
+#include <stdlib.h>
+
+using namespace DirectX;
+
+ParticleSimulation::ParticleSimulation(int maxParticles, int particlesPerSecond, float lifetime)
+	: ring(maxParticles)
+{
+	particles.resize(maxParticles > 0 ? maxParticles : 0, Particle{});
+
+	this->secondsPerParticle = (float)(1.0 / particlesPerSecond);
+	this->timeSinceEmit = 0;
+	this->lifetime = lifetime;
+
+	position = XMFLOAT3(0, 0, 0);
+	startVelocity = XMFLOAT3(0, 0, 0);
+	positionRandomRange = XMFLOAT3(0, 0, 0);
+	velocityRandomRange = XMFLOAT3(0, 0, 0);
+	rotationStart = XMFLOAT2(0, 0);
+	rotationEnd = XMFLOAT2(0, 0);
+}
+
+void ParticleSimulation::SetRandomRanges(XMFLOAT3 positionRange, XMFLOAT3 velocityRange)
+{
+	positionRandomRange = positionRange;
+	velocityRandomRange = velocityRange;
+}
+
+void ParticleSimulation::SetRotationRanges(XMFLOAT2 start, XMFLOAT2 end)
+{
+	rotationStart = start;
+	rotationEnd = end;
+}
+
+void ParticleSimulation::Simulate(float dt, float currentTime)
+{
+	ring.Retire(currentTime, lifetime);
+
+	//build up time towards the next spawn
+	timeSinceEmit += dt;
+
+	//spawn more particles if it's time
+	while (timeSinceEmit > secondsPerParticle) {
+		SpawnParticle(currentTime);
+		timeSinceEmit -= secondsPerParticle;
+	}
+}
+
+void ParticleSimulation::SpawnParticle(float currentTime)
+{
+	//only spawn if we aren't at max particles
+	int slot = ring.Spawn(currentTime);
+	if (slot >= 0) {
+		particles[slot].spawnTime = currentTime;
+
+		//get random position based around the emitter's position
+		DirectX::XMFLOAT3 tempPos = position;
+		tempPos.x += (((float)rand() / RAND_MAX) * 2 - 1) * positionRandomRange.x;
+		tempPos.y += (((float)rand() / RAND_MAX) * 2 - 1) * positionRandomRange.y;
+		tempPos.z += (((float)rand() / RAND_MAX) * 2 - 1) * positionRandomRange.z;
+		particles[slot].startPos = tempPos;
+
+		DirectX::XMFLOAT3 tempVelocity = startVelocity;
+		tempVelocity.x += (rand()) / (float)(RAND_MAX / (velocityRandomRange.x * 2));
+		tempVelocity.y += (rand()) / (float)(RAND_MAX / (velocityRandomRange.y * 2));
+		tempVelocity.z += (rand()) / (float)(RAND_MAX / (velocityRandomRange.z * 2));
+		particles[slot].startVelocity = tempVelocity;
+
+		particles[slot].startRotation = ((float)(rand()) / (float)RAND_MAX) * (rotationStart.y - rotationStart.x) + rotationStart.x;
+		particles[slot].endRotation = ((float)(rand()) / (float)RAND_MAX) * (rotationEnd.y - rotationEnd.x) + rotationEnd.x;
+	}
+}
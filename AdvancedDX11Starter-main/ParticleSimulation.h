@@ -0,0 +1,69 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "ParticleRing.h"
+
+// One particle as the GPU sees it: where and how it started
+// out, with everything else worked out in the vertex shader
+// from its age
+struct Particle {
+	float spawnTime;
+	DirectX::XMFLOAT3 startPos;
+
+	DirectX::XMFLOAT3 startVelocity;
+	float startRotation;
+	float endRotation;
+	DirectX::XMFLOAT3 padding;
+
+};
+
+// --------------------------------------------------------
+// The CPU half of an emitter: spawning particles at a
+// steady rate and retiring them once they're too old.
+// Emitter copies the live ones to the GPU and draws them;
+// nothing here needs a device, so it can be used (and
+// timed) anywhere.
+// --------------------------------------------------------
+class ParticleSimulation
+{
+public:
+	ParticleSimulation(int maxParticles, int particlesPerSecond, float lifetime);
+
+	// Where new particles start and how they move
+	void SetPosition(DirectX::XMFLOAT3 position) { this->position = position; }
+	void SetStartVelocity(DirectX::XMFLOAT3 velocity) { startVelocity = velocity; }
+	void SetRandomRanges(DirectX::XMFLOAT3 positionRange, DirectX::XMFLOAT3 velocityRange);
+	void SetRotationRanges(DirectX::XMFLOAT2 start, DirectX::XMFLOAT2 end);
+
+	// Retires expired particles, then spawns as many as the
+	// time since the last spawn pays for
+	void Simulate(float dt, float currentTime);
+
+	// The live particles as at most two runs of the array,
+	// oldest first (see ParticleRing)
+	int GetAliveSpans(ParticleRing::Span spans[2]) { return ring.GetAliveSpans(spans); }
+	const Particle* GetParticles() { return particles.data(); }
+
+	int GetAliveCount() { return ring.GetAliveCount(); }
+	int GetMaxParticles() { return ring.GetCapacity(); }
+	float GetLifetime() { return lifetime; }
+
+private:
+	std::vector<Particle> particles;
+	ParticleRing ring;
+
+	float secondsPerParticle;
+	float timeSinceEmit;
+	float lifetime;
+
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 startVelocity;
+	DirectX::XMFLOAT3 positionRandomRange;
+	DirectX::XMFLOAT3 velocityRandomRange;
+	DirectX::XMFLOAT2 rotationStart;
+	DirectX::XMFLOAT2 rotationEnd;
+
+	void SpawnParticle(float currentTime);
+};
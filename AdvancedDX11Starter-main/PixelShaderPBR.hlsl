@@ -56,13 +56,12 @@ struct PS_Output {
 // Texture-related variables
 Texture2D Albedo			: register(t0);
 Texture2D NormalMap			: register(t1);
-Texture2D RoughnessMap		: register(t2);
-Texture2D MetalMap			: register(t3);
+Texture2D OcclusionRoughnessMetalMap	: register(t2);	// R occlusion, G roughness, B metal
 
 // IBL (indirect PBR) textures
-Texture2D BrdfLookUpMap : register(t4);
-TextureCube IrradianceIBLMap : register(t5);
-TextureCube SpecularIBLMap : register(t6);
+Texture2D BrdfLookUpMap : register(t3);
+TextureCube IrradianceIBLMap : register(t4);
+TextureCube SpecularIBLMap : register(t5);
 
 SamplerState BasicSampler	: register(s0);
 SamplerState ClampSampler : register(s1);
@@ -80,8 +79,10 @@ PS_Output main(VertexToPixel input) : SV_TARGET
 
 	// Sample various textures
 	input.normal = NormalMapping(NormalMap, BasicSampler, input.uv, input.normal, input.tangent);
-	float roughness = RoughnessMap.Sample(BasicSampler, input.uv).r;
-	float metal = MetalMap.Sample(BasicSampler, input.uv).r;
+	float3 orm = OcclusionRoughnessMetalMap.Sample(BasicSampler, input.uv).rgb;
+	float occlusion = orm.r;
+	float roughness = orm.g;
+	float metal = orm.b;
 
 	// Gamma correct the texture back to linear space and apply the color tint
 	float4 surfaceColor = Albedo.Sample(BasicSampler, input.uv);
@@ -120,13 +121,13 @@ PS_Output main(VertexToPixel input) : SV_TARGET
 	float3 viewRefl = normalize(reflect(-viewToCam, input.normal));
 	float NdotV = saturate(dot(input.normal, viewToCam));
 	
-	// Indirect lighting
-	float3 indirectDiffuse = IndirectDiffuse(IrradianceIBLMap, BasicSampler, input.normal);
+	// Indirect lighting (the only part occlusion applies to)
+	float3 indirectDiffuse = IndirectDiffuse(IrradianceIBLMap, BasicSampler, input.normal) * occlusion;
 	float3 indirectSpecular = IndirectSpecular(
 		SpecularIBLMap, SpecIBLTotalMipLevels,
 		BrdfLookUpMap, ClampSampler, // MUST use the clamp sampler here!
 		viewRefl, NdotV,
-		roughness, specColor);
+		roughness, specColor) * occlusion;
 
 	// Balance indirect diff/spec
 //	float3 balancedDiff = DiffuseEnergyConserve(indirectDiffuse, indirectSpecular, metal);
@@ -0,0 +1,1270 @@
+#include "PortableBenchmarks.h"
+#include "BlockCompression.h"
+#include "BRDFLookUp.h"
+#include "Clock.h"
+#include "ConstantBufferData.h"
+#include "EquirectCubemap.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "PackedHDR.h"
+#include "ParticleRing.h"
+#include "PNGDecoder.h"
+#include "ProceduralSky.h"
+#include "Profiler.h"
+#include "RingAllocator.h"
+#include "SpecularPrefilter.h"
+#include "SphericalHarmonics.h"
+#include "TextureResidency.h"
+
+#include "ImGui/imgui.h"
+
+// DirectXMath ships with the Windows SDK; elsewhere CMake
+// defines this when it finds the headers
+#if defined(_WIN32) && !defined(ENGINE_HAS_DIRECTXMATH)
+#define ENGINE_HAS_DIRECTXMATH
+#endif
+
+#ifdef ENGINE_HAS_DIRECTXMATH
+#include "OBJLoader.h"
+#include "ParticleSimulation.h"
+#include "Transform.h"
+#endif
+
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+// Results get written here so the compiler can't
+// throw away work whose output is never used
+static volatile float benchmarkSink;
+
+// --------------------------------------------------------
+// The cost of a PROFILE_ZONE: a begin/end pair, both flat
+// and nested a few deep the way real frames are, against
+// the profiler's budget of 50 ns per zone.  The two
+// timestamps a zone reads are timed on their own too, as
+// under some hypervisors reading the TSC traps and costs
+// far more than the zone's own bookkeeping.
+// --------------------------------------------------------
+static void BenchmarkProfiler(Benchmark& benchmark)
+{
+	const int zoneCounts[] = { 1000, 100000 };
+	for (int count : zoneCounts)
+	{
+		const BenchmarkResult& timestamps = benchmark.Run("Profiler timestamp pair", std::to_string(count), count,
+			[&]()
+			{
+				uint64_t sum = 0;
+				for (int i = 0; i < count; i++)
+				{
+					sum += Profiler::Now();
+					sum += Profiler::Now();
+				}
+				benchmarkSink = (float)sum;
+			});
+		double timestampNs = timestamps.MedianMs * 1e6 / count;
+
+		const BenchmarkResult& flat = benchmark.Run("Profiler zone", std::to_string(count), count,
+			[&]()
+			{
+				for (int i = 0; i < count; i++)
+				{
+					PROFILE_ZONE("Benchmark");
+				}
+			});
+		double flatNs = flat.MedianMs * 1e6 / count;
+
+		const BenchmarkResult& nested = benchmark.Run("Profiler nested zone", std::to_string(count), count,
+			[&]()
+			{
+				for (int i = 0; i < count; i += 4)
+				{
+					PROFILE_ZONE("Outer");
+					{
+						PROFILE_ZONE("Middle");
+						{
+							PROFILE_ZONE("Inner");
+							PROFILE_ZONE("Innermost");
+						}
+					}
+				}
+			});
+		double nestedNs = nested.MedianMs * 1e6 / count;
+
+		printf("  Profiler: %.1f ns per zone flat, %.1f ns nested, %.1f ns of it reading timestamps (budget 50 ns)\n",
+			flatNs, nestedNs, timestampNs);
+	}
+}
+
+// The size of Emitter's Particle, so the old way's scan
+// walks memory at the same stride
+struct ScannedParticle
+{
+	float spawnTime;
+	float Rest[11];
+};
+
+// --------------------------------------------------------
+// Particles in spawn order, retired the way Emitter did
+// before ParticleRing: every live particle's age checked
+// every frame.  Kept as the baseline ParticleRing is timed
+// against.
+// --------------------------------------------------------
+struct ScannedParticles
+{
+	std::vector<ScannedParticle> Particles;
+	int FirstAlive = 0;
+	int FirstDead = 0;
+	int Alive = 0;
+
+	void Spawn(float time, int count)
+	{
+		int size = (int)Particles.size();
+		for (int i = 0; i < count && Alive < size; i++)
+		{
+			Particles[FirstDead].spawnTime = time;
+			FirstDead = (FirstDead + 1) % size;
+			Alive++;
+		}
+	}
+
+	void RetireByScan(float time, float lifetime)
+	{
+		int size = (int)Particles.size();
+		auto check = [&](int i)
+		{
+			if (time - Particles[i].spawnTime >= lifetime)
+			{
+				FirstAlive = (FirstAlive + 1) % size;
+				Alive--;
+			}
+		};
+
+		if (Alive > 0)
+		{
+			if (FirstAlive < FirstDead)
+			{
+				for (int i = FirstAlive; i < FirstDead; i++)
+					check(i);
+			}
+			else if (FirstAlive > FirstDead)
+			{
+				for (int i = FirstAlive; i < size; i++)
+					check(i);
+				for (int i = 0; i < FirstDead; i++)
+					check(i);
+			}
+			else
+			{
+				for (int i = 0; i < size; i++)
+					check(i);
+			}
+		}
+	}
+};
+
+// --------------------------------------------------------
+// Emitter's particle bookkeeping alone, the old scan next
+// to ParticleRing, in the same steady state as the emitter
+// benchmarks: about count / 60 particles die and spawn
+// each frame
+// --------------------------------------------------------
+static void BenchmarkParticleRing(Benchmark& benchmark)
+{
+	const float dt = 1.0f / 60.0f;
+	const int ringCounts[] = { 10000, 100000, 1000000 };
+	for (int count : ringCounts)
+	{
+		ScannedParticles scanned;
+		scanned.Particles.resize(count);
+		ParticleRing ring(count);
+		int perFrame = count / 60;
+
+		float scanTime = 0.0f;
+		auto scanFrame = [&]()
+		{
+			scanned.RetireByScan(scanTime, 1.0f);
+			scanned.Spawn(scanTime, perFrame);
+			scanTime += dt;
+		};
+		float ringTime = 0.0f;
+		auto ringFrame = [&]()
+		{
+			ring.Retire(ringTime, 1.0f);
+			for (int i = 0; i < perFrame; i++)
+				ring.Spawn(ringTime);
+			ringTime += dt;
+		};
+		for (int i = 0; i < 90; i++)
+		{
+			scanFrame();
+			ringFrame();
+		}
+
+		double scanMs = benchmark.Run("Particle retirement scan", std::to_string(count), scanned.Alive, scanFrame).MedianMs;
+		double ringMs = benchmark.Run("ParticleRing retire and spawn", std::to_string(count), ring.GetAliveCount(), ringFrame).MedianMs;
+		printf("  Particles: ParticleRing %.1fx faster than the scan at %d\n",
+			ringMs > 0.0 ? scanMs / ringMs : 0.0, count);
+	}
+}
+
+#ifdef ENGINE_HAS_DIRECTXMATH
+// --------------------------------------------------------
+//  A wavy grid with gridSize x gridSize vertices, so the
+//  tangent calculation has real (non-flat) work to do
+// --------------------------------------------------------
+static void MakeGridMesh(int gridSize, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.resize((size_t)gridSize * gridSize);
+	indices.clear();
+	indices.reserve((size_t)(gridSize - 1) * (gridSize - 1) * 6);
+
+	for (int y = 0; y < gridSize; y++)
+	{
+		for (int x = 0; x < gridSize; x++)
+		{
+			float u = x / (float)(gridSize - 1);
+			float v = y / (float)(gridSize - 1);
+			Vertex& vert = verts[(size_t)y * gridSize + x];
+			vert.Position = DirectX::XMFLOAT3(u * 10.0f, sinf(u * 20.0f) * cosf(v * 20.0f), v * 10.0f);
+			vert.Normal = DirectX::XMFLOAT3(0, 1, 0);
+			vert.UV = DirectX::XMFLOAT2(u, v);
+			vert.Tangent = DirectX::XMFLOAT3(0, 0, 0);
+		}
+	}
+
+	for (int y = 0; y < gridSize - 1; y++)
+	{
+		for (int x = 0; x < gridSize - 1; x++)
+		{
+			unsigned int i = y * gridSize + x;
+			indices.push_back(i);
+			indices.push_back(i + gridSize);
+			indices.push_back(i + 1);
+			indices.push_back(i + 1);
+			indices.push_back(i + gridSize);
+			indices.push_back(i + gridSize + 1);
+		}
+	}
+}
+
+static void BenchmarkMeshes(Benchmark& benchmark, const std::string& assetFolder)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+
+	// Parsing each of the bundled models
+	const char* models[] = { "cube", "cone", "cylinder", "sphere", "torus", "helix" };
+	for (const char* model : models)
+	{
+		std::string path = assetFolder + "Models/" + model + ".obj";
+		if (!LoadOBJ(path.c_str(), verts, indices))
+		{
+			printf("Skipping %s - could not load %s\n", model, path.c_str());
+			continue;
+		}
+
+		benchmark.Run("LoadOBJ", model, verts.size(),
+			[&]() { LoadOBJ(path.c_str(), verts, indices); });
+	}
+
+	// Tangents on synthetic grids of increasing size
+	const int gridSizes[] = { 32, 128, 512 };
+	for (int gridSize : gridSizes)
+	{
+		MakeGridMesh(gridSize, verts, indices);
+		benchmark.Run("CalculateTangents", std::to_string(verts.size()), verts.size(),
+			[&]()
+			{
+				CalculateTangents(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+				benchmarkSink = verts[0].Tangent.x;
+			});
+	}
+}
+
+static void BenchmarkTransforms(Benchmark& benchmark)
+{
+	const int counts[] = { 1000, 10000, 100000 };
+	for (int count : counts)
+	{
+		std::vector<Transform> transforms(count);
+		for (int i = 0; i < count; i++)
+			transforms[i].SetPosition((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000));
+
+		// Dirty each transform, then fetch both matrices
+		// like Material::PrepareMaterial() does
+		benchmark.Run("Transform::UpdateMatrices", std::to_string(count), count,
+			[&]()
+			{
+				float sum = 0.0f;
+				for (Transform& t : transforms)
+				{
+					t.Rotate(0.0f, 0.001f, 0.0f);
+					sum += t.GetWorldMatrix()._11;
+					sum += t.GetWorldInverseTransposeMatrix()._11;
+				}
+				benchmarkSink = sum;
+			});
+	}
+}
+
+// --------------------------------------------------------
+// An emitter's CPU work each step: retiring, then spawning
+// with random positions and velocities
+// --------------------------------------------------------
+static void BenchmarkParticleSimulation(Benchmark& benchmark)
+{
+	const float dt = 1.0f / 60.0f;
+	const int counts[] = { 1000, 10000, 100000 };
+	for (int count : counts)
+	{
+		// One second lifetime at "count" per second, so the
+		// emitter runs full once it reaches a steady state
+		ParticleSimulation simulation(count, count, 1.0f);
+		simulation.SetStartVelocity(DirectX::XMFLOAT3(0, 1, 0));
+		simulation.SetRandomRanges(DirectX::XMFLOAT3(1, 1, 1), DirectX::XMFLOAT3(1, 1, 1));
+		simulation.SetRotationRanges(DirectX::XMFLOAT2(0, 1), DirectX::XMFLOAT2(0, 1));
+
+		float time = 0.0f;
+		for (int i = 0; i < 90; i++, time += dt)
+			simulation.Simulate(dt, time);
+
+		benchmark.Run("ParticleSimulation::Simulate", std::to_string(count), simulation.GetAliveCount(),
+			[&]() { simulation.Simulate(dt, time); time += dt; });
+	}
+}
+#endif
+
+// --------------------------------------------------------
+// SimpleShader's CPU side of setting variables: writes
+// into the local copies of VertexShader's externalData and
+// PixelShaderPBR's two buffers, at their offsets, then the
+// copy of the changed range that precedes each upload.
+// --------------------------------------------------------
+static void BenchmarkConstantBuffers(Benchmark& benchmark)
+{
+	ConstantBufferData externalData(256);
+	ConstantBufferData perMaterial(32);
+	ConstantBufferData perFrame(8224);
+	unsigned char staging[8224];
+
+	float matrix[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	float colorTint[3] = { 1, 1, 1 };
+	float uvScale[2] = { 1, 1 };
+	float uvOffset[2] = { 0, 0 };
+	float cameraPosition[3] = { 0, 0, -5 };
+	int lightCount = 128;
+	std::vector<unsigned char> lights(128 * 64, 0);
+
+	auto setFrame = [&]()
+	{
+		perFrame.Write(0, lights.data(), (unsigned int)lights.size());
+		perFrame.Write(8192, &lightCount, sizeof(lightCount));
+		perFrame.Write(8196, cameraPosition, sizeof(cameraPosition));
+	};
+	auto setEntity = [&]()
+	{
+		externalData.Write(0, matrix, sizeof(matrix));
+		externalData.Write(64, matrix, sizeof(matrix));
+		externalData.Write(128, matrix, sizeof(matrix));
+		externalData.Write(192, matrix, sizeof(matrix));
+		perMaterial.Write(0, colorTint, sizeof(colorTint));
+		perMaterial.Write(16, uvScale, sizeof(uvScale));
+		perMaterial.Write(24, uvOffset, sizeof(uvOffset));
+	};
+	auto copy = [&](ConstantBufferData& buffer)
+	{
+		unsigned int start = 0;
+		unsigned int end = 0;
+		if (buffer.GetUploadRange(&start, &end))
+		{
+			memcpy(staging + start, buffer.GetData() + start, end - start);
+			buffer.MarkClean();
+		}
+	};
+
+	const int entityCounts[] = { 1, 100, 1000 };
+	for (int count : entityCounts)
+	{
+		benchmark.Run("SimpleShader Set (CPU)", std::to_string(count), count,
+			[&]()
+			{
+				setFrame();
+				for (int i = 0; i < count; i++)
+					setEntity();
+			});
+
+		// A different world matrix per entity, so every one
+		// of them has something to copy
+		benchmark.Run("SimpleShader Set+Copy (CPU)", std::to_string(count), count,
+			[&]()
+			{
+				setFrame();
+				copy(perFrame);
+				for (int i = 0; i < count; i++)
+				{
+					matrix[12] = (float)i;
+					setEntity();
+					copy(externalData);
+					copy(perMaterial);
+				}
+				benchmarkSink = staging[0];
+			});
+	}
+}
+
+// --------------------------------------------------------
+// Just the CPU side of ImGui: building a frame and its draw
+// lists, without a renderer to submit them to.  Runs in a
+// context of its own, so the game's UI state is untouched.
+// --------------------------------------------------------
+static void BenchmarkImGui(Benchmark& benchmark)
+{
+	ImGuiContext* previousContext = ImGui::GetCurrentContext();
+	ImGuiContext* context = ImGui::CreateContext();
+	ImGui::SetCurrentContext(context);
+
+	// Build the font atlas up front, as a renderer would
+	ImGuiIO& io = ImGui::GetIO();
+	io.IniFilename = 0;
+	unsigned char* fontPixels = 0;
+	int fontWidth = 0;
+	int fontHeight = 0;
+	io.Fonts->GetTexDataAsRGBA32(&fontPixels, &fontWidth, &fontHeight);
+
+	std::vector<float> values(1000, 0.5f);
+	const int widgetCounts[] = { 10, 100, 1000 };
+	for (int count : widgetCounts)
+	{
+		benchmark.Run("ImGui NewFrame+Render", std::to_string(count), count,
+			[&]()
+			{
+				io.DisplaySize = ImVec2(1280, 720);
+				io.DeltaTime = 1.0f / 60.0f;
+				ImGui::NewFrame();
+
+				ImGui::SetNextWindowPos(ImVec2(0, 0));
+				ImGui::SetNextWindowSize(ImVec2(1280, 720));
+				ImGui::Begin("Benchmark", 0, ImGuiWindowFlags_NoSavedSettings);
+				for (int i = 0; i < count; i++)
+				{
+					ImGui::PushID(i);
+					ImGui::BulletText("Item %d", i);
+					ImGui::SameLine();
+					ImGui::SliderFloat("Value", &values[i], 0.0f, 1.0f);
+					ImGui::PopID();
+				}
+				ImGui::End();
+
+				ImGui::Render();
+				benchmarkSink = (float)ImGui::GetDrawData()->TotalVtxCount;
+			});
+	}
+
+	ImGui::DestroyContext(context);
+	ImGui::SetCurrentContext(previousContext);
+}
+
+static void BenchmarkRingAllocator(Benchmark& benchmark)
+{
+	// A frame's worth of draws, each taking a couple of
+	// constant buffer sized slices, with the GPU finishing
+	// frames two behind the CPU
+	const unsigned int framesInFlight = 2;
+	const int drawCounts[] = { 100, 1000, 10000 };
+	for (int count : drawCounts)
+	{
+		RingAllocator ring(count * 2048 * (framesInFlight + 1));
+		uint64_t frame = 0;
+		benchmark.Run("RingAllocator::Allocate", std::to_string(count), count * 2,
+			[&]()
+			{
+				size_t sum = 0;
+				for (int i = 0; i < count; i++)
+				{
+					sum += ring.Allocate(256);
+					sum += ring.Allocate(256 + (i & 3) * 256);
+				}
+				ring.EndFrame(frame);
+				if (frame >= framesInFlight)
+					ring.RetireFrame(frame - framesInFlight);
+				frame++;
+				benchmarkSink = (float)sum;
+			});
+	}
+}
+
+// --------------------------------------------------------
+// Streaming decisions for a row of textured objects as a
+// camera flies past them, entirely headless.  Each
+// iteration is one frame of the path; the budget only fits
+// full detail for the nearest few.
+// --------------------------------------------------------
+static void BenchmarkTextureResidency(Benchmark& benchmark)
+{
+	const int textureCounts[] = { 28, 256, 2048 };
+	for (int count : textureCounts)
+	{
+		std::vector<size_t> mipBytes;
+		for (unsigned int size = 1024; size > 0; size /= 2)
+			mipBytes.push_back((size_t)size * size * 4);
+
+		TextureResidency residency(32 * 1024 * 1024);
+		for (int i = 0; i < count; i++)
+			residency.AddTexture(1024, 1024, mipBytes);
+
+		// Four textures per object, objects 4 units apart
+		const float projectionScale = 1.0f / tanf(3.14159265f / 8.0f);
+		const float pathLength = count / 4 * 4.0f;
+		int frame = 0;
+		benchmark.Run("TextureResidency::Update", std::to_string(count), count,
+			[&]()
+			{
+				float cameraX = fmodf(frame++ * 0.25f, pathLength);
+				residency.BeginFrame();
+				for (int i = 0; i < count; i++)
+				{
+					float distance = fabsf(cameraX - (i / 4) * 4.0f);
+					float texels = TextureResidency::CalculateRequiredTexels(2.0f, 1.0f + (i % 3), distance, projectionScale, 720.0f);
+					residency.Request(i, texels);
+				}
+				residency.Update();
+				benchmarkSink = (float)residency.GetStats().ResidentBytes;
+			});
+	}
+}
+
+// --------------------------------------------------------
+// Block compression of a synthetic material texture: smooth
+// gradients plus per-pixel noise, so blocks aren't trivial.
+// Items are pixels, so items/s over a million is MP/s.
+// --------------------------------------------------------
+static void BenchmarkBlockCompression(Benchmark& benchmark)
+{
+	const unsigned int size = 512;
+	std::vector<unsigned char> image((size_t)size * size * 4);
+	unsigned int seed = 1;
+	for (unsigned int y = 0; y < size; y++)
+	{
+		for (unsigned int x = 0; x < size; x++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			unsigned char* pixel = &image[((size_t)y * size + x) * 4];
+			pixel[0] = (unsigned char)(128 + 100 * sinf(x * 0.03f) + (seed >> 28));
+			pixel[1] = (unsigned char)(128 + 100 * cosf(y * 0.05f) + ((seed >> 24) & 15));
+			pixel[2] = (unsigned char)((x + y) / 4);
+			pixel[3] = (unsigned char)(200 + (seed >> 29));
+		}
+	}
+
+	const BlockFormat formats[] = { BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC4, BLOCK_FORMAT_BC5, BLOCK_FORMAT_BC7 };
+	const BlockQuality qualities[] = { BLOCK_QUALITY_FAST, BLOCK_QUALITY_NORMAL, BLOCK_QUALITY_HIGH };
+	std::vector<unsigned char> blocks;
+	std::vector<unsigned char> decoded(image.size());
+	for (BlockFormat format : formats)
+	{
+		blocks.resize(GetCompressedSize(format, size, size));
+		for (BlockQuality quality : qualities)
+		{
+			std::string name = std::string("CompressBlocks ") + GetBlockFormatName(format) + " " + GetBlockQualityName(quality);
+			benchmark.Run(name, std::to_string(size) + "x" + std::to_string(size), (uint64_t)size * size,
+				[&]()
+				{
+					CompressBlocks(image.data(), size, size, format, quality, blocks.data());
+					benchmarkSink = blocks[0];
+				});
+
+			DecompressBlocks(blocks.data(), size, size, format, decoded.data());
+			printf("  %s %s PSNR %.2f dB\n", GetBlockFormatName(format), GetBlockQualityName(quality),
+				CalculatePSNR(image.data(), decoded.data(), size, size, GetBlockChannels(format)));
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Mip chains for some of the bundled textures, with each
+// filter on one thread and on all of them.  Also checks the
+// output is the same whatever the thread count.  Items are
+// top mip pixels.
+// --------------------------------------------------------
+static void BenchmarkMipGeneration(Benchmark& benchmark, const std::string& assetFolder)
+{
+	// The options TextureStreamer gives each of these
+	struct MipSource { const char* File; bool SRGB; bool NormalMap; bool AlphaCoverage; };
+	const MipSource sources[] = {
+		{ "Textures/wood_albedo.png", true, false, false },
+		{ "Textures/wood_normals.png", false, true, false },
+		{ "Particles/trace_03.png", false, false, true } };
+	for (const MipSource& mipSource : sources)
+	{
+		std::string path = assetFolder + mipSource.File;
+		MipOptions options;
+		options.Wrap = true;
+		options.NormalMap = mipSource.NormalMap;
+		options.PreserveAlphaCoverage = mipSource.AlphaCoverage;
+
+		MappedFile file;
+		PNGImage source;
+		if (!file.Open(path.c_str()) || !DecodePNG(file.GetData(), file.GetSize(), source))
+		{
+			printf("Skipping mip generation for %s - could not decode it\n", mipSource.File);
+			continue;
+		}
+		options.SRGB = mipSource.SRGB || (source.Info.SRGB && !mipSource.NormalMap);
+
+		unsigned int width = source.Info.Width;
+		unsigned int height = source.Info.Height;
+		std::string scale = std::to_string(width) + "x" + std::to_string(height);
+		std::string name = path.substr(path.find_last_of('/') + 1);
+		std::vector<std::vector<unsigned char>> mips;
+
+		const MipFilter filters[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER };
+		for (MipFilter filter : filters)
+		{
+			MipOptions mipOptions = options;
+			mipOptions.Filter = filter;
+
+			std::vector<std::vector<unsigned char>> reference;
+			bool identical = true;
+			const unsigned int threadCounts[] = { 1, 2, 3, 0 };
+			for (unsigned int threads : threadCounts)
+			{
+				mipOptions.ThreadCount = threads;
+				auto generate = [&]()
+				{
+					mips.assign(1, source.RGBA);
+					GenerateMipChain(mips, width, height, mipOptions);
+					benchmarkSink = mips.back()[0];
+				};
+
+				// Only time one thread and every thread
+				if (threads == 1 || threads == 0)
+				{
+					std::string runName = std::string("GenerateMipChain ") + name +
+						(filter == MIP_FILTER_BOX ? " box" : " kaiser") +
+						(threads == 1 ? " 1 thread" : " all threads");
+					benchmark.Run(runName, scale, (uint64_t)width * height, generate);
+				}
+				else
+				{
+					generate();
+				}
+
+				if (reference.empty())
+					reference = mips;
+				else
+					identical = identical && mips == reference;
+			}
+			printf("  %s %s mips %s across thread counts\n", name.c_str(),
+				filter == MIP_FILTER_BOX ? "box" : "kaiser",
+				identical ? "identical" : "DIFFER");
+		}
+	}
+}
+
+// Every .png in a folder and the folders inside it
+static void FindPNGs(const std::string& folder, std::vector<std::string>& paths)
+{
+	auto isPNG = [](const std::string& name)
+	{
+		if (name.size() <= 4)
+			return false;
+		std::string extension = name.substr(name.size() - 4);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+		return extension == ".png";
+	};
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((folder + "*").c_str(), &found);
+	if (search == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		std::string name = found.cFileName;
+		if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			if (name != "." && name != "..")
+				FindPNGs(folder + name + "/", paths);
+		}
+		else if (isPNG(name))
+		{
+			paths.push_back(folder + name);
+		}
+	} while (FindNextFileA(search, &found));
+	FindClose(search);
+#else
+	DIR* directory = opendir(folder.c_str());
+	if (!directory)
+		return;
+
+	// Sorted, so runs list files in the same order
+	std::vector<std::string> names;
+	while (dirent* entry = readdir(directory))
+		names.push_back(entry->d_name);
+	closedir(directory);
+	std::sort(names.begin(), names.end());
+
+	for (const std::string& name : names)
+	{
+		struct stat info;
+		if (name == "." || name == ".." || stat((folder + name).c_str(), &info) != 0)
+			continue;
+		if (S_ISDIR(info.st_mode))
+			FindPNGs(folder + name + "/", paths);
+		else if (isPNG(name))
+			paths.push_back(folder + name);
+	}
+#endif
+}
+
+// --------------------------------------------------------
+// Decodes every bundled PNG, one after another and then
+// all at once across threads, plus a throughput line per
+// file.  Items are pixels, so items/s over a million is
+// MP/s.
+// --------------------------------------------------------
+static void BenchmarkPNGDecoding(Benchmark& benchmark, const std::string& assetFolder)
+{
+	std::vector<std::string> paths;
+	FindPNGs(assetFolder, paths);
+
+	std::vector<std::unique_ptr<MappedFile>> mappedFiles;
+	std::vector<std::pair<const unsigned char*, size_t>> files;
+	uint64_t pixels = 0;
+	for (const std::string& path : paths)
+	{
+		std::unique_ptr<MappedFile> file(new MappedFile());
+		PNGInfo info;
+		if (!file->Open(path.c_str()) || !ReadPNGInfo(file->GetData(), file->GetSize(), info))
+		{
+			printf("Skipping %s - not a readable PNG\n", path.c_str());
+			continue;
+		}
+
+		// One untimed decode per file, both to check it and to
+		// report each one's throughput
+		PNGImage image;
+		int64_t start = Clock::NowNanoseconds();
+		bool decoded = DecodePNG(file->GetData(), file->GetSize(), image);
+		double seconds = (Clock::NowNanoseconds() - start) * 1e-9;
+		printf("  %-50s %4ux%-4u %s %7.1f MP/s\n", path.substr(assetFolder.size()).c_str(), info.Width, info.Height,
+			decoded ? "    " : "FAIL", seconds > 0 ? (double)info.Width * info.Height / seconds * 1e-6 : 0.0);
+
+		pixels += (uint64_t)info.Width * info.Height;
+		files.push_back({ file->GetData(), file->GetSize() });
+		mappedFiles.push_back(std::move(file));
+	}
+
+	if (files.empty())
+	{
+		printf("Skipping PNG decoding - no PNGs under %s\n", assetFolder.c_str());
+		return;
+	}
+
+	std::string scale = std::to_string(files.size()) + " files";
+	std::vector<PNGImage> images;
+	benchmark.Run("DecodePNGs 1 thread", scale, pixels,
+		[&]() { benchmarkSink = (float)DecodePNGs(files, images, 1); });
+	benchmark.Run("DecodePNGs all threads", scale, pixels,
+		[&]() { benchmarkSink = (float)DecodePNGs(files, images); });
+}
+
+// --------------------------------------------------------
+// Decodes the bundled sky's faces for the IBL benchmarks,
+// or says why that one is skipped
+// --------------------------------------------------------
+static bool LoadBenchmarkSky(const std::string& assetFolder, const char* benchmarkName, std::vector<PNGImage>& images, CubemapPixels& cube)
+{
+	const char* faceNames[6] = { "right", "left", "up", "down", "front", "back" };
+	MappedFile files[6];
+	std::vector<std::pair<const unsigned char*, size_t>> data;
+	for (int i = 0; i < 6; i++)
+	{
+		std::string path = assetFolder + "Skies/Clouds Blue/" + faceNames[i] + ".png";
+		if (!files[i].Open(path.c_str()))
+		{
+			printf("Skipping %s - could not open %s\n", benchmarkName, path.c_str());
+			return false;
+		}
+		data.push_back({ files[i].GetData(), files[i].GetSize() });
+	}
+
+	if (DecodePNGs(data, images) != 6)
+	{
+		printf("Skipping %s - could not decode the sky\n", benchmarkName);
+		return false;
+	}
+
+	cube = CubemapPixels();
+	for (int i = 0; i < 6; i++)
+		cube.Faces[i] = images[i].RGBA.data();
+	cube.Size = images[0].Info.Width;
+	cube.RowPitch = cube.Size * 4;
+	cube.SRGB = images[0].Info.SRGB;
+	return true;
+}
+
+// --------------------------------------------------------
+// Projects the bundled sky onto spherical harmonics and
+// reports how far the irradiance rebuilt from them is from
+// the brute force shader's, in 8 bit (gamma encoded) levels
+// over an 8x8 grid of directions per face.  Items are sky
+// texels.
+// --------------------------------------------------------
+static void BenchmarkIrradianceSH(Benchmark& benchmark, const std::string& assetFolder)
+{
+	std::vector<PNGImage> images;
+	CubemapPixels cube;
+	if (!LoadBenchmarkSky(assetFolder, "SH irradiance", images, cube))
+		return;
+
+	std::string scale = std::to_string(cube.Size) + "x" + std::to_string(cube.Size);
+	uint64_t texels = (uint64_t)cube.Size * cube.Size * 6;
+	SH9Color sh;
+	benchmark.Run("ProjectCubemapSH9 1 thread", scale, texels,
+		[&]() { ProjectCubemapSH9(cube, sh, 1); benchmarkSink = sh.Coefficients[0][0]; });
+	benchmark.Run("ProjectCubemapSH9 all threads", scale, texels,
+		[&]() { ProjectCubemapSH9(cube, sh); benchmarkSink = sh.Coefficients[0][0]; });
+
+	ConvolveIrradianceSH9(sh);
+	LinearCubemapLevel level;
+	benchmark.Run("CreateIrradianceCubeSH9", "32x32", 32 * 32 * 6,
+		[&]() { CreateIrradianceCubeSH9(sh, 32, level); benchmarkSink = level.Faces[0][0]; });
+
+	const int grid = 8;
+	float maxError = 0.0f, totalError = 0.0f;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (int y = 0; y < grid; y++)
+		{
+			for (int x = 0; x < grid; x++)
+			{
+				float direction[3], fromSH[3], reference[3];
+				GetCubemapDirection(face, (x + 0.5f) / grid, (y + 0.5f) / grid, direction);
+				EvaluateSH9(sh, direction, fromSH);
+				CalculateIrradianceReference(cube, direction, reference);
+				for (int c = 0; c < 3; c++)
+				{
+					float error = 255.0f * fabsf(
+						powf((std::max)(fromSH[c], 0.0f), 1.0f / 2.2f) -
+						powf((std::max)(reference[c], 0.0f), 1.0f / 2.2f));
+					maxError = (std::max)(maxError, error);
+					totalError += error;
+				}
+			}
+		}
+	}
+	printf("  SH irradiance vs brute force: max %.2f, mean %.2f of 255 levels\n",
+		maxError, totalError / (6 * grid * grid * 3));
+}
+
+// --------------------------------------------------------
+// Times the CPU specular prefilter on the bundled sky, then
+// reports each blurred mip's error against the shader's
+// 4096 samples, in 8 bit levels over a 4x4 grid of texels
+// per face, next to the error of the same number of plain
+// (unfiltered) samples.  Items are texels of every mip.
+// --------------------------------------------------------
+static void BenchmarkSpecularPrefilter(Benchmark& benchmark, const std::string& assetFolder)
+{
+	std::vector<PNGImage> images;
+	CubemapPixels cube;
+	if (!LoadBenchmarkSky(assetFolder, "specular prefilter", images, cube))
+		return;
+
+	// Matches Sky's IBL constants
+	const unsigned int size = 256;
+	const unsigned int mipLevels = 6;
+	const unsigned int sampleCount = 64;
+	const unsigned int referenceSampleCount = 4096;
+
+	LinearCubemap source;
+	std::string sourceScale = std::to_string(cube.Size) + "x" + std::to_string(cube.Size);
+	benchmark.Run("DecodeCubemap all threads", sourceScale, (uint64_t)cube.Size * cube.Size * 6,
+		[&]() { DecodeCubemap(cube, size * 2, source); benchmarkSink = source.Mips[0].Faces[0][0]; });
+
+	LinearCubemap prefiltered;
+	std::string scale = std::to_string(size) + "x" + std::to_string(size) + " " + std::to_string(sampleCount) + " samples";
+	uint64_t texels = 0;
+	for (unsigned int mip = 0; mip < mipLevels; mip++)
+		texels += (uint64_t)(size >> mip) * (size >> mip) * 6;
+	benchmark.Run("PrefilterSpecularCubemap 1 thread", scale, texels,
+		[&]() { PrefilterSpecularCubemap(source, size, mipLevels, sampleCount, prefiltered, 1); benchmarkSink = prefiltered.Mips[0].Faces[0][0]; });
+	benchmark.Run("PrefilterSpecularCubemap all threads", scale, texels,
+		[&]() { PrefilterSpecularCubemap(source, size, mipLevels, sampleCount, prefiltered); benchmarkSink = prefiltered.Mips[0].Faces[0][0]; });
+
+	// A 4x4 grid of texels on every face of each mip
+	auto encode = [](float value) { return 255.0f * powf((std::max)(value, 0.0f), 1.0f / 2.2f); };
+	const unsigned int grid = 4;
+	for (unsigned int mip = 1; mip < mipLevels; mip++)
+	{
+		const LinearCubemapLevel& level = prefiltered.Mips[mip];
+		float roughness = GetSpecularMipRoughness(mip, mipLevels);
+		float maxFiltered = 0, totalFiltered = 0, maxUnfiltered = 0, totalUnfiltered = 0;
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			for (unsigned int gy = 0; gy < grid; gy++)
+			{
+				for (unsigned int gx = 0; gx < grid; gx++)
+				{
+					unsigned int x = (2 * gx + 1) * level.Size / (2 * grid);
+					unsigned int y = (2 * gy + 1) * level.Size / (2 * grid);
+					float direction[3], reference[3], unfiltered[3];
+					GetCubemapDirection(face, (x + 0.5f) / level.Size, (y + 0.5f) / level.Size, direction);
+					CalculateSpecularReference(cube, roughness, direction, referenceSampleCount, reference);
+					CalculateSpecularReference(cube, roughness, direction, sampleCount, unfiltered);
+
+					const float* filtered = &level.Faces[face][((size_t)y * level.Size + x) * 3];
+					for (int c = 0; c < 3; c++)
+					{
+						float filteredError = fabsf(encode(filtered[c]) - encode(reference[c]));
+						float unfilteredError = fabsf(encode(unfiltered[c]) - encode(reference[c]));
+						maxFiltered = (std::max)(maxFiltered, filteredError);
+						maxUnfiltered = (std::max)(maxUnfiltered, unfilteredError);
+						totalFiltered += filteredError;
+						totalUnfiltered += unfilteredError;
+					}
+				}
+			}
+		}
+
+		float count = 6.0f * grid * grid * 3;
+		printf("  Specular mip %u (roughness %.1f) vs %u samples: filtered max %.2f, mean %.2f; unfiltered max %.2f, mean %.2f of 255 levels\n",
+			mip, roughness, referenceSampleCount, maxFiltered, totalFiltered / count, maxUnfiltered, totalUnfiltered / count);
+	}
+}
+
+// --------------------------------------------------------
+// A synthetic equirectangular sky as a run length encoded
+// .hdr file: a gradient brighter toward the horizon, a sun
+// far over 1 and some noise to keep the runs short, since
+// there's no HDR sky bundled with the assets
+// --------------------------------------------------------
+static void MakeBenchmarkHDR(unsigned int width, unsigned int height, std::string& file)
+{
+	file = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+
+	std::vector<unsigned char> planes(width * 4);
+	uint32_t noise = 12345;
+	float sunX = width * 0.3f, sunY = height * 0.3f, sunRadius = width / 200.0f;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			noise = noise * 1664525 + 1013904223;
+			float grain = (noise >> 24) / 2550.0f;
+			float horizon = 1.0f - fabsf(y / (float)height - 0.5f) * 2.0f;
+			float rgb[3] = { 0.3f + horizon + grain, 0.5f + horizon + grain, 1.0f + horizon * 0.5f + grain };
+			float dx = x - sunX, dy = y - sunY;
+			if (dx * dx + dy * dy < sunRadius * sunRadius)
+				rgb[0] = rgb[1] = rgb[2] = 5000.0f;
+
+			// The largest channel sets the shared exponent
+			int exponent;
+			float scale = frexpf((std::max)(rgb[0], (std::max)(rgb[1], rgb[2])), &exponent) * 256.0f / (std::max)(rgb[0], (std::max)(rgb[1], rgb[2]));
+			for (int c = 0; c < 3; c++)
+				planes[c * width + x] = (unsigned char)(rgb[c] * scale);
+			planes[3 * width + x] = (unsigned char)(exponent + 128);
+		}
+
+		file += (char)2;
+		file += (char)2;
+		file += (char)(width >> 8);
+		file += (char)(width & 0xFF);
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			const unsigned char* plane = &planes[c * width];
+			unsigned int x = 0;
+			while (x < width)
+			{
+				unsigned int run = 1;
+				while (x + run < width && run < 127 && plane[x + run] == plane[x])
+					run++;
+				if (run >= 4)
+				{
+					file += (char)(128 + run);
+					file += (char)plane[x];
+					x += run;
+					continue;
+				}
+
+				// Literals up to the next run worth encoding
+				unsigned int start = x;
+				while (x < width && x - start < 128 && !(x + 3 < width && plane[x] == plane[x + 1] && plane[x] == plane[x + 2] && plane[x] == plane[x + 3]))
+					x++;
+				file += (char)(x - start);
+				file.append((const char*)plane + start, x - start);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Decodes synthetic 2K and 8K .hdr skies and resamples each
+// into the cube Sky would make from it (a quarter of the
+// width, full mips), then reports the largest relative
+// error of the top mip against plain float resampling over
+// a 16x16 grid per face.  Items are source pixels for
+// decoding and cube texels of every mip for conversion.
+// --------------------------------------------------------
+static void BenchmarkEquirectCubemap(Benchmark& benchmark)
+{
+	// An 8K conversion takes long enough that a few
+	// iterations are plenty
+	benchmark.SetMinimums(5, 0.25);
+
+	const unsigned int widths[] = { 2048, 8192 };
+	for (unsigned int width : widths)
+	{
+		std::string file;
+		MakeBenchmarkHDR(width, width / 2, file);
+		std::string scale = std::to_string(width) + "x" + std::to_string(width / 2);
+
+		HDRImage image;
+		benchmark.Run("DecodeHDR", scale, (uint64_t)width * (width / 2),
+			[&]() { DecodeHDR((const unsigned char*)file.data(), file.size(), image); benchmarkSink = image.RGBE[0]; });
+		if (image.Width != width)
+		{
+			printf("Skipping equirect conversion - could not decode the %s sky\n", scale.c_str());
+			continue;
+		}
+
+		unsigned int size = GetEquirectCubeSize(width);
+		HalfCubemap cube;
+		uint64_t texels = 0;
+		for (unsigned int mipSize = size; mipSize > 0; mipSize /= 2)
+			texels += (uint64_t)mipSize * mipSize * 6;
+		scale += " to " + std::to_string(size);
+		benchmark.Run("ConvertEquirectToCubemap 1 thread", scale, texels,
+			[&]() { ConvertEquirectToCubemap(image, size, 0, cube, 1); benchmarkSink = cube.Texels[0]; });
+		benchmark.Run("ConvertEquirectToCubemap all threads", scale, texels,
+			[&]() { ConvertEquirectToCubemap(image, size, 0, cube); benchmarkSink = cube.Texels[0]; });
+
+		// Gamma decoded back to linear to compare
+		const unsigned int grid = 16;
+		float maxError = 0.0f;
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			const uint16_t* top = cube.GetSubresource(face, 0);
+			for (unsigned int gy = 0; gy < grid; gy++)
+			{
+				for (unsigned int gx = 0; gx < grid; gx++)
+				{
+					unsigned int x = (2 * gx + 1) * size / (2 * grid);
+					unsigned int y = (2 * gy + 1) * size / (2 * grid);
+					float direction[3], reference[3];
+					GetCubemapDirection(face, (x + 0.5f) / size, (y + 0.5f) / size, direction);
+					SampleEquirect(image, direction, reference);
+					for (int c = 0; c < 3; c++)
+					{
+						float converted = powf(DecodeHalf(top[((size_t)y * size + x) * 4 + c]), 2.2f);
+						maxError = (std::max)(maxError, fabsf(converted - reference[c]) / (std::max)(reference[c], 1e-3f));
+					}
+				}
+			}
+		}
+		printf("  Equirect %s vs float resampling: max relative error %.5f\n", scale.c_str(), maxError);
+	}
+
+	benchmark.SetMinimums(30, 0.25);
+}
+
+// --------------------------------------------------------
+// Times packing and unpacking a million HDR colors in each
+// format, then reports how far they come back from where
+// they started: relative to the brightest channel (what a
+// shared exponent keeps) and to each channel on its own,
+// ignoring channels under 1/256 of the brightest.  Colors
+// are 2^-6 to 2^10 at their brightest channel, with random
+// hues; RGBM clips those over its range, so those are
+// counted instead.
+// --------------------------------------------------------
+static void BenchmarkPackedHDR(Benchmark& benchmark)
+{
+	const size_t texelCount = 1024 * 1024;
+	std::vector<float> colors(texelCount * 3);
+	uint32_t noise = 12345;
+	auto random = [&]() { noise = noise * 1664525 + 1013904223; return (noise >> 8) / 16777216.0f; };
+	for (size_t i = 0; i < texelCount; i++)
+	{
+		float brightness = exp2f(random() * 16.0f - 6.0f);
+		for (int c = 0; c < 3; c++)
+			colors[i * 3 + c] = brightness * random();
+		colors[i * 3 + i % 3] = brightness;
+	}
+
+	std::vector<uint32_t> packed(texelCount);
+	std::vector<float> unpacked(texelCount * 3);
+	const PackedHDRFormat formats[] = { PACKED_HDR_RGB9E5, PACKED_HDR_R11G11B10F, PACKED_HDR_RGBM };
+	for (PackedHDRFormat format : formats)
+	{
+		std::string name = GetPackedHDRFormatName(format);
+		benchmark.Run("PackHDR " + name, "1M texels", texelCount,
+			[&]() { PackHDR(colors.data(), texelCount, format, packed.data()); benchmarkSink = (float)packed[0]; });
+		benchmark.Run("UnpackHDR " + name, "1M texels", texelCount,
+			[&]() { UnpackHDR(packed.data(), texelCount, format, unpacked.data()); benchmarkSink = unpacked[0]; });
+
+		float maxOfBrightest = 0, totalOfBrightest = 0, maxOfChannel = 0, totalOfChannel = 0;
+		size_t channels = 0, compared = 0, clipped = 0;
+		for (size_t i = 0; i < texelCount; i++)
+		{
+			const float* original = &colors[i * 3];
+			const float* result = &unpacked[i * 3];
+			float brightest = (std::max)(original[0], (std::max)(original[1], original[2]));
+			if (format == PACKED_HDR_RGBM && brightest > PackedHDRRGBMRange)
+			{
+				clipped++;
+				continue;
+			}
+
+			compared++;
+			for (int c = 0; c < 3; c++)
+			{
+				float error = fabsf(result[c] - original[c]);
+				maxOfBrightest = (std::max)(maxOfBrightest, error / brightest);
+				totalOfBrightest += error / brightest;
+				if (original[c] >= brightest / 256.0f)
+				{
+					maxOfChannel = (std::max)(maxOfChannel, error / original[c]);
+					totalOfChannel += error / original[c];
+					channels++;
+				}
+			}
+		}
+
+		printf("  %s relative error: of the brightest channel max %.5f, mean %.6f; of each channel max %.5f, mean %.6f; %zu clipped\n",
+			name.c_str(), maxOfBrightest, totalOfBrightest / (compared * 3), maxOfChannel, totalOfChannel / channels, clipped);
+	}
+}
+
+// --------------------------------------------------------
+// The procedural sky's bakes, whole and spread over frames.
+// Each iteration of the sliced runs is one frame's Update()
+// at that budget, asking for another bake whenever one
+// finishes, so the median and p99 show how closely the
+// frames keep to it.  The baker's own count of updates over
+// budget, and how far over, follow.  Nothing here touches
+// D3D, so it runs the same anywhere.
+// --------------------------------------------------------
+static void BenchmarkProceduralSky(Benchmark& benchmark)
+{
+	ProceduralSkySettings settings;
+	ProceduralSkyBaker baker;
+	unsigned int size = baker.GetMaps().SkySize;
+
+	benchmark.SetMinimums(5, 0.25);
+	benchmark.Run("ProceduralSkyBaker::Finish", std::to_string(size) + " sky", (uint64_t)size * size * 6,
+		[&]() { baker.Request(settings); baker.Finish(); benchmarkSink = (float)baker.GetMaps().Sky[0]; });
+
+	// Enough frames at each budget for a few whole bakes
+	benchmark.SetMinimums(100, 0.5);
+	const double budgets[] = { 0.5, 1.0, 2.0, 4.0 };
+	for (double budget : budgets)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%.1f ms budget", budget);
+		baker.ResetStats();
+		benchmark.Run("ProceduralSkyBaker::Update", name, 1,
+			[&]()
+			{
+				if (!baker.IsBaking())
+					baker.Request(settings);
+				baker.Update(budget);
+			});
+
+		const ProceduralSkyStats& stats = baker.GetStats();
+		printf("  %s: %llu of %llu frames over (worst +%.3f ms), bakes take %u frames (%.1f ms in all)\n",
+			name, (unsigned long long)stats.OverBudgetUpdates, (unsigned long long)stats.Updates, stats.MaxOverrunMs,
+			stats.LastBakeUpdates, stats.LastBakeMs);
+	}
+
+	benchmark.SetMinimums(30, 0.25);
+}
+
+// --------------------------------------------------------
+// Times the BRDF look up table at each size, then checks a
+// small one against both the plain per-entry integration at
+// the same sample count (which the SIMD version should
+// match to rounding) and a 64x sample count reference
+// (which shows the sampling error itself).  Items are
+// table entries.
+// --------------------------------------------------------
+static void BenchmarkBRDFLookUp(Benchmark& benchmark)
+{
+	const unsigned int sampleCount = 4096;
+	std::vector<uint16_t> table;
+	const unsigned int sizes[] = { 32, 64, 128, 256 };
+	for (unsigned int size : sizes)
+	{
+		std::string scale = std::to_string(size) + "x" + std::to_string(size);
+		benchmark.Run("GenerateBRDFLookUp all threads", scale, (uint64_t)size * size,
+			[&]() { GenerateBRDFLookUp(size, sampleCount, table); benchmarkSink = table[0]; });
+	}
+	benchmark.Run("GenerateBRDFLookUp 1 thread", "256x256", 256 * 256,
+		[&]() { GenerateBRDFLookUp(256, sampleCount, table, 1); benchmarkSink = table[0]; });
+
+	const unsigned int size = 32;
+	GenerateBRDFLookUp(size, sampleCount, table);
+	float maxSame = 0, maxReference = 0, totalReference = 0;
+	for (unsigned int y = 0; y < size; y++)
+	{
+		for (unsigned int x = 0; x < size; x++)
+		{
+			float roughness = (y + 0.5f) / size;
+			float nDotV = (x + 0.5f) / size;
+			float scaleSame, biasSame, scaleReference, biasReference;
+			IntegrateEnvironmentBRDF(roughness, nDotV, sampleCount, scaleSame, biasSame);
+			IntegrateEnvironmentBRDF(roughness, nDotV, sampleCount * 64, scaleReference, biasReference);
+
+			float tableScale = table[(y * size + x) * 2 + 0] / 65535.0f;
+			float tableBias = table[(y * size + x) * 2 + 1] / 65535.0f;
+			maxSame = (std::max)(maxSame, (std::max)(fabsf(tableScale - scaleSame), fabsf(tableBias - biasSame)));
+			float error = (std::max)(fabsf(tableScale - scaleReference), fabsf(tableBias - biasReference));
+			maxReference = (std::max)(maxReference, error);
+			totalReference += error;
+		}
+	}
+	printf("  BRDF look up vs same sample count: max %.6f; vs %u samples: max %.5f, mean %.6f\n",
+		maxSame, sampleCount * 64, maxReference, totalReference / (size * size));
+}
+
+// --------------------------------------------------------
+//  Runs every benchmark that doesn't need D3D
+//
+//  assetFolder - Path to the Assets folder (ending in a slash)
+// --------------------------------------------------------
+void RunPortableBenchmarks(Benchmark& benchmark, const std::string& assetFolder)
+{
+	BenchmarkProfiler(benchmark);
+	BenchmarkParticleRing(benchmark);
+#ifdef ENGINE_HAS_DIRECTXMATH
+	BenchmarkMeshes(benchmark, assetFolder);
+	BenchmarkTransforms(benchmark);
+	BenchmarkParticleSimulation(benchmark);
+#endif
+	BenchmarkConstantBuffers(benchmark);
+	BenchmarkImGui(benchmark);
+	BenchmarkRingAllocator(benchmark);
+	BenchmarkTextureResidency(benchmark);
+	BenchmarkBlockCompression(benchmark);
+	BenchmarkMipGeneration(benchmark, assetFolder);
+	BenchmarkPNGDecoding(benchmark, assetFolder);
+	BenchmarkIrradianceSH(benchmark, assetFolder);
+	BenchmarkSpecularPrefilter(benchmark, assetFolder);
+	BenchmarkEquirectCubemap(benchmark);
+	BenchmarkPackedHDR(benchmark);
+	BenchmarkProceduralSky(benchmark);
+	BenchmarkBRDFLookUp(benchmark);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "Benchmark.h"
+
+#include <string>
+
+// Runs every benchmark that needs neither Windows nor a GPU
+// (see Benchmark.h), adding each result to the benchmark
+void RunPortableBenchmarks(Benchmark& benchmark, const std::string& assetFolder);
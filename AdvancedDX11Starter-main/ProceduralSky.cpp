@@ -0,0 +1,474 @@
+#include "ProceduralSky.h"
+#include "Clock.h"
+#include "PackedHDR.h"
+
+#include <algorithm>
+#include <math.h>
+
+// The sky is projected to spherical harmonics from its
+// first mip at most this size, as ProjectCubemapSH9() does
+static const unsigned int ProjectedSize = 64;
+
+// Room for every mip of a cube up to 2^15 across
+static const unsigned int MaxMipLevels = 16;
+
+// Costs per texel vary by a quarter or so across a face
+// (around the sun the model takes longer), so estimates
+// jump straight up to a higher measurement but come down
+// from one gradually, and updates only plan to fill this
+// much of what's left of their budget
+static const double CostSmoothing = 0.25;
+static const double BudgetFill = 0.9;
+
+// The sky fades to black as the sun's height goes from 0
+// to minus this (about 6 degrees, the end of twilight)
+static const float SunsetFadeHeight = 0.1f;
+
+// The ground is the horizon above it, darkening to this
+// much of it by GroundFadeHeight below the horizon
+static const float GroundBrightness = 0.3f;
+static const float GroundFadeHeight = 0.1f;
+
+// Perez's formula blows up as the view drops to the horizon
+static const float MinCosTheta = 0.01f;
+
+static const float Gamma = 2.2f;
+static const float Pi = 3.14159265f;
+
+static void Normalize(float d[3])
+{
+	float length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	float scale = length > 0.0f ? 1.0f / length : 0.0f;
+	d[0] *= scale;
+	d[1] *= scale;
+	d[2] *= scale;
+}
+
+static float Saturate(float value)
+{
+	return (std::min)((std::max)(value, 0.0f), 1.0f);
+}
+
+// --------------------------------------------------------
+// Perez's sky distribution for a view theta from the zenith
+// and gamma from the sun
+// --------------------------------------------------------
+static float Perez(const float coefficients[5], float cosTheta, float gamma, float cosGamma)
+{
+	const float* c = coefficients;
+	return (1.0f + c[0] * expf(c[1] / cosTheta)) * (1.0f + c[2] * expf(c[3] * gamma) + c[4] * cosGamma * cosGamma);
+}
+
+void SetupPreethamSky(const ProceduralSkySettings& settings, PreethamSky& sky)
+{
+	float sun[3] = { settings.SunDirection[0], settings.SunDirection[1], settings.SunDirection[2] };
+	Normalize(sun);
+	if (sun[0] == 0.0f && sun[1] == 0.0f && sun[2] == 0.0f)
+		sun[1] = 1.0f;
+	std::copy(sun, sun + 3, sky.SunDirection);
+
+	// The fit only covers the sun above the horizon, and
+	// turbidities from about 2 to 10
+	float thetaS = acosf(Saturate(sun[1]));
+	float t = (std::min)((std::max)(settings.Turbidity, 1.7f), 10.0f);
+
+	const float perez[3][5] = {
+		{ 0.1787f * t - 1.4630f, -0.3554f * t + 0.4275f, -0.0227f * t + 5.3251f, 0.1206f * t - 2.5771f, -0.0670f * t + 0.3703f },
+		{ -0.0193f * t - 0.2592f, -0.0665f * t + 0.0008f, -0.0004f * t + 0.2125f, -0.0641f * t - 0.8989f, -0.0033f * t + 0.0452f },
+		{ -0.0167f * t - 0.2608f, -0.0950f * t + 0.0092f, -0.0079f * t + 0.2102f, -0.0441f * t - 1.6537f, -0.0109f * t + 0.0529f } };
+	std::copy(&perez[0][0], &perez[0][0] + 15, &sky.Perez[0][0]);
+
+	// Zenith luminance in kcd/m^2, and chromaticity
+	float chi = (4.0f / 9.0f - t / 120.0f) * (Pi - 2.0f * thetaS);
+	float theta2 = thetaS * thetaS;
+	float theta3 = theta2 * thetaS;
+	float t2 = t * t;
+	float zenith[3];
+	zenith[0] = (4.0453f * t - 4.9710f) * tanf(chi) - 0.2155f * t + 2.4192f;
+	zenith[1] =
+		t2 * (0.00166f * theta3 - 0.00375f * theta2 + 0.00209f * thetaS) +
+		t * (-0.02903f * theta3 + 0.06377f * theta2 - 0.03202f * thetaS + 0.00394f) +
+		(0.11693f * theta3 - 0.21196f * theta2 + 0.06052f * thetaS + 0.25886f);
+	zenith[2] =
+		t2 * (0.00275f * theta3 - 0.00610f * theta2 + 0.00317f * thetaS) +
+		t * (-0.04214f * theta3 + 0.08970f * theta2 - 0.04153f * thetaS + 0.00516f) +
+		(0.15346f * theta3 - 0.26756f * theta2 + 0.06670f * thetaS + 0.26688f);
+
+	// Divided by the formula's value straight up, so
+	// evaluating it anywhere else scales relative to that
+	float cosThetaS = cosf(thetaS);
+	for (int i = 0; i < 3; i++)
+		sky.Zenith[i] = zenith[i] / Perez(sky.Perez[i], 1.0f, thetaS, cosThetaS);
+
+	sky.Scale = settings.Exposure * Saturate((sun[1] + SunsetFadeHeight) / SunsetFadeHeight);
+}
+
+void EvaluatePreethamSky(const PreethamSky& sky, const float direction[3], float rgb[3])
+{
+	float d[3] = { direction[0], direction[1], direction[2] };
+	Normalize(d);
+
+	// Below the horizon, the horizon straight above
+	float scale = sky.Scale;
+	if (d[1] < 0.0f)
+	{
+		float depth = Saturate(-d[1] / GroundFadeHeight);
+		scale *= 1.0f + (GroundBrightness - 1.0f) * depth;
+		d[1] = 0.0f;
+		Normalize(d);
+	}
+
+	float cosTheta = (std::max)(d[1], MinCosTheta);
+	float cosGamma = (std::min)((std::max)(d[0] * sky.SunDirection[0] + d[1] * sky.SunDirection[1] + d[2] * sky.SunDirection[2], -1.0f), 1.0f);
+	float gamma = acosf(cosGamma);
+
+	float luminance = sky.Zenith[0] * Perez(sky.Perez[0], cosTheta, gamma, cosGamma);
+	float x = sky.Zenith[1] * Perez(sky.Perez[1], cosTheta, gamma, cosGamma);
+	float y = sky.Zenith[2] * Perez(sky.Perez[2], cosTheta, gamma, cosGamma);
+
+	// xyY to XYZ to linear sRGB
+	float X = y > 0.0f ? x / y * luminance : 0.0f;
+	float Y = luminance;
+	float Z = y > 0.0f ? (1.0f - x - y) / y * luminance : 0.0f;
+	rgb[0] = (std::max)(3.2406f * X - 1.5372f * Y - 0.4986f * Z, 0.0f) * scale;
+	rgb[1] = (std::max)(-0.9689f * X + 1.8758f * Y + 0.0415f * Z, 0.0f) * scale;
+	rgb[2] = (std::max)(0.0557f * X - 0.2040f * Y + 1.0570f * Z, 0.0f) * scale;
+}
+
+void GetSunDirectionAtTime(float hours, float maxElevation, float direction[3])
+{
+	float hourAngle = (hours - 6.0f) / 12.0f * Pi;
+	float tilt = maxElevation * Pi / 180.0f;
+	direction[0] = cosf(hourAngle);
+	direction[1] = sinf(hourAngle) * sinf(tilt);
+	direction[2] = sinf(hourAngle) * cosf(tilt);
+}
+
+const uint32_t* ProceduralSkyMaps::GetSkyFace(unsigned int face) const
+{
+	return &Sky[(size_t)face * SkySize * SkySize];
+}
+
+const uint32_t* ProceduralSkyMaps::GetIrradianceFace(unsigned int face) const
+{
+	return &Irradiance[(size_t)face * IrradianceSize * IrradianceSize];
+}
+
+unsigned int ProceduralSkyMaps::GetSpecularMipSize(unsigned int mip) const
+{
+	return (std::max)(1u, SpecularSize >> mip);
+}
+
+const uint32_t* ProceduralSkyMaps::GetSpecularSubresource(unsigned int face, unsigned int mip) const
+{
+	return &Specular[GetSpecularOffset(face, mip)];
+}
+
+size_t ProceduralSkyMaps::GetSpecularOffset(unsigned int face, unsigned int mip) const
+{
+	size_t faceTexels = 0, offset = 0;
+	for (unsigned int m = 0; m < SpecularMipLevels; m++)
+	{
+		size_t size = GetSpecularMipSize(m);
+		if (m < mip)
+			offset += size * size;
+		faceTexels += size * size;
+	}
+	return face * faceTexels + offset;
+}
+
+ProceduralSkyBaker::ProceduralSkyBaker(unsigned int skySize, unsigned int irradianceSize, unsigned int specularMipLevels, unsigned int specularSampleCount)
+	: totalRows(0),
+	projectedMip(0),
+	texelCosts(STEP_KIND_COUNT * MaxMipLevels, 0.0),
+	pending(false),
+	baking(false),
+	stepIndex(0),
+	row(0),
+	rowsDone(0),
+	bakeUpdates(0),
+	bakeMs(0),
+	specularSampleCount((std::max)(1u, specularSampleCount)),
+	front(0),
+	generation(0)
+{
+	// A power of 2 from 2 up, so every mip halves exactly
+	unsigned int size = 2;
+	while (size < skySize && size < (1u << (MaxMipLevels - 1)))
+		size *= 2;
+	skySize = size;
+	irradianceSize = (std::max)(1u, irradianceSize);
+	unsigned int specularSize = skySize / 2;
+	unsigned int maxSpecularMips = 1;
+	while ((specularSize >> maxSpecularMips) > 0)
+		maxSpecularMips++;
+	specularMipLevels = (std::min)((std::max)(1u, specularMipLevels), maxSpecularMips);
+
+	// The sky's mips, down to 1x1 for filtering
+	for (unsigned int levelSize = skySize; levelSize > 0; levelSize /= 2)
+	{
+		sky.Mips.emplace_back();
+		sky.Mips.back().Size = levelSize;
+		for (std::vector<float>& face : sky.Mips.back().Faces)
+			face.resize((size_t)levelSize * levelSize * 3);
+		if (levelSize > ProjectedSize)
+			projectedMip++;
+	}
+	BuildSpecularLobes(skySize, specularMipLevels, this->specularSampleCount, lobes);
+	rowScratch.resize((size_t)skySize * skySize * 3);
+
+	// Everything a bake does, in the order it has to
+	for (unsigned int face = 0; face < 6; face++)
+		steps.push_back({ STEP_SKY, face, 0, skySize });
+	for (unsigned int mip = 1; mip < sky.Mips.size(); mip++)
+	{
+		for (unsigned int face = 0; face < 6; face++)
+			steps.push_back({ STEP_SKY_MIP, face, mip, sky.Mips[mip].Size });
+	}
+	for (unsigned int face = 0; face < 6; face++)
+		steps.push_back({ STEP_PROJECT_SH, face, projectedMip, sky.Mips[projectedMip].Size });
+	for (unsigned int face = 0; face < 6; face++)
+		steps.push_back({ STEP_IRRADIANCE, face, 0, irradianceSize });
+	for (unsigned int mip = 0; mip < specularMipLevels; mip++)
+	{
+		for (unsigned int face = 0; face < 6; face++)
+			steps.push_back({ STEP_SPECULAR, face, mip, (std::max)(1u, specularSize >> mip) });
+	}
+	for (const Step& step : steps)
+		totalRows += step.Size;
+
+	// Both sets start out black, at their full size
+	for (ProceduralSkyMaps& set : maps)
+	{
+		set.SkySize = skySize;
+		set.IrradianceSize = irradianceSize;
+		set.SpecularSize = specularSize;
+		set.SpecularMipLevels = specularMipLevels;
+		set.Sky.resize((size_t)skySize * skySize * 6);
+		set.Irradiance.resize((size_t)irradianceSize * irradianceSize * 6);
+		size_t specularTexels = 0;
+		for (unsigned int mip = 0; mip < specularMipLevels; mip++)
+			specularTexels += (size_t)set.GetSpecularMipSize(mip) * set.GetSpecularMipSize(mip);
+		set.Specular.resize(specularTexels * 6);
+	}
+}
+
+void ProceduralSkyBaker::Request(const ProceduralSkySettings& settings)
+{
+	pendingSettings = settings;
+	pending = true;
+}
+
+float ProceduralSkyBaker::GetProgress() const
+{
+	return baking ? (float)rowsDone / totalRows : 0.0f;
+}
+
+double& ProceduralSkyBaker::GetTexelCost(const Step& step)
+{
+	return texelCosts[step.Kind * MaxMipLevels + step.Mip];
+}
+
+void ProceduralSkyBaker::UpdateTexelCost(double& texelCost, int64_t elapsedNs, double texels)
+{
+	// A coarse clock can read 0 for a tiny slice, which isn't
+	// free; a cost of 0 would mean "not measured yet"
+	double measured = (double)(std::max)(elapsedNs, (int64_t)1) / texels;
+	texelCost = measured > texelCost ? measured : texelCost + (measured - texelCost) * CostSmoothing;
+}
+
+void ProceduralSkyBaker::StartBake()
+{
+	bakeSettings = pendingSettings;
+	pending = false;
+	SetupPreethamSky(bakeSettings, model);
+
+	baking = true;
+	stepIndex = 0;
+	row = 0;
+	rowsDone = 0;
+	bakeUpdates = 0;
+	bakeMs = 0;
+}
+
+void ProceduralSkyBaker::CompleteBake()
+{
+	ProceduralSkyMaps& back = maps[1 - front];
+	back.Settings = bakeSettings;
+	back.Generation = ++generation;
+	front = 1 - front;
+	baking = false;
+
+	stats.CompletedBakes++;
+	stats.LastBakeUpdates = bakeUpdates;
+	stats.LastBakeMs = bakeMs;
+}
+
+void ProceduralSkyBaker::RunRows(const Step& step, unsigned int firstRow, unsigned int endRow)
+{
+	ProceduralSkyMaps& back = maps[1 - front];
+	size_t texels = (size_t)(endRow - firstRow) * step.Size;
+	switch (step.Kind)
+	{
+	case STEP_SKY:
+	{
+		// Linear for the steps after, gamma encoded to draw
+		LinearCubemapLevel& level = sky.Mips[0];
+		float* rgb = &level.Faces[step.Face][(size_t)firstRow * level.Size * 3];
+		float* encoded = rowScratch.data();
+		for (unsigned int y = firstRow; y < endRow; y++)
+		{
+			for (unsigned int x = 0; x < level.Size; x++, rgb += 3, encoded += 3)
+			{
+				float direction[3];
+				GetCubemapDirection(step.Face, (x + 0.5f) / level.Size, (y + 0.5f) / level.Size, direction);
+				EvaluatePreethamSky(model, direction, rgb);
+				for (int c = 0; c < 3; c++)
+					encoded[c] = powf(rgb[c], 1.0f / Gamma);
+			}
+		}
+		PackHDR(rowScratch.data(), texels, PACKED_HDR_RGB9E5,
+			&back.Sky[((size_t)step.Face * level.Size + firstRow) * level.Size]);
+		break;
+	}
+
+	case STEP_SKY_MIP:
+		DownsampleCubemapRows(sky.Mips[step.Mip - 1], sky.Mips[step.Mip], step.Face, firstRow, endRow);
+		break;
+
+	case STEP_PROJECT_SH:
+		if (step.Face == 0 && firstRow == 0)
+			radiance = SH9Color();
+		AccumulateSH9Rows(sky.Mips[step.Mip], step.Face, firstRow, endRow, radiance);
+		break;
+
+	case STEP_IRRADIANCE:
+	{
+		if (step.Face == 0 && firstRow == 0)
+		{
+			irradiance = radiance;
+			ConvolveIrradianceSH9(irradiance);
+		}
+
+		float* rgb = rowScratch.data();
+		for (unsigned int y = firstRow; y < endRow; y++)
+		{
+			for (unsigned int x = 0; x < step.Size; x++, rgb += 3)
+			{
+				float direction[3];
+				GetCubemapDirection(step.Face, (x + 0.5f) / step.Size, (y + 0.5f) / step.Size, direction);
+				EvaluateSH9(irradiance, direction, rgb);
+			}
+		}
+		PackHDR(rowScratch.data(), texels, PACKED_HDR_RGB9E5,
+			&back.Irradiance[((size_t)step.Face * step.Size + firstRow) * step.Size]);
+		break;
+	}
+
+	case STEP_SPECULAR:
+	{
+		PrefilterSpecularRows(sky, lobes[step.Mip], step.Face, step.Size, firstRow, endRow, rowScratch.data());
+		PackHDR(rowScratch.data(), texels, PACKED_HDR_RGB9E5,
+			&back.Specular[back.GetSpecularOffset(step.Face, step.Mip) + (size_t)firstRow * step.Size]);
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+bool ProceduralSkyBaker::Update(double budgetMs)
+{
+	if (!baking)
+	{
+		if (!pending)
+			return false;
+		StartBake();
+	}
+
+	int64_t start = Clock::NowNanoseconds();
+	double budgetNs = budgetMs * 1000000.0;
+	bool progressed = false;
+	bool completed = false;
+	while (!completed)
+	{
+		const Step& step = steps[stepIndex];
+		double& texelCost = GetTexelCost(step);
+		double remainingNs = budgetNs * BudgetFill - (double)(Clock::NowNanoseconds() - start);
+		unsigned int rows = PlanSliceRows(texelCost * step.Size, remainingNs, step.Size - row, progressed);
+		if (rows == 0)
+			break;
+
+		int64_t sliceStart = Clock::NowNanoseconds();
+		RunRows(step, row, row + rows);
+		UpdateTexelCost(texelCost, Clock::NowNanoseconds() - sliceStart, (double)rows * step.Size);
+
+		progressed = true;
+		row += rows;
+		rowsDone += rows;
+		if (row == step.Size)
+		{
+			row = 0;
+			completed = ++stepIndex == steps.size();
+		}
+	}
+
+	double elapsedMs = (double)(Clock::NowNanoseconds() - start) / 1000000.0;
+	bakeUpdates++;
+	bakeMs += elapsedMs;
+
+	stats.Updates++;
+	stats.LastUpdateMs = elapsedMs;
+	stats.MaxUpdateMs = (std::max)(stats.MaxUpdateMs, elapsedMs);
+	if (elapsedMs > budgetMs)
+	{
+		stats.OverBudgetUpdates++;
+		stats.MaxOverrunMs = (std::max)(stats.MaxOverrunMs, elapsedMs - budgetMs);
+	}
+
+	if (completed)
+		CompleteBake();
+	return completed;
+}
+
+unsigned int ProceduralSkyBaker::PlanSliceRows(double rowCostNs, double remainingNs, unsigned int rowsLeft, bool progressed)
+{
+	unsigned int rows = rowsLeft;
+	if (rowCostNs > 0.0)
+	{
+		double fit = remainingNs / rowCostNs;
+		if (fit < rows)
+			rows = fit > 0.0 ? (unsigned int)fit : 0;
+	}
+	else
+		rows = 1;
+
+	// Every update makes some progress, however small its budget
+	if (rows == 0 && !progressed)
+		rows = 1;
+	return rows;
+}
+
+void ProceduralSkyBaker::Finish()
+{
+	while (baking || pending)
+	{
+		if (!baking)
+			StartBake();
+
+		// Timing each step as it goes, so the first bake spread
+		// over updates already has estimates to go by
+		for (; stepIndex < steps.size(); stepIndex++)
+		{
+			const Step& step = steps[stepIndex];
+			int64_t start = Clock::NowNanoseconds();
+			RunRows(step, row, step.Size);
+			int64_t elapsed = Clock::NowNanoseconds() - start;
+			UpdateTexelCost(GetTexelCost(step), elapsed, (double)(step.Size - row) * step.Size);
+			bakeMs += (double)elapsed / 1000000.0;
+			row = 0;
+		}
+		CompleteBake();
+	}
+}
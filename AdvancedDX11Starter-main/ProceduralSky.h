@@ -0,0 +1,222 @@
+#pragma once
+
+#include "Cubemap.h"
+#include "SpecularPrefilter.h"
+#include "SphericalHarmonics.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// What a procedural sky is made from.  Directions are Y up,
+// as the cube's faces are.
+// --------------------------------------------------------
+struct ProceduralSkySettings
+{
+	float SunDirection[3] = { 0.0f, 0.5f, 0.866f };	// Toward the sun, normalized
+	float Turbidity = 2.5f;		// Haze, from 2 (clear) to 10 (hazy)
+	float Exposure = 0.05f;		// Linear color per kcd/m^2 of sky luminance
+};
+
+// --------------------------------------------------------
+// The clear sky of Preetham, Shirley and Smits, "A Practical
+// Analytic Model for Daylight": luminance and chromaticity
+// each follow Perez's formula, with coefficients and zenith
+// values fit to the turbidity and the sun's height.  The
+// model stops at the horizon, so the ground is the horizon
+// darkened, and it fades out as the sun sets.
+// --------------------------------------------------------
+struct PreethamSky
+{
+	float SunDirection[3] = {};
+	float Perez[3][5] = {};		// A to E for Y, x and y
+	float Zenith[3] = {};		// Y, x and y straight up, each over its Perez value there
+	float Scale = 0.0f;			// Exposure times the sunset fade
+};
+
+void SetupPreethamSky(const ProceduralSkySettings& settings, PreethamSky& sky);
+
+// Linear RGB for a (not necessarily normalized) direction
+void EvaluatePreethamSky(const PreethamSky& sky, const float direction[3], float rgb[3]);
+
+// A simple day: the sun rises in +X at 6, is highest over
+// +Z at noon (maxElevation degrees up) and sets at 18
+void GetSunDirectionAtTime(float hours, float maxElevation, float direction[3]);
+
+// --------------------------------------------------------
+// One set of maps made from a procedural sky, all packed
+// RGB9E5 (see PackedHDR.h): the sky itself, gamma encoded
+// as the sky shader draws it, and its linear irradiance and
+// pre-filtered specular cubes.  Faces are in D3D's order,
+// each mip of a face before the next face, as
+// D3D11CalcSubresource() numbers them.
+// --------------------------------------------------------
+struct ProceduralSkyMaps
+{
+	unsigned int SkySize = 0;
+	unsigned int IrradianceSize = 0;
+	unsigned int SpecularSize = 0;
+	unsigned int SpecularMipLevels = 0;
+
+	std::vector<uint32_t> Sky;
+	std::vector<uint32_t> Irradiance;
+	std::vector<uint32_t> Specular;
+
+	ProceduralSkySettings Settings;		// What they were made from
+	uint64_t Generation = 0;			// Counts up with each completed set
+
+	const uint32_t* GetSkyFace(unsigned int face) const;
+	const uint32_t* GetIrradianceFace(unsigned int face) const;
+	const uint32_t* GetSpecularSubresource(unsigned int face, unsigned int mip) const;
+	size_t GetSpecularOffset(unsigned int face, unsigned int mip) const;	// In texels
+	unsigned int GetSpecularMipSize(unsigned int mip) const;
+};
+
+// Timing of a baker's updates, for checking how well it
+// keeps to its budget
+struct ProceduralSkyStats
+{
+	uint64_t Updates = 0;				// Update() calls that had work to do
+	uint64_t OverBudgetUpdates = 0;		// ...that took longer than their budget
+	uint64_t CompletedBakes = 0;
+	double LastUpdateMs = 0;
+	double MaxUpdateMs = 0;
+	double MaxOverrunMs = 0;			// Furthest any update went past its budget
+	unsigned int LastBakeUpdates = 0;	// Updates the last completed bake was spread over
+	double LastBakeMs = 0;				// Time spent on it in all
+};
+
+// --------------------------------------------------------
+// Makes a procedural sky's maps a little at a time, so that
+// changing it (the time of day moving the sun) never costs
+// more than a few milliseconds of any frame.
+//
+// A bake is a fixed list of steps, in dependency order:
+//
+//  - Each face of the sky, from the model
+//  - Each face of each of its mips, averaging the one above
+//  - Projecting a 64x64 (or smaller) mip to spherical
+//    harmonics, face by face
+//  - Each face of the irradiance cube, from those
+//  - Each face of each mip of the specular cube, filtered
+//    as PrefilterSpecularCubemap() does
+//
+// Update() works through rows of the current step until
+// its budget is used up.  It keeps a running cost per texel
+// for each kind of step at each mip size, and only starts
+// as many rows as that says will fit, so it stays under
+// budget without checking the clock in the middle of a row.
+// Every update makes at least one row of progress, however
+// small the budget, so a bake always finishes.
+//
+// The maps are double buffered: GetMaps() holds the last
+// completed bake until the next one is entirely done, then
+// they swap.  A request made during a bake waits for it to
+// finish rather than starting over, so a sun moving every
+// frame still gets new maps every bake's worth of frames.
+//
+// Nothing here needs D3D or threads; it all runs on the
+// calling thread.
+// --------------------------------------------------------
+class ProceduralSkyBaker
+{
+public:
+	// The sky is skySize across (a power of 2), with mips
+	// down to 1x1 for filtering; the specular cube is half
+	// that across, as PrefilterSpecularCubemap() expects
+	ProceduralSkyBaker(
+		unsigned int skySize = 256,
+		unsigned int irradianceSize = 32,
+		unsigned int specularMipLevels = 5,
+		unsigned int specularSampleCount = 32);
+
+	// Bakes these settings next, once any bake in progress
+	// is done
+	void Request(const ProceduralSkySettings& settings);
+
+	// Works for about budgetMs milliseconds.  True when that
+	// completed a bake, so GetMaps() has just changed.
+	bool Update(double budgetMs);
+
+	// Completes any bake in progress and the pending request,
+	// all at once
+	void Finish();
+
+	bool IsBaking() const { return baking; }
+	bool HasPendingRequest() const { return pending; }
+
+	// Fraction of the current bake done, by row
+	float GetProgress() const;
+
+	const ProceduralSkyMaps& GetMaps() const { return maps[front]; }
+	const ProceduralSkyStats& GetStats() const { return stats; }
+	void ResetStats() { stats = ProceduralSkyStats(); }
+
+	// How many rows an update starts next: as many of the
+	// step's rowsLeft as rowCostNs each says fit in
+	// remainingNs, or one when there's no estimate yet (a
+	// cost of 0).  0 means the update stops, which it only
+	// does once it has made some progress.
+	static unsigned int PlanSliceRows(double rowCostNs, double remainingNs, unsigned int rowsLeft, bool progressed);
+
+private:
+	enum StepKind
+	{
+		STEP_SKY,
+		STEP_SKY_MIP,
+		STEP_PROJECT_SH,
+		STEP_IRRADIANCE,
+		STEP_SPECULAR,
+		STEP_KIND_COUNT
+	};
+
+	struct Step
+	{
+		StepKind Kind;
+		unsigned int Face;
+		unsigned int Mip;
+		unsigned int Size;	// Rows, and texels in each
+	};
+
+	void StartBake();
+	void CompleteBake();
+	void RunRows(const Step& step, unsigned int firstRow, unsigned int endRow);
+
+	std::vector<Step> steps;
+	unsigned int totalRows;
+	unsigned int projectedMip;
+
+	// Nanoseconds per texel for each kind of step at each
+	// mip, 0 until measured
+	std::vector<double> texelCosts;
+	double& GetTexelCost(const Step& step);
+	static void UpdateTexelCost(double& texelCost, int64_t elapsedNs, double texels);
+
+	ProceduralSkySettings pendingSettings;
+	bool pending;
+
+	// Where the bake in progress is
+	bool baking;
+	size_t stepIndex;
+	unsigned int row;
+	unsigned int rowsDone;
+	unsigned int bakeUpdates;
+	double bakeMs;
+	PreethamSky model;
+	ProceduralSkySettings bakeSettings;
+
+	// Working data for a bake
+	LinearCubemap sky;
+	std::vector<std::vector<SpecularLobeSample>> lobes;
+	SH9Color radiance;
+	SH9Color irradiance;
+	std::vector<float> rowScratch;
+	unsigned int specularSampleCount;
+
+	ProceduralSkyMaps maps[2];
+	int front;
+	uint64_t generation;
+
+	ProceduralSkyStats stats;
+};
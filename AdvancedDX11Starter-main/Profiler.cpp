@@ -0,0 +1,484 @@
+#include "Profiler.h"
+#include "ImGui/imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_HAS_RDTSC 1
+#else
+#define PROFILER_HAS_RDTSC 0
+#endif
+
+// Singleton requirement
+Profiler* Profiler::instance;
+
+// --------------------------------------------------------
+//  Nanoseconds on the steady clock, used to calibrate
+//  the raw tick counter
+// --------------------------------------------------------
+static int64_t SteadyNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// --------------------------------------------------------
+//  Sets up the frame history and does a short initial
+//  calibration so tick conversions are usable right away
+// --------------------------------------------------------
+Profiler::Profiler()
+{
+	memset(frames, 0, sizeof(frames));
+	currentFrame = 0;
+	paused = false;
+	graphFrameCount = 3;
+	graphThread = 0;
+	pausedStart = 0;
+	pausedEnd = 0;
+
+	calibrationTicks = Now();
+	calibrationNanoseconds = SteadyNanoseconds();
+	secondsPerTick = 1e-9;
+
+	// Spin for a couple of milliseconds for a first estimate,
+	// which gets refined every frame afterwards
+	while (SteadyNanoseconds() - calibrationNanoseconds < 2000000) {}
+	Calibrate();
+}
+
+Profiler::~Profiler()
+{
+	// Threads still holding buffers check this as they exit
+	instance = 0;
+}
+
+// --------------------------------------------------------
+//  Raw timestamp for zones.  On x86 this is the invariant
+//  TSC (a handful of cycles to read), otherwise it falls
+//  back to the steady clock in nanoseconds.
+// --------------------------------------------------------
+uint64_t Profiler::Now()
+{
+#if PROFILER_HAS_RDTSC
+	return __rdtsc();
+#else
+	return (uint64_t)SteadyNanoseconds();
+#endif
+}
+
+// --------------------------------------------------------
+//  A thread's hold on its buffer, handing it back to the
+//  profiler that gave it out when the thread exits
+// --------------------------------------------------------
+struct ProfileThreadOwner
+{
+	Profiler* Owner = 0;
+	ProfileThreadBuffer* Buffer = 0;
+
+	~ProfileThreadOwner()
+	{
+		if (Buffer && Owner == Profiler::instance)
+			Owner->ReleaseThreadBuffer(Buffer);
+	}
+};
+
+// --------------------------------------------------------
+//  Returns this thread's event buffer.  The first call on
+//  a thread takes the registry lock once, reusing the
+//  buffer of a thread that has exited if there is one;
+//  after that it is a thread-local read.
+// --------------------------------------------------------
+ProfileThreadBuffer* Profiler::GetThreadBuffer()
+{
+	static thread_local ProfileThreadOwner owner;
+	if (owner.Buffer && owner.Owner == instance)
+		return owner.Buffer;
+
+	Profiler& profiler = GetInstance();
+	std::lock_guard<std::mutex> lock(profiler.registryMutex);
+
+	ProfileThreadBuffer* buffer = 0;
+	if (!profiler.freeThreadBuffers.empty())
+	{
+		// Keeps its track and write index, so its old events
+		// are still there until these overwrite them
+		buffer = profiler.freeThreadBuffers.back();
+		profiler.freeThreadBuffers.pop_back();
+	}
+	else
+	{
+		std::unique_ptr<ProfileThreadBuffer> newBuffer = std::make_unique<ProfileThreadBuffer>();
+		newBuffer->ThreadIndex = (unsigned int)profiler.threadBuffers.size();
+		newBuffer->WriteIndex.store(0);
+
+		buffer = newBuffer.get();
+		profiler.threadBuffers.push_back(std::move(newBuffer));
+	}
+	buffer->Depth = 0;
+
+	owner.Owner = &profiler;
+	owner.Buffer = buffer;
+	return buffer;
+}
+
+void Profiler::ReleaseThreadBuffer(ProfileThreadBuffer* buffer)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	freeThreadBuffers.push_back(buffer);
+}
+
+// --------------------------------------------------------
+//  Refines the tick-to-seconds ratio using everything
+//  since construction
+// --------------------------------------------------------
+void Profiler::Calibrate()
+{
+#if PROFILER_HAS_RDTSC
+	uint64_t ticks = Now() - calibrationTicks;
+	int64_t nanoseconds = SteadyNanoseconds() - calibrationNanoseconds;
+	if (ticks > 0 && nanoseconds > 0)
+		secondsPerTick = (double)nanoseconds / (double)ticks * 1e-9;
+#else
+	secondsPerTick = 1e-9;
+#endif
+}
+
+double Profiler::TicksToMilliseconds(uint64_t ticks)
+{
+	return (double)ticks * secondsPerTick * 1000.0;
+}
+
+// --------------------------------------------------------
+//  Marks the start of a new frame
+// --------------------------------------------------------
+void Profiler::BeginFrame()
+{
+	unsigned int frame = currentFrame.load(std::memory_order_relaxed) + 1;
+
+	ProfileFrame& f = frames[frame % FrameHistory];
+	f.Index = frame;
+	f.Start = Now();
+	f.End = 0;
+
+	currentFrame.store(frame, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+//  Marks the end of the current frame
+// --------------------------------------------------------
+void Profiler::EndFrame()
+{
+	unsigned int frame = currentFrame.load(std::memory_order_relaxed);
+	frames[frame % FrameHistory].End = Now();
+
+	// Calibration only gets more accurate the longer we run,
+	// so an occasional refresh is plenty
+	if (frame % 64 == 0)
+		Calibrate();
+}
+
+// --------------------------------------------------------
+//  Gets the tick range covering the last frameCount
+//  completed frames (clamped to the frame history)
+// --------------------------------------------------------
+bool Profiler::GetFrameRange(unsigned int frameCount, uint64_t* start, uint64_t* end)
+{
+	unsigned int current = currentFrame.load(std::memory_order_relaxed);
+	if (current < 2)
+		return false;
+
+	// The current frame is still in flight
+	unsigned int last = current - 1;
+	unsigned int available = std::min(last, FrameHistory - 1);
+	if (frameCount > available)
+		frameCount = available;
+
+	unsigned int first = last - frameCount + 1;
+	*start = frames[first % FrameHistory].Start;
+	*end = frames[last % FrameHistory].End;
+	return *end > *start;
+}
+
+// --------------------------------------------------------
+//  Copies the events from one thread that fall entirely
+//  inside the given tick range.  Events are published in
+//  the order they end, so we can walk backwards and stop
+//  as soon as we pass the start of the range.
+//
+//  The owning thread keeps writing while we copy, and can
+//  lap us on the oldest slots.  So, as a seqlock reader
+//  would, we read the write index again afterwards and drop
+//  every copy from a slot that could have been reused by
+//  then (including the one being written right now).
+// --------------------------------------------------------
+void Profiler::CopyEvents(ProfileThreadBuffer* buffer, uint64_t startTick, uint64_t endTick, std::vector<ProfileEvent>& out)
+{
+	const uint64_t capacity = ProfileThreadBuffer::Capacity;
+	uint64_t write = buffer->WriteIndex.load(std::memory_order_acquire);
+	uint64_t oldest = write > capacity ? write - capacity : 0;
+
+	size_t firstOut = out.size();
+	std::vector<uint64_t> indices;
+	for (uint64_t i = write; i > oldest; i--)
+	{
+		ProfileEvent e = buffer->Events[(i - 1) & (capacity - 1)];
+		if (e.End < startTick)
+			break;
+		if (e.Start >= startTick && e.End <= endTick)
+		{
+			out.push_back(e);
+			indices.push_back(i - 1);
+		}
+	}
+
+	// Copies are newest first, so the overwritten ones are
+	// all at the end
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t writeAfter = buffer->WriteIndex.load(std::memory_order_relaxed);
+	uint64_t firstIntact = writeAfter >= capacity ? writeAfter - capacity + 1 : 0;
+	size_t intact = 0;
+	while (intact < indices.size() && indices[intact] >= firstIntact)
+		intact++;
+	out.resize(firstOut + intact);
+
+	// Back to chronological order
+	std::reverse(out.begin() + firstOut, out.end());
+}
+
+// --------------------------------------------------------
+//  Writes the last frameCount frames as Chrome trace event
+//  JSON, which both chrome://tracing and Perfetto can open.
+//  A frameCount of 0 writes everything still buffered,
+//  including zones from before the first frame (loading).
+// --------------------------------------------------------
+bool Profiler::ExportChromeTrace(const char* path, unsigned int frameCount)
+{
+	uint64_t start = calibrationTicks;
+	uint64_t end = Now();
+	if (frameCount > 0 && !GetFrameRange(frameCount, &start, &end))
+		return false;
+
+	std::ofstream file(path);
+	if (!file.is_open())
+		return false;
+
+	// Microseconds relative to the start of the capture
+	double usPerTick = secondsPerTick * 1000000.0;
+	auto toMicroseconds = [&](uint64_t ticks) { return (double)(ticks - start) * usPerTick; };
+
+	char line[512];
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Frames\"}}";
+
+	// One track of frame boundaries
+	unsigned int last = currentFrame.load(std::memory_order_relaxed) - 1;
+	for (unsigned int i = 0; i < FrameHistory - 1 && i < last; i++)
+	{
+		const ProfileFrame& f = frames[(last - i) % FrameHistory];
+		if (f.Start < start || f.End > end || f.End == 0)
+			continue;
+
+		snprintf(line, sizeof(line), ",\n{\"name\":\"Frame %u\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+			f.Index, toMicroseconds(f.Start), (double)(f.End - f.Start) * usPerTick);
+		file << line;
+	}
+
+	// Then a track per thread
+	std::lock_guard<std::mutex> lock(registryMutex);
+	std::vector<ProfileEvent> events;
+	for (auto& buffer : threadBuffers)
+	{
+		unsigned int tid = buffer->ThreadIndex + 1;
+		snprintf(line, sizeof(line), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+			tid, buffer->ThreadIndex == 0 ? "Main Thread" : "Thread", buffer->ThreadIndex);
+		file << line;
+
+		events.clear();
+		CopyEvents(buffer.get(), start, end, events);
+		for (auto& e : events)
+		{
+			// Escape anything that would break the JSON string
+			std::string name;
+			for (const char* c = e.Name; *c; c++)
+			{
+				if (*c == '"' || *c == '\\')
+					name.push_back('\\');
+				name.push_back(*c);
+			}
+
+			snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+				name.c_str(), tid, toMicroseconds(e.Start), (double)(e.End - e.Start) * usPerTick, e.Frame);
+			file << line;
+		}
+	}
+
+	file << "\n]}\n";
+	return true;
+}
+
+// --------------------------------------------------------
+//  Stable color per zone name so a zone keeps its color
+//  from frame to frame
+// --------------------------------------------------------
+static ImU32 ZoneColor(const char* name)
+{
+	unsigned int hash = 2166136261u;
+	for (const char* c = name; *c; c++)
+		hash = (hash ^ (unsigned char)*c) * 16777619u;
+
+	float h = (hash % 360) / 360.0f;
+	float r, g, b;
+	ImGui::ColorConvertHSVtoRGB(h, 0.55f, 0.85f, r, g, b);
+	return ImGui::GetColorU32(ImVec4(r, g, b, 1.0f));
+}
+
+// --------------------------------------------------------
+//  Draws the profiler window: a flame graph of the last
+//  few frames for one thread, plus a per-zone summary
+//
+//  tracePath - Where the "Save Trace" button writes to
+// --------------------------------------------------------
+void Profiler::DrawImGuiWindow(const char* tracePath, bool* open)
+{
+	ImGui::Begin("Profiler", open);
+
+	// Pausing freezes the view on the frames being shown
+	bool wasPaused = paused;
+	ImGui::Checkbox("Pause", &paused);
+	ImGui::SameLine();
+	ImGui::SliderInt("Frames", &graphFrameCount, 1, 16);
+
+	int threadCount = 0;
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		threadCount = (int)threadBuffers.size();
+	}
+	if (threadCount > 1)
+		ImGui::SliderInt("Thread", &graphThread, 0, threadCount - 1);
+	graphThread = std::max(0, std::min(graphThread, threadCount - 1));
+
+	if (ImGui::Button("Save Trace"))
+	{
+		exportResult = ExportChromeTrace(tracePath) ?
+			std::string("Saved ") + tracePath :
+			std::string("Could not write ") + tracePath;
+	}
+	if (!exportResult.empty())
+	{
+		ImGui::SameLine();
+		ImGui::Text("%s", exportResult.c_str());
+	}
+
+	uint64_t start = 0;
+	uint64_t end = 0;
+	if (paused && wasPaused)
+	{
+		start = pausedStart;
+		end = pausedEnd;
+	}
+	else if (!GetFrameRange(graphFrameCount, &start, &end) || threadCount == 0)
+	{
+		ImGui::End();
+		return;
+	}
+	pausedStart = start;
+	pausedEnd = end;
+
+	std::vector<ProfileEvent> events;
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		CopyEvents(threadBuffers[graphThread].get(), start, end, events);
+	}
+
+	unsigned int maxDepth = 0;
+	for (auto& e : events)
+		maxDepth = std::max(maxDepth, e.Depth);
+
+	ImGui::Text("%.3f ms across %d frame(s), %d zones",
+		TicksToMilliseconds(end - start), graphFrameCount, (int)events.size());
+
+	// Reserve the space for the graph, then draw into it
+	const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	ImVec2 size(std::max(ImGui::GetContentRegionAvail().x, 100.0f), rowHeight * (maxDepth + 1));
+	ImGui::InvisibleButton("FlameGraph", size);
+	bool graphHovered = ImGui::IsItemHovered();
+	ImVec2 mouse = ImGui::GetIO().MousePos;
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+	double pixelsPerTick = size.x / (double)(end - start);
+	const ProfileEvent* hovered = 0;
+	for (auto& e : events)
+	{
+		float x0 = origin.x + (float)((e.Start - start) * pixelsPerTick);
+		float x1 = origin.x + (float)((e.End - start) * pixelsPerTick);
+		float y0 = origin.y + e.Depth * rowHeight;
+		float y1 = y0 + rowHeight - 1.0f;
+		x1 = std::max(x1, x0 + 1.0f);
+
+		drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), ZoneColor(e.Name));
+
+		// Only label zones wide enough to read
+		if (x1 - x0 > 20.0f)
+		{
+			ImVec4 clip(x0, y0, x1 - 2.0f, y1);
+			drawList->AddText(0, 0.0f, ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(0, 0, 0, 255), e.Name, 0, 0.0f, &clip);
+		}
+
+		if (graphHovered && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1)
+			hovered = &e;
+	}
+
+	// Frame boundaries
+	unsigned int last = currentFrame.load(std::memory_order_relaxed) - 1;
+	for (unsigned int i = 0; i < FrameHistory - 1 && i < last; i++)
+	{
+		const ProfileFrame& f = frames[(last - i) % FrameHistory];
+		if (f.Start < start)
+			break;
+		if (f.Start > end)
+			continue;
+
+		float x = origin.x + (float)((f.Start - start) * pixelsPerTick);
+		drawList->AddLine(ImVec2(x, origin.y), ImVec2(x, origin.y + size.y), IM_COL32(255, 255, 255, 128));
+	}
+
+	if (hovered)
+	{
+		ImGui::BeginTooltip();
+		ImGui::Text("%s", hovered->Name);
+		ImGui::Text("%.3f ms (frame %u)", TicksToMilliseconds(hovered->End - hovered->Start), hovered->Frame);
+		ImGui::EndTooltip();
+	}
+
+	// Per-zone totals, averaged over the frames shown
+	if (ImGui::TreeNode("Zone Totals"))
+	{
+		std::unordered_map<const char*, uint64_t> totals;
+		for (auto& e : events)
+			totals[e.Name] += e.End - e.Start;
+
+		std::vector<std::pair<const char*, uint64_t>> sorted(totals.begin(), totals.end());
+		std::sort(sorted.begin(), sorted.end(),
+			[](const std::pair<const char*, uint64_t>& a, const std::pair<const char*, uint64_t>& b) { return a.second > b.second; });
+
+		for (auto& z : sorted)
+			ImGui::Text("%8.3f ms  %s", TicksToMilliseconds(z.second) / graphFrameCount, z.first);
+
+		ImGui::TreePop();
+	}
+
+	ImGui::End();
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Set to 0 to compile every PROFILE_ZONE out of the build
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 1
+#endif
+
+// --------------- Basic usage -----------------
+//
+// Place a zone at the top of any scope you want timed.
+// The zone ends when the scope does, and zones nest:
+//
+//  void Game::Update(float deltaTime, float totalTime)
+//  {
+//      PROFILE_ZONE("Game::Update");
+//      {
+//          PROFILE_ZONE("Camera");
+//          camera->Update(deltaTime);
+//      }
+//  }
+//
+// Zone names must be string literals (or otherwise
+// outlive the capture), as only the pointer is stored.
+//
+// DXCore::Run() marks frame boundaries, which is what
+// the flame graph window and trace export use to
+// group zones into frames.
+// ---------------------------------------------
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if ENABLE_PROFILER
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#endif
+
+// A single completed zone
+struct ProfileEvent
+{
+	const char* Name;
+	uint64_t Start;			// Raw ticks (see Profiler::Now)
+	uint64_t End;
+	unsigned int Depth;		// Nesting level on its thread
+	unsigned int Frame;		// Frame the zone started in
+};
+
+// Start and end of one frame, as marked by DXCore
+struct ProfileFrame
+{
+	unsigned int Index;
+	uint64_t Start;
+	uint64_t End;
+};
+
+// One per live thread that has opened a zone.  Only the owning
+// thread writes, so the write index is the only synchronization
+// needed: readers acquire it, copy what is behind it, then check
+// it again to throw out anything overwritten while they copied.
+// When a thread exits its buffer goes back to the profiler for
+// the next new thread, so short lived threads don't each keep
+// one (2 MB) for good.
+struct ProfileThreadBuffer
+{
+	static const unsigned int Capacity = 1 << 16; // Power of two
+
+	unsigned int ThreadIndex;
+	unsigned int Depth;
+	std::atomic<uint64_t> WriteIndex;
+	ProfileEvent Events[Capacity];
+};
+
+class Profiler
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static Profiler& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new Profiler();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	Profiler(Profiler const&) = delete;
+	void operator=(Profiler const&) = delete;
+
+private:
+	static Profiler* instance;
+	Profiler();
+	friend struct ProfileThreadOwner;
+#pragma endregion
+
+public:
+	~Profiler();
+
+	// Cheap timestamp used by zones
+	static uint64_t Now();
+
+	// The calling thread's buffer, registering it on first use
+	static ProfileThreadBuffer* GetThreadBuffer();
+
+	// Makes a buffer available to the next thread that needs
+	// one, called as its thread exits
+	void ReleaseThreadBuffer(ProfileThreadBuffer* buffer);
+
+	// Frame markers, called by DXCore::Run()
+	void BeginFrame();
+	void EndFrame();
+
+	unsigned int GetCurrentFrame() { return currentFrame.load(std::memory_order_relaxed); }
+	double TicksToMilliseconds(uint64_t ticks);
+
+	// Captures
+	void SetPaused(bool paused) { this->paused = paused; }
+	bool IsPaused() { return paused; }
+	bool ExportChromeTrace(const char* path, unsigned int frameCount = 0);
+
+	// ImGui window with a flame graph of the last few frames
+	void DrawImGuiWindow(const char* tracePath, bool* open = 0);
+
+private:
+	// Per-thread storage, owned here so it outlives its thread
+	// (its events stay visible until another thread reuses it)
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<ProfileThreadBuffer>> threadBuffers;
+	std::vector<ProfileThreadBuffer*> freeThreadBuffers;
+
+	// Recent frame boundaries
+	static const unsigned int FrameHistory = 256;
+	ProfileFrame frames[FrameHistory];
+	std::atomic<unsigned int> currentFrame;
+	bool paused;
+
+	// Tick calibration against the steady clock
+	uint64_t calibrationTicks;
+	int64_t calibrationNanoseconds;
+	double secondsPerTick;
+	void Calibrate();
+
+	// Flame graph settings
+	int graphFrameCount;
+	int graphThread;
+
+	// The frames the flame graph froze on when paused, and
+	// the outcome of the last "Save Trace"
+	uint64_t pausedStart;
+	uint64_t pausedEnd;
+	std::string exportResult;
+
+	void CopyEvents(ProfileThreadBuffer* buffer, uint64_t startTick, uint64_t endTick, std::vector<ProfileEvent>& out);
+	bool GetFrameRange(unsigned int frameCount, uint64_t* start, uint64_t* end);
+};
+
+// --------------------------------------------------------
+// Records a zone for the lifetime of this object.  Only
+// touches the current thread's buffer, so no locks.
+// --------------------------------------------------------
+class ProfileZone
+{
+public:
+	ProfileZone(const char* name)
+	{
+		buffer = Profiler::GetThreadBuffer();
+		this->name = name;
+		depth = buffer->Depth++;
+		frame = Profiler::GetInstance().GetCurrentFrame();
+		start = Profiler::Now();
+	}
+
+	~ProfileZone()
+	{
+		uint64_t end = Profiler::Now();
+		buffer->Depth--;
+
+		// Write the event, then publish it
+		uint64_t index = buffer->WriteIndex.load(std::memory_order_relaxed);
+		ProfileEvent& e = buffer->Events[index & (ProfileThreadBuffer::Capacity - 1)];
+		e.Name = name;
+		e.Start = start;
+		e.End = end;
+		e.Depth = depth;
+		e.Frame = frame;
+		buffer->WriteIndex.store(index + 1, std::memory_order_release);
+	}
+
+	ProfileZone(ProfileZone const&) = delete;
+	void operator=(ProfileZone const&) = delete;
+
+private:
+	ProfileThreadBuffer* buffer;
+	const char* name;
+	uint64_t start;
+	unsigned int depth;
+	unsigned int frame;
+};
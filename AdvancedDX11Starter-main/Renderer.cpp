@@ -4,6 +4,9 @@
 #include "ImGui/imgui_impl_dx11.h"
 #include "ImGui\imgui_impl_win32.h"
 #include "SimpleShader.h"
+#include "ShaderStructs.h"
+#include "Profiler.h"
+#include "FrameArena.h"
 
 using namespace DirectX;
 
@@ -61,6 +64,37 @@ Renderer::Renderer(Microsoft::WRL::ComPtr<ID3D11Device> device,
 
 	PostResize(windowWidth, windowHeight, backBufferRTV, depthBufferDSV);
 
+	// Resolve handles for per-draw data up front
+	refractionBindings = GetPerFrameBindings(refractionPS);
+	refractionScreenSizeHandle = refractionPS->GetVariableHandle("screenSize");
+	refractionScaleHandle = refractionPS->GetVariableHandle("refractionScale");
+	refractionNormalHandle = refractionPS->GetShaderResourceViewHandle("NormalTexture");
+	refractionScreenPixelsHandle = refractionPS->GetShaderResourceViewHandle("ScreenPixels");
+
+	lightViewHandle = lightVS->GetVariableHandle("view");
+	lightProjectionHandle = lightVS->GetVariableHandle("projection");
+	lightWorldHandle = lightVS->GetVariableHandle("world");
+	lightWorldInvTransHandle = lightVS->GetVariableHandle("worldInverseTranspose");
+	lightColorHandle = lightPS->GetVariableHandle("Color");
+
+	skySunDirectionHandle = skyPS->GetVariableHandle("sunDirection");
+	skyFalloffExponentHandle = skyPS->GetVariableHandle("falloffExponent");
+	skySunColorHandle = skyPS->GetVariableHandle("sunColor");
+
+	ssaoNormalsHandle = ssaoPS->GetShaderResourceViewHandle("Normals");
+	ssaoDepthsHandle = ssaoPS->GetShaderResourceViewHandle("Depths");
+	ssaoRandomHandle = ssaoPS->GetShaderResourceViewHandle("Random");
+	ssaoBlurInputHandle = ssaoBlurPS->GetShaderResourceViewHandle("SSAO");
+	ssaoBlurPixelSizeHandle = ssaoBlurPS->GetVariableHandle("pixelSize");
+	ssaoCombineSceneHandle = ssaoCombinePS->GetShaderResourceViewHandle("SceneColorsNoAmbient");
+	ssaoCombineAmbientHandle = ssaoCombinePS->GetShaderResourceViewHandle("Ambient");
+	ssaoCombineBlurHandle = ssaoCombinePS->GetShaderResourceViewHandle("SSAOBlur");
+	ssaoCombinePixelSizeHandle = ssaoCombinePS->GetVariableHandle("pixelSize");
+
+	finalPixelsHandle = simplePS->GetShaderResourceViewHandle("pixels");
+	lightRaySkyAndOccludersHandle = lightRayPS->GetShaderResourceViewHandle("SkyAndOccluders");
+	lightRayFinalSceneHandle = lightRayPS->GetShaderResourceViewHandle("FinalScene");
+
 	//set up ssao offsets
 	for (int i = 0; i < ARRAYSIZE(ssaoOffsets); i++) {
 	
@@ -134,6 +168,8 @@ void Renderer::PostResize(unsigned int windowWidth, unsigned int windowHeight, M
 
 void Renderer::Render(std::shared_ptr<Camera> camera, float totalTime)
 {
+	PROFILE_ZONE("Renderer::Render");
+
 	// Background color for clearing
 	const float color[4] = { 0, 0, 0, 1 };
 
@@ -169,121 +205,142 @@ void Renderer::Render(std::shared_ptr<Camera> camera, float totalTime)
 		1.0f,
 		0);
 
-	std::vector<std::shared_ptr<GameEntity>> refractiveEntities;
+	// Refractive entities are drawn after everything else
+	FrameVector<GameEntity*> refractiveEntities;
+	refractiveEntities.reserve(entities.size());
 
 	// Draw all of the entities
-	for (auto& ge : entities)
 	{
-		if (ge->GetMaterial()->GetRefractive()) {
-			refractiveEntities.push_back(ge);
-			continue;
+		PROFILE_ZONE("Opaque Entities");
+		for (auto& ge : entities)
+		{
+			if (ge->GetMaterial()->GetRefractive()) {
+				refractiveEntities.push_back(ge.get());
+				continue;
+			}
+			// Set the "per frame" data
+			// Note that this should literally be set once PER FRAME, before
+			// the draw loop, but we're currently setting it per entity since 
+			// we are just using whichever shader the current entity has.  
+			// Inefficient!!!
+			std::shared_ptr<SimplePixelShader> ps = ge->GetMaterial()->GetPixelShader();
+			PerFrameBindings& b = GetPerFrameBindings(ps);
+			ps->SetData(b.Lights, (void*)(&lights[0]), sizeof(Light) * lightCount);
+			ps->SetInt(b.LightCount, lightCount);
+			ps->SetFloat3(b.CameraPosition, camera->GetViewPosition());
+			ps->SetInt(b.SpecIBLTotalMipLevels, sky->GetSpecIBLMipLevels());
+			ps->SetShaderResourceView(b.BrdfLookUpMap, sky->GetBRDFLookUpTexture().Get());
+			ps->SetShaderResourceView(b.IrradianceIBLMap, sky->GetIrradianceMap().Get());
+			ps->SetShaderResourceView(b.SpecularIBLMap, sky->GetSpecularMap().Get());
+
+			for (int i = 0; i <= SCENE_SKY_AND_OCCLUDERS; i++)
+				ps->SetShaderResourceView(b.SceneTextures[i], renderTargetSRVs[i].Get());
+
+			ps->CopyBufferData(b.PerFrameBuffer);
+
+
+
+			// Draw the entity
+			ge->Draw(context, camera);
 		}
-		// Set the "per frame" data
-		// Note that this should literally be set once PER FRAME, before
-		// the draw loop, but we're currently setting it per entity since 
-		// we are just using whichever shader the current entity has.  
-		// Inefficient!!!
-		std::shared_ptr<SimplePixelShader> ps = ge->GetMaterial()->GetPixelShader();
-		ps->SetData("lights", (void*)(&lights[0]), sizeof(Light) * lightCount);
-		ps->SetInt("lightCount", lightCount);
-		ps->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
-		ps->SetInt("SpecIBLTotalMipLevels", sky->GetSpecIBLMipLevels());
-		ps->SetShaderResourceView("BrdfLookUpMap", sky->GetBRDFLookUpTexture());
-		ps->SetShaderResourceView("IrradianceIBLMap", sky->GetIrradianceMap());
-		ps->SetShaderResourceView("SpecularIBLMap", sky->GetSpecularMap());
-
-		ps->SetShaderResourceView("colorNoAmbient", renderTargetSRVs[RenderTargetType::SCENE_COLORS_NO_AMBIENT]);
-		ps->SetShaderResourceView("sceneColors", renderTargetSRVs[RenderTargetType::SCENE_COLORS]);
-		ps->SetShaderResourceView("sceneNormals", renderTargetSRVs[RenderTargetType::SCENE_NORMALS]);
-		ps->SetShaderResourceView("sceneDepths", renderTargetSRVs[RenderTargetType::SCENE_DEPTHS]);
-		ps->SetShaderResourceView("skyAndOccluders", renderTargetSRVs[RenderTargetType::SCENE_SKY_AND_OCCLUDERS]);
-
-		ps->CopyBufferData("perFrame");
-
-
-
-		// Draw the entity
-		ge->Draw(context, camera);
 	}
 
 	// Draw the light sources
-	if(drawPointMeshes)DrawPointLights(camera);
+	if (drawPointMeshes)
+	{
+		PROFILE_ZONE("Point Lights");
+		DrawPointLights(camera);
+	}
 
 	// Draw the sky
-	skyPS->SetFloat3("sunDirection", SunDirection);
-	skyPS->SetFloat("falloffExponent", lightRaySunFalloffExponent);
-	skyPS->SetFloat3("sunColor", lightRayColor);
-	skyPS->CopyAllBufferData();
-	sky->Draw(camera);
+	{
+		PROFILE_ZONE("Sky");
+		skyPS->SetFloat3(skySunDirectionHandle, SunDirection);
+		skyPS->SetFloat(skyFalloffExponentHandle, lightRaySunFalloffExponent);
+		skyPS->SetFloat3(skySunColorHandle, lightRayColor);
+		skyPS->CopyAllBufferData();
+		sky->Draw(camera);
+	}
 
 	//draw ssao (NOTE: SSAO DOESNT WORK)
-	fullScreenVS->SetShader();
-	targets[0] = renderTargetRTVs[RenderTargetType::SSAO_RESULTS].Get();
-	targets[1] = 0;
-	targets[2] = 0;
-	targets[3] = 0;
-	context->OMSetRenderTargets(numTargets, targets, 0);
-	ssaoPS->SetShader();
-
-	XMFLOAT4X4 invView, invProj, view = camera->GetView(), proj = camera->GetProjection();
-	XMStoreFloat4x4(&invView, XMMatrixInverse(0, XMLoadFloat4x4(&view)));
-	XMStoreFloat4x4(&invProj, XMMatrixInverse(0, XMLoadFloat4x4(&proj)));
-	ssaoPS->SetMatrix4x4("invViewMatrix", invView);
-	ssaoPS->SetMatrix4x4("invProjMatrix", invProj);
-	ssaoPS->SetMatrix4x4("viewMatrix", view);
-	ssaoPS->SetMatrix4x4("projectionMatrix", proj);
-	ssaoPS->SetData("offsets", ssaoOffsets, sizeof(XMFLOAT4) * ARRAYSIZE(ssaoOffsets));
-	ssaoPS->SetFloat("ssaoRadius", ssaoRadius);
-	ssaoPS->SetInt("ssaoSamples", ssaoSamples);
-	ssaoPS->SetFloat2("randomTextureScreenScale", XMFLOAT2(windowWidth / 4.0f, windowHeight / 4.0f));
-	ssaoPS->CopyAllBufferData();
-	ssaoPS->SetShaderResourceView("Normals", renderTargetSRVs[RenderTargetType::SCENE_NORMALS]);
-	ssaoPS->SetShaderResourceView("Depths", renderTargetSRVs[RenderTargetType::SCENE_DEPTHS]);
-	ssaoPS->SetShaderResourceView("Random", randomTexture.Get());
-	context->Draw(3, 0);
+	{
+		PROFILE_ZONE("SSAO");
+		fullScreenVS->SetShader();
+		targets[0] = renderTargetRTVs[RenderTargetType::SSAO_RESULTS].Get();
+		targets[1] = 0;
+		targets[2] = 0;
+		targets[3] = 0;
+		context->OMSetRenderTargets(numTargets, targets, 0);
+		ssaoPS->SetShader();
+
+		SsaoPSExternalData ssaoData = {};
+		ssaoData.viewMatrix = camera->GetView();
+		ssaoData.projectionMatrix = camera->GetProjection();
+		XMStoreFloat4x4(&ssaoData.invProjMatrix, XMMatrixInverse(0, XMLoadFloat4x4(&ssaoData.projectionMatrix)));
+		memcpy(ssaoData.offsets, ssaoOffsets, sizeof(ssaoData.offsets));
+		ssaoData.ssaoRadius = ssaoRadius;
+		ssaoData.ssaoSamples = ssaoSamples;
+		ssaoData.randomTextureScreenScale = XMFLOAT2(windowWidth / 4.0f, windowHeight / 4.0f);
+		ssaoPS->SetBufferData(ssaoData);
+		ssaoPS->CopyAllBufferData();
+		ssaoPS->SetShaderResourceView(ssaoNormalsHandle, renderTargetSRVs[RenderTargetType::SCENE_NORMALS].Get());
+		ssaoPS->SetShaderResourceView(ssaoDepthsHandle, renderTargetSRVs[RenderTargetType::SCENE_DEPTHS].Get());
+		ssaoPS->SetShaderResourceView(ssaoRandomHandle, randomTexture.Get());
+		context->Draw(3, 0);
+	}
 
 	//SSAO blur
-	targets[0] = renderTargetRTVs[RenderTargetType::SSAO_BLUR].Get();
-	context->OMSetRenderTargets(1, targets, 0);
-	ssaoBlurPS->SetShader();
+	{
+		PROFILE_ZONE("SSAO Blur");
+		targets[0] = renderTargetRTVs[RenderTargetType::SSAO_BLUR].Get();
+		context->OMSetRenderTargets(1, targets, 0);
+		ssaoBlurPS->SetShader();
 
-	ssaoBlurPS->SetShaderResourceView("SSAO", renderTargetSRVs[RenderTargetType::SSAO_RESULTS]);
-	ssaoBlurPS->SetFloat2("pixelSize", XMFLOAT2(1.0f / windowWidth, 1.0f / windowHeight));
-	ssaoBlurPS->CopyAllBufferData();
-	context->Draw(3, 0);
+		ssaoBlurPS->SetShaderResourceView(ssaoBlurInputHandle, renderTargetSRVs[RenderTargetType::SSAO_RESULTS].Get());
+		ssaoBlurPS->SetFloat2(ssaoBlurPixelSizeHandle, XMFLOAT2(1.0f / windowWidth, 1.0f / windowHeight));
+		ssaoBlurPS->CopyAllBufferData();
+		context->Draw(3, 0);
+	}
 
 	//SSAO Combine
-	targets[0] = renderTargetRTVs[RenderTargetType::FINAL_COMPOSITE].Get();
-	context->OMSetRenderTargets(1, targets, 0);
-	ssaoCombinePS->SetShader();
-	ssaoCombinePS->SetShaderResourceView("SceneColorsNoAmbient", renderTargetSRVs[RenderTargetType::SCENE_COLORS_NO_AMBIENT]);
-	ssaoCombinePS->SetShaderResourceView("Ambient", renderTargetSRVs[RenderTargetType::SCENE_COLORS]);
-	ssaoCombinePS->SetShaderResourceView("SSAOBlur", renderTargetSRVs[RenderTargetType::SSAO_BLUR]);
-	ssaoCombinePS->SetFloat2("pixelSize", XMFLOAT2(1.0f / windowWidth, 1.0f / windowHeight));
-	ssaoCombinePS->CopyAllBufferData();
-	context->Draw(3, 0);
+	{
+		PROFILE_ZONE("SSAO Combine");
+		targets[0] = renderTargetRTVs[RenderTargetType::FINAL_COMPOSITE].Get();
+		context->OMSetRenderTargets(1, targets, 0);
+		ssaoCombinePS->SetShader();
+		ssaoCombinePS->SetShaderResourceView(ssaoCombineSceneHandle, renderTargetSRVs[RenderTargetType::SCENE_COLORS_NO_AMBIENT].Get());
+		ssaoCombinePS->SetShaderResourceView(ssaoCombineAmbientHandle, renderTargetSRVs[RenderTargetType::SCENE_COLORS].Get());
+		ssaoCombinePS->SetShaderResourceView(ssaoCombineBlurHandle, renderTargetSRVs[RenderTargetType::SSAO_BLUR].Get());
+		ssaoCombinePS->SetFloat2(ssaoCombinePixelSizeHandle, XMFLOAT2(1.0f / windowWidth, 1.0f / windowHeight));
+		ssaoCombinePS->CopyAllBufferData();
+		context->Draw(3, 0);
+	}
 
 
 
 	//draw final results
-	fullScreenVS->SetShader();
-	targets[0] = backBufferRTV.Get();
-	context->OMSetRenderTargets(1, targets, 0);
+	{
+		PROFILE_ZONE("Final Composite");
+		fullScreenVS->SetShader();
+		targets[0] = backBufferRTV.Get();
+		context->OMSetRenderTargets(1, targets, 0);
 
-	simplePS->SetShader();
-	simplePS->SetShaderResourceView("pixels", renderTargetSRVs[RenderTargetType::SCENE_COLORS_NO_AMBIENT].Get());
+		simplePS->SetShader();
+		simplePS->SetShaderResourceView(finalPixelsHandle, renderTargetSRVs[RenderTargetType::SCENE_COLORS_NO_AMBIENT].Get());
 
-	context->Draw(3, 0);
-	context->OMSetRenderTargets(1, targets, depthBufferDSV.Get());
+		context->Draw(3, 0);
+		context->OMSetRenderTargets(1, targets, depthBufferDSV.Get());
+	}
 
 	//draw light rays
 	if (useLightRays) {
+		PROFILE_ZONE("Light Rays");
 		fullScreenVS->SetShader();
 		targets[0] = backBufferRTV.Get();
 		context->OMSetRenderTargets(1, targets, 0);
 
-		view = camera->GetView();
-		proj = camera->GetProjection();
+		XMFLOAT4X4 view = camera->GetView();
+		XMFLOAT4X4 proj = camera->GetProjection();
 		XMVECTOR lightPosinWorld = XMLoadFloat3(&SunDirection);
 		XMVECTOR lightPosScreenVec = XMVector4Transform(lightPosinWorld, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&proj));
 		lightPosScreenVec /= XMVectorGetW(lightPosScreenVec); // divide by the perspective
@@ -292,14 +349,16 @@ void Renderer::Render(std::shared_ptr<Camera> camera, float totalTime)
 		XMStoreFloat2(&lightPosScreen, lightPosScreenVec);
 
 		lightRayPS->SetShader();
-		lightRayPS->SetShaderResourceView("SkyAndOccluders", renderTargetSRVs[RenderTargetType::SCENE_SKY_AND_OCCLUDERS]);
-		lightRayPS->SetShaderResourceView("FinalScene", renderTargetSRVs[RenderTargetType::SCENE_COLORS_NO_AMBIENT]);
-		lightRayPS->SetInt("numSamples", numLightRaySamples);
-		lightRayPS->SetFloat("density", lightRayDensity);
-		lightRayPS->SetFloat("weight", lightRaySampleWeight);
-		lightRayPS->SetFloat("decay", lightDecay);
-		lightRayPS->SetFloat("exposure", lightRayExposure);
-		lightRayPS->SetFloat2("lightPosScreenSpace", lightPosScreen);
+		lightRayPS->SetShaderResourceView(lightRaySkyAndOccludersHandle, renderTargetSRVs[RenderTargetType::SCENE_SKY_AND_OCCLUDERS].Get());
+		lightRayPS->SetShaderResourceView(lightRayFinalSceneHandle, renderTargetSRVs[RenderTargetType::SCENE_COLORS_NO_AMBIENT].Get());
+		LightRayPSExternalData lightRayData = {};
+		lightRayData.numSamples = numLightRaySamples;
+		lightRayData.density = lightRayDensity;
+		lightRayData.weight = lightRaySampleWeight;
+		lightRayData.decay = lightDecay;
+		lightRayData.exposure = lightRayExposure;
+		lightRayData.lightPosScreenSpace = lightPosScreen;
+		lightRayPS->SetBufferData(lightRayData);
 		lightRayPS->CopyAllBufferData();
 		context->Draw(3, 0);
 	}
@@ -307,24 +366,25 @@ void Renderer::Render(std::shared_ptr<Camera> camera, float totalTime)
 
 	//draw refraction
 	if (useRefraction) {
+		PROFILE_ZONE("Refraction");
 		fullScreenVS->SetShader();
 		targets[0] = backBufferRTV.Get();
 		context->OMSetRenderTargets(1, targets, 0);
 
-		for (auto refractiveGE : refractiveEntities) {
+		for (GameEntity* refractiveGE : refractiveEntities) {
 			std::shared_ptr<Material> material = refractiveGE->GetMaterial();
 			std::shared_ptr<SimplePixelShader> prevPS = material->GetPixelShader(); //get materials PS so we can set it back later after refraction
 			material->SetPixelShader(refractionPS);
-			refractionPS->SetData("lights", (void*)(&lights[0]), sizeof(Light) * lightCount);
-			refractionPS->SetInt("lightCount", lightCount);
-			refractionPS->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
-			refractionPS->SetInt("SpecIBLTotalMipLevels", sky->GetSpecIBLMipLevels());
-			refractionPS->SetFloat2("screenSize", XMFLOAT2((float)windowWidth, (float)windowHeight));
-			refractionPS->SetFloat("refractionScale", refractionScale);
-			refractionPS->CopyBufferData("perFrame");
+			refractionPS->SetData(refractionBindings.Lights, (void*)(&lights[0]), sizeof(Light) * lightCount);
+			refractionPS->SetInt(refractionBindings.LightCount, lightCount);
+			refractionPS->SetFloat3(refractionBindings.CameraPosition, camera->GetViewPosition());
+			refractionPS->SetInt(refractionBindings.SpecIBLTotalMipLevels, sky->GetSpecIBLMipLevels());
+			refractionPS->SetFloat2(refractionScreenSizeHandle, XMFLOAT2((float)windowWidth, (float)windowHeight));
+			refractionPS->SetFloat(refractionScaleHandle, refractionScale);
+			refractionPS->CopyBufferData(refractionBindings.PerFrameBuffer);
 
-			refractionPS->SetShaderResourceView("NormalTexture", material->GetTextureSRV("NormalMap"));
-			refractionPS->SetShaderResourceView("ScreenPixels", renderTargetSRVs[RenderTargetType::SCENE_COLORS_NO_AMBIENT].Get());
+			refractionPS->SetShaderResourceView(refractionNormalHandle, material->GetTextureSRV("NormalMap").Get());
+			refractionPS->SetShaderResourceView(refractionScreenPixelsHandle, renderTargetSRVs[RenderTargetType::SCENE_COLORS_NO_AMBIENT].Get());
 
 			refractiveGE->Draw(context, camera);
 
@@ -333,29 +393,38 @@ void Renderer::Render(std::shared_ptr<Camera> camera, float totalTime)
 	}
 
 	//now draw particles (commented out)
-	targets[0] = backBufferRTV.Get();
-	context->OMSetRenderTargets(1, targets, depthBufferDSV.Get());
+	{
+		PROFILE_ZONE("Particles");
+		targets[0] = backBufferRTV.Get();
+		context->OMSetRenderTargets(1, targets, depthBufferDSV.Get());
 
-	context->OMSetBlendState(particleBlendState.Get(), 0, 0xFFFFFFFF);
-	context->OMSetDepthStencilState(particleDepthState.Get(), 0);
+		context->OMSetBlendState(particleBlendState.Get(), 0, 0xFFFFFFFF);
+		context->OMSetDepthStencilState(particleDepthState.Get(), 0);
 
-	for (auto& emitter : emitters) {
-		emitter->Draw(camera, totalTime);
-	} 
+		for (auto& emitter : emitters) {
+			emitter->Draw(camera, totalTime);
+		} 
 
-	context->OMSetBlendState(0, 0, 0xFFFFFFFF);
-	context->OMSetDepthStencilState(0, 0);
+		context->OMSetBlendState(0, 0, 0xFFFFFFFF);
+		context->OMSetDepthStencilState(0, 0);
+	}
 
 
 	//Draw ImGui
-	ImGui::Render();
-	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+	{
+		PROFILE_ZONE("ImGui Render");
+		ImGui::Render();
+		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+	}
 
 
 	// Present the back buffer to the user
 	//  - Puts the final frame we're drawing into the window so the user can see it
 	//  - Do this exactly ONCE PER FRAME (always at the very end of the frame)
-	swapchain->Present(0, 0);
+	{
+		PROFILE_ZONE("Present");
+		swapchain->Present(0, 0);
+	}
 
 	// Due to the usage of a more sophisticated swap chain,
 	// the render target must be re-bound after every call to Present()
@@ -452,8 +521,8 @@ void Renderer::DrawPointLights(std::shared_ptr<Camera> camera)
 	lightPS->SetShader();
 
 	// Set up vertex shader
-	lightVS->SetMatrix4x4("view", camera->GetView());
-	lightVS->SetMatrix4x4("projection", camera->GetProjection());
+	lightVS->SetMatrix4x4(lightViewHandle, camera->GetView());
+	lightVS->SetMatrix4x4(lightProjectionHandle, camera->GetProjection());
 
 	for (int i = 0; i < lightCount; i++)
 	{
@@ -478,15 +547,15 @@ void Renderer::DrawPointLights(std::shared_ptr<Camera> camera)
 		XMStoreFloat4x4(&worldInvTrans, XMMatrixInverse(0, XMMatrixTranspose(worldMat)));
 
 		// Set up the world matrix for this light
-		lightVS->SetMatrix4x4("world", world);
-		lightVS->SetMatrix4x4("worldInverseTranspose", worldInvTrans);
+		lightVS->SetMatrix4x4(lightWorldHandle, world);
+		lightVS->SetMatrix4x4(lightWorldInvTransHandle, worldInvTrans);
 
 		// Set up the pixel shader data
 		XMFLOAT3 finalColor = light.Color;
 		finalColor.x *= light.Intensity;
 		finalColor.y *= light.Intensity;
 		finalColor.z *= light.Intensity;
-		lightPS->SetFloat3("Color", finalColor);
+		lightPS->SetFloat3(lightColorHandle, finalColor);
 
 		// Copy data
 		lightVS->CopyAllBufferData();
@@ -497,4 +566,34 @@ void Renderer::DrawPointLights(std::shared_ptr<Camera> camera)
 	}
 }
 
+// --------------------------------------------------------
+// Finds (or resolves) the per-frame handles for an entity's
+// pixel shader.  There are only a few distinct shaders, so
+// a linear search beats hashing.
+// --------------------------------------------------------
+Renderer::PerFrameBindings& Renderer::GetPerFrameBindings(const std::shared_ptr<SimplePixelShader>& ps)
+{
+	for (PerFrameBindings& b : perFrameBindings)
+	{
+		if (b.PS == ps)
+			return b;
+	}
 
+	const char* sceneTextureNames[] = { "colorNoAmbient", "sceneColors", "sceneNormals", "sceneDepths", "skyAndOccluders" };
+
+	PerFrameBindings b;
+	b.PS = ps;
+	b.Lights = ps->GetVariableHandle("lights");
+	b.LightCount = ps->GetVariableHandle("lightCount");
+	b.CameraPosition = ps->GetVariableHandle("cameraPosition");
+	b.SpecIBLTotalMipLevels = ps->GetVariableHandle("SpecIBLTotalMipLevels");
+	b.BrdfLookUpMap = ps->GetShaderResourceViewHandle("BrdfLookUpMap");
+	b.IrradianceIBLMap = ps->GetShaderResourceViewHandle("IrradianceIBLMap");
+	b.SpecularIBLMap = ps->GetShaderResourceViewHandle("SpecularIBLMap");
+	for (int i = 0; i <= SCENE_SKY_AND_OCCLUDERS; i++)
+		b.SceneTextures[i] = ps->GetShaderResourceViewHandle(sceneTextureNames[i]);
+	b.PerFrameBuffer = ps->GetBufferIndex("perFrame");
+
+	perFrameBindings.push_back(b);
+	return perFrameBindings.back();
+}
@@ -135,5 +135,54 @@ private:
 
 
 	void DrawPointLights(std::shared_ptr<Camera> camera);
+
+	// Handles for the per-frame data every entity's pixel shader
+	// gets, resolved once per shader
+	struct PerFrameBindings
+	{
+		std::shared_ptr<SimplePixelShader> PS;
+		SimpleVariableHandle Lights;
+		SimpleVariableHandle LightCount;
+		SimpleVariableHandle CameraPosition;
+		SimpleVariableHandle SpecIBLTotalMipLevels;
+		SimpleResourceHandle BrdfLookUpMap;
+		SimpleResourceHandle IrradianceIBLMap;
+		SimpleResourceHandle SpecularIBLMap;
+		SimpleResourceHandle SceneTextures[SCENE_SKY_AND_OCCLUDERS + 1];
+		unsigned int PerFrameBuffer;
+	};
+	std::vector<PerFrameBindings> perFrameBindings;
+	PerFrameBindings& GetPerFrameBindings(const std::shared_ptr<SimplePixelShader>& ps);
+
+	// Handles for the shaders the renderer owns
+	PerFrameBindings refractionBindings;
+	SimpleVariableHandle refractionScreenSizeHandle;
+	SimpleVariableHandle refractionScaleHandle;
+	SimpleResourceHandle refractionNormalHandle;
+	SimpleResourceHandle refractionScreenPixelsHandle;
+
+	SimpleVariableHandle lightViewHandle;
+	SimpleVariableHandle lightProjectionHandle;
+	SimpleVariableHandle lightWorldHandle;
+	SimpleVariableHandle lightWorldInvTransHandle;
+	SimpleVariableHandle lightColorHandle;
+
+	SimpleVariableHandle skySunDirectionHandle;
+	SimpleVariableHandle skyFalloffExponentHandle;
+	SimpleVariableHandle skySunColorHandle;
+
+	SimpleResourceHandle ssaoNormalsHandle;
+	SimpleResourceHandle ssaoDepthsHandle;
+	SimpleResourceHandle ssaoRandomHandle;
+	SimpleResourceHandle ssaoBlurInputHandle;
+	SimpleVariableHandle ssaoBlurPixelSizeHandle;
+	SimpleResourceHandle ssaoCombineSceneHandle;
+	SimpleResourceHandle ssaoCombineAmbientHandle;
+	SimpleResourceHandle ssaoCombineBlurHandle;
+	SimpleVariableHandle ssaoCombinePixelSizeHandle;
+
+	SimpleResourceHandle finalPixelsHandle;
+	SimpleResourceHandle lightRaySkyAndOccludersHandle;
+	SimpleResourceHandle lightRayFinalSceneHandle;
 };
 
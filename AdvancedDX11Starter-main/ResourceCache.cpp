@@ -0,0 +1,385 @@
+#include "ResourceCache.h"
+
+#include "Profiler.h"
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cwctype>
+
+using namespace DirectX;
+
+ResourceCache::ResourceCache(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	size_t budget)
+	:
+	device(device),
+	context(context),
+	budget(budget),
+	evictions(0)
+{
+}
+
+ResourceCache::~ResourceCache()
+{
+	// Workers still hold the device, so let them finish
+	for (TextureEntry& entry : textures)
+	{
+		if (entry.PendingLoad.valid())
+			entry.PendingLoad.wait();
+	}
+}
+
+// --------------------------------------------------------
+// Turns any spelling of a path into one key: full path,
+// lower case, backslashes only
+// --------------------------------------------------------
+std::wstring ResourceCache::NormalizePath(const std::wstring& path)
+{
+	wchar_t fullPath[1024] = {};
+	DWORD length = GetFullPathNameW(path.c_str(), ARRAYSIZE(fullPath), fullPath, 0);
+	std::wstring result = (length > 0 && length < ARRAYSIZE(fullPath)) ? std::wstring(fullPath, length) : path;
+
+	for (wchar_t& c : result)
+		c = (c == L'/') ? L'\\' : (wchar_t)towlower(c);
+
+	return result;
+}
+
+std::wstring ResourceCache::MakeKey(const std::wstring& normalizedPath, const TextureLoadOptions& options)
+{
+	// The thread count doesn't change the mips, so isn't here
+	const MipOptions& mips = options.Mips;
+	wchar_t suffix[64];
+	swprintf_s(suffix, L"|%d%d%d|%u|%d%d%d%d%d|%g",
+		options.IgnoreSRGB ? 1 : 0,
+		options.ForceSRGB ? 1 : 0,
+		options.GenerateMips ? 1 : 0,
+		options.MaxSize,
+		(int)mips.Filter,
+		mips.SRGB ? 1 : 0,
+		mips.NormalMap ? 1 : 0,
+		mips.Wrap ? 1 : 0,
+		mips.PreserveAlphaCoverage ? 1 : 0,
+		mips.AlphaReference);
+	return normalizedPath + suffix;
+}
+
+// --------------------------------------------------------
+// Finds a texture, marking it as the most recently used
+// --------------------------------------------------------
+ResourceCache::TextureEntry* ResourceCache::FindTexture(const std::wstring& key)
+{
+	auto it = textureTable.find(key);
+	if (it == textureTable.end())
+		return 0;
+
+	textures.splice(textures.begin(), textures, it->second);
+	return &textures.front();
+}
+
+ResourceCache::TextureEntry& ResourceCache::AddTexture(const std::wstring& key, const std::wstring& path, const TextureLoadOptions& options)
+{
+	textures.emplace_front();
+	TextureEntry& entry = textures.front();
+	entry.Key = key;
+	entry.Options = options;
+	entry.Texture = std::make_shared<CachedTexture>();
+	entry.Texture->Path = path;
+
+	textureTable[key] = textures.begin();
+	return entry;
+}
+
+// --------------------------------------------------------
+// Decodes an image the way the streamer does (see
+// TextureStreamer::DecodeImage), mips and all, then creates
+// an immutable texture from the whole chain.  Only uses the
+// device, so it's safe on worker threads.  MaxSize drops
+// whole mips from the top, so needs GenerateMips.
+// --------------------------------------------------------
+static Microsoft::WRL::ComPtr<ID3D11Resource> CreateTexture(ID3D11Device* device, const std::wstring& path, const TextureLoadOptions& options)
+{
+	std::shared_ptr<TextureStreamer::TextureData> data = TextureStreamer::DecodeImage(path, options);
+	if (!data)
+		return 0;
+
+	unsigned int topMip = 0;
+	while (options.MaxSize > 0 && topMip + 1 < data->Mips.size() &&
+		((data->Width >> topMip) > options.MaxSize || (data->Height >> topMip) > options.MaxSize))
+		topMip++;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = (std::max)(1u, data->Width >> topMip);
+	desc.Height = (std::max)(1u, data->Height >> topMip);
+	desc.MipLevels = (UINT)data->Mips.size() - topMip;
+	desc.ArraySize = 1;
+	desc.Format = data->Format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData(desc.MipLevels);
+	for (unsigned int i = 0; i < desc.MipLevels; i++)
+	{
+		initialData[i].pSysMem = data->Mips[topMip + i].data();
+		initialData[i].SysMemPitch = (std::max)(1u, desc.Width >> i) * 4;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(device->CreateTexture2D(&desc, initialData.data(), texture.GetAddressOf())))
+		return 0;
+	return texture;
+}
+
+std::shared_ptr<CachedTexture> ResourceCache::LoadTexture(const std::wstring& path, const TextureLoadOptions& options)
+{
+	std::wstring normalizedPath = NormalizePath(path);
+	std::wstring key = MakeKey(normalizedPath, options);
+
+	TextureEntry* existing = FindTexture(key);
+	if (existing)
+	{
+		// Already on its way - just finish it now
+		if (existing->PendingLoad.valid())
+			FinishLoad(*existing, existing->PendingLoad.get());
+		return existing->Texture;
+	}
+
+	PROFILE_ZONE("Load texture");
+	TextureEntry& entry = AddTexture(key, normalizedPath, options);
+
+	FinishLoad(entry, CreateTexture(device.Get(), normalizedPath, options));
+	return entry.Texture;
+}
+
+std::shared_ptr<CachedTexture> ResourceCache::LoadTextureAsync(const std::wstring& path, const TextureLoadOptions& options)
+{
+	std::wstring normalizedPath = NormalizePath(path);
+	std::wstring key = MakeKey(normalizedPath, options);
+
+	TextureEntry* existing = FindTexture(key);
+	if (existing)
+		return existing->Texture;
+
+	TextureEntry& entry = AddTexture(key, normalizedPath, options);
+
+	// Workers only touch the device, which is free threaded
+	Microsoft::WRL::ComPtr<ID3D11Device> workerDevice = device;
+	entry.PendingLoad = std::async(std::launch::async, [workerDevice, normalizedPath, options]()
+	{
+		PROFILE_ZONE("Decode texture");
+		return CreateTexture(workerDevice.Get(), normalizedPath, options);
+	});
+
+	return entry.Texture;
+}
+
+// --------------------------------------------------------
+// Finishes a loaded texture by making its SRV
+// --------------------------------------------------------
+void ResourceCache::FinishLoad(TextureEntry& entry, Microsoft::WRL::ComPtr<ID3D11Resource> resource)
+{
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (!resource || FAILED(resource.As(&texture)))
+	{
+		entry.Texture->Failed = true;
+		return;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (FAILED(device->CreateShaderResourceView(texture.Get(), 0, srv.GetAddressOf())))
+	{
+		entry.Texture->Failed = true;
+		return;
+	}
+
+	entry.Texture->SRV = srv;
+	entry.Texture->GPUBytes = CalculateTextureBytes(texture.Get());
+}
+
+void ResourceCache::Update()
+{
+	for (TextureEntry& entry : textures)
+	{
+		if (entry.PendingLoad.valid() &&
+			entry.PendingLoad.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			FinishLoad(entry, entry.PendingLoad.get());
+		}
+	}
+
+	Evict();
+}
+
+void ResourceCache::WaitForLoads()
+{
+	PROFILE_ZONE("Wait for textures");
+	for (TextureEntry& entry : textures)
+	{
+		if (entry.PendingLoad.valid())
+			FinishLoad(entry, entry.PendingLoad.get());
+	}
+}
+
+// --------------------------------------------------------
+// A texture is unused once the cache holds the only handle
+// to it
+// --------------------------------------------------------
+static bool IsUnused(const std::shared_ptr<CachedTexture>& texture)
+{
+	return texture.use_count() == 1;
+}
+
+// --------------------------------------------------------
+// Drops unused textures, least recently used first, until
+// the cache is back under budget
+// --------------------------------------------------------
+void ResourceCache::Evict()
+{
+	size_t gpuBytes = 0;
+	for (TextureEntry& entry : textures)
+		gpuBytes += entry.Texture->GPUBytes;
+
+	auto it = textures.end();
+	while (gpuBytes > budget && it != textures.begin())
+	{
+		--it;
+		if (it->PendingLoad.valid() || !IsUnused(it->Texture))
+			continue;
+
+		gpuBytes -= it->Texture->GPUBytes;
+		textureTable.erase(it->Key);
+		it = textures.erase(it);
+		evictions++;
+	}
+}
+
+// --------------------------------------------------------
+// Finds or creates a sampler.  D3D already shares
+// identical sampler states, but this skips the call (and
+// keeps them alive) for descriptions seen before.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11SamplerState> ResourceCache::GetSampler(const D3D11_SAMPLER_DESC& desc)
+{
+	std::string key((const char*)&desc, sizeof(desc));
+	auto it = samplers.find(key);
+	if (it != samplers.end())
+		return it->second;
+
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
+	device->CreateSamplerState(&desc, sampler.GetAddressOf());
+	if (sampler)
+		samplers[key] = sampler;
+	return sampler;
+}
+
+ResourceCacheStats ResourceCache::GetStats()
+{
+	ResourceCacheStats stats = {};
+	stats.Textures = (unsigned int)textures.size();
+	stats.Samplers = (unsigned int)samplers.size();
+	stats.Evictions = evictions;
+	stats.Budget = budget;
+
+	for (TextureEntry& entry : textures)
+	{
+		if (entry.PendingLoad.valid())
+			stats.PendingLoads++;
+		stats.GPUBytes += entry.Texture->GPUBytes;
+	}
+
+	return stats;
+}
+
+std::vector<std::shared_ptr<CachedTexture>> ResourceCache::GetTextures()
+{
+	std::vector<std::shared_ptr<CachedTexture>> result;
+	result.reserve(textures.size());
+	for (TextureEntry& entry : textures)
+		result.push_back(entry.Texture);
+	return result;
+}
+
+// --------------------------------------------------------
+// Format sizes for the formats textures here end up in.
+// Block compressed sizes are per pixel of a 4x4 block.
+// --------------------------------------------------------
+static unsigned int GetBitsPerPixel(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return 128;
+
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R32G32_FLOAT:
+		return 64;
+
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_FLOAT:
+		return 16;
+
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+
+	default:
+		return 32;
+	}
+}
+
+static bool IsBlockCompressed(DXGI_FORMAT format)
+{
+	return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+		(format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+}
+
+// --------------------------------------------------------
+// Size of every mip of every array slice of a texture
+// --------------------------------------------------------
+size_t ResourceCache::CalculateTextureBytes(ID3D11Resource* resource)
+{
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (!resource || FAILED(resource->QueryInterface(IID_PPV_ARGS(texture.GetAddressOf()))))
+		return 0;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	texture->GetDesc(&desc);
+
+	// Block compressed formats store whole 4x4 blocks
+	bool blockCompressed = IsBlockCompressed(desc.Format);
+	size_t bytes = 0;
+	for (unsigned int mip = 0; mip < desc.MipLevels; mip++)
+	{
+		size_t width = (std::max)(1u, desc.Width >> mip);
+		size_t height = (std::max)(1u, desc.Height >> mip);
+		if (blockCompressed)
+		{
+			width = (width + 3) & ~(size_t)3;
+			height = (height + 3) & ~(size_t)3;
+		}
+		bytes += width * height * GetBitsPerPixel(desc.Format) / 8;
+	}
+
+	return bytes * desc.ArraySize;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include <future>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MipGenerator.h"
+
+// How a texture is loaded.  Part of the cache key, so the
+// same file loaded two ways is two entries.
+struct TextureLoadOptions
+{
+	bool IgnoreSRGB = false;	// Treat the data as linear (normal maps and the like)
+	bool ForceSRGB = false;
+	bool GenerateMips = true;	// On the CPU, filtered as Mips says
+	unsigned int MaxSize = 0;	// 0 for no limit (only applies with mips)
+	MipOptions Mips;
+};
+
+// --------------------------------------------------------
+// A texture owned by the cache.  The SRV is null until an
+// async load finishes (see ResourceCache::Update()), or if
+// the file failed to load.
+// --------------------------------------------------------
+struct CachedTexture
+{
+	std::wstring Path;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;
+	size_t GPUBytes = 0;		// Textures keep no CPU copy once created
+	bool Failed = false;
+
+	bool IsReady() const { return SRV != 0; }
+};
+
+// Totals across everything cached
+struct ResourceCacheStats
+{
+	unsigned int Textures;
+	unsigned int Samplers;
+	unsigned int PendingLoads;
+	unsigned int Evictions;		// Since the cache was created
+	size_t GPUBytes;
+	size_t Budget;
+};
+
+// --------------------------------------------------------
+// Loads each texture exactly once, keyed by its normalized
+// full path plus load options, and hands out shared
+// handles to it.  Identical sampler descriptions share one
+// sampler state.
+//
+// Textures can be decoded (and their mips generated) on
+// worker threads with LoadTextureAsync().  Those get their
+// SRVs from Update() on the main thread, or all at once
+// from WaitForLoads().
+//
+// Textures nobody else holds a handle to are kept around
+// for reuse until the cache goes over its GPU memory
+// budget, then evicted least recently used first.  So hold
+// on to the handle (Material::AddTexture() does) for as
+// long as the texture's in use, not just its SRV.
+// --------------------------------------------------------
+class ResourceCache
+{
+public:
+	static const size_t DefaultBudget = 512 * 1024 * 1024;
+
+	ResourceCache(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		size_t budget = DefaultBudget);
+	~ResourceCache();
+
+	// Loads (or finds) a texture right away
+	std::shared_ptr<CachedTexture> LoadTexture(const std::wstring& path, const TextureLoadOptions& options = TextureLoadOptions());
+
+	// Starts decoding a texture on another thread, returning
+	// its (not yet ready) handle straight away
+	std::shared_ptr<CachedTexture> LoadTextureAsync(const std::wstring& path, const TextureLoadOptions& options = TextureLoadOptions());
+
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> GetSampler(const D3D11_SAMPLER_DESC& desc);
+
+	// Call once per frame: finishes completed async loads,
+	// then evicts unused textures if over budget
+	void Update();
+
+	// Blocks until every async load has finished
+	void WaitForLoads();
+
+	void SetBudget(size_t bytes) { budget = bytes; }
+	size_t GetBudget() { return budget; }
+
+	ResourceCacheStats GetStats();
+
+	// Every cached texture, most recently used first
+	std::vector<std::shared_ptr<CachedTexture>> GetTextures();
+
+	// Full path, lower case, backslashes only
+	static std::wstring NormalizePath(const std::wstring& path);
+
+	// Identifies a texture loaded with these options
+	static std::wstring MakeKey(const std::wstring& normalizedPath, const TextureLoadOptions& options);
+
+private:
+	struct TextureEntry
+	{
+		std::wstring Key;
+		TextureLoadOptions Options;
+		std::shared_ptr<CachedTexture> Texture;
+
+		// Set while a worker thread is decoding.  The worker's
+		// texture is complete; Update() only adds the SRV.
+		std::future<Microsoft::WRL::ComPtr<ID3D11Resource>> PendingLoad;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	size_t budget;
+	unsigned int evictions;
+
+	// Most recently used at the front
+	std::list<TextureEntry> textures;
+	std::unordered_map<std::wstring, std::list<TextureEntry>::iterator> textureTable;
+
+	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
+
+	TextureEntry* FindTexture(const std::wstring& key);
+	TextureEntry& AddTexture(const std::wstring& key, const std::wstring& path, const TextureLoadOptions& options);
+	void FinishLoad(TextureEntry& entry, Microsoft::WRL::ComPtr<ID3D11Resource> resource);
+	void Evict();
+
+	static size_t CalculateTextureBytes(ID3D11Resource* resource);
+};
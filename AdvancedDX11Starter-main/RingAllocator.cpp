@@ -0,0 +1,114 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(size_t capacity, size_t alignment)
+	: alignment(alignment)
+{
+	Reset(capacity);
+}
+
+void RingAllocator::Reset()
+{
+	head = 0;
+	tail = 0;
+	allocatedTotal = 0;
+	freedTotal = 0;
+	frameStartTotal = 0;
+	fences.clear();
+}
+
+void RingAllocator::Reset(size_t capacity)
+{
+	// Keep the capacity a whole number of aligned blocks so
+	// wrapping always lands back on an aligned offset
+	this->capacity = capacity & ~(alignment - 1);
+	Reset();
+}
+
+// --------------------------------------------------------
+//  Finds room for an allocation, wrapping back to the start
+//  of the ring if it doesn't fit before the end.  The bytes
+//  skipped at the end count as used until their frame is
+//  retired, so the fences stay simple offsets.
+// --------------------------------------------------------
+size_t RingAllocator::Allocate(size_t size)
+{
+	size = (size + alignment - 1) & ~(alignment - 1);
+	if (size == 0 || size > capacity)
+		return InvalidOffset;
+
+	size_t used = GetUsed();
+	if (used == capacity)
+		return InvalidOffset;
+
+	// Nothing in flight, so start from the beginning to get
+	// the largest contiguous run.  Any fences still queued
+	// were all placed at the old head.
+	if (used == 0)
+	{
+		head = 0;
+		tail = 0;
+		for (Fence& fence : fences)
+			fence.Head = 0;
+	}
+
+	size_t offset;
+	if (head >= tail)
+	{
+		// Free space is [head, capacity) and [0, tail)
+		if (head + size <= capacity)
+		{
+			offset = head;
+		}
+		else if (size <= tail)
+		{
+			allocatedTotal += capacity - head;
+			offset = 0;
+		}
+		else
+		{
+			return InvalidOffset;
+		}
+	}
+	else
+	{
+		// Free space is [head, tail)
+		if (head + size > tail)
+			return InvalidOffset;
+		offset = head;
+	}
+
+	head = offset + size;
+	if (head == capacity)
+		head = 0;
+
+	allocatedTotal += size;
+	return offset;
+}
+
+// --------------------------------------------------------
+//  Marks the end of a frame's allocations
+// --------------------------------------------------------
+void RingAllocator::EndFrame(uint64_t frame)
+{
+	Fence fence;
+	fence.Frame = frame;
+	fence.Head = head;
+	fence.AllocatedTotal = allocatedTotal;
+	fences.push_back(fence);
+
+	frameStartTotal = allocatedTotal;
+}
+
+// --------------------------------------------------------
+//  Frees everything allocated up to and including the
+//  given frame, once the GPU is known to be done with it
+// --------------------------------------------------------
+void RingAllocator::RetireFrame(uint64_t frame)
+{
+	while (!fences.empty() && fences.front().Frame <= frame)
+	{
+		tail = fences.front().Head;
+		freedTotal = fences.front().AllocatedTotal;
+		fences.pop_front();
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// --------------------------------------------------------
+// Offset allocator for a ring buffer that the GPU reads
+// from a few frames behind the CPU.  It only hands out
+// offsets - the memory itself belongs to whoever owns the
+// ring (see ConstantRing) - so it can be used and tested
+// without a device.
+//
+// Each frame ends with a fence at the current head.  Once
+// the GPU is done with that frame, RetireFrame() frees
+// everything up to the fence.  Allocate() never returns
+// space that hasn't been retired, and fails instead; the
+// owner can then wait, or start over with Reset().
+// --------------------------------------------------------
+class RingAllocator
+{
+public:
+	static const size_t InvalidOffset = (size_t)-1;
+
+	// alignment - Every allocation starts on a multiple of
+	//             this (power of two)
+	RingAllocator(size_t capacity = 0, size_t alignment = 256);
+
+	// Drops every allocation and fence, optionally resizing
+	void Reset();
+	void Reset(size_t capacity);
+
+	// Returns the offset of "size" free bytes, or InvalidOffset
+	size_t Allocate(size_t size);
+
+	// Fences
+	void EndFrame(uint64_t frame);
+	void RetireFrame(uint64_t frame);
+
+	size_t GetCapacity() { return capacity; }
+	size_t GetAlignment() { return alignment; }
+	size_t GetUsed() { return (size_t)(allocatedTotal - freedTotal); }
+	size_t GetFrameBytes() { return (size_t)(allocatedTotal - frameStartTotal); }
+	size_t GetPendingFrames() { return fences.size(); }
+
+private:
+	struct Fence
+	{
+		uint64_t Frame;
+		size_t Head;
+		uint64_t AllocatedTotal;
+	};
+
+	size_t capacity;
+	size_t alignment;
+	size_t head;	// Next free byte
+	size_t tail;	// Oldest byte still in use
+
+	// Running byte counts (including padding skipped when
+	// wrapping), so "used" can't be confused between an
+	// empty and a full ring with head == tail
+	uint64_t allocatedTotal;
+	uint64_t freedTotal;
+	uint64_t frameStartTotal;
+
+	std::deque<Fence> fences;
+};
@@ -0,0 +1,321 @@
+#include "ShaderMetadata.h"
+
+#include <string.h>
+
+// Layout of the binary form, all little endian:
+//
+//  Header    - magic, version, source hash (64 bit), then the
+//              buffer, variable, texture, sampler and input
+//              counts and the string pool size
+//  Buffers   - name, type, bind index, size, first variable, variable count
+//  Variables - name, byte offset, size
+//  Textures  - name, bind index
+//  Samplers  - name, bind index
+//  Inputs    - semantic name, semantic index, mask, component type
+//  Strings   - Null terminated, referenced by offset from above
+//
+// Every field other than the hash is 32 bits.
+static const uint32_t MetadataMagic = 0x54454D53; // "SMET"
+static const size_t HeaderSize = 2 * 4 + 8 + 6 * 4;
+static const size_t BufferRecordSize = 6 * 4;
+static const size_t VariableRecordSize = 3 * 4;
+static const size_t ResourceRecordSize = 2 * 4;
+static const size_t InputRecordSize = 4 * 4;
+
+// --------------------------------------------------------
+// Appends fields to the output, and strings to a separate
+// pool that's added to the end
+// --------------------------------------------------------
+class MetadataWriter
+{
+public:
+	MetadataWriter(std::vector<unsigned char>& out) : out(out) {}
+
+	void Write32(uint32_t value)
+	{
+		unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+		out.insert(out.end(), bytes, bytes + 4);
+	}
+
+	void Write64(uint64_t value)
+	{
+		Write32((uint32_t)value);
+		Write32((uint32_t)(value >> 32));
+	}
+
+	void WriteString(const std::string& text)
+	{
+		Write32((uint32_t)strings.size());
+		strings.insert(strings.end(), text.begin(), text.end());
+		strings.push_back(0);
+	}
+
+	void Finish() { out.insert(out.end(), strings.begin(), strings.end()); }
+
+private:
+	std::vector<unsigned char>& out;
+	std::vector<unsigned char> strings;
+};
+
+static void HashBytes(uint32_t* hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		*hash ^= bytes[i];
+		*hash *= 16777619u;
+	}
+}
+
+static void Hash32(uint32_t* hash, uint32_t value)
+{
+	unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+	HashBytes(hash, bytes, 4);
+}
+
+uint32_t ShaderMetadataBuffer::LayoutHash() const
+{
+	uint32_t hash = 2166136261u;
+	for (const ShaderMetadataVariable& var : Variables)
+	{
+		// Names with their terminator, so "ab" + "c" differs
+		// from "a" + "bc"
+		HashBytes(&hash, var.Name.c_str(), var.Name.size() + 1);
+		Hash32(&hash, var.ByteOffset);
+		Hash32(&hash, var.Size);
+	}
+	Hash32(&hash, Size);
+	return hash;
+}
+
+void ShaderMetadata::Serialize(std::vector<unsigned char>& out) const
+{
+	// Strings are pooled while writing the records, so
+	// work out the pool size with a first pass
+	uint32_t variableCount = 0;
+	uint32_t stringBytes = 0;
+	for (const ShaderMetadataBuffer& b : Buffers)
+	{
+		stringBytes += (uint32_t)b.Name.size() + 1;
+		for (const ShaderMetadataVariable& v : b.Variables)
+			stringBytes += (uint32_t)v.Name.size() + 1;
+		variableCount += (uint32_t)b.Variables.size();
+	}
+	for (const ShaderMetadataResource& t : Textures) stringBytes += (uint32_t)t.Name.size() + 1;
+	for (const ShaderMetadataResource& s : Samplers) stringBytes += (uint32_t)s.Name.size() + 1;
+	for (const ShaderMetadataInput& i : Inputs) stringBytes += (uint32_t)i.SemanticName.size() + 1;
+
+	out.clear();
+	out.reserve(HeaderSize +
+		Buffers.size() * BufferRecordSize +
+		variableCount * VariableRecordSize +
+		(Textures.size() + Samplers.size()) * ResourceRecordSize +
+		Inputs.size() * InputRecordSize +
+		stringBytes);
+
+	MetadataWriter writer(out);
+	writer.Write32(MetadataMagic);
+	writer.Write32(Version);
+	writer.Write64(SourceHash);
+	writer.Write32((uint32_t)Buffers.size());
+	writer.Write32(variableCount);
+	writer.Write32((uint32_t)Textures.size());
+	writer.Write32((uint32_t)Samplers.size());
+	writer.Write32((uint32_t)Inputs.size());
+	writer.Write32(stringBytes);
+
+	uint32_t firstVariable = 0;
+	for (const ShaderMetadataBuffer& b : Buffers)
+	{
+		writer.WriteString(b.Name);
+		writer.Write32(b.Type);
+		writer.Write32(b.BindIndex);
+		writer.Write32(b.Size);
+		writer.Write32(firstVariable);
+		writer.Write32((uint32_t)b.Variables.size());
+		firstVariable += (uint32_t)b.Variables.size();
+	}
+
+	for (const ShaderMetadataBuffer& b : Buffers)
+	{
+		for (const ShaderMetadataVariable& v : b.Variables)
+		{
+			writer.WriteString(v.Name);
+			writer.Write32(v.ByteOffset);
+			writer.Write32(v.Size);
+		}
+	}
+
+	for (const ShaderMetadataResource& t : Textures)
+	{
+		writer.WriteString(t.Name);
+		writer.Write32(t.BindIndex);
+	}
+
+	for (const ShaderMetadataResource& s : Samplers)
+	{
+		writer.WriteString(s.Name);
+		writer.Write32(s.BindIndex);
+	}
+
+	for (const ShaderMetadataInput& i : Inputs)
+	{
+		writer.WriteString(i.SemanticName);
+		writer.Write32(i.SemanticIndex);
+		writer.Write32(i.Mask);
+		writer.Write32(i.ComponentType);
+	}
+
+	writer.Finish();
+}
+
+// --------------------------------------------------------
+// Reads fields in order, failing (and staying failed) if
+// anything would read outside the data
+// --------------------------------------------------------
+class MetadataReader
+{
+public:
+	MetadataReader(const unsigned char* data, size_t size) : data(data), size(size), position(0), failed(false) {}
+
+	uint32_t Read32()
+	{
+		if (failed || size - position < 4)
+		{
+			failed = true;
+			return 0;
+		}
+
+		const unsigned char* p = data + position;
+		position += 4;
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	uint64_t Read64()
+	{
+		uint64_t low = Read32();
+		uint64_t high = Read32();
+		return low | (high << 32);
+	}
+
+	// Strings live in the pool at the end of the data
+	std::string ReadString()
+	{
+		uint32_t offset = Read32();
+		if (failed || offset >= stringBytes)
+		{
+			failed = true;
+			return std::string();
+		}
+
+		const char* text = (const char*)strings + offset;
+		const void* end = memchr(text, 0, stringBytes - offset);
+		if (!end)
+		{
+			failed = true;
+			return std::string();
+		}
+
+		return std::string(text, (const char*)end - text);
+	}
+
+	void SetStrings(const unsigned char* pool, uint32_t bytes) { strings = pool; stringBytes = bytes; }
+	bool Failed() { return failed; }
+
+private:
+	const unsigned char* data;
+	size_t size;
+	size_t position;
+	bool failed;
+
+	const unsigned char* strings = 0;
+	uint32_t stringBytes = 0;
+};
+
+bool ShaderMetadata::Parse(const void* data, size_t size, uint64_t expectedSourceHash)
+{
+	MetadataReader reader((const unsigned char*)data, size);
+	if (reader.Read32() != MetadataMagic ||
+		reader.Read32() != Version ||
+		reader.Read64() != expectedSourceHash)
+		return false;
+
+	uint32_t bufferCount = reader.Read32();
+	uint32_t variableCount = reader.Read32();
+	uint32_t textureCount = reader.Read32();
+	uint32_t samplerCount = reader.Read32();
+	uint32_t inputCount = reader.Read32();
+	uint32_t stringBytes = reader.Read32();
+	if (reader.Failed())
+		return false;
+
+	// The counts have to account for the exact size, which
+	// also means nothing below can read out of bounds
+	uint64_t expectedSize = HeaderSize +
+		(uint64_t)bufferCount * BufferRecordSize +
+		(uint64_t)variableCount * VariableRecordSize +
+		((uint64_t)textureCount + samplerCount) * ResourceRecordSize +
+		(uint64_t)inputCount * InputRecordSize +
+		stringBytes;
+	if (expectedSize != size)
+		return false;
+
+	reader.SetStrings((const unsigned char*)data + (size - stringBytes), stringBytes);
+
+	SourceHash = expectedSourceHash;
+	Buffers.resize(bufferCount);
+	std::vector<uint32_t> firstVariables(bufferCount);
+	std::vector<uint32_t> variableCounts(bufferCount);
+	for (uint32_t b = 0; b < bufferCount; b++)
+	{
+		Buffers[b].Name = reader.ReadString();
+		Buffers[b].Type = reader.Read32();
+		Buffers[b].BindIndex = reader.Read32();
+		Buffers[b].Size = reader.Read32();
+		firstVariables[b] = reader.Read32();
+		variableCounts[b] = reader.Read32();
+
+		if (firstVariables[b] > variableCount || variableCounts[b] > variableCount - firstVariables[b])
+			return false;
+	}
+
+	std::vector<ShaderMetadataVariable> variables(variableCount);
+	for (ShaderMetadataVariable& v : variables)
+	{
+		v.Name = reader.ReadString();
+		v.ByteOffset = reader.Read32();
+		v.Size = reader.Read32();
+	}
+
+	for (uint32_t b = 0; b < bufferCount; b++)
+	{
+		Buffers[b].Variables.assign(
+			variables.begin() + firstVariables[b],
+			variables.begin() + firstVariables[b] + variableCounts[b]);
+	}
+
+	Textures.resize(textureCount);
+	for (ShaderMetadataResource& t : Textures)
+	{
+		t.Name = reader.ReadString();
+		t.BindIndex = reader.Read32();
+	}
+
+	Samplers.resize(samplerCount);
+	for (ShaderMetadataResource& s : Samplers)
+	{
+		s.Name = reader.ReadString();
+		s.BindIndex = reader.Read32();
+	}
+
+	Inputs.resize(inputCount);
+	for (ShaderMetadataInput& i : Inputs)
+	{
+		i.SemanticName = reader.ReadString();
+		i.SemanticIndex = reader.Read32();
+		i.Mask = reader.Read32();
+		i.ComponentType = reader.Read32();
+	}
+
+	return !reader.Failed();
+}
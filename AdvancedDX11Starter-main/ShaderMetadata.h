@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Everything SimpleShader needs from reflecting a compiled
+// shader: constant buffers and their variables, textures,
+// samplers and vertex inputs.  D3D enum values are kept as
+// plain integers so this builds (and can be tested)
+// without any D3D headers.
+// --------------------------------------------------------
+struct ShaderMetadataVariable
+{
+	std::string Name;
+	uint32_t ByteOffset;
+	uint32_t Size;
+};
+
+struct ShaderMetadataBuffer
+{
+	std::string Name;
+	uint32_t Type;		// D3D_CBUFFER_TYPE
+	uint32_t BindIndex;
+	uint32_t Size;
+	std::vector<ShaderMetadataVariable> Variables;
+
+	// FNV-1a of every variable's name, offset and size, then
+	// the buffer's size.  Tools/GenerateShaderStructs.py
+	// works out the same hash for each struct it generates,
+	// so a struct can be checked against the buffer it's for.
+	uint32_t LayoutHash() const;
+};
+
+struct ShaderMetadataResource
+{
+	std::string Name;
+	uint32_t BindIndex;
+};
+
+struct ShaderMetadataInput
+{
+	std::string SemanticName;
+	uint32_t SemanticIndex;
+	uint32_t Mask;
+	uint32_t ComponentType;	// D3D_REGISTER_COMPONENT_TYPE
+};
+
+// --------------------------------------------------------
+// Reflection results, plus the compact binary form they're
+// cached in next to each .cso.  The cache records a hash
+// of the .cso it came from, and is ignored if the shader
+// has changed since or the format version doesn't match.
+// --------------------------------------------------------
+struct ShaderMetadata
+{
+	// Bump whenever the binary layout changes
+	static const uint32_t Version = 1;
+
+	uint64_t SourceHash = 0;
+	std::vector<ShaderMetadataBuffer> Buffers;
+	std::vector<ShaderMetadataResource> Textures;	// In shader resource view index order
+	std::vector<ShaderMetadataResource> Samplers;	// In sampler index order
+	std::vector<ShaderMetadataInput> Inputs;
+
+	void Serialize(std::vector<unsigned char>& out) const;
+
+	// Reads a serialized cache, checking every count and
+	// offset against the data size.  Returns false for
+	// anything malformed, outdated or for another shader.
+	bool Parse(const void* data, size_t size, uint64_t expectedSourceHash);
+};
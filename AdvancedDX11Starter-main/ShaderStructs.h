@@ -0,0 +1,276 @@
+// Generated by Tools/GenerateShaderStructs.py from the cbuffers in
+// this project's shaders - don't edit by hand.  Fill one in and pass
+// it to ISimpleShader::SetBufferData() to set a whole buffer at once.
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include "Lights.h"
+
+// Light (from Lights.h) must match the HLSL struct
+static_assert(offsetof(Light, Type) == 0, "Light::Type doesn't match HLSL");
+static_assert(offsetof(Light, Direction) == 4, "Light::Direction doesn't match HLSL");
+static_assert(offsetof(Light, Range) == 16, "Light::Range doesn't match HLSL");
+static_assert(offsetof(Light, Position) == 20, "Light::Position doesn't match HLSL");
+static_assert(offsetof(Light, Intensity) == 32, "Light::Intensity doesn't match HLSL");
+static_assert(offsetof(Light, Color) == 36, "Light::Color doesn't match HLSL");
+static_assert(offsetof(Light, SpotFalloff) == 48, "Light::SpotFalloff doesn't match HLSL");
+static_assert(offsetof(Light, Padding) == 52, "Light::Padding doesn't match HLSL");
+static_assert(sizeof(Light) == 64, "Light doesn't match HLSL");
+
+// IBLIrradianceMapPS.hlsl, cbuffer externalData : register(b0)
+struct IBLIrradianceMapPSExternalData
+{
+	static constexpr const char* BufferName = "externalData";
+	static constexpr unsigned int LayoutHash = 0x7FF2AA1C;
+
+	int faceIndex;
+	float _pad0[3];
+};
+static_assert(offsetof(IBLIrradianceMapPSExternalData, faceIndex) == 0, "IBLIrradianceMapPSExternalData::faceIndex is misplaced");
+static_assert(sizeof(IBLIrradianceMapPSExternalData) == 16, "IBLIrradianceMapPSExternalData has the wrong size");
+
+// IBLSpecularConvolutionPS.hlsl, cbuffer data : register(b0)
+struct IBLSpecularConvolutionPSData
+{
+	static constexpr const char* BufferName = "data";
+	static constexpr unsigned int LayoutHash = 0x986F7DF2;
+
+	float roughness;
+	int faceIndex;
+	int mipLevel;
+	float _pad0[1];
+};
+static_assert(offsetof(IBLSpecularConvolutionPSData, roughness) == 0, "IBLSpecularConvolutionPSData::roughness is misplaced");
+static_assert(offsetof(IBLSpecularConvolutionPSData, faceIndex) == 4, "IBLSpecularConvolutionPSData::faceIndex is misplaced");
+static_assert(offsetof(IBLSpecularConvolutionPSData, mipLevel) == 8, "IBLSpecularConvolutionPSData::mipLevel is misplaced");
+static_assert(sizeof(IBLSpecularConvolutionPSData) == 16, "IBLSpecularConvolutionPSData has the wrong size");
+
+// LightRayPS.hlsl, cbuffer externalData : register(b0)
+struct LightRayPSExternalData
+{
+	static constexpr const char* BufferName = "externalData";
+	static constexpr unsigned int LayoutHash = 0xA93AABEB;
+
+	int numSamples;
+	DirectX::XMFLOAT2 lightPosScreenSpace;
+	float density;
+	float weight;
+	float decay;
+	float exposure;
+	float _pad0[1];
+};
+static_assert(offsetof(LightRayPSExternalData, numSamples) == 0, "LightRayPSExternalData::numSamples is misplaced");
+static_assert(offsetof(LightRayPSExternalData, lightPosScreenSpace) == 4, "LightRayPSExternalData::lightPosScreenSpace is misplaced");
+static_assert(offsetof(LightRayPSExternalData, density) == 12, "LightRayPSExternalData::density is misplaced");
+static_assert(offsetof(LightRayPSExternalData, weight) == 16, "LightRayPSExternalData::weight is misplaced");
+static_assert(offsetof(LightRayPSExternalData, decay) == 20, "LightRayPSExternalData::decay is misplaced");
+static_assert(offsetof(LightRayPSExternalData, exposure) == 24, "LightRayPSExternalData::exposure is misplaced");
+static_assert(sizeof(LightRayPSExternalData) == 32, "LightRayPSExternalData has the wrong size");
+
+// ParticleVS.hlsl, cbuffer externalData : register(b0)
+struct ParticleVSExternalData
+{
+	static constexpr const char* BufferName = "externalData";
+	static constexpr unsigned int LayoutHash = 0xC076986E;
+
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT3 acceleration;
+	float _pad0[1];
+	DirectX::XMFLOAT4 startColor;
+	DirectX::XMFLOAT4 endColor;
+	float startSize;
+	float endSize;
+	float lifetime;
+	float currentTime;
+};
+static_assert(offsetof(ParticleVSExternalData, view) == 0, "ParticleVSExternalData::view is misplaced");
+static_assert(offsetof(ParticleVSExternalData, projection) == 64, "ParticleVSExternalData::projection is misplaced");
+static_assert(offsetof(ParticleVSExternalData, acceleration) == 128, "ParticleVSExternalData::acceleration is misplaced");
+static_assert(offsetof(ParticleVSExternalData, startColor) == 144, "ParticleVSExternalData::startColor is misplaced");
+static_assert(offsetof(ParticleVSExternalData, endColor) == 160, "ParticleVSExternalData::endColor is misplaced");
+static_assert(offsetof(ParticleVSExternalData, startSize) == 176, "ParticleVSExternalData::startSize is misplaced");
+static_assert(offsetof(ParticleVSExternalData, endSize) == 180, "ParticleVSExternalData::endSize is misplaced");
+static_assert(offsetof(ParticleVSExternalData, lifetime) == 184, "ParticleVSExternalData::lifetime is misplaced");
+static_assert(offsetof(ParticleVSExternalData, currentTime) == 188, "ParticleVSExternalData::currentTime is misplaced");
+static_assert(sizeof(ParticleVSExternalData) == 192, "ParticleVSExternalData has the wrong size");
+
+// PixelShader.hlsl, cbuffer perMaterial : register(b0)
+struct PixelShaderPerMaterial
+{
+	static constexpr const char* BufferName = "perMaterial";
+	static constexpr unsigned int LayoutHash = 0xD6318A02;
+
+	DirectX::XMFLOAT3 colorTint;
+	float _pad0[1];
+	DirectX::XMFLOAT2 uvScale;
+	DirectX::XMFLOAT2 uvOffset;
+};
+static_assert(offsetof(PixelShaderPerMaterial, colorTint) == 0, "PixelShaderPerMaterial::colorTint is misplaced");
+static_assert(offsetof(PixelShaderPerMaterial, uvScale) == 16, "PixelShaderPerMaterial::uvScale is misplaced");
+static_assert(offsetof(PixelShaderPerMaterial, uvOffset) == 24, "PixelShaderPerMaterial::uvOffset is misplaced");
+static_assert(sizeof(PixelShaderPerMaterial) == 32, "PixelShaderPerMaterial has the wrong size");
+
+// PixelShader.hlsl, cbuffer perFrame : register(b1)
+struct PixelShaderPerFrame
+{
+	static constexpr const char* BufferName = "perFrame";
+	static constexpr unsigned int LayoutHash = 0x2E850C9F;
+
+	Light lights[128];
+	int lightCount;
+	DirectX::XMFLOAT3 cameraPosition;
+};
+static_assert(offsetof(PixelShaderPerFrame, lights) == 0, "PixelShaderPerFrame::lights is misplaced");
+static_assert(offsetof(PixelShaderPerFrame, lightCount) == 8192, "PixelShaderPerFrame::lightCount is misplaced");
+static_assert(offsetof(PixelShaderPerFrame, cameraPosition) == 8196, "PixelShaderPerFrame::cameraPosition is misplaced");
+static_assert(sizeof(PixelShaderPerFrame) == 8208, "PixelShaderPerFrame has the wrong size");
+
+// PixelShaderPBR.hlsl, cbuffer perMaterial : register(b0)
+struct PixelShaderPBRPerMaterial
+{
+	static constexpr const char* BufferName = "perMaterial";
+	static constexpr unsigned int LayoutHash = 0xD6318A02;
+
+	DirectX::XMFLOAT3 colorTint;
+	float _pad0[1];
+	DirectX::XMFLOAT2 uvScale;
+	DirectX::XMFLOAT2 uvOffset;
+};
+static_assert(offsetof(PixelShaderPBRPerMaterial, colorTint) == 0, "PixelShaderPBRPerMaterial::colorTint is misplaced");
+static_assert(offsetof(PixelShaderPBRPerMaterial, uvScale) == 16, "PixelShaderPBRPerMaterial::uvScale is misplaced");
+static_assert(offsetof(PixelShaderPBRPerMaterial, uvOffset) == 24, "PixelShaderPBRPerMaterial::uvOffset is misplaced");
+static_assert(sizeof(PixelShaderPBRPerMaterial) == 32, "PixelShaderPBRPerMaterial has the wrong size");
+
+// PixelShaderPBR.hlsl, cbuffer perFrame : register(b1)
+struct PixelShaderPBRPerFrame
+{
+	static constexpr const char* BufferName = "perFrame";
+	static constexpr unsigned int LayoutHash = 0xA0DC0D96;
+
+	Light lights[128];
+	int lightCount;
+	DirectX::XMFLOAT3 cameraPosition;
+	int SpecIBLTotalMipLevels;
+	float _pad0[3];
+};
+static_assert(offsetof(PixelShaderPBRPerFrame, lights) == 0, "PixelShaderPBRPerFrame::lights is misplaced");
+static_assert(offsetof(PixelShaderPBRPerFrame, lightCount) == 8192, "PixelShaderPBRPerFrame::lightCount is misplaced");
+static_assert(offsetof(PixelShaderPBRPerFrame, cameraPosition) == 8196, "PixelShaderPBRPerFrame::cameraPosition is misplaced");
+static_assert(offsetof(PixelShaderPBRPerFrame, SpecIBLTotalMipLevels) == 8208, "PixelShaderPBRPerFrame::SpecIBLTotalMipLevels is misplaced");
+static_assert(sizeof(PixelShaderPBRPerFrame) == 8224, "PixelShaderPBRPerFrame has the wrong size");
+
+// RefractionPS.hlsl, cbuffer perFrame : register(b0)
+struct RefractionPSPerFrame
+{
+	static constexpr const char* BufferName = "perFrame";
+	static constexpr unsigned int LayoutHash = 0x00138C78;
+
+	Light Lights[128];
+	int LightCount;
+	DirectX::XMFLOAT3 CameraPosition;
+	int SpecIBLTotalMipLevels;
+	DirectX::XMFLOAT2 screenSize;
+	float refractionScale;
+};
+static_assert(offsetof(RefractionPSPerFrame, Lights) == 0, "RefractionPSPerFrame::Lights is misplaced");
+static_assert(offsetof(RefractionPSPerFrame, LightCount) == 8192, "RefractionPSPerFrame::LightCount is misplaced");
+static_assert(offsetof(RefractionPSPerFrame, CameraPosition) == 8196, "RefractionPSPerFrame::CameraPosition is misplaced");
+static_assert(offsetof(RefractionPSPerFrame, SpecIBLTotalMipLevels) == 8208, "RefractionPSPerFrame::SpecIBLTotalMipLevels is misplaced");
+static_assert(offsetof(RefractionPSPerFrame, screenSize) == 8212, "RefractionPSPerFrame::screenSize is misplaced");
+static_assert(offsetof(RefractionPSPerFrame, refractionScale) == 8220, "RefractionPSPerFrame::refractionScale is misplaced");
+static_assert(sizeof(RefractionPSPerFrame) == 8224, "RefractionPSPerFrame has the wrong size");
+
+// SkyPS.hlsl, cbuffer externalData : register(b0)
+struct SkyPSExternalData
+{
+	static constexpr const char* BufferName = "externalData";
+	static constexpr unsigned int LayoutHash = 0x6F689F10;
+
+	DirectX::XMFLOAT3 sunDirection;
+	float falloffExponent;
+	DirectX::XMFLOAT3 sunColor;
+	float _pad0[1];
+};
+static_assert(offsetof(SkyPSExternalData, sunDirection) == 0, "SkyPSExternalData::sunDirection is misplaced");
+static_assert(offsetof(SkyPSExternalData, falloffExponent) == 12, "SkyPSExternalData::falloffExponent is misplaced");
+static_assert(offsetof(SkyPSExternalData, sunColor) == 16, "SkyPSExternalData::sunColor is misplaced");
+static_assert(sizeof(SkyPSExternalData) == 32, "SkyPSExternalData has the wrong size");
+
+// SkyVS.hlsl, cbuffer ExternalData : register(b0)
+struct SkyVSExternalData
+{
+	static constexpr const char* BufferName = "ExternalData";
+	static constexpr unsigned int LayoutHash = 0xD524544F;
+
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+};
+static_assert(offsetof(SkyVSExternalData, view) == 0, "SkyVSExternalData::view is misplaced");
+static_assert(offsetof(SkyVSExternalData, projection) == 64, "SkyVSExternalData::projection is misplaced");
+static_assert(sizeof(SkyVSExternalData) == 128, "SkyVSExternalData has the wrong size");
+
+// SolidColorPS.hlsl, cbuffer externalData : register(b0)
+struct SolidColorPSExternalData
+{
+	static constexpr const char* BufferName = "externalData";
+	static constexpr unsigned int LayoutHash = 0x89A6E274;
+
+	DirectX::XMFLOAT3 Color;
+	float _pad0[1];
+};
+static_assert(offsetof(SolidColorPSExternalData, Color) == 0, "SolidColorPSExternalData::Color is misplaced");
+static_assert(sizeof(SolidColorPSExternalData) == 16, "SolidColorPSExternalData has the wrong size");
+
+// SsaoBlurPS.hlsl, cbuffer externalData : register(b0)
+struct SsaoBlurPSExternalData
+{
+	static constexpr const char* BufferName = "externalData";
+	static constexpr unsigned int LayoutHash = 0x9FD0DCF2;
+
+	DirectX::XMFLOAT2 pixelSize;
+	float _pad0[2];
+};
+static_assert(offsetof(SsaoBlurPSExternalData, pixelSize) == 0, "SsaoBlurPSExternalData::pixelSize is misplaced");
+static_assert(sizeof(SsaoBlurPSExternalData) == 16, "SsaoBlurPSExternalData has the wrong size");
+
+// SsaoPS.hlsl, cbuffer externalData : register(b0)
+struct SsaoPSExternalData
+{
+	static constexpr const char* BufferName = "externalData";
+	static constexpr unsigned int LayoutHash = 0xA3ACEFEB;
+
+	DirectX::XMFLOAT4X4 viewMatrix;
+	DirectX::XMFLOAT4X4 projectionMatrix;
+	DirectX::XMFLOAT4X4 invProjMatrix;
+	DirectX::XMFLOAT4 offsets[64];
+	float ssaoRadius;
+	int ssaoSamples;
+	DirectX::XMFLOAT2 randomTextureScreenScale;
+};
+static_assert(offsetof(SsaoPSExternalData, viewMatrix) == 0, "SsaoPSExternalData::viewMatrix is misplaced");
+static_assert(offsetof(SsaoPSExternalData, projectionMatrix) == 64, "SsaoPSExternalData::projectionMatrix is misplaced");
+static_assert(offsetof(SsaoPSExternalData, invProjMatrix) == 128, "SsaoPSExternalData::invProjMatrix is misplaced");
+static_assert(offsetof(SsaoPSExternalData, offsets) == 192, "SsaoPSExternalData::offsets is misplaced");
+static_assert(offsetof(SsaoPSExternalData, ssaoRadius) == 1216, "SsaoPSExternalData::ssaoRadius is misplaced");
+static_assert(offsetof(SsaoPSExternalData, ssaoSamples) == 1220, "SsaoPSExternalData::ssaoSamples is misplaced");
+static_assert(offsetof(SsaoPSExternalData, randomTextureScreenScale) == 1224, "SsaoPSExternalData::randomTextureScreenScale is misplaced");
+static_assert(sizeof(SsaoPSExternalData) == 1232, "SsaoPSExternalData has the wrong size");
+
+// VertexShader.hlsl, cbuffer externalData : register(b0)
+struct VertexShaderExternalData
+{
+	static constexpr const char* BufferName = "externalData";
+	static constexpr unsigned int LayoutHash = 0x66DAB011;
+
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInverseTranspose;
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+};
+static_assert(offsetof(VertexShaderExternalData, world) == 0, "VertexShaderExternalData::world is misplaced");
+static_assert(offsetof(VertexShaderExternalData, worldInverseTranspose) == 64, "VertexShaderExternalData::worldInverseTranspose is misplaced");
+static_assert(offsetof(VertexShaderExternalData, view) == 128, "VertexShaderExternalData::view is misplaced");
+static_assert(offsetof(VertexShaderExternalData, projection) == 192, "VertexShaderExternalData::projection is misplaced");
+static_assert(sizeof(VertexShaderExternalData) == 256, "VertexShaderExternalData has the wrong size");
@@ -1,8 +1,23 @@
 #include "SimpleShader.h"
+#include "ConstantRing.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "Profiler.h"
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
 bool ISimpleShader::ReportWarnings = false;
+bool ISimpleShader::UseMetadataCache = true;
+
+// Upload stats, shared by all shaders
+SimpleShaderUploadStats ISimpleShader::uploadStats;
+SimpleShaderUploadStats ISimpleShader::lastFrameUploadStats;
+
+// Constant ring (if any)
+ConstantRing* ISimpleShader::constantRing = 0;
+
+// The shader SetShader() last set on each stage
+ISimpleShader* ISimpleShader::boundShaders[StageCount] = {};
 
 // To enable error reporting, use either or both 
 // of the following lines somewhere in your program, 
@@ -29,6 +44,15 @@ ISimpleShader::ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Micros
 	this->constantBufferCount = 0;
 	this->constantBuffers = 0;
 	this->shaderValid = false;
+	this->loadingMetadata = 0;
+
+	// Partial constant buffer updates need D3D 11.1 and driver support;
+	// without them, changed buffers are uploaded whole
+	context.As(&deviceContext1);
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	this->partialUpdates = deviceContext1 &&
+		SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.ConstantBufferPartialUpdate;
 }
 
 // --------------------------------------------------------
@@ -45,12 +69,7 @@ ISimpleShader::~ISimpleShader()
 // --------------------------------------------------------
 void ISimpleShader::CleanUp()
 {
-	// Handle constant buffers and local data buffers
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		delete[] constantBuffers[i].LocalDataBuffer;
-	}
-
+	// Handle constant buffers, along with their local data
 	if (constantBuffers)
 	{
 		delete[] constantBuffers;
@@ -80,6 +99,8 @@ void ISimpleShader::CleanUp()
 // --------------------------------------------------------
 bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 {
+	PROFILE_ZONE("SimpleShader::LoadShaderFile");
+
 	// Load the shader to a blob and ensure it worked
 	HRESULT hr = D3DReadFileToBlob(shaderFile, shaderBlob.GetAddressOf());
 	if (hr != S_OK)
@@ -94,9 +115,26 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Get information about this shader and its
+	// variables, buffers, etc.
+	ShaderMetadata shaderMetadata;
+	if (!LoadMetadata(shaderFile, &shaderMetadata))
+	{
+		if (ReportErrors)
+		{
+			LogError("SimpleShader::LoadShaderFile() - Error reflecting shader from file '");
+			LogW(shaderFile);
+			LogError("'.\n");
+		}
+
+		return false;
+	}
+
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
+	loadingMetadata = &shaderMetadata;
 	shaderValid = CreateShader(shaderBlob);
+	loadingMetadata = 0;
 	if (!shaderValid)
 	{
 		if (ReportErrors)
@@ -109,23 +147,134 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Handle bound resources (like shaders and samplers)
+	for (const ShaderMetadataResource& resource : shaderMetadata.Textures)
+	{
+		// Create the SRV wrapper
+		SimpleSRV* srv = new SimpleSRV();
+		srv->BindIndex = resource.BindIndex;					// Shader bind point
+		srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
+
+		textureTable.insert(std::pair<std::string, SimpleSRV*>(resource.Name, srv));
+		shaderResourceViews.push_back(srv);
+	}
+
+	for (const ShaderMetadataResource& resource : shaderMetadata.Samplers)
+	{
+		// Create the sampler wrapper
+		SimpleSampler* samp = new SimpleSampler();
+		samp->BindIndex = resource.BindIndex;				// Shader bind point
+		samp->Index = (unsigned int)samplerStates.size();	// Raw index
+
+		samplerTable.insert(std::pair<std::string, SimpleSampler*>(resource.Name, samp));
+		samplerStates.push_back(samp);
+	}
+
+	// Create resource arrays
+	constantBufferCount = (unsigned int)shaderMetadata.Buffers.size();
+	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+
+	// Loop through all constant buffers
+	for (unsigned int b = 0; b < constantBufferCount; b++)
+	{
+		const ShaderMetadataBuffer& bufferInfo = shaderMetadata.Buffers[b];
+
+		// Save the type, which we reference when setting these buffers
+		constantBuffers[b].Type = (D3D_CBUFFER_TYPE)bufferInfo.Type;
+
+		// Set up the buffer and put its pointer in the table
+		constantBuffers[b].BindIndex = bufferInfo.BindIndex;
+		constantBuffers[b].LayoutHash = bufferInfo.LayoutHash();
+		constantBuffers[b].Name = bufferInfo.Name;
+		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferInfo.Name, &constantBuffers[b]));
+
+		// Create this constant buffer
+		D3D11_BUFFER_DESC newBuffDesc = {};
+		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
+		newBuffDesc.ByteWidth = ((bufferInfo.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
+		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		newBuffDesc.CPUAccessFlags = 0;
+		newBuffDesc.MiscFlags = 0;
+		newBuffDesc.StructureByteStride = 0;
+		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
+
+		// Set up the data buffer for this constant buffer, marking
+		// it all dirty since the GPU copy starts uninitialized
+		constantBuffers[b].Size = bufferInfo.Size;
+		constantBuffers[b].Data.Resize(bufferInfo.Size);
+
+		// Loop through all variables in this buffer
+		for (const ShaderMetadataVariable& var : bufferInfo.Variables)
+		{
+			// Create the variable struct
+			SimpleShaderVariable varStruct = {};
+			varStruct.ConstantBufferIndex = b;
+			varStruct.ByteOffset = var.ByteOffset;
+			varStruct.Size = var.Size;
+
+			// Add this variable to the table and the constant buffer
+			varTable.insert(std::pair<std::string, SimpleShaderVariable>(var.Name, varStruct));
+			constantBuffers[b].Variables.push_back(varStruct);
+		}
+	}
+
+	// All set
+	return true;
+}
+
+// --------------------------------------------------------
+// Gets the loaded shader's reflection info, from its cache
+// file if that's there and matches the shader.  Otherwise
+// the shader is reflected, and the cache (re)written.
+// --------------------------------------------------------
+bool ISimpleShader::LoadMetadata(LPCWSTR shaderFile, ShaderMetadata* metadata)
+{
+	uint64_t hash = HashFNV1a(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
+	std::wstring cachePath = std::wstring(shaderFile) + L".meta";
+
+	if (UseMetadataCache)
+	{
+		MappedFile cache;
+		if (cache.Open(cachePath.c_str()) &&
+			metadata->Parse(cache.GetData(), cache.GetSize(), hash))
+			return true;
+	}
+
+	if (!ReflectMetadata(metadata))
+		return false;
+
+	metadata->SourceHash = hash;
+	if (UseMetadataCache)
+		WriteMetadataCache(cachePath, *metadata);
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Uses shader reflection to get information about the
+// loaded shader's buffers, variables, resources and inputs
+// --------------------------------------------------------
+bool ISimpleShader::ReflectMetadata(ShaderMetadata* metadata)
+{
+	PROFILE_ZONE("SimpleShader::ReflectMetadata");
+
+	*metadata = ShaderMetadata();
+
 	// Set up shader reflection to get information about
 	// this shader and its variables,  buffers, etc.
 	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
+	HRESULT hr = D3DReflect(
 		shaderBlob->GetBufferPointer(),
 		shaderBlob->GetBufferSize(),
 		IID_ID3D11ShaderReflection,
 		(void**)refl.GetAddressOf());
-	
+	if (FAILED(hr))
+		return false;
+
 	// Get the description of the shader
 	D3D11_SHADER_DESC shaderDesc;
 	refl->GetDesc(&shaderDesc);
 
-	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
-	
 	// Handle bound resources (like shaders and samplers)
 	unsigned int resourceCount = shaderDesc.BoundResources;
 	for (unsigned int r = 0; r < resourceCount; r++)
@@ -134,38 +283,26 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
 		refl->GetResourceBindingDesc(r, &resourceDesc);
 
+		ShaderMetadataResource resource;
+		resource.Name = resourceDesc.Name;
+		resource.BindIndex = resourceDesc.BindPoint;
+
 		// Check the type
 		switch (resourceDesc.Type)
 		{
 		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
 		case D3D_SIT_TEXTURE: // A texture resource
-		{
-			// Create the SRV wrapper
-			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
-			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
-
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
-			shaderResourceViews.push_back(srv);
-		}
+			metadata->Textures.push_back(resource);
 			break;
 
 		case D3D_SIT_SAMPLER: // A sampler resource
-		{
-			// Create the sampler wrapper
-			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
-			samp->Index = (unsigned int)samplerStates.size();	// Raw index
-
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
-			samplerStates.push_back(samp);
-		}
+			metadata->Samplers.push_back(resource);
 			break;
 		}
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
 	{
 		// Get this buffer
 		ID3D11ShaderReflectionConstantBuffer* cb =
@@ -175,33 +312,16 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		D3D11_SHADER_BUFFER_DESC bufferDesc;
 		cb->GetDesc(&bufferDesc);
 
-		// Save the type, which we reference when setting these buffers
-		constantBuffers[b].Type = bufferDesc.Type;
-		
 		// Get the description of the resource binding, so
 		// we know exactly how it's bound in the shader
 		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
 		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
-		
-		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
 
-		// Create this constant buffer
-		D3D11_BUFFER_DESC newBuffDesc = {};
-		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = ((bufferDesc.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
-		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		newBuffDesc.CPUAccessFlags = 0;
-		newBuffDesc.MiscFlags = 0;
-		newBuffDesc.StructureByteStride = 0;
-		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
-
-		// Set up the data buffer for this constant buffer
-		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		ShaderMetadataBuffer buffer;
+		buffer.Name = bufferDesc.Name;
+		buffer.Type = bufferDesc.Type;
+		buffer.BindIndex = bindDesc.BindPoint;
+		buffer.Size = bufferDesc.Size;
 
 		// Loop through all variables in this buffer
 		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
@@ -210,29 +330,51 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			ID3D11ShaderReflectionVariable* var =
 				cb->GetVariableByIndex(v);
 			
-			// Get the description of the variable and its type
+			// Get the description of the variable
 			D3D11_SHADER_VARIABLE_DESC varDesc;
 			var->GetDesc(&varDesc);
 
-			// Create the variable struct
-			SimpleShaderVariable varStruct = {};
-			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
-
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
-			constantBuffers[b].Variables.push_back(varStruct);
+			ShaderMetadataVariable variable;
+			variable.Name = varDesc.Name;
+			variable.ByteOffset = varDesc.StartOffset;
+			variable.Size = varDesc.Size;
+			buffer.Variables.push_back(variable);
 		}
+
+		metadata->Buffers.push_back(buffer);
+	}
+
+	// Inputs, for vertex shaders to build an input layout
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+
+		ShaderMetadataInput input;
+		input.SemanticName = paramDesc.SemanticName;
+		input.SemanticIndex = paramDesc.SemanticIndex;
+		input.Mask = paramDesc.Mask;
+		input.ComponentType = paramDesc.ComponentType;
+		metadata->Inputs.push_back(input);
 	}
 
-	// All set
 	return true;
 }
 
+// --------------------------------------------------------
+// Saves reflection info for next time.  It's written to a
+// temporary file first and moved into place, so a shader
+// loading the same file at the same time never sees half
+// of it.  Failing just means reflecting again next time.
+// --------------------------------------------------------
+void ISimpleShader::WriteMetadataCache(const std::wstring& cachePath, const ShaderMetadata& metadata)
+{
+	std::vector<unsigned char> bytes;
+	metadata.Serialize(bytes);
+
+	WriteFileReplacing(cachePath.c_str(), bytes.data(), bytes.size());
+}
+
 // --------------------------------------------------------
 // Helper for looking up a variable by name and also
 // verifying that it is the requested size
@@ -345,14 +487,9 @@ void ISimpleShader::CopyAllBufferData()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy whatever changed
 	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
-	}
+		UploadBuffer(&constantBuffers[i]);
 }
 
 // --------------------------------------------------------
@@ -375,14 +512,8 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if(index >= this->constantBufferCount)
 		return;
 
-	// Check for the buffer
-	SimpleConstantBuffer* cb = &this->constantBuffers[index];
-	if (!cb) return;
-
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(&this->constantBuffers[index]);
 }
 
 // --------------------------------------------------------
@@ -402,9 +533,164 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
+}
+
+
+// --------------------------------------------------------
+// Copies a buffer's dirty range to the GPU, or nothing at
+// all if it hasn't changed since the last upload.  Partial
+// updates are rounded out to 16 byte boundaries, as D3D
+// requires for constant buffers.
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	// With a ring, changed data goes to a new slice, which
+	// is bound right away if this shader is the one in use
+	if (UsingConstantRing())
+	{
+		bool stale = cb->RingGeneration != constantRing->GetGeneration();
+		if (!stale && !cb->Data.IsDirty())
+		{
+			uploadStats.SkippedUploads++;
+			return;
+		}
+
+		if (WriteToRing(cb))
+		{
+			if (IsBound())
+				BindConstantBuffer(cb->BindIndex, constantRing->GetBuffer(), cb->RingFirstConstant, cb->RingNumConstants);
+			return;
+		}
+
+		// The ring is full or sitting the frame out, so fall
+		// back to this shader's own buffer, which needs all of
+		// the data if the latest went to the ring
+		if (cb->RingGeneration != 0)
+		{
+			cb->RingGeneration = 0;
+			cb->Data.MarkAllDirty();
+		}
+		if (IsBound())
+			BindConstantBuffer(cb->BindIndex, cb->ConstantBuffer.Get(), 0, 0);
+	}
+	else if (cb->RingGeneration != 0)
+	{
+		// The latest data went to a ring that's since been
+		// removed, so this buffer needs all of it
+		cb->RingGeneration = 0;
+		cb->Data.MarkAllDirty();
+	}
+
+	unsigned int start = 0;
+	unsigned int end = 0;
+	if (!cb->Data.GetUploadRange(&start, &end))
+	{
+		uploadStats.SkippedUploads++;
+		return;
+	}
+
+	if (partialUpdates && (start > 0 || end < cb->Size))
+	{
+		D3D11_BOX box = {};
+		box.left = start;
+		box.right = end;
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+		deviceContext1->UpdateSubresource1(
+			cb->ConstantBuffer.Get(), 0, &box,
+			cb->Data.GetData() + start, 0, 0, 0);
+
+		uploadStats.PartialUploads++;
+		uploadStats.BytesUploaded += end - start;
+	}
+	else
+	{
+		deviceContext->UpdateSubresource(
+			cb->ConstantBuffer.Get(), 0, 0,
+			cb->Data.GetData(), 0, 0);
+
+		uploadStats.BytesUploaded += cb->Size;
+	}
+
+	uploadStats.Uploads++;
+	cb->Data.MarkClean();
+}
+
+// --------------------------------------------------------
+// Copies a buffer's whole local data into a new ring slice
+// --------------------------------------------------------
+bool ISimpleShader::WriteToRing(SimpleConstantBuffer* cb)
+{
+	ConstantRingSlice slice;
+	if (!constantRing->Write(cb->Data.GetData(), cb->Size, &slice))
+		return false;
+
+	cb->RingFirstConstant = slice.FirstConstant;
+	cb->RingNumConstants = slice.NumConstants;
+	cb->RingGeneration = slice.Generation;
+	cb->Data.MarkClean();
+
+	uploadStats.Uploads++;
+	uploadStats.BytesUploaded += cb->Size;
+	return true;
+}
+
+// --------------------------------------------------------
+// Binds each of the shader's constant buffers.  With a
+// ring, a buffer whose slice is from an earlier frame is
+// written again first, or goes back to its own buffer if
+// the ring is full.
+// --------------------------------------------------------
+void ISimpleShader::SetConstantBuffers()
+{
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		// Skip "buffers" that aren't true constant buffers
+		SimpleConstantBuffer* cb = &constantBuffers[i];
+		if (cb->Type != D3D11_CT_CBUFFER)
+			continue;
+
+		if (UsingConstantRing() &&
+			(cb->RingGeneration == constantRing->GetGeneration() || WriteToRing(cb)))
+		{
+			BindConstantBuffer(cb->BindIndex, constantRing->GetBuffer(), cb->RingFirstConstant, cb->RingNumConstants);
+		}
+		else
+		{
+			if (cb->RingGeneration != 0)
+				UploadBuffer(cb);
+			BindConstantBuffer(cb->BindIndex, cb->ConstantBuffer.Get(), 0, 0);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Copies data into a local buffer, but only marks it dirty
+// if the bytes actually changed, so setting the same values
+// every draw doesn't cause uploads.  Returns false if the
+// data doesn't fit in the buffer.
+// --------------------------------------------------------
+bool ISimpleShader::WriteBufferData(unsigned int bufferIndex, unsigned int byteOffset, const void* data, unsigned int size)
+{
+	return constantBuffers[bufferIndex].Data.Write(byteOffset, data, size);
+}
+
+// --------------------------------------------------------
+// Moves this frame's upload counts into the last frame
+// stats and starts counting again
+// --------------------------------------------------------
+void ISimpleShader::EndFrameUploadStats()
+{
+	lastFrameUploadStats = uploadStats;
+	uploadStats = SimpleShaderUploadStats();
+
+	// Others set shaders between frames too (ImGui's backend
+	// draws last), so stop assuming any of ours are bound
+	for (unsigned int i = 0; i < StageCount; i++)
+		boundShaders[i] = 0;
 }
 
 
@@ -446,10 +732,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 	}
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	WriteBufferData(var->ConstantBufferIndex, var->ByteOffset, data, size);
 
 	// Success
 	return true;
@@ -535,6 +818,174 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Resolves a variable name to a handle for the fast setters.
+// Do this once (after loading) and keep the handle around.
+//
+// Returns an invalid handle if the variable doesn't exist
+// --------------------------------------------------------
+SimpleVariableHandle ISimpleShader::GetVariableHandle(std::string name)
+{
+	SimpleVariableHandle handle;
+	SimpleShaderVariable* var = FindVariable(name, -1);
+	if (var == 0)
+		return handle;
+
+	handle.ByteOffset = var->ByteOffset;
+	handle.Size = var->Size;
+	handle.ConstantBufferIndex = var->ConstantBufferIndex;
+	handle.Shader = this;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Resolves an SRV name to a handle (invalid if not found)
+// --------------------------------------------------------
+SimpleResourceHandle ISimpleShader::GetShaderResourceViewHandle(std::string name)
+{
+	SimpleResourceHandle handle;
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	if (srvInfo)
+		handle.BindIndex = srvInfo->BindIndex;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Resolves a sampler name to a handle (invalid if not found)
+// --------------------------------------------------------
+SimpleResourceHandle ISimpleShader::GetSamplerHandle(std::string name)
+{
+	SimpleResourceHandle handle;
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	if (sampInfo)
+		handle.BindIndex = sampInfo->BindIndex;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Resolves a constant buffer name to its index, for use
+// with CopyBufferData(unsigned int).  Returns
+// SimpleVariableHandle::InvalidIndex if not found.
+// --------------------------------------------------------
+unsigned int ISimpleShader::GetBufferIndex(std::string name)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(name);
+	if (cb == 0)
+		return SimpleVariableHandle::InvalidIndex;
+
+	return (unsigned int)(cb - constantBuffers);
+}
+
+// --------------------------------------------------------
+// Sets a variable through a handle from GetVariableHandle()
+//
+// handle - The variable's handle
+// data   - The data to set in the buffer
+// size   - The size of the data (this must be less than or equal to the variable's size)
+//
+// Returns true if data is copied, false if the handle is invalid
+// or from another shader, or the data is too large
+// --------------------------------------------------------
+bool ISimpleShader::SetData(SimpleVariableHandle handle, const void* data, unsigned int size)
+{
+	if (handle.Shader != this || handle.ConstantBufferIndex >= constantBufferCount || size > handle.Size)
+		return false;
+
+	// Never writes past the end of the buffer, whatever the
+	// handle says
+	return WriteBufferData(handle.ConstantBufferIndex, handle.ByteOffset, data, size);
+}
+
+// --------------------------------------------------------
+// Sets an entire constant buffer's data in one copy
+//
+// bufferName - The name of the buffer in the shader
+// data       - The data for the whole buffer
+// size       - The size of the data, which must match the buffer's
+//
+// Returns true if data is copied, false if there's no such
+// buffer or the size doesn't match (which likely means the
+// C++ struct and the shader's cbuffer have drifted apart)
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferData(std::string bufferName, const void* data, unsigned int size)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (!cb)
+		return false;
+
+	return SetBufferData((unsigned int)(cb - constantBuffers), data, size);
+}
+
+bool ISimpleShader::SetBufferData(unsigned int bufferIndex, const void* data, unsigned int size)
+{
+	if (bufferIndex >= constantBufferCount)
+		return false;
+
+	if (size != constantBuffers[bufferIndex].Size)
+	{
+		if (ReportErrors)
+		{
+			LogError("SimpleShader::SetBufferData() - Size of data for buffer '");
+			Log(constantBuffers[bufferIndex].Name);
+			LogError("' doesn't match the buffer's size.\n");
+		}
+
+		return false;
+	}
+
+	WriteBufferData(bufferIndex, 0, data, size);
+	return true;
+}
+
+bool ISimpleShader::SetBufferData(std::string bufferName, unsigned int layoutHash, const void* data, unsigned int size)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (!cb)
+		return false;
+
+	if (cb->LayoutHash != layoutHash)
+	{
+		if (ReportErrors)
+		{
+			LogError("SimpleShader::SetBufferData() - Layout of data for buffer '");
+			Log(cb->Name);
+			LogError("' doesn't match the buffer's layout.\n");
+		}
+
+		return false;
+	}
+
+	return SetBufferData((unsigned int)(cb - constantBuffers), data, size);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view through a handle
+//
+// Returns true if the handle is valid, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetShaderResourceView(SimpleResourceHandle handle, ID3D11ShaderResourceView* srv)
+{
+	if (!handle.IsValid())
+		return false;
+
+	BindShaderResourceViews(handle.BindIndex, 1, &srv);
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state through a handle
+//
+// Returns true if the handle is valid, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetSamplerState(SimpleResourceHandle handle, ID3D11SamplerState* samplerState)
+{
+	if (!handle.IsValid())
+		return false;
+
+	BindSamplerStates(handle.BindIndex, 1, &samplerState);
+	return true;
+}
+
 // --------------------------------------------------------
 // Determines if the shader contains the specified
 // variable within one of its constant buffers
@@ -735,6 +1186,8 @@ SimpleVertexShader::~SimpleVertexShader()
 void SimpleVertexShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+	if (boundShaders[VertexStage] == this)
+		boundShaders[VertexStage] = 0;
 }
 
 // --------------------------------------------------------
@@ -767,32 +1220,19 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 		return true;
 
 	// Vertex shader was created successfully, so we now use the
-	// shader code to re-reflect and create an input layout that 
-	// matches what the vertex shader expects.  Code adapted from:
+	// reflected inputs to create an input layout that matches
+	// what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
-
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
+	if (!loadingMetadata)
+		return true;
 
 	// Read input layout description from shader info
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	for (const ShaderMetadataInput& paramDesc : loadingMetadata->Inputs)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
-
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
-		std::string sem = paramDesc.SemanticName;
+		const std::string& sem = paramDesc.SemanticName;
 		int lenDiff = (int)sem.size() - (int)perInstanceStr.size();
 		bool isPerInstance = 
 			lenDiff >= 0 &&
@@ -800,7 +1240,7 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc = {};
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = paramDesc.SemanticName.c_str();
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -871,20 +1311,18 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Set the shader and input layout
 	deviceContext->IASetInputLayout(inputLayout.Get());
 	deviceContext->VSSetShader(shader.Get(), 0, 0);
+	boundShaders[VertexStage] = this;
 
 	// Set the constant buffers
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+	SetConstantBuffers();
+}
 
-		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
-	}
+// --------------------------------------------------------
+// Whether this shader is the one currently set
+// --------------------------------------------------------
+bool SimpleVertexShader::IsBound()
+{
+	return boundShaders[VertexStage] == this;
 }
 
 // --------------------------------------------------------
@@ -947,6 +1385,27 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of SRVs or samplers to consecutive registers
+// --------------------------------------------------------
+void SimpleVertexShader::BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->VSSetShaderResources(startSlot, count, srvs);
+}
+
+void SimpleVertexShader::BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	deviceContext->VSSetSamplers(startSlot, count, samplerStates);
+}
+
+void SimpleVertexShader::BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (numConstants > 0)
+		deviceContext1->VSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &numConstants);
+	else
+		deviceContext->VSSetConstantBuffers(bindIndex, 1, &buffer);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ SIMPLE PIXEL SHADER -------------------------------------------------
@@ -976,6 +1435,8 @@ SimplePixelShader::~SimplePixelShader()
 void SimplePixelShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+	if (boundShaders[PixelStage] == this)
+		boundShaders[PixelStage] = 0;
 }
 
 // --------------------------------------------------------
@@ -1013,20 +1474,18 @@ void SimplePixelShader::SetShaderAndCBs()
 	
 	// Set the shader
 	deviceContext->PSSetShader(shader.Get(), 0, 0);
+	boundShaders[PixelStage] = this;
 
 	// Set the constant buffers
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+	SetConstantBuffers();
+}
 
-		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
-	}
+// --------------------------------------------------------
+// Whether this shader is the one currently set
+// --------------------------------------------------------
+bool SimplePixelShader::IsBound()
+{
+	return boundShaders[PixelStage] == this;
 }
 
 // --------------------------------------------------------
@@ -1089,6 +1548,27 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of SRVs or samplers to consecutive registers
+// --------------------------------------------------------
+void SimplePixelShader::BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->PSSetShaderResources(startSlot, count, srvs);
+}
+
+void SimplePixelShader::BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	deviceContext->PSSetSamplers(startSlot, count, samplerStates);
+}
+
+void SimplePixelShader::BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (numConstants > 0)
+		deviceContext1->PSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &numConstants);
+	else
+		deviceContext->PSSetConstantBuffers(bindIndex, 1, &buffer);
+}
+
 
 
 
@@ -1120,6 +1600,8 @@ SimpleDomainShader::~SimpleDomainShader()
 void SimpleDomainShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+	if (boundShaders[DomainStage] == this)
+		boundShaders[DomainStage] = 0;
 }
 
 // --------------------------------------------------------
@@ -1157,20 +1639,18 @@ void SimpleDomainShader::SetShaderAndCBs()
 
 	// Set the shader
 	deviceContext->DSSetShader(shader.Get(), 0, 0);
+	boundShaders[DomainStage] = this;
 
 	// Set the constant buffers
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+	SetConstantBuffers();
+}
 
-		// This is a real constant buffer, so set it
-		deviceContext->DSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
-	}
+// --------------------------------------------------------
+// Whether this shader is the one currently set
+// --------------------------------------------------------
+bool SimpleDomainShader::IsBound()
+{
+	return boundShaders[DomainStage] == this;
 }
 
 // --------------------------------------------------------
@@ -1233,6 +1713,27 @@ bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of SRVs or samplers to consecutive registers
+// --------------------------------------------------------
+void SimpleDomainShader::BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->DSSetShaderResources(startSlot, count, srvs);
+}
+
+void SimpleDomainShader::BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	deviceContext->DSSetSamplers(startSlot, count, samplerStates);
+}
+
+void SimpleDomainShader::BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (numConstants > 0)
+		deviceContext1->DSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &numConstants);
+	else
+		deviceContext->DSSetConstantBuffers(bindIndex, 1, &buffer);
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1263,6 +1764,8 @@ SimpleHullShader::~SimpleHullShader()
 void SimpleHullShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+	if (boundShaders[HullStage] == this)
+		boundShaders[HullStage] = 0;
 }
 
 // --------------------------------------------------------
@@ -1300,20 +1803,18 @@ void SimpleHullShader::SetShaderAndCBs()
 
 	// Set the shader
 	deviceContext->HSSetShader(shader.Get(), 0, 0);
+	boundShaders[HullStage] = this;
 
-	// Set the constant buffers?
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+	// Set the constant buffers
+	SetConstantBuffers();
+}
 
-		// This is a real constant buffer, so set it
-		deviceContext->HSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
-	}
+// --------------------------------------------------------
+// Whether this shader is the one currently set
+// --------------------------------------------------------
+bool SimpleHullShader::IsBound()
+{
+	return boundShaders[HullStage] == this;
 }
 
 // --------------------------------------------------------
@@ -1376,6 +1877,27 @@ bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of SRVs or samplers to consecutive registers
+// --------------------------------------------------------
+void SimpleHullShader::BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->HSSetShaderResources(startSlot, count, srvs);
+}
+
+void SimpleHullShader::BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	deviceContext->HSSetSamplers(startSlot, count, samplerStates);
+}
+
+void SimpleHullShader::BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (numConstants > 0)
+		deviceContext1->HSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &numConstants);
+	else
+		deviceContext->HSSetConstantBuffers(bindIndex, 1, &buffer);
+}
+
 
 
 
@@ -1411,6 +1933,8 @@ SimpleGeometryShader::~SimpleGeometryShader()
 void SimpleGeometryShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+	if (boundShaders[GeometryStage] == this)
+		boundShaders[GeometryStage] = 0;
 }
 
 // --------------------------------------------------------
@@ -1574,20 +2098,18 @@ void SimpleGeometryShader::SetShaderAndCBs()
 
 	// Set the shader
 	deviceContext->GSSetShader(shader.Get(), 0, 0);
+	boundShaders[GeometryStage] = this;
 
-	// Set the constant buffers?
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+	// Set the constant buffers
+	SetConstantBuffers();
+}
 
-		// This is a real constant buffer, so set it
-		deviceContext->GSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
-	}
+// --------------------------------------------------------
+// Whether this shader is the one currently set
+// --------------------------------------------------------
+bool SimpleGeometryShader::IsBound()
+{
+	return boundShaders[GeometryStage] == this;
 }
 
 // --------------------------------------------------------
@@ -1650,6 +2172,27 @@ bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::Com
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of SRVs or samplers to consecutive registers
+// --------------------------------------------------------
+void SimpleGeometryShader::BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->GSSetShaderResources(startSlot, count, srvs);
+}
+
+void SimpleGeometryShader::BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	deviceContext->GSSetSamplers(startSlot, count, samplerStates);
+}
+
+void SimpleGeometryShader::BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (numConstants > 0)
+		deviceContext1->GSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &numConstants);
+	else
+		deviceContext->GSSetConstantBuffers(bindIndex, 1, &buffer);
+}
+
 // --------------------------------------------------------
 // Calculates the number of components specified by a parameter description mask
 //
@@ -1702,6 +2245,8 @@ SimpleComputeShader::~SimpleComputeShader()
 void SimpleComputeShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
+	if (boundShaders[ComputeStage] == this)
+		boundShaders[ComputeStage] = 0;
 
 	uavTable.clear();
 }
@@ -1784,20 +2329,18 @@ void SimpleComputeShader::SetShaderAndCBs()
 
 	// Set the shader
 	deviceContext->CSSetShader(shader.Get(), 0, 0);
+	boundShaders[ComputeStage] = this;
 
-	// Set the constant buffers?
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
+	// Set the constant buffers
+	SetConstantBuffers();
+}
 
-		// This is a real constant buffer, so set it
-		deviceContext->CSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
-	}
+// --------------------------------------------------------
+// Whether this shader is the one currently set
+// --------------------------------------------------------
+bool SimpleComputeShader::IsBound()
+{
+	return boundShaders[ComputeStage] == this;
 }
 
 // --------------------------------------------------------
@@ -1921,6 +2464,27 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of SRVs or samplers to consecutive registers
+// --------------------------------------------------------
+void SimpleComputeShader::BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->CSSetShaderResources(startSlot, count, srvs);
+}
+
+void SimpleComputeShader::BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	deviceContext->CSSetSamplers(startSlot, count, samplerStates);
+}
+
+void SimpleComputeShader::BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (numConstants > 0)
+		deviceContext1->CSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &numConstants);
+	else
+		deviceContext->CSSetConstantBuffers(bindIndex, 1, &buffer);
+}
+
 // --------------------------------------------------------
 // Sets an unordered access view in the Compute shader stage
 //
@@ -3,6 +3,7 @@
 #pragma comment(lib, "d3dcompiler.lib")
 
 #include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include <wrl/client.h>
@@ -11,6 +12,12 @@
 #include <vector>
 #include <string>
 
+#include "ConstantBufferData.h"
+#include "ShaderMetadata.h"
+
+class ConstantRing;
+class ISimpleShader;
+
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -34,9 +41,29 @@ struct SimpleConstantBuffer
 	D3D_CBUFFER_TYPE Type = D3D_CBUFFER_TYPE::D3D11_CT_CBUFFER;
 	unsigned int Size = 0;
 	unsigned int BindIndex = 0;
+	unsigned int LayoutHash = 0;	// See ShaderMetadataBuffer::LayoutHash()
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
-	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+
+	// The local copy of the data, and what changed since the
+	// last upload
+	ConstantBufferData Data;
+
+	// Where the data was last written when using a ConstantRing
+	unsigned int RingFirstConstant = 0;
+	unsigned int RingNumConstants = 0;
+	unsigned long long RingGeneration = 0;
+};
+
+// --------------------------------------------------------
+// Constant buffer upload counts, across all shaders
+// --------------------------------------------------------
+struct SimpleShaderUploadStats
+{
+	unsigned int Uploads = 0;			// Buffers actually copied to the GPU
+	unsigned int PartialUploads = 0;	// ...of which only a dirty range was sent
+	unsigned int SkippedUploads = 0;	// Copies skipped as nothing had changed
+	unsigned long long BytesUploaded = 0;
 };
 
 // --------------------------------------------------------
@@ -57,6 +84,38 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// --------------------------------------------------------
+// A constant buffer variable resolved ahead of time with
+// GetVariableHandle(), so setting it is just a memcpy with
+// no name lookup.  A handle for a name the shader doesn't
+// have is invalid, and setting it does nothing.  Handles
+// only work with the shader that resolved them.
+// --------------------------------------------------------
+struct SimpleVariableHandle
+{
+	static const unsigned int InvalidIndex = 0xFFFFFFFF;
+
+	unsigned int ByteOffset = 0;
+	unsigned int Size = 0;
+	unsigned int ConstantBufferIndex = InvalidIndex;
+	const ISimpleShader* Shader = 0;	// The shader it belongs to
+
+	bool IsValid() const { return ConstantBufferIndex != InvalidIndex; }
+};
+
+// --------------------------------------------------------
+// A texture or sampler resolved ahead of time - just the
+// register it's bound to
+// --------------------------------------------------------
+struct SimpleResourceHandle
+{
+	static const unsigned int InvalidIndex = 0xFFFFFFFF;
+
+	unsigned int BindIndex = InvalidIndex;
+
+	bool IsValid() const { return BindIndex != InvalidIndex; }
+};
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -93,6 +152,40 @@ public:
 	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
 	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
 
+	// Resolving names to handles, once, for the fast setters below
+	SimpleVariableHandle GetVariableHandle(std::string name);
+	SimpleResourceHandle GetShaderResourceViewHandle(std::string name);
+	SimpleResourceHandle GetSamplerHandle(std::string name);
+	unsigned int GetBufferIndex(std::string name);
+
+	// Sets data through handles - no lookups or string copies
+	bool SetData(SimpleVariableHandle handle, const void* data, unsigned int size);
+	bool SetInt(SimpleVariableHandle handle, int data) { return SetData(handle, &data, sizeof(int)); }
+	bool SetFloat(SimpleVariableHandle handle, float data) { return SetData(handle, &data, sizeof(float)); }
+	bool SetFloat2(SimpleVariableHandle handle, const DirectX::XMFLOAT2& data) { return SetData(handle, &data, sizeof(float) * 2); }
+	bool SetFloat3(SimpleVariableHandle handle, const DirectX::XMFLOAT3& data) { return SetData(handle, &data, sizeof(float) * 3); }
+	bool SetFloat4(SimpleVariableHandle handle, const DirectX::XMFLOAT4& data) { return SetData(handle, &data, sizeof(float) * 4); }
+	bool SetMatrix4x4(SimpleVariableHandle handle, const DirectX::XMFLOAT4X4& data) { return SetData(handle, &data, sizeof(float) * 16); }
+
+	bool SetShaderResourceView(SimpleResourceHandle handle, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(SimpleResourceHandle handle, ID3D11SamplerState* samplerState);
+
+	// Binds SRVs or samplers to consecutive registers in one call,
+	// for callers that have already resolved their slots
+	void SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs) { BindShaderResourceViews(startSlot, count, srvs); }
+	void SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates) { BindSamplerStates(startSlot, count, samplerStates); }
+
+	// Sets a whole constant buffer at once, usually from one of the
+	// structs in ShaderStructs.h.  The size must match exactly, and
+	// for those structs the layout too, as many shaders have an
+	// "externalData" buffer that's laid out differently.
+	bool SetBufferData(std::string bufferName, const void* data, unsigned int size);
+	bool SetBufferData(unsigned int bufferIndex, const void* data, unsigned int size);
+	bool SetBufferData(std::string bufferName, unsigned int layoutHash, const void* data, unsigned int size);
+
+	template<typename T>
+	bool SetBufferData(const T& data) { return SetBufferData(T::BufferName, T::LayoutHash, &data, (unsigned int)sizeof(T)); }
+
 	// Simple resource checking
 	bool HasVariable(std::string name);
 	bool HasShaderResourceView(std::string name);
@@ -122,12 +215,29 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Reflection results are cached next to each .cso (as
+	// .cso.meta) and reused until the shader changes
+	static bool UseMetadataCache;
+
+	// Upload stats.  Call EndFrameUploadStats() once per frame
+	// to move the running counts into the "last frame" stats.
+	static const SimpleShaderUploadStats& GetLastFrameUploadStats() { return lastFrameUploadStats; }
+	static void EndFrameUploadStats();
+
+	// Once given a ring, every shader writes its constant
+	// data into slices of it rather than its own buffers.
+	// Pass null to go back to per-shader buffers.
+	static void SetConstantRing(ConstantRing* ring) { constantRing = ring; }
+	static ConstantRing* GetConstantRing() { return constantRing; }
+
 protected:
 	
 	bool shaderValid;
 	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> deviceContext1;	// Null before D3D 11.1
+	bool partialUpdates;
 
 	// Resource counts
 	unsigned int constantBufferCount;
@@ -144,12 +254,49 @@ protected:
 	// Initialization method
 	bool LoadShaderFile(LPCWSTR shaderFile);
 
+	// Reflection info for the shader being loaded - only
+	// valid during LoadShaderFile(), for CreateShader()
+	const ShaderMetadata* loadingMetadata;
+
+	// Getting reflection info, from the cache if possible
+	bool LoadMetadata(LPCWSTR shaderFile, ShaderMetadata* metadata);
+	bool ReflectMetadata(ShaderMetadata* metadata);
+	void WriteMetadataCache(const std::wstring& cachePath, const ShaderMetadata& metadata);
+
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
 
+	// Whether this is the shader SetShader() last set on its
+	// stage.  Tracked here rather than asking the context,
+	// which is too slow to do on every upload.  Raw *SetShader
+	// calls (ImGui's backend) aren't seen, so every frame
+	// starts over with none bound (see EndFrameUploadStats()).
+	virtual bool IsBound() = 0;
+	enum ShaderStage { VertexStage, PixelStage, DomainStage, HullStage, GeometryStage, ComputeStage, StageCount };
+	static ISimpleShader* boundShaders[StageCount];
+
+	virtual void BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs) = 0;
+	virtual void BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates) = 0;
+
+	// numConstants of 0 binds the whole buffer
+	virtual void BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants) = 0;
+
 	virtual void CleanUp();
 
+	// Writes into a local buffer, tracking what changed, and
+	// uploads just the changed part of a buffer
+	bool WriteBufferData(unsigned int bufferIndex, unsigned int byteOffset, const void* data, unsigned int size);
+	void UploadBuffer(SimpleConstantBuffer* cb);
+	static SimpleShaderUploadStats uploadStats;
+	static SimpleShaderUploadStats lastFrameUploadStats;
+
+	// Binds every constant buffer, from the ring if there is one
+	void SetConstantBuffers();
+	bool UsingConstantRing() { return constantRing && deviceContext1; }
+	bool WriteToRing(SimpleConstantBuffer* cb);
+	static ConstantRing* constantRing;
+
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
@@ -180,6 +327,8 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 
 protected:
 	bool perInstanceCompatible;
@@ -187,6 +336,10 @@ protected:
 	 Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	bool IsBound();
+	void BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
+	void BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 	void CleanUp();
 };
 
@@ -203,11 +356,17 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	bool IsBound();
+	void BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
+	void BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 	void CleanUp();
 };
 
@@ -223,11 +382,17 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	bool IsBound();
+	void BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
+	void BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 	void CleanUp();
 };
 
@@ -243,11 +408,17 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11HullShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	bool IsBound();
+	void BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
+	void BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 	void CleanUp();
 };
 
@@ -263,6 +434,8 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 
 	bool CreateCompatibleStreamOutBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer, int vertexCount);
 
@@ -280,6 +453,10 @@ protected:
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	bool CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	bool IsBound();
+	void BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
+	void BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 	void CleanUp();
 
 	// Helpers
@@ -304,6 +481,8 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 	bool SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
 
 	int GetUnorderedAccessViewIndex(std::string name);
@@ -319,5 +498,9 @@ protected:
 
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	bool IsBound();
+	void BindShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void BindSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
+	void BindConstantBuffer(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 	void CleanUp();
 };
\ No newline at end of file
@@ -1,11 +1,91 @@
 #include "Sky.h"
+#include "BRDFLookUp.h"
+#include "Clock.h"
+#include "Cubemap.h"
 #include "WICTextureLoader.h"
 #include "DDSTextureLoader.h"
+#include "EquirectCubemap.h"
+#include "Hash.h"
+#include "HDRDecoder.h"
+#include "IBLCache.h"
+#include "MappedFile.h"
+#include "PackedHDR.h"
+#include "PNGDecoder.h"
+#include "Profiler.h"
+#include "SpecularPrefilter.h"
+#include "SphericalHarmonics.h"
+
+#include <string.h>
 
 using namespace DirectX;
 
+static bool IsHDRFile(const wchar_t* path)
+{
+	size_t length = wcslen(path);
+	return length >= 4 && _wcsicmp(path + length - 4, L".hdr") == 0;
+}
+
+// --------------------------------------------------------
+// Decodes an equirectangular Radiance HDR image and
+// resamples it into a half float cube with a full mip
+// chain, all made on the CPU in one allocation that's
+// handed straight to the immutable texture.  Null if the
+// file can't be read.
+// --------------------------------------------------------
+static Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemapFromHDR(ID3D11Device* device, const wchar_t* path)
+{
+	PROFILE_ZONE("Sky::CreateCubemapFromHDR");
+
+	HDRImage image;
+	{
+		MappedFile file;
+		if (!file.Open(path) || !DecodeHDR(file.GetData(), file.GetSize(), image))
+			return 0;
+	}
+
+	HalfCubemap cube;
+	if (!ConvertEquirectToCubemap(image, GetEquirectCubeSize(image.Width), 0, cube))
+		return 0;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData(6 * cube.MipLevels);
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (unsigned int mip = 0; mip < cube.MipLevels; mip++)
+		{
+			D3D11_SUBRESOURCE_DATA& data = initialData[face * cube.MipLevels + mip];
+			data.pSysMem = cube.GetSubresource(face, mip);
+			data.SysMemPitch = (UINT)cube.GetRowPitch(mip);
+		}
+	}
+
+	D3D11_TEXTURE2D_DESC cubeDesc = {};
+	cubeDesc.ArraySize = 6;
+	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	cubeDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	cubeDesc.Width = cube.Size;
+	cubeDesc.Height = cube.Size;
+	cubeDesc.MipLevels = cube.MipLevels;
+	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+	cubeDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	cubeDesc.SampleDesc.Count = 1;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture;
+	if (FAILED(device->CreateTexture2D(&cubeDesc, initialData.data(), cubeMapTexture.GetAddressOf())))
+		return 0;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = cubeDesc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	srvDesc.TextureCube.MipLevels = cube.MipLevels;
+	srvDesc.TextureCube.MostDetailedMip = 0;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeSRV;
+	device->CreateShaderResourceView(cubeMapTexture.Get(), &srvDesc, cubeSRV.GetAddressOf());
+	return cubeSRV;
+}
+
 Sky::Sky(
-	const wchar_t* cubemapDDSFile, 
+	const wchar_t* cubemapFile, 
 	std::shared_ptr<Mesh> mesh,
 	std::shared_ptr<SimpleVertexShader> skyVS, 
 	std::shared_ptr<SimplePixelShader> skyPS, 
@@ -14,8 +94,7 @@ Sky::Sky(
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
 	std::shared_ptr<SimpleVertexShader> fullscreenVS,
 	std::shared_ptr<SimplePixelShader>irradiancePS,
-	std::shared_ptr<SimplePixelShader>specConvPS,
-	std::shared_ptr<SimplePixelShader>envBrdfPS)
+	std::shared_ptr<SimplePixelShader>specConvPS)
 {
 	// Save params
 	this->skyMesh = mesh;
@@ -26,15 +105,17 @@ Sky::Sky(
 	this->skyPS = skyPS;
 	IBLSpecMipLevels = 0;
 
-	// Init render states
+	// Init render states and shader handles
 	InitRenderStates();
+	InitShaderHandles();
 
-	// Load texture
-	CreateDDSTextureFromFile(device.Get(), cubemapDDSFile, 0, skySRV.GetAddressOf());
+	// Load texture, resampling equirectangular HDR images
+	if (IsHDRFile(cubemapFile))
+		skySRV = CreateCubemapFromHDR(device.Get(), cubemapFile);
+	else
+		CreateDDSTextureFromFile(device.Get(), cubemapFile, 0, skySRV.GetAddressOf());
 
-	IBLCreateIrradianceMap(fullscreenVS, irradiancePS);
-	IBLCreateConvolvedSpecularMap(fullscreenVS, specConvPS);
-	IBLCreateBRDFLookUpTexture(fullscreenVS, envBrdfPS);
+	IBLCreateMaps({ cubemapFile }, fullscreenVS, irradiancePS, specConvPS);
 }
 
 Sky::Sky(
@@ -52,8 +133,7 @@ Sky::Sky(
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
 	std::shared_ptr<SimpleVertexShader> fullscreenVS,
 	std::shared_ptr<SimplePixelShader>irradiancePS,
-	std::shared_ptr<SimplePixelShader>specConvPS,
-	std::shared_ptr<SimplePixelShader>envBrdfPS)
+	std::shared_ptr<SimplePixelShader>specConvPS)
 {
 	// Save params
 	this->skyMesh = mesh;
@@ -64,15 +144,62 @@ Sky::Sky(
 	this->skyPS = skyPS;
 	IBLSpecMipLevels = 0;
 
-	// Init render states
+	// Init render states and shader handles
 	InitRenderStates();
+	InitShaderHandles();
 
 	// Create texture from 6 images
 	skySRV = CreateCubemap(right, left, up, down, front, back);
 
-	IBLCreateIrradianceMap(fullscreenVS, irradiancePS);
-	IBLCreateConvolvedSpecularMap(fullscreenVS, specConvPS);
-	IBLCreateBRDFLookUpTexture(fullscreenVS, envBrdfPS);
+	IBLCreateMaps({ right, left, up, down, front, back }, fullscreenVS, irradiancePS, specConvPS);
+}
+
+Sky::Sky(
+	const ProceduralSkySettings& settings,
+	std::shared_ptr<Mesh> mesh,
+	std::shared_ptr<SimpleVertexShader> skyVS,
+	std::shared_ptr<SimplePixelShader> skyPS,
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerOptions,
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	PROFILE_ZONE("Sky::Sky procedural");
+
+	// Save params
+	this->skyMesh = mesh;
+	this->device = device;
+	this->context = context;
+	this->samplerOptions = samplerOptions;
+	this->skyVS = skyVS;
+	this->skyPS = skyPS;
+
+	// Init render states and shader handles
+	InitRenderStates();
+	InitShaderHandles();
+
+	// The specular cube is half the sky's size, skipping
+	// the same small mips as the other skies'
+	int specularMipLevels = max((int)(log2(IBLCubeSize / 2)) + 1 - IBLSpecMipLevelsToSkip, 1);
+	proceduralSky.reset(new ProceduralSkyBaker(IBLCubeSize, IBLIrradianceCubeSize, specularMipLevels, IBLProceduralSampleCount));
+
+	// The first bake all at once, so there's a sky to draw
+	SetProceduralSettings(settings);
+	proceduralSky->Finish();
+	IBLSpecMipLevels = proceduralSky->GetMaps().SpecularMipLevels;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srvs[PROCEDURAL_TEXTURE_COUNT];
+	if (CreateProceduralTextures(true, proceduralTextures, srvs) &&
+		CreateProceduralTextures(false, proceduralBackTextures, proceduralBackSRVs))
+	{
+		skySRV = srvs[PROCEDURAL_SKY];
+		irradianceIBL = srvs[PROCEDURAL_IRRADIANCE];
+		specularIBL = srvs[PROCEDURAL_SPECULAR];
+	}
+	else
+		proceduralSky.reset();	// Nothing to upload into
+
+	// The BRDF doesn't depend on the sky, so it's only made once
+	IBLCreateBRDFLookUpTexture();
 }
 
 Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::GetIrradianceMap()
@@ -99,6 +226,135 @@ Sky::~Sky()
 {
 }
 
+void Sky::SetProceduralSettings(const ProceduralSkySettings& settings)
+{
+	if (!proceduralSky)
+		return;
+	proceduralSettings = settings;
+	proceduralSky->Request(settings);
+}
+
+// --------------------------------------------------------
+// Bakes until a new set of maps is done, then spends the
+// frames after uploading it into the back textures.  Both
+// go by the same budget, and the textures in use only swap
+// once every subresource is there, so a half finished sky
+// is never drawn.
+// --------------------------------------------------------
+void Sky::UpdateProcedural(double budgetMs)
+{
+	if (!proceduralSky)
+		return;
+
+	PROFILE_ZONE("Sky::UpdateProcedural");
+
+	// Uploads wait for the frame after the bake finishes,
+	// which may already have used the whole budget
+	if (!proceduralUploading)
+	{
+		proceduralUploading = proceduralSky->Update(budgetMs);
+		proceduralUploadNext = 0;
+		return;
+	}
+
+	int64_t start = Clock::NowNanoseconds();
+	unsigned int count = 12 + 6 * proceduralSky->GetMaps().SpecularMipLevels;
+	do
+		UploadProceduralSubresource(proceduralUploadNext++);
+	while (proceduralUploadNext < count && Clock::NowNanoseconds() - start < budgetMs * 1000000.0);
+
+	if (proceduralUploadNext == count)
+	{
+		for (int i = 0; i < PROCEDURAL_TEXTURE_COUNT; i++)
+			proceduralTextures[i].Swap(proceduralBackTextures[i]);
+		skySRV.Swap(proceduralBackSRVs[PROCEDURAL_SKY]);
+		irradianceIBL.Swap(proceduralBackSRVs[PROCEDURAL_IRRADIANCE]);
+		specularIBL.Swap(proceduralBackSRVs[PROCEDURAL_SPECULAR]);
+		proceduralUploading = false;
+	}
+}
+
+// --------------------------------------------------------
+// Makes one set of a procedural sky's textures, linear
+// RGB9E5 but for the sky, which holds the gamma encoded
+// colors SkyPS expects.  Default usage, so the next bake
+// can be copied in; initialized from the baker's current
+// maps if asked.
+// --------------------------------------------------------
+bool Sky::CreateProceduralTextures(bool initialize, Microsoft::WRL::ComPtr<ID3D11Texture2D> textures[], Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srvs[])
+{
+	const ProceduralSkyMaps& maps = proceduralSky->GetMaps();
+	const unsigned int sizes[PROCEDURAL_TEXTURE_COUNT] = { maps.SkySize, maps.IrradianceSize, maps.SpecularSize };
+	const unsigned int mipLevels[PROCEDURAL_TEXTURE_COUNT] = { 1, 1, maps.SpecularMipLevels };
+
+	for (int i = 0; i < PROCEDURAL_TEXTURE_COUNT; i++)
+	{
+		std::vector<D3D11_SUBRESOURCE_DATA> initialData(6 * mipLevels[i]);
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			for (unsigned int mip = 0; mip < mipLevels[i]; mip++)
+			{
+				D3D11_SUBRESOURCE_DATA& data = initialData[D3D11CalcSubresource(mip, face, mipLevels[i])];
+				data.pSysMem =
+					i == PROCEDURAL_SKY ? maps.GetSkyFace(face) :
+					i == PROCEDURAL_IRRADIANCE ? maps.GetIrradianceFace(face) :
+					maps.GetSpecularSubresource(face, mip);
+				data.SysMemPitch = max(1u, sizes[i] >> mip) * sizeof(uint32_t);
+			}
+		}
+
+		D3D11_TEXTURE2D_DESC texDesc = {};
+		texDesc.Width = sizes[i];
+		texDesc.Height = sizes[i];
+		texDesc.ArraySize = 6;
+		texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		texDesc.Format = (DXGI_FORMAT)GetPackedHDRDXGIFormat(PACKED_HDR_RGB9E5);
+		texDesc.MipLevels = mipLevels[i];
+		texDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.SampleDesc.Count = 1;
+		if (FAILED(device->CreateTexture2D(&texDesc, initialize ? initialData.data() : 0, textures[i].ReleaseAndGetAddressOf())))
+			return false;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = mipLevels[i];
+		srvDesc.TextureCube.MostDetailedMip = 0;
+		srvDesc.Format = texDesc.Format;
+		if (FAILED(device->CreateShaderResourceView(textures[i].Get(), &srvDesc, srvs[i].ReleaseAndGetAddressOf())))
+			return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies one subresource of the baker's latest maps into
+// the back textures: the sky's 6 faces, then the irradiance
+// cube's, then every subresource of the specular cube
+// --------------------------------------------------------
+void Sky::UploadProceduralSubresource(unsigned int index)
+{
+	const ProceduralSkyMaps& maps = proceduralSky->GetMaps();
+	if (index < 6)
+	{
+		context->UpdateSubresource(proceduralBackTextures[PROCEDURAL_SKY].Get(), index, 0,
+			maps.GetSkyFace(index), maps.SkySize * sizeof(uint32_t), 0);
+	}
+	else if (index < 12)
+	{
+		context->UpdateSubresource(proceduralBackTextures[PROCEDURAL_IRRADIANCE].Get(), index - 6, 0,
+			maps.GetIrradianceFace(index - 6), maps.IrradianceSize * sizeof(uint32_t), 0);
+	}
+	else
+	{
+		unsigned int subresource = index - 12;
+		unsigned int face = subresource / maps.SpecularMipLevels;
+		unsigned int mip = subresource % maps.SpecularMipLevels;
+		context->UpdateSubresource(proceduralBackTextures[PROCEDURAL_SPECULAR].Get(), subresource, 0,
+			maps.GetSpecularSubresource(face, mip), maps.GetSpecularMipSize(mip) * sizeof(uint32_t), 0);
+	}
+}
+
 void Sky::Draw(std::shared_ptr<Camera> camera)
 {
 	// Change to the sky-specific rasterizer state
@@ -110,13 +366,13 @@ void Sky::Draw(std::shared_ptr<Camera> camera)
 	skyPS->SetShader();
 
 	// Give them proper data
-	skyVS->SetMatrix4x4("view", camera->GetView());
-	skyVS->SetMatrix4x4("projection", camera->GetProjection());
+	skyVS->SetMatrix4x4(viewHandle, camera->GetView());
+	skyVS->SetMatrix4x4(projectionHandle, camera->GetProjection());
 	skyVS->CopyAllBufferData();
 
 	// Send the proper resources to the pixel shader
-	skyPS->SetShaderResourceView("skyTexture", skySRV);
-	skyPS->SetSamplerState("samplerOptions", samplerOptions);
+	skyPS->SetShaderResourceView(skyTextureHandle, skySRV.Get());
+	skyPS->SetSamplerState(samplerOptionsHandle, samplerOptions.Get());
 
 	// Set mesh buffers and draw
 	skyMesh->SetBuffersAndDraw(context);
@@ -126,6 +382,14 @@ void Sky::Draw(std::shared_ptr<Camera> camera)
 	context->OMSetDepthStencilState(0, 0);
 }
 
+void Sky::InitShaderHandles()
+{
+	viewHandle = skyVS->GetVariableHandle("view");
+	projectionHandle = skyVS->GetVariableHandle("projection");
+	skyTextureHandle = skyPS->GetShaderResourceViewHandle("skyTexture");
+	samplerOptionsHandle = skyPS->GetSamplerHandle("samplerOptions");
+}
+
 void Sky::InitRenderStates()
 {
 	// Rasterizer to reverse the cull mode
@@ -143,7 +407,82 @@ void Sky::InitRenderStates()
 	device->CreateDepthStencilState(&depthDesc, skyDepthState.GetAddressOf());
 }
 
+// --------------------------------------------------------
+// Decodes all 6 faces at once, each on its own thread,
+// and creates the cube map straight from the decoded
+// pixels, without separate face textures to copy from.
+// Null unless every face is a PNG of the same size.
+// --------------------------------------------------------
+static Microsoft::WRL::ComPtr<ID3D11Texture2D> CreateCubemapFromPNGs(ID3D11Device* device, const wchar_t* const faces[6])
+{
+	MappedFile files[6];
+	std::vector<std::pair<const unsigned char*, size_t>> data;
+	for (int i = 0; i < 6; i++)
+	{
+		if (!files[i].Open(faces[i]))
+			return 0;
+		data.push_back({ files[i].GetData(), files[i].GetSize() });
+	}
+
+	std::vector<PNGImage> images;
+	if (DecodePNGs(data, images) != 6)
+		return 0;
+
+	D3D11_SUBRESOURCE_DATA initialData[6] = {};
+	for (int i = 0; i < 6; i++)
+	{
+		if (images[i].Info.Width != images[0].Info.Width || images[i].Info.Height != images[0].Info.Height)
+			return 0;
+		initialData[i].pSysMem = images[i].RGBA.data();
+		initialData[i].SysMemPitch = images[i].Info.Width * 4;
+	}
+
+	// sRGB the same way the WIC loader decides it
+	D3D11_TEXTURE2D_DESC cubeDesc = {};
+	cubeDesc.ArraySize = 6;
+	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	cubeDesc.Format = images[0].Info.SRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	cubeDesc.Width = images[0].Info.Width;
+	cubeDesc.Height = images[0].Info.Height;
+	cubeDesc.MipLevels = 1;
+	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+	cubeDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	cubeDesc.SampleDesc.Count = 1;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture;
+	device->CreateTexture2D(&cubeDesc, initialData, cubeMapTexture.GetAddressOf());
+	return cubeMapTexture;
+}
+
 Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(const wchar_t* right, const wchar_t* left, const wchar_t* up, const wchar_t* down, const wchar_t* front, const wchar_t* back)
+{
+	// PNG faces can be decoded in parallel, right into the cube
+	const wchar_t* const faces[6] = { right, left, up, down, front, back };
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture = CreateCubemapFromPNGs(device.Get(), faces);
+	if (!cubeMapTexture)
+		cubeMapTexture = CreateCubemapWithWIC(right, left, up, down, front, back);
+
+	D3D11_TEXTURE2D_DESC cubeDesc = {};
+	if (cubeMapTexture)
+		cubeMapTexture->GetDesc(&cubeDesc);
+
+	// At this point, all of the faces are in the cube map
+	// texture, so we can describe a shader resource view for it
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = cubeDesc.Format; // Same format as texture
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE; // Treat this as a cube!
+	srvDesc.TextureCube.MipLevels = 1;	// Only need access to 1 mip
+	srvDesc.TextureCube.MostDetailedMip = 0; // Index of the first mip we want to see
+
+	// Make the SRV
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeSRV;
+	device->CreateShaderResourceView(cubeMapTexture.Get(), &srvDesc, cubeSRV.GetAddressOf());
+
+	// Send back the SRV, which is what we need for our shaders
+	return cubeSRV;
+}
+
+Microsoft::WRL::ComPtr<ID3D11Texture2D> Sky::CreateCubemapWithWIC(const wchar_t* right, const wchar_t* left, const wchar_t* up, const wchar_t* down, const wchar_t* front, const wchar_t* back)
 {
 	// Load the 6 textures into an array.
 	// - We need references to the TEXTURES, not the SHADER RESOURCE VIEWS!
@@ -202,24 +541,336 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(const wchar_
 			0);					// Source subresource "box" of data to copy (zero means the whole thing)
 	}
 
-	// At this point, all of the faces have been copied into the 
-	// cube map texture, so we can describe a shader resource view for it
+	return cubeMapTexture;
+}
+
+// --------------------------------------------------------
+// Copies the top mip of the sky's faces somewhere the CPU
+// can read and maps them, until UnmapSkyPixels().  False
+// (with nothing left mapped) for sky formats the CPU paths
+// can't read.
+// --------------------------------------------------------
+static bool MapSkyPixels(
+	ID3D11Device* device,
+	ID3D11DeviceContext* context,
+	ID3D11ShaderResourceView* skySRV,
+	Microsoft::WRL::ComPtr<ID3D11Texture2D>& staging,
+	CubemapPixels& cube)
+{
+	if (!skySRV)
+		return false;
+
+	Microsoft::WRL::ComPtr<ID3D11Resource> skyResource;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> skyTexture;
+	skySRV->GetResource(skyResource.GetAddressOf());
+	if (FAILED(skyResource.As(&skyTexture)))
+		return false;
+
+	D3D11_TEXTURE2D_DESC skyDesc = {};
+	skyTexture->GetDesc(&skyDesc);
+	if (skyDesc.ArraySize < 6 || skyDesc.Width != skyDesc.Height)
+		return false;
+
+	cube = CubemapPixels();
+	cube.Size = skyDesc.Width;
+	switch (skyDesc.Format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM: break;
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: cube.SRGB = true; break;
+	case DXGI_FORMAT_B8G8R8A8_UNORM: cube.BGRA = true; break;
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: cube.BGRA = true; cube.SRGB = true; break;
+	default: return false;
+	}
+
+	D3D11_TEXTURE2D_DESC stagingDesc = {};
+	stagingDesc.Width = skyDesc.Width;
+	stagingDesc.Height = skyDesc.Height;
+	stagingDesc.MipLevels = 1;
+	stagingDesc.ArraySize = 6;
+	stagingDesc.Format = skyDesc.Format;
+	stagingDesc.SampleDesc.Count = 1;
+	stagingDesc.Usage = D3D11_USAGE_STAGING;
+	stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	if (FAILED(device->CreateTexture2D(&stagingDesc, 0, staging.ReleaseAndGetAddressOf())))
+		return false;
+
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		context->CopySubresourceRegion(
+			staging.Get(), D3D11CalcSubresource(0, face, 1), 0, 0, 0,
+			skyTexture.Get(), D3D11CalcSubresource(0, face, skyDesc.MipLevels), 0);
+	}
+
+	// CubemapPixels has one pitch for every face
+	unsigned int mappedFaces = 0;
+	bool samePitch = true;
+	for (; mappedFaces < 6; mappedFaces++)
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (FAILED(context->Map(staging.Get(), D3D11CalcSubresource(0, mappedFaces, 1), D3D11_MAP_READ, 0, &mapped)))
+			break;
+		samePitch = samePitch && (mappedFaces == 0 || mapped.RowPitch == cube.RowPitch);
+		cube.Faces[mappedFaces] = (const unsigned char*)mapped.pData;
+		cube.RowPitch = mapped.RowPitch;
+	}
+	if (mappedFaces == 6 && samePitch)
+		return true;
+
+	for (unsigned int face = 0; face < mappedFaces; face++)
+		context->Unmap(staging.Get(), D3D11CalcSubresource(0, face, 1));
+	return false;
+}
+
+static void UnmapSkyPixels(ID3D11DeviceContext* context, ID3D11Texture2D* staging)
+{
+	for (unsigned int face = 0; face < 6; face++)
+		context->Unmap(staging, D3D11CalcSubresource(0, face, 1));
+}
+
+void Sky::IBLCreateMaps(
+	const std::vector<std::wstring>& skyFiles,
+	std::shared_ptr<SimpleVertexShader> fullscreenVS,
+	std::shared_ptr<SimplePixelShader> irradiancePS,
+	std::shared_ptr<SimplePixelShader> specConvPS)
+{
+	// Hash everything the maps depend on: the sky's files,
+	// the sizes and sample counts, and the shaders' bytecode,
+	// which covers their own MAX_IBL_SAMPLES.  Sizes go in too,
+	// so one file's bytes can't run into the next's.
+	uint32_t version = IBLCache::Version;
+	uint64_t hash = HashFNV1a(&version, sizeof(version));
+	const int parameters[] = { IBLCubeSize, IBLIrradianceCubeSize, IBLSpecMipLevelsToSkip, IBLLookUpTextureSize, IBLLookUpSampleCount, IBLSpecularSampleCount };
+	hash = HashFNV1a(parameters, sizeof(parameters), hash);
+
+	bool cacheable = !skyFiles.empty();
+	{
+		PROFILE_ZONE("Sky::IBLHashSources");
+		for (const std::wstring& path : skyFiles)
+		{
+			MappedFile file;
+			cacheable = cacheable && file.Open(path.c_str());
+			uint64_t size = file.GetSize();
+			hash = HashFNV1a(&size, sizeof(size), hash);
+			hash = HashFNV1a(file.GetData(), file.GetSize(), hash);
+		}
+
+		ISimpleShader* shaders[] = { fullscreenVS.get(), irradiancePS.get(), specConvPS.get() };
+		for (ISimpleShader* shader : shaders)
+		{
+			Microsoft::WRL::ComPtr<ID3DBlob> blob;
+			if (shader)
+				blob = shader->GetShaderBlob();
+			cacheable = cacheable && blob.Get() != 0;
+			uint64_t size = blob ? blob->GetBufferSize() : 0;
+			hash = HashFNV1a(&size, sizeof(size), hash);
+			if (blob)
+				hash = HashFNV1a(blob->GetBufferPointer(), blob->GetBufferSize(), hash);
+		}
+	}
+
+	std::wstring cachePath = cacheable ? skyFiles[0] + L".ibl" : std::wstring();
+	if (cacheable && IBLLoadCache(cachePath, hash))
+		return;
+
+	// The sky's pixels, read back once for both CPU paths
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> skyStaging;
+	CubemapPixels skyPixels;
+	bool skyMapped = MapSkyPixels(device.Get(), context.Get(), skySRV.Get(), skyStaging, skyPixels);
+	IBLCreateIrradianceMap(skyMapped ? &skyPixels : 0, fullscreenVS, irradiancePS);
+	IBLCreateConvolvedSpecularMap(skyMapped ? &skyPixels : 0, fullscreenVS, specConvPS);
+	if (skyMapped)
+		UnmapSkyPixels(context.Get(), skyStaging.Get());
+	IBLCreateBRDFLookUpTexture();
+
+	if (cacheable)
+		IBLWriteCache(cachePath, hash);
+}
+
+// Bytes per texel of the formats the IBL maps can be in,
+// or 0 for anything else
+static uint32_t GetBytesPerTexel(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+		return 4;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		return 8;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+// --------------------------------------------------------
+// Makes a texture (a cube if it has 6 slices) straight from
+// cached pixels, which can be the mapped file itself
+// --------------------------------------------------------
+static bool CreateTextureFromCache(ID3D11Device* device, const IBLCacheTexture& cached, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	bool cube = cached.ArraySize == 6;
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData(cached.Subresources.size());
+	for (size_t i = 0; i < initialData.size(); i++)
+	{
+		uint32_t mip = (uint32_t)(i % cached.MipLevels);
+		initialData[i].pSysMem = cached.Subresources[i];
+		initialData[i].SysMemPitch = (UINT)cached.GetRowPitch(mip);
+	}
+
+	D3D11_TEXTURE2D_DESC texDesc = {};
+	texDesc.Width = cached.Width;
+	texDesc.Height = cached.Height;
+	texDesc.ArraySize = cached.ArraySize;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	texDesc.Format = (DXGI_FORMAT)cached.DXGIFormat;
+	texDesc.MipLevels = cached.MipLevels;
+	texDesc.MiscFlags = cube ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+	texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	texDesc.SampleDesc.Count = 1;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(device->CreateTexture2D(&texDesc, initialData.data(), texture.GetAddressOf())))
+		return false;
+
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = cubeDesc.Format; // Same format as texture
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE; // Treat this as a cube!
-	srvDesc.TextureCube.MipLevels = 1;	// Only need access to 1 mip
-	srvDesc.TextureCube.MostDetailedMip = 0; // Index of the first mip we want to see
+	srvDesc.Format = texDesc.Format;
+	if (cube)
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = cached.MipLevels;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = cached.MipLevels;
+	}
+	return SUCCEEDED(device->CreateShaderResourceView(texture.Get(), &srvDesc, srv.ReleaseAndGetAddressOf()));
+}
 
-	// Make the SRV
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeSRV;
-	device->CreateShaderResourceView(cubeMapTexture.Get(), &srvDesc, cubeSRV.GetAddressOf());
+// --------------------------------------------------------
+// Copies a texture back from the GPU into tightly packed
+// subresources, kept alive by pixels
+// --------------------------------------------------------
+static bool ReadBackTexture(
+	ID3D11Device* device,
+	ID3D11DeviceContext* context,
+	ID3D11ShaderResourceView* srv,
+	IBLCacheTexture& cached,
+	std::vector<std::vector<unsigned char>>& pixels)
+{
+	if (!srv)
+		return false;
 
-	// Send back the SRV, which is what we need for our shaders
-	return cubeSRV;
+	Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	srv->GetResource(resource.GetAddressOf());
+	if (FAILED(resource.As(&texture)))
+		return false;
+
+	D3D11_TEXTURE2D_DESC texDesc = {};
+	texture->GetDesc(&texDesc);
+	cached.DXGIFormat = texDesc.Format;
+	cached.BytesPerTexel = GetBytesPerTexel(texDesc.Format);
+	cached.Width = texDesc.Width;
+	cached.Height = texDesc.Height;
+	cached.ArraySize = texDesc.ArraySize;
+	cached.MipLevels = texDesc.MipLevels;
+	if (cached.BytesPerTexel == 0)
+		return false;
+
+	D3D11_TEXTURE2D_DESC stagingDesc = texDesc;
+	stagingDesc.BindFlags = 0;
+	stagingDesc.MiscFlags = 0;
+	stagingDesc.Usage = D3D11_USAGE_STAGING;
+	stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> staging;
+	if (FAILED(device->CreateTexture2D(&stagingDesc, 0, staging.GetAddressOf())))
+		return false;
+	context->CopyResource(staging.Get(), texture.Get());
+
+	cached.Subresources.clear();
+	unsigned int subresources = texDesc.ArraySize * texDesc.MipLevels;
+	for (unsigned int i = 0; i < subresources; i++)
+	{
+		uint32_t mip = i % texDesc.MipLevels;
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (FAILED(context->Map(staging.Get(), i, D3D11_MAP_READ, 0, &mapped)))
+			return false;
+
+		size_t rowPitch = cached.GetRowPitch(mip);
+		size_t rows = cached.GetSubresourceSize(mip) / rowPitch;
+		pixels.emplace_back(rowPitch * rows);
+		for (size_t y = 0; y < rows; y++)
+			memcpy(&pixels.back()[y * rowPitch], (const unsigned char*)mapped.pData + y * mapped.RowPitch, rowPitch);
+		context->Unmap(staging.Get(), i);
+		cached.Subresources.push_back(pixels.back().data());
+	}
+	return true;
 }
 
-void Sky::IBLCreateIrradianceMap(std::shared_ptr<SimpleVertexShader> fullscreenVS, std::shared_ptr<SimplePixelShader>irradiancePS)
+bool Sky::IBLLoadCache(const std::wstring& cachePath, uint64_t hash)
 {
+	PROFILE_ZONE("Sky::IBLLoadCache");
+
+	MappedFile file;
+	IBLCache cache;
+	if (!file.Open(cachePath.c_str()) ||
+		!cache.Parse(file.GetData(), file.GetSize(), hash))
+		return false;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> irradiance, specular, lookUp;
+	if (!CreateTextureFromCache(device.Get(), cache.Irradiance, irradiance) ||
+		!CreateTextureFromCache(device.Get(), cache.Specular, specular) ||
+		!CreateTextureFromCache(device.Get(), cache.BRDFLookUp, lookUp))
+		return false;
+
+	irradianceIBL = irradiance;
+	specularIBL = specular;
+	brdfLookUpMap = lookUp;
+	IBLSpecMipLevels = (int)cache.Specular.MipLevels;
+	return true;
+}
+
+// --------------------------------------------------------
+// Saves the maps for next time.  Like the shader metadata
+// cache, it's written to a temporary file and moved into
+// place.  Failing just means making the maps again.
+// --------------------------------------------------------
+void Sky::IBLWriteCache(const std::wstring& cachePath, uint64_t hash)
+{
+	PROFILE_ZONE("Sky::IBLWriteCache");
+
+	// Every texture's pixels, which the cache points into
+	std::vector<std::vector<unsigned char>> pixels;
+	IBLCache cache;
+	cache.SourceHash = hash;
+	if (!ReadBackTexture(device.Get(), context.Get(), irradianceIBL.Get(), cache.Irradiance, pixels) ||
+		!ReadBackTexture(device.Get(), context.Get(), specularIBL.Get(), cache.Specular, pixels) ||
+		!ReadBackTexture(device.Get(), context.Get(), brdfLookUpMap.Get(), cache.BRDFLookUp, pixels))
+		return;
+
+	std::vector<unsigned char> bytes;
+	cache.Serialize(bytes);
+
+	WriteFileReplacing(cachePath.c_str(), bytes.data(), bytes.size());
+}
+
+void Sky::IBLCreateIrradianceMap(const CubemapPixels* sky, std::shared_ptr<SimpleVertexShader> fullscreenVS, std::shared_ptr<SimplePixelShader>irradiancePS)
+{
+	PROFILE_ZONE("Sky::IBLCreateIrradianceMap");
+
+	// Spherical harmonics when the sky's pixels can be read,
+	// otherwise the brute force shader below
+	if (sky && IBLCreateIrradianceMapSH(*sky))
+		return;
+
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> irrMapFinalTexture;
 
 	// Create the final irradiance cube texture
@@ -228,7 +879,7 @@ void Sky::IBLCreateIrradianceMap(std::shared_ptr<SimpleVertexShader> fullscreenV
 	texDesc.Height = IBLCubeSize; // Same as width
 	texDesc.ArraySize = 6; // Cube map means 6 textures
 	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE; // Will be used as both
-	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // Basic texture format
+	texDesc.Format = DXGI_FORMAT_R11G11B10_FLOAT; // Linear HDR that can be rendered to (RGB9E5 can't)
 	texDesc.MipLevels = 1; // No mip chain needed
 	texDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE; // It's a cube map
 	texDesc.SampleDesc.Count = 1; // Can't be zero
@@ -306,13 +957,71 @@ void Sky::IBLCreateIrradianceMap(std::shared_ptr<SimpleVertexShader> fullscreenV
 
 }
 
-void Sky::IBLCreateConvolvedSpecularMap(std::shared_ptr<SimpleVertexShader> fullscreenVS, std::shared_ptr<SimplePixelShader>specConvPS)
+// --------------------------------------------------------
+// Irradiance from the sky's spherical harmonics: the faces
+// are projected on the CPU, then a small cube is filled in
+// from the 9 coefficients.  On the bundled sky
+// this is within 6 of 255 levels of IBLIrradianceMapPS
+// everywhere (0.5 on average, the worst in the dark ground
+// below the horizon), in milliseconds instead of seconds.
+// --------------------------------------------------------
+bool Sky::IBLCreateIrradianceMapSH(const CubemapPixels& sky)
+{
+	SH9Color irradiance;
+	if (!ProjectCubemapSH9(sky, irradiance))
+		return false;
+
+	ConvolveIrradianceSH9(irradiance);
+	LinearCubemapLevel level;
+	CreateIrradianceCubeSH9(irradiance, IBLIrradianceCubeSize, level);
+
+	// Linear RGB9E5, which only needs to be sampled
+	std::vector<uint32_t> faces[6];
+	D3D11_SUBRESOURCE_DATA initialData[6] = {};
+	for (int face = 0; face < 6; face++)
+	{
+		faces[face].resize((size_t)level.Size * level.Size);
+		PackHDR(level.Faces[face].data(), faces[face].size(), PACKED_HDR_RGB9E5, faces[face].data());
+		initialData[face].pSysMem = faces[face].data();
+		initialData[face].SysMemPitch = level.Size * sizeof(uint32_t);
+	}
+
+	D3D11_TEXTURE2D_DESC texDesc = {};
+	texDesc.Width = IBLIrradianceCubeSize;
+	texDesc.Height = IBLIrradianceCubeSize;
+	texDesc.ArraySize = 6;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	texDesc.Format = (DXGI_FORMAT)GetPackedHDRDXGIFormat(PACKED_HDR_RGB9E5);
+	texDesc.MipLevels = 1;
+	texDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+	texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	texDesc.SampleDesc.Count = 1;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> irrMapFinalTexture;
+	if (FAILED(device->CreateTexture2D(&texDesc, initialData, irrMapFinalTexture.GetAddressOf())))
+		return false;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	srvDesc.TextureCube.MipLevels = 1;
+	srvDesc.TextureCube.MostDetailedMip = 0;
+	srvDesc.Format = texDesc.Format;
+	return SUCCEEDED(device->CreateShaderResourceView(irrMapFinalTexture.Get(), &srvDesc, irradianceIBL.GetAddressOf()));
+}
+
+void Sky::IBLCreateConvolvedSpecularMap(const CubemapPixels* sky, std::shared_ptr<SimpleVertexShader> fullscreenVS, std::shared_ptr<SimplePixelShader>specConvPS)
 {
+	PROFILE_ZONE("Sky::IBLCreateConvolvedSpecularMap");
+
 	// Calculate how many mip levels we'll need, potentially skipping a few of the smaller
 	// mip levels (1x1, 2x2, etc.) because, with such low resolutions, they're mostly the same.
 	// (The +1 is necessary to account for the 1x1 mip level)
 	IBLSpecMipLevels = max((int)(log2(IBLCubeSize)) + 1 - IBLSpecMipLevelsToSkip, 1);
 
+	// Filtered importance sampling when the sky's pixels can
+	// be read, otherwise the brute force shader below
+	if (sky && IBLCreateConvolvedSpecularMapCPU(*sky))
+		return;
+
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> specConvFinalTexture;
 
 	// Create the final irradiance cube texture
@@ -321,7 +1030,7 @@ void Sky::IBLCreateConvolvedSpecularMap(std::shared_ptr<SimpleVertexShader> full
 	texDesc.Height = IBLCubeSize; // Same as width
 	texDesc.ArraySize = 6; // Cube map means 6 textures
 	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE; // Will be used as both
-	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // Basic texture format
+	texDesc.Format = DXGI_FORMAT_R11G11B10_FLOAT; // Linear HDR that can be rendered to (RGB9E5 can't)
 	texDesc.MipLevels = IBLSpecMipLevels; //What we calculated
 	texDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE; // It's a cube map
 	texDesc.SampleDesc.Count = 1; // Can't be zero
@@ -405,20 +1114,87 @@ void Sky::IBLCreateConvolvedSpecularMap(std::shared_ptr<SimpleVertexShader> full
 
 }
 
-void Sky::IBLCreateBRDFLookUpTexture(std::shared_ptr<SimpleVertexShader> fullscreenVS, std::shared_ptr<SimplePixelShader>envBrdfPS)
+// --------------------------------------------------------
+// The pre-filtered specular cube made on the CPU (see
+// SpecularPrefilter.h).  The sky is decoded to linear mips
+// from twice the cube's size down, then each mip of the
+// cube takes IBLSpecularSampleCount filtered samples per
+// texel across every hardware thread.
+// --------------------------------------------------------
+bool Sky::IBLCreateConvolvedSpecularMapCPU(const CubemapPixels& sky)
 {
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> envBrdfFinalTexture;
+	LinearCubemap source;
+	LinearCubemap prefiltered;
+	if (!DecodeCubemap(sky, IBLCubeSize * 2, source) ||
+		!PrefilterSpecularCubemap(source, IBLCubeSize, IBLSpecMipLevels, IBLSpecularSampleCount, prefiltered))
+		return false;
+
+	// Linear RGB9E5, every mip of the first face, then the
+	// next face's
+	std::vector<std::vector<uint32_t>> pixels((size_t)IBLSpecMipLevels * 6);
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData(pixels.size());
+	for (int mip = 0; mip < IBLSpecMipLevels; mip++)
+	{
+		const LinearCubemapLevel& level = prefiltered.Mips[mip];
+		for (int face = 0; face < 6; face++)
+		{
+			size_t subresource = D3D11CalcSubresource(mip, face, IBLSpecMipLevels);
+			pixels[subresource].resize((size_t)level.Size * level.Size);
+			PackHDR(level.Faces[face].data(), pixels[subresource].size(), PACKED_HDR_RGB9E5, pixels[subresource].data());
+			initialData[subresource].pSysMem = pixels[subresource].data();
+			initialData[subresource].SysMemPitch = level.Size * sizeof(uint32_t);
+		}
+	}
 
+	D3D11_TEXTURE2D_DESC texDesc = {};
+	texDesc.Width = IBLCubeSize;
+	texDesc.Height = IBLCubeSize;
+	texDesc.ArraySize = 6;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	texDesc.Format = (DXGI_FORMAT)GetPackedHDRDXGIFormat(PACKED_HDR_RGB9E5);
+	texDesc.MipLevels = IBLSpecMipLevels;
+	texDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+	texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	texDesc.SampleDesc.Count = 1;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> specConvFinalTexture;
+	if (FAILED(device->CreateTexture2D(&texDesc, initialData.data(), specConvFinalTexture.GetAddressOf())))
+		return false;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	srvDesc.TextureCube.MipLevels = IBLSpecMipLevels;
+	srvDesc.TextureCube.MostDetailedMip = 0;
+	srvDesc.Format = texDesc.Format;
+	return SUCCEEDED(device->CreateShaderResourceView(specConvFinalTexture.Get(), &srvDesc, specularIBL.GetAddressOf()));
+}
+
+// --------------------------------------------------------
+// The split sum's environment BRDF, integrated on the CPU
+// (see BRDFLookUp.h) rather than rendered
+// --------------------------------------------------------
+void Sky::IBLCreateBRDFLookUpTexture()
+{
+	PROFILE_ZONE("Sky::IBLCreateBRDFLookUpTexture");
+
+	std::vector<uint16_t> table;
+	GenerateBRDFLookUp(IBLLookUpTextureSize, IBLLookUpSampleCount, table);
+
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = table.data();
+	initialData.SysMemPitch = IBLLookUpTextureSize * 2 * sizeof(uint16_t);
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> envBrdfFinalTexture;
 	D3D11_TEXTURE2D_DESC texDesc = {};
 	texDesc.Width = IBLLookUpTextureSize;
 	texDesc.Height = IBLLookUpTextureSize;
 	texDesc.ArraySize = 1; // Single texture
-	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	texDesc.Format = DXGI_FORMAT_R16G16_UNORM;  // Only two channels, each of which is double the precision
 	texDesc.MipLevels = 1; // Just one mip level
 	texDesc.MiscFlags = 0; // not a cube map
+	texDesc.Usage = D3D11_USAGE_IMMUTABLE;
 	texDesc.SampleDesc.Count = 1; // Can't be zero
-	device->CreateTexture2D(&texDesc, 0, envBrdfFinalTexture.GetAddressOf());
+	device->CreateTexture2D(&texDesc, &initialData, envBrdfFinalTexture.GetAddressOf());
 
 	// Create an SRV for the BRDF look-up texture
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
@@ -428,57 +1204,4 @@ void Sky::IBLCreateBRDFLookUpTexture(std::shared_ptr<SimpleVertexShader> fullscr
 	srvDesc.Format = texDesc.Format; // Same format as texture
 	device->CreateShaderResourceView(
 		envBrdfFinalTexture.Get(), &srvDesc, brdfLookUpMap.GetAddressOf());
-
-	// Save current render target and depth buffer
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> prevRTV;
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> prevDSV;
-	context->OMGetRenderTargets(1, prevRTV.GetAddressOf(), prevDSV.GetAddressOf());
-
-	// Save current viewport
-	unsigned int vpCount = 1;
-	D3D11_VIEWPORT prevVP = {};
-	context->RSGetViewports(&vpCount, &prevVP);
-
-	// Create a viewport that matches the size of this texture
-	D3D11_VIEWPORT vp = {};
-	vp.Width = (float)IBLLookUpTextureSize;
-	vp.Height = (float)IBLLookUpTextureSize;
-	vp.MinDepth = 0.0f;
-	vp.MaxDepth = 1.0f;
-	context->RSSetViewports(1, &vp);
-
-	// Set states that may or may not be set yet
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	//set up shaders
-	fullscreenVS->SetShader();
-	envBrdfPS->SetShader();
-
-	//Render
-	// Make a render target view for this whole texture
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D; // This points to a Texture2D
-	rtvDesc.Texture2D.MipSlice = 0; // Which mip are we rendering into?
-	rtvDesc.Format = texDesc.Format; // Match the format of the texture
-
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> rtv;
-	device->CreateRenderTargetView(envBrdfFinalTexture.Get(), &rtvDesc, rtv.GetAddressOf());
-
-	// Clear and set this render target
-	float black[4] = {}; // Initialize to all zeroes
-	context->ClearRenderTargetView(rtv.Get(), black);
-	context->OMSetRenderTargets(1, rtv.GetAddressOf(), 0);
-
-	// Render exactly 3 vertices
-	context->Draw(3, 0);
-
-	// Ensure we flush the graphics pipe to 
-	// so that we don't cause a hardware timeout
-	// which can result in a driver crash
-	// NOTE: This might make C++ sit and wait!  Better than a crash!
-	context->Flush();
-
-	//Restore
-	context->OMSetRenderTargets(1, prevRTV.GetAddressOf(), prevDSV.Get());
-	context->RSSetViewports(1, &prevVP);
 }
@@ -1,20 +1,26 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "Mesh.h"
 #include "SimpleShader.h"
 #include "Camera.h"
+#include "ProceduralSky.h"
 
 #include <wrl/client.h> // Used for ComPtr
 
+struct CubemapPixels;
+
 class Sky
 {
 public:
 
-	// Constructor that loads a DDS cube map file
+	// Constructor that loads a DDS cube map file, or an
+	// equirectangular .hdr image it resamples into a cube
 	Sky(
-		const wchar_t* cubemapDDSFile, 
+		const wchar_t* cubemapFile, 
 		std::shared_ptr<Mesh> mesh,
 		std::shared_ptr<SimpleVertexShader> skyVS,
 		std::shared_ptr<SimplePixelShader> skyPS,
@@ -23,8 +29,7 @@ public:
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, 
 		std::shared_ptr<SimpleVertexShader> fullscreenVS, 
 		std::shared_ptr<SimplePixelShader>irradiancePS,
-		std::shared_ptr<SimplePixelShader>specConvPS,
-		std::shared_ptr<SimplePixelShader>envBrdfPS
+		std::shared_ptr<SimplePixelShader>specConvPS
 	);
 
 	// Constructor that loads 6 textures and makes a cube map
@@ -43,10 +48,34 @@ public:
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
 		std::shared_ptr<SimpleVertexShader> fullscreenVS,
 		std::shared_ptr<SimplePixelShader>irradiancePS,
-		std::shared_ptr<SimplePixelShader>specConvPS,
-		std::shared_ptr<SimplePixelShader>envBrdfPS
+		std::shared_ptr<SimplePixelShader>specConvPS
 	);
 
+	// Constructor that makes a procedural daylight sky (see
+	// ProceduralSky.h), baked all at once to start with.  Sky
+	// changes after that are baked a bit at a time by
+	// UpdateProcedural(), showing the old maps until the new
+	// ones are done.
+	Sky(
+		const ProceduralSkySettings& settings,
+		std::shared_ptr<Mesh> mesh,
+		std::shared_ptr<SimpleVertexShader> skyVS,
+		std::shared_ptr<SimplePixelShader> skyPS,
+		Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerOptions,
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context
+	);
+
+	// Procedural skies only: the sky to bake next, and about
+	// how many milliseconds of this frame to spend baking it
+	// and uploading the results (at least one piece of work
+	// either way, so it always gets there)
+	bool IsProcedural() { return proceduralSky != 0; }
+	void SetProceduralSettings(const ProceduralSkySettings& settings);
+	const ProceduralSkySettings& GetProceduralSettings() { return proceduralSettings; }
+	void UpdateProcedural(double budgetMs);
+	const ProceduralSkyBaker* GetProceduralBaker() { return proceduralSky.get(); }
+
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetIrradianceMap();
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetSpecularMap();
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetBRDFLookUpTexture();
@@ -59,6 +88,7 @@ public:
 private:
 
 	void InitRenderStates();
+	void InitShaderHandles();
 
 	// Helper for creating a cubemap from 6 individual textures
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemap(
@@ -69,9 +99,25 @@ private:
 		const wchar_t* front,
 		const wchar_t* back);
 
+	// Loads each face with WIC and copies it into the cube,
+	// for faces that aren't PNGs
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> CreateCubemapWithWIC(
+		const wchar_t* right,
+		const wchar_t* left,
+		const wchar_t* up,
+		const wchar_t* down,
+		const wchar_t* front,
+		const wchar_t* back);
+
 	// Skybox related resources
 	std::shared_ptr<SimpleVertexShader> skyVS;
 	std::shared_ptr<SimplePixelShader> skyPS;
+
+	// Handles for what Draw() sets, resolved once
+	SimpleVariableHandle viewHandle;
+	SimpleVariableHandle projectionHandle;
+	SimpleResourceHandle skyTextureHandle;
+	SimpleResourceHandle samplerOptionsHandle;
 	
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> irradianceIBL;		// Incoming diffuse light
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> specularIBL;		// Incoming specular light
@@ -79,12 +125,52 @@ private:
 	int IBLSpecMipLevels;
 	int IBLSpecMipLevelsToSkip = 3;
 	const int IBLCubeSize = 256;
+	const int IBLIrradianceCubeSize = 32;	// Plenty for irradiance rebuilt from spherical harmonics
 	const int IBLLookUpTextureSize = 256;
-
-	void IBLCreateIrradianceMap(std::shared_ptr<SimpleVertexShader> fullscreenVS, std::shared_ptr<SimplePixelShader>irradiancePS);
-	void IBLCreateConvolvedSpecularMap(std::shared_ptr<SimpleVertexShader> fullscreenVS, std::shared_ptr<SimplePixelShader>specConvPS);
-	void IBLCreateBRDFLookUpTexture(std::shared_ptr<SimpleVertexShader> fullscreenVS, std::shared_ptr<SimplePixelShader>envBrdfPS);
-
+	const int IBLLookUpSampleCount = 4096;	// MAX_IBL_SAMPLES in Lighting.hlsli
+	const int IBLSpecularSampleCount = 64;	// Filtered, so far fewer than the shader needs
+	const int IBLProceduralSampleCount = 32;	// Fewer still for the smooth procedural sky
+
+	// Loads the IBL maps from a cache file next to the sky's
+	// first file when it was made from the same sky, sizes
+	// and shaders.  Otherwise makes them and rewrites it.
+	void IBLCreateMaps(
+		const std::vector<std::wstring>& skyFiles,
+		std::shared_ptr<SimpleVertexShader> fullscreenVS,
+		std::shared_ptr<SimplePixelShader>irradiancePS,
+		std::shared_ptr<SimplePixelShader>specConvPS);
+	bool IBLLoadCache(const std::wstring& cachePath, uint64_t hash);
+	void IBLWriteCache(const std::wstring& cachePath, uint64_t hash);
+
+	// Made on the CPU from the sky's pixels when they can be
+	// read back (sky isn't null), otherwise with the shaders
+	void IBLCreateIrradianceMap(const CubemapPixels* sky, std::shared_ptr<SimpleVertexShader> fullscreenVS, std::shared_ptr<SimplePixelShader>irradiancePS);
+	bool IBLCreateIrradianceMapSH(const CubemapPixels& sky);
+	void IBLCreateConvolvedSpecularMap(const CubemapPixels* sky, std::shared_ptr<SimpleVertexShader> fullscreenVS, std::shared_ptr<SimplePixelShader>specConvPS);
+	bool IBLCreateConvolvedSpecularMapCPU(const CubemapPixels& sky);
+	void IBLCreateBRDFLookUpTexture();
+
+
+	// A procedural sky's baker, and the textures its maps go
+	// into: the sky, irradiance and specular cubes in use, and
+	// a second set the next bake is uploaded into, a
+	// subresource at a time, before the two swap
+	enum ProceduralTexture
+	{
+		PROCEDURAL_SKY,
+		PROCEDURAL_IRRADIANCE,
+		PROCEDURAL_SPECULAR,
+		PROCEDURAL_TEXTURE_COUNT
+	};
+	std::unique_ptr<ProceduralSkyBaker> proceduralSky;
+	ProceduralSkySettings proceduralSettings;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> proceduralTextures[PROCEDURAL_TEXTURE_COUNT];
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> proceduralBackTextures[PROCEDURAL_TEXTURE_COUNT];
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> proceduralBackSRVs[PROCEDURAL_TEXTURE_COUNT];
+	bool proceduralUploading = false;
+	unsigned int proceduralUploadNext = 0;
+	bool CreateProceduralTextures(bool initialize, Microsoft::WRL::ComPtr<ID3D11Texture2D> textures[], Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srvs[]);
+	void UploadProceduralSubresource(unsigned int index);
 
 	std::shared_ptr<Mesh> skyMesh;
 
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Cubemap.h"
+
+// --------------------------------------------------------
+// The pre-filtered environment half of the split sum
+// approximation: for each mip of a cube, the sky convolved
+// with the GGX lobe of a roughness from 0 (the top mip) to
+// 1 (the last), with N = V = R as IBLSpecularConvolutionPS
+// assumes.
+//
+// The shader takes thousands of samples of the full size
+// sky per texel.  This uses filtered importance sampling
+// (Krivanek and Colbert, "Real-time Shading with Filtered
+// Importance Sampling") instead: each sample reads a mip
+// of the source whose texels cover about the solid angle
+// that sample stands for, so 32-128 samples are as smooth
+// as thousands of point samples.
+// --------------------------------------------------------
+
+// Fills output with mipLevels mips from size x size down.
+// The source's top level should be around twice size, and
+// its mips should go down to 1x1 (see DecodeCubemap()).
+// Work is split into tiles of every face of every mip and
+// spread across threads (0 for every hardware thread); the
+// result is the same for any thread count.  False if
+// either cube is empty.
+bool PrefilterSpecularCubemap(const LinearCubemap& source, unsigned int size, unsigned int mipLevels, unsigned int sampleCount, LinearCubemap& output, unsigned int threadCount = 0);
+
+// The roughness a mip of the pre-filtered cube is made for
+float GetSpecularMipRoughness(unsigned int mip, unsigned int mipLevels);
+
+// --------------------------------------------------------
+// One sample of a mip's lobe.  With N = V, L depends only
+// on the half vector, so every texel of a mip shares them
+// in tangent space.
+// --------------------------------------------------------
+struct SpecularLobeSample
+{
+	float L[3];			// Tangent space light direction
+	float NDotL;		// Its weight
+	float SourceMip;	// Where its footprint matches the source's texels
+};
+
+// The samples PrefilterSpecularCubemap() takes for each of
+// mipLevels mips, from a source sourceSize texels across.
+// They depend only on the sizes, so callers filtering a
+// piece at a time can build them once.
+void BuildSpecularLobes(unsigned int sourceSize, unsigned int mipLevels, unsigned int sampleCount, std::vector<std::vector<SpecularLobeSample>>& lobes);
+
+// Filters rows firstRow to endRow of one face of a size x
+// size mip with that mip's lobe, as PrefilterSpecularCubemap()
+// would, into output (3 floats per texel, starting at
+// firstRow).  For spreading the work over frames (see
+// ProceduralSky.h).
+void PrefilterSpecularRows(const LinearCubemap& source, const std::vector<SpecularLobeSample>& lobe, unsigned int face, unsigned int size, unsigned int firstRow, unsigned int endRow, float* output);
+
+// Linear pre-filtered color for one direction, sampled
+// exactly as IBLSpecularConvolutionPS does, to check the
+// filtered version against (at the shader's 4096 samples)
+void CalculateSpecularReference(const CubemapPixels& cube, float roughness, const float direction[3], unsigned int sampleCount, float rgb[3]);
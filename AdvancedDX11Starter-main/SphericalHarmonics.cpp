@@ -0,0 +1,297 @@
+#include "SphericalHarmonics.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <math.h>
+
+// Faces are filtered down to at most this many texels
+// across before projecting; the 3 bands can't see finer
+// detail than that anyway
+static const unsigned int MaxProjectedSize = 64;
+
+// Filtered rows each work item projects
+static const unsigned int BandRows = 4;
+
+static const float Gamma = 2.2f;
+static const float Pi = 3.14159265f;
+
+// Cosine lobe convolution per band, over pi: 1, 2/3, 1/4
+static const float IrradianceBandScale[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+
+// --------------------------------------------------------
+// The 9 basis functions for a unit direction
+// --------------------------------------------------------
+static void EvaluateBasis(const float d[3], float basis[9])
+{
+	float x = d[0], y = d[1], z = d[2];
+	basis[0] = 0.282095f;
+	basis[1] = 0.488603f * y;
+	basis[2] = 0.488603f * z;
+	basis[3] = 0.488603f * x;
+	basis[4] = 1.092548f * x * y;
+	basis[5] = 1.092548f * y * z;
+	basis[6] = 0.315392f * (3.0f * z * z - 1.0f);
+	basis[7] = 1.092548f * x * z;
+	basis[8] = 0.546274f * (x * x - y * y);
+}
+
+static void Normalize(float d[3])
+{
+	float scale = 1.0f / sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	d[0] *= scale;
+	d[1] *= scale;
+	d[2] *= scale;
+}
+
+// Solid angle from a face's center to the point (a, b) of
+// the face, in -1 to 1 coordinates
+static double AreaElement(double a, double b)
+{
+	return atan2(a * b, sqrt(a * a + b * b + 1.0));
+}
+
+bool ProjectCubemapSH9(const CubemapPixels& cube, SH9Color& sh, unsigned int threadCount)
+{
+	sh = SH9Color();
+	if (cube.Size == 0)
+		return false;
+	for (const unsigned char* face : cube.Faces)
+	{
+		if (!face)
+			return false;
+	}
+
+	float linear[256];
+	BuildCubemapViewTable(cube.SRGB, linear);
+	for (float& value : linear)
+		value = powf(value, Gamma);
+
+	// Each filtered texel averages a block of block x block
+	// texels, short at the far edges if the size doesn't divide
+	unsigned int block = (std::max)(1u, cube.Size / MaxProjectedSize);
+	unsigned int cells = (cube.Size + block - 1) / block;
+	unsigned int bandsPerFace = (cells + BandRows - 1) / BandRows;
+	unsigned int itemCount = bandsPerFace * 6;
+	int red = cube.BGRA ? 2 : 0;
+	int blue = cube.BGRA ? 0 : 2;
+
+	// Solid angle and direction of every filtered texel, the
+	// same on each face but for the direction's orientation
+	std::vector<float> solidAngles((size_t)cells * cells);
+	for (unsigned int cy = 0; cy < cells; cy++)
+	{
+		double b0 = 2.0 * (cy * block) / cube.Size - 1.0;
+		double b1 = 2.0 * (std::min)((cy + 1) * block, cube.Size) / cube.Size - 1.0;
+		for (unsigned int cx = 0; cx < cells; cx++)
+		{
+			double a0 = 2.0 * (cx * block) / cube.Size - 1.0;
+			double a1 = 2.0 * (std::min)((cx + 1) * block, cube.Size) / cube.Size - 1.0;
+			solidAngles[(size_t)cy * cells + cx] = (float)(
+				AreaElement(a1, b1) - AreaElement(a0, b1) - AreaElement(a1, b0) + AreaElement(a0, b0));
+		}
+	}
+
+	std::vector<double> itemSums((size_t)itemCount * 27);
+	ParallelFor(itemCount, threadCount, [&](unsigned int item)
+	{
+		std::vector<float> rowSums((size_t)cells * 3);
+		unsigned int face = item / bandsPerFace;
+		unsigned int firstCell = (item % bandsPerFace) * BandRows;
+		unsigned int endCell = (std::min)(firstCell + BandRows, cells);
+		double sums[27] = {};
+
+		for (unsigned int cy = firstCell; cy < endCell; cy++)
+		{
+			// Linear color summed over each block of this row
+			unsigned int firstRow = cy * block;
+			unsigned int endRow = (std::min)(firstRow + block, cube.Size);
+			std::fill(rowSums.begin(), rowSums.end(), 0.0f);
+			for (unsigned int y = firstRow; y < endRow; y++)
+			{
+				const unsigned char* texel = cube.Faces[face] + y * cube.RowPitch;
+				for (unsigned int cx = 0; cx < cells; cx++)
+				{
+					unsigned int width = (std::min)(block, cube.Size - cx * block);
+					// Two texels at a time into separate sums, so the
+					// adds don't all wait on each other
+					float r[2] = {}, g[2] = {}, b[2] = {};
+					unsigned int x = 0;
+					for (; x + 1 < width; x += 2, texel += 8)
+					{
+						r[0] += linear[texel[red]];
+						g[0] += linear[texel[1]];
+						b[0] += linear[texel[blue]];
+						r[1] += linear[texel[4 + red]];
+						g[1] += linear[texel[5]];
+						b[1] += linear[texel[4 + blue]];
+					}
+					if (x < width)
+					{
+						r[0] += linear[texel[red]];
+						g[0] += linear[texel[1]];
+						b[0] += linear[texel[blue]];
+						texel += 4;
+					}
+					rowSums[cx * 3 + 0] += r[0] + r[1];
+					rowSums[cx * 3 + 1] += g[0] + g[1];
+					rowSums[cx * 3 + 2] += b[0] + b[1];
+				}
+			}
+
+			// Then each block's average weighted by its solid angle
+			for (unsigned int cx = 0; cx < cells; cx++)
+			{
+				unsigned int firstColumn = cx * block;
+				unsigned int endColumn = (std::min)(firstColumn + block, cube.Size);
+				float weight = solidAngles[(size_t)cy * cells + cx] / ((endColumn - firstColumn) * (endRow - firstRow));
+
+				float direction[3], basis[9];
+				GetCubemapDirection(face,
+					(firstColumn + endColumn) * 0.5f / cube.Size,
+					(firstRow + endRow) * 0.5f / cube.Size,
+					direction);
+				Normalize(direction);
+				EvaluateBasis(direction, basis);
+
+				const float* color = &rowSums[cx * 3];
+				for (int i = 0; i < 9; i++)
+				{
+					float scale = basis[i] * weight;
+					sums[i * 3 + 0] += color[0] * scale;
+					sums[i * 3 + 1] += color[1] * scale;
+					sums[i * 3 + 2] += color[2] * scale;
+				}
+			}
+		}
+		std::copy(sums, sums + 27, &itemSums[(size_t)item * 27]);
+	});
+
+	// Summed in item order so threads can't change the result
+	double total[27] = {};
+	for (unsigned int item = 0; item < itemCount; item++)
+	{
+		for (int i = 0; i < 27; i++)
+			total[i] += itemSums[(size_t)item * 27 + i];
+	}
+	for (int i = 0; i < 9; i++)
+	{
+		for (int c = 0; c < 3; c++)
+			sh.Coefficients[i][c] = (float)total[i * 3 + c];
+	}
+	return true;
+}
+
+void AccumulateSH9Rows(const LinearCubemapLevel& level, unsigned int face, unsigned int firstRow, unsigned int endRow, SH9Color& sh)
+{
+	double step = 2.0 / level.Size;
+	for (unsigned int y = firstRow; y < endRow; y++)
+	{
+		double b0 = y * step - 1.0;
+		double b1 = b0 + step;
+		const float* color = &level.Faces[face][(size_t)y * level.Size * 3];
+		for (unsigned int x = 0; x < level.Size; x++, color += 3)
+		{
+			double a0 = x * step - 1.0;
+			double a1 = a0 + step;
+			float weight = (float)(AreaElement(a1, b1) - AreaElement(a0, b1) - AreaElement(a1, b0) + AreaElement(a0, b0));
+
+			float direction[3], basis[9];
+			GetCubemapDirection(face, (x + 0.5f) / level.Size, (y + 0.5f) / level.Size, direction);
+			Normalize(direction);
+			EvaluateBasis(direction, basis);
+			for (int i = 0; i < 9; i++)
+			{
+				float scale = basis[i] * weight;
+				sh.Coefficients[i][0] += color[0] * scale;
+				sh.Coefficients[i][1] += color[1] * scale;
+				sh.Coefficients[i][2] += color[2] * scale;
+			}
+		}
+	}
+}
+
+void ConvolveIrradianceSH9(SH9Color& sh)
+{
+	for (int i = 0; i < 9; i++)
+	{
+		float scale = IrradianceBandScale[i == 0 ? 0 : i < 4 ? 1 : 2];
+		for (int c = 0; c < 3; c++)
+			sh.Coefficients[i][c] *= scale;
+	}
+}
+
+void EvaluateSH9(const SH9Color& sh, const float direction[3], float rgb[3])
+{
+	float d[3] = { direction[0], direction[1], direction[2] };
+	Normalize(d);
+
+	float basis[9];
+	EvaluateBasis(d, basis);
+	rgb[0] = rgb[1] = rgb[2] = 0.0f;
+	for (int i = 0; i < 9; i++)
+	{
+		for (int c = 0; c < 3; c++)
+			rgb[c] += sh.Coefficients[i][c] * basis[i];
+	}
+}
+
+void CreateIrradianceCubeSH9(const SH9Color& irradiance, unsigned int size, LinearCubemapLevel& level)
+{
+	level.Size = size;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		level.Faces[face].resize((size_t)size * size * 3);
+		float* rgb = level.Faces[face].data();
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++, rgb += 3)
+			{
+				float direction[3];
+				GetCubemapDirection(face, (x + 0.5f) / size, (y + 0.5f) / size, direction);
+				EvaluateSH9(irradiance, direction, rgb);
+			}
+		}
+	}
+}
+
+void CalculateIrradianceReference(const CubemapPixels& cube, const float direction[3], float rgb[3])
+{
+	float table[256];
+	BuildCubemapViewTable(cube.SRGB, table);
+
+	// Same tangent basis and loops as the shader
+	float zDir[3] = { direction[0], direction[1], direction[2] };
+	Normalize(zDir);
+	float xDir[3] = { zDir[2], 0.0f, -zDir[0] };
+	Normalize(xDir);
+	float yDir[3] = {
+		zDir[1] * xDir[2] - zDir[2] * xDir[1],
+		zDir[2] * xDir[0] - zDir[0] * xDir[2],
+		zDir[0] * xDir[1] - zDir[1] * xDir[0] };
+	Normalize(yDir);
+
+	const float step = 0.025f;
+	double total[3] = {};
+	int sampleCount = 0;
+	for (float phi = 0.0f; phi < 2.0f * Pi; phi += step)
+	{
+		float sinP = sinf(phi), cosP = cosf(phi);
+		for (float theta = 0.0f; theta < Pi * 0.5f; theta += step)
+		{
+			float sinT = sinf(theta), cosT = cosf(theta);
+			float local[3] = { sinT * cosP, sinT * sinP, cosT };
+			float sampleDirection[3];
+			for (int i = 0; i < 3; i++)
+				sampleDirection[i] = local[0] * xDir[i] + local[1] * yDir[i] + local[2] * zDir[i];
+
+			float sample[3];
+			SampleCubemapPixels(cube, table, sampleDirection, sample);
+			for (int c = 0; c < 3; c++)
+				total[c] += cosT * sinT * powf(sample[c], Gamma);
+			sampleCount++;
+		}
+	}
+
+	for (int c = 0; c < 3; c++)
+		rgb[c] = (float)(Pi * total[c] / sampleCount);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Cubemap.h"
+
+#include <vector>
+
+// --------------------------------------------------------
+// An RGB function over the sphere as the 9 coefficients of
+// the first 3 bands of real spherical harmonics
+// --------------------------------------------------------
+struct SH9Color
+{
+	float Coefficients[9][3] = {};
+};
+
+// --------------------------------------------------------
+// Diffuse irradiance from a cube map, in place of looping
+// over the hemisphere for every texel of the irradiance
+// cube.  Irradiance is so smooth that 9 coefficients hold
+// it to within a few percent for any lighting (Ramamoorthi
+// and Hanrahan, "An Efficient Representation for Irradiance
+// Environment Maps").
+//
+// Each face is box filtered to at most 64x64 in linear
+// space, then every filtered texel is projected weighted by
+// its exact solid angle.  Faces are split into bands spread
+// over threads and summed in a fixed order, so the result
+// is identical for any thread count.
+// --------------------------------------------------------
+
+// Projects the (linear) radiance of a cube map.  False if
+// the cube is empty.  0 threads uses every hardware thread.
+bool ProjectCubemapSH9(const CubemapPixels& cube, SH9Color& sh, unsigned int threadCount = 0);
+
+// Adds the projection of rows firstRow to endRow of one face
+// of a linear level to sh, each texel weighted by its exact
+// solid angle.  Every row of every face adds up to the whole
+// level's projection; piece by piece, it can be spread over
+// frames (see ProceduralSky.h).
+void AccumulateSH9Rows(const LinearCubemapLevel& level, unsigned int face, unsigned int firstRow, unsigned int endRow, SH9Color& sh);
+
+// Turns projected radiance into the irradiance over pi it
+// gives a surface facing each direction - what a white
+// Lambertian surface reflects, as the irradiance map holds
+void ConvolveIrradianceSH9(SH9Color& sh);
+
+void EvaluateSH9(const SH9Color& sh, const float direction[3], float rgb[3]);
+
+// Evaluates irradiance at every texel of a size x size cube
+// as linear RGB, what IBLIrradianceMapPS renders
+void CreateIrradianceCubeSH9(const SH9Color& irradiance, unsigned int size, LinearCubemapLevel& level);
+
+// Brute force irradiance for one direction, sampled exactly
+// as IBLIrradianceMapPS does (about 16k bilinear samples),
+// to check the SH version against
+void CalculateIrradianceReference(const CubemapPixels& cube, const float direction[3], float rgb[3]);
@@ -0,0 +1,117 @@
+#include "TestHarness.h"
+#include "../BRDFLookUp.h"
+
+#include <algorithm>
+#include <math.h>
+
+// --------------------------------------------------------
+// The split sum BRDF table: the SIMD table against the
+// scalar integration, its sampling error, known limits,
+// and the same table for any thread count
+// --------------------------------------------------------
+
+static float TableValue(const std::vector<uint16_t>& table, unsigned int size, unsigned int x, unsigned int y, int channel)
+{
+	return table[((size_t)y * size + x) * 2 + channel] / 65535.0f;
+}
+
+TEST(BRDFLookUp, EmptyTables)
+{
+	std::vector<uint16_t> table(5, 1);
+	GenerateBRDFLookUp(0, 1024, table);
+	CHECK(table.empty());
+
+	GenerateBRDFLookUp(4, 0, table);
+	CHECK(table.size() == 4 * 4 * 2);
+}
+
+TEST(BRDFLookUp, MatchesTheScalarIntegration)
+{
+	// Same sample count, so only float rounding differs -
+	// including counts the SIMD loop has to pad
+	const unsigned int size = 16;
+	const unsigned int sampleCounts[] = { 1024, 1023 };
+	for (unsigned int sampleCount : sampleCounts)
+	{
+		std::vector<uint16_t> table;
+		GenerateBRDFLookUp(size, sampleCount, table);
+		REQUIRE(table.size() == size * size * 2);
+
+		float maxError = 0;
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				float scale, bias;
+				IntegrateEnvironmentBRDF((y + 0.5f) / size, (x + 0.5f) / size, sampleCount, scale, bias);
+				maxError = (std::max)(maxError, fabsf(TableValue(table, size, x, y, 0) - scale));
+				maxError = (std::max)(maxError, fabsf(TableValue(table, size, x, y, 1) - bias));
+			}
+		}
+		CHECK(maxError < 1e-4f);
+	}
+}
+
+TEST(BRDFLookUp, SamplingErrorIsSmall)
+{
+	// 4096 Hammersley points against 64 times as many
+	const unsigned int size = 8, sampleCount = 4096;
+	std::vector<uint16_t> table;
+	GenerateBRDFLookUp(size, sampleCount, table);
+
+	float maxError = 0, totalError = 0;
+	for (unsigned int y = 0; y < size; y++)
+	{
+		for (unsigned int x = 0; x < size; x++)
+		{
+			float scale, bias;
+			IntegrateEnvironmentBRDF((y + 0.5f) / size, (x + 0.5f) / size, sampleCount * 64, scale, bias);
+			float error = (std::max)(fabsf(TableValue(table, size, x, y, 0) - scale), fabsf(TableValue(table, size, x, y, 1) - bias));
+			maxError = (std::max)(maxError, error);
+			totalError += error;
+		}
+	}
+	CHECK(maxError < 0.02f);
+	CHECK(totalError / (size * size) < 0.002f);
+}
+
+TEST(BRDFLookUp, KnownLimits)
+{
+	// Scale + bias (the reflectance for F0 = 1) never exceeds
+	// 1, and near smooth, head on surfaces it nearly reaches it
+	// with almost all of it in the scale
+	const unsigned int size = 32;
+	std::vector<uint16_t> table;
+	GenerateBRDFLookUp(size, 1024, table);
+
+	bool bounded = true;
+	for (unsigned int y = 0; y < size; y++)
+	{
+		for (unsigned int x = 0; x < size; x++)
+			bounded = bounded && TableValue(table, size, x, y, 0) + TableValue(table, size, x, y, 1) <= 1.001f;
+	}
+	CHECK(bounded);
+
+	float smoothScale = TableValue(table, size, size - 1, 0, 0);
+	float smoothBias = TableValue(table, size, size - 1, 0, 1);
+	CHECK(smoothScale + smoothBias > 0.95f);
+	CHECK(smoothBias < 0.01f);
+
+	// Rougher loses more to masking and shadowing
+	CHECK(TableValue(table, size, size / 2, size - 1, 0) < TableValue(table, size, size / 2, 0, 0));
+}
+
+TEST(BRDFLookUp, SameTableForAnyThreadCount)
+{
+	const unsigned int size = 48, sampleCount = 256;
+	std::vector<uint16_t> single;
+	GenerateBRDFLookUp(size, sampleCount, single, 1);
+
+	unsigned int threadCounts[] = { 0, 3, 100 };
+	for (unsigned int threads : threadCounts)
+	{
+		std::vector<uint16_t> parallel;
+		GenerateBRDFLookUp(size, sampleCount, parallel, threads);
+		CHECK(parallel == single);
+	}
+}
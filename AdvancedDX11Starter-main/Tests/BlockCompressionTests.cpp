@@ -0,0 +1,75 @@
+#include "TestHarness.h"
+#include "../BlockCompression.h"
+
+#include <math.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// Block compression round trips, and the same output for
+// any thread count
+// --------------------------------------------------------
+
+// Smooth gradients with a little noise, like a material texture
+static std::vector<unsigned char> MakeTestImage(unsigned int width, unsigned int height)
+{
+	std::vector<unsigned char> rgba((size_t)width * height * 4);
+	unsigned int noise = 12345;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			noise = noise * 1664525u + 1013904223u;
+			unsigned char* p = &rgba[((size_t)y * width + x) * 4];
+			p[0] = (unsigned char)(x * 255 / width);
+			p[1] = (unsigned char)(y * 255 / height);
+			p[2] = (unsigned char)(128 + 100 * sinf(x * 0.05f + y * 0.03f) + (noise >> 29));
+			p[3] = 255;
+		}
+	}
+	return rgba;
+}
+
+TEST(BlockCompression, RoundTripsEveryFormat)
+{
+	const unsigned int width = 64, height = 48;
+	std::vector<unsigned char> image = MakeTestImage(width, height);
+
+	BlockFormat formats[] = { BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC4, BLOCK_FORMAT_BC5, BLOCK_FORMAT_BC7 };
+	for (BlockFormat format : formats)
+	{
+		std::vector<unsigned char> blocks(GetCompressedSize(format, width, height));
+		CompressBlocks(image.data(), width, height, format, BLOCK_QUALITY_NORMAL, blocks.data());
+
+		std::vector<unsigned char> decoded(image.size());
+		DecompressBlocks(blocks.data(), width, height, format, decoded.data());
+
+		double psnr = CalculatePSNR(image.data(), decoded.data(), width, height, GetBlockChannels(format));
+		CHECK(psnr > 30.0);
+	}
+}
+
+TEST(BlockCompression, SameOutputForAnyThreadCount)
+{
+	// Odd sizes leave partial blocks along two edges
+	const unsigned int width = 70, height = 133;
+	std::vector<unsigned char> image = MakeTestImage(width, height);
+	size_t size = GetCompressedSize(BLOCK_FORMAT_BC7, width, height);
+	CHECK(size == 18 * 34 * 16);
+
+	std::vector<unsigned char> single(size);
+	CompressBlocks(image.data(), width, height, BLOCK_FORMAT_BC7, BLOCK_QUALITY_FAST, single.data(), 1);
+
+	unsigned int threadCounts[] = { 0, 2, 3, 64 };
+	for (unsigned int threads : threadCounts)
+	{
+		std::vector<unsigned char> parallel(size);
+		CompressBlocks(image.data(), width, height, BLOCK_FORMAT_BC7, BLOCK_QUALITY_FAST, parallel.data(), threads);
+		CHECK(memcmp(single.data(), parallel.data(), size) == 0);
+	}
+}
+
+TEST(BlockCompression, IdenticalImagesScore100)
+{
+	std::vector<unsigned char> image = MakeTestImage(16, 16);
+	CHECK(CalculatePSNR(image.data(), image.data(), 16, 16, 4) == 100.0);
+}
@@ -0,0 +1,188 @@
+#include "TestHarness.h"
+#include "../Clock.h"
+
+#include <math.h>
+
+// --------------------------------------------------------
+// FixedTimestep, driven the way DXCore::Run() drives it:
+// advance by a frame's time, run every pending step, then
+// render at the interpolation alpha.  Tick rates are powers
+// of two so step times add up exactly.
+// --------------------------------------------------------
+
+// Runs every pending step, returning how many there were
+static unsigned int RunSteps(FixedTimestep& timestep)
+{
+	unsigned int steps = 0;
+	while (timestep.Step())
+		steps++;
+	return steps;
+}
+
+TEST(Clock, StepsWholeStepsAndCarriesTheRest)
+{
+	FixedTimestep timestep(64.0);
+	CHECK(timestep.GetStepSeconds() == 1.0 / 64.0);
+
+	// Two and a half steps' worth
+	CHECK(timestep.Advance(2.5 / 64.0) == 2);
+	CHECK(RunSteps(timestep) == 2);
+	CHECK(timestep.GetSimulationTime() == 2.0 / 64.0);
+	CHECK(timestep.GetStepCount() == 2);
+
+	// The leftover half pays for part of the next step
+	CHECK(timestep.Advance(0.25 / 64.0) == 0);
+	CHECK(!timestep.Step());
+	CHECK(timestep.Advance(0.25 / 64.0) == 1);
+	CHECK(RunSteps(timestep) == 1);
+	CHECK(timestep.GetSimulationTime() == 3.0 / 64.0);
+	CHECK(timestep.GetDroppedSteps() == 0);
+}
+
+TEST(Clock, IgnoresNegativeAndZeroFrames)
+{
+	FixedTimestep timestep(64.0);
+	CHECK(timestep.Advance(0.0) == 0);
+	CHECK(timestep.Advance(-1.0) == 0);
+	CHECK(timestep.GetAlpha() == 0.0);
+	CHECK(timestep.Advance(1.0 / 64.0) == 1);
+}
+
+TEST(Clock, MatchesTheStepsOfManySmallFrames)
+{
+	// 1000 frames at a third of a step each
+	FixedTimestep timestep(64.0);
+	unsigned int steps = 0;
+	for (int i = 0; i < 1000; i++)
+	{
+		timestep.Advance(1.0 / 192.0);
+		steps += RunSteps(timestep);
+	}
+
+	// Rounding may leave the last step a hair short
+	CHECK(steps == 333 || steps == 332);
+	CHECK(timestep.GetStepCount() == steps);
+	CHECK(timestep.GetSimulationTime() == steps / 64.0);
+}
+
+TEST(Clock, ClampsCatchUpAfterAHitch)
+{
+	FixedTimestep timestep(64.0, 8);
+
+	// A one second hitch pays for 64 steps, but only 8 run
+	// and the rest (remainder included) are dropped
+	CHECK(timestep.Advance(1.0 + 0.5 / 64.0) == 8);
+	CHECK(timestep.GetDroppedSteps() == 56);
+	CHECK(timestep.GetAlpha() == 0.0);
+	CHECK(RunSteps(timestep) == 8);
+	CHECK(timestep.GetSimulationTime() == 8.0 / 64.0);
+
+	// The next normal frame starts clean
+	CHECK(timestep.Advance(1.0 / 64.0) == 1);
+	CHECK(RunSteps(timestep) == 1);
+	CHECK(timestep.GetDroppedSteps() == 56);
+}
+
+TEST(Clock, ClampsStepsLeftPendingAcrossFrames)
+{
+	// Steps not run yet still count against the limit
+	FixedTimestep timestep(64.0, 4);
+	CHECK(timestep.Advance(3.0 / 64.0) == 3);
+	CHECK(timestep.Advance(3.0 / 64.0) == 4);
+	CHECK(timestep.GetDroppedSteps() == 2);
+	CHECK(RunSteps(timestep) == 4);
+
+	timestep.SetMaxStepsPerFrame(16);
+	CHECK(timestep.Advance(10.0 / 64.0) == 10);
+	CHECK(timestep.GetDroppedSteps() == 2);
+}
+
+TEST(Clock, AlphaIsTheFractionOfAStepLeftOver)
+{
+	FixedTimestep timestep(64.0);
+	timestep.Advance(0.25 / 64.0);
+	CHECK(timestep.GetAlpha() == 0.25);
+
+	timestep.Advance(1.5 / 64.0);
+	CHECK(RunSteps(timestep) == 1);
+	CHECK(timestep.GetAlpha() == 0.75);
+
+	// Render time sits between the last two states: one step
+	// behind the latest, plus the leftover
+	CHECK(timestep.GetSimulationTime() == 1.0 / 64.0);
+	CHECK(timestep.GetInterpolatedTime() == 0.75 / 64.0);
+
+	timestep.Advance(0.25 / 64.0);
+	CHECK(RunSteps(timestep) == 1);
+	CHECK(timestep.GetAlpha() == 0.0);
+	CHECK(timestep.GetInterpolatedTime() == 1.0 / 64.0);
+}
+
+TEST(Clock, AlphaStaysInRange)
+{
+	FixedTimestep timestep(60.0);
+	unsigned int noise = 12345;
+	for (int i = 0; i < 10000; i++)
+	{
+		noise = noise * 1664525 + 1013904223;
+		timestep.Advance((noise >> 16) % 1000 / 20000.0);
+		RunSteps(timestep);
+
+		double alpha = timestep.GetAlpha();
+		if (alpha < 0.0 || alpha >= 1.0)
+		{
+			CHECK(alpha >= 0.0 && alpha < 1.0);
+			break;
+		}
+	}
+	CHECK(timestep.GetInterpolatedTime() >= 0.0);
+}
+
+TEST(Clock, ChangesRateMidRun)
+{
+	FixedTimestep timestep(64.0);
+	timestep.Advance(0.5 / 64.0);
+
+	// The accumulated time is kept, now worth a whole step
+	timestep.SetTickRate(128.0);
+	CHECK(timestep.GetTickRate() == 128.0);
+	CHECK(timestep.Advance(0.0) == 1);
+
+	// Nonsense rates are ignored
+	timestep.SetTickRate(0.0);
+	timestep.SetTickRate(-60.0);
+	CHECK(timestep.GetTickRate() == 128.0);
+}
+
+TEST(Clock, ResetStartsOver)
+{
+	FixedTimestep timestep(64.0, 2);
+	timestep.Advance(10.5 / 64.0);
+	RunSteps(timestep);
+	timestep.Advance(0.5 / 64.0);
+
+	timestep.Reset();
+	CHECK(timestep.GetSimulationTime() == 0.0);
+	CHECK(timestep.GetStepCount() == 0);
+	CHECK(timestep.GetDroppedSteps() == 0);
+	CHECK(timestep.GetAlpha() == 0.0);
+	CHECK(!timestep.Step());
+	CHECK(timestep.GetInterpolatedTime() == 0.0);
+}
+
+TEST(Clock, TicksForwardFromReset)
+{
+	Clock clock;
+	CHECK(clock.GetTotalSeconds() == 0.0);
+
+	double previousTotal = 0.0;
+	for (int i = 0; i < 100; i++)
+	{
+		CHECK(clock.Tick() >= 0.0);
+		CHECK(clock.GetTotalSeconds() >= previousTotal);
+		previousTotal = clock.GetTotalSeconds();
+	}
+
+	clock.Reset();
+	CHECK(clock.GetTotalSeconds() == 0.0);
+}
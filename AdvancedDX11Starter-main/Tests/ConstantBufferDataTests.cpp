@@ -0,0 +1,106 @@
+#include "TestHarness.h"
+#include "../ConstantBufferData.h"
+
+#include <string.h>
+
+// --------------------------------------------------------
+// ConstantBufferData, the way SimpleShader uses it: writes
+// at variable offsets, then the 16 byte aligned range to
+// upload, then clean again
+// --------------------------------------------------------
+
+TEST(ConstantBufferData, StartsZeroedAndDirty)
+{
+	ConstantBufferData data(64);
+	CHECK(data.GetSize() == 64);
+	CHECK(data.IsDirty());
+	for (unsigned int i = 0; i < data.GetSize(); i++)
+		REQUIRE(data.GetData()[i] == 0);
+
+	unsigned int start = 1;
+	unsigned int end = 0;
+	CHECK(data.GetUploadRange(&start, &end));
+	CHECK(start == 0 && end == 64);
+}
+
+TEST(ConstantBufferData, OnlyMarksChangesDirty)
+{
+	ConstantBufferData data(64);
+	data.MarkClean();
+
+	float zeros[4] = {};
+	CHECK(data.Write(16, zeros, sizeof(zeros)));
+	CHECK(!data.IsDirty());
+
+	float value = 2.0f;
+	CHECK(data.Write(20, &value, sizeof(value)));
+	CHECK(data.IsDirty());
+	CHECK(memcmp(data.GetData() + 20, &value, sizeof(value)) == 0);
+
+	// The same value again changes nothing
+	data.MarkClean();
+	CHECK(data.Write(20, &value, sizeof(value)));
+	CHECK(!data.IsDirty());
+}
+
+TEST(ConstantBufferData, RoundsUploadsToWholeRegisters)
+{
+	ConstantBufferData data(72);
+	data.MarkClean();
+
+	unsigned int start = 0;
+	unsigned int end = 0;
+	CHECK(!data.GetUploadRange(&start, &end));
+
+	int a = 1;
+	int b = 2;
+	data.Write(20, &a, sizeof(a));
+	data.Write(36, &b, sizeof(b));
+	CHECK(data.GetUploadRange(&start, &end));
+	CHECK(start == 16 && end == 48);
+
+	// Never past the end of a buffer that isn't a whole
+	// number of registers
+	data.Write(68, &a, sizeof(a));
+	CHECK(data.GetUploadRange(&start, &end));
+	CHECK(start == 16 && end == 72);
+
+	data.MarkClean();
+	CHECK(!data.GetUploadRange(&start, &end));
+}
+
+TEST(ConstantBufferData, RejectsWritesPastTheEnd)
+{
+	ConstantBufferData data(32);
+	data.MarkClean();
+
+	unsigned char bytes[40];
+	memset(bytes, 0xFF, sizeof(bytes));
+	CHECK(!data.Write(0, bytes, 33));
+	CHECK(!data.Write(29, bytes, 4));
+	CHECK(!data.Write(32, bytes, 1));
+	CHECK(!data.Write(0xFFFFFFF0u, bytes, 32));
+	CHECK(!data.Write(16, bytes, 0xFFFFFFF8u));
+	CHECK(!data.IsDirty());
+
+	CHECK(data.Write(28, bytes, 4));
+	CHECK(data.Write(32, bytes, 0));
+	CHECK(data.IsDirty());
+}
+
+TEST(ConstantBufferData, ResizeStartsOver)
+{
+	ConstantBufferData data(16);
+	int value = 7;
+	data.Write(0, &value, sizeof(value));
+	data.MarkClean();
+
+	data.Resize(48);
+	CHECK(data.GetSize() == 48);
+	CHECK(data.GetData()[0] == 0);
+
+	unsigned int start = 0;
+	unsigned int end = 0;
+	CHECK(data.GetUploadRange(&start, &end));
+	CHECK(start == 0 && end == 48);
+}
@@ -0,0 +1,230 @@
+#include "TestHarness.h"
+#include "TestCube.h"
+
+#include <math.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// Cube map addressing, decoding to linear mips, sampling,
+// and the same decode for any thread count
+// --------------------------------------------------------
+
+static float ToLinear(unsigned char value)
+{
+	return powf(value / 255.0f, 2.2f);
+}
+
+TEST(Cubemap, FaceLookUpInvertsDirections)
+{
+	bool inverted = true;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		const float coordinates[] = { 0.05f, 0.3f, 0.5f, 0.77f, 0.95f };
+		for (float u : coordinates)
+		{
+			for (float v : coordinates)
+			{
+				float direction[3];
+				GetCubemapDirection(face, u, v, direction);
+
+				// Scaling the direction doesn't change where it lands
+				for (float& d : direction)
+					d *= 3.5f;
+
+				unsigned int foundFace;
+				float foundU, foundV;
+				GetCubemapFace(direction, foundFace, foundU, foundV);
+				inverted = inverted && foundFace == face && fabsf(foundU - u) < 1e-5f && fabsf(foundV - v) < 1e-5f;
+			}
+		}
+	}
+	CHECK(inverted);
+}
+
+TEST(Cubemap, ViewTables)
+{
+	float unorm[256], srgb[256];
+	BuildCubemapViewTable(false, unorm);
+	BuildCubemapViewTable(true, srgb);
+	CHECK(unorm[0] == 0.0f && unorm[255] == 1.0f);
+	CHECK(fabsf(unorm[128] - 128 / 255.0f) < 1e-7f);
+	CHECK(srgb[0] == 0.0f && fabsf(srgb[255] - 1.0f) < 1e-6f);
+	CHECK(fabsf(srgb[188] - 0.5029f) < 1e-3f);
+}
+
+TEST(Cubemap, RejectsEmptyCubes)
+{
+	LinearCubemap linear;
+	CubemapPixels empty;
+	CHECK(!DecodeCubemap(empty, 16, linear));
+
+	TestCube cube(4);
+	CHECK(!DecodeCubemap(cube.Pixels, 0, linear));
+	cube.Pixels.Faces[5] = nullptr;
+	CHECK(!DecodeCubemap(cube.Pixels, 16, linear));
+	CHECK(linear.Mips.empty());
+}
+
+TEST(Cubemap, DecodesEveryMip)
+{
+	TestCube cube = MakeGradientCube(16);
+	LinearCubemap linear;
+	REQUIRE(DecodeCubemap(cube.Pixels, 64, linear));
+
+	// 16 down to 1, never bigger than the source
+	REQUIRE(linear.Mips.size() == 5);
+	for (size_t mip = 0; mip < linear.Mips.size(); mip++)
+	{
+		CHECK(linear.Mips[mip].Size == 16u >> mip);
+		for (const std::vector<float>& face : linear.Mips[mip].Faces)
+			CHECK(face.size() == (size_t)linear.Mips[mip].Size * linear.Mips[mip].Size * 3);
+	}
+
+	// The top level is each texel made linear
+	bool linearTop = true;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (unsigned int i = 0; i < 16 * 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+				linearTop = linearTop && fabsf(linear.Mips[0].Faces[face][i * 3 + c] - ToLinear(cube.Faces[face][i * 4 + c])) < 1e-6f;
+		}
+	}
+	CHECK(linearTop);
+
+	// Each mip averages 2x2 of the one above
+	const LinearCubemapLevel& top = linear.Mips[0];
+	const float* corner = &linear.Mips[1].Faces[2][0];
+	for (int c = 0; c < 3; c++)
+	{
+		float average = (top.Faces[2][c] + top.Faces[2][3 + c] + top.Faces[2][16 * 3 + c] + top.Faces[2][17 * 3 + c]) * 0.25f;
+		CHECK(fabsf(corner[c] - average) < 1e-6f);
+	}
+}
+
+TEST(Cubemap, BoxFiltersToMaxSize)
+{
+	// A 2x2 checker of black and white averages to grey at
+	// half the size, also when the sizes don't divide
+	TestCube cube(12);
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (unsigned int y = 0; y < 12; y++)
+		{
+			for (unsigned int x = 0; x < 12; x++)
+			{
+				unsigned char value = ((x ^ y) & 1) ? 255 : 0;
+				unsigned char* p = cube.Texel(face, x, y);
+				p[0] = p[1] = p[2] = value;
+				p[3] = 255;
+			}
+		}
+	}
+
+	LinearCubemap linear;
+	REQUIRE(DecodeCubemap(cube.Pixels, 6, linear));
+	REQUIRE(linear.Mips[0].Size == 6);
+	bool grey = true;
+	for (float value : linear.Mips[0].Faces[3])
+		grey = grey && fabsf(value - 0.5f) < 1e-6f;
+	CHECK(grey);
+
+	// 12 to 5: blocks of 2 or 3 texels, still within 0-1
+	REQUIRE(DecodeCubemap(cube.Pixels, 5, linear));
+	REQUIRE(linear.Mips[0].Size == 5);
+	bool bounded = true;
+	for (float value : linear.Mips[0].Faces[0])
+		bounded = bounded && value > 0.2f && value < 0.8f;
+	CHECK(bounded);
+}
+
+TEST(Cubemap, ReadsBGRAAndSRGB)
+{
+	TestCube cube = MakeFlatCube(4, 200, 100, 10);
+	LinearCubemap plain;
+	REQUIRE(DecodeCubemap(cube.Pixels, 4, plain));
+	CHECK(fabsf(plain.Mips[0].Faces[0][0] - ToLinear(200)) < 1e-6f);
+	CHECK(fabsf(plain.Mips[0].Faces[0][2] - ToLinear(10)) < 1e-6f);
+
+	TestCube swapped = cube;
+	swapped.Pixels.BGRA = true;
+	LinearCubemap bgra;
+	REQUIRE(DecodeCubemap(swapped.Pixels, 4, bgra));
+	CHECK(bgra.Mips[0].Faces[0][0] == plain.Mips[0].Faces[0][2]);
+	CHECK(bgra.Mips[0].Faces[0][2] == plain.Mips[0].Faces[0][0]);
+
+	// Through an sRGB view, then the shaders' gamma on top
+	swapped.Pixels.BGRA = false;
+	swapped.Pixels.SRGB = true;
+	LinearCubemap srgb;
+	REQUIRE(DecodeCubemap(swapped.Pixels, 4, srgb));
+	float table[256];
+	BuildCubemapViewTable(true, table);
+	CHECK(fabsf(srgb.Mips[0].Faces[0][0] - powf(table[200], 2.2f)) < 1e-6f);
+}
+
+TEST(Cubemap, SamplesTexelCenters)
+{
+	TestCube cube = MakeGradientCube(8);
+	LinearCubemap linear;
+	REQUIRE(DecodeCubemap(cube.Pixels, 8, linear));
+	float table[256];
+	BuildCubemapViewTable(false, table);
+
+	bool matches = true;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (unsigned int y = 0; y < 8; y++)
+		{
+			for (unsigned int x = 0; x < 8; x++)
+			{
+				float direction[3], pixels[3], level[3], trilinear[3];
+				GetCubemapDirection(face, (x + 0.5f) / 8, (y + 0.5f) / 8, direction);
+				SampleCubemapPixels(cube.Pixels, table, direction, pixels);
+				SampleCubemapLevel(linear.Mips[0], direction, level);
+				SampleCubemapTrilinear(linear, direction, 0.0f, trilinear);
+
+				const unsigned char* texel = cube.Texel(face, x, y);
+				for (int c = 0; c < 3; c++)
+				{
+					matches = matches && fabsf(pixels[c] - texel[c] / 255.0f) < 1e-5f;
+					matches = matches && fabsf(level[c] - ToLinear(texel[c])) < 1e-5f;
+					matches = matches && level[c] == trilinear[c];
+				}
+			}
+		}
+	}
+	CHECK(matches);
+
+	// Past the last mip clamps to it; between blends
+	float direction[3] = { 0.2f, 0.9f, -0.3f }, last[3], past[3], between[3], mip1[3], mip2[3];
+	SampleCubemapLevel(linear.Mips.back(), direction, last);
+	SampleCubemapTrilinear(linear, direction, 10.0f, past);
+	CHECK(memcmp(last, past, sizeof(last)) == 0);
+
+	SampleCubemapLevel(linear.Mips[1], direction, mip1);
+	SampleCubemapLevel(linear.Mips[2], direction, mip2);
+	SampleCubemapTrilinear(linear, direction, 1.25f, between);
+	for (int c = 0; c < 3; c++)
+		CHECK(fabsf(between[c] - (mip1[c] * 0.75f + mip2[c] * 0.25f)) < 1e-6f);
+}
+
+TEST(Cubemap, SameDecodeForAnyThreadCount)
+{
+	TestCube cube = MakeGradientCube(100);
+	LinearCubemap single;
+	REQUIRE(DecodeCubemap(cube.Pixels, 48, single, 1));
+
+	unsigned int threadCounts[] = { 0, 3, 1000 };
+	for (unsigned int threads : threadCounts)
+	{
+		LinearCubemap parallel;
+		REQUIRE(DecodeCubemap(cube.Pixels, 48, parallel, threads));
+		REQUIRE(parallel.Mips.size() == single.Mips.size());
+		for (size_t mip = 0; mip < single.Mips.size(); mip++)
+		{
+			for (int face = 0; face < 6; face++)
+				CHECK(parallel.Mips[mip].Faces[face] == single.Mips[mip].Faces[face]);
+		}
+	}
+}
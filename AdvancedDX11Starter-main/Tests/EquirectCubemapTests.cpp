@@ -0,0 +1,191 @@
+#include "TestHarness.h"
+#include "../Cubemap.h"
+#include "../EquirectCubemap.h"
+
+#include <algorithm>
+#include <math.h>
+
+// --------------------------------------------------------
+// Equirect to cube conversion: sizes and layout, against
+// plain float resampling, mips, and the same cube for any
+// thread count
+// --------------------------------------------------------
+
+static HDRImage MakeEquirect(unsigned int width, unsigned int height)
+{
+	HDRImage image;
+	image.Width = width;
+	image.Height = height;
+	image.RGBE.resize((size_t)width * height * 4);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			// Smooth in both directions, brighter than 1 at the top
+			unsigned char* p = &image.RGBE[((size_t)y * width + x) * 4];
+			p[0] = (unsigned char)(64 + 191 * (height - y) / height);
+			p[1] = (unsigned char)(64 + 128 * x / width);
+			p[2] = (unsigned char)(200 - 100 * y / height);
+			p[3] = (unsigned char)(y < height / 4 ? 130 : 128);
+		}
+	}
+	return image;
+}
+
+TEST(EquirectCubemap, CubeSizes)
+{
+	CHECK(GetEquirectCubeSize(2048) == 512);
+	CHECK(GetEquirectCubeSize(3000) == 512);
+	CHECK(GetEquirectCubeSize(4) == 1);
+}
+
+TEST(EquirectCubemap, RejectsBadInput)
+{
+	HDRImage empty;
+	HalfCubemap cube;
+	CHECK(!ConvertEquirectToCubemap(empty, 16, 0, cube));
+
+	HDRImage image = MakeEquirect(64, 32);
+	CHECK(!ConvertEquirectToCubemap(image, 0, 0, cube));
+	CHECK(!ConvertEquirectToCubemap(image, 24, 0, cube));
+	CHECK(cube.Texels.empty());
+}
+
+TEST(EquirectCubemap, SubresourceLayout)
+{
+	HDRImage image = MakeEquirect(64, 32);
+	HalfCubemap cube;
+	REQUIRE(ConvertEquirectToCubemap(image, 16, 0, cube));
+	CHECK(cube.Size == 16);
+	CHECK(cube.MipLevels == 5);
+
+	// Every mip of a face, then the next face
+	size_t offset = 0;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (unsigned int mip = 0; mip < cube.MipLevels; mip++)
+		{
+			CHECK(cube.GetMipSize(mip) == 16u >> mip);
+			CHECK(cube.GetRowPitch(mip) == (size_t)(16u >> mip) * 8);
+			CHECK(cube.GetSubresourceOffset(face, mip) == offset);
+			CHECK(cube.GetSubresource(face, mip) == cube.Texels.data() + offset);
+			offset += (size_t)(16u >> mip) * (16u >> mip) * 4;
+		}
+	}
+	CHECK(cube.Texels.size() == offset);
+
+	// Fewer mips when asked, never more than the chain
+	REQUIRE(ConvertEquirectToCubemap(image, 16, 2, cube));
+	CHECK(cube.MipLevels == 2);
+	REQUIRE(ConvertEquirectToCubemap(image, 16, 9, cube));
+	CHECK(cube.MipLevels == 5);
+}
+
+TEST(EquirectCubemap, DecodesHalves)
+{
+	CHECK(DecodeHalf(0x0000) == 0.0f);
+	CHECK(DecodeHalf(0x3C00) == 1.0f);
+	CHECK(DecodeHalf(0xC000) == -2.0f);
+	CHECK(DecodeHalf(0x7BFF) == 65504.0f);
+	CHECK(DecodeHalf(0x0001) == ldexpf(1.0f, -24));
+	CHECK(isinf(DecodeHalf(0x7C00)));
+	CHECK(isnan(DecodeHalf(0x7E00)));
+}
+
+TEST(EquirectCubemap, FlatSkyIsFlatAtEveryMip)
+{
+	HDRImage image = MakeEquirect(128, 64);
+	for (size_t i = 0; i < image.RGBE.size(); i += 4)
+	{
+		image.RGBE[i + 0] = 200;
+		image.RGBE[i + 1] = 100;
+		image.RGBE[i + 2] = 50;
+		image.RGBE[i + 3] = 129;
+	}
+	float linear[3];
+	DecodeRGBE(&image.RGBE[0], linear);
+
+	HalfCubemap cube;
+	REQUIRE(ConvertEquirectToCubemap(image, 32, 0, cube));
+	bool flat = true;
+	for (size_t i = 0; i < cube.Texels.size(); i += 4)
+	{
+		for (int c = 0; c < 3; c++)
+			flat = flat && fabsf(powf(DecodeHalf(cube.Texels[i + c]), 2.2f) - linear[c]) <= 2e-3f * linear[c];
+		flat = flat && DecodeHalf(cube.Texels[i + 3]) == 1.0f;
+	}
+	CHECK(flat);
+}
+
+TEST(EquirectCubemap, MatchesFloatResampling)
+{
+	// The SIMD path against SampleEquirect(), to the halves'
+	// precision, over every texel of the top mip
+	HDRImage image = MakeEquirect(256, 128);
+	HalfCubemap cube;
+	REQUIRE(ConvertEquirectToCubemap(image, 64, 1, cube));
+
+	float maxError = 0.0f;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		const uint16_t* top = cube.GetSubresource(face, 0);
+		for (unsigned int y = 0; y < 64; y++)
+		{
+			for (unsigned int x = 0; x < 64; x++)
+			{
+				float direction[3], reference[3];
+				GetCubemapDirection(face, (x + 0.5f) / 64, (y + 0.5f) / 64, direction);
+				SampleEquirect(image, direction, reference);
+				for (int c = 0; c < 3; c++)
+				{
+					float converted = powf(DecodeHalf(top[((size_t)y * 64 + x) * 4 + c]), 2.2f);
+					maxError = (std::max)(maxError, fabsf(converted - reference[c]) / (std::max)(reference[c], 1e-3f));
+				}
+			}
+		}
+	}
+	CHECK(maxError < 5e-3f);
+}
+
+TEST(EquirectCubemap, MipsAverageTheTop)
+{
+	// Big enough for mips past the bands'; the 1x1 mip of
+	// each face is the average of its top mip
+	HDRImage image = MakeEquirect(512, 256);
+	HalfCubemap cube;
+	REQUIRE(ConvertEquirectToCubemap(image, 128, 0, cube));
+	REQUIRE(cube.MipLevels == 8);
+
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		const uint16_t* top = cube.GetSubresource(face, 0);
+		double sums[3] = {};
+		for (size_t i = 0; i < (size_t)128 * 128; i++)
+		{
+			for (int c = 0; c < 3; c++)
+				sums[c] += powf(DecodeHalf(top[i * 4 + c]), 2.2f);
+		}
+
+		const uint16_t* last = cube.GetSubresource(face, cube.MipLevels - 1);
+		for (int c = 0; c < 3; c++)
+		{
+			float average = (float)(sums[c] / (128 * 128));
+			CHECK(fabsf(powf(DecodeHalf(last[c]), 2.2f) - average) <= 5e-3f * average);
+		}
+	}
+}
+
+TEST(EquirectCubemap, SameCubeForAnyThreadCount)
+{
+	HDRImage image = MakeEquirect(512, 256);
+	HalfCubemap single;
+	REQUIRE(ConvertEquirectToCubemap(image, 128, 0, single, 1));
+
+	unsigned int threadCounts[] = { 0, 3, 100 };
+	for (unsigned int threads : threadCounts)
+	{
+		HalfCubemap parallel;
+		REQUIRE(ConvertEquirectToCubemap(image, 128, 0, parallel, threads));
+		CHECK(parallel.Texels == single.Texels);
+	}
+}
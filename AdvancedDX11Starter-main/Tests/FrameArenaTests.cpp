@@ -0,0 +1,137 @@
+#include "TestHarness.h"
+#include "../FrameArena.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// The per-frame arena: alignment, the heap fallback when a
+// frame doesn't fit, and what EndFrame() resets.  The arena
+// is a singleton, so each test starts by ending two frames
+// to begin on a freshly reset buffer.
+// --------------------------------------------------------
+
+static FrameArena& StartClean()
+{
+	FrameArena& arena = FrameArena::GetInstance();
+	arena.EndFrame();
+	arena.EndFrame();
+	return arena;
+}
+
+TEST(FrameArena, AlignsAllocations)
+{
+	FrameArena& arena = StartClean();
+
+	// Odd sizes in between, so each alignment has to skip ahead
+	unsigned char* last = 0;
+	size_t lastSize = 0;
+	for (size_t alignment = 1; alignment <= 256; alignment *= 2)
+	{
+		for (size_t size = 1; size < 40; size += 7)
+		{
+			unsigned char* memory = (unsigned char*)arena.Allocate(size, alignment);
+			REQUIRE(memory);
+			CHECK((uintptr_t)memory % alignment == 0);
+			CHECK(!last || memory >= last + lastSize);
+			memset(memory, 0xCD, size);
+			last = memory;
+			lastSize = size;
+		}
+	}
+
+	double* values = arena.AllocateArray<double>(3);
+	CHECK((uintptr_t)values % alignof(double) == 0);
+
+	arena.EndFrame();
+	CHECK(arena.GetLastFrameStats().OverflowAllocations == 0);
+}
+
+TEST(FrameArena, FallsBackToTheHeap)
+{
+	FrameArena& arena = FrameArena::GetInstance();
+	arena.EndFrame();
+	size_t firstCapacity = arena.GetLastFrameStats().Capacity;
+	arena.EndFrame();
+	size_t secondCapacity = arena.GetLastFrameStats().Capacity;
+
+	// Bigger than either buffer
+	size_t big = (firstCapacity > secondCapacity ? firstCapacity : secondCapacity) * 2;
+	REQUIRE(arena.Allocate(16));
+	unsigned char* large = (unsigned char*)arena.Allocate(big, 64);
+	REQUIRE(large);
+	CHECK((uintptr_t)large % 64 == 0);
+	memset(large, 0xAB, big);
+
+	arena.EndFrame();
+	FrameArenaStats overflowed = arena.GetLastFrameStats();
+	CHECK(overflowed.Allocations == 2);
+	CHECK(overflowed.OverflowAllocations == 1);
+	CHECK(overflowed.BytesAllocated >= big + 16);
+
+	// Back to the buffer that overflowed, which grew, so the
+	// same frame fits without the heap
+	arena.EndFrame();
+	REQUIRE(arena.Allocate(16));
+	REQUIRE(arena.Allocate(big, 64));
+	arena.EndFrame();
+	const FrameArenaStats& grown = arena.GetLastFrameStats();
+	CHECK(grown.OverflowAllocations == 0);
+	CHECK(grown.Capacity >= big + 16);
+	CHECK(grown.Capacity > overflowed.Capacity);
+}
+
+TEST(FrameArena, RefusesImpossibleSizes)
+{
+	FrameArena& arena = StartClean();
+	CHECK(arena.Allocate(SIZE_MAX) == 0);
+	CHECK(arena.Allocate(SIZE_MAX - 8, 16) == 0);
+	CHECK(arena.AllocateArray<uint64_t>(SIZE_MAX / 8) == 0);
+
+	// And carries on as normal after
+	void* memory = arena.Allocate(64);
+	CHECK(memory != 0);
+
+	arena.EndFrame();
+	CHECK(arena.GetLastFrameStats().OverflowAllocations == 0);
+}
+
+TEST(FrameArena, EndFrameResets)
+{
+	FrameArena& arena = StartClean();
+	char* first = (char*)arena.Allocate(100);
+	REQUIRE(first);
+	strcpy(first, "still here");
+
+	arena.EndFrame();
+	const FrameArenaStats& stats = arena.GetLastFrameStats();
+	CHECK(stats.Allocations == 1);
+	CHECK(stats.BytesAllocated == 100);
+
+	// The next frame uses the other buffer, so the last
+	// frame's memory is still valid
+	char* second = (char*)arena.Allocate(100);
+	REQUIRE(second);
+	CHECK(second != first);
+	CHECK(strcmp(first, "still here") == 0);
+
+	// The frame after that reuses the first buffer from the
+	// start
+	arena.EndFrame();
+	CHECK(arena.GetLastFrameStats().Allocations == 1);
+	CHECK(arena.Allocate(100) == first);
+}
+
+TEST(FrameArena, FormatsAndBacksVectors)
+{
+	FrameArena& arena = StartClean();
+	CHECK(strcmp(arena.Format("Entity %d", 42), "Entity 42") == 0);
+
+	FrameVector<int> values;
+	for (int i = 0; i < 1000; i++)
+		values.push_back(i);
+	bool inOrder = true;
+	for (int i = 0; i < 1000; i++)
+		inOrder = inOrder && values[i] == i;
+	CHECK(inOrder);
+}
@@ -0,0 +1,256 @@
+#include "TestHarness.h"
+#include "../HDRDecoder.h"
+
+#include <string.h>
+#include <string>
+
+// --------------------------------------------------------
+// The Radiance .hdr decoder: each way a scanline can be
+// stored, and rejection of damaged headers and data
+// --------------------------------------------------------
+
+// A file's bytes: the given header, then the pixel data
+static std::vector<unsigned char> MakeHDR(const std::string& header, const std::vector<unsigned char>& data)
+{
+	std::vector<unsigned char> bytes(header.begin(), header.end());
+	bytes.insert(bytes.end(), data.begin(), data.end());
+	return bytes;
+}
+
+static std::string Header(unsigned int width, unsigned int height)
+{
+	return "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\nEXPOSURE=1.0\n\n-Y " +
+		std::to_string(height) + " +X " + std::to_string(width) + "\n";
+}
+
+// A distinct pixel for each position
+static void Pixel(unsigned int x, unsigned int y, unsigned char rgbe[4])
+{
+	rgbe[0] = (unsigned char)(x * 3 + 1);
+	rgbe[1] = (unsigned char)(y * 5 + 2);
+	rgbe[2] = (unsigned char)(x + y + 3);
+	rgbe[3] = (unsigned char)(128 + x % 4);
+}
+
+static bool Decode(const std::vector<unsigned char>& bytes, HDRImage& image)
+{
+	return DecodeHDR(bytes.data(), bytes.size(), image);
+}
+
+// A width x height image, every row run length encoded: each
+// channel as a literal of half the row, then a run of the rest
+static std::vector<unsigned char> MakeEncodedHDR(unsigned int width, unsigned int height)
+{
+	std::vector<unsigned char> data;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		data.push_back(2);
+		data.push_back(2);
+		data.push_back((unsigned char)(width >> 8));
+		data.push_back((unsigned char)width);
+
+		unsigned int literal = width / 2;
+		for (unsigned int channel = 0; channel < 4; channel++)
+		{
+			data.push_back((unsigned char)literal);
+			for (unsigned int x = 0; x < literal; x++)
+			{
+				unsigned char rgbe[4];
+				Pixel(x, y, rgbe);
+				data.push_back(rgbe[channel]);
+			}
+
+			unsigned char rgbe[4];
+			Pixel(literal, y, rgbe);
+			data.push_back((unsigned char)(128 + width - literal));
+			data.push_back(rgbe[channel]);
+		}
+	}
+	return MakeHDR(Header(width, height), data);
+}
+
+// What MakeEncodedHDR's pixels decode to
+static bool MatchesEncoded(const HDRImage& image, unsigned int width, unsigned int height)
+{
+	if (image.Width != width || image.Height != height || image.RGBE.size() != (size_t)width * height * 4)
+		return false;
+
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			unsigned char rgbe[4];
+			Pixel(x < width / 2 ? x : width / 2, y, rgbe);
+			if (memcmp(&image.RGBE[((size_t)y * width + x) * 4], rgbe, 4) != 0)
+				return false;
+		}
+	}
+	return true;
+}
+
+TEST(HDRDecoder, DecodesFlatRows)
+{
+	// Too narrow to be encoded, so always flat
+	std::vector<unsigned char> data;
+	for (unsigned int y = 0; y < 2; y++)
+	{
+		for (unsigned int x = 0; x < 3; x++)
+		{
+			unsigned char rgbe[4];
+			Pixel(x, y, rgbe);
+			data.insert(data.end(), rgbe, rgbe + 4);
+		}
+	}
+
+	HDRImage image;
+	REQUIRE(Decode(MakeHDR(Header(3, 2), data), image));
+	CHECK(image.Width == 3 && image.Height == 2);
+	CHECK(image.RGBE == data);
+}
+
+TEST(HDRDecoder, DecodesOldStyleRuns)
+{
+	// One pixel, then a repeat of 43, then a repeat of 1 << 8
+	// (consecutive repeats shift their count up a byte)
+	const unsigned int width = 300;
+	std::vector<unsigned char> data = { 10, 20, 30, 130, 1, 1, 1, 43, 1, 1, 1, 1 };
+
+	// And a second row with a repeat between two pixels
+	std::vector<unsigned char> second = { 40, 50, 60, 131, 1, 1, 1, 255, 70, 80, 90, 132 };
+	for (unsigned int x = 257; x < width; x++)
+	{
+		unsigned char rgbe[4] = { (unsigned char)x, 1, 2, 133 };
+		second.insert(second.end(), rgbe, rgbe + 4);
+	}
+
+	data.insert(data.end(), second.begin(), second.end());
+
+	HDRImage image;
+	REQUIRE(Decode(MakeHDR(Header(width, 2), data), image));
+	const unsigned char first[4] = { 10, 20, 30, 130 };
+	for (unsigned int x = 0; x < width; x++)
+		REQUIRE(memcmp(&image.RGBE[x * 4], first, 4) == 0);
+
+	const unsigned char* row = &image.RGBE[width * 4];
+	const unsigned char repeated[4] = { 40, 50, 60, 131 };
+	for (unsigned int x = 0; x < 256; x++)
+		REQUIRE(memcmp(row + x * 4, repeated, 4) == 0);
+	const unsigned char after[4] = { 70, 80, 90, 132 };
+	CHECK(memcmp(row + 256 * 4, after, 4) == 0);
+	CHECK(row[299 * 4] == (unsigned char)299);
+}
+
+TEST(HDRDecoder, DecodesEncodedRows)
+{
+	// Wide enough for the SIMD interleave and a scalar tail
+	HDRImage image;
+	REQUIRE(Decode(MakeEncodedHDR(21, 3), image));
+	CHECK(MatchesEncoded(image, 21, 3));
+
+	// And the narrowest width that's ever encoded
+	REQUIRE(Decode(MakeEncodedHDR(8, 1), image));
+	CHECK(MatchesEncoded(image, 8, 1));
+}
+
+TEST(HDRDecoder, ReadsOtherHeaders)
+{
+	// The older magic, Windows line endings and no FORMAT
+	std::vector<unsigned char> data = { 1, 2, 3, 128 };
+	HDRImage image;
+	CHECK(Decode(MakeHDR("#?RGBE\r\n# comment\r\n\r\n-Y 1 +X 1\r\n", data), image));
+	CHECK(image.RGBE == data);
+}
+
+TEST(HDRDecoder, RejectsMalformedHeaders)
+{
+	std::vector<unsigned char> data = { 1, 2, 3, 128 };
+	const char* headers[] =
+	{
+		"",
+		"#?RADIANCE",							// Nothing after the magic
+		"P6\n\n-Y 1 +X 1\n",					// Some other file
+		"#?RADIANCE\nFORMAT=32-bit_rle_xyze\n\n-Y 1 +X 1\n",
+		"#?RADIANCE\n-Y 1 +X 1\n",				// No blank line
+		"#?RADIANCE\n\n",						// No resolution
+		"#?RADIANCE\n\n+Y 1 +X 1\n",			// Bottom to top
+		"#?RADIANCE\n\n-Y 1 -X 1\n",			// Right to left
+		"#?RADIANCE\n\n+X 1 -Y 1\n",			// Column major
+		"#?RADIANCE\n\n-Y 0 +X 1\n",
+		"#?RADIANCE\n\n-Y 1 +X 0\n",
+		"#?RADIANCE\n\n-Y 1 +X\n",
+		"#?RADIANCE\n\n-Y 1 +X 1x\n",
+		"#?RADIANCE\n\n-Y 1 +X 99999999999\n",	// Absurdly wide
+		"#?RADIANCE\n\n-Y 1 +X 1",				// No newline
+	};
+
+	for (const char* header : headers)
+	{
+		HDRImage image;
+		CHECK(!Decode(MakeHDR(header, data), image));
+		CHECK(image.Width == 0 && image.RGBE.empty());
+	}
+}
+
+TEST(HDRDecoder, RejectsEveryTruncation)
+{
+	std::vector<unsigned char> encoded = MakeEncodedHDR(21, 3);
+	for (size_t size = 0; size < encoded.size(); size++)
+	{
+		HDRImage image;
+		CHECK(!DecodeHDR(encoded.data(), size, image));
+	}
+
+	// Flat rows too
+	std::vector<unsigned char> flat = MakeHDR(Header(2, 2), std::vector<unsigned char>(16, 100));
+	for (size_t size = 0; size < flat.size(); size++)
+	{
+		HDRImage image;
+		CHECK(!DecodeHDR(flat.data(), size, image));
+	}
+}
+
+TEST(HDRDecoder, RejectsMalformedRows)
+{
+	const std::string header = Header(8, 1);
+
+	// An encoded row that says it's another width
+	std::vector<unsigned char> wrongWidth = MakeEncodedHDR(8, 1);
+	wrongWidth[header.size() + 3] = 9;
+
+	// A run, then a literal, past the end of the row
+	std::vector<unsigned char> longRun = { 2, 2, 0, 8, 128 + 9, 5 };
+	std::vector<unsigned char> longLiteral = { 2, 2, 0, 8, 9, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+	// A literal of nothing, which would never finish
+	std::vector<unsigned char> emptyLiteral = { 2, 2, 0, 8, 0, 0, 0, 0 };
+
+	// Old style repeats: of nothing at the start of a row,
+	// and past the end of one
+	std::vector<unsigned char> repeatFirst = { 1, 1, 1, 8 };
+	std::vector<unsigned char> repeatPast = { 5, 5, 5, 130, 1, 1, 1, 8 };
+
+	HDRImage image;
+	CHECK(!Decode(wrongWidth, image));
+	CHECK(!Decode(MakeHDR(header, longRun), image));
+	CHECK(!Decode(MakeHDR(header, longLiteral), image));
+	CHECK(!Decode(MakeHDR(header, emptyLiteral), image));
+	CHECK(!Decode(MakeHDR(header, repeatFirst), image));
+	CHECK(!Decode(MakeHDR(header, repeatPast), image));
+}
+
+TEST(HDRDecoder, ConvertsRGBE)
+{
+	float rgb[3];
+	const unsigned char one[4] = { 128, 64, 0, 129 };
+	DecodeRGBE(one, rgb);
+	CHECK(rgb[0] == 1.0f && rgb[1] == 0.5f && rgb[2] == 0.0f);
+
+	const unsigned char bright[4] = { 128, 128, 128, 140 };
+	DecodeRGBE(bright, rgb);
+	CHECK(rgb[0] == 2048.0f);
+
+	// A zero exponent is black, whatever the mantissas say
+	const unsigned char black[4] = { 255, 255, 255, 0 };
+	DecodeRGBE(black, rgb);
+	CHECK(rgb[0] == 0.0f && rgb[1] == 0.0f && rgb[2] == 0.0f);
+}
@@ -0,0 +1,212 @@
+#include "TestHarness.h"
+#include "../IBLCache.h"
+
+#include <string.h>
+
+// --------------------------------------------------------
+// The IBL cache file: round trips, and rejection of
+// anything stale, from another sky or damaged
+// --------------------------------------------------------
+
+// Pixels for a small cache, kept alive for the textures
+// that point into them
+struct TestIBLCache
+{
+	IBLCache Cache;
+	std::vector<std::vector<unsigned char>> Pixels;
+
+	void AddTexture(IBLCacheTexture& texture, uint32_t bytesPerTexel, uint32_t width, uint32_t height, uint32_t arraySize, uint32_t mipLevels)
+	{
+		texture.DXGIFormat = 10 + (uint32_t)Pixels.size();
+		texture.BytesPerTexel = bytesPerTexel;
+		texture.Width = width;
+		texture.Height = height;
+		texture.ArraySize = arraySize;
+		texture.MipLevels = mipLevels;
+
+		for (uint32_t slice = 0; slice < arraySize; slice++)
+		{
+			for (uint32_t mip = 0; mip < mipLevels; mip++)
+			{
+				std::vector<unsigned char> pixels(texture.GetSubresourceSize(mip));
+				for (size_t i = 0; i < pixels.size(); i++)
+					pixels[i] = (unsigned char)(i * 7 + slice * 31 + mip * 13 + Pixels.size());
+				Pixels.push_back(pixels);
+			}
+		}
+	}
+
+	TestIBLCache()
+	{
+		// Reserve up front, so earlier pointers stay valid
+		Pixels.reserve(64);
+		Cache.SourceHash = 0xFEDCBA9876543210ull;
+		AddTexture(Cache.Irradiance, 8, 4, 4, 6, 1);
+		AddTexture(Cache.Specular, 8, 8, 8, 6, 4);
+		AddTexture(Cache.BRDFLookUp, 4, 8, 4, 1, 1);
+
+		size_t next = 0;
+		IBLCacheTexture* textures[] = { &Cache.Irradiance, &Cache.Specular, &Cache.BRDFLookUp };
+		for (IBLCacheTexture* t : textures)
+			for (uint32_t i = 0; i < t->ArraySize * t->MipLevels; i++)
+				t->Subresources.push_back(Pixels[next++].data());
+	}
+};
+
+static bool SameTexture(const IBLCacheTexture& a, const IBLCacheTexture& b)
+{
+	if (a.DXGIFormat != b.DXGIFormat || a.BytesPerTexel != b.BytesPerTexel ||
+		a.Width != b.Width || a.Height != b.Height ||
+		a.ArraySize != b.ArraySize || a.MipLevels != b.MipLevels ||
+		a.Subresources.size() != b.Subresources.size())
+		return false;
+
+	for (size_t i = 0; i < a.Subresources.size(); i++)
+	{
+		if (memcmp(a.Subresources[i], b.Subresources[i], a.GetSubresourceSize((uint32_t)(i % a.MipLevels))) != 0)
+			return false;
+	}
+	return true;
+}
+
+TEST(IBLCache, RoundTrips)
+{
+	TestIBLCache test;
+	std::vector<unsigned char> bytes;
+	test.Cache.Serialize(bytes);
+
+	IBLCache parsed;
+	REQUIRE(parsed.Parse(bytes.data(), bytes.size(), test.Cache.SourceHash));
+	CHECK(parsed.SourceHash == test.Cache.SourceHash);
+	CHECK(SameTexture(parsed.Irradiance, test.Cache.Irradiance));
+	CHECK(SameTexture(parsed.Specular, test.Cache.Specular));
+	CHECK(SameTexture(parsed.BRDFLookUp, test.Cache.BRDFLookUp));
+
+	// The subresources point into the parsed data, in order
+	CHECK(parsed.Irradiance.Subresources[0] > bytes.data());
+	CHECK(parsed.Specular.Subresources[0] == parsed.Irradiance.Subresources[5] + parsed.Irradiance.GetSubresourceSize(0));
+	CHECK(parsed.BRDFLookUp.Subresources[0] + parsed.BRDFLookUp.GetSubresourceSize(0) == bytes.data() + bytes.size());
+}
+
+TEST(IBLCache, SizesSmallMips)
+{
+	IBLCacheTexture texture;
+	texture.BytesPerTexel = 8;
+	texture.Width = 8;
+	texture.Height = 2;
+	CHECK(texture.GetRowPitch(0) == 64);
+	CHECK(texture.GetSubresourceSize(0) == 128);
+	CHECK(texture.GetSubresourceSize(1) == 32);
+	CHECK(texture.GetSubresourceSize(2) == 16);
+	CHECK(texture.GetSubresourceSize(3) == 8);
+}
+
+TEST(IBLCache, HashMismatchInvalidates)
+{
+	TestIBLCache test;
+	std::vector<unsigned char> bytes;
+	test.Cache.Serialize(bytes);
+
+	// A different sky, or the same one changed, in either
+	// half of the hash
+	IBLCache parsed;
+	CHECK(!parsed.Parse(bytes.data(), bytes.size(), test.Cache.SourceHash + 1));
+	CHECK(!parsed.Parse(bytes.data(), bytes.size(), test.Cache.SourceHash ^ (1ull << 40)));
+	CHECK(!parsed.Parse(bytes.data(), bytes.size(), 0));
+	CHECK(parsed.Parse(bytes.data(), bytes.size(), test.Cache.SourceHash));
+}
+
+TEST(IBLCache, RejectsOtherVersionsAndFiles)
+{
+	TestIBLCache test;
+	std::vector<unsigned char> bytes;
+	test.Cache.Serialize(bytes);
+
+	std::vector<unsigned char> oldVersion = bytes;
+	oldVersion[4] = (unsigned char)(IBLCache::Version - 1);
+	IBLCache parsed;
+	CHECK(!parsed.Parse(oldVersion.data(), oldVersion.size(), test.Cache.SourceHash));
+
+	std::vector<unsigned char> otherFile = bytes;
+	otherFile[0] = 'X';
+	CHECK(!parsed.Parse(otherFile.data(), otherFile.size(), test.Cache.SourceHash));
+}
+
+TEST(IBLCache, RejectsEveryTruncation)
+{
+	TestIBLCache test;
+	std::vector<unsigned char> bytes;
+	test.Cache.Serialize(bytes);
+
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		IBLCache parsed;
+		CHECK(!parsed.Parse(bytes.data(), size, test.Cache.SourceHash));
+	}
+
+	bytes.push_back(0);
+	IBLCache parsed;
+	CHECK(!parsed.Parse(bytes.data(), bytes.size(), test.Cache.SourceHash));
+}
+
+TEST(IBLCache, SurvivesCorruptBytes)
+{
+	TestIBLCache test;
+	std::vector<unsigned char> bytes;
+	test.Cache.Serialize(bytes);
+
+	// Damage each byte of the header and texture records in
+	// turn (damaged pixels are still well formed).  Parse()
+	// may accept some, like a changed format, but must never
+	// read out of bounds or fail to return.
+	const size_t headerBytes = 16 + 3 * 24;
+	unsigned int rejected = 0;
+	for (size_t i = 0; i < headerBytes; i++)
+	{
+		std::vector<unsigned char> corrupt = bytes;
+		corrupt[i] ^= 0xA5;
+
+		IBLCache parsed;
+		if (!parsed.Parse(corrupt.data(), corrupt.size(), test.Cache.SourceHash))
+			rejected++;
+	}
+	CHECK(rejected > 0);
+
+	// Sizes and counts far past the end
+	std::vector<unsigned char> huge = bytes;
+	for (size_t i = 16; i < headerBytes; i++)
+		huge[i] = 0xFF;
+	IBLCache parsed;
+	CHECK(!parsed.Parse(huge.data(), huge.size(), test.Cache.SourceHash));
+}
+
+TEST(IBLCache, RejectsImpossibleTextures)
+{
+	TestIBLCache test;
+	std::vector<unsigned char> bytes;
+	test.Cache.Serialize(bytes);
+
+	// Each field of the specular record (the second), set to
+	// something no cache would hold
+	const size_t record = 16 + 24;
+	struct { size_t Offset; uint32_t Value; } cases[] =
+	{
+		{ 4, 0 },		// No bytes per texel
+		{ 4, 17 },		// More than any format has
+		{ 8, 0 },		// No width
+		{ 12, 16385 },	// Taller than D3D allows
+		{ 16, 0 },		// No array slices
+		{ 16, 7 },		// More than a cube's faces
+		{ 20, 0 },		// No mips
+		{ 20, 5 },		// Past 1x1 for an 8x8 texture
+	};
+	for (auto& c : cases)
+	{
+		std::vector<unsigned char> corrupt = bytes;
+		for (int i = 0; i < 4; i++)
+			corrupt[record + c.Offset + i] = (unsigned char)(c.Value >> (i * 8));
+
+		IBLCache parsed;
+		CHECK(!parsed.Parse(corrupt.data(), corrupt.size(), test.Cache.SourceHash));
+	}
+}
@@ -0,0 +1,150 @@
+#include "TestHarness.h"
+#include "../MipGenerator.h"
+
+#include <math.h>
+
+// --------------------------------------------------------
+// Mip chains: sizes, filtering, and the same output for
+// any thread count
+// --------------------------------------------------------
+
+static std::vector<std::vector<unsigned char>> MakeTopLevel(unsigned int width, unsigned int height)
+{
+	std::vector<std::vector<unsigned char>> mips(1);
+	mips[0].resize((size_t)width * height * 4);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			unsigned char* p = &mips[0][((size_t)y * width + x) * 4];
+			p[0] = (unsigned char)((x * 37 + y * 11) & 255);
+			p[1] = (unsigned char)(((x ^ y) * 5) & 255);
+			p[2] = (unsigned char)(x * 255 / width);
+			p[3] = (unsigned char)((x * y) & 255);
+		}
+	}
+	return mips;
+}
+
+TEST(MipGenerator, BuildsEveryLevel)
+{
+	std::vector<std::vector<unsigned char>> mips = MakeTopLevel(96, 20);
+	GenerateMipChain(mips, 96, 20);
+
+	// 96x20 down to 1x1: 96, 48, 24, 12, 6, 3, 1
+	REQUIRE(mips.size() == 7);
+	unsigned int width = 96, height = 20;
+	for (size_t level = 0; level < mips.size(); level++)
+	{
+		CHECK(mips[level].size() == (size_t)width * height * 4);
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+}
+
+TEST(MipGenerator, BoxFilterAveragesFlatImages)
+{
+	std::vector<std::vector<unsigned char>> mips(1, std::vector<unsigned char>(32 * 32 * 4));
+	for (size_t i = 0; i < mips[0].size(); i += 4)
+	{
+		mips[0][i + 0] = 200;
+		mips[0][i + 1] = 100;
+		mips[0][i + 2] = 50;
+		mips[0][i + 3] = 255;
+	}
+
+	MipOptions options;
+	options.SRGB = true;
+	GenerateMipChain(mips, 32, 32, options);
+
+	// A flat image stays flat, even through sRGB decoding
+	const std::vector<unsigned char>& last = mips.back();
+	CHECK(last[0] == 200 && last[1] == 100 && last[2] == 50 && last[3] == 255);
+}
+
+TEST(MipGenerator, SameOutputForAnyThreadCount)
+{
+	// Big enough that every level up to the top is split
+	const unsigned int width = 512, height = 300;
+	MipOptions options;
+	options.Filter = MIP_FILTER_KAISER;
+	options.SRGB = true;
+	options.Wrap = true;
+	options.PreserveAlphaCoverage = true;
+	options.ThreadCount = 1;
+
+	std::vector<std::vector<unsigned char>> single = MakeTopLevel(width, height);
+	GenerateMipChain(single, width, height, options);
+
+	unsigned int threadCounts[] = { 0, 3, 7 };
+	for (unsigned int threads : threadCounts)
+	{
+		options.ThreadCount = threads;
+		std::vector<std::vector<unsigned char>> parallel = MakeTopLevel(width, height);
+		GenerateMipChain(parallel, width, height, options);
+		CHECK(parallel == single);
+	}
+}
+
+TEST(MipGenerator, PreservesAlphaCoverage)
+{
+	// Mostly faint alpha with a few solid texels, like foliage:
+	// plain averaging would drop most of it below the reference
+	const unsigned int size = 64;
+	std::vector<std::vector<unsigned char>> mips(1, std::vector<unsigned char>(size * size * 4, 255));
+	unsigned int noise = 777;
+	for (unsigned int i = 0; i < size * size; i++)
+	{
+		noise = noise * 1664525u + 1013904223u;
+		float value = (noise >> 8) / 16777216.0f;
+		mips[0][i * 4 + 3] = (unsigned char)(value * value * 255);
+	}
+	float topCoverage = CalculateAlphaCoverage(mips[0].data(), size, size, 0.5f);
+
+	std::vector<std::vector<unsigned char>> plain = mips;
+	GenerateMipChain(plain, size, size);
+
+	MipOptions options;
+	options.PreserveAlphaCoverage = true;
+	GenerateMipChain(mips, size, size, options);
+
+	for (unsigned int level = 1; level <= 3; level++)
+	{
+		unsigned int mipSize = size >> level;
+		float coverage = CalculateAlphaCoverage(mips[level].data(), mipSize, mipSize, 0.5f);
+		float plainCoverage = CalculateAlphaCoverage(plain[level].data(), mipSize, mipSize, 0.5f);
+		CHECK(fabsf(coverage - topCoverage) < 0.05f);
+		CHECK(fabsf(coverage - topCoverage) < fabsf(plainCoverage - topCoverage));
+	}
+}
+
+TEST(MipGenerator, KeepsNormalsUnitLength)
+{
+	const unsigned int size = 64;
+	std::vector<std::vector<unsigned char>> mips(1, std::vector<unsigned char>(size * size * 4));
+	for (unsigned int i = 0; i < size * size; i++)
+	{
+		// Alternating tilts, which average toward straight up
+		float x = (i % 2) ? 0.6f : -0.6f;
+		float z = 0.8f;
+		mips[0][i * 4 + 0] = (unsigned char)((x * 0.5f + 0.5f) * 255 + 0.5f);
+		mips[0][i * 4 + 1] = 128;
+		mips[0][i * 4 + 2] = (unsigned char)((z * 0.5f + 0.5f) * 255 + 0.5f);
+		mips[0][i * 4 + 3] = 255;
+	}
+
+	MipOptions options;
+	options.NormalMap = true;
+	GenerateMipChain(mips, size, size, options);
+
+	const std::vector<unsigned char>& mip = mips[2];
+	bool unit = true;
+	for (size_t i = 0; i < mip.size(); i += 4)
+	{
+		float x = mip[i + 0] / 255.0f * 2 - 1;
+		float y = mip[i + 1] / 255.0f * 2 - 1;
+		float z = mip[i + 2] / 255.0f * 2 - 1;
+		unit = unit && fabsf(sqrtf(x * x + y * y + z * z) - 1.0f) < 0.02f;
+	}
+	CHECK(unit);
+}
@@ -0,0 +1,607 @@
+#include "TestHarness.h"
+#include "../MappedFile.h"
+#include "../PNGDecoder.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#endif
+
+// --------------------------------------------------------
+// PNG decoding, against files written here with a small
+// independent encoder (every color type, bit depth and
+// interlacing, stored and compressed deflate blocks), and
+// against the bundled assets
+// --------------------------------------------------------
+
+// === A minimal PNG writer ================================
+
+static uint32_t ReferenceCRC(const unsigned char* data, size_t size)
+{
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; bit++)
+			crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+	}
+	return ~crc;
+}
+
+static uint32_t ReferenceAdler(const std::vector<unsigned char>& data)
+{
+	uint32_t a = 1, b = 0;
+	for (unsigned char byte : data)
+	{
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	return (b << 16) | a;
+}
+
+static void PutBigEndian(std::vector<unsigned char>& out, uint32_t value)
+{
+	out.push_back((unsigned char)(value >> 24));
+	out.push_back((unsigned char)(value >> 16));
+	out.push_back((unsigned char)(value >> 8));
+	out.push_back((unsigned char)value);
+}
+
+// Writes deflate bits least significant first
+struct BitWriter
+{
+	std::vector<unsigned char>& Out;
+	uint32_t Bits = 0;
+	unsigned int Count = 0;
+
+	BitWriter(std::vector<unsigned char>& out) : Out(out) {}
+
+	void Put(uint32_t value, unsigned int count)
+	{
+		Bits |= value << Count;
+		Count += count;
+		while (Count >= 8)
+		{
+			Out.push_back((unsigned char)Bits);
+			Bits >>= 8;
+			Count -= 8;
+		}
+	}
+
+	// Huffman codes go most significant bit first
+	void PutCode(uint32_t code, unsigned int length)
+	{
+		uint32_t reversed = 0;
+		for (unsigned int i = 0; i < length; i++)
+			reversed |= ((code >> i) & 1) << (length - 1 - i);
+		Put(reversed, length);
+	}
+
+	void Flush()
+	{
+		if (Count > 0)
+			Out.push_back((unsigned char)Bits);
+		Bits = 0;
+		Count = 0;
+	}
+};
+
+// The fixed literal/length code from the deflate spec
+static void PutFixedLiteral(BitWriter& writer, unsigned int symbol)
+{
+	if (symbol < 144) writer.PutCode(0x30 + symbol, 8);
+	else if (symbol < 256) writer.PutCode(0x190 + symbol - 144, 9);
+	else if (symbol < 280) writer.PutCode(symbol - 256, 7);
+	else writer.PutCode(0xC0 + symbol - 280, 8);
+}
+
+static void PutFixedMatch(BitWriter& writer, unsigned int length, unsigned int distance)
+{
+	static const unsigned short lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const unsigned char lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const unsigned short distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const unsigned char distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	unsigned int l = 28;
+	while (lengthBase[l] > length) l--;
+	PutFixedLiteral(writer, 257 + l);
+	writer.Put(length - lengthBase[l], lengthExtra[l]);
+
+	unsigned int d = 29;
+	while (distanceBase[d] > distance) d--;
+	writer.PutCode(d, 5);
+	writer.Put(distance - distanceBase[d], distanceExtra[d]);
+}
+
+// --------------------------------------------------------
+// A zlib stream of either stored blocks, or one fixed
+// Huffman block with greedy matches (including overlapping
+// ones, like runs)
+// --------------------------------------------------------
+static std::vector<unsigned char> Compress(const std::vector<unsigned char>& data, bool stored)
+{
+	std::vector<unsigned char> out = { 0x78, 0x01 };
+	if (stored)
+	{
+		size_t offset = 0;
+		do
+		{
+			size_t length = (std::min)(data.size() - offset, (size_t)65535);
+			bool final = offset + length == data.size();
+			out.push_back(final ? 1 : 0);
+			out.push_back((unsigned char)length);
+			out.push_back((unsigned char)(length >> 8));
+			out.push_back((unsigned char)~length);
+			out.push_back((unsigned char)(~length >> 8));
+			out.insert(out.end(), data.begin() + offset, data.begin() + offset + length);
+			offset += length;
+		} while (offset < data.size());
+	}
+	else
+	{
+		BitWriter writer(out);
+		writer.Put(1, 1);
+		writer.Put(1, 2);
+		for (size_t i = 0; i < data.size();)
+		{
+			// Longest match among a few recent distances
+			unsigned int bestLength = 0, bestDistance = 0;
+			unsigned int distances[] = { 1, 2, 3, 4, 7, 8, 16, 100, 1000, 5000 };
+			for (unsigned int distance : distances)
+			{
+				if (distance > i)
+					break;
+				unsigned int length = 0;
+				while (length < 258 && i + length < data.size() && data[i + length] == data[i + length - distance])
+					length++;
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestDistance = distance;
+				}
+			}
+
+			if (bestLength >= 3)
+			{
+				PutFixedMatch(writer, bestLength, bestDistance);
+				i += bestLength;
+			}
+			else
+			{
+				PutFixedLiteral(writer, data[i++]);
+			}
+		}
+		PutFixedLiteral(writer, 256);
+		writer.Flush();
+	}
+
+	PutBigEndian(out, ReferenceAdler(data));
+	return out;
+}
+
+static void PutChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& body)
+{
+	PutBigEndian(png, (uint32_t)body.size());
+	size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), body.begin(), body.end());
+	PutBigEndian(png, ReferenceCRC(&png[start], png.size() - start));
+}
+
+// A test image: raw samples, plus what it should decode to
+struct TestPNG
+{
+	unsigned int Width, Height, BitDepth, ColorType;
+	bool Interlaced;
+	std::vector<uint16_t> Samples;	// Per pixel, per channel
+	std::vector<unsigned char> Palette;	// RGBA
+	bool HasTransparent = false;
+	uint16_t Transparent[3] = {};
+	std::vector<unsigned char> Expected;
+};
+
+static unsigned int Channels(unsigned int colorType)
+{
+	return colorType == 2 ? 3 : colorType == 4 ? 2 : colorType == 6 ? 4 : 1;
+}
+
+static TestPNG MakeTestPNG(unsigned int width, unsigned int height, unsigned int colorType, unsigned int bitDepth, bool interlaced, unsigned int seed)
+{
+	TestPNG t;
+	t.Width = width;
+	t.Height = height;
+	t.BitDepth = bitDepth;
+	t.ColorType = colorType;
+	t.Interlaced = interlaced;
+
+	unsigned int channels = Channels(colorType);
+	unsigned int maxValue = (1u << bitDepth) - 1;
+	unsigned int paletteSize = colorType == 3 ? (std::min)(maxValue + 1, 40u) : 0;
+	for (unsigned int i = 0; i < paletteSize; i++)
+	{
+		t.Palette.push_back((unsigned char)(i * 7));
+		t.Palette.push_back((unsigned char)(255 - i * 5));
+		t.Palette.push_back((unsigned char)(i * 31));
+		t.Palette.push_back((unsigned char)(i % 3 == 0 ? 100 : 255));
+	}
+
+	// Smooth areas (which compress into matches) and noise
+	unsigned int noise = seed;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				noise = noise * 1664525u + 1013904223u;
+				uint32_t value = (x < width / 2) ? (y * 3 + c) : (noise >> 8);
+				t.Samples.push_back((uint16_t)(colorType == 3 ? value % paletteSize : value & maxValue));
+			}
+		}
+	}
+
+	// Transparency picks a color that appears in the image
+	if ((colorType == 0 || colorType == 2) && width * height > 5)
+	{
+		t.HasTransparent = true;
+		for (unsigned int c = 0; c < channels; c++)
+			t.Transparent[c] = t.Samples[5 * channels + c];
+	}
+
+	for (unsigned int i = 0; i < width * height; i++)
+	{
+		const uint16_t* s = &t.Samples[i * channels];
+		auto to8 = [&](uint16_t v) { return (unsigned char)(bitDepth == 16 ? v >> 8 : bitDepth == 8 ? v : v * 255 / maxValue); };
+		unsigned char rgba[4];
+		switch (colorType)
+		{
+		case 0: rgba[0] = rgba[1] = rgba[2] = to8(s[0]); rgba[3] = 255; break;
+		case 2: rgba[0] = to8(s[0]); rgba[1] = to8(s[1]); rgba[2] = to8(s[2]); rgba[3] = 255; break;
+		case 3: memcpy(rgba, &t.Palette[s[0] * 4], 4); break;
+		case 4: rgba[0] = rgba[1] = rgba[2] = to8(s[0]); rgba[3] = to8(s[1]); break;
+		default: rgba[0] = to8(s[0]); rgba[1] = to8(s[1]); rgba[2] = to8(s[2]); rgba[3] = to8(s[3]); break;
+		}
+
+		if (t.HasTransparent && memcmp(s, t.Transparent, channels * sizeof(uint16_t)) == 0)
+			rgba[3] = 0;
+		t.Expected.insert(t.Expected.end(), rgba, rgba + 4);
+	}
+	return t;
+}
+
+// Paeth predictor, as the spec writes it
+static unsigned char ReferencePaeth(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if (pa <= pb && pa <= pc) return (unsigned char)a;
+	if (pb <= pc) return (unsigned char)b;
+	return (unsigned char)c;
+}
+
+// --------------------------------------------------------
+// Encodes the image: rows packed to the bit depth, each
+// with the next of the five filters in turn, compressed,
+// and split over several IDAT chunks
+// --------------------------------------------------------
+static std::vector<unsigned char> EncodeTestPNG(const TestPNG& t, bool stored)
+{
+	static const unsigned int passX[7] = { 0, 4, 0, 2, 0, 1, 0 }, passY[7] = { 0, 0, 4, 0, 2, 0, 1 };
+	static const unsigned int stepX[7] = { 8, 8, 4, 4, 2, 2, 1 }, stepY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+	unsigned int channels = Channels(t.ColorType);
+	unsigned int bitsPerPixel = channels * t.BitDepth;
+	unsigned int bytesPerPixel = (std::max)(1u, bitsPerPixel / 8);
+	std::vector<unsigned char> scanlines;
+	unsigned int filter = 0;
+
+	for (unsigned int pass = 0; pass < (t.Interlaced ? 7u : 1u); pass++)
+	{
+		unsigned int x0 = t.Interlaced ? passX[pass] : 0, dx = t.Interlaced ? stepX[pass] : 1;
+		unsigned int y0 = t.Interlaced ? passY[pass] : 0, dy = t.Interlaced ? stepY[pass] : 1;
+		if (x0 >= t.Width || y0 >= t.Height)
+			continue;
+
+		unsigned int passWidth = (t.Width - x0 + dx - 1) / dx;
+		size_t rowBytes = ((size_t)passWidth * bitsPerPixel + 7) / 8;
+		std::vector<unsigned char> previous(rowBytes, 0);
+		for (unsigned int y = y0; y < t.Height; y += dy)
+		{
+			std::vector<unsigned char> row(rowBytes, 0);
+			for (unsigned int px = 0; px < passWidth; px++)
+			{
+				const uint16_t* s = &t.Samples[((size_t)y * t.Width + x0 + px * dx) * channels];
+				for (unsigned int c = 0; c < channels; c++)
+				{
+					size_t bit = ((size_t)px * channels + c) * t.BitDepth;
+					if (t.BitDepth == 16)
+					{
+						row[bit / 8] = (unsigned char)(s[c] >> 8);
+						row[bit / 8 + 1] = (unsigned char)s[c];
+					}
+					else
+					{
+						row[bit / 8] |= (unsigned char)(s[c] << (8 - t.BitDepth - (bit & 7)));
+					}
+				}
+			}
+
+			scanlines.push_back((unsigned char)filter);
+			for (size_t i = 0; i < rowBytes; i++)
+			{
+				int a = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+				int b = previous[i];
+				int c = i >= bytesPerPixel ? previous[i - bytesPerPixel] : 0;
+				int predicted = filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) / 2 : filter == 4 ? ReferencePaeth(a, b, c) : 0;
+				scanlines.push_back((unsigned char)(row[i] - predicted));
+			}
+			previous = row;
+			filter = (filter + 1) % 5;
+		}
+	}
+
+	std::vector<unsigned char> png = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	std::vector<unsigned char> header;
+	PutBigEndian(header, t.Width);
+	PutBigEndian(header, t.Height);
+	header.push_back((unsigned char)t.BitDepth);
+	header.push_back((unsigned char)t.ColorType);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(t.Interlaced ? 1 : 0);
+	PutChunk(png, "IHDR", header);
+
+	if (t.ColorType == 3)
+	{
+		std::vector<unsigned char> palette, alpha;
+		for (size_t i = 0; i < t.Palette.size(); i += 4)
+		{
+			palette.insert(palette.end(), &t.Palette[i], &t.Palette[i] + 3);
+			alpha.push_back(t.Palette[i + 3]);
+		}
+		PutChunk(png, "PLTE", palette);
+		PutChunk(png, "tRNS", alpha);
+	}
+	else if (t.HasTransparent)
+	{
+		std::vector<unsigned char> transparent;
+		for (unsigned int c = 0; c < Channels(t.ColorType); c++)
+		{
+			transparent.push_back((unsigned char)(t.Transparent[c] >> 8));
+			transparent.push_back((unsigned char)t.Transparent[c]);
+		}
+		PutChunk(png, "tRNS", transparent);
+	}
+
+	std::vector<unsigned char> stream = Compress(scanlines, stored);
+	size_t chunkSize = stream.size() / 3 + 1;
+	for (size_t offset = 0; offset < stream.size(); offset += chunkSize)
+	{
+		size_t end = (std::min)(stream.size(), offset + chunkSize);
+		PutChunk(png, "IDAT", std::vector<unsigned char>(stream.begin() + offset, stream.begin() + end));
+	}
+	PutChunk(png, "IEND", std::vector<unsigned char>());
+	return png;
+}
+
+// === Tests ===============================================
+
+TEST(PNGDecoder, DecodesEveryFormat)
+{
+	struct Format { unsigned int ColorType, BitDepth; };
+	const Format formats[] = {
+		{ 0, 1 }, { 0, 2 }, { 0, 4 }, { 0, 8 }, { 0, 16 },
+		{ 2, 8 }, { 2, 16 },
+		{ 3, 1 }, { 3, 2 }, { 3, 4 }, { 3, 8 },
+		{ 4, 8 }, { 4, 16 },
+		{ 6, 8 }, { 6, 16 } };
+
+	// Sizes that leave partial bytes and empty Adam7 passes
+	const unsigned int sizes[][2] = { { 1, 1 }, { 3, 2 }, { 13, 7 }, { 64, 33 } };
+
+	unsigned int seed = 1;
+	for (const Format& format : formats)
+	{
+		for (const unsigned int* size : sizes)
+		{
+			for (int variant = 0; variant < 4; variant++)
+			{
+				bool interlaced = (variant & 1) != 0;
+				bool stored = (variant & 2) != 0;
+				TestPNG t = MakeTestPNG(size[0], size[1], format.ColorType, format.BitDepth, interlaced, seed++);
+				std::vector<unsigned char> file = EncodeTestPNG(t, stored);
+
+				PNGImage image;
+				bool decoded = DecodePNG(file.data(), file.size(), image);
+				CHECK(decoded);
+				if (!decoded || image.RGBA != t.Expected)
+				{
+					printf("  color type %u, %u bit, %ux%u%s%s\n", format.ColorType, format.BitDepth,
+						size[0], size[1], interlaced ? ", interlaced" : "", stored ? ", stored" : "");
+					CHECK(image.RGBA == t.Expected);
+				}
+			}
+		}
+	}
+}
+
+TEST(PNGDecoder, DecodesIntoAnyRowPitch)
+{
+	TestPNG t = MakeTestPNG(21, 9, 6, 8, false, 99);
+	std::vector<unsigned char> file = EncodeTestPNG(t, false);
+
+	const size_t pitch = 21 * 4 + 12;
+	std::vector<unsigned char> pixels(pitch * 9, 0xCD);
+	REQUIRE(DecodePNG(file.data(), file.size(), pixels.data(), pitch));
+
+	bool matches = true, paddingKept = true;
+	for (unsigned int y = 0; y < 9; y++)
+	{
+		matches = matches && memcmp(&pixels[y * pitch], &t.Expected[y * 21 * 4], 21 * 4) == 0;
+		for (size_t i = 21 * 4; i < pitch; i++)
+			paddingKept = paddingKept && pixels[y * pitch + i] == 0xCD;
+	}
+	CHECK(matches);
+	CHECK(paddingKept);
+}
+
+TEST(PNGDecoder, RejectsBadChecksums)
+{
+	TestPNG t = MakeTestPNG(16, 16, 2, 8, false, 5);
+	std::vector<unsigned char> file = EncodeTestPNG(t, false);
+	PNGImage image;
+	REQUIRE(DecodePNG(file.data(), file.size(), image));
+
+	// Any flipped bit in IHDR's CRC, or in the middle of the
+	// compressed data (which also fails its chunk's CRC)
+	std::vector<unsigned char> badHeader = file;
+	badHeader[8 + 8 + 13] ^= 0x01;
+	CHECK(!DecodePNG(badHeader.data(), badHeader.size(), image));
+	CHECK(image.RGBA.empty());
+
+	std::vector<unsigned char> badData = file;
+	badData[badData.size() - 40] ^= 0x10;
+	CHECK(!DecodePNG(badData.data(), badData.size(), image));
+}
+
+TEST(PNGDecoder, RejectsABadAdler32)
+{
+	// Re-encode with a wrong Adler-32 but correct chunk CRCs:
+	// only the zlib check can catch it
+	TestPNG t = MakeTestPNG(8, 8, 0, 8, false, 6);
+	std::vector<unsigned char> file = EncodeTestPNG(t, true);
+
+	// The IDAT chunks are followed by IEND (12 bytes).  The
+	// last IDAT ends with the Adler-32, then its CRC.
+	size_t adlerOffset = file.size() - 12 - 4 - 4;
+	file[adlerOffset] ^= 0xFF;
+
+	// Find the last IDAT and fix up its CRC
+	size_t chunk = 8;
+	size_t lastIDAT = 0;
+	while (chunk + 12 <= file.size())
+	{
+		uint32_t length = ((uint32_t)file[chunk] << 24) | ((uint32_t)file[chunk + 1] << 16) | ((uint32_t)file[chunk + 2] << 8) | file[chunk + 3];
+		if (memcmp(&file[chunk + 4], "IDAT", 4) == 0)
+			lastIDAT = chunk;
+		chunk += 12 + length;
+	}
+	REQUIRE(lastIDAT != 0);
+	uint32_t length = ((uint32_t)file[lastIDAT] << 24) | ((uint32_t)file[lastIDAT + 1] << 16) | ((uint32_t)file[lastIDAT + 2] << 8) | file[lastIDAT + 3];
+	uint32_t crc = ReferenceCRC(&file[lastIDAT + 4], 4 + length);
+	for (int i = 0; i < 4; i++)
+		file[lastIDAT + 8 + length + i] = (unsigned char)(crc >> (24 - 8 * i));
+
+	PNGImage image;
+	CHECK(!DecodePNG(file.data(), file.size(), image));
+}
+
+TEST(PNGDecoder, RefusesHugeImagesBeforeAllocating)
+{
+	// A valid header for 20000 x 20000 and no real data: within
+	// the per-side limit, but 1.6 GB of RGBA to allocate
+	std::vector<unsigned char> png = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	std::vector<unsigned char> header;
+	PutBigEndian(header, 20000);
+	PutBigEndian(header, 20000);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+	PutChunk(png, "IHDR", header);
+	PutChunk(png, "IDAT", std::vector<unsigned char>(16, 0));
+	PutChunk(png, "IEND", std::vector<unsigned char>());
+
+	PNGInfo info;
+	CHECK(!ReadPNGInfo(png.data(), png.size(), info));
+	PNGImage image;
+	CHECK(!DecodePNG(png.data(), png.size(), image));
+
+	// The largest allowed size still reads
+	std::vector<unsigned char> allowed = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	header.clear();
+	PutBigEndian(header, 16384);
+	PutBigEndian(header, 16384);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+	PutChunk(allowed, "IHDR", header);
+	PutChunk(allowed, "IDAT", std::vector<unsigned char>(16, 0));
+	CHECK(ReadPNGInfo(allowed.data(), allowed.size(), info));
+}
+
+TEST(PNGDecoder, RejectsEveryTruncation)
+{
+	TestPNG t = MakeTestPNG(12, 12, 6, 8, true, 7);
+	std::vector<unsigned char> file = EncodeTestPNG(t, false);
+
+	// Dropping IEND alone is tolerated; anything shorter isn't
+	bool allRejected = true;
+	for (size_t size = 0; size + 12 < file.size(); size++)
+	{
+		PNGImage image;
+		allRejected = allRejected && !DecodePNG(file.data(), size, image);
+	}
+	CHECK(allRejected);
+}
+
+// Every .png under a folder, recursively
+static void FindPNGs(const std::string& folder, std::vector<std::string>& paths)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((folder + "*").c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE)
+		return;
+	do
+	{
+		std::string name = data.cFileName;
+		if (name == "." || name == "..")
+			continue;
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			FindPNGs(folder + name + "\\", paths);
+		else if (name.size() > 4 && _stricmp(name.c_str() + name.size() - 4, ".png") == 0)
+			paths.push_back(folder + name);
+	} while (FindNextFileA(find, &data));
+	FindClose(find);
+#else
+	DIR* dir = opendir(folder.c_str());
+	if (!dir)
+		return;
+	while (dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		if (name == "." || name == "..")
+			continue;
+		if (entry->d_type == DT_DIR)
+			FindPNGs(folder + name + "/", paths);
+		else if (name.size() > 4 && strcasecmp(name.c_str() + name.size() - 4, ".png") == 0)
+			paths.push_back(folder + name);
+	}
+	closedir(dir);
+#endif
+}
+
+TEST(PNGDecoder, DecodesTheBundledAssets)
+{
+	// Passing the CRC and Adler-32 checks means each file's
+	// inflated bytes are exactly what its encoder wrote
+	std::vector<std::string> paths;
+	FindPNGs(GetTestAssetFolder(), paths);
+	REQUIRE(!paths.empty());
+
+	std::vector<MappedFile> files(paths.size());
+	std::vector<std::pair<const unsigned char*, size_t>> data;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		REQUIRE(files[i].Open(paths[i].c_str()));
+		data.push_back({ files[i].GetData(), files[i].GetSize() });
+	}
+
+	std::vector<PNGImage> single, parallel;
+	CHECK(DecodePNGs(data, single, 1) == paths.size());
+	CHECK(DecodePNGs(data, parallel, 0) == paths.size());
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		CHECK(!single[i].RGBA.empty());
+		CHECK(single[i].RGBA == parallel[i].RGBA);
+	}
+}
@@ -0,0 +1,368 @@
+#include "TestHarness.h"
+#include "../PackedHDR.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// Packed HDR formats against reference conversions written
+// from D3D's rules in double precision, on a million
+// colors including NaN, negative, denormal and out of range
+// values; the batch versions against the single texel
+// ones; and round trip error
+// --------------------------------------------------------
+
+static const PackedHDRFormat Formats[] = { PACKED_HDR_RGB9E5, PACKED_HDR_R11G11B10F, PACKED_HDR_RGBM };
+
+static uint32_t NextRandom(uint64_t& state)
+{
+	state = state * 6364136223846793005ull + 1442695040888963407ull;
+	return (uint32_t)(state >> 32);
+}
+
+// --------------------------------------------------------
+// A channel value from every range that matters: ordinary,
+// tiny and denormal, huge, special, and exact steps of the
+// formats (including the halfway points between them)
+// --------------------------------------------------------
+static float RandomChannel(uint64_t& state)
+{
+	uint32_t kind = NextRandom(state) % 16;
+	uint32_t bits = NextRandom(state);
+	switch (kind)
+	{
+	case 0: return std::numeric_limits<float>::quiet_NaN();
+	case 1: return (bits & 1) ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+	case 2: return -ldexpf((float)(bits >> 8), -20);
+	case 3:
+	{
+		// Any float bit pattern that isn't NaN
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value == value ? value : 0.0f;
+	}
+	case 4:
+	{
+		// Float denormals
+		uint32_t denormal = bits & 0x807FFFFFu;
+		float value;
+		memcpy(&value, &denormal, sizeof(value));
+		return value;
+	}
+	case 5: return ldexpf((float)(bits >> 8), -24 - 20 - (int)(bits & 7));	// Around the formats' denormals
+	case 6: return 65000.0f + (bits >> 16);	// Around the largest values
+	case 7:
+	{
+		// On or halfway between steps of 6 and 5 bit mantissas
+		int exponent = (int)(bits % 34) - 18;
+		float step = ldexpf(1.0f, exponent - 7);
+		return ldexpf(1.0f, exponent) + step * ((bits >> 8) % 256) * 0.5f;
+	}
+	case 8: return 0.0f;
+	default:
+	{
+		// Mostly ordinary HDR values, 2^-12 to 2^12
+		float mantissa = 1.0f + (bits >> 9) * ldexpf(1.0f, -23);
+		return ldexpf(mantissa, (int)(bits % 25) - 12);
+	}
+	}
+}
+
+static std::vector<float> MakeColors(size_t count, uint64_t seed)
+{
+	std::vector<float> rgb(count * 3);
+	for (float& value : rgb)
+		value = RandomChannel(seed);
+
+	// Some grey ones, where the shared exponent ties
+	for (size_t i = 0; i < count; i += 7)
+		rgb[i * 3 + 1] = rgb[i * 3 + 2] = rgb[i * 3];
+	return rgb;
+}
+
+// NaN and negative to 0, too large to the largest value
+static double ReferenceClamp(float value, double maxValue)
+{
+	return value > 0 ? (std::min)((double)value, maxValue) : 0.0;
+}
+
+// --------------------------------------------------------
+// RGB9E5, as the D3D functional spec writes it:
+//   E = max(-B - 1, floor(log2(maxc))) + 1 + B
+//   denom = 2^(E - B - N), one more if maxc rounds to 2^N
+//   each = floor(c / denom + 0.5)
+// --------------------------------------------------------
+static uint32_t ReferenceRGB9E5(const float rgb[3])
+{
+	const double maxValue = 65408.0;
+	double r = ReferenceClamp(rgb[0], maxValue);
+	double g = ReferenceClamp(rgb[1], maxValue);
+	double b = ReferenceClamp(rgb[2], maxValue);
+	double maxChannel = (std::max)(r, (std::max)(g, b));
+
+	int exponent = 0;
+	if (maxChannel > 0)
+	{
+		int log2Floor;
+		frexp(maxChannel, &log2Floor);
+		exponent = (std::max)(-16, log2Floor - 1) + 16;
+	}
+	double denominator = ldexp(1.0, exponent - 24);
+	if (floor(maxChannel / denominator + 0.5) == 512)
+	{
+		exponent++;
+		denominator *= 2;
+	}
+
+	uint32_t red = (uint32_t)floor(r / denominator + 0.5);
+	uint32_t green = (uint32_t)floor(g / denominator + 0.5);
+	uint32_t blue = (uint32_t)floor(b / denominator + 0.5);
+	return red | green << 9 | blue << 18 | (uint32_t)exponent << 27;
+}
+
+// --------------------------------------------------------
+// An unsigned float with 5 exponent bits (bias 15) and
+// mantissaBits, rounded to nearest even; values under the
+// smallest normal are steps of the smallest denormal
+// --------------------------------------------------------
+static uint32_t ReferenceSmallFloat(float value, int mantissaBits)
+{
+	double maxValue = ldexp(2.0 - ldexp(1.0, -mantissaBits), 15);
+	double v = ReferenceClamp(value, maxValue);
+	if (v < ldexp(1.0, -14))
+		return (uint32_t)nearbyint(v / ldexp(1.0, -14 - mantissaBits));
+
+	int exponent;
+	frexp(v, &exponent);
+	exponent--;
+	double steps = nearbyint(v / ldexp(1.0, exponent - mantissaBits));
+	// Rounding up to the next power of 2 carries into the exponent
+	return ((uint32_t)(exponent + 15) << mantissaBits) + (uint32_t)steps - (1u << mantissaBits);
+}
+
+static uint32_t ReferenceR11G11B10F(const float rgb[3])
+{
+	return ReferenceSmallFloat(rgb[0], 6) | ReferenceSmallFloat(rgb[1], 6) << 11 | ReferenceSmallFloat(rgb[2], 5) << 22;
+}
+
+static double ReferenceUnpackSmallFloat(uint32_t bits, int mantissaBits)
+{
+	uint32_t exponent = bits >> mantissaBits;
+	uint32_t mantissa = bits & ((1u << mantissaBits) - 1);
+	if (exponent == 0)
+		return ldexp((double)mantissa, -14 - mantissaBits);
+	return ldexp(1.0 + ldexp((double)mantissa, -mantissaBits), (int)exponent - 15);
+}
+
+// --------------------------------------------------------
+// RGBM: the smallest whole multiplier (in 255ths of the
+// range) that fits the brightest channel, then each channel
+// rounded to nearest in steps of multiplier * range / 65025.
+// D3D has no rules for it and the codec works in float, so
+// a texel whose exact values land within float rounding of
+// a rounding boundary may go either way.
+// --------------------------------------------------------
+static bool MatchesReferenceRGBM(const float rgb[3], uint32_t texel)
+{
+	const double range = PackedHDRRGBMRange;
+	const double tolerance = 1e-4;
+	double values[3];
+	for (int c = 0; c < 3; c++)
+		values[c] = ReferenceClamp(rgb[c], range);
+	double maxChannel = (std::max)(values[0], (std::max)(values[1], values[2]));
+
+	double exactMultiplier = maxChannel * 255.0 / range;
+	double multiplier = (std::max)(ceil(exactMultiplier), 1.0);
+	double texelMultiplier = texel >> 24;
+	if (texelMultiplier != multiplier &&
+		!(fabs(texelMultiplier - multiplier) == 1 && fabs(exactMultiplier - (std::min)(texelMultiplier, multiplier)) < tolerance))
+		return false;
+
+	double step = texelMultiplier * range / 65025.0;
+	for (int c = 0; c < 3; c++)
+	{
+		double exact = values[c] / step;
+		double channel = (std::min)(nearbyint(exact), 255.0);
+		double texelChannel = (texel >> (c * 8)) & 0xFF;
+		if (texelChannel != channel &&
+			!(fabs(texelChannel - channel) == 1 && fabs(exact - ((std::min)(texelChannel, channel) + 0.5)) < tolerance))
+			return false;
+	}
+	return true;
+}
+
+static bool MatchesReference(const float rgb[3], PackedHDRFormat format, uint32_t texel)
+{
+	switch (format)
+	{
+	case PACKED_HDR_RGB9E5: return texel == ReferenceRGB9E5(rgb);
+	case PACKED_HDR_R11G11B10F: return texel == ReferenceR11G11B10F(rgb);
+	default: return MatchesReferenceRGBM(rgb, texel);
+	}
+}
+
+TEST(PackedHDR, Names)
+{
+	CHECK(strcmp(GetPackedHDRFormatName(PACKED_HDR_RGB9E5), "RGB9E5") == 0);
+	CHECK(strcmp(GetPackedHDRFormatName(PACKED_HDR_R11G11B10F), "R11G11B10F") == 0);
+	CHECK(strcmp(GetPackedHDRFormatName(PACKED_HDR_RGBM), "RGBM") == 0);
+
+	// DXGI_FORMAT_R9G9B9E5_SHAREDEXP, R11G11B10_FLOAT and R8G8B8A8_UNORM
+	CHECK(GetPackedHDRDXGIFormat(PACKED_HDR_RGB9E5) == 67);
+	CHECK(GetPackedHDRDXGIFormat(PACKED_HDR_R11G11B10F) == 26);
+	CHECK(GetPackedHDRDXGIFormat(PACKED_HDR_RGBM) == 28);
+}
+
+TEST(PackedHDR, PacksLikeTheReference)
+{
+	const size_t count = 1000000;
+	std::vector<float> rgb = MakeColors(count, 1);
+	for (PackedHDRFormat format : Formats)
+	{
+		// The batch version on the same colors, with a count
+		// that leaves some for the single texel version
+		std::vector<uint32_t> batch(count - 1);
+		PackHDR(rgb.data(), batch.size(), format, batch.data());
+
+		size_t texelDifferences = 0, batchDifferences = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t texel = PackHDRTexel(&rgb[i * 3], format);
+			if (!MatchesReference(&rgb[i * 3], format, texel) && texelDifferences++ < 3)
+			{
+				printf("  %s (%g, %g, %g): %08X\n", GetPackedHDRFormatName(format),
+					rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], texel);
+			}
+			if (i < batch.size() && batch[i] != texel)
+				batchDifferences++;
+		}
+		CHECK(texelDifferences == 0);
+		CHECK(batchDifferences == 0);
+	}
+}
+
+TEST(PackedHDR, UnpacksLikeTheReference)
+{
+	// Every RGB9E5 exponent and mantissa
+	bool rgb9e5 = true;
+	for (uint32_t exponent = 0; exponent < 32; exponent++)
+	{
+		for (uint32_t mantissa = 0; mantissa < 512; mantissa++)
+		{
+			float rgb[3];
+			UnpackHDRTexel(mantissa | (511 - mantissa) << 9 | 1u << 18 | exponent << 27, PACKED_HDR_RGB9E5, rgb);
+			double scale = ldexp(1.0, (int)exponent - 24);
+			rgb9e5 = rgb9e5 && rgb[0] == mantissa * scale && rgb[1] == (511 - mantissa) * scale && rgb[2] == scale;
+		}
+	}
+	CHECK(rgb9e5);
+
+	// Every finite float11 and float10
+	bool smallFloats = true;
+	for (uint32_t bits = 0; bits < (31u << 6); bits++)
+	{
+		float rgb[3];
+		uint32_t blue = bits >> 1;
+		UnpackHDRTexel(bits | bits << 11 | blue << 22, PACKED_HDR_R11G11B10F, rgb);
+		smallFloats = smallFloats && rgb[0] == ReferenceUnpackSmallFloat(bits, 6) && rgb[1] == rgb[0];
+		smallFloats = smallFloats && rgb[2] == ReferenceUnpackSmallFloat(blue, 5);
+	}
+	CHECK(smallFloats);
+
+	float rgb[3];
+	UnpackHDRTexel(255 | 128 << 8 | 0 << 16 | 255u << 24, PACKED_HDR_RGBM, rgb);
+	CHECK(fabsf(rgb[0] - PackedHDRRGBMRange) < 1e-5f && fabsf(rgb[1] - PackedHDRRGBMRange * 128 / 255) < 1e-5f && rgb[2] == 0.0f);
+}
+
+TEST(PackedHDR, BatchUnpackMatchesTexels)
+{
+	// Random bit patterns, except R11G11B10F's Inf and NaN
+	// codes, which packing never makes
+	const size_t count = 100003;
+	uint64_t seed = 2;
+	std::vector<uint32_t> packed(count);
+	for (PackedHDRFormat format : Formats)
+	{
+		for (uint32_t& texel : packed)
+		{
+			texel = NextRandom(seed);
+			if (format == PACKED_HDR_R11G11B10F)
+				texel &= ~(1u << 10 | 1u << 21 | 1u << 31);
+		}
+
+		std::vector<float> batch(count * 3);
+		UnpackHDR(packed.data(), count, format, batch.data());
+		size_t differences = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			float rgb[3];
+			UnpackHDRTexel(packed[i], format, rgb);
+			differences += memcmp(rgb, &batch[i * 3], sizeof(rgb)) != 0;
+		}
+		CHECK(differences == 0);
+	}
+}
+
+TEST(PackedHDR, SpecialValues)
+{
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const float infinity = std::numeric_limits<float>::infinity();
+	const float special[3] = { nan, -5.0f, infinity };
+	const float largest[3][3] = { { 0, 0, 65408.0f }, { 0, 0, 64512.0f }, { 0, 0, PackedHDRRGBMRange } };
+	for (int f = 0; f < 3; f++)
+	{
+		float rgb[3];
+		UnpackHDRTexel(PackHDRTexel(special, Formats[f]), Formats[f], rgb);
+		CHECK(rgb[0] == 0.0f && rgb[1] == 0.0f);
+		CHECK(fabsf(rgb[2] - largest[f][2]) <= largest[f][2] * 1e-6f);
+
+		// The batch path handles them the same
+		float four[12] = { nan, -5.0f, infinity, -0.0f, 1e30f, -1e-30f, 1.0f, 2.0f, 3.0f, nan, nan, nan };
+		uint32_t packed[4];
+		PackHDR(four, 4, Formats[f], packed);
+		for (int i = 0; i < 4; i++)
+			CHECK(packed[i] == PackHDRTexel(&four[i * 3], Formats[f]));
+	}
+}
+
+TEST(PackedHDR, RoundTripError)
+{
+	// Within the documented bounds over ordinary HDR values
+	const size_t count = 200000;
+	uint64_t seed = 3;
+	std::vector<float> rgb(count * 3);
+	for (float& value : rgb)
+	{
+		uint32_t bits = NextRandom(seed);
+		value = ldexpf(1.0f + (bits >> 9) * ldexpf(1.0f, -23), (int)(bits % 16) - 8);
+	}
+
+	std::vector<uint32_t> packed(count);
+	std::vector<float> unpacked(count * 3);
+	for (PackedHDRFormat format : Formats)
+	{
+		PackHDR(rgb.data(), count, format, packed.data());
+		UnpackHDR(packed.data(), count, format, unpacked.data());
+
+		bool withinBounds = true;
+		for (size_t i = 0; i < count; i++)
+		{
+			const float* in = &rgb[i * 3];
+			const float* out = &unpacked[i * 3];
+			float maxChannel = (std::max)(in[0], (std::max)(in[1], in[2]));
+			for (int c = 0; c < 3; c++)
+			{
+				float error = fabsf(out[c] - in[c]);
+				if (format == PACKED_HDR_RGB9E5)
+					withinBounds = withinBounds && error <= maxChannel / 512;
+				else if (format == PACKED_HDR_R11G11B10F)
+					withinBounds = withinBounds && error <= in[c] / (c == 2 ? 64 : 128);
+				else if (maxChannel <= PackedHDRRGBMRange)
+					withinBounds = withinBounds && error <= 0.5f * ceilf(maxChannel * 255 / PackedHDRRGBMRange) * PackedHDRRGBMRange / 65025 * 1.0001f;
+			}
+		}
+		CHECK(withinBounds);
+	}
+}
@@ -0,0 +1,103 @@
+#include "TestHarness.h"
+#include "../ParallelFor.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// The shared worker pool
+// --------------------------------------------------------
+
+TEST(ParallelFor, RunsEveryItemOnce)
+{
+	for (unsigned int threads = 0; threads <= 4; threads++)
+	{
+		std::vector<std::atomic<unsigned int>> counts(1000);
+		for (std::atomic<unsigned int>& count : counts)
+			count = 0;
+
+		ParallelFor((unsigned int)counts.size(), threads, [&](unsigned int item) { counts[item]++; });
+
+		bool allOnce = true;
+		for (std::atomic<unsigned int>& count : counts)
+			allOnce = allOnce && count == 1;
+		CHECK(allOnce);
+	}
+}
+
+TEST(ParallelFor, HandlesNoItems)
+{
+	bool ran = false;
+	ParallelFor(0, 0, [&](unsigned int) { ran = true; });
+	CHECK(!ran);
+}
+
+TEST(ParallelFor, LimitsThreads)
+{
+	std::atomic<unsigned int> running(0);
+	std::atomic<unsigned int> mostRunning(0);
+	ParallelFor(64, 2, [&](unsigned int)
+	{
+		unsigned int now = ++running;
+		unsigned int most = mostRunning;
+		while (now > most && !mostRunning.compare_exchange_weak(most, now)) {}
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+		running--;
+	});
+	CHECK(mostRunning <= 2);
+	CHECK(GetParallelThreadCount() >= 1);
+}
+
+TEST(ParallelFor, NestsAndRunsFromManyThreads)
+{
+	// Loops inside loops, started from several threads at
+	// once, all sharing the one pool
+	std::atomic<unsigned int> total(0);
+	std::vector<std::thread> callers;
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		callers.emplace_back([&]()
+		{
+			ParallelFor(8, 0, [&](unsigned int)
+			{
+				ParallelFor(50, 0, [&](unsigned int) { total++; });
+			});
+		});
+	}
+
+	for (std::thread& caller : callers)
+		caller.join();
+	CHECK(total == 4 * 8 * 50);
+}
+
+TEST(ParallelFor, BandsCoverTheRangeOnce)
+{
+	unsigned int counts[] = { 1, 7, 100, 4099 };
+	unsigned int minBandSizes[] = { 1, 16, 1000 };
+	for (unsigned int count : counts)
+	{
+		for (unsigned int minBandSize : minBandSizes)
+		{
+			std::vector<std::atomic<unsigned int>> covered(count);
+			for (std::atomic<unsigned int>& c : covered)
+				c = 0;
+
+			std::atomic<unsigned int> shortBands(0);
+			ParallelForBands(count, minBandSize, 0, [&](unsigned int first, unsigned int end)
+			{
+				if (end - first < minBandSize && !(first == 0 && end == count))
+					shortBands++;
+				for (unsigned int i = first; i < end; i++)
+					covered[i]++;
+			});
+
+			bool allOnce = true;
+			for (std::atomic<unsigned int>& c : covered)
+				allOnce = allOnce && c == 1;
+			CHECK(allOnce);
+			CHECK(shortBands == 0);
+		}
+	}
+}
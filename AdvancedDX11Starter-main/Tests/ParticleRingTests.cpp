@@ -0,0 +1,226 @@
+#include "TestHarness.h"
+#include "../ParticleRing.h"
+
+#include <deque>
+#include <stdint.h>
+
+// --------------------------------------------------------
+// ParticleRing, driven the way Emitter drives it: retire
+// the expired particles, then spawn this frame's
+// --------------------------------------------------------
+
+// Checks that the spans cover exactly the live slots, oldest
+// first, ending at the first dead slot
+static bool SpansMatchRing(ParticleRing& ring)
+{
+	ParticleRing::Span spans[2];
+	int spanCount = ring.GetAliveSpans(spans);
+
+	int slot = ring.GetFirstAliveIndex();
+	int total = 0;
+	for (int i = 0; i < spanCount; i++)
+	{
+		if (spans[i].First != slot || spans[i].Count <= 0 || spans[i].First + spans[i].Count > ring.GetCapacity())
+			return false;
+		slot = (spans[i].First + spans[i].Count) % ring.GetCapacity();
+		total += spans[i].Count;
+	}
+	return total == ring.GetAliveCount() && (total == 0 || slot == ring.GetFirstDeadIndex());
+}
+
+TEST(ParticleRing, SpawnsIntoConsecutiveSlots)
+{
+	ParticleRing ring(4);
+	CHECK(ring.GetCapacity() == 4);
+	CHECK(ring.GetAliveCount() == 0);
+
+	CHECK(ring.Spawn(0.0f) == 0);
+	CHECK(ring.Spawn(0.1f) == 1);
+	CHECK(ring.Spawn(0.2f) == 2);
+	CHECK(ring.GetAliveCount() == 3);
+	CHECK(ring.GetFirstAliveIndex() == 0);
+	CHECK(ring.GetFirstDeadIndex() == 3);
+}
+
+TEST(ParticleRing, RefusesToSpawnWhenFull)
+{
+	ParticleRing ring(3);
+	for (int i = 0; i < 3; i++)
+		CHECK(ring.Spawn(0.0f) == i);
+	CHECK(ring.Spawn(0.0f) == -1);
+	CHECK(ring.GetAliveCount() == 3);
+	CHECK(ring.GetFirstAliveIndex() == ring.GetFirstDeadIndex());
+
+	ParticleRing empty;
+	CHECK(empty.Spawn(0.0f) == -1);
+	CHECK(empty.GetAliveCount() == 0);
+}
+
+TEST(ParticleRing, RetiresOldestFirst)
+{
+	ParticleRing ring(8);
+	for (int i = 0; i < 5; i++)
+		ring.Spawn((float)i);
+
+	// Exactly "lifetime" old counts as expired
+	ring.Retire(3.0f, 1.0f);
+	CHECK(ring.GetAliveCount() == 2);
+	CHECK(ring.GetFirstAliveIndex() == 3);
+
+	ring.Retire(3.0f, 1.0f);
+	CHECK(ring.GetAliveCount() == 2);
+
+	ring.Retire(100.0f, 1.0f);
+	CHECK(ring.GetAliveCount() == 0);
+	CHECK(ring.GetFirstAliveIndex() == ring.GetFirstDeadIndex());
+
+	ring.Retire(200.0f, 1.0f);
+	CHECK(ring.GetAliveCount() == 0);
+}
+
+TEST(ParticleRing, WrapsAroundTheEnd)
+{
+	ParticleRing ring(4);
+	for (int i = 0; i < 4; i++)
+		ring.Spawn((float)i);
+	ring.Retire(2.0f, 1.0f);
+	CHECK(ring.GetAliveCount() == 2);
+
+	CHECK(ring.Spawn(2.0f) == 0);
+	CHECK(ring.Spawn(2.0f) == 1);
+	CHECK(ring.Spawn(2.0f) == -1);
+	CHECK(ring.GetFirstAliveIndex() == 2);
+	CHECK(ring.GetFirstDeadIndex() == 2);
+
+	ring.Retire(3.0f, 1.0f);
+	CHECK(ring.GetAliveCount() == 3);
+	CHECK(ring.GetFirstAliveIndex() == 3);
+}
+
+TEST(ParticleRing, SpansAreOldestFirst)
+{
+	ParticleRing ring(6);
+	ParticleRing::Span spans[2];
+	CHECK(ring.GetAliveSpans(spans) == 0);
+
+	// Unwrapped
+	for (int i = 0; i < 4; i++)
+		ring.Spawn((float)i);
+	ring.Retire(1.0f, 1.0f);
+	REQUIRE(ring.GetAliveSpans(spans) == 1);
+	CHECK(spans[0].First == 1 && spans[0].Count == 3);
+
+	// Ending exactly at the end of the array
+	ring.Spawn(4.0f);
+	ring.Spawn(5.0f);
+	REQUIRE(ring.GetAliveSpans(spans) == 1);
+	CHECK(spans[0].First == 1 && spans[0].Count == 5);
+	CHECK(ring.GetFirstDeadIndex() == 0);
+
+	// Wrapped, and full with the indices meeting mid-array
+	ring.Spawn(6.0f);
+	REQUIRE(ring.GetAliveSpans(spans) == 2);
+	CHECK(spans[0].First == 1 && spans[0].Count == 5);
+	CHECK(spans[1].First == 0 && spans[1].Count == 1);
+	CHECK(SpansMatchRing(ring));
+
+	// Full, starting at slot 0
+	ParticleRing full(3);
+	for (int i = 0; i < 3; i++)
+		full.Spawn(0.0f);
+	REQUIRE(full.GetAliveSpans(spans) == 1);
+	CHECK(spans[0].First == 0 && spans[0].Count == 3);
+}
+
+TEST(ParticleRing, ResetEmptiesAndResizes)
+{
+	ParticleRing ring(4);
+	ring.Spawn(0.0f);
+	ring.Spawn(0.0f);
+
+	ring.Reset();
+	CHECK(ring.GetAliveCount() == 0);
+	CHECK(ring.GetCapacity() == 4);
+	CHECK(ring.Spawn(0.0f) == 0);
+
+	ring.Reset(10);
+	CHECK(ring.GetCapacity() == 10);
+	CHECK(ring.GetAliveCount() == 0);
+	for (int i = 0; i < 10; i++)
+		CHECK(ring.Spawn(0.0f) == i);
+	CHECK(ring.Spawn(0.0f) == -1);
+}
+
+// --------------------------------------------------------
+// Runs rings through uneven frame times with the emitter's
+// spawning arithmetic, checking every frame that the ring's
+// accounting matches a plain queue of spawn times: the live
+// count, and that it spans exactly from the first alive
+// index to the first dead one.  The first ring never fills;
+// the second is capped, so it spends most of the run full,
+// where the two indices meet.
+// --------------------------------------------------------
+TEST(ParticleRing, MatchesAQueueOverUnevenFrames)
+{
+	struct RingCase { int Capacity; int PerSecond; float Lifetime; };
+	const RingCase cases[] = { { 200000, 100000, 1.5f }, { 100000, 100000, 1.5f } };
+	const int frames = 300;
+	for (const RingCase& ringCase : cases)
+	{
+		ParticleRing ring(ringCase.Capacity);
+
+		// Each live particle's spawn time and slot
+		struct Spawned { float Time; int Slot; };
+		std::deque<Spawned> queue;
+
+		float secondsPerParticle = (float)(1.0 / ringCase.PerSecond);
+		float timeSinceEmit = 0.0f;
+		float time = 0.0f;
+		uint64_t spawned = 0;
+		uint32_t noise = 12345;
+		int wrongFrames = 0;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			// 1/240 to 1/15 of a second
+			noise = noise * 1664525 + 1013904223;
+			float dt = (1 + (noise >> 16) % 16) / 240.0f;
+			time += dt;
+
+			ring.Retire(time, ringCase.Lifetime);
+			while (!queue.empty() && time - queue.front().Time >= ringCase.Lifetime)
+				queue.pop_front();
+
+			bool slotsMatch = true;
+			timeSinceEmit += dt;
+			while (timeSinceEmit > secondsPerParticle)
+			{
+				int slot = ring.Spawn(time);
+				if ((int)queue.size() < ringCase.Capacity)
+				{
+					int expected = queue.empty() ? ring.GetFirstAliveIndex() : (queue.back().Slot + 1) % ringCase.Capacity;
+					slotsMatch = slotsMatch && slot == expected;
+					queue.push_back({ time, slot });
+					spawned++;
+				}
+				else
+				{
+					slotsMatch = slotsMatch && slot == -1;
+				}
+				timeSinceEmit -= secondsPerParticle;
+			}
+
+			int alive = ring.GetAliveCount();
+			int span = (ring.GetFirstDeadIndex() - ring.GetFirstAliveIndex() + ringCase.Capacity) % ringCase.Capacity;
+			if (span == 0 && alive == ringCase.Capacity)
+				span = ringCase.Capacity;
+			bool frontMatches = queue.empty() || queue.front().Slot == ring.GetFirstAliveIndex();
+			if (!slotsMatch || !frontMatches || alive != (int)queue.size() || span != alive || !SpansMatchRing(ring))
+				wrongFrames++;
+		}
+
+		CHECK(wrongFrames == 0);
+
+		// Make sure the run actually exercised wrapping
+		CHECK(spawned > 3 * (uint64_t)ringCase.Capacity);
+	}
+}
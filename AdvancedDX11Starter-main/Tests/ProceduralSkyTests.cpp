@@ -0,0 +1,274 @@
+#include "TestHarness.h"
+#include "../PackedHDR.h"
+#include "../ProceduralSky.h"
+
+#include <algorithm>
+#include <math.h>
+
+// --------------------------------------------------------
+// The procedural sky: the model, the baker's layout, bakes
+// spread over any number of updates matching whole ones,
+// double buffering, and how bakes are sliced to a budget.
+// Headless; nothing here touches D3D.
+// --------------------------------------------------------
+
+static ProceduralSkySettings MakeSettings(float hours)
+{
+	ProceduralSkySettings settings;
+	GetSunDirectionAtTime(hours, 60.0f, settings.SunDirection);
+	return settings;
+}
+
+static float Luminance(const float rgb[3])
+{
+	return 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+}
+
+TEST(ProceduralSky, SunPath)
+{
+	float direction[3];
+	GetSunDirectionAtTime(6.0f, 60.0f, direction);
+	CHECK(fabsf(direction[0] - 1.0f) < 1e-5f && fabsf(direction[1]) < 1e-5f);
+
+	GetSunDirectionAtTime(12.0f, 60.0f, direction);
+	CHECK(fabsf(direction[0]) < 1e-5f);
+	CHECK(fabsf(direction[1] - sinf(60.0f * 3.14159265f / 180.0f)) < 1e-5f);
+	CHECK(direction[2] > 0.0f);
+
+	GetSunDirectionAtTime(18.0f, 60.0f, direction);
+	CHECK(fabsf(direction[0] + 1.0f) < 1e-5f);
+
+	GetSunDirectionAtTime(0.0f, 60.0f, direction);
+	CHECK(direction[1] < 0.0f);
+}
+
+TEST(ProceduralSky, Model)
+{
+	PreethamSky sky;
+	SetupPreethamSky(MakeSettings(10.0f), sky);
+
+	// Brighter toward the sun than away from it, a blue sky
+	// overhead, and ground darker than the horizon above it
+	float towardSun[3], awayFromSun[3], up[3], horizon[3], ground[3];
+	const float opposite[3] = { -sky.SunDirection[0], sky.SunDirection[1], -sky.SunDirection[2] };
+	const float upDirection[3] = { 0, 1, 0 }, horizonDirection[3] = { 0, 0, 1 }, groundDirection[3] = { 0, -1, 1 };
+	EvaluatePreethamSky(sky, sky.SunDirection, towardSun);
+	EvaluatePreethamSky(sky, opposite, awayFromSun);
+	EvaluatePreethamSky(sky, upDirection, up);
+	EvaluatePreethamSky(sky, horizonDirection, horizon);
+	EvaluatePreethamSky(sky, groundDirection, ground);
+	CHECK(Luminance(towardSun) > 2.0f * Luminance(awayFromSun));
+	CHECK(up[2] > up[0]);
+	CHECK(Luminance(ground) < Luminance(horizon));
+	CHECK(Luminance(ground) > 0.0f);
+
+	// Normalizing isn't the caller's job
+	float scaled[3];
+	const float longUp[3] = { 0, 7, 0 };
+	EvaluatePreethamSky(sky, longUp, scaled);
+	for (int c = 0; c < 3; c++)
+		CHECK(fabsf(scaled[c] - up[c]) <= 1e-6f * up[c]);
+
+	// Dark once the sun is well down
+	SetupPreethamSky(MakeSettings(19.0f), sky);
+	EvaluatePreethamSky(sky, upDirection, up);
+	CHECK(up[0] == 0.0f && up[1] == 0.0f && up[2] == 0.0f);
+}
+
+TEST(ProceduralSky, MapLayout)
+{
+	// Sizes round up to a power of 2, the specular cube is
+	// half the sky, and its mips are limited to its chain
+	ProceduralSkyBaker baker(100, 8, 20, 8);
+	const ProceduralSkyMaps& maps = baker.GetMaps();
+	CHECK(maps.SkySize == 128);
+	CHECK(maps.IrradianceSize == 8);
+	CHECK(maps.SpecularSize == 64);
+	CHECK(maps.SpecularMipLevels == 7);
+	CHECK(maps.Sky.size() == 128 * 128 * 6);
+	CHECK(maps.Irradiance.size() == 8 * 8 * 6);
+	CHECK(maps.GetSkyFace(2) == &maps.Sky[2 * 128 * 128]);
+	CHECK(maps.GetIrradianceFace(5) == &maps.Irradiance[5 * 8 * 8]);
+
+	// Every mip of a face, then the next
+	size_t offset = 0;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (unsigned int mip = 0; mip < maps.SpecularMipLevels; mip++)
+		{
+			CHECK(maps.GetSpecularMipSize(mip) == 64u >> mip);
+			CHECK(maps.GetSpecularOffset(face, mip) == offset);
+			CHECK(maps.GetSpecularSubresource(face, mip) == &maps.Specular[offset]);
+			offset += (size_t)(64u >> mip) * (64u >> mip);
+		}
+	}
+	CHECK(maps.Specular.size() == offset);
+
+	// Black until the first bake
+	CHECK(maps.Generation == 0);
+	CHECK(std::all_of(maps.Sky.begin(), maps.Sky.end(), [](uint32_t texel) { return texel == 0; }));
+}
+
+TEST(ProceduralSky, NothingToDoWithoutARequest)
+{
+	ProceduralSkyBaker baker(16, 4, 3, 4);
+	CHECK(!baker.Update(1.0));
+	CHECK(!baker.IsBaking());
+	CHECK(baker.GetStats().Updates == 0);
+	baker.Finish();
+	CHECK(baker.GetMaps().Generation == 0);
+}
+
+TEST(ProceduralSky, SlicedBakesMatchWholeOnes)
+{
+	// A budget of nothing still makes a row of progress per
+	// update, so this is the finest slicing there is
+	ProceduralSkySettings settings = MakeSettings(9.0f);
+	ProceduralSkyBaker whole(64, 8, 4, 16);
+	whole.Request(settings);
+	whole.Finish();
+
+	const double budgets[] = { 0.0, 0.3, 1000.0 };
+	for (double budget : budgets)
+	{
+		ProceduralSkyBaker sliced(64, 8, 4, 16);
+		sliced.Request(settings);
+		unsigned int updates = 0;
+		while (!sliced.Update(budget))
+		{
+			updates++;
+			REQUIRE(updates < 100000);
+		}
+
+		const ProceduralSkyMaps& a = whole.GetMaps();
+		const ProceduralSkyMaps& b = sliced.GetMaps();
+		CHECK(a.Sky == b.Sky);
+		CHECK(a.Irradiance == b.Irradiance);
+		CHECK(a.Specular == b.Specular);
+		CHECK(b.Generation == 1);
+		CHECK(sliced.GetStats().CompletedBakes == 1);
+		CHECK(sliced.GetStats().LastBakeUpdates == updates + 1);
+	}
+}
+
+TEST(ProceduralSky, MapsFollowTheSky)
+{
+	ProceduralSkyBaker baker(64, 8, 4, 16);
+	baker.Request(MakeSettings(12.0f));
+	baker.Finish();
+	const ProceduralSkyMaps& maps = baker.GetMaps();
+
+	// The sky is stored gamma encoded, as drawn
+	PreethamSky model;
+	SetupPreethamSky(maps.Settings, model);
+	float direction[3], expected[3], stored[3];
+	GetCubemapDirection(2, 10.5f / 64, 20.5f / 64, direction);
+	EvaluatePreethamSky(model, direction, expected);
+	UnpackHDRTexel(maps.GetSkyFace(2)[20 * 64 + 10], PACKED_HDR_RGB9E5, stored);
+	for (int c = 0; c < 3; c++)
+		CHECK(fabsf(powf(stored[c], 2.2f) - expected[c]) <= 0.01f * Luminance(expected) + 1e-4f);
+
+	// At noon, more light falls on a surface facing up (+Y,
+	// face 2) than down (-Y, face 3)
+	float irradianceUp[3], irradianceDown[3];
+	UnpackHDRTexel(maps.GetIrradianceFace(2)[4 * 8 + 4], PACKED_HDR_RGB9E5, irradianceUp);
+	UnpackHDRTexel(maps.GetIrradianceFace(3)[4 * 8 + 4], PACKED_HDR_RGB9E5, irradianceDown);
+	CHECK(Luminance(irradianceUp) > 2.0f * Luminance(irradianceDown));
+
+	// The roughest specular mip is about as smooth as irradiance
+	const unsigned int lastMip = maps.SpecularMipLevels - 1;
+	float roughUp[3];
+	unsigned int lastSize = maps.GetSpecularMipSize(lastMip);
+	UnpackHDRTexel(maps.GetSpecularSubresource(2, lastMip)[(lastSize / 2) * lastSize + lastSize / 2], PACKED_HDR_RGB9E5, roughUp);
+	CHECK(Luminance(roughUp) > Luminance(irradianceDown));
+}
+
+TEST(ProceduralSky, DoubleBuffersAndQueuesRequests)
+{
+	ProceduralSkyBaker baker(32, 4, 3, 8);
+	ProceduralSkySettings morning = MakeSettings(8.0f), evening = MakeSettings(16.0f);
+	baker.Request(morning);
+	baker.Finish();
+	std::vector<uint32_t> morningSky = baker.GetMaps().Sky;
+
+	// Partway through the next bake, the maps are still the
+	// last complete ones, and a new request waits its turn
+	baker.Request(evening);
+	CHECK(!baker.Update(0.0));
+	CHECK(baker.IsBaking());
+	CHECK(baker.GetProgress() > 0.0f && baker.GetProgress() < 1.0f);
+	CHECK(baker.GetMaps().Sky == morningSky);
+	CHECK(baker.GetMaps().Generation == 1);
+
+	baker.Request(morning);
+	CHECK(baker.HasPendingRequest());
+	while (!baker.Update(0.0)) {}
+	CHECK(baker.GetMaps().Generation == 2);
+	CHECK(baker.GetMaps().Settings.SunDirection[0] == evening.SunDirection[0]);
+	CHECK(baker.GetMaps().Sky != morningSky);
+	CHECK(baker.HasPendingRequest());
+	CHECK(!baker.IsBaking());
+
+	// Then the queued one, back to the first sky
+	baker.Finish();
+	CHECK(baker.GetMaps().Generation == 3);
+	CHECK(baker.GetMaps().Sky == morningSky);
+	CHECK(!baker.HasPendingRequest());
+}
+
+TEST(ProceduralSky, PlansSlicesToFit)
+{
+	// Whole rows that fit in what's left, never more than
+	// the step has
+	CHECK(ProceduralSkyBaker::PlanSliceRows(100.0, 1000.0, 50, false) == 10);
+	CHECK(ProceduralSkyBaker::PlanSliceRows(100.0, 999.0, 50, true) == 9);
+	CHECK(ProceduralSkyBaker::PlanSliceRows(100.0, 1000.0, 4, true) == 4);
+	CHECK(ProceduralSkyBaker::PlanSliceRows(100.0, 1e12, 256, true) == 256);
+
+	// Nothing fits: one row to make progress, then stop
+	CHECK(ProceduralSkyBaker::PlanSliceRows(100.0, 50.0, 50, false) == 1);
+	CHECK(ProceduralSkyBaker::PlanSliceRows(100.0, 50.0, 50, true) == 0);
+	CHECK(ProceduralSkyBaker::PlanSliceRows(100.0, -20.0, 50, false) == 1);
+	CHECK(ProceduralSkyBaker::PlanSliceRows(100.0, -20.0, 50, true) == 0);
+
+	// No estimate yet: one row, to measure
+	CHECK(ProceduralSkyBaker::PlanSliceRows(0.0, 1e12, 50, false) == 1);
+	CHECK(ProceduralSkyBaker::PlanSliceRows(0.0, 1e12, 50, true) == 1);
+}
+
+TEST(ProceduralSky, SlicesBakesByBudget)
+{
+	// A 16 across sky has 16 + 8 + 4 + 2 + 1 rows of mips, its
+	// 16x16 mip is projected, and the irradiance (4) and
+	// specular cubes (8 and 4) follow, for each face
+	const unsigned int totalRows = 6 * ((16 + 8 + 4 + 2 + 1) + 16 + 4 + (8 + 4));
+	ProceduralSkyBaker baker(16, 4, 2, 4);
+	baker.Request(MakeSettings(10.0f));
+	baker.Finish();
+	baker.ResetStats();
+
+	// With no budget, each update is a single row
+	baker.Request(MakeSettings(11.0f));
+	CHECK(!baker.Update(0.0));
+	CHECK(baker.GetProgress() * totalRows > 0.5f && baker.GetProgress() * totalRows < 1.5f);
+	unsigned int updates = 1;
+	while (!baker.Update(0.0))
+	{
+		updates++;
+		REQUIRE(updates < totalRows);
+	}
+	CHECK(updates + 1 == totalRows);
+	CHECK(baker.GetStats().LastBakeUpdates == totalRows);
+	CHECK(baker.GetStats().Updates == totalRows);
+	CHECK(baker.GetStats().CompletedBakes == 1);
+
+	// With more than enough, the whole bake is one update
+	baker.Request(MakeSettings(12.0f));
+	CHECK(baker.Update(1e9));
+	CHECK(baker.GetStats().LastBakeUpdates == 1);
+	CHECK(baker.GetStats().CompletedBakes == 2);
+
+	// And with nothing requested, updates do nothing
+	CHECK(!baker.Update(1e9));
+	CHECK(baker.GetStats().Updates == totalRows + 1);
+}
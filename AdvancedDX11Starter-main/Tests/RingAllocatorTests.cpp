@@ -0,0 +1,163 @@
+#include "TestHarness.h"
+#include "../RingAllocator.h"
+
+// --------------------------------------------------------
+// RingAllocator, driven the way ConstantRing drives it:
+// allocations, a fence at the end of each frame, and
+// frames retired once their GPU fence has passed
+// --------------------------------------------------------
+
+TEST(RingAllocator, AlignsAllocations)
+{
+	RingAllocator ring(4096, 256);
+	CHECK(ring.Allocate(1) == 0);
+	CHECK(ring.Allocate(100) == 256);
+	CHECK(ring.Allocate(257) == 512);
+	CHECK(ring.Allocate(256) == 1024);
+	CHECK(ring.GetUsed() == 1280);
+	CHECK(ring.GetFrameBytes() == 1280);
+}
+
+TEST(RingAllocator, RoundsCapacityToAlignment)
+{
+	RingAllocator ring(1000, 256);
+	CHECK(ring.GetCapacity() == 768);
+
+	ring.Reset(2100);
+	CHECK(ring.GetCapacity() == 2048);
+}
+
+TEST(RingAllocator, RejectsEmptyAndOversizedAllocations)
+{
+	RingAllocator ring(1024, 256);
+	CHECK(ring.Allocate(0) == RingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(1025) == RingAllocator::InvalidOffset);
+	CHECK(ring.GetUsed() == 0);
+}
+
+TEST(RingAllocator, NeverReusesUnretiredSpace)
+{
+	RingAllocator ring(1024, 256);
+	for (int i = 0; i < 4; i++)
+		CHECK(ring.Allocate(256) == (size_t)i * 256);
+	ring.EndFrame(0);
+
+	// Full, and the frame is still "on the GPU"
+	CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+	CHECK(ring.GetPendingFrames() == 1);
+
+	ring.RetireFrame(0);
+	CHECK(ring.GetPendingFrames() == 0);
+	CHECK(ring.GetUsed() == 0);
+	CHECK(ring.Allocate(1024) == 0);
+}
+
+TEST(RingAllocator, WrapsPastTheEnd)
+{
+	RingAllocator ring(1024, 256);
+	CHECK(ring.Allocate(512) == 0);
+	ring.EndFrame(0);
+	CHECK(ring.Allocate(256) == 512);
+	ring.EndFrame(1);
+	ring.RetireFrame(0);
+
+	// [768, 1024) is too small, so this wraps to the start,
+	// and the skipped tail counts as used
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.GetUsed() == 1024);
+	CHECK(ring.Allocate(256) == RingAllocator::InvalidOffset);
+
+	// Retiring frame 1 frees its slice.  The skipped tail
+	// belongs to the frame that wrapped, so it stays used.
+	ring.RetireFrame(1);
+	CHECK(ring.GetUsed() == 768);
+	CHECK(ring.Allocate(256) == 512);
+	ring.EndFrame(2);
+
+	ring.RetireFrame(2);
+	CHECK(ring.GetUsed() == 0);
+}
+
+TEST(RingAllocator, StopsAtTheTailAfterWrapping)
+{
+	RingAllocator ring(1024, 256);
+	CHECK(ring.Allocate(256) == 0);
+	ring.EndFrame(0);
+	CHECK(ring.Allocate(512) == 256);
+	ring.EndFrame(1);
+	ring.RetireFrame(0);
+
+	// Free space is [768, 1024) and [0, 256)
+	CHECK(ring.Allocate(256) == 768);
+	CHECK(ring.Allocate(256) == 0);
+	CHECK(ring.Allocate(256) == RingAllocator::InvalidOffset);
+}
+
+TEST(RingAllocator, RetiresEveryFrameUpToTheOneGiven)
+{
+	RingAllocator ring(4096, 256);
+	for (uint64_t frame = 0; frame < 3; frame++)
+	{
+		ring.Allocate(512);
+		ring.EndFrame(frame);
+		CHECK(ring.GetFrameBytes() == 0);
+	}
+	CHECK(ring.GetPendingFrames() == 3);
+	CHECK(ring.GetUsed() == 1536);
+
+	// Fences pass in order, so a later one covers earlier frames
+	ring.RetireFrame(1);
+	CHECK(ring.GetPendingFrames() == 1);
+	CHECK(ring.GetUsed() == 512);
+
+	ring.RetireFrame(2);
+	CHECK(ring.GetUsed() == 0);
+}
+
+TEST(RingAllocator, RestartsFromZeroWhenIdle)
+{
+	RingAllocator ring(1024, 256);
+	ring.Allocate(768);
+	ring.EndFrame(0);
+	ring.RetireFrame(0);
+
+	// Nothing in flight, so a large allocation gets the whole
+	// ring rather than failing on the short run left at the end
+	CHECK(ring.Allocate(1024) == 0);
+}
+
+TEST(RingAllocator, SteadyStateFramesInFlight)
+{
+	// Three frames in flight with a fence lagging two behind,
+	// as ConstantRing sees it with a GPU a couple frames back
+	RingAllocator ring(64 * 1024, 256);
+	for (uint64_t frame = 0; frame < 1000; frame++)
+	{
+		if (frame >= 2)
+			ring.RetireFrame(frame - 2);
+
+		for (unsigned int i = 0; i < 20; i++)
+		{
+			size_t size = 64 + (size_t)((frame * 7 + i * 13) % 700);
+			size_t offset = ring.Allocate(size);
+			REQUIRE(offset != RingAllocator::InvalidOffset);
+			CHECK(offset % 256 == 0);
+			CHECK(offset + size <= ring.GetCapacity());
+		}
+
+		ring.EndFrame(frame);
+		CHECK(ring.GetPendingFrames() <= 3);
+		CHECK(ring.GetUsed() <= ring.GetCapacity());
+	}
+}
+
+TEST(RingAllocator, ResetDropsFences)
+{
+	RingAllocator ring(1024, 256);
+	ring.Allocate(1024);
+	ring.EndFrame(0);
+	ring.Reset();
+	CHECK(ring.GetPendingFrames() == 0);
+	CHECK(ring.GetUsed() == 0);
+	CHECK(ring.Allocate(512) == 0);
+}
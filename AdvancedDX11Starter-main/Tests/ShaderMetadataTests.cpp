@@ -0,0 +1,267 @@
+#include "TestHarness.h"
+#include "../MappedFile.h"
+#include "../ShaderMetadata.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// The reflection cache: round trips through a file, and
+// rejection of anything stale or damaged
+// --------------------------------------------------------
+
+static ShaderMetadata MakeMetadata()
+{
+	ShaderMetadata metadata;
+	metadata.SourceHash = 0x0123456789ABCDEFull;
+
+	ShaderMetadataBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.Type = 0;
+	perFrame.BindIndex = 0;
+	perFrame.Size = 80;
+	perFrame.Variables.push_back({ "view", 0, 64 });
+	perFrame.Variables.push_back({ "cameraPosition", 64, 12 });
+	metadata.Buffers.push_back(perFrame);
+
+	ShaderMetadataBuffer perObject;
+	perObject.Name = "perObject";
+	perObject.Type = 0;
+	perObject.BindIndex = 1;
+	perObject.Size = 64;
+	perObject.Variables.push_back({ "world", 0, 64 });
+	metadata.Buffers.push_back(perObject);
+
+	metadata.Textures.push_back({ "Albedo", 0 });
+	metadata.Textures.push_back({ "NormalMap", 1 });
+	metadata.Samplers.push_back({ "BasicSampler", 0 });
+	metadata.Inputs.push_back({ "POSITION", 0, 7, 3 });
+	metadata.Inputs.push_back({ "TEXCOORD", 0, 3, 3 });
+	return metadata;
+}
+
+static bool SameMetadata(const ShaderMetadata& a, const ShaderMetadata& b)
+{
+	if (a.SourceHash != b.SourceHash ||
+		a.Buffers.size() != b.Buffers.size() ||
+		a.Textures.size() != b.Textures.size() ||
+		a.Samplers.size() != b.Samplers.size() ||
+		a.Inputs.size() != b.Inputs.size())
+		return false;
+
+	for (size_t i = 0; i < a.Buffers.size(); i++)
+	{
+		const ShaderMetadataBuffer& x = a.Buffers[i];
+		const ShaderMetadataBuffer& y = b.Buffers[i];
+		if (x.Name != y.Name || x.Type != y.Type || x.BindIndex != y.BindIndex ||
+			x.Size != y.Size || x.Variables.size() != y.Variables.size())
+			return false;
+
+		for (size_t v = 0; v < x.Variables.size(); v++)
+		{
+			if (x.Variables[v].Name != y.Variables[v].Name ||
+				x.Variables[v].ByteOffset != y.Variables[v].ByteOffset ||
+				x.Variables[v].Size != y.Variables[v].Size)
+				return false;
+		}
+	}
+
+	for (size_t i = 0; i < a.Textures.size(); i++)
+		if (a.Textures[i].Name != b.Textures[i].Name || a.Textures[i].BindIndex != b.Textures[i].BindIndex)
+			return false;
+
+	for (size_t i = 0; i < a.Samplers.size(); i++)
+		if (a.Samplers[i].Name != b.Samplers[i].Name || a.Samplers[i].BindIndex != b.Samplers[i].BindIndex)
+			return false;
+
+	for (size_t i = 0; i < a.Inputs.size(); i++)
+	{
+		if (a.Inputs[i].SemanticName != b.Inputs[i].SemanticName ||
+			a.Inputs[i].SemanticIndex != b.Inputs[i].SemanticIndex ||
+			a.Inputs[i].Mask != b.Inputs[i].Mask ||
+			a.Inputs[i].ComponentType != b.Inputs[i].ComponentType)
+			return false;
+	}
+
+	return true;
+}
+
+TEST(ShaderMetadata, RoundTripsThroughAFile)
+{
+	ShaderMetadata metadata = MakeMetadata();
+	std::vector<unsigned char> bytes;
+	metadata.Serialize(bytes);
+
+	std::string path = GetTestTempFolder() + "Shader.cso.meta";
+	REQUIRE(WriteFileReplacing(path.c_str(), bytes.data(), bytes.size()));
+
+	MappedFile file;
+	REQUIRE(file.Open(path.c_str()));
+	CHECK(file.GetSize() == bytes.size());
+
+	ShaderMetadata parsed;
+	CHECK(parsed.Parse(file.GetData(), file.GetSize(), metadata.SourceHash));
+	CHECK(SameMetadata(metadata, parsed));
+}
+
+TEST(ShaderMetadata, RoundTripsEmptyMetadata)
+{
+	ShaderMetadata metadata;
+	metadata.SourceHash = 42;
+	std::vector<unsigned char> bytes;
+	metadata.Serialize(bytes);
+
+	ShaderMetadata parsed;
+	CHECK(parsed.Parse(bytes.data(), bytes.size(), 42));
+	CHECK(SameMetadata(metadata, parsed));
+}
+
+TEST(ShaderMetadata, RejectsAnotherShadersCache)
+{
+	ShaderMetadata metadata = MakeMetadata();
+	std::vector<unsigned char> bytes;
+	metadata.Serialize(bytes);
+
+	ShaderMetadata parsed;
+	CHECK(!parsed.Parse(bytes.data(), bytes.size(), metadata.SourceHash + 1));
+}
+
+TEST(ShaderMetadata, RejectsOtherVersions)
+{
+	ShaderMetadata metadata = MakeMetadata();
+	std::vector<unsigned char> bytes;
+	metadata.Serialize(bytes);
+
+	// The version follows the 4 byte magic
+	bytes[4]++;
+	ShaderMetadata parsed;
+	CHECK(!parsed.Parse(bytes.data(), bytes.size(), metadata.SourceHash));
+}
+
+TEST(ShaderMetadata, RejectsEveryTruncation)
+{
+	ShaderMetadata metadata = MakeMetadata();
+	std::vector<unsigned char> bytes;
+	metadata.Serialize(bytes);
+
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		ShaderMetadata parsed;
+		CHECK(!parsed.Parse(bytes.data(), size, metadata.SourceHash));
+	}
+
+	bytes.push_back(0);
+	ShaderMetadata parsed;
+	CHECK(!parsed.Parse(bytes.data(), bytes.size(), metadata.SourceHash));
+}
+
+TEST(ShaderMetadata, SurvivesCorruptBytes)
+{
+	ShaderMetadata metadata = MakeMetadata();
+	std::vector<unsigned char> bytes;
+	metadata.Serialize(bytes);
+
+	// Damage each byte in turn.  Parse() may accept some
+	// (a changed bind index is still well formed), but must
+	// never read out of bounds or fail to return.
+	unsigned int rejected = 0;
+	for (size_t i = 0; i < bytes.size(); i++)
+	{
+		std::vector<unsigned char> corrupt = bytes;
+		corrupt[i] ^= 0xA5;
+
+		ShaderMetadata parsed;
+		if (!parsed.Parse(corrupt.data(), corrupt.size(), metadata.SourceHash))
+			rejected++;
+	}
+	CHECK(rejected > 0);
+
+	// Counts and string offsets that point past the end
+	std::vector<unsigned char> huge = bytes;
+	for (size_t i = 16; i < 40; i++)
+		huge[i] = 0xFF;
+	ShaderMetadata parsed;
+	CHECK(!parsed.Parse(huge.data(), huge.size(), metadata.SourceHash));
+}
+
+TEST(ShaderMetadata, ReplacingAFileKeepsNoTemporaries)
+{
+	std::string path = GetTestTempFolder() + "Replaced.meta";
+	const char first[] = "first version";
+	const char second[] = "second";
+	REQUIRE(WriteFileReplacing(path.c_str(), first, sizeof(first)));
+	REQUIRE(WriteFileReplacing(path.c_str(), second, sizeof(second)));
+
+	MappedFile file;
+	REQUIRE(file.Open(path.c_str()));
+	CHECK(file.GetSize() == sizeof(second));
+	CHECK(memcmp(file.GetData(), second, sizeof(second)) == 0);
+
+	// A folder that doesn't exist can't be written to
+	std::string badPath = GetTestTempFolder() + "Missing/File.meta";
+	CHECK(!WriteFileReplacing(badPath.c_str(), first, sizeof(first)));
+}
+
+TEST(MappedFile, FailsForMissingAndEmptyFiles)
+{
+	MappedFile file;
+	CHECK(!file.Open((GetTestTempFolder() + "DoesNotExist").c_str()));
+	CHECK(!file.IsOpen());
+
+	std::string emptyPath = GetTestTempFolder() + "Empty";
+	FILE* empty = fopen(emptyPath.c_str(), "wb");
+	REQUIRE(empty);
+	fclose(empty);
+	CHECK(!file.Open(emptyPath.c_str()));
+	CHECK(file.GetSize() == 0);
+}
+
+TEST(MappedFile, ReopensAndCloses)
+{
+	std::string path = GetTestTempFolder() + "Bytes";
+	unsigned char bytes[300];
+	for (unsigned int i = 0; i < sizeof(bytes); i++)
+		bytes[i] = (unsigned char)i;
+	REQUIRE(WriteFileReplacing(path.c_str(), bytes, sizeof(bytes)));
+
+	MappedFile file;
+	REQUIRE(file.Open(path.c_str()));
+	REQUIRE(file.Open(path.c_str()));
+	CHECK(file.GetSize() == sizeof(bytes));
+	CHECK(memcmp(file.GetData(), bytes, sizeof(bytes)) == 0);
+
+	file.Close();
+	CHECK(!file.IsOpen());
+	CHECK(file.GetData() == 0);
+}
+
+TEST(ShaderMetadata, LayoutHashCoversEveryField)
+{
+	ShaderMetadata metadata = MakeMetadata();
+	const ShaderMetadataBuffer& original = metadata.Buffers[0];
+	uint32_t hash = original.LayoutHash();
+	CHECK(hash == MakeMetadata().Buffers[0].LayoutHash());
+
+	ShaderMetadataBuffer renamed = original;
+	renamed.Variables[1].Name = "cameraPos";
+	CHECK(renamed.LayoutHash() != hash);
+
+	ShaderMetadataBuffer moved = original;
+	moved.Variables[1].ByteOffset = 68;
+	CHECK(moved.LayoutHash() != hash);
+
+	ShaderMetadataBuffer resized = original;
+	resized.Variables[1].Size = 16;
+	CHECK(resized.LayoutHash() != hash);
+
+	ShaderMetadataBuffer grown = original;
+	grown.Size = 96;
+	CHECK(grown.LayoutHash() != hash);
+
+	// Only the layout counts, not where the buffer's bound
+	// or what it's called
+	ShaderMetadataBuffer rebound = original;
+	rebound.Name = "perView";
+	rebound.BindIndex = 3;
+	CHECK(rebound.LayoutHash() == hash);
+}
@@ -0,0 +1,124 @@
+#include "TestHarness.h"
+#include "../ShaderMetadata.h"
+#include "../ShaderStructs.h"
+
+#include <string.h>
+
+// --------------------------------------------------------
+// The structs Tools/GenerateShaderStructs.py writes, against
+// layouts worked out by hand from HLSL's packing rules, and
+// their layout hashes against the ones SimpleShader gets
+// from reflecting the same buffers
+// --------------------------------------------------------
+
+TEST(ShaderStructs, LightMatchesHLSL)
+{
+	CHECK(offsetof(Light, Type) == 0);
+	CHECK(offsetof(Light, Direction) == 4);
+	CHECK(offsetof(Light, Range) == 16);
+	CHECK(offsetof(Light, Position) == 20);
+	CHECK(offsetof(Light, Intensity) == 32);
+	CHECK(offsetof(Light, Color) == 36);
+	CHECK(offsetof(Light, SpotFalloff) == 48);
+	CHECK(offsetof(Light, Padding) == 52);
+	CHECK(sizeof(Light) == 64);
+}
+
+TEST(ShaderStructs, PacksAcrossRegisters)
+{
+	// float3 then float2s: the first float2 can't share the
+	// float3's register, the second shares the first's
+	CHECK(offsetof(PixelShaderPBRPerMaterial, colorTint) == 0);
+	CHECK(offsetof(PixelShaderPBRPerMaterial, uvScale) == 16);
+	CHECK(offsetof(PixelShaderPBRPerMaterial, uvOffset) == 24);
+	CHECK(sizeof(PixelShaderPBRPerMaterial) == 32);
+
+	// An int fills the gap in front of a float2
+	CHECK(offsetof(LightRayPSExternalData, numSamples) == 0);
+	CHECK(offsetof(LightRayPSExternalData, lightPosScreenSpace) == 4);
+	CHECK(offsetof(LightRayPSExternalData, density) == 12);
+	CHECK(offsetof(LightRayPSExternalData, exposure) == 24);
+	CHECK(sizeof(LightRayPSExternalData) == 32);
+
+	// A float3 after a matrix starts a new register, and the
+	// float4 after it can't share that one
+	CHECK(offsetof(ParticleVSExternalData, acceleration) == 128);
+	CHECK(offsetof(ParticleVSExternalData, startColor) == 144);
+	CHECK(offsetof(ParticleVSExternalData, startSize) == 176);
+	CHECK(sizeof(ParticleVSExternalData) == 192);
+}
+
+TEST(ShaderStructs, PacksStructArrays)
+{
+	CHECK(offsetof(PixelShaderPBRPerFrame, lights) == 0);
+	CHECK(offsetof(PixelShaderPBRPerFrame, lightCount) == 64 * 128);
+	CHECK(offsetof(PixelShaderPBRPerFrame, cameraPosition) == 64 * 128 + 4);
+	CHECK(offsetof(PixelShaderPBRPerFrame, SpecIBLTotalMipLevels) == 64 * 128 + 16);
+	CHECK(sizeof(PixelShaderPBRPerFrame) == 64 * 128 + 32);
+
+	CHECK(offsetof(SsaoPSExternalData, offsets) == 192);
+	CHECK(offsetof(SsaoPSExternalData, ssaoRadius) == 192 + 64 * 16);
+	CHECK(sizeof(SsaoPSExternalData) == 1232);
+}
+
+TEST(ShaderStructs, NamesTheirBuffers)
+{
+	CHECK(strcmp(PixelShaderPBRPerFrame::BufferName, "perFrame") == 0);
+	CHECK(strcmp(PixelShaderPBRPerMaterial::BufferName, "perMaterial") == 0);
+	CHECK(strcmp(VertexShaderExternalData::BufferName, "externalData") == 0);
+	CHECK(strcmp(IBLSpecularConvolutionPSData::BufferName, "data") == 0);
+}
+
+TEST(ShaderStructs, HashesMatchReflection)
+{
+	// What reflecting VertexShader.hlsl's buffer gives
+	ShaderMetadataBuffer externalData;
+	externalData.Name = "externalData";
+	externalData.Type = 0;
+	externalData.BindIndex = 0;
+	externalData.Size = 256;
+	externalData.Variables.push_back({ "world", 0, 64 });
+	externalData.Variables.push_back({ "worldInverseTranspose", 64, 64 });
+	externalData.Variables.push_back({ "view", 128, 64 });
+	externalData.Variables.push_back({ "projection", 192, 64 });
+	CHECK(externalData.LayoutHash() == VertexShaderExternalData::LayoutHash);
+
+	// And PixelShaderPBR.hlsl's perFrame, where the array's
+	// size is every element, padding and all
+	ShaderMetadataBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.Type = 0;
+	perFrame.BindIndex = 1;
+	perFrame.Size = 8224;
+	perFrame.Variables.push_back({ "lights", 0, 8192 });
+	perFrame.Variables.push_back({ "lightCount", 8192, 4 });
+	perFrame.Variables.push_back({ "cameraPosition", 8196, 12 });
+	perFrame.Variables.push_back({ "SpecIBLTotalMipLevels", 8208, 4 });
+	CHECK(perFrame.LayoutHash() == PixelShaderPBRPerFrame::LayoutHash);
+}
+
+TEST(ShaderStructs, SharedNamesHashDifferently)
+{
+	// Every one of these is an "externalData" buffer, so the
+	// name alone can't tell them apart
+	const unsigned int hashes[] =
+	{
+		IBLIrradianceMapPSExternalData::LayoutHash,
+		LightRayPSExternalData::LayoutHash,
+		ParticleVSExternalData::LayoutHash,
+		SkyPSExternalData::LayoutHash,
+		SkyVSExternalData::LayoutHash,
+		SolidColorPSExternalData::LayoutHash,
+		SsaoBlurPSExternalData::LayoutHash,
+		SsaoPSExternalData::LayoutHash,
+		VertexShaderExternalData::LayoutHash,
+	};
+	const int count = sizeof(hashes) / sizeof(hashes[0]);
+	for (int i = 0; i < count; i++)
+		for (int j = i + 1; j < count; j++)
+			CHECK(hashes[i] != hashes[j]);
+
+	// Same types, same offsets, different names
+	CHECK(PixelShaderPerMaterial::LayoutHash == PixelShaderPBRPerMaterial::LayoutHash);
+	CHECK(PixelShaderPBRPerFrame::LayoutHash != RefractionPSPerFrame::LayoutHash);
+}
@@ -0,0 +1,174 @@
+#include "TestHarness.h"
+#include "TestCube.h"
+#include "../SpecularPrefilter.h"
+
+#include <math.h>
+
+// --------------------------------------------------------
+// The pre-filtered specular cube: flat and mirror cases,
+// the shader's brute force reference, filtering piece by
+// piece, and the same cube for any thread count
+// --------------------------------------------------------
+
+TEST(SpecularPrefilter, RejectsEmptyInput)
+{
+	LinearCubemap empty, output;
+	CHECK(!PrefilterSpecularCubemap(empty, 16, 5, 64, output));
+
+	TestCube cube = MakeGradientCube(8);
+	LinearCubemap source;
+	REQUIRE(DecodeCubemap(cube.Pixels, 8, source));
+	CHECK(!PrefilterSpecularCubemap(source, 0, 5, 64, output));
+	CHECK(!PrefilterSpecularCubemap(source, 16, 0, 64, output));
+	CHECK(!PrefilterSpecularCubemap(source, 16, 5, 0, output));
+	CHECK(output.Mips.empty());
+}
+
+TEST(SpecularPrefilter, MipRoughness)
+{
+	CHECK(GetSpecularMipRoughness(0, 5) == 0.0f);
+	CHECK(GetSpecularMipRoughness(2, 5) == 0.5f);
+	CHECK(GetSpecularMipRoughness(4, 5) == 1.0f);
+	CHECK(GetSpecularMipRoughness(0, 1) == 0.0f);
+}
+
+TEST(SpecularPrefilter, FlatSkyStaysFlat)
+{
+	// Any average of one color is that color, at every roughness
+	TestCube cube = MakeFlatCube(32, 180, 90, 30);
+	LinearCubemap source, output;
+	REQUIRE(DecodeCubemap(cube.Pixels, 32, source));
+	REQUIRE(PrefilterSpecularCubemap(source, 16, 5, 64, output));
+	REQUIRE(output.Mips.size() == 5);
+
+	const float expected[3] = { powf(180 / 255.0f, 2.2f), powf(90 / 255.0f, 2.2f), powf(30 / 255.0f, 2.2f) };
+	bool flat = true;
+	for (size_t mip = 0; mip < output.Mips.size(); mip++)
+	{
+		CHECK(output.Mips[mip].Size == (16u >> mip));
+		for (const std::vector<float>& face : output.Mips[mip].Faces)
+		{
+			for (size_t i = 0; i < face.size(); i++)
+				flat = flat && fabsf(face[i] - expected[i % 3]) < 1e-4f;
+		}
+	}
+	CHECK(flat);
+}
+
+TEST(SpecularPrefilter, TopMipIsAMirror)
+{
+	// Roughness 0 is one sample straight out of the source
+	TestCube cube = MakeGradientCube(32);
+	LinearCubemap source, output;
+	REQUIRE(DecodeCubemap(cube.Pixels, 32, source));
+	REQUIRE(PrefilterSpecularCubemap(source, 16, 4, 64, output));
+
+	bool mirror = true;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (unsigned int y = 0; y < 16; y++)
+		{
+			for (unsigned int x = 0; x < 16; x++)
+			{
+				float direction[3], rgb[3];
+				GetCubemapDirection(face, (x + 0.5f) / 16, (y + 0.5f) / 16, direction);
+				SampleCubemapLevel(source.Mips[0], direction, rgb);
+				const float* texel = &output.Mips[0].Faces[face][(y * 16 + x) * 3];
+				for (int c = 0; c < 3; c++)
+					mirror = mirror && fabsf(texel[c] - rgb[c]) < 1e-5f;
+			}
+		}
+	}
+	CHECK(mirror);
+}
+
+TEST(SpecularPrefilter, CloseToTheReference)
+{
+	// Filtered importance sampling at 64 samples against the
+	// shader's 4096, within a few levels of 255 on average
+	TestCube cube = MakeGradientCube(64);
+	LinearCubemap source, output;
+	REQUIRE(DecodeCubemap(cube.Pixels, 64, source));
+	const unsigned int mipLevels = 5;
+	REQUIRE(PrefilterSpecularCubemap(source, 32, mipLevels, 64, output));
+
+	for (unsigned int mip = 1; mip < mipLevels; mip++)
+	{
+		const LinearCubemapLevel& level = output.Mips[mip];
+		float roughness = GetSpecularMipRoughness(mip, mipLevels);
+		double totalError = 0;
+		unsigned int count = 0;
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			for (unsigned int y = 0; y < level.Size; y += (std::max)(1u, level.Size / 4))
+			{
+				for (unsigned int x = 0; x < level.Size; x += (std::max)(1u, level.Size / 4))
+				{
+					float direction[3], reference[3];
+					GetCubemapDirection(face, (x + 0.5f) / level.Size, (y + 0.5f) / level.Size, direction);
+					CalculateSpecularReference(cube.Pixels, roughness, direction, 4096, reference);
+					const float* texel = &level.Faces[face][((size_t)y * level.Size + x) * 3];
+					for (int c = 0; c < 3; c++)
+					{
+						// Compared as the gamma encoded bytes the shaders see
+						float encoded = powf(texel[c], 1 / 2.2f) * 255;
+						float expected = powf(reference[c], 1 / 2.2f) * 255;
+						totalError += fabsf(encoded - expected);
+						count++;
+					}
+				}
+			}
+		}
+		CHECK(totalError / count < 3.0);
+	}
+}
+
+TEST(SpecularPrefilter, RowsMatchTheWholeCube)
+{
+	TestCube cube = MakeGradientCube(32);
+	LinearCubemap source, output;
+	REQUIRE(DecodeCubemap(cube.Pixels, 32, source));
+	const unsigned int size = 16, mipLevels = 5, sampleCount = 32;
+	REQUIRE(PrefilterSpecularCubemap(source, size, mipLevels, sampleCount, output));
+
+	std::vector<std::vector<SpecularLobeSample>> lobes;
+	BuildSpecularLobes(source.Mips[0].Size, mipLevels, sampleCount, lobes);
+	REQUIRE(lobes.size() == mipLevels);
+	CHECK(lobes[0].size() == 1);
+
+	for (unsigned int mip = 0; mip < mipLevels; mip++)
+	{
+		unsigned int levelSize = size >> mip;
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			// Two uneven pieces
+			std::vector<float> rows((size_t)levelSize * levelSize * 3);
+			unsigned int split = levelSize / 3;
+			PrefilterSpecularRows(source, lobes[mip], face, levelSize, 0, split, rows.data());
+			PrefilterSpecularRows(source, lobes[mip], face, levelSize, split, levelSize, &rows[(size_t)split * levelSize * 3]);
+			CHECK(rows == output.Mips[mip].Faces[face]);
+		}
+	}
+}
+
+TEST(SpecularPrefilter, SameCubeForAnyThreadCount)
+{
+	// Several tiles per face at the top
+	TestCube cube = MakeGradientCube(128);
+	LinearCubemap source, single;
+	REQUIRE(DecodeCubemap(cube.Pixels, 128, source));
+	REQUIRE(PrefilterSpecularCubemap(source, 80, 6, 16, single, 1));
+
+	unsigned int threadCounts[] = { 0, 3, 500 };
+	for (unsigned int threads : threadCounts)
+	{
+		LinearCubemap parallel;
+		REQUIRE(PrefilterSpecularCubemap(source, 80, 6, 16, parallel, threads));
+		REQUIRE(parallel.Mips.size() == single.Mips.size());
+		for (size_t mip = 0; mip < single.Mips.size(); mip++)
+		{
+			for (int face = 0; face < 6; face++)
+				CHECK(parallel.Mips[mip].Faces[face] == single.Mips[mip].Faces[face]);
+		}
+	}
+}
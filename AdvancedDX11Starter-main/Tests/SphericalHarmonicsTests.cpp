@@ -0,0 +1,165 @@
+#include "TestHarness.h"
+#include "TestCube.h"
+#include "../SphericalHarmonics.h"
+
+#include <math.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// SH9 projection and irradiance: known answers, the brute
+// force reference, and the same result for any thread count
+// --------------------------------------------------------
+
+static float ToLinear(unsigned char value)
+{
+	return powf(value / 255.0f, 2.2f);
+}
+
+TEST(SphericalHarmonics, RejectsEmptyCubes)
+{
+	CubemapPixels empty;
+	SH9Color sh;
+	CHECK(!ProjectCubemapSH9(empty, sh));
+
+	TestCube missingFace(4);
+	missingFace.Pixels.Faces[3] = nullptr;
+	CHECK(!ProjectCubemapSH9(missingFace.Pixels, sh));
+}
+
+TEST(SphericalHarmonics, ConstantRadianceGivesConstantIrradiance)
+{
+	// Uniform light L: only the first coefficient, 4 pi L
+	// times its basis, and irradiance over pi of L everywhere
+	TestCube cube = MakeFlatCube(100, 200, 120, 40);
+
+	SH9Color sh;
+	REQUIRE(ProjectCubemapSH9(cube.Pixels, sh));
+	const float expected[3] = { ToLinear(200), ToLinear(120), ToLinear(40) };
+	for (int c = 0; c < 3; c++)
+	{
+		CHECK(fabsf(sh.Coefficients[0][c] - 0.282095f * 4.0f * 3.14159265f * expected[c]) < 1e-3f);
+		for (int i = 1; i < 9; i++)
+			CHECK(fabsf(sh.Coefficients[i][c]) < 1e-4f);
+	}
+
+	ConvolveIrradianceSH9(sh);
+	const float directions[][3] = { { 1, 0, 0 }, { 0, -1, 0 }, { 0.3f, 0.5f, -0.8f } };
+	for (const float* direction : directions)
+	{
+		float rgb[3];
+		EvaluateSH9(sh, direction, rgb);
+		for (int c = 0; c < 3; c++)
+			CHECK(fabsf(rgb[c] - expected[c]) < 1e-3f);
+	}
+}
+
+TEST(SphericalHarmonics, SwapsRedAndBlueForBGRA)
+{
+	TestCube rgba = MakeGradientCube(16);
+	TestCube bgra = rgba;
+	bgra.Pixels.BGRA = true;
+	for (int face = 0; face < 6; face++)
+	{
+		for (size_t i = 0; i < bgra.Faces[face].size(); i += 4)
+			std::swap(bgra.Faces[face][i], bgra.Faces[face][i + 2]);
+	}
+
+	SH9Color a, b;
+	REQUIRE(ProjectCubemapSH9(rgba.Pixels, a));
+	REQUIRE(ProjectCubemapSH9(bgra.Pixels, b));
+	CHECK(memcmp(&a, &b, sizeof(a)) == 0);
+}
+
+TEST(SphericalHarmonics, MatchesTheReference)
+{
+	// Within a few percent of the shader's brute force loop.
+	// Not straight up or down, where its tangent basis (like
+	// the shader's) degenerates.
+	TestCube cube = MakeGradientCube(32);
+	SH9Color sh;
+	REQUIRE(ProjectCubemapSH9(cube.Pixels, sh));
+	ConvolveIrradianceSH9(sh);
+
+	const float directions[][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0.1f, 0.9f, 0.2f }, { 0.2f, -0.9f, -0.1f }, { 0, 0, 1 }, { 0.6f, -0.3f, 0.7f } };
+	for (const float* direction : directions)
+	{
+		float fast[3], reference[3];
+		EvaluateSH9(sh, direction, fast);
+		CalculateIrradianceReference(cube.Pixels, direction, reference);
+		for (int c = 0; c < 3; c++)
+			CHECK(fabsf(fast[c] - reference[c]) <= 0.03f * reference[c] + 0.006f);
+	}
+}
+
+TEST(SphericalHarmonics, AccumulatedRowsMatchTheProjection)
+{
+	// Small enough that the projection doesn't filter, so
+	// both see the same texels
+	TestCube cube = MakeGradientCube(24);
+	SH9Color projected;
+	REQUIRE(ProjectCubemapSH9(cube.Pixels, projected));
+
+	LinearCubemap linear;
+	REQUIRE(DecodeCubemap(cube.Pixels, 24, linear));
+	const LinearCubemapLevel& level = linear.Mips[0];
+
+	// In uneven pieces, as a frame budget would split it
+	SH9Color accumulated;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		AccumulateSH9Rows(level, face, 0, 5, accumulated);
+		AccumulateSH9Rows(level, face, 5, 6, accumulated);
+		AccumulateSH9Rows(level, face, 6, level.Size, accumulated);
+	}
+
+	for (int i = 0; i < 9; i++)
+	{
+		for (int c = 0; c < 3; c++)
+			CHECK(fabsf(accumulated.Coefficients[i][c] - projected.Coefficients[i][c]) < 1e-3f);
+	}
+}
+
+TEST(SphericalHarmonics, IrradianceCubeMatchesEvaluation)
+{
+	TestCube cube = MakeGradientCube(16);
+	SH9Color sh;
+	REQUIRE(ProjectCubemapSH9(cube.Pixels, sh));
+	ConvolveIrradianceSH9(sh);
+
+	LinearCubemapLevel level;
+	CreateIrradianceCubeSH9(sh, 8, level);
+	REQUIRE(level.Size == 8);
+
+	bool matches = true;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		REQUIRE(level.Faces[face].size() == 8 * 8 * 3);
+		for (unsigned int y = 0; y < 8; y++)
+		{
+			for (unsigned int x = 0; x < 8; x++)
+			{
+				float direction[3], rgb[3];
+				GetCubemapDirection(face, (x + 0.5f) / 8, (y + 0.5f) / 8, direction);
+				EvaluateSH9(sh, direction, rgb);
+				matches = matches && memcmp(rgb, &level.Faces[face][(y * 8 + x) * 3], sizeof(rgb)) == 0;
+			}
+		}
+	}
+	CHECK(matches);
+}
+
+TEST(SphericalHarmonics, SameResultForAnyThreadCount)
+{
+	// Big enough to filter, with a size the blocks don't divide
+	TestCube cube = MakeGradientCube(300);
+	SH9Color single;
+	REQUIRE(ProjectCubemapSH9(cube.Pixels, single, 1));
+
+	unsigned int threadCounts[] = { 0, 2, 5, 64 };
+	for (unsigned int threads : threadCounts)
+	{
+		SH9Color parallel;
+		REQUIRE(ProjectCubemapSH9(cube.Pixels, parallel, threads));
+		CHECK(memcmp(&single, &parallel, sizeof(single)) == 0);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "../Cubemap.h"
+
+#include <math.h>
+
+// --------------------------------------------------------
+// Six faces of 8 bit RGBA owned by the test, and the
+// CubemapPixels that points at them
+// --------------------------------------------------------
+struct TestCube
+{
+	std::vector<unsigned char> Faces[6];
+	CubemapPixels Pixels;
+
+	TestCube(unsigned int size, bool bgra = false)
+	{
+		Pixels.Size = size;
+		Pixels.RowPitch = (size_t)size * 4;
+		Pixels.BGRA = bgra;
+		for (int face = 0; face < 6; face++)
+		{
+			Faces[face].resize((size_t)size * size * 4);
+			Pixels.Faces[face] = Faces[face].data();
+		}
+	}
+
+	// Copies need their own face pointers
+	TestCube(const TestCube& other) : Pixels(other.Pixels)
+	{
+		for (int face = 0; face < 6; face++)
+		{
+			Faces[face] = other.Faces[face];
+			Pixels.Faces[face] = Faces[face].data();
+		}
+	}
+
+	TestCube& operator=(const TestCube&) = delete;
+
+	unsigned char* Texel(unsigned int face, unsigned int x, unsigned int y)
+	{
+		return &Faces[face][((size_t)y * Pixels.Size + x) * 4];
+	}
+};
+
+// --------------------------------------------------------
+// A sky-ish cube: brightest straight up, a different green
+// per face and some blue detail at the texel level
+// --------------------------------------------------------
+inline TestCube MakeGradientCube(unsigned int size)
+{
+	TestCube cube(size);
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				float direction[3];
+				GetCubemapDirection(face, (x + 0.5f) / size, (y + 0.5f) / size, direction);
+				float length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+				float up = 0.5f + 0.5f * direction[1] / length;
+
+				unsigned char* p = cube.Texel(face, x, y);
+				p[0] = (unsigned char)(40 + 200 * up);
+				p[1] = (unsigned char)(30 + 30 * face);
+				p[2] = (unsigned char)(((x * 7) ^ (y * 3)) & 127);
+				p[3] = 255;
+			}
+		}
+	}
+	return cube;
+}
+
+// A cube of one color
+inline TestCube MakeFlatCube(unsigned int size, unsigned char r, unsigned char g, unsigned char b)
+{
+	TestCube cube(size);
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (size_t i = 0; i < cube.Faces[face].size(); i += 4)
+		{
+			cube.Faces[face][i + 0] = r;
+			cube.Faces[face][i + 1] = g;
+			cube.Faces[face][i + 2] = b;
+			cube.Faces[face][i + 3] = 255;
+		}
+	}
+	return cube;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// A minimal self-registering test harness for the engine
+// code that needs neither Windows nor a GPU.  Tests are
+// grouped into suites, and CTest runs each suite as its
+// own test:
+//
+//  TEST(RingAllocator, WrapsAround)
+//  {
+//      CHECK(ring.Allocate(256) == 0);
+//  }
+//
+// A failed CHECK reports and carries on; REQUIRE returns
+// from the test, for checks the rest of it depends on.
+// --------------------------------------------------------
+
+typedef void (*TestFunction)();
+
+struct TestCase
+{
+	const char* Suite;
+	const char* Name;
+	TestFunction Function;
+};
+
+std::vector<TestCase>& GetTestCases();
+void ReportTestFailure(const char* file, int line, const char* expression);
+
+// Folder for files a test writes, removed after the run
+std::string GetTestTempFolder();
+
+// Folder holding the sample assets (Assets/)
+std::string GetTestAssetFolder();
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* suite, const char* name, TestFunction function)
+	{
+		TestCase test = { suite, name, function };
+		GetTestCases().push_back(test);
+	}
+};
+
+#define TEST(suite, name) \
+	static void suite##_##name(); \
+	static TestRegistrar suite##_##name##_registrar(#suite, #name, suite##_##name); \
+	static void suite##_##name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) ReportTestFailure(__FILE__, __LINE__, #expression); } while (0)
+
+#define REQUIRE(expression) \
+	do { if (!(expression)) { ReportTestFailure(__FILE__, __LINE__, #expression); return; } } while (0)
@@ -0,0 +1,123 @@
+#include "TestHarness.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+static unsigned int failures = 0;
+static std::string tempFolder;
+
+std::vector<TestCase>& GetTestCases()
+{
+	// Function local, so it exists before any registrar runs
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void ReportTestFailure(const char* file, int line, const char* expression)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+	failures++;
+}
+
+std::string GetTestTempFolder()
+{
+	if (!tempFolder.empty())
+		return tempFolder;
+
+#ifdef _WIN32
+	char path[MAX_PATH];
+	GetTempPathA(MAX_PATH, path);
+	tempFolder = std::string(path) + "EngineTests" + std::to_string(GetCurrentProcessId()) + "\\";
+	CreateDirectoryA(tempFolder.c_str(), 0);
+#else
+	char path[] = "/tmp/EngineTestsXXXXXX";
+	if (mkdtemp(path))
+		tempFolder = std::string(path) + "/";
+#endif
+	return tempFolder;
+}
+
+std::string GetTestAssetFolder()
+{
+	return TEST_ASSET_FOLDER;
+}
+
+// --------------------------------------------------------
+// Removes the temp folder and whatever the tests left in
+// it (files only - tests don't make folders)
+// --------------------------------------------------------
+static void RemoveTestTempFolder()
+{
+	if (tempFolder.empty())
+		return;
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((tempFolder + "*").c_str(), &data);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				DeleteFileA((tempFolder + data.cFileName).c_str());
+		} while (FindNextFileA(find, &data));
+		FindClose(find);
+	}
+	RemoveDirectoryA(tempFolder.c_str());
+#else
+	DIR* dir = opendir(tempFolder.c_str());
+	if (dir)
+	{
+		while (dirent* entry = readdir(dir))
+		{
+			if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+				unlink((tempFolder + entry->d_name).c_str());
+		}
+		closedir(dir);
+	}
+	rmdir(tempFolder.c_str());
+#endif
+}
+
+// --------------------------------------------------------
+//  EngineTests [suite]
+//
+//  Runs every test, or just one suite's.  Returns nonzero
+//  if any check failed or the suite doesn't exist.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	const char* suite = argc > 1 ? argv[1] : 0;
+
+	unsigned int run = 0;
+	for (TestCase& test : GetTestCases())
+	{
+		if (suite && strcmp(suite, test.Suite) != 0)
+			continue;
+
+		unsigned int failuresBefore = failures;
+		printf("%s.%s\n", test.Suite, test.Name);
+		test.Function();
+		if (failures != failuresBefore)
+			printf("  FAILED\n");
+		run++;
+	}
+
+	RemoveTestTempFolder();
+
+	if (run == 0)
+	{
+		printf("No tests in suite \"%s\"\n", suite ? suite : "");
+		return 1;
+	}
+
+	printf("%u tests, %u failed checks\n", run, failures);
+	return failures == 0 ? 0 : 1;
+}
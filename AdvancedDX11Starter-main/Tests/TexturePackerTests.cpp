@@ -0,0 +1,164 @@
+#include "TestHarness.h"
+#include "../MappedFile.h"
+#include "../TexturePacker.h"
+
+#include <string.h>
+
+// --------------------------------------------------------
+// ORM packing, and BuildORM()'s up-to-date check, with a
+// stand-in decoder so no image library is needed
+// --------------------------------------------------------
+
+// DXGI_FORMAT_R8G8B8A8_UNORM and DXGI_FORMAT_BC7_UNORM
+static const uint32_t FormatRGBA8 = 28;
+static const uint32_t FormatBC7 = 98;
+
+static PackSourceImage MakeImage(unsigned int width, unsigned int height, unsigned char base, unsigned char step)
+{
+	PackSourceImage image;
+	image.Width = width;
+	image.Height = height;
+	image.RGBA.resize((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		image.RGBA[i * 4 + 0] = (unsigned char)(base + step * (i % 7));
+		image.RGBA[i * 4 + 1] = 0;
+		image.RGBA[i * 4 + 2] = 0;
+		image.RGBA[i * 4 + 3] = 255;
+	}
+	return image;
+}
+
+// The "encoded" test files: width, height, then RGBA
+static std::vector<unsigned char> EncodeImage(const PackSourceImage& image)
+{
+	std::vector<unsigned char> bytes(8);
+	memcpy(&bytes[0], &image.Width, 4);
+	memcpy(&bytes[4], &image.Height, 4);
+	bytes.insert(bytes.end(), image.RGBA.begin(), image.RGBA.end());
+	return bytes;
+}
+
+static bool DecodeImage(const unsigned char* data, size_t size, PackSourceImage& image)
+{
+	if (size < 8)
+		return false;
+
+	memcpy(&image.Width, data, 4);
+	memcpy(&image.Height, data + 4, 4);
+	if ((uint64_t)image.Width * image.Height * 4 != size - 8)
+		return false;
+
+	image.RGBA.assign(data + 8, data + size);
+	return true;
+}
+
+static std::string WriteImage(const std::string& name, const PackSourceImage& image)
+{
+	std::string path = GetTestTempFolder() + name;
+	std::vector<unsigned char> bytes = EncodeImage(image);
+	WriteFileReplacing(path.c_str(), bytes.data(), bytes.size());
+	return path;
+}
+
+TEST(TexturePacker, PacksChannelsWithDefaults)
+{
+	PackSourceImage roughness = MakeImage(8, 8, 100, 10);
+
+	DDSImage packed;
+	TexturePacker::PackORM(0, &roughness, 0, false, packed);
+	REQUIRE(packed.Width == 8 && packed.Height == 8);
+	CHECK(packed.DXGIFormat == FormatRGBA8);
+	CHECK(packed.Mips.size() == 4);
+
+	const std::vector<unsigned char>& top = packed.Mips[0];
+	bool matches = true;
+	for (size_t i = 0; i < 64; i++)
+	{
+		matches = matches &&
+			top[i * 4 + 0] == 255 &&
+			top[i * 4 + 1] == roughness.RGBA[i * 4] &&
+			top[i * 4 + 2] == 0 &&
+			top[i * 4 + 3] == 255;
+	}
+	CHECK(matches);
+}
+
+TEST(TexturePacker, SolidSourcesGiveATinyTexture)
+{
+	PackSourceImage occlusion = MakeImage(512, 512, 200, 0);
+	PackSourceImage metal = MakeImage(256, 256, 0, 0);
+
+	DDSImage packed;
+	TexturePacker::PackORM(&occlusion, 0, &metal, false, packed);
+	CHECK(packed.Width == 4 && packed.Height == 4);
+	CHECK(packed.Mips[0][0] == 200);
+	CHECK(packed.Mips[0][1] == 255);
+	CHECK(packed.Mips[0][2] == 0);
+}
+
+TEST(TexturePacker, UpsamplesSmallerSources)
+{
+	PackSourceImage roughness = MakeImage(16, 16, 10, 20);
+	PackSourceImage metal = MakeImage(4, 4, 50, 30);
+
+	DDSImage packed;
+	TexturePacker::PackORM(0, &roughness, &metal, true, packed);
+	CHECK(packed.Width == 16 && packed.Height == 16);
+	CHECK(packed.DXGIFormat == FormatBC7);
+	CHECK(packed.Mips.size() == 5);
+	CHECK(packed.Mips[0].size() == 4 * 4 * 16);
+}
+
+TEST(TexturePacker, RebuildsOnlyWhenSourcesChange)
+{
+	std::string roughnessPath = WriteImage("Roughness.raw", MakeImage(8, 8, 100, 10));
+	std::string metalPath = WriteImage("Metal.raw", MakeImage(8, 8, 0, 30));
+	std::string outputPath = GetTestTempFolder() + "ORM.dds";
+
+	CHECK(TexturePacker::BuildORM("", roughnessPath, metalPath, outputPath, DecodeImage, false) == TEXTURE_PACK_BUILT);
+	CHECK(TexturePacker::BuildORM("", roughnessPath, metalPath, outputPath, DecodeImage, false) == TEXTURE_PACK_UP_TO_DATE);
+
+	// Asking for compression replaces an uncompressed build,
+	// but an uncompressed request accepts a compressed one
+	CHECK(TexturePacker::BuildORM("", roughnessPath, metalPath, outputPath, DecodeImage, true) == TEXTURE_PACK_BUILT);
+	CHECK(TexturePacker::BuildORM("", roughnessPath, metalPath, outputPath, DecodeImage, false) == TEXTURE_PACK_UP_TO_DATE);
+
+	WriteImage("Metal.raw", MakeImage(8, 8, 5, 30));
+	CHECK(TexturePacker::BuildORM("", roughnessPath, metalPath, outputPath, DecodeImage, true) == TEXTURE_PACK_BUILT);
+
+	MappedFile output;
+	REQUIRE(output.Open(outputPath.c_str()));
+	DDSImage image;
+	CHECK(ParseDDS(output.GetData(), output.GetSize(), image));
+	CHECK(image.DXGIFormat == FormatBC7);
+	CHECK(image.SourceHash != 0);
+}
+
+TEST(TexturePacker, FailsWithoutTouchingTheOutput)
+{
+	std::string roughnessPath = WriteImage("Roughness2.raw", MakeImage(8, 8, 100, 10));
+	std::string outputPath = GetTestTempFolder() + "ORM2.dds";
+	REQUIRE(TexturePacker::BuildORM("", roughnessPath, "", outputPath, DecodeImage, false) == TEXTURE_PACK_BUILT);
+
+	MappedFile before;
+	REQUIRE(before.Open(outputPath.c_str()));
+	std::vector<unsigned char> original(before.GetData(), before.GetData() + before.GetSize());
+	before.Close();
+
+	// A source that's missing, or won't decode
+	CHECK(TexturePacker::BuildORM("", GetTestTempFolder() + "Missing.raw", "", outputPath, DecodeImage, false) == TEXTURE_PACK_FAILED);
+
+	std::string garbagePath = GetTestTempFolder() + "Garbage.raw";
+	const char garbage[] = "not an image";
+	WriteFileReplacing(garbagePath.c_str(), garbage, sizeof(garbage));
+	CHECK(TexturePacker::BuildORM("", garbagePath, "", outputPath, DecodeImage, false) == TEXTURE_PACK_FAILED);
+
+	// An output folder that doesn't exist
+	CHECK(TexturePacker::BuildORM("", roughnessPath, "", GetTestTempFolder() + "Missing/ORM.dds", DecodeImage, false) == TEXTURE_PACK_FAILED);
+
+	MappedFile after;
+	REQUIRE(after.Open(outputPath.c_str()));
+	CHECK(after.GetSize() == original.size());
+	CHECK(memcmp(after.GetData(), original.data(), original.size()) == 0);
+}
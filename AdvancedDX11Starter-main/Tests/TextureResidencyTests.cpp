@@ -0,0 +1,225 @@
+#include "TestHarness.h"
+#include "../TextureResidency.h"
+
+#include <math.h>
+
+// --------------------------------------------------------
+// Mip residency, driven headless the way Game drives it:
+// requests each frame, then an update
+// --------------------------------------------------------
+
+// Bytes of each mip of an RGBA8 texture, finest first
+static std::vector<size_t> MakeMipBytes(unsigned int width, unsigned int height)
+{
+	std::vector<size_t> mipBytes;
+	while (true)
+	{
+		mipBytes.push_back((size_t)width * height * 4);
+		if (width == 1 && height == 1)
+			break;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return mipBytes;
+}
+
+static size_t BytesFrom(const std::vector<size_t>& mipBytes, unsigned int finestMip)
+{
+	size_t bytes = 0;
+	for (unsigned int mip = finestMip; mip < mipBytes.size(); mip++)
+		bytes += mipBytes[mip];
+	return bytes;
+}
+
+TEST(TextureResidency, PicksTheMipMatchingTheTexels)
+{
+	// 1024 wide, 11 mips
+	CHECK(TextureResidency::CalculateWantedMip(1024, 11, 1024) == 0);
+	CHECK(TextureResidency::CalculateWantedMip(1024, 11, 2000) == 0);
+	CHECK(TextureResidency::CalculateWantedMip(1024, 11, 512) == 1);
+	CHECK(TextureResidency::CalculateWantedMip(1024, 11, 300) == 1);
+	CHECK(TextureResidency::CalculateWantedMip(1024, 11, 256) == 2);
+	CHECK(TextureResidency::CalculateWantedMip(1024, 11, 0.01f) == 10);
+	CHECK(TextureResidency::CalculateWantedMip(1024, 11, 0) == 10);
+	CHECK(TextureResidency::CalculateWantedMip(1024, 0, 100) == 0);
+}
+
+TEST(TextureResidency, TexelsFollowDistanceAndTiling)
+{
+	float projectionScale = 1.0f / tanf(3.14159265f / 8.0f);
+	float near = TextureResidency::CalculateRequiredTexels(2.0f, 1.0f, 5.0f, projectionScale, 720.0f);
+	float far = TextureResidency::CalculateRequiredTexels(2.0f, 1.0f, 10.0f, projectionScale, 720.0f);
+	float tiled = TextureResidency::CalculateRequiredTexels(2.0f, 4.0f, 5.0f, projectionScale, 720.0f);
+
+	CHECK(fabsf(near - 2.0f * far) < 0.01f);
+	CHECK(fabsf(near - 4.0f * tiled) < 0.01f);
+
+	// Inside the object is clamped, not infinite
+	float inside = TextureResidency::CalculateRequiredTexels(2.0f, 1.0f, 0.0f, projectionScale, 720.0f);
+	CHECK(std::isfinite(inside) && inside > near);
+}
+
+TEST(TextureResidency, StartsWithJustTheTail)
+{
+	TextureResidency residency;
+	std::vector<size_t> mips = MakeMipBytes(1024, 512);
+	unsigned int texture = residency.AddTexture(1024, 512, mips);
+
+	// 1024x512 >> 4 = 64x32, the first mip within TailSize
+	CHECK(residency.GetTailMip(texture) == 4);
+	CHECK(residency.GetResidentMip(texture) == 4);
+	CHECK(residency.GetResidentBytes() == BytesFrom(mips, 4));
+
+	// Unrequested textures stay at their tail
+	residency.BeginFrame();
+	residency.Update();
+	CHECK(residency.GetResidentMip(texture) == 4);
+	CHECK(residency.GetStats().Requested == 0);
+}
+
+TEST(TextureResidency, StreamsInCoarsestFirstUnderTheLoadCap)
+{
+	std::vector<size_t> mips = MakeMipBytes(1024, 1024);
+	TextureResidency residency(64 * 1024 * 1024);
+	residency.SetMaxLoadBytesPerUpdate(mips[2]);
+	unsigned int texture = residency.AddTexture(1024, 1024, mips);
+
+	// Each update can only afford about one mip, so detail
+	// arrives a step at a time
+	unsigned int previous = residency.GetResidentMip(texture);
+	unsigned int updates = 0;
+	while (residency.GetResidentMip(texture) > 0 && updates < 20)
+	{
+		residency.BeginFrame();
+		residency.Request(texture, 1024);
+		residency.Update();
+		updates++;
+
+		unsigned int resident = residency.GetResidentMip(texture);
+		CHECK(resident == previous || resident == previous - 1);
+		CHECK(residency.GetStats().Loads <= 1);
+		previous = resident;
+	}
+
+	CHECK(residency.GetResidentMip(texture) == 0);
+	CHECK(residency.GetStats().Starved == 0);
+}
+
+TEST(TextureResidency, LoadsMipsBiggerThanTheCapAlone)
+{
+	std::vector<size_t> mips = MakeMipBytes(1024, 1024);
+	TextureResidency residency(64 * 1024 * 1024);
+	residency.SetMaxLoadBytesPerUpdate(mips[1]);
+	unsigned int a = residency.AddTexture(1024, 1024, mips);
+	unsigned int b = residency.AddTexture(1024, 1024, mips);
+
+	for (int i = 0; i < 20; i++)
+	{
+		residency.BeginFrame();
+		residency.Request(a, 1024, 2.0f);
+		residency.Request(b, 1024, 1.0f);
+		residency.Update();
+
+		// Mip 0 is four times the cap, so nothing else loads
+		// in the same update
+		if (residency.GetStats().LoadedBytes > mips[1])
+			CHECK(residency.GetStats().Loads == 1);
+	}
+
+	CHECK(residency.GetResidentMip(a) == 0);
+	CHECK(residency.GetResidentMip(b) == 0);
+}
+
+TEST(TextureResidency, StaysWithinBudget)
+{
+	std::vector<size_t> mips = MakeMipBytes(1024, 1024);
+	size_t budget = 3 * BytesFrom(mips, 1);
+
+	TextureResidency residency(budget);
+	residency.SetMaxLoadBytesPerUpdate(budget);
+	for (int i = 0; i < 8; i++)
+		residency.AddTexture(1024, 1024, mips);
+
+	for (int frame = 0; frame < 10; frame++)
+	{
+		residency.BeginFrame();
+		for (unsigned int t = 0; t < residency.GetTextureCount(); t++)
+			residency.Request(t, 1024, (float)(t + 1));
+		residency.Update();
+		CHECK(residency.GetResidentBytes() <= budget);
+	}
+
+	// The highest priority textures get the detail
+	CHECK(residency.GetResidentMip(7) <= residency.GetResidentMip(0));
+	CHECK(residency.GetResidentMip(7) <= 1);
+	CHECK(residency.GetStats().Starved > 0);
+}
+
+TEST(TextureResidency, KeepsUnrequestedMipsUntilSpaceIsNeeded)
+{
+	std::vector<size_t> mips = MakeMipBytes(512, 512);
+	size_t budget = BytesFrom(mips, 0) + BytesFrom(mips, 3);
+
+	TextureResidency residency(budget);
+	residency.SetMaxLoadBytesPerUpdate(budget);
+	unsigned int a = residency.AddTexture(512, 512, mips);
+	unsigned int b = residency.AddTexture(512, 512, mips);
+
+	residency.BeginFrame();
+	residency.Request(a, 512);
+	residency.Update();
+	CHECK(residency.GetResidentMip(a) == 0);
+
+	// Nobody wants "a" now, but there's room to keep it
+	residency.BeginFrame();
+	residency.Update();
+	CHECK(residency.GetResidentMip(a) == 0);
+	CHECK(residency.GetStats().Evictions == 0);
+
+	// "b" needs the space, so "a" gives it up
+	residency.BeginFrame();
+	residency.Request(b, 512);
+	residency.Update();
+	CHECK(residency.GetResidentMip(b) == 0);
+	CHECK(residency.GetResidentMip(a) == residency.GetTailMip(a));
+	CHECK(residency.GetStats().Evictions > 0);
+	CHECK(residency.GetResidentBytes() <= budget);
+}
+
+TEST(TextureResidency, FollowsACameraPath)
+{
+	// A camera flying past a row of objects: detail should
+	// follow it, within budget, without thrashing
+	const unsigned int objectCount = 16;
+	std::vector<size_t> mips = MakeMipBytes(2048, 2048);
+	size_t budget = 4 * BytesFrom(mips, 0);
+
+	TextureResidency residency(budget);
+	for (unsigned int i = 0; i < objectCount; i++)
+		residency.AddTexture(2048, 2048, mips);
+
+	float projectionScale = 1.0f / tanf(3.14159265f / 8.0f);
+	unsigned int totalLoads = 0;
+	for (unsigned int frame = 0; frame < 600; frame++)
+	{
+		float cameraX = frame * 0.1f;
+		residency.BeginFrame();
+		for (unsigned int i = 0; i < objectCount; i++)
+		{
+			float distance = fabsf(i * 4.0f - cameraX) + 1.0f;
+			residency.Request(i, TextureResidency::CalculateRequiredTexels(2.0f, 1.0f, distance, projectionScale, 1080.0f));
+		}
+		residency.Update();
+
+		CHECK(residency.GetResidentBytes() <= budget);
+		totalLoads += residency.GetStats().Loads;
+	}
+
+	// The camera ends next to the last object, which has
+	// caught up with the detail it needs
+	CHECK(residency.GetWantedMip(objectCount - 1) == 0);
+	CHECK(residency.GetResidentMip(objectCount - 1) == 0);
+	CHECK(residency.GetWantedMip(0) == residency.GetTailMip(0));
+	CHECK(totalLoads > 0);
+	CHECK(totalLoads < 600 * 2);
+}
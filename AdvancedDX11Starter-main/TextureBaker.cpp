@@ -0,0 +1,118 @@
+#include "TextureBaker.h"
+#include "Clock.h"
+#include "DDSFile.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "TextureStreamer.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <stdio.h>
+
+static bool EndsWith(const std::wstring& text, const std::wstring& ending)
+{
+	return text.size() >= ending.size() &&
+		text.compare(text.size() - ending.size(), ending.size(), ending) == 0;
+}
+
+unsigned int TextureBaker::BakeFolder(const std::wstring& folder, BlockQuality quality)
+{
+	printf("Baking textures (%s quality)\n", GetBlockQualityName(quality));
+
+	WIN32_FIND_DATAW found;
+	HANDLE search = FindFirstFileW((folder + L"*.png").c_str(), &found);
+	if (search == INVALID_HANDLE_VALUE)
+		return 0;
+
+	unsigned int baked = 0;
+	do
+	{
+		BlockFormat format;
+		if (GetFormatForTexture(found.cFileName, quality, &format) &&
+			BakeTexture(folder + found.cFileName, format, quality))
+			baked++;
+	} while (FindNextFileW(search, &found));
+
+	FindClose(search);
+	printf("Baked %u textures\n", baked);
+	return baked;
+}
+
+bool TextureBaker::GetFormatForTexture(const std::wstring& fileName, BlockQuality quality, BlockFormat* format)
+{
+	std::wstring name = fileName.substr(0, fileName.find_last_of(L'.'));
+	if (EndsWith(name, L"_albedo"))
+		*format = quality == BLOCK_QUALITY_FAST ? BLOCK_FORMAT_BC1 : BLOCK_FORMAT_BC7;
+	else if (EndsWith(name, L"_normals"))
+		*format = BLOCK_FORMAT_BC5;
+	else
+		return false;
+	return true;
+}
+
+uint64_t TextureBaker::HashSource(const unsigned char* data, size_t size)
+{
+	// The size goes in too, so an empty file has a hash of its own
+	uint32_t version = Version;
+	uint64_t length = size;
+	uint64_t hash = HashFNV1a(&version, sizeof(version));
+	hash = HashFNV1a(&length, sizeof(length), hash);
+	return HashFNV1a(data, size, hash);
+}
+
+// --------------------------------------------------------
+// Decodes the source the same way the streamer would, so
+// the baked copy matches it, then compresses each mip
+// --------------------------------------------------------
+bool TextureBaker::BakeTexture(const std::wstring& sourcePath, BlockFormat format, BlockQuality quality)
+{
+	MappedFile sourceFile;
+	std::shared_ptr<TextureStreamer::TextureData> source;
+	if (sourceFile.Open(sourcePath.c_str()))
+		source = TextureStreamer::DecodeImage(sourceFile.GetData(), sourceFile.GetSize(), TextureStreamer::GetMaterialTextureOptions(sourcePath));
+	if (!source)
+	{
+		wprintf(L"Could not decode %s\n", sourcePath.c_str());
+		return false;
+	}
+
+	DDSImage image;
+	image.DXGIFormat = GetBlockDXGIFormat(format, source->Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+	image.Width = source->Width;
+	image.Height = source->Height;
+	image.SourceHash = HashSource(sourceFile.GetData(), sourceFile.GetSize());
+
+	size_t pixels = 0;
+	int64_t start = Clock::NowNanoseconds();
+	for (unsigned int mip = 0; mip < source->Mips.size(); mip++)
+	{
+		unsigned int width = (std::max)(1u, source->Width >> mip);
+		unsigned int height = (std::max)(1u, source->Height >> mip);
+		image.Mips.emplace_back(GetCompressedSize(format, width, height));
+		CompressBlocks(source->Mips[mip].data(), width, height, format, quality, image.Mips.back().data());
+		pixels += (size_t)width * height;
+	}
+	double seconds = (Clock::NowNanoseconds() - start) * 1e-9;
+
+	std::vector<unsigned char> decoded(source->Mips[0].size());
+	DecompressBlocks(image.Mips[0].data(), source->Width, source->Height, format, decoded.data());
+	double psnr = CalculatePSNR(source->Mips[0].data(), decoded.data(), source->Width, source->Height, GetBlockChannels(format));
+
+	std::vector<unsigned char> file;
+	SerializeDDS(image, file);
+	std::wstring outputPath = TextureStreamer::GetCompressedPath(sourcePath);
+	if (!WriteFileReplacing(outputPath.c_str(), file.data(), file.size()))
+	{
+		wprintf(L"Could not write %s\n", outputPath.c_str());
+		return false;
+	}
+
+	wprintf(L"%-60s %S %4ux%-4u PSNR %6.2f dB  %7.2f MP/s\n",
+		outputPath.c_str(),
+		GetBlockFormatName(format),
+		source->Width,
+		source->Height,
+		psnr,
+		seconds > 0 ? pixels / seconds * 1e-6 : 0.0);
+	return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "BlockCompression.h"
+
+// --------------------------------------------------------
+// Bakes material textures into block compressed .dds files
+// next to their sources, which TextureStreamer then loads
+// instead.  The format comes from the file name:
+//
+//  *_albedo    - BC7 (BC1 at fast quality)
+//  *_normals   - BC5
+//
+// Roughness and metal maps aren't baked on their own, as
+// they're packed together first (see TexturePacker).
+//
+// Every mip is compressed, and a line per texture reports
+// the format, the PSNR of the top mip and the throughput.
+// Each file records a hash of its source, so the streamer
+// ignores it once the source has changed.
+// --------------------------------------------------------
+class TextureBaker
+{
+public:
+	// Bump when baking changes, so older files aren't used
+	static const uint32_t Version = 1;
+
+	// Bakes every recognized .png in the folder (ending in a
+	// slash).  Returns how many were written.
+	static unsigned int BakeFolder(const std::wstring& folder, BlockQuality quality);
+
+	static bool BakeTexture(const std::wstring& sourcePath, BlockFormat format, BlockQuality quality);
+
+	// False for textures that aren't baked
+	static bool GetFormatForTexture(const std::wstring& fileName, BlockQuality quality, BlockFormat* format);
+
+	// What a baked file records of its source's bytes
+	static uint64_t HashSource(const unsigned char* data, size_t size);
+};
@@ -0,0 +1,193 @@
+#include "TexturePacker.h"
+#include "BlockCompression.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+// DXGI_FORMAT_R8G8B8A8_UNORM, so this builds without D3D headers
+static const uint32_t DXGIFormatRGBA8 = 28;
+
+// True if the red channel is the same everywhere
+static bool IsConstant(const PackSourceImage& image)
+{
+	for (size_t i = 4; i < image.RGBA.size(); i += 4)
+	{
+		if (image.RGBA[i] != image.RGBA[0])
+			return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// The source's red channel at the center of pixel (x, y)
+// of a width x height image, filtered bilinearly with
+// wrapping when the sizes differ
+// --------------------------------------------------------
+static unsigned char SampleRed(const PackSourceImage& image, unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+{
+	if (image.Width == width && image.Height == height)
+		return image.RGBA[((size_t)y * width + x) * 4];
+
+	float u = (x + 0.5f) * image.Width / width - 0.5f;
+	float v = (y + 0.5f) * image.Height / height - 0.5f;
+	float u0 = floorf(u);
+	float v0 = floorf(v);
+	float tu = u - u0;
+	float tv = v - v0;
+
+	auto texel = [&](int px, int py)
+	{
+		int w = (int)image.Width;
+		int h = (int)image.Height;
+		px = (px % w + w) % w;
+		py = (py % h + h) % h;
+		return (float)image.RGBA[((size_t)py * w + px) * 4];
+	};
+
+	int x0 = (int)u0;
+	int y0 = (int)v0;
+	float top = texel(x0, y0) * (1 - tu) + texel(x0 + 1, y0) * tu;
+	float bottom = texel(x0, y0 + 1) * (1 - tu) + texel(x0 + 1, y0 + 1) * tu;
+	return (unsigned char)(top * (1 - tv) + bottom * tv + 0.5f);
+}
+
+void TexturePacker::PackORM(
+	const PackSourceImage* occlusion,
+	const PackSourceImage* roughness,
+	const PackSourceImage* metal,
+	bool compress,
+	DDSImage& output)
+{
+	const PackSourceImage* sources[3] = { occlusion, roughness, metal };
+	const unsigned char defaults[3] = { 255, 255, 0 };
+
+	// The largest source with any detail sets the size
+	bool constant[3] = {};
+	unsigned int width = 0, height = 0;
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		if (sources[i] && sources[i]->RGBA.empty())
+			sources[i] = 0;
+		if (!sources[i])
+			continue;
+
+		constant[i] = IsConstant(*sources[i]);
+		if (!constant[i])
+		{
+			width = (std::max)(width, sources[i]->Width);
+			height = (std::max)(height, sources[i]->Height);
+		}
+	}
+
+	// Solid colors only need a block, and block compressed
+	// textures need sizes that are multiples of 4
+	width = (std::max)(width, 4u);
+	height = (std::max)(height, 4u);
+	if (compress)
+	{
+		width = (width + 3) & ~3u;
+		height = (height + 3) & ~3u;
+	}
+
+	std::vector<std::vector<unsigned char>> mips(1);
+	mips[0].resize((size_t)width * height * 4);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			unsigned char* pixel = &mips[0][((size_t)y * width + x) * 4];
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				if (!sources[i])
+					pixel[i] = defaults[i];
+				else if (constant[i])
+					pixel[i] = sources[i]->RGBA[0];
+				else
+					pixel[i] = SampleRed(*sources[i], x, y, width, height);
+			}
+			pixel[3] = 255;
+		}
+	}
+	MipOptions mipOptions;
+	mipOptions.Filter = MIP_FILTER_KAISER;
+	mipOptions.Wrap = true;
+	GenerateMipChain(mips, width, height, mipOptions);
+
+	output.Width = width;
+	output.Height = height;
+	output.SourceHash = 0;
+	output.Mips.clear();
+	if (!compress)
+	{
+		output.DXGIFormat = DXGIFormatRGBA8;
+		output.Mips = std::move(mips);
+		return;
+	}
+
+	output.DXGIFormat = GetBlockDXGIFormat(BLOCK_FORMAT_BC7, false);
+	for (unsigned int mip = 0; mip < mips.size(); mip++)
+	{
+		unsigned int mipWidth = (std::max)(1u, width >> mip);
+		unsigned int mipHeight = (std::max)(1u, height >> mip);
+		output.Mips.emplace_back(GetCompressedSize(BLOCK_FORMAT_BC7, mipWidth, mipHeight));
+		CompressBlocks(mips[mip].data(), mipWidth, mipHeight, BLOCK_FORMAT_BC7, BLOCK_QUALITY_NORMAL, output.Mips.back().data());
+	}
+}
+
+TexturePackResult TexturePacker::BuildORM(
+	const std::string& occlusionPath,
+	const std::string& roughnessPath,
+	const std::string& metalPath,
+	const std::string& outputPath,
+	const ImageDecoder& decoder,
+	bool compress)
+{
+	// Hash everything the output depends on.  Sizes go in
+	// too, so a missing source can't look like another's bytes.
+	const std::string* paths[3] = { &occlusionPath, &roughnessPath, &metalPath };
+	MappedFile files[3];
+	uint32_t version = Version;
+	uint64_t hash = HashFNV1a(&version, sizeof(version));
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		if (!paths[i]->empty() && !files[i].Open(paths[i]->c_str()))
+			return TEXTURE_PACK_FAILED;
+
+		uint64_t size = files[i].GetSize();
+		hash = HashFNV1a(&size, sizeof(size), hash);
+		hash = HashFNV1a(files[i].GetData(), files[i].GetSize(), hash);
+	}
+
+	// Either format will do unless compression was asked for,
+	// so a baked copy isn't replaced by an uncompressed one
+	{
+		MappedFile existing;
+		DDSImage image;
+		if (existing.Open(outputPath.c_str()) &&
+			ParseDDS(existing.GetData(), existing.GetSize(), image) &&
+			image.SourceHash == hash &&
+			(!compress || image.DXGIFormat != DXGIFormatRGBA8))
+			return TEXTURE_PACK_UP_TO_DATE;
+	}
+
+	PackSourceImage images[3];
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		if (files[i].IsOpen() && !decoder(files[i].GetData(), files[i].GetSize(), images[i]))
+			return TEXTURE_PACK_FAILED;
+	}
+
+	DDSImage packed;
+	PackORM(&images[0], &images[1], &images[2], compress, packed);
+	packed.SourceHash = hash;
+
+	// Written beside the output and moved over it, so a
+	// failed or interrupted write leaves the old file (or
+	// none) rather than a truncated one that looks current
+	std::vector<unsigned char> data;
+	SerializeDDS(packed, data);
+	return WriteFileReplacing(outputPath.c_str(), data.data(), data.size()) ? TEXTURE_PACK_BUILT : TEXTURE_PACK_FAILED;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "DDSFile.h"
+
+// --------------------------------------------------------
+// A decoded source image, RGBA8
+// --------------------------------------------------------
+struct PackSourceImage
+{
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	std::vector<unsigned char> RGBA;
+};
+
+enum TexturePackResult
+{
+	TEXTURE_PACK_FAILED,
+	TEXTURE_PACK_UP_TO_DATE,	// The existing file came from the same sources
+	TEXTURE_PACK_BUILT
+};
+
+// --------------------------------------------------------
+// Packs a material's occlusion, roughness and metal maps
+// into one texture, so PBR shaders make one fetch for all
+// three instead of one each:
+//
+//  R - occlusion (1 when there's no occlusion map)
+//  G - roughness
+//  B - metal
+//  A - 1
+//
+// Each value comes from its source's red channel.  Sources
+// can be different sizes; the smaller ones are bilinearly
+// upsampled (wrapping, since material textures tile).
+// Sources with a single value everywhere don't count
+// towards the size, so packing solid colors gives a tiny
+// texture.
+//
+// The result is a .dds with a full mip chain, either RGBA8
+// or BC7.  It records a hash of the source files' bytes,
+// so BuildORM() only repacks when a source has changed.
+// Decoding is left to the caller, which keeps this free of
+// platform image libraries.
+// --------------------------------------------------------
+class TexturePacker
+{
+public:
+	// Bump whenever packing changes, to rebuild everything
+	static const uint32_t Version = 2;
+
+	// Decodes an encoded image file (png, etc.)
+	typedef std::function<bool(const unsigned char* data, size_t size, PackSourceImage& image)> ImageDecoder;
+
+	// Packs decoded images.  Null or empty sources use their
+	// default (occlusion 1, roughness 1, metal 0).
+	static void PackORM(
+		const PackSourceImage* occlusion,
+		const PackSourceImage* roughness,
+		const PackSourceImage* metal,
+		bool compress,
+		DDSImage& output);
+
+	// Packs the files at these paths into outputPath, unless
+	// it was already packed from the same files (and is
+	// compressed, if compress is set).  An empty occlusion
+	// path means no occlusion map.
+	static TexturePackResult BuildORM(
+		const std::string& occlusionPath,
+		const std::string& roughnessPath,
+		const std::string& metalPath,
+		const std::string& outputPath,
+		const ImageDecoder& decoder,
+		bool compress);
+};
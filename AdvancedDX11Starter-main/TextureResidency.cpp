@@ -0,0 +1,219 @@
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+TextureResidency::TextureResidency(size_t budget)
+	: budget(budget), maxLoadBytesPerUpdate(DefaultMaxLoadBytesPerUpdate), frameNumber(0)
+{
+	stats = {};
+}
+
+unsigned int TextureResidency::AddTexture(unsigned int width, unsigned int height, const std::vector<size_t>& mipBytes)
+{
+	Texture t = {};
+	t.MipBytes = mipBytes;
+	t.Width = width;
+
+	// The tail starts at the first mip that fits in TailSize
+	unsigned int mipCount = (unsigned int)mipBytes.size();
+	t.TailMip = mipCount > 0 ? mipCount - 1 : 0;
+	for (unsigned int mip = 0; mip < mipCount; mip++)
+	{
+		if ((width >> mip) <= TailSize && (height >> mip) <= TailSize)
+		{
+			t.TailMip = mip;
+			break;
+		}
+	}
+
+	t.ResidentMip = t.TailMip;
+	t.WantedMip = t.TailMip;
+	t.TargetMip = t.TailMip;
+	textures.push_back(t);
+	return (unsigned int)textures.size() - 1;
+}
+
+void TextureResidency::BeginFrame()
+{
+	frameNumber++;
+	for (Texture& t : textures)
+	{
+		t.RequiredTexels = 0;
+		t.Priority = 0;
+	}
+}
+
+void TextureResidency::Request(unsigned int texture, float requiredTexels, float priority)
+{
+	Texture& t = textures[texture];
+	t.RequiredTexels = (std::max)(t.RequiredTexels, requiredTexels);
+	t.Priority = (std::max)(t.Priority, priority < 0 ? requiredTexels : priority);
+	t.LastRequestedFrame = frameNumber;
+}
+
+// --------------------------------------------------------
+// Bytes for every mip from finestMip down to the smallest
+// --------------------------------------------------------
+size_t TextureResidency::GetBytes(const Texture& t, unsigned int finestMip)
+{
+	size_t bytes = 0;
+	for (unsigned int mip = finestMip; mip < t.MipBytes.size(); mip++)
+		bytes += t.MipBytes[mip];
+	return bytes;
+}
+
+size_t TextureResidency::GetResidentBytes()
+{
+	size_t bytes = 0;
+	for (Texture& t : textures)
+		bytes += GetBytes(t, t.ResidentMip);
+	return bytes;
+}
+
+void TextureResidency::Update()
+{
+	stats = {};
+	stats.Textures = (unsigned int)textures.size();
+	stats.Budget = budget;
+
+	// Tails are always resident, so only what's left over is
+	// handed out
+	size_t tailBytes = 0;
+	for (Texture& t : textures)
+		tailBytes += GetBytes(t, t.TailMip);
+	size_t remaining = budget > tailBytes ? budget - tailBytes : 0;
+
+	// One step is one mip finer for one texture.  Cheap steps
+	// for important textures go first, and each texture's
+	// next step is only considered once this one fits, so
+	// coarse mips always come before fine ones.
+	struct Step
+	{
+		float Priority;
+		unsigned int Texture;
+		unsigned int Mip;
+		bool operator<(const Step& other) const { return Priority < other.Priority; }
+	};
+	std::priority_queue<Step> steps;
+	std::vector<Step> accepted;
+
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		Texture& t = textures[i];
+		t.TargetMip = t.TailMip;
+		t.WantedMip = t.TailMip;
+		if (t.LastRequestedFrame != frameNumber)
+			continue;
+
+		stats.Requested++;
+		t.WantedMip = (std::min)(t.TailMip, CalculateWantedMip(t.Width, (unsigned int)t.MipBytes.size(), t.RequiredTexels));
+		if (t.WantedMip < t.TailMip)
+			steps.push({ t.Priority / (float)t.MipBytes[t.TailMip - 1], i, t.TailMip - 1 });
+	}
+
+	while (!steps.empty())
+	{
+		Step step = steps.top();
+		steps.pop();
+
+		Texture& t = textures[step.Texture];
+		if (t.MipBytes[step.Mip] > remaining)
+			continue;
+
+		remaining -= t.MipBytes[step.Mip];
+		t.TargetMip = step.Mip;
+		accepted.push_back(step);
+
+		if (step.Mip > t.WantedMip)
+			steps.push({ t.Priority / (float)t.MipBytes[step.Mip - 1], step.Texture, step.Mip - 1 });
+	}
+
+	// Whatever's left keeps resident mips nobody asked for
+	// this frame, most recently requested first.  Everything
+	// else is evicted.
+	std::vector<unsigned int> keepOrder;
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		if (textures[i].ResidentMip < textures[i].TargetMip)
+			keepOrder.push_back(i);
+	}
+	std::sort(keepOrder.begin(), keepOrder.end(), [this](unsigned int a, unsigned int b)
+	{
+		return textures[a].LastRequestedFrame > textures[b].LastRequestedFrame;
+	});
+
+	for (unsigned int i : keepOrder)
+	{
+		Texture& t = textures[i];
+		while (t.TargetMip > t.ResidentMip && t.MipBytes[t.TargetMip - 1] <= remaining)
+		{
+			remaining -= t.MipBytes[t.TargetMip - 1];
+			t.TargetMip--;
+		}
+	}
+
+	for (Texture& t : textures)
+	{
+		while (t.ResidentMip < t.TargetMip)
+		{
+			stats.Evictions++;
+			stats.EvictedBytes += t.MipBytes[t.ResidentMip];
+			t.ResidentMip++;
+		}
+	}
+
+	// Load in priority order, up to this update's limit.  A
+	// mip bigger than the whole limit may still load on its
+	// own, or it would never load at all.
+	size_t loadBudget = maxLoadBytesPerUpdate;
+	bool loadedAny = false;
+	for (const Step& step : accepted)
+	{
+		Texture& t = textures[step.Texture];
+		if (step.Mip + 1 != t.ResidentMip)
+			continue;
+		if (t.MipBytes[step.Mip] > loadBudget && loadedAny)
+			continue;
+
+		loadBudget -= (std::min)(loadBudget, t.MipBytes[step.Mip]);
+		loadedAny = true;
+		stats.Loads++;
+		stats.LoadedBytes += t.MipBytes[step.Mip];
+		t.ResidentMip = step.Mip;
+	}
+
+	for (Texture& t : textures)
+	{
+		if (t.LastRequestedFrame == frameNumber && t.ResidentMip > t.WantedMip)
+			stats.Starved++;
+	}
+	stats.ResidentBytes = GetResidentBytes();
+}
+
+unsigned int TextureResidency::CalculateWantedMip(unsigned int width, unsigned int mipCount, float requiredTexels)
+{
+	if (mipCount == 0)
+		return 0;
+	if (requiredTexels <= 0)
+		return mipCount - 1;
+
+	// Each mip halves the texels, so the finest mip needed is
+	// the one with at least requiredTexels across
+	float mip = std::floor(std::log2((float)width / requiredTexels));
+	if (mip <= 0)
+		return 0;
+	return (std::min)((unsigned int)mip, mipCount - 1);
+}
+
+float TextureResidency::CalculateRequiredTexels(float objectSize, float uvScale, float distance, float projectionScale, float screenHeight)
+{
+	// Pixels per world unit at this distance, with a floor on
+	// the distance so the camera inside an object is finite
+	const float minDistance = 0.1f;
+	float pixelsPerUnit = screenHeight * projectionScale / (2.0f * (std::max)(distance, minDistance));
+
+	float pixels = objectSize * pixelsPerUnit;
+	return pixels / (std::max)(uvScale, 0.0001f);
+}
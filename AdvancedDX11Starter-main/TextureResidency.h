@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Counts for the most recent Update()
+struct TextureResidencyStats
+{
+	unsigned int Textures;
+	unsigned int Requested;		// Textures asked for since BeginFrame()
+	unsigned int Starved;		// ...whose wanted mip isn't resident yet
+	unsigned int Loads;			// Mips loaded this update
+	unsigned int Evictions;		// Mips dropped this update
+	size_t LoadedBytes;
+	size_t EvictedBytes;
+	size_t ResidentBytes;
+	size_t Budget;
+};
+
+// --------------------------------------------------------
+// Decides which mips of each streamed texture should be in
+// memory, without touching any actual textures - so it can
+// be driven headless, from a simulated camera path, as
+// easily as from the renderer.
+//
+// Every texture keeps its small mips (up to TailSize
+// pixels) resident at all times.  Each frame, callers
+// Request() the textures they're drawing along with how
+// many texels they need across the texture.  Update()
+// then hands out the budget a mip at a time, coarsest
+// first, to the highest priority requests.  Finer mips
+// nothing asked for stay resident while there's room and
+// are evicted least recently requested first once there
+// isn't.  Loads are capped per update so streaming is
+// spread over frames.
+//
+// Mips are numbered the D3D way: 0 is full size.  A
+// texture's resident mip is the finest one in memory;
+// every coarser mip is resident too.
+// --------------------------------------------------------
+class TextureResidency
+{
+public:
+	static const unsigned int TailSize = 64;
+	static const size_t DefaultBudget = 128 * 1024 * 1024;
+	static const size_t DefaultMaxLoadBytesPerUpdate = 8 * 1024 * 1024;
+
+	TextureResidency(size_t budget = DefaultBudget);
+
+	// Registers a texture, with its tail already resident.
+	// mipBytes holds the size of each mip, finest first.
+	// Returns the id for the other calls.
+	unsigned int AddTexture(unsigned int width, unsigned int height, const std::vector<size_t>& mipBytes);
+	unsigned int GetTextureCount() { return (unsigned int)textures.size(); }
+
+	// Call once per frame before any Request()
+	void BeginFrame();
+
+	// Asks for enough detail to draw requiredTexels texels
+	// across the whole texture (see CalculateRequiredTexels()).
+	// Priority defaults to the texel count, so textures that
+	// are bigger on screen win.  Repeated requests keep the
+	// most demanding one.
+	void Request(unsigned int texture, float requiredTexels, float priority = -1.0f);
+
+	// Moves residency toward what this frame's requests want
+	void Update();
+
+	unsigned int GetResidentMip(unsigned int texture) { return textures[texture].ResidentMip; }
+	unsigned int GetWantedMip(unsigned int texture) { return textures[texture].WantedMip; }
+	unsigned int GetTailMip(unsigned int texture) { return textures[texture].TailMip; }
+
+	void SetBudget(size_t bytes) { budget = bytes; }
+	// A single mip over the limit still loads, alone
+	void SetMaxLoadBytesPerUpdate(size_t bytes) { maxLoadBytesPerUpdate = bytes; }
+	const TextureResidencyStats& GetStats() { return stats; }
+	size_t GetResidentBytes();
+
+	// The mip whose texels best match requiredTexels across
+	// a texture of the given width, clamped to its mips
+	static unsigned int CalculateWantedMip(unsigned int width, unsigned int mipCount, float requiredTexels);
+
+	// How many texels across one repeat of a texture an
+	// object needs: its size on screen in pixels, divided by
+	// how many times the texture repeats across it.
+	//
+	//  objectSize      - World space size of the object (e.g. bounding diameter)
+	//  uvScale         - Texture repeats across the object
+	//  distance        - From the camera to the object's nearest point
+	//  projectionScale - The projection matrix's _22 (1 / tan(fovY / 2))
+	//  screenHeight    - In pixels
+	static float CalculateRequiredTexels(float objectSize, float uvScale, float distance, float projectionScale, float screenHeight);
+
+private:
+	struct Texture
+	{
+		std::vector<size_t> MipBytes;
+		unsigned int Width;
+		unsigned int TailMip;		// Finest mip that's always resident
+		unsigned int ResidentMip;
+		unsigned int WantedMip;
+		unsigned int TargetMip;
+		float RequiredTexels;
+		float Priority;
+		uint64_t LastRequestedFrame;
+	};
+
+	std::vector<Texture> textures;
+	size_t budget;
+	size_t maxLoadBytesPerUpdate;
+	uint64_t frameNumber;
+	TextureResidencyStats stats;
+
+	size_t GetBytes(const Texture& t, unsigned int finestMip);
+};
@@ -0,0 +1,390 @@
+#include "TextureStreamer.h"
+#include "DDSFile.h"
+#include "MappedFile.h"
+#include "Material.h"
+#include "MipGenerator.h"
+#include "PNGDecoder.h"
+#include "Profiler.h"
+#include "TextureBaker.h"
+
+#include <wincodec.h>
+#include <algorithm>
+#include <chrono>
+
+#pragma comment(lib, "windowscodecs.lib")
+
+TextureStreamer::TextureStreamer(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	size_t budget)
+	:
+	device(device),
+	context(context),
+	residency(budget)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	for (TextureState& state : states)
+	{
+		if (state.PendingDecode.valid())
+			state.PendingDecode.wait();
+	}
+}
+
+std::shared_ptr<StreamedTexture> TextureStreamer::Load(const std::wstring& path, const TextureLoadOptions& options)
+{
+	return LoadGenerated(path, std::function<void()>(), options);
+}
+
+std::shared_ptr<StreamedTexture> TextureStreamer::LoadGenerated(const std::wstring& path, std::function<void()> build, const TextureLoadOptions& options)
+{
+	std::wstring normalizedPath = ResourceCache::NormalizePath(path);
+	std::wstring key = ResourceCache::MakeKey(normalizedPath, options);
+
+	auto it = textureTable.find(key);
+	if (it != textureTable.end())
+		return textures[it->second];
+
+	std::shared_ptr<StreamedTexture> texture = std::make_shared<StreamedTexture>();
+	texture->Path = normalizedPath;
+
+	TextureState state;
+	state.Texture = texture;
+	state.PendingDecode = std::async(std::launch::async, [normalizedPath, build, options]()
+	{
+		if (build)
+			build();
+		return Decode(normalizedPath, options);
+	});
+
+	textureTable[key] = (unsigned int)textures.size();
+	textures.push_back(texture);
+	states.push_back(std::move(state));
+	return texture;
+}
+
+void TextureStreamer::Bind(std::shared_ptr<Material> material, const std::string& name, std::shared_ptr<StreamedTexture> texture)
+{
+	auto it = std::find(textures.begin(), textures.end(), texture);
+	if (it == textures.end())
+		return;
+
+	unsigned int index = (unsigned int)(it - textures.begin());
+	states[index].Bindings.push_back({ material, name });
+	materialTextures[material.get()].push_back(index);
+
+	if (texture->SRV)
+		material->AddTextureSRV(name, texture->SRV);
+}
+
+void TextureStreamer::BeginFrame()
+{
+	residency.BeginFrame();
+}
+
+void TextureStreamer::RequestMaterial(Material* material, float requiredTexels)
+{
+	auto it = materialTextures.find(material);
+	if (it == materialTextures.end())
+		return;
+
+	for (unsigned int index : it->second)
+	{
+		if (states[index].Data)
+			residency.Request(states[index].ResidencyId, requiredTexels);
+	}
+}
+
+void TextureStreamer::Update()
+{
+	PROFILE_ZONE("Texture streaming");
+
+	for (TextureState& state : states)
+	{
+		if (state.PendingDecode.valid() &&
+			state.PendingDecode.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			FinishDecode(state);
+		}
+	}
+
+	residency.Update();
+
+	for (TextureState& state : states)
+	{
+		if (!state.Data)
+			continue;
+
+		unsigned int residentMip = residency.GetResidentMip(state.ResidencyId);
+		if (residentMip != state.Texture->ResidentMip)
+			Rebuild(state, residentMip);
+	}
+}
+
+void TextureStreamer::WaitForLoads()
+{
+	PROFILE_ZONE("Wait for streamed textures");
+	for (TextureState& state : states)
+	{
+		if (state.PendingDecode.valid())
+			FinishDecode(state);
+	}
+}
+
+// --------------------------------------------------------
+// Registers a decoded texture and uploads its tail
+// --------------------------------------------------------
+void TextureStreamer::FinishDecode(TextureState& state)
+{
+	state.Data = state.PendingDecode.get();
+	if (!state.Data)
+	{
+		state.Texture->Failed = true;
+		return;
+	}
+
+	std::vector<size_t> mipBytes;
+	for (std::vector<unsigned char>& mip : state.Data->Mips)
+		mipBytes.push_back(mip.size());
+
+	state.ResidencyId = residency.AddTexture(state.Data->Width, state.Data->Height, mipBytes);
+	state.Texture->Width = state.Data->Width;
+	state.Texture->Height = state.Data->Height;
+	state.Texture->CPUBytes = 0;
+	for (size_t bytes : mipBytes)
+		state.Texture->CPUBytes += bytes;
+
+	Rebuild(state, residency.GetResidentMip(state.ResidencyId));
+}
+
+// --------------------------------------------------------
+// Replaces the GPU texture with one holding the mips from
+// residentMip down, and points every bound material at it
+// (in place, so their compiled bindings stay valid)
+// --------------------------------------------------------
+void TextureStreamer::Rebuild(TextureState& state, unsigned int residentMip)
+{
+	TextureData& data = *state.Data;
+	unsigned int mipCount = (unsigned int)data.Mips.size();
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = (std::max)(1u, data.Width >> residentMip);
+	desc.Height = (std::max)(1u, data.Height >> residentMip);
+	desc.MipLevels = mipCount - residentMip;
+	desc.ArraySize = 1;
+	desc.Format = data.Format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData(desc.MipLevels);
+	size_t gpuBytes = 0;
+	for (unsigned int i = 0; i < desc.MipLevels; i++)
+	{
+		initialData[i].pSysMem = data.Mips[residentMip + i].data();
+		initialData[i].SysMemPitch = (UINT)DDSRowPitch(data.Format, (std::max)(1u, data.Width >> (residentMip + i)));
+		gpuBytes += data.Mips[residentMip + i].size();
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (FAILED(device->CreateTexture2D(&desc, initialData.data(), texture.GetAddressOf())) ||
+		FAILED(device->CreateShaderResourceView(texture.Get(), 0, srv.GetAddressOf())))
+	{
+		state.Texture->Failed = true;
+		return;
+	}
+
+	state.GPUTexture = texture;
+	state.Texture->SRV = srv;
+	state.Texture->ResidentMip = residentMip;
+	state.Texture->GPUBytes = gpuBytes;
+
+	for (auto& binding : state.Bindings)
+	{
+		std::shared_ptr<Material> material = binding.first.lock();
+		if (material)
+			material->ReplaceTextureSRV(binding.second, srv);
+	}
+}
+
+std::wstring TextureStreamer::GetCompressedPath(const std::wstring& path)
+{
+	size_t dot = path.find_last_of(L'.');
+	size_t slash = path.find_last_of(L"\\/");
+	if (dot == std::wstring::npos || (slash != std::wstring::npos && dot < slash))
+		return path + L".dds";
+	return path.substr(0, dot) + L".dds";
+}
+
+TextureLoadOptions TextureStreamer::GetMaterialTextureOptions(const std::wstring& path)
+{
+	std::wstring name = path.substr(0, path.find_last_of(L'.'));
+	auto endsWith = [&](const wchar_t* suffix)
+	{
+		size_t length = wcslen(suffix);
+		return name.size() >= length && name.compare(name.size() - length, length, suffix) == 0;
+	};
+
+	TextureLoadOptions options;
+	options.Mips.Filter = MIP_FILTER_KAISER;
+	options.Mips.Wrap = true;
+	if (endsWith(L"_albedo"))
+	{
+		options.Mips.SRGB = true;
+	}
+	else if (endsWith(L"_normals"))
+	{
+		options.IgnoreSRGB = true;
+		options.Mips.NormalMap = true;
+	}
+	return options;
+}
+
+// --------------------------------------------------------
+// Loads the .dds next to the image if there is one (baked
+// by TextureBaker) and it was baked from the image as it is
+// now, and decodes the image itself otherwise.  A .dds with
+// no image beside it is used as is.  Paths to .dds files
+// (like TexturePacker's) load directly.  Runs on worker
+// threads.
+// --------------------------------------------------------
+std::shared_ptr<TextureStreamer::TextureData> TextureStreamer::Decode(const std::wstring& path, const TextureLoadOptions& options)
+{
+	std::wstring compressedPath = GetCompressedPath(path);
+	MappedFile source;
+	if (_wcsicmp(compressedPath.c_str(), path.c_str()) != 0)
+		source.Open(path.c_str());
+
+	MappedFile file;
+	DDSImage image;
+	if (file.Open(compressedPath.c_str()) &&
+		ParseDDS(file.GetData(), file.GetSize(), image) &&
+		(!source.IsOpen() || image.SourceHash == TextureBaker::HashSource(source.GetData(), source.GetSize())))
+	{
+		std::shared_ptr<TextureData> data = std::make_shared<TextureData>();
+		data->Format = (DXGI_FORMAT)image.DXGIFormat;
+		data->Width = image.Width;
+		data->Height = image.Height;
+		data->Mips = std::move(image.Mips);
+
+		// The baker keeps the source's sRGB-ness, but the
+		// options still win where the format has both
+		if (options.ForceSRGB && data->Format == DXGI_FORMAT_BC1_UNORM) data->Format = DXGI_FORMAT_BC1_UNORM_SRGB;
+		if (options.ForceSRGB && data->Format == DXGI_FORMAT_BC7_UNORM) data->Format = DXGI_FORMAT_BC7_UNORM_SRGB;
+		if (options.IgnoreSRGB && data->Format == DXGI_FORMAT_BC1_UNORM_SRGB) data->Format = DXGI_FORMAT_BC1_UNORM;
+		if (options.IgnoreSRGB && data->Format == DXGI_FORMAT_BC7_UNORM_SRGB) data->Format = DXGI_FORMAT_BC7_UNORM;
+		return data;
+	}
+
+	if (!source.IsOpen())
+		return 0;
+	return DecodeImage(source.GetData(), source.GetSize(), options);
+}
+
+std::shared_ptr<TextureStreamer::TextureData> TextureStreamer::DecodeImage(const std::wstring& path, const TextureLoadOptions& options)
+{
+	MappedFile file;
+	if (!file.Open(path.c_str()))
+		return 0;
+	return DecodeImage(file.GetData(), file.GetSize(), options);
+}
+
+// --------------------------------------------------------
+// Decodes the top mip of any image WIC can read.  Picks an
+// sRGB format the same way the WIC texture loader does, so
+// streamed textures look the same as loaded ones.
+// --------------------------------------------------------
+static std::shared_ptr<TextureStreamer::TextureData> DecodeWithWIC(const unsigned char* fileData, size_t fileSize, const TextureLoadOptions& options)
+{
+	HRESULT coInit = CoInitializeEx(0, COINIT_MULTITHREADED);
+
+	std::shared_ptr<TextureStreamer::TextureData> data;
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICStream> stream;
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+		UINT width = 0, height = 0;
+
+		if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))) &&
+			SUCCEEDED(factory->CreateStream(stream.GetAddressOf())) &&
+			SUCCEEDED(stream->InitializeFromMemory((BYTE*)fileData, (DWORD)fileSize)) &&
+			SUCCEEDED(factory->CreateDecoderFromStream(stream.Get(), 0, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())) &&
+			SUCCEEDED(decoder->GetFrame(0, frame.GetAddressOf())) &&
+			SUCCEEDED(frame->GetSize(&width, &height)) &&
+			width > 0 && height > 0 &&
+			SUCCEEDED(factory->CreateFormatConverter(converter.GetAddressOf())) &&
+			SUCCEEDED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, 0, 0, WICBitmapPaletteTypeCustom)))
+		{
+			std::vector<unsigned char> pixels((size_t)width * height * 4);
+			if (SUCCEEDED(converter->CopyPixels(0, width * 4, (UINT)pixels.size(), pixels.data())))
+			{
+				bool sRGB = options.ForceSRGB;
+				Microsoft::WRL::ComPtr<IWICMetadataQueryReader> metadata;
+				GUID container = {};
+				if (!sRGB && !options.IgnoreSRGB &&
+					SUCCEEDED(frame->GetMetadataQueryReader(metadata.GetAddressOf())) &&
+					SUCCEEDED(decoder->GetContainerFormat(&container)))
+				{
+					PROPVARIANT value;
+					PropVariantInit(&value);
+					if (container == GUID_ContainerFormatPng)
+						sRGB = SUCCEEDED(metadata->GetMetadataByName(L"/sRGB/RenderingIntent", &value)) && value.vt == VT_UI1;
+					else
+						sRGB = SUCCEEDED(metadata->GetMetadataByName(L"System.Image.ColorSpace", &value)) && value.vt == VT_UI2 && value.uiVal == 1;
+					PropVariantClear(&value);
+				}
+
+				data = std::make_shared<TextureStreamer::TextureData>();
+				data->Format = sRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+				data->Width = width;
+				data->Height = height;
+				data->Mips.push_back(std::move(pixels));
+			}
+		}
+	}
+
+	if (SUCCEEDED(coInit))
+		CoUninitialize();
+	return data;
+}
+
+// --------------------------------------------------------
+// Decodes an image to RGBA8 and builds its mip chain on
+// the CPU.  PNGs decode straight into the top mip, and
+// only fall back to WIC if that fails.  sRGB images are
+// always filtered in linear space.
+// --------------------------------------------------------
+std::shared_ptr<TextureStreamer::TextureData> TextureStreamer::DecodeImage(const unsigned char* fileData, size_t fileSize, const TextureLoadOptions& options)
+{
+	PROFILE_ZONE("Decode streamed texture");
+
+	// An sRGB chunk makes it sRGB, as it does for WIC
+	std::shared_ptr<TextureData> data;
+	PNGInfo png;
+	if (ReadPNGInfo(fileData, fileSize, png))
+	{
+		data = std::make_shared<TextureData>();
+		data->Format = (options.ForceSRGB || (png.SRGB && !options.IgnoreSRGB)) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+		data->Width = png.Width;
+		data->Height = png.Height;
+		data->Mips.emplace_back((size_t)png.Width * png.Height * 4);
+		if (!DecodePNG(fileData, fileSize, data->Mips[0].data(), (size_t)png.Width * 4))
+			data = 0;
+	}
+
+	if (!data)
+		data = DecodeWithWIC(fileData, fileSize, options);
+
+	if (data && options.GenerateMips)
+	{
+		MipOptions mipOptions = options.Mips;
+		mipOptions.SRGB = mipOptions.SRGB || data->Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		GenerateMipChain(data->Mips, data->Width, data->Height, mipOptions);
+	}
+	return data;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ResourceCache.h"
+#include "TextureResidency.h"
+
+class Material;
+
+// --------------------------------------------------------
+// A texture whose GPU copy only holds the mips its
+// residency allows.  The SRV is replaced whenever that
+// changes, and materials it's bound to are updated.
+// --------------------------------------------------------
+struct StreamedTexture
+{
+	std::wstring Path;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;	// Null until decoded
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	unsigned int ResidentMip = 0;	// Finest mip in the GPU texture
+	size_t GPUBytes = 0;
+	size_t CPUBytes = 0;			// Every mip, kept to stream from
+	bool Failed = false;
+
+	bool IsReady() const { return SRV != 0; }
+};
+
+// --------------------------------------------------------
+// Streams material textures' mips in and out based on how
+// big they are on screen, keeping the GPU copies under a
+// memory budget (see TextureResidency for the policy).
+//
+// Textures are decoded on worker threads, with every mip
+// kept in CPU memory.  A block compressed .dds baked next
+// to the image (see TextureBaker) is used instead when
+// there is one.  Only the small tail is uploaded at
+// first; finer mips follow as they're needed.  Each
+// frame:
+//
+//  streamer->BeginFrame();
+//  for each drawn entity: streamer->RequestMaterial(material, texels);
+//  streamer->Update();
+//
+// where texels comes from TextureResidency::CalculateRequiredTexels().
+// --------------------------------------------------------
+class TextureStreamer
+{
+public:
+	TextureStreamer(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		size_t budget = TextureResidency::DefaultBudget);
+	~TextureStreamer();
+
+	// Starts decoding a texture.  Loading the same path with
+	// the same options again returns the same texture.
+	std::shared_ptr<StreamedTexture> Load(const std::wstring& path, const TextureLoadOptions& options = TextureLoadOptions());
+
+	// Like Load(), but runs build on the decoding thread first,
+	// for files made from others (like packed ORM maps) that
+	// may need remaking before they're read.  Only the first
+	// load of a path and options builds.
+	std::shared_ptr<StreamedTexture> LoadGenerated(const std::wstring& path, std::function<void()> build, const TextureLoadOptions& options = TextureLoadOptions());
+
+	// Sets the texture on the material now, and again
+	// whenever its SRV changes
+	void Bind(std::shared_ptr<Material> material, const std::string& name, std::shared_ptr<StreamedTexture> texture);
+
+	void BeginFrame();
+
+	// Asks for enough detail in every streamed texture bound
+	// to the material for requiredTexels across one repeat
+	void RequestMaterial(Material* material, float requiredTexels);
+
+	// Finishes decodes, updates residency and rebuilds any
+	// textures whose resident mips changed
+	void Update();
+
+	// Blocks until every texture is decoded
+	void WaitForLoads();
+
+	TextureResidency& GetResidency() { return residency; }
+	const std::vector<std::shared_ptr<StreamedTexture>>& GetTextures() { return textures; }
+
+	struct TextureData
+	{
+		DXGI_FORMAT Format;
+		unsigned int Width;
+		unsigned int Height;
+		std::vector<std::vector<unsigned char>> Mips;	// Finest first
+	};
+
+	// Decodes an image file (or one already in memory) to
+	// RGBA8 - PNGs with PNGDecoder, anything else with WIC -
+	// with a full mip chain built on the CPU (see
+	// MipGenerator) unless GenerateMips is off.  Null if it
+	// can't be read.
+	static std::shared_ptr<TextureData> DecodeImage(const std::wstring& path, const TextureLoadOptions& options);
+	static std::shared_ptr<TextureData> DecodeImage(const unsigned char* fileData, size_t fileSize, const TextureLoadOptions& options);
+
+	// The block compressed copy Load() looks for first
+	static std::wstring GetCompressedPath(const std::wstring& path);
+
+	// How a material texture should be loaded, from its name:
+	// *_albedo is sRGB and *_normals is a linear normal map,
+	// both with Kaiser filtered, wrapping mips
+	static TextureLoadOptions GetMaterialTextureOptions(const std::wstring& path);
+
+private:
+	struct TextureState
+	{
+		std::shared_ptr<StreamedTexture> Texture;
+		std::future<std::shared_ptr<TextureData>> PendingDecode;
+		std::shared_ptr<TextureData> Data;
+		unsigned int ResidencyId = 0xFFFFFFFF;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> GPUTexture;
+		std::vector<std::pair<std::weak_ptr<Material>, std::string>> Bindings;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	TextureResidency residency;
+
+	std::vector<std::shared_ptr<StreamedTexture>> textures;
+	std::vector<TextureState> states;	// Parallel to textures
+	std::unordered_map<std::wstring, unsigned int> textureTable;
+	std::unordered_map<Material*, std::vector<unsigned int>> materialTextures;
+
+	void FinishDecode(TextureState& state);
+	void Rebuild(TextureState& state, unsigned int residentMip);
+
+	static std::shared_ptr<TextureData> Decode(const std::wstring& path, const TextureLoadOptions& options);
+};
@@ -0,0 +1,344 @@
+#!/usr/bin/env python3
+"""
+Generates C++ structs matching the cbuffers in the project's shaders.
+
+Each cbuffer in each .hlsl file becomes a struct named after the file and
+the buffer (cbuffer perFrame in PixelShaderPBR.hlsl is PixelShaderPBRPerFrame),
+laid out with HLSL's constant buffer packing rules: members can't straddle
+a 16 byte register, and matrices, arrays and structs start on a new one.
+Any gaps get explicit padding, and every offset and the total size are
+checked with static_assert, so a layout this script gets wrong fails to
+compile rather than uploading garbage.  Each struct also records a hash
+of its layout, matching ShaderMetadataBuffer::LayoutHash(), which
+SimpleShader checks before a struct is copied into a buffer - many
+shaders share buffer names like "externalData".
+
+HLSL structs used in cbuffers that already have a C++ version (see
+KnownStructs) aren't redefined - the existing struct is checked against
+the HLSL layout instead.
+
+Run as a pre-build step:
+
+    python Tools/GenerateShaderStructs.py <shader folder> <output header>
+
+The header is only rewritten when its contents change, so builds that
+don't touch a shader don't recompile everything that includes it.  With
+--check first, nothing is written, and the exit code is 1 if the header
+is out of date (CMakeLists.txt runs it this way on every build).
+"""
+
+import os
+import re
+import sys
+
+# HLSL structs with a hand written C++ equivalent: name -> header
+KnownStructs = {
+    "Light": "Lights.h",
+}
+
+# HLSL type -> (C++ type, size in bytes, starts a new register)
+Types = {
+    "float": ("float", 4, False),
+    "int": ("int", 4, False),
+    "uint": ("unsigned int", 4, False),
+    "dword": ("unsigned int", 4, False),
+    "bool": ("int", 4, False),
+    "float2": ("DirectX::XMFLOAT2", 8, False),
+    "float3": ("DirectX::XMFLOAT3", 12, False),
+    "float4": ("DirectX::XMFLOAT4", 16, False),
+    "int2": ("DirectX::XMINT2", 8, False),
+    "int3": ("DirectX::XMINT3", 12, False),
+    "int4": ("DirectX::XMINT4", 16, False),
+    "uint2": ("DirectX::XMUINT2", 8, False),
+    "uint3": ("DirectX::XMUINT3", 12, False),
+    "uint4": ("DirectX::XMUINT4", 16, False),
+    "matrix": ("DirectX::XMFLOAT4X4", 64, True),
+    "float4x4": ("DirectX::XMFLOAT4X4", 64, True),
+}
+
+Modifiers = {"row_major", "column_major", "precise", "uniform", "const"}
+
+
+class LayoutError(Exception):
+    pass
+
+
+class Member:
+    def __init__(self, name, cpp_type, offset, size, count):
+        self.name = name
+        self.cpp_type = cpp_type
+        self.offset = offset
+        self.size = size      # Whole member, including array padding
+        self.count = count    # Array length, or 0 if not an array
+
+
+class Layout:
+    def __init__(self, name, members, size):
+        self.name = name
+        self.members = members
+        self.size = size
+
+
+def strip_comments(text):
+    text = re.sub(r"/\*.*?\*/", " ", text, flags=re.S)
+    return re.sub(r"//[^\n]*", "", text)
+
+
+def read_source(path, seen=None):
+    """Reads a shader and everything it #includes, comments removed"""
+    seen = seen if seen is not None else set()
+    path = os.path.normpath(path)
+    if path in seen:
+        return ""
+    seen.add(path)
+
+    with open(path, encoding="utf-8-sig", errors="replace") as f:
+        text = strip_comments(f.read())
+
+    def include(match):
+        return read_source(os.path.join(os.path.dirname(path), match.group(1)), seen)
+
+    return re.sub(r'^\s*#include\s+"([^"]+)"', include, text, flags=re.M)
+
+
+def read_defines(text):
+    defines = {}
+    for name, value in re.findall(r"^\s*#define\s+(\w+)\s+([^\n]+)", text, flags=re.M):
+        defines[name] = value.strip()
+    return defines
+
+
+def evaluate_count(expression, defines):
+    expression = expression.strip()
+    for _ in range(8):
+        if expression in defines:
+            expression = defines[expression].strip()
+    if not re.fullmatch(r"[0-9]+", expression):
+        raise LayoutError("can't evaluate array size '%s'" % expression)
+    return int(expression)
+
+
+def parse_declarations(body, defines):
+    """Yields (type, name, array count) for each variable in a block"""
+    for statement in body.split(";"):
+        statement = statement.strip()
+        if not statement:
+            continue
+        if "packoffset" in statement:
+            raise LayoutError("packoffset isn't supported")
+
+        # Drop semantics and modifiers
+        statement = statement.split(":")[0]
+        words = statement.replace(",", " , ").split()
+        words = [w for w in words if w not in Modifiers]
+        if len(words) < 2:
+            raise LayoutError("can't parse '%s'" % statement)
+
+        hlsl_type = words[0]
+        for declarator in " ".join(words[1:]).split(","):
+            match = re.fullmatch(r"\s*(\w+)\s*(?:\[\s*([^\]]+)\s*\])?\s*", declarator)
+            if not match:
+                raise LayoutError("can't parse '%s'" % declarator)
+            count = evaluate_count(match.group(2), defines) if match.group(2) else 0
+            yield hlsl_type, match.group(1), count
+
+
+def align16(value):
+    return (value + 15) & ~15
+
+
+def lay_out(name, body, structs, defines):
+    """Applies HLSL constant buffer packing to a block of declarations"""
+    members = []
+    offset = 0
+    for hlsl_type, member_name, count in parse_declarations(body, defines):
+        if hlsl_type in Types:
+            cpp_type, size, new_register = Types[hlsl_type]
+        elif hlsl_type in structs:
+            inner = structs[hlsl_type]
+            cpp_type, size, new_register = hlsl_type, align16(inner.size), True
+        else:
+            raise LayoutError("unsupported type '%s'" % hlsl_type)
+
+        if count:
+            # Elements are 16 byte aligned, but the last one isn't
+            # padded, and C++ arrays can't express that
+            if size % 16 != 0:
+                raise LayoutError("arrays of '%s' aren't supported" % hlsl_type)
+            new_register = True
+            size *= count
+
+        if new_register or (offset % 16) + size > 16:
+            offset = align16(offset)
+        members.append(Member(member_name, cpp_type, offset, size, count))
+        offset += size
+
+    return Layout(name, members, offset)
+
+
+def find_blocks(keyword, text):
+    """Finds "keyword Name ... { body }" blocks"""
+    pattern = keyword + r"\s+(\w+)[^{;]*\{([^}]*)\}"
+    return re.findall(pattern, text)
+
+
+def layout_hash(layout):
+    """FNV-1a of each member's name, offset and size, then the buffer's
+    size - the same as ShaderMetadataBuffer::LayoutHash() works out from
+    reflection"""
+    hash = 2166136261
+
+    def mix(data):
+        nonlocal hash
+        for byte in data:
+            hash = ((hash ^ byte) * 16777619) & 0xFFFFFFFF
+
+    for m in layout.members:
+        mix(m.name.encode("utf-8") + b"\0")
+        mix(m.offset.to_bytes(4, "little"))
+        mix(m.size.to_bytes(4, "little"))
+    mix(align16(layout.size).to_bytes(4, "little"))
+    return hash
+
+
+def pascal_case(name):
+    return name[:1].upper() + name[1:]
+
+
+def emit_struct(layout, buffer_name, source, register):
+    lines = []
+    lines.append("// %s, cbuffer %s%s" % (source, buffer_name, " : register(%s)" % register if register else ""))
+    lines.append("struct %s" % layout.name)
+    lines.append("{")
+    lines.append('\tstatic constexpr const char* BufferName = "%s";' % buffer_name)
+    lines.append("\tstatic constexpr unsigned int LayoutHash = 0x%08X;" % layout_hash(layout))
+    lines.append("")
+
+    position = 0
+    padding = 0
+    for m in layout.members:
+        if m.offset > position:
+            lines.append("\tfloat _pad%d[%d];" % (padding, (m.offset - position) // 4))
+            padding += 1
+        array = "[%d]" % m.count if m.count else ""
+        lines.append("\t%s %s%s;" % (m.cpp_type, m.name, array))
+        position = m.offset + m.size
+
+    # The GPU buffer is always a whole number of registers
+    size = align16(layout.size)
+    if size > position:
+        lines.append("\tfloat _pad%d[%d];" % (padding, (size - position) // 4))
+    lines.append("};")
+
+    for m in layout.members:
+        lines.append("static_assert(offsetof(%s, %s) == %d, \"%s::%s is misplaced\");" % (layout.name, m.name, m.offset, layout.name, m.name))
+    lines.append("static_assert(sizeof(%s) == %d, \"%s has the wrong size\");" % (layout.name, size, layout.name))
+    return "\n".join(lines)
+
+
+def emit_known_struct_checks(layout):
+    lines = ["// %s (from %s) must match the HLSL struct" % (layout.name, KnownStructs[layout.name])]
+    for m in layout.members:
+        lines.append("static_assert(offsetof(%s, %s) == %d, \"%s::%s doesn't match HLSL\");" % (layout.name, m.name, m.offset, layout.name, m.name))
+    lines.append("static_assert(sizeof(%s) == %d, \"%s doesn't match HLSL\");" % (layout.name, align16(layout.size), layout.name))
+    return "\n".join(lines)
+
+
+def generate(shader_folder):
+    sections = []
+    used_structs = {}
+    warnings = []
+
+    for file_name in sorted(os.listdir(shader_folder)):
+        if not file_name.endswith(".hlsl"):
+            continue
+
+        text = read_source(os.path.join(shader_folder, file_name))
+        defines = read_defines(text)
+        stem = os.path.splitext(file_name)[0]
+
+        # Structs have to be laid out before the cbuffers using them
+        structs = {}
+        for struct_name, body in find_blocks("struct", text):
+            try:
+                structs[struct_name] = lay_out(struct_name, body, structs, defines)
+            except LayoutError:
+                pass  # Vertex formats and the like, never in a cbuffer
+
+        pattern = r"cbuffer\s+(\w+)\s*(?::\s*register\s*\(\s*(\w+)\s*\))?\s*\{([^}]*)\}"
+        for buffer_name, register, body in re.findall(pattern, text):
+            struct_name = stem + pascal_case(buffer_name)
+            try:
+                layout = lay_out(struct_name, body, structs, defines)
+            except LayoutError as e:
+                warnings.append("%s: cbuffer %s skipped - %s" % (file_name, buffer_name, e))
+                continue
+
+            for m in layout.members:
+                if m.cpp_type in structs:
+                    if m.cpp_type not in KnownStructs:
+                        warnings.append("%s: cbuffer %s skipped - struct %s has no C++ version" % (file_name, buffer_name, m.cpp_type))
+                        break
+                    used_structs[m.cpp_type] = structs[m.cpp_type]
+            else:
+                sections.append(emit_struct(layout, buffer_name, file_name, register))
+
+    header = [
+        "// Generated by Tools/GenerateShaderStructs.py from the cbuffers in",
+        "// this project's shaders - don't edit by hand.  Fill one in and pass",
+        "// it to ISimpleShader::SetBufferData() to set a whole buffer at once.",
+        "#pragma once",
+        "",
+        "#include <DirectXMath.h>",
+        "#include <cstddef>",
+    ]
+    for name in sorted(used_structs):
+        header.append('#include "%s"' % KnownStructs[name])
+    header.append("")
+
+    for name in sorted(used_structs):
+        header.append(emit_known_struct_checks(used_structs[name]))
+        header.append("")
+
+    for section in sections:
+        header.append(section)
+        header.append("")
+
+    return "\n".join(header), warnings
+
+
+def main():
+    args = sys.argv[1:]
+    check = args[:1] == ["--check"]
+    if check:
+        args = args[1:]
+    if len(args) != 2:
+        print("Usage: GenerateShaderStructs.py [--check] <shader folder> <output header>", file=sys.stderr)
+        return 1
+
+    shader_folder, output_path = args
+    contents, warnings = generate(shader_folder)
+    for warning in warnings:
+        print("GenerateShaderStructs: warning: " + warning, file=sys.stderr)
+
+    existing = None
+    if os.path.exists(output_path):
+        with open(output_path, encoding="utf-8") as f:
+            existing = f.read()
+
+    if check:
+        if existing != contents:
+            print("GenerateShaderStructs: error: %s is out of date - rerun Tools/GenerateShaderStructs.py" % output_path, file=sys.stderr)
+            return 1
+        return 0
+
+    if existing != contents:
+        with open(output_path, "w", encoding="utf-8", newline="\n") as f:
+            f.write(contents)
+        print("GenerateShaderStructs: wrote " + output_path)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())